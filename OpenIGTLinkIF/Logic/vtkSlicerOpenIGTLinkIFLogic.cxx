@@ -30,6 +30,7 @@
 
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
   #include "vtkMRMLBitStreamNode.h"
+  #include "vtkMRMLBitStreamStorageNode.h"
 #endif
 
 // OpenIGTLinkIO Device includes
@@ -157,6 +158,7 @@ void vtkSlicerOpenIGTLinkIFLogic::RegisterNodes()
   scene->RegisterNodeClass(vtkNew<vtkMRMLIGTLSensorNode>().GetPointer());
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
   scene->RegisterNodeClass(vtkNew<vtkMRMLBitStreamNode>().GetPointer());
+  scene->RegisterNodeClass(vtkNew<vtkMRMLBitStreamStorageNode>().GetPointer());
 #endif
 }
 
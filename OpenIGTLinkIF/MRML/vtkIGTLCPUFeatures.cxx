@@ -0,0 +1,103 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCPUFeatures.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLCPUFeatures.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+#if defined(_MSC_VER) && defined(OpenIGTLinkIF_USE_SSE2)
+  #include <intrin.h>
+  #include <immintrin.h>
+#endif
+
+namespace
+{
+  enum
+  {
+    FeatureSSE2 = 0x1,
+    FeatureAVX2 = 0x2,
+  };
+
+  //---------------------------------------------------------------------------
+  int DetectFeatures()
+  {
+    int features = 0;
+#if defined(OpenIGTLinkIF_USE_SSE2)
+    features |= FeatureSSE2;
+#endif
+#if defined(OpenIGTLinkIF_USE_AVX2)
+  #if defined(_MSC_VER)
+    int info[4] = { 0, 0, 0, 0 };
+    __cpuid(info, 0);
+    if (info[0] >= 7)
+      {
+      __cpuid(info, 1);
+      bool osSavesYMM = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 0x6) == 0x6);
+      __cpuidex(info, 7, 0);
+      if (osSavesYMM && (info[1] & (1 << 5)))
+        {
+        features |= FeatureAVX2;
+        }
+      }
+  #else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      {
+      features |= FeatureAVX2;
+      }
+  #endif
+#endif
+    return features;
+  }
+
+  //---------------------------------------------------------------------------
+  int GetFeatures()
+  {
+    static const int features = DetectFeatures();
+    return features;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLCPUFeatures);
+
+//----------------------------------------------------------------------------
+vtkIGTLCPUFeatures::vtkIGTLCPUFeatures()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCPUFeatures::~vtkIGTLCPUFeatures()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCPUFeatures::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "SSE2: " << (vtkIGTLCPUFeatures::HasSSE2() ? "yes" : "no") << "\n";
+  os << indent << "AVX2: " << (vtkIGTLCPUFeatures::HasAVX2() ? "yes" : "no") << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCPUFeatures::HasSSE2()
+{
+  return (GetFeatures() & FeatureSSE2) != 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCPUFeatures::HasAVX2()
+{
+  return (GetFeatures() & FeatureAVX2) != 0;
+}
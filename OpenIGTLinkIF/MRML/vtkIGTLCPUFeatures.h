@@ -0,0 +1,64 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCPUFeatures.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLCPUFeatures_h
+#define __vtkIGTLCPUFeatures_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// Compile-time availability of the SIMD kernels used by the module.
+// SSE2 kernels are built when the compiler targets SSE2 (always the case on x86-64),
+// AVX2 kernels are built with a function-level target and selected at run time.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define OpenIGTLinkIF_USE_SSE2
+#endif
+#if defined(OpenIGTLinkIF_USE_SSE2) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+  #if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+    #define OpenIGTLinkIF_USE_AVX2
+    #define OpenIGTLinkIF_TARGET_AVX2 __attribute__((target("avx2")))
+  #elif defined(_MSC_VER) && _MSC_VER >= 1800
+    #define OpenIGTLinkIF_USE_AVX2
+    #define OpenIGTLinkIF_TARGET_AVX2
+  #endif
+#endif
+
+/// \brief Run time detection of the instruction sets used by the SIMD kernels of the module.
+///
+/// The result of the detection is cached, so the methods are cheap enough to be
+/// called once per processed frame.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLCPUFeatures : public vtkObject
+{
+public:
+  static vtkIGTLCPUFeatures *New();
+  vtkTypeMacro(vtkIGTLCPUFeatures, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Returns true if SSE2 kernels are compiled in and supported by the processor.
+  static bool HasSSE2();
+
+  /// Returns true if AVX2 kernels are compiled in and supported by the processor and the OS.
+  static bool HasAVX2();
+
+protected:
+  vtkIGTLCPUFeatures();
+  ~vtkIGTLCPUFeatures();
+
+private:
+  vtkIGTLCPUFeatures(const vtkIGTLCPUFeatures&); // Not implemented
+  void operator=(const vtkIGTLCPUFeatures&);     // Not implemented
+};
+
+#endif
@@ -0,0 +1,160 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCapabilityDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLCapabilityDevice.h"
+
+// OpenIGTLink includes
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+// vtkIGTLGetCapabilityMessage
+
+//----------------------------------------------------------------------------
+vtkIGTLGetCapabilityMessage::vtkIGTLGetCapabilityMessage()
+{
+  this->m_SendMessageType = "GET_CAPABIL";
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLGetCapabilityMessage::~vtkIGTLGetCapabilityMessage()
+{
+}
+
+//----------------------------------------------------------------------------
+// vtkIGTLCapabilityDevice
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLCapabilityDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLCapabilityDevice::vtkIGTLCapabilityDevice()
+{
+  this->OutMessage = igtl::CapabilityMessage::New();
+  this->InMessage = igtl::CapabilityMessage::New();
+  this->GetMessage = vtkIGTLGetCapabilityMessage::New();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCapabilityDevice::~vtkIGTLCapabilityDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCapabilityDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Types:";
+  for (size_t i = 0; i < this->Types.size(); ++i)
+  {
+    os << " " << this->Types[i];
+  }
+  os << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkIGTLCapabilityDevice::GetDeviceContentModifiedEvent() const
+{
+  return CapabilityModifiedEvent;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCapabilityDevice::GetDeviceType() const
+{
+  return vtkIGTLCapabilityDevice::GetIGTLTypeName();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCapabilityDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  if (strcmp(buffer->GetDeviceType(), "GET_CAPABIL") == 0)
+  {
+    // No body
+    this->InvokeEvent(CapabilityRequestEvent, this);
+    return 1;
+  }
+
+  this->InMessage->SetMessageHeader(buffer);
+  this->InMessage->AllocateBuffer();
+  memcpy(this->InMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->InMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack CAPABIL message " << this->GetDeviceName());
+    return 0;
+  }
+
+  this->Types = this->InMessage->GetTypes();
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->InMessage->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(CapabilityModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLCapabilityDevice::GetIGTLMessage()
+{
+  this->OutMessage->SetTypes(this->Types);
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->GetTime();
+  this->OutMessage->SetDeviceName(this->GetDeviceName().c_str());
+  this->OutMessage->SetTimeStamp(timestamp);
+  this->OutMessage->Pack();
+  return igtl::MessageBase::Pointer(this->OutMessage.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLCapabilityDevice::GetIGTLMessage(MESSAGE_PREFIX prefix)
+{
+  if (prefix == MESSAGE_PREFIX_NOT_DEFINED)
+  {
+    return this->GetIGTLMessage();
+  }
+  if (prefix == MESSAGE_PREFIX_GET)
+  {
+    this->GetMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->GetMessage->Pack();
+    return igtl::MessageBase::Pointer(this->GetMessage.GetPointer());
+  }
+  return igtl::MessageBase::Pointer();
+}
+
+//----------------------------------------------------------------------------
+std::set<igtlio::Device::MESSAGE_PREFIX> vtkIGTLCapabilityDevice::GetSupportedMessagePrefixes() const
+{
+  std::set<MESSAGE_PREFIX> retval;
+  retval.insert(MESSAGE_PREFIX_NOT_DEFINED);
+  retval.insert(MESSAGE_PREFIX_GET);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCapabilityDevice::SetTypes(const std::vector<std::string>& types)
+{
+  this->Types = types;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+const std::vector<std::string>& vtkIGTLCapabilityDevice::GetTypes()
+{
+  return this->Types;
+}
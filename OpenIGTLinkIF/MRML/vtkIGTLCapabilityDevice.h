@@ -0,0 +1,99 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCapabilityDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLCapabilityDevice_h
+#define __vtkIGTLCapabilityDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioDevice.h"
+
+// OpenIGTLink includes
+#include <igtlCapabilityMessage.h>
+#include <igtlMessageBase.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+/// \brief GET_CAPABIL message: request of the CAPABIL message of the peer, without body.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLGetCapabilityMessage : public igtl::HeaderOnlyMessageBase
+{
+public:
+  typedef vtkIGTLGetCapabilityMessage    Self;
+  typedef igtl::HeaderOnlyMessageBase    Superclass;
+  typedef igtl::SmartPointer<Self>       Pointer;
+  typedef igtl::SmartPointer<const Self> ConstPointer;
+
+  igtlTypeMacro(vtkIGTLGetCapabilityMessage, igtl::HeaderOnlyMessageBase);
+  igtlNewMacro(vtkIGTLGetCapabilityMessage);
+
+protected:
+  vtkIGTLGetCapabilityMessage();
+  ~vtkIGTLGetCapabilityMessage();
+};
+
+/// \brief OpenIGTLinkIO device for the CAPABIL message type.
+///
+/// A CAPABIL message lists the message types that a peer can receive, a GET_CAPABIL message
+/// requests the list. A received GET_CAPABIL invokes CapabilityRequestEvent, the list is sent
+/// with the NOT_DEFINED prefix. The OpenIGTLinkIO device factory does not know this message type,
+/// so a receiver must add the device before the first message arrives, and both peers must use
+/// the same device name (see vtkMRMLIGTLConnectorNode::SetCapabilityNegotiation).
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLCapabilityDevice : public igtlio::Device
+{
+public:
+  enum
+  {
+    CapabilityModifiedEvent = 119008,
+    CapabilityRequestEvent = 119009,
+  };
+
+  static vtkIGTLCapabilityDevice *New();
+  vtkTypeMacro(vtkIGTLCapabilityDevice, igtlio::Device);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static const char* GetIGTLTypeName() { return "CAPABIL"; };
+
+  virtual unsigned int GetDeviceContentModifiedEvent() const VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage() VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage(MESSAGE_PREFIX prefix) VTK_OVERRIDE;
+  virtual std::set<MESSAGE_PREFIX> GetSupportedMessagePrefixes() const VTK_OVERRIDE;
+
+#ifndef __VTK_WRAP__
+  /// Types to send, or the last received types
+  void SetTypes(const std::vector<std::string>& types);
+  const std::vector<std::string>& GetTypes();
+#endif
+
+protected:
+  vtkIGTLCapabilityDevice();
+  ~vtkIGTLCapabilityDevice();
+
+#ifndef __VTK_WRAP__
+  std::vector<std::string> Types;
+#endif
+
+  igtl::CapabilityMessage::Pointer OutMessage;
+  igtl::CapabilityMessage::Pointer InMessage;
+  vtkIGTLGetCapabilityMessage::Pointer GetMessage;
+
+private:
+  vtkIGTLCapabilityDevice(const vtkIGTLCapabilityDevice&); // Not implemented
+  void operator=(const vtkIGTLCapabilityDevice&);          // Not implemented
+};
+
+#endif
@@ -0,0 +1,190 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLClockOffsetEstimator.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLClockOffsetEstimator.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  struct RoundTripDelayLess
+  {
+    template <class T>
+    bool operator()(const T& a, const T& b) const
+    {
+      return a.RoundTripDelay < b.RoundTripDelay;
+    }
+  };
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLClockOffsetEstimator);
+
+//----------------------------------------------------------------------------
+vtkIGTLClockOffsetEstimator::vtkIGTLClockOffsetEstimator()
+{
+  this->MaximumNumberOfSamples = 64;
+  this->MinimumDriftTimeSpan = 30.0;
+  this->Reset();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLClockOffsetEstimator::~vtkIGTLClockOffsetEstimator()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLClockOffsetEstimator::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "MaximumNumberOfSamples: " << this->MaximumNumberOfSamples << "\n";
+  os << indent << "MinimumDriftTimeSpan: " << this->MinimumDriftTimeSpan << " s\n";
+  os << indent << "NumberOfSamples: " << this->Samples.size() << "\n";
+  os << indent << "ReferenceTime: " << this->ReferenceTime << " s\n";
+  os << indent << "Offset: " << this->Offset << " s\n";
+  os << indent << "Drift: " << this->Drift << "\n";
+  os << indent << "MinimumRoundTripDelay: " << this->MinimumRoundTripDelay << " s\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLClockOffsetEstimator::Reset()
+{
+  this->Samples.clear();
+  this->ReferenceTime = 0.0;
+  this->Offset = 0.0;
+  this->Drift = 0.0;
+  this->MinimumRoundTripDelay = 0.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLClockOffsetEstimator::AddSample(double requestSendTime, double requestReceiveTime,
+                                            double responseSendTime, double responseReceiveTime)
+{
+  Sample sample;
+  sample.LocalTime = 0.5 * (requestSendTime + responseReceiveTime);
+  sample.Offset = 0.5 * ((requestReceiveTime - requestSendTime) + (responseSendTime - responseReceiveTime));
+  sample.RoundTripDelay = (responseReceiveTime - requestSendTime) - (responseSendTime - requestReceiveTime);
+  if (sample.RoundTripDelay < 0.0)
+  {
+    // The remote processing time cannot be longer than the round trip
+    sample.RoundTripDelay = 0.0;
+  }
+  this->Samples.push_back(sample);
+  if (static_cast<int>(this->Samples.size()) > this->MaximumNumberOfSamples)
+  {
+    this->Samples.erase(this->Samples.begin(), this->Samples.end() - this->MaximumNumberOfSamples);
+  }
+  this->UpdateEstimate();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLClockOffsetEstimator::UpdateEstimate()
+{
+  // Exchanges delayed by the network or by processing have an asymmetric delay and
+  // an inaccurate offset. Keep the half with the shortest round trip.
+  std::vector<Sample> selected(this->Samples);
+  std::sort(selected.begin(), selected.end(), RoundTripDelayLess());
+  this->MinimumRoundTripDelay = selected[0].RoundTripDelay;
+  selected.resize((selected.size() + 1) / 2);
+
+  double n = static_cast<double>(selected.size());
+  double meanTime = 0.0;
+  double meanOffset = 0.0;
+  double minimumTime = selected[0].LocalTime;
+  double maximumTime = selected[0].LocalTime;
+  for (size_t i = 0; i < selected.size(); ++i)
+  {
+    meanTime += selected[i].LocalTime;
+    meanOffset += selected[i].Offset;
+    minimumTime = std::min(minimumTime, selected[i].LocalTime);
+    maximumTime = std::max(maximumTime, selected[i].LocalTime);
+  }
+  meanTime /= n;
+  meanOffset /= n;
+
+  this->ReferenceTime = meanTime;
+  this->Offset = meanOffset;
+  this->Drift = 0.0;
+  if (selected.size() >= 3 && maximumTime - minimumTime >= this->MinimumDriftTimeSpan)
+  {
+    double covariance = 0.0;
+    double variance = 0.0;
+    for (size_t i = 0; i < selected.size(); ++i)
+    {
+      double dt = selected[i].LocalTime - meanTime;
+      covariance += dt * (selected[i].Offset - meanOffset);
+      variance += dt * dt;
+    }
+    if (variance > 0.0)
+    {
+      this->Drift = covariance / variance;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLClockOffsetEstimator::GetNumberOfSamples()
+{
+  return static_cast<int>(this->Samples.size());
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLClockOffsetEstimator::IsValid()
+{
+  return !this->Samples.empty();
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLClockOffsetEstimator::GetOffset(double localTime)
+{
+  return this->Offset + this->Drift * (localTime - this->ReferenceTime);
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLClockOffsetEstimator::GetDrift()
+{
+  return this->Drift;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLClockOffsetEstimator::GetMinimumRoundTripDelay()
+{
+  return this->MinimumRoundTripDelay;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLClockOffsetEstimator::RemoteToLocalTime(double remoteTime)
+{
+  if (this->Samples.empty())
+  {
+    return remoteTime;
+  }
+  // Solve remoteTime = localTime + Offset + Drift * (localTime - ReferenceTime)
+  return this->ReferenceTime + (remoteTime - this->Offset - this->ReferenceTime) / (1.0 + this->Drift);
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLClockOffsetEstimator::LocalToRemoteTime(double localTime)
+{
+  if (this->Samples.empty())
+  {
+    return localTime;
+  }
+  return localTime + this->GetOffset(localTime);
+}
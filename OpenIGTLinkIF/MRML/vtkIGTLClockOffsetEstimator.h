@@ -0,0 +1,102 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLClockOffsetEstimator.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLClockOffsetEstimator_h
+#define __vtkIGTLClockOffsetEstimator_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+/// \brief Estimation of the offset and drift of a remote clock from ping exchanges (NTP-style).
+///
+/// Each exchange gives four times: request sent (local), request received (remote),
+/// response sent (remote), response received (local). The offset of the exchange is
+/// ((t2 - t1) + (t3 - t4)) / 2, its error is at most half of the round-trip delay.
+/// The estimate uses the exchanges with the shortest round-trip delay. When the exchanges span
+/// enough time, the drift is estimated by a linear fit of the offset over the local time.
+/// Times are in seconds.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLClockOffsetEstimator : public vtkObject
+{
+public:
+  static vtkIGTLClockOffsetEstimator *New();
+  vtkTypeMacro(vtkIGTLClockOffsetEstimator, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Number of most recent exchanges used for the estimation
+  vtkGetMacro(MaximumNumberOfSamples, int);
+  vtkSetClampMacro(MaximumNumberOfSamples, int, 1, 10000);
+
+  /// Minimum time covered by the exchanges to estimate the drift, in seconds
+  vtkGetMacro(MinimumDriftTimeSpan, double);
+  vtkSetClampMacro(MinimumDriftTimeSpan, double, 0.0, 1e6);
+
+  /// Add the times of a ping exchange
+  void AddSample(double requestSendTime, double requestReceiveTime, double responseSendTime, double responseReceiveTime);
+
+  /// Remove all exchanges
+  void Reset();
+
+  int GetNumberOfSamples();
+
+  /// True if at least one exchange was added
+  bool IsValid();
+
+  /// Remote clock minus local clock at the given local time
+  double GetOffset(double localTime);
+
+  /// Rate of change of the offset (seconds per second)
+  double GetDrift();
+
+  /// Shortest round-trip delay of the exchanges
+  double GetMinimumRoundTripDelay();
+
+  /// Convert a remote time to local time. The time is returned unchanged if there is no estimate.
+  double RemoteToLocalTime(double remoteTime);
+
+  /// Convert a local time to remote time. The time is returned unchanged if there is no estimate.
+  double LocalToRemoteTime(double localTime);
+
+protected:
+  vtkIGTLClockOffsetEstimator();
+  ~vtkIGTLClockOffsetEstimator();
+
+  void UpdateEstimate();
+
+  struct Sample
+  {
+    double LocalTime;
+    double Offset;
+    double RoundTripDelay;
+  };
+
+  std::vector<Sample> Samples;
+  int MaximumNumberOfSamples;
+  double MinimumDriftTimeSpan;
+
+  // Offset at ReferenceTime (local) and drift
+  double ReferenceTime;
+  double Offset;
+  double Drift;
+  double MinimumRoundTripDelay;
+
+private:
+  vtkIGTLClockOffsetEstimator(const vtkIGTLClockOffsetEstimator&); // Not implemented
+  void operator=(const vtkIGTLClockOffsetEstimator&);              // Not implemented
+};
+
+#endif
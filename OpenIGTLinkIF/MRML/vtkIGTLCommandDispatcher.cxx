@@ -0,0 +1,370 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandDispatcher.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLCommandDispatcher.h"
+#include "vtkIGTLCommandHandler.h"
+#include "vtkIGTLCommandRequest.h"
+
+// VTK includes
+#include <vtkConditionVariable.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+#include <deque>
+#include <map>
+
+//----------------------------------------------------------------------------
+class vtkIGTLCommandDispatcher::vtkInternal
+{
+public:
+  vtkInternal();
+
+  static VTK_THREAD_RETURN_TYPE WorkerThread(void* arg);
+  void RunWorker();
+
+  /// Start the worker threads if they are not running. The mutex must be locked.
+  void StartThreads();
+
+  /// Stop the worker threads. The mutex must not be locked.
+  void StopThreads();
+
+  struct JobType
+  {
+    vtkSmartPointer<vtkIGTLCommandRequest> Request;
+    vtkSmartPointer<vtkIGTLCommandHandler> Handler;
+  };
+
+  vtkSimpleMutexLock Mutex;
+  vtkSmartPointer<vtkConditionVariable> WorkAvailable;
+  vtkSmartPointer<vtkConditionVariable> MRMLAccessChanged;
+  vtkSmartPointer<vtkMultiThreader> Threader;
+  std::vector<int> ThreadIDs;
+  int NumberOfThreads;
+  bool Stopping;
+
+  std::map<std::string, vtkSmartPointer<vtkIGTLCommandHandler> > Handlers;
+  std::deque<JobType> QueuedJobs;
+  int NumberOfRunningJobs;
+  std::vector< vtkSmartPointer<vtkIGTLCommandRequest> > CompletedRequests;
+
+  // MRML access handshake: handlers wait until the main thread is paused, then take turns
+  int NumberOfMRMLAccessRequests;
+  bool MainThreadPaused;
+  bool MRMLAccessHeld;
+};
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandDispatcher::vtkInternal::vtkInternal()
+{
+  this->WorkAvailable = vtkSmartPointer<vtkConditionVariable>::New();
+  this->MRMLAccessChanged = vtkSmartPointer<vtkConditionVariable>::New();
+  this->Threader = vtkSmartPointer<vtkMultiThreader>::New();
+  this->NumberOfThreads = 2;
+  this->Stopping = false;
+  this->NumberOfRunningJobs = 0;
+  this->NumberOfMRMLAccessRequests = 0;
+  this->MainThreadPaused = false;
+  this->MRMLAccessHeld = false;
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkIGTLCommandDispatcher::vtkInternal::WorkerThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  static_cast<vtkInternal*>(info->UserData)->RunWorker();
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::vtkInternal::RunWorker()
+{
+  this->Mutex.Lock();
+  while (true)
+  {
+    while (!this->Stopping && this->QueuedJobs.empty())
+    {
+      this->WorkAvailable->Wait(this->Mutex);
+    }
+    if (this->Stopping)
+    {
+      break;
+    }
+    JobType job = this->QueuedJobs.front();
+    this->QueuedJobs.pop_front();
+    ++this->NumberOfRunningJobs;
+    this->Mutex.Unlock();
+
+    job.Handler->Execute(job.Request);
+
+    this->Mutex.Lock();
+    --this->NumberOfRunningJobs;
+    this->CompletedRequests.push_back(job.Request);
+  }
+  this->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::vtkInternal::StartThreads()
+{
+  if (!this->ThreadIDs.empty())
+  {
+    return;
+  }
+  for (int i = 0; i < this->NumberOfThreads; ++i)
+  {
+    this->ThreadIDs.push_back(this->Threader->SpawnThread(&vtkInternal::WorkerThread, this));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::vtkInternal::StopThreads()
+{
+  this->Mutex.Lock();
+  this->Stopping = true;
+  this->WorkAvailable->Broadcast();
+  this->MRMLAccessChanged->Broadcast();
+  std::vector<int> threadIDs;
+  threadIDs.swap(this->ThreadIDs);
+  this->Mutex.Unlock();
+
+  for (size_t i = 0; i < threadIDs.size(); ++i)
+  {
+    this->Threader->TerminateThread(threadIDs[i]);
+  }
+
+  this->Mutex.Lock();
+  this->Stopping = false;
+  this->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLCommandDispatcher);
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandDispatcher::vtkIGTLCommandDispatcher()
+{
+  this->Internal = new vtkInternal;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandDispatcher::~vtkIGTLCommandDispatcher()
+{
+  this->Shutdown();
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  this->Internal->Mutex.Lock();
+  os << indent << "NumberOfThreads: " << this->Internal->NumberOfThreads << "\n";
+  os << indent << "NumberOfRunningThreads: " << this->Internal->ThreadIDs.size() << "\n";
+  os << indent << "NumberOfQueuedRequests: " << this->Internal->QueuedJobs.size() << "\n";
+  os << indent << "NumberOfRunningRequests: " << this->Internal->NumberOfRunningJobs << "\n";
+  os << indent << "Handlers:\n";
+  std::map<std::string, vtkSmartPointer<vtkIGTLCommandHandler> >::iterator iter;
+  for (iter = this->Internal->Handlers.begin(); iter != this->Internal->Handlers.end(); ++iter)
+  {
+    os << indent.GetNextIndent() << iter->first << ": " << iter->second->GetClassName() << "\n";
+  }
+  this->Internal->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::RegisterHandler(const std::string& commandName, vtkIGTLCommandHandler* handler)
+{
+  if (handler == NULL)
+  {
+    this->UnregisterHandler(commandName);
+    return;
+  }
+  this->Internal->Mutex.Lock();
+  this->Internal->Handlers[commandName] = handler;
+  this->Internal->Mutex.Unlock();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::UnregisterHandler(const std::string& commandName)
+{
+  // Queued requests keep a reference to their handler and still run
+  this->Internal->Mutex.Lock();
+  bool modified = (this->Internal->Handlers.erase(commandName) > 0);
+  this->Internal->Mutex.Unlock();
+  if (modified)
+  {
+    this->Modified();
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandHandler* vtkIGTLCommandDispatcher::GetHandler(const std::string& commandName)
+{
+  this->Internal->Mutex.Lock();
+  std::map<std::string, vtkSmartPointer<vtkIGTLCommandHandler> >::iterator iter = this->Internal->Handlers.find(commandName);
+  vtkIGTLCommandHandler* handler = (iter != this->Internal->Handlers.end()) ? iter->second.GetPointer() : NULL;
+  this->Internal->Mutex.Unlock();
+  return handler;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandDispatcher::HasHandler(const std::string& commandName)
+{
+  return this->GetHandler(commandName) != NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::SetNumberOfThreads(int numberOfThreads)
+{
+  numberOfThreads = std::max(0, std::min(numberOfThreads, 64));
+  if (numberOfThreads == this->GetNumberOfThreads())
+  {
+    return;
+  }
+  // Queued requests are kept, the new threads take them over
+  this->Internal->StopThreads();
+  this->Internal->Mutex.Lock();
+  this->Internal->NumberOfThreads = numberOfThreads;
+  if (!this->Internal->QueuedJobs.empty())
+  {
+    this->Internal->StartThreads();
+  }
+  this->Internal->Mutex.Unlock();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCommandDispatcher::GetNumberOfThreads()
+{
+  this->Internal->Mutex.Lock();
+  int numberOfThreads = this->Internal->NumberOfThreads;
+  this->Internal->Mutex.Unlock();
+  return numberOfThreads;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandDispatcher::Submit(vtkIGTLCommandRequest* request)
+{
+  if (request == NULL)
+  {
+    return false;
+  }
+  vtkInternal::JobType job;
+  job.Request = request;
+  this->Internal->Mutex.Lock();
+  std::map<std::string, vtkSmartPointer<vtkIGTLCommandHandler> >::iterator iter =
+    this->Internal->Handlers.find(request->GetCommandName());
+  if (iter == this->Internal->Handlers.end())
+  {
+    this->Internal->Mutex.Unlock();
+    return false;
+  }
+  job.Handler = iter->second;
+  if (this->Internal->NumberOfThreads == 0)
+  {
+    this->Internal->Mutex.Unlock();
+    request->SetDispatcher(NULL);
+    job.Handler->Execute(request);
+    this->Internal->Mutex.Lock();
+    this->Internal->CompletedRequests.push_back(request);
+    this->Internal->Mutex.Unlock();
+    return true;
+  }
+  request->SetDispatcher(this);
+  this->Internal->QueuedJobs.push_back(job);
+  this->Internal->StartThreads();
+  this->Internal->WorkAvailable->Signal();
+  this->Internal->Mutex.Unlock();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCommandDispatcher::GetNumberOfPendingRequests()
+{
+  this->Internal->Mutex.Lock();
+  int count = static_cast<int>(this->Internal->QueuedJobs.size()) + this->Internal->NumberOfRunningJobs;
+  this->Internal->Mutex.Unlock();
+  return count;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::PopCompletedRequests(std::vector< vtkSmartPointer<vtkIGTLCommandRequest> >& requests)
+{
+  this->Internal->Mutex.Lock();
+  requests.insert(requests.end(), this->Internal->CompletedRequests.begin(), this->Internal->CompletedRequests.end());
+  this->Internal->CompletedRequests.clear();
+  this->Internal->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::ProcessMRMLAccessRequests()
+{
+  this->Internal->Mutex.Lock();
+  if (this->Internal->NumberOfMRMLAccessRequests > 0 && !this->Internal->Stopping)
+  {
+    this->Internal->MainThreadPaused = true;
+    this->Internal->MRMLAccessChanged->Broadcast();
+    while (!this->Internal->Stopping
+      && (this->Internal->NumberOfMRMLAccessRequests > 0 || this->Internal->MRMLAccessHeld))
+    {
+      this->Internal->MRMLAccessChanged->Wait(this->Internal->Mutex);
+    }
+    this->Internal->MainThreadPaused = false;
+  }
+  this->Internal->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandDispatcher::BeginMRMLAccess()
+{
+  this->Internal->Mutex.Lock();
+  ++this->Internal->NumberOfMRMLAccessRequests;
+  while (!this->Internal->Stopping && (!this->Internal->MainThreadPaused || this->Internal->MRMLAccessHeld))
+  {
+    this->Internal->MRMLAccessChanged->Wait(this->Internal->Mutex);
+  }
+  --this->Internal->NumberOfMRMLAccessRequests;
+  bool granted = !this->Internal->Stopping;
+  if (granted)
+  {
+    this->Internal->MRMLAccessHeld = true;
+  }
+  else
+  {
+    this->Internal->MRMLAccessChanged->Broadcast();
+  }
+  this->Internal->Mutex.Unlock();
+  return granted;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::EndMRMLAccess()
+{
+  this->Internal->Mutex.Lock();
+  this->Internal->MRMLAccessHeld = false;
+  this->Internal->MRMLAccessChanged->Broadcast();
+  this->Internal->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandDispatcher::Shutdown()
+{
+  this->Internal->Mutex.Lock();
+  this->Internal->QueuedJobs.clear();
+  this->Internal->Mutex.Unlock();
+  this->Internal->StopThreads();
+}
@@ -0,0 +1,92 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandDispatcher.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLCommandDispatcher_h
+#define __vtkIGTLCommandDispatcher_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+class vtkIGTLCommandHandler;
+class vtkIGTLCommandRequest;
+
+/// \brief Registry of command handlers by command name, executed by a pool of worker threads.
+///
+/// The connector node submits each received COMMAND message that has a handler and sends the
+/// responses of the completed requests from PeriodicProcess, with the command ID of the request.
+/// Requests are started in the order they are received, and may complete in any order.
+/// A handler that needs MRML calls vtkIGTLCommandRequest::BeginMRMLAccess, which waits until
+/// the main thread calls ProcessMRMLAccessRequests and pauses it until EndMRMLAccess.
+/// With 0 threads, handlers run on the thread that submits the request.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLCommandDispatcher : public vtkObject
+{
+public:
+  static vtkIGTLCommandDispatcher *New();
+  vtkTypeMacro(vtkIGTLCommandDispatcher, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Set the handler of a command name, replacing the previous one. NULL removes the handler.
+  void RegisterHandler(const std::string& commandName, vtkIGTLCommandHandler* handler);
+  void UnregisterHandler(const std::string& commandName);
+  vtkIGTLCommandHandler* GetHandler(const std::string& commandName);
+  bool HasHandler(const std::string& commandName);
+
+  /// Number of worker threads (0-64, default 2). Threads are started at the first request.
+  /// Changing the number waits for the running handlers to return.
+  void SetNumberOfThreads(int numberOfThreads);
+  int GetNumberOfThreads();
+
+  /// Queue the request for execution by the handler of its command name.
+  /// Returns false if there is no handler for the command name.
+  bool Submit(vtkIGTLCommandRequest* request);
+
+  /// Number of requests that are queued or running
+  int GetNumberOfPendingRequests();
+
+#ifndef __VTK_WRAP__
+  /// Move the requests whose handler returned to requests, in order of completion
+  void PopCompletedRequests(std::vector< vtkSmartPointer<vtkIGTLCommandRequest> >& requests);
+#endif
+
+  /// Called on the main thread: if handlers wait for MRML access, let them access MRML one after
+  /// the other and return when no handler waits anymore.
+  void ProcessMRMLAccessRequests();
+
+  /// Stop the worker threads after their running handler returns and drop the queued requests.
+  /// Handlers waiting for MRML access are denied. The threads are restarted by the next request.
+  void Shutdown();
+
+  /// Called by vtkIGTLCommandRequest on a worker thread
+  bool BeginMRMLAccess();
+  void EndMRMLAccess();
+
+protected:
+  vtkIGTLCommandDispatcher();
+  ~vtkIGTLCommandDispatcher();
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+private:
+  vtkIGTLCommandDispatcher(const vtkIGTLCommandDispatcher&); // Not implemented
+  void operator=(const vtkIGTLCommandDispatcher&);           // Not implemented
+};
+
+#endif
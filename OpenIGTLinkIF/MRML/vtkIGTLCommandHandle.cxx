@@ -0,0 +1,415 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandHandle.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLCommandHandle.h"
+#include "vtkIGTLXMLDocument.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <pthread.h>
+  #include <sys/time.h>
+#endif
+
+//----------------------------------------------------------------------------
+// Mutex and condition variable with a timed wait, which vtkSimpleConditionVariable does not provide
+class vtkIGTLCommandHandle::vtkInternal
+{
+public:
+  vtkInternal()
+  {
+#if defined(_WIN32)
+    InitializeCriticalSection(&this->Mutex);
+    InitializeConditionVariable(&this->Condition);
+#else
+    pthread_mutex_init(&this->Mutex, NULL);
+    pthread_cond_init(&this->Condition, NULL);
+#endif
+  }
+
+  ~vtkInternal()
+  {
+#if defined(_WIN32)
+    DeleteCriticalSection(&this->Mutex);
+#else
+    pthread_cond_destroy(&this->Condition);
+    pthread_mutex_destroy(&this->Mutex);
+#endif
+  }
+
+  void Lock()
+  {
+#if defined(_WIN32)
+    EnterCriticalSection(&this->Mutex);
+#else
+    pthread_mutex_lock(&this->Mutex);
+#endif
+  }
+
+  void Unlock()
+  {
+#if defined(_WIN32)
+    LeaveCriticalSection(&this->Mutex);
+#else
+    pthread_mutex_unlock(&this->Mutex);
+#endif
+  }
+
+  void Broadcast()
+  {
+#if defined(_WIN32)
+    WakeAllConditionVariable(&this->Condition);
+#else
+    pthread_cond_broadcast(&this->Condition);
+#endif
+  }
+
+  /// Release the mutex and wait at most timeout seconds for a broadcast. Must be called with the mutex locked.
+  /// May return early (spurious wakeup), the caller checks its condition again.
+  void TimedWait(double timeout)
+  {
+#if defined(_WIN32)
+    SleepConditionVariableCS(&this->Condition, &this->Mutex, static_cast<DWORD>(timeout * 1000.0 + 0.5));
+#else
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    double deadline = now.tv_sec + now.tv_usec * 1e-6 + timeout;
+    struct timespec deadlineSpec;
+    deadlineSpec.tv_sec = static_cast<time_t>(deadline);
+    deadlineSpec.tv_nsec = static_cast<long>((deadline - deadlineSpec.tv_sec) * 1e9);
+    if (deadlineSpec.tv_nsec >= 1000000000L)
+    {
+      deadlineSpec.tv_sec += 1;
+      deadlineSpec.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&this->Condition, &this->Mutex, &deadlineSpec);
+#endif
+  }
+
+#if defined(_WIN32)
+  CRITICAL_SECTION Mutex;
+  CONDITION_VARIABLE Condition;
+#else
+  pthread_mutex_t Mutex;
+  pthread_cond_t Condition;
+#endif
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLCommandHandle);
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandHandle::vtkIGTLCommandHandle()
+{
+  this->Internal = new vtkInternal;
+  this->CommandID = -1;
+  this->SendTime = 0.0;
+  this->Timeout = 0.0;
+  this->Status = STATUS_WAITING;
+  this->ResponseDocument = vtkIGTLXMLDocument::New();
+  this->ResponseDocumentParsed = false;
+  this->CompletionTime = 0.0;
+  this->ResponseFromCache = false;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandHandle::~vtkIGTLCommandHandle()
+{
+  this->ResponseDocument->Delete();
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandHandle::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  this->Internal->Lock();
+  os << indent << "CommandID: " << this->CommandID << "\n";
+  os << indent << "DeviceName: " << this->DeviceName << "\n";
+  os << indent << "CommandName: " << this->CommandName << "\n";
+  os << indent << "SendTime: " << this->SendTime << "\n";
+  os << indent << "Timeout: " << this->Timeout << "\n";
+  os << indent << "Status: " << GetStatusAsString(this->Status) << "\n";
+  os << indent << "ResponseName: " << this->ResponseName << "\n";
+  os << indent << "CompletionTime: " << this->CompletionTime << "\n";
+  os << indent << "ResponseFromCache: " << (this->ResponseFromCache ? "true" : "false") << "\n";
+  this->Internal->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandHandle::Initialize(const std::string& deviceName, const std::string& commandName,
+                                      const std::string& content, double timeout)
+{
+  this->Internal->Lock();
+  this->CommandID = -1;
+  this->DeviceName = deviceName;
+  this->CommandName = commandName;
+  this->CommandContent = content;
+  this->SendTime = 0.0;
+  this->Timeout = timeout;
+  this->Status = STATUS_WAITING;
+  this->ResponseName.clear();
+  this->ResponseContent.clear();
+  this->ResponseDocument->Clear();
+  this->ResponseDocumentParsed = false;
+  this->CompletionTime = 0.0;
+  this->ResponseFromCache = false;
+  this->Internal->Unlock();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandHandle::SetSent(int commandID, double sendTime)
+{
+  this->Internal->Lock();
+  this->CommandID = commandID;
+  this->SendTime = sendTime;
+  this->Internal->Unlock();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::IsSent()
+{
+  return this->GetCommandID() >= 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCommandHandle::GetCommandID()
+{
+  this->Internal->Lock();
+  int commandID = this->CommandID;
+  this->Internal->Unlock();
+  return commandID;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandHandle::GetDeviceName()
+{
+  return this->DeviceName;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandHandle::GetCommandName()
+{
+  return this->CommandName;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandHandle::GetCommandContent()
+{
+  return this->CommandContent;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLCommandHandle::GetSendTime()
+{
+  this->Internal->Lock();
+  double time = this->SendTime;
+  this->Internal->Unlock();
+  return time;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLCommandHandle::GetTimeout()
+{
+  return this->Timeout;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLCommandHandle::GetExpiryTime()
+{
+  return this->GetSendTime() + this->Timeout;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCommandHandle::GetStatus()
+{
+  this->Internal->Lock();
+  int status = this->Status;
+  this->Internal->Unlock();
+  return status;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLCommandHandle::GetStatusAsString(int status)
+{
+  switch (status)
+  {
+    case STATUS_WAITING: return "Waiting";
+    case STATUS_SUCCESS: return "Success";
+    case STATUS_EXPIRED: return "Expired";
+    case STATUS_CANCELLED: return "Cancelled";
+    case STATUS_FAILED: return "Failed";
+    default: return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::IsDone()
+{
+  return this->GetStatus() != STATUS_WAITING;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandHandle::GetResponseName()
+{
+  this->Internal->Lock();
+  std::string name = this->ResponseName;
+  this->Internal->Unlock();
+  return name;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandHandle::GetResponseContent()
+{
+  this->Internal->Lock();
+  std::string content = this->ResponseContent;
+  this->Internal->Unlock();
+  return content;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLXMLDocument* vtkIGTLCommandHandle::GetResponseDocument()
+{
+  this->Internal->Lock();
+  if (this->Status != STATUS_SUCCESS)
+  {
+    this->Internal->Unlock();
+    return NULL;
+  }
+  if (!this->ResponseDocumentParsed)
+  {
+    // The response content does not change once the handle is completed
+    this->ResponseDocument->ParseBuffer(this->ResponseContent.data(), this->ResponseContent.size());
+    this->ResponseDocumentParsed = true;
+  }
+  this->Internal->Unlock();
+  return this->ResponseDocument;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLCommandHandle::GetCompletionTime()
+{
+  this->Internal->Lock();
+  double time = this->CompletionTime;
+  this->Internal->Unlock();
+  return time;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::GetResponseFromCache()
+{
+  this->Internal->Lock();
+  bool fromCache = this->ResponseFromCache;
+  this->Internal->Unlock();
+  return fromCache;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::Wait(double timeout)
+{
+  double deadline = vtkTimerLog::GetUniversalTime() + timeout;
+  this->Internal->Lock();
+  while (this->Status == STATUS_WAITING)
+  {
+    if (timeout < 0.0)
+    {
+      // Wake up regularly so that the wait survives a missed broadcast
+      this->Internal->TimedWait(1.0);
+      continue;
+    }
+    double remaining = deadline - vtkTimerLog::GetUniversalTime();
+    if (remaining <= 0.0)
+    {
+      break;
+    }
+    this->Internal->TimedWait(remaining);
+  }
+  bool done = (this->Status != STATUS_WAITING);
+  this->Internal->Unlock();
+  return done;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::Cancel()
+{
+  std::string noContent;
+  return this->Complete(STATUS_CANCELLED, "", noContent, vtkTimerLog::GetUniversalTime());
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::SetResponse(const std::string& name, const std::string& content, double time)
+{
+  std::string responseContent = content;
+  return this->Complete(STATUS_SUCCESS, name, responseContent, time);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::TakeResponse(const std::string& name, std::string& content, double time)
+{
+  return this->Complete(STATUS_SUCCESS, name, content, time);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::SetCachedResponse(const std::string& name, const std::string& content, double time)
+{
+  this->Internal->Lock();
+  if (this->Status == STATUS_WAITING)
+  {
+    this->ResponseFromCache = true;
+  }
+  this->Internal->Unlock();
+  std::string responseContent = content;
+  return this->Complete(STATUS_SUCCESS, name, responseContent, time);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::Expire(double time)
+{
+  std::string noContent;
+  return this->Complete(STATUS_EXPIRED, "", noContent, time);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::Fail(double time)
+{
+  std::string noContent;
+  return this->Complete(STATUS_FAILED, "", noContent, time);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandHandle::Complete(int status, const std::string& name, std::string& content, double time)
+{
+  this->Internal->Lock();
+  if (this->Status != STATUS_WAITING)
+  {
+    this->Internal->Unlock();
+    return false;
+  }
+  this->Status = status;
+  this->ResponseName = name;
+  this->ResponseContent.clear();
+  this->ResponseContent.swap(content);
+  this->CompletionTime = time;
+  this->Internal->Broadcast();
+  this->Internal->Unlock();
+
+  // Observers are notified without the lock, they may query the handle
+  this->Modified();
+  this->InvokeEvent(CommandCompletedEvent, this);
+  return true;
+}
@@ -0,0 +1,158 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandHandle.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLCommandHandle_h
+#define __vtkIGTLCommandHandle_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <string>
+
+class vtkIGTLXMLDocument;
+
+/// \brief State of a COMMAND message sent by a connector, until its response arrives.
+///
+/// A handle is created when the command is requested. The connector sends the command when
+/// its window of commands in flight allows it, and completes the handle when the RTS_COMMAND
+/// response is received, when the timeout expires, or when it is cancelled. Responses of
+/// commands in flight are matched by command ID, in any order. The state can be polled with IsDone and
+/// GetStatus, waited for with Wait, or observed with CommandCompletedEvent.
+/// All methods can be called from any thread. CommandCompletedEvent is invoked by the thread
+/// that completes the handle, which is the thread calling vtkMRMLIGTLConnectorNode::PeriodicProcess
+/// (or the thread calling Cancel).
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLCommandHandle : public vtkObject
+{
+public:
+  static vtkIGTLCommandHandle *New();
+  vtkTypeMacro(vtkIGTLCommandHandle, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum
+  {
+    CommandCompletedEvent = 119003,
+  };
+
+  enum
+  {
+    STATUS_WAITING = 0,
+    STATUS_SUCCESS,   // response received
+    STATUS_EXPIRED,   // no response before the timeout
+    STATUS_CANCELLED,
+    STATUS_FAILED,    // the command could not be sent
+  };
+
+  /// True once the command is sent. Until then the command waits for a free slot in the command window.
+  bool IsSent();
+
+  /// Command ID of the sent message, -1 until the command is sent
+  int GetCommandID();
+  std::string GetDeviceName();
+  std::string GetCommandName();
+  std::string GetCommandContent();
+
+  /// Universal time when the command was sent and time after which it expires, in seconds.
+  /// Valid once the command is sent.
+  double GetSendTime();
+  double GetTimeout();
+  double GetExpiryTime();
+
+  int GetStatus();
+  static const char* GetStatusAsString(int status);
+
+  /// True if the command is no longer waiting for a response
+  bool IsDone();
+
+  /// Command name and content of the response. Empty until the status is STATUS_SUCCESS.
+  std::string GetResponseName();
+  std::string GetResponseContent();
+
+  /// Response content parsed as XML, NULL until the status is STATUS_SUCCESS. The content is
+  /// parsed on the first call; the document is valid until the handle is initialized again.
+  vtkIGTLXMLDocument* GetResponseDocument();
+
+  /// Universal time when the handle was completed, 0 while waiting
+  double GetCompletionTime();
+
+  /// True if the response was taken from the response cache of the connector, without sending the command
+  bool GetResponseFromCache();
+
+  /// Block until the handle is completed or timeout seconds elapsed (negative: no limit).
+  /// Returns true if the handle is completed. The handle is completed by the thread that runs
+  /// the connector periodic processing, so waiting on that thread can only time out.
+  bool Wait(double timeout);
+
+  /// Stop waiting for the response. Returns false if the handle was already completed.
+  bool Cancel();
+
+#ifndef __VTK_WRAP__
+  // The state is set by the connector that owns the handle, these methods are not wrapped.
+
+  /// Set by the connector when the command is requested. timeout is counted from the time the command is sent.
+  void Initialize(const std::string& deviceName, const std::string& commandName, const std::string& content, double timeout);
+
+  /// Set by the connector when the command is sent
+  void SetSent(int commandID, double sendTime);
+
+  /// Complete the handle with a response. Returns false if the handle was already completed.
+  bool SetResponse(const std::string& name, const std::string& content, double time);
+
+  /// Same as SetResponse, but the content is swapped into the handle instead of copied.
+  /// content is left empty if the handle takes it, unchanged if the handle was already completed.
+  bool TakeResponse(const std::string& name, std::string& content, double time);
+
+  /// Complete the handle with a cached response of the same command. The command is not sent.
+  /// Returns false if the handle was already completed.
+  bool SetCachedResponse(const std::string& name, const std::string& content, double time);
+
+  /// Complete the handle as expired. Returns false if the handle was already completed.
+  bool Expire(double time);
+
+  /// Complete the handle as failed to send. Returns false if the handle was already completed.
+  bool Fail(double time);
+#endif
+
+protected:
+  vtkIGTLCommandHandle();
+  ~vtkIGTLCommandHandle();
+
+  /// Set the final status, wake the waiting threads and invoke CommandCompletedEvent.
+  /// The content is swapped into the handle.
+  bool Complete(int status, const std::string& name, std::string& content, double time);
+
+  class vtkInternal;
+  vtkInternal* Internal;
+
+  int CommandID;
+  std::string DeviceName;
+  std::string CommandName;
+  std::string CommandContent;
+  double SendTime;
+  double Timeout;
+  int Status;
+  std::string ResponseName;
+  std::string ResponseContent;
+  vtkIGTLXMLDocument* ResponseDocument;
+  bool ResponseDocumentParsed;
+  double CompletionTime;
+  bool ResponseFromCache;
+
+private:
+  vtkIGTLCommandHandle(const vtkIGTLCommandHandle&); // Not implemented
+  void operator=(const vtkIGTLCommandHandle&);       // Not implemented
+};
+
+#endif
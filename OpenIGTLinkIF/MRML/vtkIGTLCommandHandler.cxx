@@ -0,0 +1,43 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandHandler.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLCommandHandler.h"
+#include "vtkIGTLCommandRequest.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLCommandHandler);
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandHandler::vtkIGTLCommandHandler()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandHandler::~vtkIGTLCommandHandler()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandHandler::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandHandler::Execute(vtkIGTLCommandRequest* request)
+{
+  this->InvokeEvent(ExecuteCommandEvent, request);
+}
@@ -0,0 +1,55 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandHandler.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLCommandHandler_h
+#define __vtkIGTLCommandHandler_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkIGTLCommandRequest;
+
+/// \brief Handler of the COMMAND messages of a command name, registered on a connector node.
+///
+/// C++ handlers override Execute. The default Execute invokes ExecuteCommandEvent with the
+/// request as call data, so that handlers can be written as observers (e.g., in Python).
+/// Execute runs on a worker thread of the connector: it must be thread safe and may only
+/// access MRML between vtkIGTLCommandRequest::BeginMRMLAccess and EndMRMLAccess.
+/// Python observers on worker threads require a VTK build with thread safe Python wrapping.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLCommandHandler : public vtkObject
+{
+public:
+  static vtkIGTLCommandHandler *New();
+  vtkTypeMacro(vtkIGTLCommandHandler, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum
+  {
+    ExecuteCommandEvent = 119004,
+  };
+
+  /// Process the command and set the response content of the request
+  virtual void Execute(vtkIGTLCommandRequest* request);
+
+protected:
+  vtkIGTLCommandHandler();
+  ~vtkIGTLCommandHandler();
+
+private:
+  vtkIGTLCommandHandler(const vtkIGTLCommandHandler&); // Not implemented
+  void operator=(const vtkIGTLCommandHandler&);        // Not implemented
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandRequest.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLCommandRequest.h"
+#include "vtkIGTLCommandDispatcher.h"
+#include "vtkIGTLXMLDocument.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLCommandRequest);
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandRequest::vtkIGTLCommandRequest()
+{
+  this->ConnectorNode = NULL;
+  this->Dispatcher = NULL;
+  this->CommandID = -1;
+  this->ContentDocument = vtkIGTLXMLDocument::New();
+  this->ContentDocumentParsed = false;
+  this->ReceiveTime = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandRequest::~vtkIGTLCommandRequest()
+{
+  this->ContentDocument->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandRequest::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "DeviceName: " << this->DeviceName << "\n";
+  os << indent << "CommandName: " << this->CommandName << "\n";
+  os << indent << "CommandID: " << this->CommandID << "\n";
+  os << indent << "Content: " << this->Content << "\n";
+  os << indent << "ReceiveTime: " << this->ReceiveTime << "\n";
+  os << indent << "ResponseContent: " << this->ResponseContent << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandRequest::Initialize(vtkMRMLIGTLConnectorNode* connector, const std::string& deviceName,
+                                       const std::string& commandName, int commandID, const std::string& content,
+                                       double receiveTime)
+{
+  // The connector owns the dispatcher that runs the request, it outlives the request execution
+  this->ConnectorNode = connector;
+  this->DeviceName = deviceName;
+  this->CommandName = commandName;
+  this->CommandID = commandID;
+  this->Content = content;
+  this->ContentDocument->Clear();
+  this->ContentDocumentParsed = false;
+  this->ReceiveTime = receiveTime;
+  this->ResponseContent.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandRequest::TakeContent(std::string& content)
+{
+  this->Content.clear();
+  this->Content.swap(content);
+  this->ContentDocument->Clear();
+  this->ContentDocumentParsed = false;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLIGTLConnectorNode* vtkIGTLCommandRequest::GetConnectorNode()
+{
+  return this->ConnectorNode;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandRequest::GetDeviceName()
+{
+  return this->DeviceName;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandRequest::GetCommandName()
+{
+  return this->CommandName;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCommandRequest::GetCommandID()
+{
+  return this->CommandID;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandRequest::GetContent()
+{
+  return this->Content;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLXMLDocument* vtkIGTLCommandRequest::GetContentDocument()
+{
+  if (!this->ContentDocumentParsed)
+  {
+    // Content does not change until the next Initialize, the document can refer to it
+    this->ContentDocument->ParseBuffer(this->Content.data(), this->Content.size());
+    this->ContentDocumentParsed = true;
+  }
+  return this->ContentDocument;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLCommandRequest::GetReceiveTime()
+{
+  return this->ReceiveTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandRequest::SetResponseContent(const std::string& content)
+{
+  this->ResponseContent = content;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLCommandRequest::GetResponseContent()
+{
+  return this->ResponseContent;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandRequest::SetDispatcher(vtkIGTLCommandDispatcher* dispatcher)
+{
+  this->Dispatcher = dispatcher;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandRequest::BeginMRMLAccess()
+{
+  if (this->Dispatcher == NULL)
+  {
+    return true;
+  }
+  return this->Dispatcher->BeginMRMLAccess();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandRequest::EndMRMLAccess()
+{
+  if (this->Dispatcher)
+  {
+    this->Dispatcher->EndMRMLAccess();
+  }
+}
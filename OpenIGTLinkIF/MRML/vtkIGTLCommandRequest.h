@@ -0,0 +1,103 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandRequest.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLCommandRequest_h
+#define __vtkIGTLCommandRequest_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <string>
+
+class vtkIGTLCommandDispatcher;
+class vtkIGTLXMLDocument;
+class vtkMRMLIGTLConnectorNode;
+
+/// \brief COMMAND message received by a connector and passed to a vtkIGTLCommandHandler.
+///
+/// The handler reads the command and sets the response content. The response is sent with the
+/// command ID of the request once the handler returns. Handlers run on worker threads: the MRML
+/// scene may only be accessed between BeginMRMLAccess and EndMRMLAccess, while the thread that
+/// runs vtkMRMLIGTLConnectorNode::PeriodicProcess waits.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLCommandRequest : public vtkObject
+{
+public:
+  static vtkIGTLCommandRequest *New();
+  vtkTypeMacro(vtkIGTLCommandRequest, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Set by the connector when the command is received
+  void Initialize(vtkMRMLIGTLConnectorNode* connector, const std::string& deviceName, const std::string& commandName,
+                  int commandID, const std::string& content, double receiveTime);
+
+#ifndef __VTK_WRAP__
+  /// Replace the content by swapping it into the request instead of copying it, content is left empty.
+  /// The connector passes the received payload this way, the content document is parsed in place.
+  void TakeContent(std::string& content);
+#endif
+
+  /// Connector that received the command
+  vtkMRMLIGTLConnectorNode* GetConnectorNode();
+
+  std::string GetDeviceName();
+  std::string GetCommandName();
+  int GetCommandID();
+  std::string GetContent();
+
+  /// Content parsed as XML. The content is parsed on the first call, the document refers
+  /// to the content of the request and is valid as long as the request.
+  vtkIGTLXMLDocument* GetContentDocument();
+
+  /// Universal time when the command was received, in seconds
+  double GetReceiveTime();
+
+  /// Content of the response (an XML string). An empty response is sent if the handler does not set it.
+  void SetResponseContent(const std::string& content);
+  std::string GetResponseContent();
+
+  /// Block until the main thread can be paused, then pause it so that the handler can access
+  /// the MRML scene. Returns false if access is denied because the dispatcher is shutting down,
+  /// in which case EndMRMLAccess must not be called. Calls do not nest.
+  bool BeginMRMLAccess();
+
+  /// Resume the main thread
+  void EndMRMLAccess();
+
+  /// Set by the dispatcher. Without dispatcher (the handler runs on the main thread)
+  /// BeginMRMLAccess and EndMRMLAccess have no effect.
+  void SetDispatcher(vtkIGTLCommandDispatcher* dispatcher);
+
+protected:
+  vtkIGTLCommandRequest();
+  ~vtkIGTLCommandRequest();
+
+  vtkMRMLIGTLConnectorNode* ConnectorNode;
+  vtkIGTLCommandDispatcher* Dispatcher;
+  std::string DeviceName;
+  std::string CommandName;
+  int CommandID;
+  std::string Content;
+  vtkIGTLXMLDocument* ContentDocument;
+  bool ContentDocumentParsed;
+  double ReceiveTime;
+  std::string ResponseContent;
+
+private:
+  vtkIGTLCommandRequest(const vtkIGTLCommandRequest&); // Not implemented
+  void operator=(const vtkIGTLCommandRequest&);        // Not implemented
+};
+
+#endif
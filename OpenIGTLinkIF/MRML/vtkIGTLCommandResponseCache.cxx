@@ -0,0 +1,319 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandResponseCache.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLCommandResponseCache.h"
+
+// VTK includes
+#include <vtkMutexLock.h>
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLCommandResponseCache);
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandResponseCache::KeyType::operator<(const KeyType& other) const
+{
+  if (this->ContentHash != other.ContentHash)
+  {
+    return this->ContentHash < other.ContentHash;
+  }
+  int compare = this->CommandName.compare(other.CommandName);
+  if (compare != 0)
+  {
+    return compare < 0;
+  }
+  return this->DeviceName < other.DeviceName;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandResponseCache::vtkIGTLCommandResponseCache()
+{
+  this->Mutex = vtkMutexLock::New();
+  this->MaximumNumberOfEntries = 1024;
+  this->NumberOfHits = 0;
+  this->NumberOfMisses = 0;
+  this->NumberOfInvalidations = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandResponseCache::~vtkIGTLCommandResponseCache()
+{
+  this->Mutex->Delete();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  this->Mutex->Lock();
+  os << indent << "MaximumNumberOfEntries: " << this->MaximumNumberOfEntries << "\n";
+  os << indent << "NumberOfEntries: " << this->Entries.size() << "\n";
+  os << indent << "NumberOfHits: " << this->NumberOfHits << "\n";
+  os << indent << "NumberOfMisses: " << this->NumberOfMisses << "\n";
+  os << indent << "NumberOfInvalidations: " << this->NumberOfInvalidations << "\n";
+  os << indent << "CommandTimeToLive:\n";
+  for (std::map<std::string, double>::iterator iter = this->CommandTimeToLive.begin();
+       iter != this->CommandTimeToLive.end(); ++iter)
+  {
+    os << indent.GetNextIndent() << iter->first << ": " << iter->second << " s\n";
+  }
+  this->Mutex->Unlock();
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkIGTLCommandResponseCache::HashContent(const std::string& content)
+{
+  vtkTypeUInt64 hash = 14695981039346656037ULL;
+  for (std::string::const_iterator c = content.begin(); c != content.end(); ++c)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*c)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::SetCommandTimeToLive(const std::string& commandName, double timeToLive)
+{
+  this->Mutex->Lock();
+  if (timeToLive > 0.0)
+  {
+    this->CommandTimeToLive[commandName] = timeToLive;
+  }
+  else
+  {
+    this->CommandTimeToLive.erase(commandName);
+    EntryMapType::iterator iter = this->Entries.begin();
+    while (iter != this->Entries.end())
+    {
+      if (iter->first.CommandName == commandName)
+      {
+        this->Entries.erase(iter++);
+      }
+      else
+      {
+        ++iter;
+      }
+    }
+  }
+  this->Mutex->Unlock();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLCommandResponseCache::GetCommandTimeToLive(const std::string& commandName)
+{
+  this->Mutex->Lock();
+  std::map<std::string, double>::iterator iter = this->CommandTimeToLive.find(commandName);
+  double timeToLive = (iter != this->CommandTimeToLive.end()) ? iter->second : 0.0;
+  this->Mutex->Unlock();
+  return timeToLive;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::RemoveAllCommandTimeToLive()
+{
+  this->Mutex->Lock();
+  this->CommandTimeToLive.clear();
+  this->Entries.clear();
+  this->Mutex->Unlock();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::SetMaximumNumberOfEntries(int maximum)
+{
+  if (maximum < 1)
+  {
+    maximum = 1;
+  }
+  this->Mutex->Lock();
+  this->MaximumNumberOfEntries = maximum;
+  while (static_cast<int>(this->Entries.size()) > maximum)
+  {
+    this->RemoveEntriesToFit(0.0);
+  }
+  this->Mutex->Unlock();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCommandResponseCache::GetMaximumNumberOfEntries()
+{
+  return this->MaximumNumberOfEntries;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLCommandResponseCache::GetResponse(const std::string& deviceName, const std::string& commandName,
+                                              const std::string& content, double currentTime,
+                                              std::string& responseName, std::string& responseContent)
+{
+  this->Mutex->Lock();
+  if (this->CommandTimeToLive.find(commandName) == this->CommandTimeToLive.end())
+  {
+    this->Mutex->Unlock();
+    return false;
+  }
+  KeyType key;
+  key.DeviceName = deviceName;
+  key.CommandName = commandName;
+  key.ContentHash = HashContent(content);
+  EntryMapType::iterator iter = this->Entries.find(key);
+  if (iter != this->Entries.end() && currentTime > iter->second.ExpiryTime)
+  {
+    this->Entries.erase(iter);
+    iter = this->Entries.end();
+  }
+  if (iter == this->Entries.end() || iter->second.Content != content)
+  {
+    ++this->NumberOfMisses;
+    this->Mutex->Unlock();
+    return false;
+  }
+  responseName = iter->second.ResponseName;
+  responseContent = iter->second.ResponseContent;
+  ++this->NumberOfHits;
+  this->Mutex->Unlock();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::AddResponse(const std::string& deviceName, const std::string& commandName,
+                                              const std::string& content, const std::string& responseName,
+                                              const std::string& responseContent, double time)
+{
+  this->Mutex->Lock();
+  std::map<std::string, double>::iterator ttlIter = this->CommandTimeToLive.find(commandName);
+  if (ttlIter == this->CommandTimeToLive.end())
+  {
+    this->Mutex->Unlock();
+    return;
+  }
+  KeyType key;
+  key.DeviceName = deviceName;
+  key.CommandName = commandName;
+  key.ContentHash = HashContent(content);
+  EntryMapType::iterator iter = this->Entries.find(key);
+  if (iter == this->Entries.end())
+  {
+    if (static_cast<int>(this->Entries.size()) >= this->MaximumNumberOfEntries)
+    {
+      this->RemoveEntriesToFit(time);
+    }
+    iter = this->Entries.insert(std::make_pair(key, EntryType())).first;
+  }
+  // A different content with the same hash replaces the entry
+  iter->second.Content = content;
+  iter->second.ResponseName = responseName;
+  iter->second.ResponseContent = responseContent;
+  iter->second.ExpiryTime = time + ttlIter->second;
+  this->Mutex->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::RemoveEntriesToFit(double currentTime)
+{
+  EntryMapType::iterator firstToExpire = this->Entries.end();
+  EntryMapType::iterator iter = this->Entries.begin();
+  while (iter != this->Entries.end())
+  {
+    if (currentTime > iter->second.ExpiryTime)
+    {
+      this->Entries.erase(iter++);
+      continue;
+    }
+    if (firstToExpire == this->Entries.end() || iter->second.ExpiryTime < firstToExpire->second.ExpiryTime)
+    {
+      firstToExpire = iter;
+    }
+    ++iter;
+  }
+  if (static_cast<int>(this->Entries.size()) >= this->MaximumNumberOfEntries && firstToExpire != this->Entries.end())
+  {
+    this->Entries.erase(firstToExpire);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::Invalidate()
+{
+  this->Mutex->Lock();
+  this->Entries.clear();
+  ++this->NumberOfInvalidations;
+  this->Mutex->Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::InvalidateDevice(const std::string& deviceName)
+{
+  this->Mutex->Lock();
+  EntryMapType::iterator iter = this->Entries.begin();
+  while (iter != this->Entries.end())
+  {
+    if (iter->first.DeviceName == deviceName)
+    {
+      this->Entries.erase(iter++);
+    }
+    else
+    {
+      ++iter;
+    }
+  }
+  ++this->NumberOfInvalidations;
+  this->Mutex->Unlock();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLCommandResponseCache::GetNumberOfEntries()
+{
+  this->Mutex->Lock();
+  int numberOfEntries = static_cast<int>(this->Entries.size());
+  this->Mutex->Unlock();
+  return numberOfEntries;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkIGTLCommandResponseCache::GetNumberOfHits()
+{
+  this->Mutex->Lock();
+  vtkTypeUInt64 count = this->NumberOfHits;
+  this->Mutex->Unlock();
+  return count;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkIGTLCommandResponseCache::GetNumberOfMisses()
+{
+  this->Mutex->Lock();
+  vtkTypeUInt64 count = this->NumberOfMisses;
+  this->Mutex->Unlock();
+  return count;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkIGTLCommandResponseCache::GetNumberOfInvalidations()
+{
+  this->Mutex->Lock();
+  vtkTypeUInt64 count = this->NumberOfInvalidations;
+  this->Mutex->Unlock();
+  return count;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLCommandResponseCache::ResetCounters()
+{
+  this->Mutex->Lock();
+  this->NumberOfHits = 0;
+  this->NumberOfMisses = 0;
+  this->NumberOfInvalidations = 0;
+  this->Mutex->Unlock();
+}
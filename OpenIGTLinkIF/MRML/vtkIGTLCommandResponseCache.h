@@ -0,0 +1,125 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLCommandResponseCache.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLCommandResponseCache_h
+#define __vtkIGTLCommandResponseCache_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <map>
+#include <string>
+
+class vtkMutexLock;
+
+/// \brief Responses of idempotent COMMAND messages, reused until their time to live expires.
+///
+/// Responses are stored by (device name, command name, content). Only commands with a time to live
+/// are cached, so caching is off until SetCommandTimeToLive is called for a command name.
+/// Contents are compared by a 64-bit hash, then exactly.
+/// The connector node invalidates the whole cache when it receives a STATUS or COMMAND message,
+/// since the state of the remote device may have changed.
+/// All methods can be called from any thread. Times are universal times in seconds.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLCommandResponseCache : public vtkObject
+{
+public:
+  static vtkIGTLCommandResponseCache *New();
+  vtkTypeMacro(vtkIGTLCommandResponseCache, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Time during which the response of the command can be reused, in seconds.
+  /// 0 (default) disables caching of the command and removes its cached responses.
+  void SetCommandTimeToLive(const std::string& commandName, double timeToLive);
+  double GetCommandTimeToLive(const std::string& commandName);
+
+  /// Disable caching of all commands and remove all cached responses
+  void RemoveAllCommandTimeToLive();
+
+  /// Maximum number of cached responses (default 1024). When the cache is full,
+  /// expired responses are removed first, then the response that expires first.
+  void SetMaximumNumberOfEntries(int maximum);
+  int GetMaximumNumberOfEntries();
+
+  /// Get the cached response of the command. Returns false if the command is not cached
+  /// or has no valid response. Hits and misses are only counted for cached commands.
+  bool GetResponse(const std::string& deviceName, const std::string& commandName, const std::string& content,
+                   double currentTime, std::string& responseName, std::string& responseContent);
+
+  /// Store the response of a command, received at the given time.
+  /// Ignored if the command has no time to live.
+  void AddResponse(const std::string& deviceName, const std::string& commandName, const std::string& content,
+                   const std::string& responseName, const std::string& responseContent, double time);
+
+  /// Remove all cached responses
+  void Invalidate();
+
+  /// Remove the cached responses of the device
+  void InvalidateDevice(const std::string& deviceName);
+
+  int GetNumberOfEntries();
+
+  /// Number of commands answered from the cache, and of cached commands that had to be sent
+  vtkTypeUInt64 GetNumberOfHits();
+  vtkTypeUInt64 GetNumberOfMisses();
+
+  /// Number of calls to Invalidate and InvalidateDevice
+  vtkTypeUInt64 GetNumberOfInvalidations();
+
+  /// Set the hit, miss, and invalidation counters to 0
+  void ResetCounters();
+
+  /// 64-bit FNV-1a hash of the command content
+  static vtkTypeUInt64 HashContent(const std::string& content);
+
+protected:
+  vtkIGTLCommandResponseCache();
+  ~vtkIGTLCommandResponseCache();
+
+  struct KeyType
+  {
+    std::string DeviceName;
+    std::string CommandName;
+    vtkTypeUInt64 ContentHash;
+    bool operator<(const KeyType& other) const;
+  };
+
+  struct EntryType
+  {
+    std::string Content;
+    std::string ResponseName;
+    std::string ResponseContent;
+    double ExpiryTime;
+  };
+
+  typedef std::map<KeyType, EntryType> EntryMapType;
+
+  /// Make room for one entry. The mutex must be locked.
+  void RemoveEntriesToFit(double currentTime);
+
+  vtkMutexLock* Mutex;
+  std::map<std::string, double> CommandTimeToLive;
+  EntryMapType Entries;
+  int MaximumNumberOfEntries;
+  vtkTypeUInt64 NumberOfHits;
+  vtkTypeUInt64 NumberOfMisses;
+  vtkTypeUInt64 NumberOfInvalidations;
+
+private:
+  vtkIGTLCommandResponseCache(const vtkIGTLCommandResponseCache&); // Not implemented
+  void operator=(const vtkIGTLCommandResponseCache&);              // Not implemented
+};
+
+#endif
@@ -0,0 +1,357 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLI420ToRGBConverter.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLI420ToRGBConverter.h"
+#include "vtkIGTLCPUFeatures.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <cstring>
+
+#if defined(OpenIGTLinkIF_USE_SSE2)
+  #include <emmintrin.h>
+#endif
+#if defined(OpenIGTLinkIF_USE_AVX2)
+  #include <immintrin.h>
+#endif
+
+namespace
+{
+  //---------------------------------------------------------------------------
+  inline unsigned char Clip(int value)
+  {
+    return static_cast<unsigned char>(value < 0 ? 0 : (value > 255 ? 255 : value));
+  }
+
+  //---------------------------------------------------------------------------
+  // Converts pixels [begin, end) of a row. Reference implementation, also used for the
+  // pixels that do not fill a complete vector in the SIMD implementations.
+  inline void ConvertRowScalar(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+                               unsigned char* rgb, int begin, int end)
+  {
+    for (int x = begin; x < end; ++x)
+    {
+      int c = y[x] - 16;
+      int d = u[x >> 1] - 128;
+      int e = v[x >> 1] - 128;
+      rgb[3 * x] = Clip((298 * c + 409 * e + 128) >> 8);
+      rgb[3 * x + 1] = Clip((298 * c - 100 * d - 208 * e + 128) >> 8);
+      rgb[3 * x + 2] = Clip((298 * c + 516 * d + 128) >> 8);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // 32-bit lane holding two 16-bit pmaddwd coefficients. Built from unsigned values,
+  // shifting a negative coefficient is undefined.
+  inline int CoefficientPair(int high, int low)
+  {
+    return static_cast<int>((static_cast<unsigned int>(static_cast<unsigned short>(high)) << 16)
+      | static_cast<unsigned short>(low));
+  }
+
+#if defined(OpenIGTLinkIF_USE_SSE2)
+  //---------------------------------------------------------------------------
+  // Computes R, G, B of 8 pixels from the 16-bit C, D, E values.
+  // Coefficient pairs are applied with pmaddwd, which gives the exact 32-bit sums.
+  inline void ConvertBlockSSE2(__m128i c, __m128i d, __m128i e, __m128i& r, __m128i& g, __m128i& b)
+  {
+    const __m128i coeffR = _mm_set1_epi32(CoefficientPair(409, 298));
+    const __m128i coeffGCD = _mm_set1_epi32(CoefficientPair(-100, 298));
+    const __m128i coeffGE = _mm_set1_epi32(CoefficientPair(128, -208));
+    const __m128i coeffB = _mm_set1_epi32(CoefficientPair(516, 298));
+    const __m128i rounding = _mm_set1_epi32(128);
+    const __m128i one = _mm_set1_epi16(1);
+
+    __m128i ceLo = _mm_unpacklo_epi16(c, e);
+    __m128i ceHi = _mm_unpackhi_epi16(c, e);
+    __m128i cdLo = _mm_unpacklo_epi16(c, d);
+    __m128i cdHi = _mm_unpackhi_epi16(c, d);
+    __m128i e1Lo = _mm_unpacklo_epi16(e, one);
+    __m128i e1Hi = _mm_unpackhi_epi16(e, one);
+
+    __m128i rLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceLo, coeffR), rounding), 8);
+    __m128i rHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceHi, coeffR), rounding), 8);
+    __m128i gLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, coeffGCD), _mm_madd_epi16(e1Lo, coeffGE)), 8);
+    __m128i gHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, coeffGCD), _mm_madd_epi16(e1Hi, coeffGE)), 8);
+    __m128i bLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, coeffB), rounding), 8);
+    __m128i bHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, coeffB), rounding), 8);
+
+    r = _mm_packs_epi32(rLo, rHi);
+    g = _mm_packs_epi32(gLo, gHi);
+    b = _mm_packs_epi32(bLo, bHi);
+  }
+
+  //---------------------------------------------------------------------------
+  void ConvertRowSSE2(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+                      unsigned char* rgb, int width)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i offsetY = _mm_set1_epi16(16);
+    const __m128i offsetUV = _mm_set1_epi16(128);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i yy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+      __m128i uu = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + (x >> 1)));
+      __m128i vv = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + (x >> 1)));
+      // Each chroma sample covers two horizontal pixels
+      uu = _mm_unpacklo_epi8(uu, uu);
+      vv = _mm_unpacklo_epi8(vv, vv);
+
+      __m128i r0, g0, b0, r1, g1, b1;
+      ConvertBlockSSE2(_mm_sub_epi16(_mm_unpacklo_epi8(yy, zero), offsetY),
+                       _mm_sub_epi16(_mm_unpacklo_epi8(uu, zero), offsetUV),
+                       _mm_sub_epi16(_mm_unpacklo_epi8(vv, zero), offsetUV), r0, g0, b0);
+      ConvertBlockSSE2(_mm_sub_epi16(_mm_unpackhi_epi8(yy, zero), offsetY),
+                       _mm_sub_epi16(_mm_unpackhi_epi8(uu, zero), offsetUV),
+                       _mm_sub_epi16(_mm_unpackhi_epi8(vv, zero), offsetUV), r1, g1, b1);
+
+      // packus clips to [0, 255]
+      unsigned char r[16], g[16], b[16];
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(r), _mm_packus_epi16(r0, r1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(g), _mm_packus_epi16(g0, g1));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(b), _mm_packus_epi16(b0, b1));
+      unsigned char* out = rgb + 3 * x;
+      for (int i = 0; i < 16; ++i)
+      {
+        out[3 * i] = r[i];
+        out[3 * i + 1] = g[i];
+        out[3 * i + 2] = b[i];
+      }
+    }
+    ConvertRowScalar(y, u, v, rgb, x, width);
+  }
+#endif
+
+#if defined(OpenIGTLinkIF_USE_AVX2)
+  //---------------------------------------------------------------------------
+  OpenIGTLinkIF_TARGET_AVX2
+  void ConvertRowAVX2(const unsigned char* y, const unsigned char* u, const unsigned char* v,
+                      unsigned char* rgb, int width)
+  {
+    const __m256i offsetY = _mm256_set1_epi16(16);
+    const __m256i offsetUV = _mm256_set1_epi16(128);
+    const __m256i coeffR = _mm256_set1_epi32(CoefficientPair(409, 298));
+    const __m256i coeffGCD = _mm256_set1_epi32(CoefficientPair(-100, 298));
+    const __m256i coeffGE = _mm256_set1_epi32(CoefficientPair(128, -208));
+    const __m256i coeffB = _mm256_set1_epi32(CoefficientPair(516, 298));
+    const __m256i rounding = _mm256_set1_epi32(128);
+    const __m256i one = _mm256_set1_epi16(1);
+
+    // pshufb masks interleaving 16 R, G and B values into 48 packed RGB bytes
+    const __m128i shuffleR0 = _mm_setr_epi8(0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128, 5);
+    const __m128i shuffleG0 = _mm_setr_epi8(-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128);
+    const __m128i shuffleB0 = _mm_setr_epi8(-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128);
+    const __m128i shuffleR1 = _mm_setr_epi8(-128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10, -128);
+    const __m128i shuffleG1 = _mm_setr_epi8(5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10);
+    const __m128i shuffleB1 = _mm_setr_epi8(-128, 5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128);
+    const __m128i shuffleR2 = _mm_setr_epi8(-128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128, -128);
+    const __m128i shuffleG2 = _mm_setr_epi8(-128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128);
+    const __m128i shuffleB2 = _mm_setr_epi8(10, -128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+      __m128i uu = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(u + (x >> 1)));
+      __m128i vv = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v + (x >> 1)));
+      __m256i c = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x))), offsetY);
+      __m256i d = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(uu, uu)), offsetUV);
+      __m256i e = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_unpacklo_epi8(vv, vv)), offsetUV);
+
+      // Unpack and pack instructions work within 128-bit lanes, so the pixel order is preserved
+      __m256i ceLo = _mm256_unpacklo_epi16(c, e);
+      __m256i ceHi = _mm256_unpackhi_epi16(c, e);
+      __m256i cdLo = _mm256_unpacklo_epi16(c, d);
+      __m256i cdHi = _mm256_unpackhi_epi16(c, d);
+      __m256i e1Lo = _mm256_unpacklo_epi16(e, one);
+      __m256i e1Hi = _mm256_unpackhi_epi16(e, one);
+
+      __m256i r = _mm256_packs_epi32(
+        _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ceLo, coeffR), rounding), 8),
+        _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(ceHi, coeffR), rounding), 8));
+      __m256i g = _mm256_packs_epi32(
+        _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(cdLo, coeffGCD), _mm256_madd_epi16(e1Lo, coeffGE)), 8),
+        _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(cdHi, coeffGCD), _mm256_madd_epi16(e1Hi, coeffGE)), 8));
+      __m256i b = _mm256_packs_epi32(
+        _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(cdLo, coeffB), rounding), 8),
+        _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(cdHi, coeffB), rounding), 8));
+
+      // Clip to [0, 255] and gather the 16 bytes of both lanes in the low lane
+      __m128i r8 = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(r, r), 0x08));
+      __m128i g8 = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(g, g), 0x08));
+      __m128i b8 = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi16(b, b), 0x08));
+
+      __m128i* out = reinterpret_cast<__m128i*>(rgb + 3 * x);
+      _mm_storeu_si128(out, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r8, shuffleR0), _mm_shuffle_epi8(g8, shuffleG0)), _mm_shuffle_epi8(b8, shuffleB0)));
+      _mm_storeu_si128(out + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r8, shuffleR1), _mm_shuffle_epi8(g8, shuffleG1)), _mm_shuffle_epi8(b8, shuffleB1)));
+      _mm_storeu_si128(out + 2, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r8, shuffleR2), _mm_shuffle_epi8(g8, shuffleG2)), _mm_shuffle_epi8(b8, shuffleB2)));
+    }
+    ConvertRowScalar(y, u, v, rgb, x, width);
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLI420ToRGBConverter);
+
+//----------------------------------------------------------------------------
+vtkIGTLI420ToRGBConverter::vtkIGTLI420ToRGBConverter()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLI420ToRGBConverter::~vtkIGTLI420ToRGBConverter()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLI420ToRGBConverter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "BestImplementation: "
+     << vtkIGTLI420ToRGBConverter::GetImplementationName(vtkIGTLI420ToRGBConverter::GetBestImplementation()) << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLI420ToRGBConverter::GetBestImplementation()
+{
+  if (vtkIGTLCPUFeatures::HasAVX2())
+  {
+    return IMPLEMENTATION_AVX2;
+  }
+  if (vtkIGTLCPUFeatures::HasSSE2())
+  {
+    return IMPLEMENTATION_SSE2;
+  }
+  return IMPLEMENTATION_SCALAR;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLI420ToRGBConverter::IsImplementationAvailable(int implementation)
+{
+  switch (implementation)
+  {
+    case IMPLEMENTATION_AUTO:
+    case IMPLEMENTATION_SCALAR:
+      return true;
+    case IMPLEMENTATION_SSE2:
+      return vtkIGTLCPUFeatures::HasSSE2();
+    case IMPLEMENTATION_AVX2:
+      return vtkIGTLCPUFeatures::HasAVX2();
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLI420ToRGBConverter::GetImplementationName(int implementation)
+{
+  switch (implementation)
+  {
+    case IMPLEMENTATION_AUTO: return "Auto";
+    case IMPLEMENTATION_SCALAR: return "Scalar";
+    case IMPLEMENTATION_SSE2: return "SSE2";
+    case IMPLEMENTATION_AVX2: return "AVX2";
+    default: return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLI420ToRGBConverter::Convert(const unsigned char* yPlane, const unsigned char* uPlane, const unsigned char* vPlane,
+                                        int yStride, int uvStride, unsigned char* rgb, int rgbStride,
+                                        int width, int height, int implementation)
+{
+  if (yPlane == NULL || uPlane == NULL || vPlane == NULL || rgb == NULL || width <= 0 || height <= 0)
+  {
+    return false;
+  }
+  if (implementation == IMPLEMENTATION_AUTO)
+  {
+    implementation = vtkIGTLI420ToRGBConverter::GetBestImplementation();
+  }
+  else if (!vtkIGTLI420ToRGBConverter::IsImplementationAvailable(implementation))
+  {
+    return false;
+  }
+
+  for (int row = 0; row < height; ++row)
+  {
+    const unsigned char* y = yPlane + row * yStride;
+    const unsigned char* u = uPlane + (row >> 1) * uvStride;
+    const unsigned char* v = vPlane + (row >> 1) * uvStride;
+    unsigned char* out = rgb + row * rgbStride;
+    switch (implementation)
+    {
+#if defined(OpenIGTLinkIF_USE_AVX2)
+      case IMPLEMENTATION_AVX2:
+        ConvertRowAVX2(y, u, v, out, width);
+        break;
+#endif
+#if defined(OpenIGTLinkIF_USE_SSE2)
+      case IMPLEMENTATION_SSE2:
+        ConvertRowSSE2(y, u, v, out, width);
+        break;
+#endif
+      default:
+        ConvertRowScalar(y, u, v, out, 0, width);
+        break;
+    }
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLI420ToRGBConverter::ConvertFrame(const unsigned char* i420Frame, unsigned char* rgb,
+                                             int width, int height, int implementation)
+{
+  if (i420Frame == NULL)
+  {
+    return false;
+  }
+  int chromaWidth = (width + 1) / 2;
+  int chromaHeight = (height + 1) / 2;
+  const unsigned char* uPlane = i420Frame + width * height;
+  const unsigned char* vPlane = uPlane + chromaWidth * chromaHeight;
+  return vtkIGTLI420ToRGBConverter::Convert(i420Frame, uPlane, vPlane, width, chromaWidth,
+                                            rgb, 3 * width, width, height, implementation);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLI420ToRGBConverter::ConvertFrame(const unsigned char* i420Frame, int width, int height, vtkImageData* output,
+                                             int implementation)
+{
+  if (output == NULL || width <= 0 || height <= 0)
+  {
+    return false;
+  }
+  int* dimensions = output->GetDimensions();
+  if (dimensions[0] != width || dimensions[1] != height || dimensions[2] != 1
+    || output->GetScalarType() != VTK_UNSIGNED_CHAR || output->GetNumberOfScalarComponents() != 3
+    || output->GetPointData()->GetScalars() == NULL)
+  {
+    output->SetDimensions(width, height, 1);
+    output->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+  }
+  if (!vtkIGTLI420ToRGBConverter::ConvertFrame(i420Frame, static_cast<unsigned char*>(output->GetScalarPointer()),
+                                               width, height, implementation))
+  {
+    return false;
+  }
+  output->Modified();
+  return true;
+}
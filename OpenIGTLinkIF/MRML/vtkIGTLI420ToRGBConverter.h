@@ -0,0 +1,84 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLI420ToRGBConverter.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLI420ToRGBConverter_h
+#define __vtkIGTLI420ToRGBConverter_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkImageData;
+
+/// \brief Conversion of decoded I420 (planar YUV 4:2:0) video frames to packed 8-bit RGB.
+///
+/// The conversion uses the BT.601 fixed point formula of the OpenIGTLink video decoders:
+///   C = Y - 16, D = U - 128, E = V - 128
+///   R = clip((298 * C + 409 * E + 128) >> 8)
+///   G = clip((298 * C - 100 * D - 208 * E + 128) >> 8)
+///   B = clip((298 * C + 516 * D + 128) >> 8)
+/// All implementations produce bit-exact results, the fastest one supported by the
+/// processor is selected at run time unless an implementation is explicitly requested.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLI420ToRGBConverter : public vtkObject
+{
+public:
+  static vtkIGTLI420ToRGBConverter *New();
+  vtkTypeMacro(vtkIGTLI420ToRGBConverter, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum
+  {
+    IMPLEMENTATION_AUTO = -1,
+    IMPLEMENTATION_SCALAR = 0,
+    IMPLEMENTATION_SSE2,
+    IMPLEMENTATION_AVX2,
+    IMPLEMENTATION_LAST // must be last
+  };
+
+  /// Returns the fastest implementation available on this processor.
+  static int GetBestImplementation();
+
+  /// Returns true if the implementation is compiled in and supported by the processor.
+  static bool IsImplementationAvailable(int implementation);
+
+  static const char* GetImplementationName(int implementation);
+
+#ifndef __VTK_WRAP__
+  /// Convert separate Y, U, V planes to packed RGB.
+  /// Chroma planes have (width+1)/2 x (height+1)/2 samples.
+  /// Strides are in bytes. Returns false if the requested implementation is not available.
+  static bool Convert(const unsigned char* yPlane, const unsigned char* uPlane, const unsigned char* vPlane,
+                      int yStride, int uvStride, unsigned char* rgb, int rgbStride,
+                      int width, int height, int implementation = IMPLEMENTATION_AUTO);
+
+  /// Convert a contiguous I420 frame (Y plane followed by the U and V planes) to packed RGB.
+  static bool ConvertFrame(const unsigned char* i420Frame, unsigned char* rgb,
+                           int width, int height, int implementation = IMPLEMENTATION_AUTO);
+
+  /// Convert a contiguous I420 frame into a 3 component unsigned char image.
+  /// The image is only reallocated if its dimensions or scalar type differ.
+  static bool ConvertFrame(const unsigned char* i420Frame, int width, int height, vtkImageData* output,
+                           int implementation = IMPLEMENTATION_AUTO);
+#endif
+
+protected:
+  vtkIGTLI420ToRGBConverter();
+  ~vtkIGTLI420ToRGBConverter();
+
+private:
+  vtkIGTLI420ToRGBConverter(const vtkIGTLI420ToRGBConverter&); // Not implemented
+  void operator=(const vtkIGTLI420ToRGBConverter&);             // Not implemented
+};
+
+#endif
@@ -0,0 +1,192 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLImageMetaDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLImageMetaDevice.h"
+
+// OpenIGTLink includes
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLImageMetaDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLImageMetaDevice::vtkIGTLImageMetaDevice()
+{
+  this->OutMessage = igtl::ImageMetaMessage::New();
+  this->InMessage = igtl::ImageMetaMessage::New();
+  this->GetMessage = igtl::GetImageMetaMessage::New();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLImageMetaDevice::~vtkIGTLImageMetaDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLImageMetaDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfElements: " << this->Elements.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkIGTLImageMetaDevice::GetDeviceContentModifiedEvent() const
+{
+  return ImageMetaModifiedEvent;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLImageMetaDevice::GetDeviceType() const
+{
+  return vtkIGTLImageMetaDevice::GetIGTLTypeName();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLImageMetaDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  if (strcmp(buffer->GetDeviceType(), "GET_IMGMETA") == 0)
+  {
+    // No body
+    this->InvokeEvent(ImageMetaRequestEvent, this);
+    return 1;
+  }
+
+  this->InMessage->SetMessageHeader(buffer);
+  this->InMessage->AllocateBuffer();
+  memcpy(this->InMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->InMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack IMGMETA message " << this->GetDeviceName());
+    return 0;
+  }
+
+  int numberOfElements = this->InMessage->GetNumberOfImageMetaElement();
+  this->Elements.resize(numberOfElements);
+  igtl::ImageMetaElement::Pointer element;
+  igtl::TimeStamp::Pointer elementTimestamp = igtl::TimeStamp::New();
+  igtlUint16 size[3];
+  for (int i = 0; i < numberOfElements; ++i)
+  {
+    this->InMessage->GetImageMetaElement(i, element);
+    ElementType& meta = this->Elements[i];
+    meta.Name = element->GetName();
+    meta.DeviceName = element->GetDeviceName();
+    meta.Modality = element->GetModality();
+    meta.PatientName = element->GetPatientName();
+    meta.PatientID = element->GetPatientID();
+    element->GetTimeStamp(elementTimestamp);
+    meta.TimeStamp = elementTimestamp->GetTimeStamp();
+    element->GetSize(size);
+    meta.Size[0] = size[0];
+    meta.Size[1] = size[1];
+    meta.Size[2] = size[2];
+    meta.ScalarType = element->GetScalarType();
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->InMessage->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(ImageMetaModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLImageMetaDevice::GetIGTLMessage()
+{
+  this->OutMessage->ClearImageMetaElement();
+  igtlUint16 size[3];
+  for (size_t i = 0; i < this->Elements.size(); ++i)
+  {
+    const ElementType& meta = this->Elements[i];
+    igtl::ImageMetaElement::Pointer element = igtl::ImageMetaElement::New();
+    element->SetName(meta.Name.c_str());
+    element->SetDeviceName(meta.DeviceName.c_str());
+    element->SetModality(meta.Modality.c_str());
+    element->SetPatientName(meta.PatientName.c_str());
+    element->SetPatientID(meta.PatientID.c_str());
+    igtl::TimeStamp::Pointer elementTimestamp = igtl::TimeStamp::New();
+    elementTimestamp->SetTime(meta.TimeStamp);
+    element->SetTimeStamp(elementTimestamp);
+    size[0] = static_cast<igtlUint16>(meta.Size[0]);
+    size[1] = static_cast<igtlUint16>(meta.Size[1]);
+    size[2] = static_cast<igtlUint16>(meta.Size[2]);
+    element->SetSize(size);
+    element->SetScalarType(meta.ScalarType);
+    this->OutMessage->AddImageMetaElement(element);
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->GetTime();
+  this->OutMessage->SetDeviceName(this->GetDeviceName().c_str());
+  this->OutMessage->SetTimeStamp(timestamp);
+  this->OutMessage->Pack();
+  return igtl::MessageBase::Pointer(this->OutMessage.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLImageMetaDevice::GetIGTLMessage(MESSAGE_PREFIX prefix)
+{
+  if (prefix == MESSAGE_PREFIX_NOT_DEFINED)
+  {
+    return this->GetIGTLMessage();
+  }
+  if (prefix == MESSAGE_PREFIX_GET)
+  {
+    this->GetMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->GetMessage->Pack();
+    return igtl::MessageBase::Pointer(this->GetMessage.GetPointer());
+  }
+  return igtl::MessageBase::Pointer();
+}
+
+//----------------------------------------------------------------------------
+std::set<igtlio::Device::MESSAGE_PREFIX> vtkIGTLImageMetaDevice::GetSupportedMessagePrefixes() const
+{
+  std::set<MESSAGE_PREFIX> retval;
+  retval.insert(MESSAGE_PREFIX_NOT_DEFINED);
+  retval.insert(MESSAGE_PREFIX_GET);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLImageMetaDevice::ClearElements()
+{
+  this->Elements.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLImageMetaDevice::AddElement(const ElementType& element)
+{
+  this->Elements.push_back(element);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLImageMetaDevice::GetNumberOfElements()
+{
+  return static_cast<int>(this->Elements.size());
+}
+
+//----------------------------------------------------------------------------
+const vtkIGTLImageMetaDevice::ElementType& vtkIGTLImageMetaDevice::GetElement(int index)
+{
+  return this->Elements[index];
+}
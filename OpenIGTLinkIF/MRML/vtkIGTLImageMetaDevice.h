@@ -0,0 +1,86 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLImageMetaDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLImageMetaDevice_h
+#define __vtkIGTLImageMetaDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+#include "vtkMRMLImageMetaListNode.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioDevice.h"
+
+// OpenIGTLink includes
+#include <igtlImageMetaMessage.h>
+
+// STD includes
+#include <vector>
+
+/// \brief OpenIGTLinkIO device for the IMGMETA message type.
+///
+/// An IMGMETA message lists the images that a server can send, a GET_IMGMETA message
+/// requests the list. The elements are kept in the format of vtkMRMLImageMetaListNode.
+/// A received GET_IMGMETA invokes ImageMetaRequestEvent, the list is sent with the NOT_DEFINED prefix.
+/// The OpenIGTLinkIO device factory does not know this message type, so a receiver
+/// must add the device before the first message arrives
+/// (see vtkMRMLIGTLConnectorNode::CreateDeviceForIncomingMessage).
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLImageMetaDevice : public igtlio::Device
+{
+public:
+  enum
+  {
+    ImageMetaModifiedEvent = 118996,
+    ImageMetaRequestEvent = 119005,
+  };
+
+  static vtkIGTLImageMetaDevice *New();
+  vtkTypeMacro(vtkIGTLImageMetaDevice, igtlio::Device);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static const char* GetIGTLTypeName() { return "IMGMETA"; };
+
+  virtual unsigned int GetDeviceContentModifiedEvent() const VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage() VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage(MESSAGE_PREFIX prefix) VTK_OVERRIDE;
+  virtual std::set<MESSAGE_PREFIX> GetSupportedMessagePrefixes() const VTK_OVERRIDE;
+
+#ifndef __VTK_WRAP__
+  typedef vtkMRMLImageMetaListNode::ImageMetaElement ElementType;
+
+  /// Elements to send, or the last received elements
+  void ClearElements();
+  void AddElement(const ElementType& element);
+  int GetNumberOfElements();
+  const ElementType& GetElement(int index);
+#endif
+
+protected:
+  vtkIGTLImageMetaDevice();
+  ~vtkIGTLImageMetaDevice();
+
+#ifndef __VTK_WRAP__
+  std::vector<ElementType> Elements;
+#endif
+
+  igtl::ImageMetaMessage::Pointer OutMessage;
+  igtl::ImageMetaMessage::Pointer InMessage;
+  igtl::GetImageMetaMessage::Pointer GetMessage;
+
+private:
+  vtkIGTLImageMetaDevice(const vtkIGTLImageMetaDevice&); // Not implemented
+  void operator=(const vtkIGTLImageMetaDevice&);         // Not implemented
+};
+
+#endif
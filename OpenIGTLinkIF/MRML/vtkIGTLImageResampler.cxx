@@ -0,0 +1,310 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLImageResampler.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLImageResampler.h"
+#include "vtkIGTLCPUFeatures.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(OpenIGTLinkIF_USE_SSE2)
+  #include <emmintrin.h>
+#endif
+
+namespace
+{
+  //---------------------------------------------------------------------------
+  // Source position of an output sample in 16.16 fixed point, pixel centers aligned
+  inline long long GetSourcePosition(int outputIndex, int inputSize, int outputSize)
+  {
+    long long position = ((2LL * outputIndex + 1) * inputSize * 65536) / (2LL * outputSize) - 32768;
+    return position < 0 ? 0 : position;
+  }
+
+  //---------------------------------------------------------------------------
+  // out = (a * (256 - f) + b * f + 128) >> 8
+  void BlendRowsScalar(const unsigned char* a, const unsigned char* b, unsigned char* out, int count, int fraction)
+  {
+    int weightA = 256 - fraction;
+    for (int i = 0; i < count; ++i)
+    {
+      out[i] = static_cast<unsigned char>((a[i] * weightA + b[i] * fraction + 128) >> 8);
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // Horizontal pass from output pixel firstX to the end of the row
+  void InterpolateRowScalar(const unsigned char* row, int numberOfComponents, const int* sourceIndex,
+                            const int* sourceFraction, int firstX, int outputWidth, unsigned char* out)
+  {
+    out += firstX * numberOfComponents;
+    for (int x = firstX; x < outputWidth; ++x)
+    {
+      const unsigned char* a = row + sourceIndex[x] * numberOfComponents;
+      const unsigned char* b = (sourceFraction[x] != 0) ? a + numberOfComponents : a;
+      int weightB = sourceFraction[x];
+      int weightA = 256 - weightB;
+      for (int component = 0; component < numberOfComponents; ++component)
+      {
+        *(out++) = static_cast<unsigned char>((a[component] * weightA + b[component] * weightB + 128) >> 8);
+      }
+    }
+  }
+
+#if defined(OpenIGTLinkIF_USE_SSE2)
+  //---------------------------------------------------------------------------
+  // The weighted sum is at most 255 * 256 + 128, so it fits in unsigned 16-bit lanes
+  void BlendRowsSSE2(const unsigned char* a, const unsigned char* b, unsigned char* out, int count, int fraction)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weightA = _mm_set1_epi16(static_cast<short>(256 - fraction));
+    const __m128i weightB = _mm_set1_epi16(static_cast<short>(fraction));
+    const __m128i rounding = _mm_set1_epi16(128);
+    int i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+      __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+      __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+      __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), weightA),
+                                               _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), weightB)), rounding);
+      __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), weightA),
+                                               _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), weightB)), rounding);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    BlendRowsScalar(a + i, b + i, out + i, count - i, fraction);
+  }
+
+  //---------------------------------------------------------------------------
+  // Horizontal pass of 3 and 4 component frames: the components of a pixel and of its right
+  // neighbor are loaded as 4 bytes and blended in 16-bit lanes. Returns the first output pixel
+  // left to the scalar code: 4-byte loads or stores must not cross the end of the row.
+  int InterpolateRowSSE2(const unsigned char* row, int rowLength, int numberOfComponents, const int* sourceIndex,
+                         const int* sourceFraction, int outputWidth, unsigned char* out)
+  {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rounding = _mm_set1_epi16(128);
+    int lastX = (numberOfComponents == 4) ? outputWidth : outputWidth - 1;
+    int x = 0;
+    for (; x < lastX; ++x)
+    {
+      int offset = sourceIndex[x] * numberOfComponents;
+      if (offset + numberOfComponents + 4 > rowLength)
+      {
+        // Source positions increase with x, the remaining pixels are at the end of the row
+        break;
+      }
+      int pixelA = 0;
+      int pixelB = 0;
+      memcpy(&pixelA, row + offset, 4);
+      memcpy(&pixelB, row + offset + numberOfComponents, 4);
+      __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixelA), zero);
+      __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixelB), zero);
+      __m128i weightA = _mm_set1_epi16(static_cast<short>(256 - sourceFraction[x]));
+      __m128i weightB = _mm_set1_epi16(static_cast<short>(sourceFraction[x]));
+      __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(a, weightA), _mm_mullo_epi16(b, weightB)), rounding);
+      int result = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_srli_epi16(sum, 8), zero));
+      // With 3 components the 4th byte is overwritten by the next pixel
+      memcpy(out + x * numberOfComponents, &result, 4);
+    }
+    return x;
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLImageResampler);
+
+//----------------------------------------------------------------------------
+vtkIGTLImageResampler::vtkIGTLImageResampler()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLImageResampler::~vtkIGTLImageResampler()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLImageResampler::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLImageResampler::IsImplementationAvailable(int implementation)
+{
+  switch (implementation)
+  {
+    case IMPLEMENTATION_AUTO:
+    case IMPLEMENTATION_SCALAR:
+      return true;
+    case IMPLEMENTATION_SSE2:
+      return vtkIGTLCPUFeatures::HasSSE2();
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLImageResampler::Resample(const unsigned char* input, int inputStride, int numberOfComponents,
+                                     int regionX, int regionY, int regionWidth, int regionHeight,
+                                     unsigned char* output, int outputStride, int outputWidth, int outputHeight,
+                                     int implementation)
+{
+  if (input == NULL || output == NULL || numberOfComponents <= 0 || regionX < 0 || regionY < 0
+    || regionWidth <= 0 || regionHeight <= 0 || outputWidth <= 0 || outputHeight <= 0)
+  {
+    return false;
+  }
+  if (implementation == IMPLEMENTATION_AUTO)
+  {
+    implementation = vtkIGTLCPUFeatures::HasSSE2() ? IMPLEMENTATION_SSE2 : IMPLEMENTATION_SCALAR;
+  }
+  else if (!vtkIGTLImageResampler::IsImplementationAvailable(implementation))
+  {
+    return false;
+  }
+
+  const unsigned char* region = input + regionY * inputStride + regionX * numberOfComponents;
+  int rowLength = regionWidth * numberOfComponents;
+
+  if (outputWidth == regionWidth && outputHeight == regionHeight)
+  {
+    // Crop only
+    for (int row = 0; row < outputHeight; ++row)
+    {
+      memcpy(output + row * outputStride, region + row * inputStride, rowLength);
+    }
+    return true;
+  }
+
+  // Horizontal interpolation table: first source pixel and weight of the second one
+  std::vector<int> sourceIndex(outputWidth);
+  std::vector<int> sourceFraction(outputWidth);
+  for (int x = 0; x < outputWidth; ++x)
+  {
+    long long position = GetSourcePosition(x, regionWidth, outputWidth);
+    int index = static_cast<int>(position >> 16);
+    int fraction = static_cast<int>((position >> 8) & 0xFF);
+    if (index >= regionWidth - 1)
+    {
+      index = regionWidth - 1;
+      fraction = 0;
+    }
+    sourceIndex[x] = index;
+    sourceFraction[x] = fraction;
+  }
+
+  std::vector<unsigned char> blendedRow(rowLength);
+  for (int row = 0; row < outputHeight; ++row)
+  {
+    long long position = GetSourcePosition(row, regionHeight, outputHeight);
+    int sourceRow = static_cast<int>(position >> 16);
+    int fraction = static_cast<int>((position >> 8) & 0xFF);
+    if (sourceRow >= regionHeight - 1)
+    {
+      sourceRow = regionHeight - 1;
+      fraction = 0;
+    }
+
+    const unsigned char* rowData = region + sourceRow * inputStride;
+    if (fraction != 0)
+    {
+      const unsigned char* nextRowData = rowData + inputStride;
+#if defined(OpenIGTLinkIF_USE_SSE2)
+      if (implementation == IMPLEMENTATION_SSE2)
+      {
+        BlendRowsSSE2(rowData, nextRowData, &blendedRow[0], rowLength, fraction);
+      }
+      else
+#endif
+      {
+        BlendRowsScalar(rowData, nextRowData, &blendedRow[0], rowLength, fraction);
+      }
+      rowData = &blendedRow[0];
+    }
+
+    unsigned char* out = output + row * outputStride;
+    if (outputWidth == regionWidth)
+    {
+      memcpy(out, rowData, rowLength);
+      continue;
+    }
+    int firstX = 0;
+#if defined(OpenIGTLinkIF_USE_SSE2)
+    if (implementation == IMPLEMENTATION_SSE2 && (numberOfComponents == 3 || numberOfComponents == 4))
+    {
+      firstX = InterpolateRowSSE2(rowData, rowLength, numberOfComponents, &sourceIndex[0], &sourceFraction[0],
+        outputWidth, out);
+    }
+#endif
+    InterpolateRowScalar(rowData, numberOfComponents, &sourceIndex[0], &sourceFraction[0], firstX, outputWidth, out);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLImageResampler::Resample(vtkImageData* input, const int region[4], int outputWidth, int outputHeight,
+                                     vtkImageData* output, int implementation)
+{
+  if (input == NULL || output == NULL || input->GetPointData()->GetScalars() == NULL
+    || input->GetScalarType() != VTK_UNSIGNED_CHAR)
+  {
+    return false;
+  }
+  int* inputDimensions = input->GetDimensions();
+  if (inputDimensions[2] != 1)
+  {
+    return false;
+  }
+  int x = std::max(0, std::min(region[0], inputDimensions[0] - 1));
+  int y = std::max(0, std::min(region[1], inputDimensions[1] - 1));
+  int width = std::min(region[2], inputDimensions[0] - x);
+  int height = std::min(region[3], inputDimensions[1] - y);
+  int numberOfComponents = input->GetNumberOfScalarComponents();
+
+  int* outputDimensions = output->GetDimensions();
+  if (outputDimensions[0] != outputWidth || outputDimensions[1] != outputHeight || outputDimensions[2] != 1
+    || output->GetScalarType() != VTK_UNSIGNED_CHAR || output->GetNumberOfScalarComponents() != numberOfComponents
+    || output->GetPointData()->GetScalars() == NULL)
+  {
+    output->SetDimensions(outputWidth, outputHeight, 1);
+    output->AllocateScalars(VTK_UNSIGNED_CHAR, numberOfComponents);
+  }
+  // Output pixel centers are at the source positions of the interpolation
+  double* inputSpacing = input->GetSpacing();
+  double* inputOrigin = input->GetOrigin();
+  double scaleX = static_cast<double>(width) / outputWidth;
+  double scaleY = static_cast<double>(height) / outputHeight;
+  output->SetSpacing(inputSpacing[0] * scaleX, inputSpacing[1] * scaleY, inputSpacing[2]);
+  output->SetOrigin(inputOrigin[0] + inputSpacing[0] * (x + 0.5 * scaleX - 0.5),
+                    inputOrigin[1] + inputSpacing[1] * (y + 0.5 * scaleY - 0.5),
+                    inputOrigin[2]);
+
+  if (!vtkIGTLImageResampler::Resample(static_cast<unsigned char*>(input->GetScalarPointer()),
+        inputDimensions[0] * numberOfComponents, numberOfComponents, x, y, width, height,
+        static_cast<unsigned char*>(output->GetScalarPointer()), outputWidth * numberOfComponents,
+        outputWidth, outputHeight, implementation))
+  {
+    return false;
+  }
+  output->Modified();
+  return true;
+}
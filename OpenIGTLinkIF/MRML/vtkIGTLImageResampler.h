@@ -0,0 +1,75 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLImageResampler.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLImageResampler_h
+#define __vtkIGTLImageResampler_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkImageData;
+
+/// \brief Crop and bilinear resize of 8-bit 2D frames before video encoding.
+///
+/// A region of the source frame is resampled to the output size with 8-bit fixed point
+/// bilinear weights. Rows are first blended vertically, then interpolated horizontally using
+/// precomputed source positions. With SSE2 the vertical pass is vectorized over the row and
+/// the horizontal pass over the components of RGB and RGBA pixels.
+/// All implementations produce bit-exact results.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLImageResampler : public vtkObject
+{
+public:
+  static vtkIGTLImageResampler *New();
+  vtkTypeMacro(vtkIGTLImageResampler, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum
+  {
+    IMPLEMENTATION_AUTO = -1,
+    IMPLEMENTATION_SCALAR = 0,
+    IMPLEMENTATION_SSE2,
+    IMPLEMENTATION_LAST // must be last
+  };
+
+  static bool IsImplementationAvailable(int implementation);
+
+#ifndef __VTK_WRAP__
+  /// Resample the region (regionX, regionY, regionWidth, regionHeight) of an interleaved
+  /// 8-bit frame to outputWidth x outputHeight pixels. Strides are in bytes.
+  /// The region must be inside the source frame.
+  static bool Resample(const unsigned char* input, int inputStride, int numberOfComponents,
+                       int regionX, int regionY, int regionWidth, int regionHeight,
+                       unsigned char* output, int outputStride, int outputWidth, int outputHeight,
+                       int implementation = IMPLEMENTATION_AUTO);
+#endif
+
+  /// Resample a region of a 2D unsigned char image into the output image.
+  /// region is (x, y, width, height) in pixels, it is clamped to the input extent.
+  /// The output image is only reallocated if its size or number of components change.
+  /// Its spacing and origin are set so that each output pixel has the position of the
+  /// source position it was interpolated at.
+  static bool Resample(vtkImageData* input, const int region[4], int outputWidth, int outputHeight,
+                       vtkImageData* output, int implementation = IMPLEMENTATION_AUTO);
+
+protected:
+  vtkIGTLImageResampler();
+  ~vtkIGTLImageResampler();
+
+private:
+  vtkIGTLImageResampler(const vtkIGTLImageResampler&); // Not implemented
+  void operator=(const vtkIGTLImageResampler&);        // Not implemented
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLabelMetaDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLLabelMetaDevice.h"
+
+// OpenIGTLink includes
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLLabelMetaDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLLabelMetaDevice::vtkIGTLLabelMetaDevice()
+{
+  this->OutMessage = igtl::LabelMetaMessage::New();
+  this->InMessage = igtl::LabelMetaMessage::New();
+  this->GetMessage = igtl::GetLabelMetaMessage::New();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLLabelMetaDevice::~vtkIGTLLabelMetaDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLabelMetaDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfElements: " << this->Elements.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkIGTLLabelMetaDevice::GetDeviceContentModifiedEvent() const
+{
+  return LabelMetaModifiedEvent;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLLabelMetaDevice::GetDeviceType() const
+{
+  return vtkIGTLLabelMetaDevice::GetIGTLTypeName();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLLabelMetaDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  if (strcmp(buffer->GetDeviceType(), "GET_LBMETA") == 0)
+  {
+    // No body
+    this->InvokeEvent(LabelMetaRequestEvent, this);
+    return 1;
+  }
+
+  this->InMessage->SetMessageHeader(buffer);
+  this->InMessage->AllocateBuffer();
+  memcpy(this->InMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->InMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack LBMETA message " << this->GetDeviceName());
+    return 0;
+  }
+
+  int numberOfElements = this->InMessage->GetNumberOfLabelMetaElement();
+  this->Elements.resize(numberOfElements);
+  igtl::LabelMetaElement::Pointer element;
+  igtlUint16 size[3];
+  for (int i = 0; i < numberOfElements; ++i)
+  {
+    this->InMessage->GetLabelMetaElement(i, element);
+    ElementType& meta = this->Elements[i];
+    meta.Name = element->GetName();
+    meta.DeviceName = element->GetDeviceName();
+    meta.Owner = element->GetOwner();
+    element->GetSize(size);
+    meta.Size[0] = size[0];
+    meta.Size[1] = size[1];
+    meta.Size[2] = size[2];
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->InMessage->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(LabelMetaModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLLabelMetaDevice::GetIGTLMessage()
+{
+  this->OutMessage->ClearLabelMetaElement();
+  igtlUint16 size[3];
+  for (size_t i = 0; i < this->Elements.size(); ++i)
+  {
+    const ElementType& meta = this->Elements[i];
+    igtl::LabelMetaElement::Pointer element = igtl::LabelMetaElement::New();
+    element->SetName(meta.Name.c_str());
+    element->SetDeviceName(meta.DeviceName.c_str());
+    element->SetOwner(meta.Owner.c_str());
+    size[0] = static_cast<igtlUint16>(meta.Size[0]);
+    size[1] = static_cast<igtlUint16>(meta.Size[1]);
+    size[2] = static_cast<igtlUint16>(meta.Size[2]);
+    element->SetSize(size);
+    this->OutMessage->AddLabelMetaElement(element);
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->GetTime();
+  this->OutMessage->SetDeviceName(this->GetDeviceName().c_str());
+  this->OutMessage->SetTimeStamp(timestamp);
+  this->OutMessage->Pack();
+  return igtl::MessageBase::Pointer(this->OutMessage.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLLabelMetaDevice::GetIGTLMessage(MESSAGE_PREFIX prefix)
+{
+  if (prefix == MESSAGE_PREFIX_NOT_DEFINED)
+  {
+    return this->GetIGTLMessage();
+  }
+  if (prefix == MESSAGE_PREFIX_GET)
+  {
+    this->GetMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->GetMessage->Pack();
+    return igtl::MessageBase::Pointer(this->GetMessage.GetPointer());
+  }
+  return igtl::MessageBase::Pointer();
+}
+
+//----------------------------------------------------------------------------
+std::set<igtlio::Device::MESSAGE_PREFIX> vtkIGTLLabelMetaDevice::GetSupportedMessagePrefixes() const
+{
+  std::set<MESSAGE_PREFIX> retval;
+  retval.insert(MESSAGE_PREFIX_NOT_DEFINED);
+  retval.insert(MESSAGE_PREFIX_GET);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLabelMetaDevice::ClearElements()
+{
+  this->Elements.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLabelMetaDevice::AddElement(const ElementType& element)
+{
+  this->Elements.push_back(element);
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLLabelMetaDevice::GetNumberOfElements()
+{
+  return static_cast<int>(this->Elements.size());
+}
+
+//----------------------------------------------------------------------------
+const vtkIGTLLabelMetaDevice::ElementType& vtkIGTLLabelMetaDevice::GetElement(int index)
+{
+  return this->Elements[index];
+}
@@ -0,0 +1,86 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLabelMetaDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLLabelMetaDevice_h
+#define __vtkIGTLLabelMetaDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+#include "vtkMRMLLabelMetaListNode.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioDevice.h"
+
+// OpenIGTLink includes
+#include <igtlLabelMetaMessage.h>
+
+// STD includes
+#include <vector>
+
+/// \brief OpenIGTLinkIO device for the LBMETA message type.
+///
+/// An LBMETA message lists the label maps that a server can send, a GET_LBMETA message
+/// requests the list. The elements are kept in the format of vtkMRMLLabelMetaListNode.
+/// A received GET_LBMETA invokes LabelMetaRequestEvent, the list is sent with the NOT_DEFINED prefix.
+/// The OpenIGTLinkIO device factory does not know this message type, so a receiver
+/// must add the device before the first message arrives
+/// (see vtkMRMLIGTLConnectorNode::CreateDeviceForIncomingMessage).
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLLabelMetaDevice : public igtlio::Device
+{
+public:
+  enum
+  {
+    LabelMetaModifiedEvent = 118997,
+    LabelMetaRequestEvent = 119006,
+  };
+
+  static vtkIGTLLabelMetaDevice *New();
+  vtkTypeMacro(vtkIGTLLabelMetaDevice, igtlio::Device);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static const char* GetIGTLTypeName() { return "LBMETA"; };
+
+  virtual unsigned int GetDeviceContentModifiedEvent() const VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage() VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage(MESSAGE_PREFIX prefix) VTK_OVERRIDE;
+  virtual std::set<MESSAGE_PREFIX> GetSupportedMessagePrefixes() const VTK_OVERRIDE;
+
+#ifndef __VTK_WRAP__
+  typedef vtkMRMLLabelMetaListNode::LabelMetaElement ElementType;
+
+  /// Elements to send, or the last received elements
+  void ClearElements();
+  void AddElement(const ElementType& element);
+  int GetNumberOfElements();
+  const ElementType& GetElement(int index);
+#endif
+
+protected:
+  vtkIGTLLabelMetaDevice();
+  ~vtkIGTLLabelMetaDevice();
+
+#ifndef __VTK_WRAP__
+  std::vector<ElementType> Elements;
+#endif
+
+  igtl::LabelMetaMessage::Pointer OutMessage;
+  igtl::LabelMetaMessage::Pointer InMessage;
+  igtl::GetLabelMetaMessage::Pointer GetMessage;
+
+private:
+  vtkIGTLLabelMetaDevice(const vtkIGTLLabelMetaDevice&); // Not implemented
+  void operator=(const vtkIGTLLabelMetaDevice&);         // Not implemented
+};
+
+#endif
@@ -0,0 +1,217 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLatencyHistogram.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLLatencyHistogram.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <algorithm>
+
+namespace
+{
+  // Values below 2^SubBucketMagnitude are stored exactly
+  const int SubBucketMagnitude = 7;
+  const int SubBucketCount = 1 << SubBucketMagnitude;
+  const int SubBucketHalfCount = SubBucketCount / 2;
+  // Largest trackable value is 2^MaximumMagnitude - 1 microseconds
+  const int MaximumMagnitude = 36;
+  const int NumberOfCounts = SubBucketCount + (MaximumMagnitude - SubBucketMagnitude) * SubBucketHalfCount;
+  const vtkTypeUInt64 MaximumTrackableValue = (static_cast<vtkTypeUInt64>(1) << MaximumMagnitude) - 1;
+
+  //----------------------------------------------------------------------------
+  int GetMostSignificantBit(vtkTypeUInt64 value)
+  {
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1)
+    {
+      ++bit;
+    }
+    return bit;
+#endif
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLLatencyHistogram);
+
+//----------------------------------------------------------------------------
+vtkIGTLLatencyHistogram::vtkIGTLLatencyHistogram()
+{
+  this->Counts.resize(NumberOfCounts, 0);
+  this->Reset();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLLatencyHistogram::~vtkIGTLLatencyHistogram()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLatencyHistogram::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "TotalCount: " << this->TotalCount << "\n";
+  os << indent << "NumberOfNegativeValues: " << this->NumberOfNegativeValues << "\n";
+  os << indent << "Minimum: " << this->GetMinimum() << " s\n";
+  os << indent << "Mean: " << this->GetMean() << " s\n";
+  os << indent << "P50: " << this->GetValueAtPercentile(50.0) << " s\n";
+  os << indent << "P99: " << this->GetValueAtPercentile(99.0) << " s\n";
+  os << indent << "Maximum: " << this->GetMaximum() << " s\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLLatencyHistogram::GetBucketIndex(vtkTypeUInt64 value)
+{
+  if (value < static_cast<vtkTypeUInt64>(SubBucketCount))
+  {
+    return static_cast<int>(value);
+  }
+  // Keep the SubBucketMagnitude most significant bits of the value
+  int magnitude = GetMostSignificantBit(value);
+  int shift = magnitude - SubBucketMagnitude + 1;
+  int subBucket = static_cast<int>(value >> shift) - SubBucketHalfCount;
+  return SubBucketCount + (magnitude - SubBucketMagnitude) * SubBucketHalfCount + subBucket;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkIGTLLatencyHistogram::GetHighestEquivalentValue(int index)
+{
+  if (index < SubBucketCount)
+  {
+    return static_cast<vtkTypeUInt64>(index);
+  }
+  int bucket = (index - SubBucketCount) / SubBucketHalfCount;
+  vtkTypeUInt64 subBucket = (index - SubBucketCount) % SubBucketHalfCount + SubBucketHalfCount;
+  int shift = bucket + 1;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLatencyHistogram::RecordValue(double value)
+{
+  vtkTypeUInt64 microseconds = 0;
+  if (value < 0.0)
+  {
+    ++this->NumberOfNegativeValues;
+  }
+  else
+  {
+    double scaled = value * 1e6 + 0.5;
+    microseconds = scaled < static_cast<double>(MaximumTrackableValue)
+      ? static_cast<vtkTypeUInt64>(scaled) : MaximumTrackableValue;
+  }
+  ++this->Counts[GetBucketIndex(microseconds)];
+  if (this->TotalCount == 0 || microseconds < this->MinimumValue)
+  {
+    this->MinimumValue = microseconds;
+  }
+  if (microseconds > this->MaximumValue)
+  {
+    this->MaximumValue = microseconds;
+  }
+  ++this->TotalCount;
+  this->Sum += static_cast<double>(microseconds);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLatencyHistogram::Reset()
+{
+  std::fill(this->Counts.begin(), this->Counts.end(), 0);
+  this->TotalCount = 0;
+  this->NumberOfNegativeValues = 0;
+  this->MinimumValue = 0;
+  this->MaximumValue = 0;
+  this->Sum = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkIGTLLatencyHistogram::GetTotalCount()
+{
+  return this->TotalCount;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeUInt64 vtkIGTLLatencyHistogram::GetNumberOfNegativeValues()
+{
+  return this->NumberOfNegativeValues;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLLatencyHistogram::GetMinimum()
+{
+  return this->MinimumValue * 1e-6;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLLatencyHistogram::GetMaximum()
+{
+  return this->MaximumValue * 1e-6;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLLatencyHistogram::GetMean()
+{
+  if (this->TotalCount == 0)
+  {
+    return 0.0;
+  }
+  return this->Sum / static_cast<double>(this->TotalCount) * 1e-6;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLLatencyHistogram::GetValueAtPercentile(double percentile)
+{
+  if (this->TotalCount == 0)
+  {
+    return 0.0;
+  }
+  if (percentile < 0.0)
+  {
+    percentile = 0.0;
+  }
+  else if (percentile > 100.0)
+  {
+    percentile = 100.0;
+  }
+  // Smallest value that has at least the requested fraction of the values at or below it
+  vtkTypeUInt64 countAtPercentile = static_cast<vtkTypeUInt64>(percentile / 100.0 * this->TotalCount + 0.5);
+  if (countAtPercentile < 1)
+  {
+    countAtPercentile = 1;
+  }
+  vtkTypeUInt64 cumulativeCount = 0;
+  for (int index = 0; index < NumberOfCounts; ++index)
+  {
+    cumulativeCount += this->Counts[index];
+    if (cumulativeCount >= countAtPercentile)
+    {
+      vtkTypeUInt64 value = GetHighestEquivalentValue(index);
+      // Report no more than the exact extremes
+      if (value > this->MaximumValue)
+      {
+        value = this->MaximumValue;
+      }
+      if (value < this->MinimumValue)
+      {
+        value = this->MinimumValue;
+      }
+      return value * 1e-6;
+    }
+  }
+  return this->GetMaximum();
+}
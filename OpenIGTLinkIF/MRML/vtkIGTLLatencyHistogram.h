@@ -0,0 +1,81 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLatencyHistogram.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLLatencyHistogram_h
+#define __vtkIGTLLatencyHistogram_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+/// \brief Histogram of time intervals with constant relative precision (HDR histogram).
+///
+/// Values are counted with microsecond resolution. Values below 128 microseconds are stored
+/// exactly, larger values in 64 linear sub-buckets per power of two, which keeps the relative
+/// error of percentiles below 1.6% from microseconds up to hours in 2048 counters.
+/// Recording a value does not allocate and takes a few integer operations.
+/// Values are given in seconds.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLLatencyHistogram : public vtkObject
+{
+public:
+  static vtkIGTLLatencyHistogram *New();
+  vtkTypeMacro(vtkIGTLLatencyHistogram, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Add a value, in seconds. Negative values are counted as 0 and in NumberOfNegativeValues.
+  /// Values above the largest trackable value (about 19 hours) are counted as that value.
+  void RecordValue(double value);
+
+  /// Remove all values
+  void Reset();
+
+  /// Number of recorded values
+  vtkTypeUInt64 GetTotalCount();
+
+  /// Number of values that were negative, which happens for latencies when the clocks
+  /// of the sender and the receiver are not synchronized
+  vtkTypeUInt64 GetNumberOfNegativeValues();
+
+  /// Exact minimum, maximum and mean of the recorded values, in seconds. 0 if the histogram is empty.
+  double GetMinimum();
+  double GetMaximum();
+  double GetMean();
+
+  /// Value below which the given percentage (0-100) of the recorded values fall, in seconds.
+  /// 0 if the histogram is empty.
+  double GetValueAtPercentile(double percentile);
+
+protected:
+  vtkIGTLLatencyHistogram();
+  ~vtkIGTLLatencyHistogram();
+
+  static int GetBucketIndex(vtkTypeUInt64 value);
+  static vtkTypeUInt64 GetHighestEquivalentValue(int index);
+
+  std::vector<vtkTypeUInt64> Counts;
+  vtkTypeUInt64 TotalCount;
+  vtkTypeUInt64 NumberOfNegativeValues;
+  vtkTypeUInt64 MinimumValue;
+  vtkTypeUInt64 MaximumValue;
+  double Sum;
+
+private:
+  vtkIGTLLatencyHistogram(const vtkIGTLLatencyHistogram&); // Not implemented
+  void operator=(const vtkIGTLLatencyHistogram&);          // Not implemented
+};
+
+#endif
@@ -0,0 +1,855 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLosslessCodec.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLLosslessCodec.h"
+
+// VTK includes
+#include <vtkConditionVariable.h>
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkMutexLock.h>
+#include <vtkObjectFactory.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cstring>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace
+{
+  const unsigned char StreamMagic[4] = { 'L', 'L', 'V', '1' };
+  const size_t StreamHeaderSize = 20;
+  const unsigned char StreamFlagKeyFrame = 0x01;
+
+  // Number of residuals sharing a Rice parameter
+  const int BlockSize = 32;
+  // Quotients of this length or more are replaced by the raw value
+  const unsigned int EscapeLength = 24;
+  // Smaller strips are not worth a thread, prediction restarts at every strip border
+  const int MinimumRowsPerStrip = 32;
+
+  //---------------------------------------------------------------------------
+  void WriteUInt32(unsigned char* buffer, vtkTypeUInt32 value)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      buffer[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  vtkTypeUInt32 ReadUInt32(const unsigned char* buffer)
+  {
+    return static_cast<vtkTypeUInt32>(buffer[0]) | (static_cast<vtkTypeUInt32>(buffer[1]) << 8)
+      | (static_cast<vtkTypeUInt32>(buffer[2]) << 16) | (static_cast<vtkTypeUInt32>(buffer[3]) << 24);
+  }
+
+  //---------------------------------------------------------------------------
+  // Number of leading zero bits, value must not be 0
+  inline int CountLeadingZeros(vtkTypeUInt64 value)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<int>(index);
+#else
+    int count = 0;
+    while (!(value & (static_cast<vtkTypeUInt64>(1) << 63)))
+    {
+      value <<= 1;
+      ++count;
+    }
+    return count;
+#endif
+  }
+
+  //---------------------------------------------------------------------------
+  // Most significant bit first bit writer
+  class BitWriter
+  {
+  public:
+    BitWriter(std::vector<unsigned char>& output) : Output(output), Buffer(0), Count(0) {}
+
+    // Write the low bits of value, bits <= 32
+    inline void Write(vtkTypeUInt32 value, int bits)
+    {
+      if (bits == 0)
+      {
+        return;
+      }
+      this->Buffer = (this->Buffer << bits) | (value & ((static_cast<vtkTypeUInt64>(1) << bits) - 1));
+      this->Count += bits;
+      while (this->Count >= 8)
+      {
+        this->Count -= 8;
+        this->Output.push_back(static_cast<unsigned char>(this->Buffer >> this->Count));
+      }
+    }
+
+    // Write count one bits
+    inline void WriteOnes(unsigned int count)
+    {
+      while (count >= 16)
+      {
+        this->Write(0xFFFF, 16);
+        count -= 16;
+      }
+      this->Write((1u << count) - 1, count);
+    }
+
+    void Flush()
+    {
+      if (this->Count > 0)
+      {
+        this->Output.push_back(static_cast<unsigned char>(this->Buffer << (8 - this->Count)));
+        this->Count = 0;
+      }
+    }
+
+  private:
+    std::vector<unsigned char>& Output;
+    vtkTypeUInt64 Buffer;
+    int Count;
+  };
+
+  //---------------------------------------------------------------------------
+  class BitReader
+  {
+  public:
+    BitReader(const unsigned char* data, size_t size)
+      : Data(data), Size(size), Position(0), Buffer(0), Count(0), PaddingBytes(0) {}
+
+    inline void Refill()
+    {
+      while (this->Count <= 56)
+      {
+        if (this->Position < this->Size)
+        {
+          this->Buffer = (this->Buffer << 8) | this->Data[this->Position++];
+        }
+        else
+        {
+          this->Buffer <<= 8;
+          this->PaddingBytes++;
+        }
+        this->Count += 8;
+      }
+    }
+
+    inline vtkTypeUInt32 Read(int bits)
+    {
+      if (bits == 0)
+      {
+        return 0;
+      }
+      if (this->Count < bits)
+      {
+        this->Refill();
+      }
+      this->Count -= bits;
+      return static_cast<vtkTypeUInt32>((this->Buffer >> this->Count) & ((static_cast<vtkTypeUInt64>(1) << bits) - 1));
+    }
+
+    // Read a unary code: ones terminated by a zero, or maxLength ones without terminator
+    inline unsigned int ReadUnary(unsigned int maxLength)
+    {
+      unsigned int length = 0;
+      for (;;)
+      {
+        if (this->Count == 0)
+        {
+          this->Refill();
+        }
+        // Align the available bits to the top, the bits below them are zero
+        vtkTypeUInt64 inverted = ~(this->Buffer << (64 - this->Count));
+        int ones = CountLeadingZeros(inverted);
+        if (ones > this->Count)
+        {
+          ones = this->Count;
+        }
+        if (length + ones >= maxLength)
+        {
+          this->Count -= static_cast<int>(maxLength - length);
+          return maxLength;
+        }
+        length += ones;
+        if (ones < this->Count)
+        {
+          this->Count -= ones + 1;
+          return length;
+        }
+        this->Count = 0;
+      }
+    }
+
+    // True if more bytes were consumed than available
+    bool Overrun() const
+    {
+      return static_cast<int>(this->PaddingBytes * 8) > this->Count;
+    }
+
+  private:
+    const unsigned char* Data;
+    size_t Size;
+    size_t Position;
+    vtkTypeUInt64 Buffer;
+    int Count;
+    unsigned int PaddingBytes;
+  };
+
+  //---------------------------------------------------------------------------
+  void EncodeBlock(BitWriter& writer, const vtkTypeUInt32* values, int count, int bits)
+  {
+    vtkTypeUInt64 sum = 0;
+    for (int i = 0; i < count; ++i)
+    {
+      sum += values[i];
+    }
+    // Rice parameter close to log2 of the mean value
+    int k = 0;
+    while (k < bits && (static_cast<vtkTypeUInt64>(count) << (k + 1)) <= sum)
+    {
+      ++k;
+    }
+    writer.Write(k, 5);
+    for (int i = 0; i < count; ++i)
+    {
+      vtkTypeUInt32 quotient = values[i] >> k;
+      if (quotient < EscapeLength)
+      {
+        writer.WriteOnes(quotient);
+        writer.Write(0, 1);
+        writer.Write(values[i], k);
+      }
+      else
+      {
+        writer.WriteOnes(EscapeLength);
+        writer.Write(values[i], bits);
+      }
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  // Median edge detector of JPEG-LS: a is the left, b the upper and c the upper left neighbor
+  inline int MedianEdgePredict(int a, int b, int c)
+  {
+    if (c >= std::max(a, b))
+    {
+      return std::min(a, b);
+    }
+    if (c <= std::min(a, b))
+    {
+      return std::max(a, b);
+    }
+    return a + b - c;
+  }
+
+  //---------------------------------------------------------------------------
+  // Prediction shared by the encoder and the decoder. Without previous frame the sample is
+  // predicted from its neighbors, otherwise the change since the previous frame is predicted
+  // from the change of the neighbors. Rows above the strip are not used.
+  template <typename T>
+  inline int Predict(const T* row, const T* upperRow, const T* previousRow, const T* previousUpperRow,
+                     int index, int numberOfComponents)
+  {
+    int left = index - numberOfComponents;
+    if (previousRow == NULL)
+    {
+      if (left < 0)
+      {
+        return upperRow ? upperRow[index] : 0;
+      }
+      if (upperRow == NULL)
+      {
+        return row[left];
+      }
+      return MedianEdgePredict(row[left], upperRow[index], upperRow[left]);
+    }
+    if (left < 0)
+    {
+      return upperRow ? previousRow[index] + upperRow[index] - previousUpperRow[index] : previousRow[index];
+    }
+    if (upperRow == NULL)
+    {
+      return previousRow[index] + row[left] - previousRow[left];
+    }
+    return previousRow[index] + MedianEdgePredict(row[left] - previousRow[left],
+      upperRow[index] - previousUpperRow[index], upperRow[left] - previousUpperRow[left]);
+  }
+
+  //---------------------------------------------------------------------------
+  template <typename T>
+  void EncodeStrip(const T* current, const T* previous, int rowLength, int numberOfComponents,
+                   int rowBegin, int rowEnd, std::vector<unsigned char>& output)
+  {
+    const int bits = 8 * sizeof(T);
+    const vtkTypeUInt32 mask = (1u << bits) - 1;
+    const vtkTypeUInt32 half = 1u << (bits - 1);
+    output.clear();
+    output.reserve(static_cast<size_t>(rowEnd - rowBegin) * rowLength * sizeof(T) / 2);
+    BitWriter writer(output);
+    vtkTypeUInt32 block[BlockSize];
+    int blockLength = 0;
+    for (int rowIndex = rowBegin; rowIndex < rowEnd; ++rowIndex)
+    {
+      const T* row = current + static_cast<size_t>(rowIndex) * rowLength;
+      const T* previousRow = previous ? previous + static_cast<size_t>(rowIndex) * rowLength : NULL;
+      const T* upperRow = (rowIndex > rowBegin) ? row - rowLength : NULL;
+      const T* previousUpperRow = (previousRow && upperRow) ? previousRow - rowLength : NULL;
+      for (int i = 0; i < rowLength; ++i)
+      {
+        int prediction = Predict(row, upperRow, previousRow, previousUpperRow, i, numberOfComponents);
+        vtkTypeUInt32 difference = static_cast<vtkTypeUInt32>(row[i] - prediction) & mask;
+        // Zigzag mapping of the signed residual: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+        block[blockLength++] = (difference < half) ? (difference << 1) : (((mask - difference) << 1) | 1);
+        if (blockLength == BlockSize)
+        {
+          EncodeBlock(writer, block, blockLength, bits);
+          blockLength = 0;
+        }
+      }
+    }
+    if (blockLength > 0)
+    {
+      EncodeBlock(writer, block, blockLength, bits);
+    }
+    writer.Flush();
+  }
+
+  //---------------------------------------------------------------------------
+  template <typename T>
+  bool DecodeStrip(const unsigned char* data, size_t size, T* current, const T* previous, int rowLength,
+                   int numberOfComponents, int rowBegin, int rowEnd)
+  {
+    const int bits = 8 * sizeof(T);
+    const vtkTypeUInt32 mask = (1u << bits) - 1;
+    BitReader reader(data, size);
+    vtkTypeUInt32 block[BlockSize];
+    int blockLength = 0;
+    int blockPosition = 0;
+    size_t remaining = static_cast<size_t>(rowEnd - rowBegin) * rowLength;
+    for (int rowIndex = rowBegin; rowIndex < rowEnd; ++rowIndex)
+    {
+      T* row = current + static_cast<size_t>(rowIndex) * rowLength;
+      const T* previousRow = previous ? previous + static_cast<size_t>(rowIndex) * rowLength : NULL;
+      const T* upperRow = (rowIndex > rowBegin) ? row - rowLength : NULL;
+      const T* previousUpperRow = (previousRow && upperRow) ? previousRow - rowLength : NULL;
+      for (int i = 0; i < rowLength; ++i)
+      {
+        if (blockPosition == blockLength)
+        {
+          blockLength = static_cast<int>(std::min<size_t>(BlockSize, remaining));
+          blockPosition = 0;
+          int k = static_cast<int>(reader.Read(5));
+          if (k > bits)
+          {
+            return false;
+          }
+          for (int j = 0; j < blockLength; ++j)
+          {
+            unsigned int quotient = reader.ReadUnary(EscapeLength);
+            block[j] = (quotient < EscapeLength) ? ((quotient << k) | reader.Read(k)) : reader.Read(bits);
+          }
+          if (reader.Overrun())
+          {
+            return false;
+          }
+        }
+        remaining--;
+        vtkTypeUInt32 zigzag = block[blockPosition++];
+        vtkTypeUInt32 difference = (zigzag & 1) ? (mask - (zigzag >> 1)) : (zigzag >> 1);
+        int prediction = Predict(row, upperRow, previousRow, previousUpperRow, i, numberOfComponents);
+        row[i] = static_cast<T>((static_cast<vtkTypeUInt32>(prediction) + difference) & mask);
+      }
+    }
+    return !reader.Overrun();
+  }
+
+  //---------------------------------------------------------------------------
+  // First and last row of a strip when the frame is split into numberOfStrips strips
+  void GetStripRows(int height, int numberOfStrips, int strip, int& rowBegin, int& rowEnd)
+  {
+    int rowsPerStrip = (height + numberOfStrips - 1) / numberOfStrips;
+    rowBegin = std::min(height, strip * rowsPerStrip);
+    rowEnd = std::min(height, rowBegin + rowsPerStrip);
+  }
+
+  //---------------------------------------------------------------------------
+  // Strips of one frame, encoded from Input or decoded into Output
+  struct StripJob
+  {
+    int ScalarSize;
+    int RowLength;
+    int NumberOfComponents;
+    int Height;
+    int NumberOfStrips;
+    const void* Previous;
+    // Encoding
+    const void* Input;
+    std::vector<std::vector<unsigned char> >* StripStreams;
+    // Decoding
+    void* Output;
+    std::vector<const unsigned char*> StripData;
+    std::vector<size_t> StripSizes;
+    std::vector<char> StripSuccess;
+  };
+
+  //---------------------------------------------------------------------------
+  void ProcessStrip(StripJob& job, int strip)
+  {
+    int rowBegin = 0;
+    int rowEnd = 0;
+    GetStripRows(job.Height, job.NumberOfStrips, strip, rowBegin, rowEnd);
+    if (job.Input != NULL)
+    {
+      std::vector<unsigned char>& output = (*job.StripStreams)[strip];
+      if (job.ScalarSize == 1)
+      {
+        EncodeStrip(static_cast<const vtkTypeUInt8*>(job.Input), static_cast<const vtkTypeUInt8*>(job.Previous),
+          job.RowLength, job.NumberOfComponents, rowBegin, rowEnd, output);
+      }
+      else
+      {
+        EncodeStrip(static_cast<const vtkTypeUInt16*>(job.Input), static_cast<const vtkTypeUInt16*>(job.Previous),
+          job.RowLength, job.NumberOfComponents, rowBegin, rowEnd, output);
+      }
+      return;
+    }
+    bool success = false;
+    if (job.ScalarSize == 1)
+    {
+      success = DecodeStrip(job.StripData[strip], job.StripSizes[strip], static_cast<vtkTypeUInt8*>(job.Output),
+        static_cast<const vtkTypeUInt8*>(job.Previous), job.RowLength, job.NumberOfComponents, rowBegin, rowEnd);
+    }
+    else
+    {
+      success = DecodeStrip(job.StripData[strip], job.StripSizes[strip], static_cast<vtkTypeUInt16*>(job.Output),
+        static_cast<const vtkTypeUInt16*>(job.Previous), job.RowLength, job.NumberOfComponents, rowBegin, rowEnd);
+    }
+    job.StripSuccess[strip] = success ? 1 : 0;
+  }
+
+  //---------------------------------------------------------------------------
+  // Size and type of a frame, a reference frame can only be used for frames with the same format
+  struct FrameFormat
+  {
+    FrameFormat() : Width(0), Height(0), ScalarType(0), NumberOfComponents(0) {}
+    bool operator==(const FrameFormat& other) const
+    {
+      return this->Width == other.Width && this->Height == other.Height
+        && this->ScalarType == other.ScalarType && this->NumberOfComponents == other.NumberOfComponents;
+    }
+    size_t GetFrameSize() const
+    {
+      return static_cast<size_t>(this->Width) * this->Height * this->NumberOfComponents
+        * ((this->ScalarType == VTK_UNSIGNED_SHORT || this->ScalarType == VTK_SHORT) ? 2 : 1);
+    }
+    int Width;
+    int Height;
+    int ScalarType;
+    int NumberOfComponents;
+  };
+}
+
+//---------------------------------------------------------------------------
+class vtkIGTLLosslessCodec::vtkInternal
+{
+public:
+  vtkInternal()
+    : EncoderReferenceValid(false)
+    , FramesSinceKeyFrame(0)
+    , KeyFrameRequested(false)
+    , DecoderReferenceValid(false)
+    , Stopping(false)
+    , CurrentJob(NULL)
+    , NextStrip(0)
+    , NumberOfProcessedStrips(0)
+  {
+    this->StripAvailable = vtkSmartPointer<vtkConditionVariable>::New();
+    this->JobDone = vtkSmartPointer<vtkConditionVariable>::New();
+    this->Threader = vtkSmartPointer<vtkMultiThreader>::New();
+  }
+
+  ~vtkInternal()
+  {
+    this->StopThreads();
+  }
+
+  /// Process all strips of the job, on the calling thread and numberOfThreads - 1 worker threads.
+  void RunJob(StripJob& job, int numberOfThreads);
+
+  static VTK_THREAD_RETURN_TYPE WorkerThread(void* arg);
+  void RunWorker();
+  void StartThreads(int numberOfThreads);
+  void StopThreads();
+
+  FrameFormat EncoderFormat;
+  std::vector<unsigned char> EncoderReference;
+  bool EncoderReferenceValid;
+  int FramesSinceKeyFrame;
+  bool KeyFrameRequested;
+  std::vector<std::vector<unsigned char> > StripStreams;
+
+  FrameFormat DecoderFormat;
+  std::vector<unsigned char> DecoderReference;
+  bool DecoderReferenceValid;
+
+  // Worker threads are started once and wait for the strips of the next frame,
+  // starting threads for every frame costs as much as the strips gain
+  vtkSimpleMutexLock Mutex;
+  vtkSmartPointer<vtkConditionVariable> StripAvailable;
+  vtkSmartPointer<vtkConditionVariable> JobDone;
+  vtkSmartPointer<vtkMultiThreader> Threader;
+  std::vector<int> ThreadIDs;
+  bool Stopping;
+  StripJob* CurrentJob;
+  int NextStrip;
+  int NumberOfProcessedStrips;
+};
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessCodec::vtkInternal::RunJob(StripJob& job, int numberOfThreads)
+{
+  if (numberOfThreads <= 1 || job.NumberOfStrips <= 1)
+  {
+    for (int strip = 0; strip < job.NumberOfStrips; ++strip)
+    {
+      ProcessStrip(job, strip);
+    }
+    return;
+  }
+  if (static_cast<int>(this->ThreadIDs.size()) != numberOfThreads - 1)
+  {
+    this->StopThreads();
+    this->StartThreads(numberOfThreads - 1);
+  }
+
+  this->Mutex.Lock();
+  this->CurrentJob = &job;
+  this->NextStrip = 0;
+  this->NumberOfProcessedStrips = 0;
+  this->StripAvailable->Broadcast();
+  // The calling thread takes strips as well
+  while (this->NextStrip < job.NumberOfStrips)
+  {
+    int strip = this->NextStrip++;
+    this->Mutex.Unlock();
+    ProcessStrip(job, strip);
+    this->Mutex.Lock();
+    ++this->NumberOfProcessedStrips;
+  }
+  while (this->NumberOfProcessedStrips < job.NumberOfStrips)
+  {
+    this->JobDone->Wait(this->Mutex);
+  }
+  this->CurrentJob = NULL;
+  this->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+VTK_THREAD_RETURN_TYPE vtkIGTLLosslessCodec::vtkInternal::WorkerThread(void* arg)
+{
+  vtkMultiThreader::ThreadInfo* info = static_cast<vtkMultiThreader::ThreadInfo*>(arg);
+  static_cast<vtkInternal*>(info->UserData)->RunWorker();
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessCodec::vtkInternal::RunWorker()
+{
+  this->Mutex.Lock();
+  while (true)
+  {
+    while (!this->Stopping && (this->CurrentJob == NULL || this->NextStrip >= this->CurrentJob->NumberOfStrips))
+    {
+      this->StripAvailable->Wait(this->Mutex);
+    }
+    if (this->Stopping)
+    {
+      break;
+    }
+    StripJob* job = this->CurrentJob;
+    int strip = this->NextStrip++;
+    this->Mutex.Unlock();
+
+    ProcessStrip(*job, strip);
+
+    this->Mutex.Lock();
+    // The job is owned by the caller of RunJob, it is not accessed after its last strip
+    if (++this->NumberOfProcessedStrips == job->NumberOfStrips)
+    {
+      this->JobDone->Signal();
+    }
+  }
+  this->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessCodec::vtkInternal::StartThreads(int numberOfThreads)
+{
+  for (int i = 0; i < numberOfThreads; ++i)
+  {
+    this->ThreadIDs.push_back(this->Threader->SpawnThread(&vtkInternal::WorkerThread, this));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessCodec::vtkInternal::StopThreads()
+{
+  this->Mutex.Lock();
+  this->Stopping = true;
+  this->StripAvailable->Broadcast();
+  std::vector<int> threadIDs;
+  threadIDs.swap(this->ThreadIDs);
+  this->Mutex.Unlock();
+
+  for (size_t i = 0; i < threadIDs.size(); ++i)
+  {
+    this->Threader->TerminateThread(threadIDs[i]);
+  }
+
+  this->Mutex.Lock();
+  this->Stopping = false;
+  this->Mutex.Unlock();
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLLosslessCodec);
+
+//----------------------------------------------------------------------------
+vtkIGTLLosslessCodec::vtkIGTLLosslessCodec()
+{
+  this->Internal = new vtkInternal;
+  this->NumberOfThreads = std::max(1, std::min(64, vtkMultiThreader::GetGlobalDefaultNumberOfThreads()));
+  this->KeyFrameInterval = 30;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLLosslessCodec::~vtkIGTLLosslessCodec()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessCodec::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfThreads: " << this->NumberOfThreads << "\n";
+  os << indent << "KeyFrameInterval: " << this->KeyFrameInterval << "\n";
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLLosslessCodec::IsScalarTypeSupported(int scalarType)
+{
+  return scalarType == VTK_UNSIGNED_CHAR || scalarType == VTK_CHAR || scalarType == VTK_SIGNED_CHAR
+    || scalarType == VTK_UNSIGNED_SHORT || scalarType == VTK_SHORT;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessCodec::Reset()
+{
+  this->Internal->EncoderReferenceValid = false;
+  this->Internal->DecoderReferenceValid = false;
+  this->Internal->FramesSinceKeyFrame = 0;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessCodec::RequestKeyFrame()
+{
+  this->Internal->KeyFrameRequested = true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLLosslessCodec::IsKeyFrame(const unsigned char* stream, size_t size)
+{
+  return stream != NULL && size >= StreamHeaderSize && memcmp(stream, StreamMagic, 4) == 0
+    && (stream[4] & StreamFlagKeyFrame) != 0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLLosslessCodec::EncodeFrame(vtkImageData* frame, std::vector<unsigned char>& stream)
+{
+  if (frame == NULL || frame->GetPointData()->GetScalars() == NULL)
+  {
+    vtkErrorMacro("EncodeFrame: invalid frame");
+    return false;
+  }
+  FrameFormat format;
+  int* dimensions = frame->GetDimensions();
+  format.Width = dimensions[0];
+  format.Height = dimensions[1];
+  format.ScalarType = frame->GetScalarType();
+  format.NumberOfComponents = frame->GetNumberOfScalarComponents();
+  if (dimensions[2] != 1 || format.Width <= 0 || format.Height <= 0 || format.NumberOfComponents > 255
+    || !vtkIGTLLosslessCodec::IsScalarTypeSupported(format.ScalarType))
+  {
+    vtkErrorMacro("EncodeFrame: only 2D frames of 8 or 16-bit integers are supported");
+    return false;
+  }
+
+  vtkInternal* internal = this->Internal;
+  bool keyFrame = !internal->EncoderReferenceValid || !(internal->EncoderFormat == format)
+    || internal->KeyFrameRequested || internal->FramesSinceKeyFrame >= this->KeyFrameInterval;
+
+  // One strip per thread, strips are predicted independently
+  StripJob job;
+  job.ScalarSize = frame->GetScalarSize();
+  job.RowLength = format.Width * format.NumberOfComponents;
+  job.NumberOfComponents = format.NumberOfComponents;
+  job.Height = format.Height;
+  job.NumberOfStrips = std::max(1, std::min(this->NumberOfThreads, format.Height / MinimumRowsPerStrip));
+  job.Previous = keyFrame ? NULL : &internal->EncoderReference[0];
+  job.Input = frame->GetScalarPointer();
+  job.StripStreams = &internal->StripStreams;
+  job.Output = NULL;
+  internal->StripStreams.resize(job.NumberOfStrips);
+  internal->RunJob(job, this->NumberOfThreads);
+
+  size_t streamSize = StreamHeaderSize + 4 * job.NumberOfStrips;
+  for (int strip = 0; strip < job.NumberOfStrips; ++strip)
+  {
+    streamSize += internal->StripStreams[strip].size();
+  }
+  stream.resize(streamSize);
+  unsigned char* header = &stream[0];
+  memcpy(header, StreamMagic, 4);
+  header[4] = keyFrame ? StreamFlagKeyFrame : 0;
+  header[5] = static_cast<unsigned char>(format.ScalarType);
+  header[6] = static_cast<unsigned char>(format.NumberOfComponents);
+  header[7] = 0;
+  WriteUInt32(header + 8, static_cast<vtkTypeUInt32>(format.Width));
+  WriteUInt32(header + 12, static_cast<vtkTypeUInt32>(format.Height));
+  WriteUInt32(header + 16, static_cast<vtkTypeUInt32>(job.NumberOfStrips));
+  unsigned char* data = header + StreamHeaderSize + 4 * job.NumberOfStrips;
+  for (int strip = 0; strip < job.NumberOfStrips; ++strip)
+  {
+    const std::vector<unsigned char>& stripStream = internal->StripStreams[strip];
+    WriteUInt32(header + StreamHeaderSize + 4 * strip, static_cast<vtkTypeUInt32>(stripStream.size()));
+    if (!stripStream.empty())
+    {
+      memcpy(data, &stripStream[0], stripStream.size());
+      data += stripStream.size();
+    }
+  }
+
+  // Keep the frame as reference for the next delta frame
+  internal->EncoderFormat = format;
+  internal->EncoderReference.resize(format.GetFrameSize());
+  memcpy(&internal->EncoderReference[0], frame->GetScalarPointer(), internal->EncoderReference.size());
+  internal->EncoderReferenceValid = true;
+  internal->FramesSinceKeyFrame = keyFrame ? 1 : internal->FramesSinceKeyFrame + 1;
+  internal->KeyFrameRequested = false;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLLosslessCodec::DecodeFrame(const unsigned char* stream, size_t size, vtkImageData* frame)
+{
+  if (stream == NULL || frame == NULL || size < StreamHeaderSize || memcmp(stream, StreamMagic, 4) != 0)
+  {
+    vtkErrorMacro("DecodeFrame: invalid stream");
+    return false;
+  }
+  bool keyFrame = (stream[4] & StreamFlagKeyFrame) != 0;
+  FrameFormat format;
+  format.ScalarType = stream[5];
+  format.NumberOfComponents = stream[6];
+  format.Width = static_cast<int>(ReadUInt32(stream + 8));
+  format.Height = static_cast<int>(ReadUInt32(stream + 12));
+  vtkTypeUInt32 numberOfStrips = ReadUInt32(stream + 16);
+  if (!vtkIGTLLosslessCodec::IsScalarTypeSupported(format.ScalarType) || format.NumberOfComponents <= 0
+    || format.Width <= 0 || format.Height <= 0 || numberOfStrips == 0
+    || numberOfStrips > static_cast<vtkTypeUInt32>(format.Height)
+    || size - StreamHeaderSize < 4 * static_cast<vtkTypeUInt64>(numberOfStrips))
+  {
+    vtkErrorMacro("DecodeFrame: invalid stream header");
+    return false;
+  }
+
+  vtkInternal* internal = this->Internal;
+  if (!keyFrame && (!internal->DecoderReferenceValid || !(internal->DecoderFormat == format)))
+  {
+    // Wait for the next key frame
+    return false;
+  }
+
+  // Every sample takes at least one bit (the unary part of its Rice code), so the header
+  // cannot describe more samples than the payload has bits. Checked before allocating the frame.
+  vtkTypeUInt64 payloadOffset = StreamHeaderSize + 4 * static_cast<vtkTypeUInt64>(numberOfStrips);
+  vtkTypeUInt64 rowLength64 = static_cast<vtkTypeUInt64>(format.Width) * format.NumberOfComponents;
+  if (rowLength64 * format.Height > 8 * (size - payloadOffset) || rowLength64 > static_cast<vtkTypeUInt64>(VTK_INT_MAX))
+  {
+    vtkErrorMacro("DecodeFrame: frame size " << format.Width << "x" << format.Height << "x"
+      << format.NumberOfComponents << " does not match the stream length");
+    return false;
+  }
+  StripJob job;
+  job.ScalarSize = (format.ScalarType == VTK_UNSIGNED_SHORT || format.ScalarType == VTK_SHORT) ? 2 : 1;
+  job.RowLength = static_cast<int>(rowLength64);
+  job.NumberOfComponents = format.NumberOfComponents;
+  job.Height = format.Height;
+  job.NumberOfStrips = static_cast<int>(numberOfStrips);
+  job.Previous = keyFrame ? NULL : &internal->DecoderReference[0];
+  job.Input = NULL;
+  job.StripStreams = NULL;
+  job.StripData.resize(numberOfStrips);
+  job.StripSizes.resize(numberOfStrips);
+  job.StripSuccess.assign(numberOfStrips, 0);
+  vtkTypeUInt64 offset = payloadOffset;
+  for (vtkTypeUInt32 strip = 0; strip < numberOfStrips; ++strip)
+  {
+    int rowBegin = 0;
+    int rowEnd = 0;
+    GetStripRows(format.Height, static_cast<int>(numberOfStrips), static_cast<int>(strip), rowBegin, rowEnd);
+    job.StripSizes[strip] = ReadUInt32(stream + StreamHeaderSize + 4 * strip);
+    job.StripData[strip] = stream + offset;
+    offset += job.StripSizes[strip];
+    if (offset > size || rowLength64 * (rowEnd - rowBegin) > 8 * static_cast<vtkTypeUInt64>(job.StripSizes[strip]))
+    {
+      vtkErrorMacro("DecodeFrame: truncated stream");
+      return false;
+    }
+  }
+
+  int* dimensions = frame->GetDimensions();
+  if (dimensions[0] != format.Width || dimensions[1] != format.Height || dimensions[2] != 1
+    || frame->GetScalarType() != format.ScalarType || frame->GetNumberOfScalarComponents() != format.NumberOfComponents
+    || frame->GetPointData()->GetScalars() == NULL)
+  {
+    frame->SetDimensions(format.Width, format.Height, 1);
+    frame->AllocateScalars(format.ScalarType, format.NumberOfComponents);
+  }
+  job.Output = frame->GetScalarPointer();
+  internal->RunJob(job, this->NumberOfThreads);
+
+  if (std::find(job.StripSuccess.begin(), job.StripSuccess.end(), 0) != job.StripSuccess.end())
+  {
+    vtkErrorMacro("DecodeFrame: corrupted stream");
+    internal->DecoderReferenceValid = false;
+    return false;
+  }
+
+  internal->DecoderFormat = format;
+  internal->DecoderReference.resize(format.GetFrameSize());
+  memcpy(&internal->DecoderReference[0], job.Output, internal->DecoderReference.size());
+  internal->DecoderReferenceValid = true;
+  frame->Modified();
+  return true;
+}
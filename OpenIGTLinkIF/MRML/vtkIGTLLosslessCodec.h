@@ -0,0 +1,97 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLosslessCodec.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLLosslessCodec_h
+#define __vtkIGTLLosslessCodec_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+class vtkImageData;
+
+/// \brief Lossless compression of 8 and 16-bit 2D image streams.
+///
+/// Key frames are predicted from the neighbor samples with the JPEG-LS median edge detector,
+/// other frames from the previous frame plus the predicted change. Prediction residuals are zigzag mapped
+/// and written with adaptive Rice codes, the Rice parameter is selected per block of
+/// 32 samples. The frame is split into horizontal strips of at least 32 rows, one per thread,
+/// that are predicted independently. Strips are encoded and decoded by a pool of worker threads
+/// that is kept between frames. Prediction restarts at every strip border, which costs a little
+/// compression: vtkIGTLLosslessCodecTest --benchmark reports ratio and throughput per thread count.
+/// The decoder checks the frame size of the header against the stream length before
+/// allocating the frame.
+///
+/// Stream layout (little endian):
+///   "LLV1", uint8 flags (1: key frame), uint8 VTK scalar type, uint8 number of components,
+///   uint8 reserved, uint32 width, uint32 height, uint32 number of strips,
+///   uint32 strip sizes[], strip data.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLLosslessCodec : public vtkObject
+{
+public:
+  static vtkIGTLLosslessCodec *New();
+  vtkTypeMacro(vtkIGTLLosslessCodec, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Number of strips (and threads) used to encode a frame, and maximum number of threads
+  /// used to decode a frame. Defaults to the number of processors.
+  vtkGetMacro(NumberOfThreads, int);
+  vtkSetClampMacro(NumberOfThreads, int, 1, 64);
+
+  /// Number of frames between key frames. A value of 1 makes every frame a key frame.
+  vtkGetMacro(KeyFrameInterval, int);
+  vtkSetClampMacro(KeyFrameInterval, int, 1, 100000);
+
+  /// Returns true if frames of this scalar type can be compressed
+  /// (signed or unsigned 8 and 16-bit integers).
+  static bool IsScalarTypeSupported(int scalarType);
+
+  /// Forget the reference frame. The next encoded frame is a key frame,
+  /// and the decoder only accepts a key frame.
+  void Reset();
+
+  /// Request the next encoded frame to be a key frame.
+  void RequestKeyFrame();
+
+#ifndef __VTK_WRAP__
+  /// Compress a 2D frame. Returns false if the scalar type is not supported.
+  bool EncodeFrame(vtkImageData* frame, std::vector<unsigned char>& stream);
+
+  /// Decompress a frame into the image. The image is reallocated if its size or type changes.
+  /// Returns false if the stream is invalid or a delta frame arrives without reference frame.
+  bool DecodeFrame(const unsigned char* stream, size_t size, vtkImageData* frame);
+
+  /// Returns true if the stream is a key frame.
+  static bool IsKeyFrame(const unsigned char* stream, size_t size);
+#endif
+
+protected:
+  vtkIGTLLosslessCodec();
+  ~vtkIGTLLosslessCodec();
+
+  int NumberOfThreads;
+  int KeyFrameInterval;
+
+private:
+  vtkIGTLLosslessCodec(const vtkIGTLLosslessCodec&); // Not implemented
+  void operator=(const vtkIGTLLosslessCodec&);      // Not implemented
+
+  class vtkInternal;
+  vtkInternal* Internal;
+};
+
+#endif
@@ -0,0 +1,202 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLosslessVideoDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLLosslessVideoDevice.h"
+#include "vtkIGTLLosslessCodec.h"
+
+// OpenIGTLink includes
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+// vtkIGTLLosslessVideoMessage
+
+//----------------------------------------------------------------------------
+vtkIGTLLosslessVideoMessage::vtkIGTLLosslessVideoMessage()
+{
+  this->m_SendMessageType = "LLVIDEO";
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLLosslessVideoMessage::~vtkIGTLLosslessVideoMessage()
+{
+}
+
+//----------------------------------------------------------------------------
+igtlUint64 vtkIGTLLosslessVideoMessage::CalculateContentBufferSize()
+{
+  return static_cast<igtlUint64>(this->Stream.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLLosslessVideoMessage::PackContent()
+{
+  this->AllocateBuffer();
+  if (!this->Stream.empty())
+  {
+    memcpy(this->m_Content, &this->Stream[0], this->Stream.size());
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLLosslessVideoMessage::UnpackContent()
+{
+  igtlUint64 size = this->CalculateReceiveContentSize();
+  this->Stream.resize(static_cast<size_t>(size));
+  if (size > 0)
+  {
+    memcpy(&this->Stream[0], this->m_Content, static_cast<size_t>(size));
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+// vtkIGTLLosslessVideoDevice
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLLosslessVideoDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLLosslessVideoDevice::vtkIGTLLosslessVideoDevice()
+{
+  this->Image = vtkSmartPointer<vtkImageData>::New();
+  this->Codec = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+  this->OutMessage = vtkIGTLLosslessVideoMessage::New();
+  this->InMessage = vtkIGTLLosslessVideoMessage::New();
+  this->LastStreamSize = 0;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLLosslessVideoDevice::~vtkIGTLLosslessVideoDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessVideoDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "LastStreamSize: " << this->LastStreamSize << "\n";
+  os << indent << "Codec:\n";
+  this->Codec->PrintSelf(os, indent.GetNextIndent());
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkIGTLLosslessVideoDevice::GetDeviceContentModifiedEvent() const
+{
+  return LosslessVideoModifiedEvent;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLLosslessVideoDevice::GetDeviceType() const
+{
+  return vtkIGTLLosslessVideoDevice::GetIGTLTypeName();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLLosslessVideoDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  this->InMessage->SetMessageHeader(buffer);
+  this->InMessage->AllocateBuffer();
+  memcpy(this->InMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->InMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack LLVIDEO message " << this->GetDeviceName());
+    return 0;
+  }
+
+  std::vector<unsigned char>& stream = this->InMessage->GetStream();
+  this->LastStreamSize = stream.size();
+  if (stream.empty() || !this->Codec->DecodeFrame(&stream[0], stream.size(), this->Image))
+  {
+    // Delta frames are dropped until a key frame arrives
+    return 0;
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->InMessage->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(LosslessVideoModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLLosslessVideoDevice::GetIGTLMessage()
+{
+  if (this->Image == NULL || !this->Codec->EncodeFrame(this->Image, this->OutMessage->GetStream()))
+  {
+    return NULL;
+  }
+  this->LastStreamSize = this->OutMessage->GetStream().size();
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->GetTime();
+  this->OutMessage->SetDeviceName(this->GetDeviceName().c_str());
+  this->OutMessage->SetTimeStamp(timestamp);
+  this->OutMessage->Pack();
+  return igtl::MessageBase::Pointer(this->OutMessage.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLLosslessVideoDevice::GetIGTLMessage(MESSAGE_PREFIX prefix)
+{
+  if (prefix == MESSAGE_PREFIX_NOT_DEFINED)
+  {
+    return this->GetIGTLMessage();
+  }
+  return igtl::MessageBase::Pointer();
+}
+
+//----------------------------------------------------------------------------
+std::set<igtlio::Device::MESSAGE_PREFIX> vtkIGTLLosslessVideoDevice::GetSupportedMessagePrefixes() const
+{
+  std::set<MESSAGE_PREFIX> retval;
+  retval.insert(MESSAGE_PREFIX_NOT_DEFINED);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLLosslessVideoDevice::SetImage(vtkImageData* image)
+{
+  if (this->Image == image)
+  {
+    return;
+  }
+  this->Image = image;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkIGTLLosslessVideoDevice::GetImage()
+{
+  return this->Image;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLLosslessCodec* vtkIGTLLosslessVideoDevice::GetCodec()
+{
+  return this->Codec;
+}
+
+//----------------------------------------------------------------------------
+size_t vtkIGTLLosslessVideoDevice::GetLastStreamSize()
+{
+  return this->LastStreamSize;
+}
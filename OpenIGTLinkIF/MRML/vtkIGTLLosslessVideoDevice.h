@@ -0,0 +1,114 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLLosslessVideoDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLLosslessVideoDevice_h
+#define __vtkIGTLLosslessVideoDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioDevice.h"
+
+// OpenIGTLink includes
+#include <igtlMessageBase.h>
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <vector>
+
+class vtkIGTLLosslessCodec;
+class vtkImageData;
+
+/// \brief LLVIDEO message: one frame compressed by vtkIGTLLosslessCodec.
+///
+/// The message body is the codec stream, which carries the frame size and scalar type.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLLosslessVideoMessage : public igtl::MessageBase
+{
+public:
+  typedef vtkIGTLLosslessVideoMessage    Self;
+  typedef igtl::MessageBase              Superclass;
+  typedef igtl::SmartPointer<Self>       Pointer;
+  typedef igtl::SmartPointer<const Self> ConstPointer;
+
+  igtlTypeMacro(vtkIGTLLosslessVideoMessage, igtl::MessageBase);
+  igtlNewMacro(vtkIGTLLosslessVideoMessage);
+
+  /// Compressed frame carried by the message
+  std::vector<unsigned char>& GetStream() { return this->Stream; };
+
+protected:
+  vtkIGTLLosslessVideoMessage();
+  ~vtkIGTLLosslessVideoMessage();
+
+  virtual igtlUint64 CalculateContentBufferSize();
+  virtual int PackContent();
+  virtual int UnpackContent();
+
+  std::vector<unsigned char> Stream;
+};
+
+/// \brief OpenIGTLinkIO device for the LLVIDEO message type.
+///
+/// Outgoing images are compressed losslessly when the message is requested,
+/// incoming messages are decoded into the device image. The OpenIGTLinkIO device factory
+/// does not know this message type, so a receiver must add the device before the first
+/// message arrives (see vtkMRMLIGTLConnectorNode::CreateDeviceForIncomingMessage).
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLLosslessVideoDevice : public igtlio::Device
+{
+public:
+  enum
+  {
+    LosslessVideoModifiedEvent = 118990,
+  };
+
+  static vtkIGTLLosslessVideoDevice *New();
+  vtkTypeMacro(vtkIGTLLosslessVideoDevice, igtlio::Device);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static const char* GetIGTLTypeName() { return "LLVIDEO"; };
+
+  virtual unsigned int GetDeviceContentModifiedEvent() const VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage() VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage(MESSAGE_PREFIX prefix) VTK_OVERRIDE;
+  virtual std::set<MESSAGE_PREFIX> GetSupportedMessagePrefixes() const VTK_OVERRIDE;
+
+  /// Image to send, or the last received image
+  void SetImage(vtkImageData* image);
+  vtkImageData* GetImage();
+
+  /// Codec used to compress and decompress the frames
+  vtkIGTLLosslessCodec* GetCodec();
+
+  /// Size in bytes of the last sent or received compressed frame
+  size_t GetLastStreamSize();
+
+protected:
+  vtkIGTLLosslessVideoDevice();
+  ~vtkIGTLLosslessVideoDevice();
+
+  vtkSmartPointer<vtkImageData> Image;
+  vtkSmartPointer<vtkIGTLLosslessCodec> Codec;
+  vtkIGTLLosslessVideoMessage::Pointer OutMessage;
+  vtkIGTLLosslessVideoMessage::Pointer InMessage;
+  size_t LastStreamSize;
+
+private:
+  vtkIGTLLosslessVideoDevice(const vtkIGTLLosslessVideoDevice&); // Not implemented
+  void operator=(const vtkIGTLLosslessVideoDevice&);            // Not implemented
+};
+
+#endif
@@ -0,0 +1,265 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLMatrixConverter.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLMatrixConverter.h"
+#include "vtkIGTLCPUFeatures.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cmath>
+
+#if defined(OpenIGTLinkIF_USE_SSE2)
+  #include <emmintrin.h>
+#endif
+#if defined(OpenIGTLinkIF_USE_AVX2)
+  #include <immintrin.h>
+#endif
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  void ConvertScalar(const float* source, double* destination, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      destination[i] = source[i];
+    }
+  }
+
+#if defined(OpenIGTLinkIF_USE_SSE2)
+  //----------------------------------------------------------------------------
+  // 8 values per iteration: two unaligned 4-float loads, each widened as two pairs of doubles
+  void ConvertSSE2(const float* source, double* destination, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m128 a = _mm_loadu_ps(source + i);
+      __m128 b = _mm_loadu_ps(source + i + 4);
+      _mm_storeu_pd(destination + i, _mm_cvtps_pd(a));
+      _mm_storeu_pd(destination + i + 2, _mm_cvtps_pd(_mm_movehl_ps(a, a)));
+      _mm_storeu_pd(destination + i + 4, _mm_cvtps_pd(b));
+      _mm_storeu_pd(destination + i + 6, _mm_cvtps_pd(_mm_movehl_ps(b, b)));
+    }
+    ConvertScalar(source + i, destination + i, count - i);
+  }
+#endif
+
+#if defined(OpenIGTLinkIF_USE_AVX2)
+  //----------------------------------------------------------------------------
+  // 16 values (one matrix) per iteration
+  OpenIGTLinkIF_TARGET_AVX2
+  void ConvertAVX2(const float* source, double* destination, size_t count)
+  {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+      __m256 a = _mm256_loadu_ps(source + i);
+      __m256 b = _mm256_loadu_ps(source + i + 8);
+      _mm256_storeu_pd(destination + i, _mm256_cvtps_pd(_mm256_castps256_ps128(a)));
+      _mm256_storeu_pd(destination + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(a, 1)));
+      _mm256_storeu_pd(destination + i + 8, _mm256_cvtps_pd(_mm256_castps256_ps128(b)));
+      _mm256_storeu_pd(destination + i + 12, _mm256_cvtps_pd(_mm256_extractf128_ps(b, 1)));
+    }
+    ConvertScalar(source + i, destination + i, count - i);
+  }
+#endif
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLMatrixConverter);
+
+//----------------------------------------------------------------------------
+vtkIGTLMatrixConverter::vtkIGTLMatrixConverter()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLMatrixConverter::~vtkIGTLMatrixConverter()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLMatrixConverter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "BestImplementation: "
+     << vtkIGTLMatrixConverter::GetImplementationName(vtkIGTLMatrixConverter::GetBestImplementation()) << "\n";
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLMatrixConverter::GetBestImplementation()
+{
+  if (vtkIGTLCPUFeatures::HasAVX2())
+  {
+    return IMPLEMENTATION_AVX2;
+  }
+  if (vtkIGTLCPUFeatures::HasSSE2())
+  {
+    return IMPLEMENTATION_SSE2;
+  }
+  return IMPLEMENTATION_SCALAR;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLMatrixConverter::IsImplementationAvailable(int implementation)
+{
+  switch (implementation)
+  {
+    case IMPLEMENTATION_AUTO:
+    case IMPLEMENTATION_SCALAR:
+      return true;
+    case IMPLEMENTATION_SSE2:
+      return vtkIGTLCPUFeatures::HasSSE2();
+    case IMPLEMENTATION_AVX2:
+      return vtkIGTLCPUFeatures::HasAVX2();
+    default:
+      return false;
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLMatrixConverter::GetImplementationName(int implementation)
+{
+  switch (implementation)
+  {
+    case IMPLEMENTATION_AUTO: return "Auto";
+    case IMPLEMENTATION_SCALAR: return "Scalar";
+    case IMPLEMENTATION_SSE2: return "SSE2";
+    case IMPLEMENTATION_AVX2: return "AVX2";
+    default: return "Unknown";
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLMatrixConverter::ConvertFloatToDouble(const float* source, double* destination, size_t count,
+                                                  int implementation)
+{
+  if (count == 0)
+  {
+    return true;
+  }
+  if (source == NULL || destination == NULL)
+  {
+    return false;
+  }
+  if (implementation == IMPLEMENTATION_AUTO)
+  {
+    // The best implementation is cached by vtkIGTLCPUFeatures, this is cheap per message
+    implementation = vtkIGTLMatrixConverter::GetBestImplementation();
+  }
+  else if (!vtkIGTLMatrixConverter::IsImplementationAvailable(implementation))
+  {
+    return false;
+  }
+
+  switch (implementation)
+  {
+#if defined(OpenIGTLinkIF_USE_AVX2)
+    case IMPLEMENTATION_AVX2:
+      ConvertAVX2(source, destination, count);
+      break;
+#endif
+#if defined(OpenIGTLinkIF_USE_SSE2)
+    case IMPLEMENTATION_SSE2:
+      ConvertSSE2(source, destination, count);
+      break;
+#endif
+    default:
+      ConvertScalar(source, destination, count);
+      break;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLMatrixConverter::ConvertMatrices(const float* source, double* destination, int numberOfMatrices,
+                                             int implementation)
+{
+  if (numberOfMatrices < 0)
+  {
+    return false;
+  }
+  return vtkIGTLMatrixConverter::ConvertFloatToDouble(source, destination, 16 * static_cast<size_t>(numberOfMatrices),
+                                                      implementation);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLMatrixConverter::ConvertMatrix(const float* source, vtkMatrix4x4* destination)
+{
+  if (source == NULL || destination == NULL)
+  {
+    return;
+  }
+  vtkIGTLMatrixConverter::ConvertFloatToDouble(source, &destination->Element[0][0], 16);
+  destination->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLMatrixConverter::MatrixToPositionQuaternion(const double matrix[16], float position[3], float quaternion[4])
+{
+  double rotation[3][3];
+  for (int column = 0; column < 3; ++column)
+  {
+    double axis[3] = { matrix[column], matrix[4 + column], matrix[8 + column] };
+    double length = vtkMath::Normalize(axis);
+    for (int row = 0; row < 3; ++row)
+    {
+      rotation[row][column] = length > 0.0 ? axis[row] : (row == column ? 1.0 : 0.0);
+    }
+    position[column] = static_cast<float>(matrix[4 * column + 3]);
+  }
+  // vtkMath uses the w, x, y, z order
+  double wxyz[4];
+  vtkMath::Matrix3x3ToQuaternion(rotation, wxyz);
+  quaternion[0] = static_cast<float>(wxyz[1]);
+  quaternion[1] = static_cast<float>(wxyz[2]);
+  quaternion[2] = static_cast<float>(wxyz[3]);
+  quaternion[3] = static_cast<float>(wxyz[0]);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLMatrixConverter::PositionQuaternionToMatrix(const float position[3], const float quaternion[4], double matrix[16])
+{
+  double wxyz[4] = { quaternion[3], quaternion[0], quaternion[1], quaternion[2] };
+  double norm = sqrt(wxyz[0] * wxyz[0] + wxyz[1] * wxyz[1] + wxyz[2] * wxyz[2] + wxyz[3] * wxyz[3]);
+  if (norm > 0.0)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      wxyz[i] /= norm;
+    }
+  }
+  else
+  {
+    wxyz[0] = 1.0;
+  }
+  double rotation[3][3];
+  vtkMath::QuaternionToMatrix3x3(wxyz, rotation);
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 3; ++column)
+    {
+      matrix[4 * row + column] = rotation[row][column];
+    }
+    matrix[4 * row + 3] = position[row];
+  }
+  matrix[12] = 0.0;
+  matrix[13] = 0.0;
+  matrix[14] = 0.0;
+  matrix[15] = 1.0;
+}
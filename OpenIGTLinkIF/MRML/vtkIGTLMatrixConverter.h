@@ -0,0 +1,86 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLMatrixConverter.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLMatrixConverter_h
+#define __vtkIGTLMatrixConverter_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <cstddef>
+
+class vtkMatrix4x4;
+
+/// \brief Conversion of OpenIGTLink single precision matrices to VTK double precision matrices.
+///
+/// Matrices of all tools of a message are converted in one call, without allocation.
+/// The fastest implementation supported by the processor is selected at run time unless
+/// an implementation is explicitly requested; all implementations give identical results.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLMatrixConverter : public vtkObject
+{
+public:
+  static vtkIGTLMatrixConverter *New();
+  vtkTypeMacro(vtkIGTLMatrixConverter, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum
+  {
+    IMPLEMENTATION_AUTO = -1,
+    IMPLEMENTATION_SCALAR = 0,
+    IMPLEMENTATION_SSE2,
+    IMPLEMENTATION_AVX2,
+    IMPLEMENTATION_LAST // must be last
+  };
+
+  /// Returns the fastest implementation available on this processor.
+  static int GetBestImplementation();
+
+  /// Returns true if the implementation is compiled in and supported by the processor.
+  static bool IsImplementationAvailable(int implementation);
+
+  static const char* GetImplementationName(int implementation);
+
+#ifndef __VTK_WRAP__
+  /// Widen count floats to doubles. Returns false if the requested implementation is not available.
+  static bool ConvertFloatToDouble(const float* source, double* destination, size_t count,
+                                   int implementation = IMPLEMENTATION_AUTO);
+
+  /// Convert numberOfMatrices row-major 4x4 float matrices (16 values each) to doubles.
+  static bool ConvertMatrices(const float* source, double* destination, int numberOfMatrices,
+                              int implementation = IMPLEMENTATION_AUTO);
+
+  /// Copy a row-major 4x4 float matrix (such as igtl::Matrix4x4) into an existing VTK matrix.
+  static void ConvertMatrix(const float* source, vtkMatrix4x4* destination);
+
+  /// Split a row-major 4x4 rigid transform into a position and a unit quaternion
+  /// (x, y, z, w order, as in POSITION and QTDATA messages). Scaling is removed.
+  static void MatrixToPositionQuaternion(const double matrix[16], float position[3], float quaternion[4]);
+
+  /// Build a row-major 4x4 rigid transform from a position and a quaternion (x, y, z, w order).
+  /// The quaternion is normalized; a zero quaternion gives the identity rotation.
+  static void PositionQuaternionToMatrix(const float position[3], const float quaternion[4], double matrix[16]);
+#endif
+
+protected:
+  vtkIGTLMatrixConverter();
+  ~vtkIGTLMatrixConverter();
+
+private:
+  vtkIGTLMatrixConverter(const vtkIGTLMatrixConverter&); // Not implemented
+  void operator=(const vtkIGTLMatrixConverter&);         // Not implemented
+};
+
+#endif
@@ -0,0 +1,323 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLPoseHistory.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLPoseHistory.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // Spherical linear interpolation between unit quaternions q0 and q1 (w, x, y, z)
+  void Slerp(const double q0[4], const double q1[4], double t, double q[4])
+  {
+    double cosTheta = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+    // q and -q are the same rotation, interpolate along the shorter arc
+    double sign = 1.0;
+    if (cosTheta < 0.0)
+    {
+      cosTheta = -cosTheta;
+      sign = -1.0;
+    }
+    double w0 = 1.0 - t;
+    double w1 = t;
+    if (cosTheta < 0.9995)
+    {
+      double theta = acos(cosTheta);
+      double sinTheta = sin(theta);
+      w0 = sin((1.0 - t) * theta) / sinTheta;
+      w1 = sin(t * theta) / sinTheta;
+    }
+    // else: nearly identical rotations, linear interpolation followed by normalization is accurate
+    w1 *= sign;
+    double norm = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+      q[i] = w0 * q0[i] + w1 * q1[i];
+      norm += q[i] * q[i];
+    }
+    norm = sqrt(norm);
+    for (int i = 0; i < 4; ++i)
+    {
+      q[i] /= norm;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLPoseHistory);
+
+//----------------------------------------------------------------------------
+vtkIGTLPoseHistory::vtkIGTLPoseHistory()
+{
+  this->Capacity = 0;
+  this->Start = 0;
+  this->Count = 0;
+  this->SetCapacity(256);
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLPoseHistory::~vtkIGTLPoseHistory()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPoseHistory::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Capacity: " << this->Capacity << "\n";
+  os << indent << "NumberOfPoses: " << this->Count << "\n";
+  if (this->Count > 0)
+  {
+    os << indent << "OldestTimestamp: " << this->GetOldestTimestamp() << "\n";
+    os << indent << "NewestTimestamp: " << this->GetNewestTimestamp() << "\n";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPoseHistory::SetCapacity(int capacity)
+{
+  if (capacity < 1)
+  {
+    capacity = 1;
+  }
+  if (capacity == this->Capacity)
+  {
+    return;
+  }
+  this->Capacity = capacity;
+  this->Timestamps.resize(capacity);
+  for (int i = 0; i < 3; ++i)
+  {
+    this->Translation[i].resize(capacity);
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    this->Quaternion[i].resize(capacity);
+  }
+  this->Clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPoseHistory::Clear()
+{
+  this->Start = 0;
+  this->Count = 0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLPoseHistory::GetNumberOfPoses()
+{
+  return this->Count;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLPoseHistory::GetOldestTimestamp()
+{
+  return this->Count > 0 ? this->Timestamps[this->GetBufferIndex(0)] : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLPoseHistory::GetNewestTimestamp()
+{
+  return this->Count > 0 ? this->Timestamps[this->GetBufferIndex(this->Count - 1)] : 0.0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLPoseHistory::AddPose(double timestamp, vtkMatrix4x4* matrix)
+{
+  if (matrix == NULL)
+  {
+    return false;
+  }
+  double rotation[3][3];
+  for (int column = 0; column < 3; ++column)
+  {
+    // Remove the scaling of each axis
+    double norm = 0.0;
+    for (int row = 0; row < 3; ++row)
+    {
+      norm += matrix->GetElement(row, column) * matrix->GetElement(row, column);
+    }
+    norm = norm > 0.0 ? sqrt(norm) : 1.0;
+    for (int row = 0; row < 3; ++row)
+    {
+      rotation[row][column] = matrix->GetElement(row, column) / norm;
+    }
+  }
+  double quaternion[4];
+  vtkMath::Matrix3x3ToQuaternion(rotation, quaternion);
+  double translation[3] = { matrix->GetElement(0, 3), matrix->GetElement(1, 3), matrix->GetElement(2, 3) };
+  return this->AddPose(timestamp, translation, quaternion);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLPoseHistory::AddPose(double timestamp, const double translation[3], const double quaternion[4])
+{
+  int index = 0;
+  if (this->Count > 0)
+  {
+    double newestTimestamp = this->GetNewestTimestamp();
+    if (timestamp < newestTimestamp)
+    {
+      return false;
+    }
+    if (timestamp == newestTimestamp)
+    {
+      index = this->GetBufferIndex(this->Count - 1);
+    }
+    else if (this->Count < this->Capacity)
+    {
+      index = this->GetBufferIndex(this->Count);
+      this->Count++;
+    }
+    else
+    {
+      // Overwrite the oldest pose
+      index = this->Start;
+      this->Start = this->GetBufferIndex(1);
+    }
+  }
+  else
+  {
+    this->Start = 0;
+    this->Count = 1;
+  }
+
+  double norm = sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1]
+    + quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]);
+  if (norm <= 0.0)
+  {
+    norm = 1.0;
+  }
+  this->Timestamps[index] = timestamp;
+  for (int i = 0; i < 3; ++i)
+  {
+    this->Translation[i][index] = translation[i];
+  }
+  for (int i = 0; i < 4; ++i)
+  {
+    this->Quaternion[i][index] = quaternion[i] / norm;
+  }
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLPoseHistory::GetPose(int index, double& timestamp, double translation[3], double quaternion[4])
+{
+  if (index < 0 || index >= this->Count)
+  {
+    return false;
+  }
+  int bufferIndex = this->GetBufferIndex(index);
+  timestamp = this->Timestamps[bufferIndex];
+  for (int k = 0; k < 3; ++k)
+  {
+    translation[k] = this->Translation[k][bufferIndex];
+  }
+  for (int k = 0; k < 4; ++k)
+  {
+    quaternion[k] = this->Quaternion[k][bufferIndex];
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLPoseHistory::FindPoseIndex(double timestamp) const
+{
+  // Binary search for the last pose with time stamp <= timestamp
+  int low = 0;
+  int high = this->Count;
+  while (low < high)
+  {
+    int middle = (low + high) / 2;
+    if (this->Timestamps[this->GetBufferIndex(middle)] <= timestamp)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  return low - 1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLPoseHistory::GetPoseAtTime(double timestamp, double translation[3], double quaternion[4])
+{
+  int i = this->FindPoseIndex(timestamp);
+  if (i < 0 || (i == this->Count - 1 && timestamp > this->GetNewestTimestamp()))
+  {
+    return false;
+  }
+  int index0 = this->GetBufferIndex(i);
+  double q0[4] = { this->Quaternion[0][index0], this->Quaternion[1][index0], this->Quaternion[2][index0], this->Quaternion[3][index0] };
+  if (i == this->Count - 1 || this->Timestamps[index0] == timestamp)
+  {
+    for (int k = 0; k < 3; ++k)
+    {
+      translation[k] = this->Translation[k][index0];
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+      quaternion[k] = q0[k];
+    }
+    return true;
+  }
+
+  int index1 = this->GetBufferIndex(i + 1);
+  double q1[4] = { this->Quaternion[0][index1], this->Quaternion[1][index1], this->Quaternion[2][index1], this->Quaternion[3][index1] };
+  double t = (timestamp - this->Timestamps[index0]) / (this->Timestamps[index1] - this->Timestamps[index0]);
+  for (int k = 0; k < 3; ++k)
+  {
+    translation[k] = (1.0 - t) * this->Translation[k][index0] + t * this->Translation[k][index1];
+  }
+  Slerp(q0, q1, t, quaternion);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLPoseHistory::GetPoseAtTime(double timestamp, vtkMatrix4x4* matrix)
+{
+  if (matrix == NULL)
+  {
+    return false;
+  }
+  double translation[3];
+  double quaternion[4];
+  if (!this->GetPoseAtTime(timestamp, translation, quaternion))
+  {
+    return false;
+  }
+  double rotation[3][3];
+  vtkMath::QuaternionToMatrix3x3(quaternion, rotation);
+  matrix->Identity();
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 3; ++column)
+    {
+      matrix->SetElement(row, column, rotation[row][column]);
+    }
+    matrix->SetElement(row, 3, translation[row]);
+  }
+  return true;
+}
@@ -0,0 +1,100 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLPoseHistory.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLPoseHistory_h
+#define __vtkIGTLPoseHistory_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <vector>
+
+class vtkMatrix4x4;
+
+/// \brief Fixed-capacity history of the poses of one tool.
+///
+/// Poses are kept in a ring buffer as separate arrays of time stamps, translations and
+/// unit quaternions, in increasing time order. The pose at any time between the oldest and
+/// the newest sample is found by binary search and interpolated: linearly for the translation,
+/// by spherical linear interpolation (SLERP) for the rotation. When the buffer is full,
+/// the oldest pose is overwritten.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLPoseHistory : public vtkObject
+{
+public:
+  static vtkIGTLPoseHistory *New();
+  vtkTypeMacro(vtkIGTLPoseHistory, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Maximum number of poses. Changing the capacity clears the history.
+  void SetCapacity(int capacity);
+  vtkGetMacro(Capacity, int);
+
+  /// Remove all poses
+  void Clear();
+
+  int GetNumberOfPoses();
+
+  /// Time stamp of the oldest and the newest pose. 0 if the history is empty.
+  double GetOldestTimestamp();
+  double GetNewestTimestamp();
+
+  /// Add the pose of a rigid transform (scaling is ignored). Poses must be added in time order:
+  /// a pose older than the newest one is rejected (returns false), a pose with the same time stamp
+  /// replaces the newest one.
+  bool AddPose(double timestamp, vtkMatrix4x4* matrix);
+
+  /// Interpolate the pose at the given time. Returns false if the time is outside the history.
+  bool GetPoseAtTime(double timestamp, vtkMatrix4x4* matrix);
+
+#ifndef __VTK_WRAP__
+  /// Add a pose given as translation and unit quaternion (w, x, y, z)
+  bool AddPose(double timestamp, const double translation[3], const double quaternion[4]);
+
+  /// Interpolate the translation and quaternion (w, x, y, z) at the given time
+  bool GetPoseAtTime(double timestamp, double translation[3], double quaternion[4]);
+
+  /// Get the index-th oldest pose (0 is the oldest)
+  bool GetPose(int index, double& timestamp, double translation[3], double quaternion[4]);
+#endif
+
+protected:
+  vtkIGTLPoseHistory();
+  ~vtkIGTLPoseHistory();
+
+  /// Position in the arrays of the i-th oldest pose
+  int GetBufferIndex(int i) const
+    {
+    int index = this->Start + i;
+    return index < this->Capacity ? index : index - this->Capacity;
+    };
+
+  /// Index of the newest pose not newer than the timestamp, -1 if all poses are newer
+  int FindPoseIndex(double timestamp) const;
+
+  int Capacity;
+  int Start;
+  int Count;
+
+  std::vector<double> Timestamps;
+  std::vector<double> Translation[3];
+  std::vector<double> Quaternion[4];
+
+private:
+  vtkIGTLPoseHistory(const vtkIGTLPoseHistory&); // Not implemented
+  void operator=(const vtkIGTLPoseHistory&);     // Not implemented
+};
+
+#endif
@@ -0,0 +1,341 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLPosePredictor.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLPosePredictor.h"
+#include "vtkIGTLPoseHistory.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  // Predictions that are never compared (e.g., the stream stopped) are dropped beyond this count
+  const size_t MaximumNumberOfPendingPredictions = 1000;
+
+  //----------------------------------------------------------------------------
+  // q = a * b for quaternions (w, x, y, z)
+  void MultiplyQuaternion(const double a[4], const double b[4], double q[4])
+  {
+    q[0] = a[0] * b[0] - a[1] * b[1] - a[2] * b[2] - a[3] * b[3];
+    q[1] = a[0] * b[1] + a[1] * b[0] + a[2] * b[3] - a[3] * b[2];
+    q[2] = a[0] * b[2] - a[1] * b[3] + a[2] * b[0] + a[3] * b[1];
+    q[3] = a[0] * b[3] + a[1] * b[2] - a[2] * b[1] + a[3] * b[0];
+  }
+
+  //----------------------------------------------------------------------------
+  // Rotation from unit quaternion q0 to q1 as axis and angle (radians, in [0, pi])
+  void GetRelativeRotation(const double q0[4], const double q1[4], double axis[3], double& angle)
+  {
+    double q0Conjugate[4] = { q0[0], -q0[1], -q0[2], -q0[3] };
+    double q[4];
+    MultiplyQuaternion(q1, q0Conjugate, q);
+    if (q[0] < 0.0)
+    {
+      for (int i = 0; i < 4; ++i)
+      {
+        q[i] = -q[i];
+      }
+    }
+    double sinHalfAngle = sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+    angle = 2.0 * atan2(sinHalfAngle, q[0]);
+    if (sinHalfAngle > 1e-12)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        axis[i] = q[i + 1] / sinHalfAngle;
+      }
+    }
+    else
+    {
+      axis[0] = 1.0;
+      axis[1] = 0.0;
+      axis[2] = 0.0;
+      angle = 0.0;
+    }
+  }
+
+  //----------------------------------------------------------------------------
+  double GetDistance(const double a[3], const double b[3])
+  {
+    return sqrt((a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]));
+  }
+
+  //----------------------------------------------------------------------------
+  double GetAngleDegrees(const double q0[4], const double q1[4])
+  {
+    double axis[3];
+    double angle = 0.0;
+    GetRelativeRotation(q0, q1, axis, angle);
+    return vtkMath::DegreesFromRadians(angle);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLPosePredictor);
+
+//----------------------------------------------------------------------------
+vtkIGTLPosePredictor::vtkIGTLPosePredictor()
+{
+  this->PredictionHorizon = 0.016;
+  this->MaximumLatency = 0.5;
+  this->LastLatency = -1.0;
+  this->VelocityWindow = 0.05;
+  this->MaximumTranslationOffset = 20.0;
+  this->MaximumRotationOffset = 10.0;
+  this->ResetPredictionError();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLPosePredictor::~vtkIGTLPosePredictor()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPosePredictor::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "PredictionHorizon: " << this->PredictionHorizon << " s\n";
+  os << indent << "MaximumLatency: " << this->MaximumLatency << " s\n";
+  os << indent << "LastLatency: " << this->LastLatency << " s\n";
+  os << indent << "VelocityWindow: " << this->VelocityWindow << " s\n";
+  os << indent << "MaximumTranslationOffset: " << this->MaximumTranslationOffset << " mm\n";
+  os << indent << "MaximumRotationOffset: " << this->MaximumRotationOffset << " deg\n";
+  os << indent << "NumberOfErrorSamples: " << this->NumberOfErrorSamples << "\n";
+  os << indent << "TranslationErrorRMS: " << this->GetTranslationErrorRMS()
+     << " mm (without prediction: " << this->GetUncompensatedTranslationErrorRMS() << " mm)\n";
+  os << indent << "RotationErrorRMS: " << this->GetRotationErrorRMS()
+     << " deg (without prediction: " << this->GetUncompensatedRotationErrorRMS() << " deg)\n";
+  os << indent << "MaximumTranslationError: " << this->MaximumTranslationError << " mm\n";
+  os << indent << "MaximumRotationError: " << this->MaximumRotationError << " deg\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPosePredictor::ResetPredictionError()
+{
+  this->PendingPredictions.clear();
+  this->NumberOfErrorSamples = 0;
+  this->SumSquaredTranslationError = 0.0;
+  this->SumSquaredRotationError = 0.0;
+  this->MaximumTranslationError = 0.0;
+  this->MaximumRotationError = 0.0;
+  this->SumSquaredUncompensatedTranslationError = 0.0;
+  this->SumSquaredUncompensatedRotationError = 0.0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLPosePredictor::GetTranslationErrorRMS()
+{
+  return this->NumberOfErrorSamples > 0 ? sqrt(this->SumSquaredTranslationError / this->NumberOfErrorSamples) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLPosePredictor::GetRotationErrorRMS()
+{
+  return this->NumberOfErrorSamples > 0 ? sqrt(this->SumSquaredRotationError / this->NumberOfErrorSamples) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLPosePredictor::GetUncompensatedTranslationErrorRMS()
+{
+  return this->NumberOfErrorSamples > 0 ? sqrt(this->SumSquaredUncompensatedTranslationError / this->NumberOfErrorSamples) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLPosePredictor::GetUncompensatedRotationErrorRMS()
+{
+  return this->NumberOfErrorSamples > 0 ? sqrt(this->SumSquaredUncompensatedRotationError / this->NumberOfErrorSamples) : 0.0;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLPosePredictor::PredictPose(vtkIGTLPoseHistory* history, double extrapolationTime,
+                                       double translation[3], double quaternion[4])
+{
+  int numberOfPoses = history ? history->GetNumberOfPoses() : 0;
+  if (numberOfPoses < 1)
+  {
+    return false;
+  }
+  double newestTimestamp = 0.0;
+  history->GetPose(numberOfPoses - 1, newestTimestamp, translation, quaternion);
+  if (numberOfPoses < 2 || extrapolationTime <= 0.0)
+  {
+    return true;
+  }
+
+  // Least squares fit of the translation over the poses of the window
+  int firstIndex = numberOfPoses - 1;
+  double timestamp = 0.0;
+  double poseTranslation[3];
+  double poseQuaternion[4];
+  double sumT = 0.0;
+  double sumTT = 0.0;
+  double sumP[3] = { 0.0, 0.0, 0.0 };
+  double sumTP[3] = { 0.0, 0.0, 0.0 };
+  int numberOfSamples = 0;
+  for (int i = numberOfPoses - 1; i >= 0; --i)
+  {
+    history->GetPose(i, timestamp, poseTranslation, poseQuaternion);
+    if (i < numberOfPoses - 1 && newestTimestamp - timestamp > this->VelocityWindow)
+    {
+      break;
+    }
+    firstIndex = i;
+    // Relative time keeps the sums well conditioned
+    double t = timestamp - newestTimestamp;
+    sumT += t;
+    sumTT += t * t;
+    for (int k = 0; k < 3; ++k)
+    {
+      sumP[k] += poseTranslation[k];
+      sumTP[k] += t * poseTranslation[k];
+    }
+    numberOfSamples++;
+  }
+  double denominator = numberOfSamples * sumTT - sumT * sumT;
+  if (numberOfSamples < 2 || denominator <= 0.0)
+  {
+    return true;
+  }
+  double offset[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    double velocity = (numberOfSamples * sumTP[k] - sumT * sumP[k]) / denominator;
+    offset[k] = velocity * extrapolationTime;
+  }
+  double offsetLength = sqrt(offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2]);
+  double translationScale = 1.0;
+  if (offsetLength > this->MaximumTranslationOffset)
+  {
+    translationScale = this->MaximumTranslationOffset / offsetLength;
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    translation[k] += translationScale * offset[k];
+  }
+
+  // Constant angular velocity between the oldest and the newest pose of the window
+  double firstTimestamp = 0.0;
+  history->GetPose(firstIndex, firstTimestamp, poseTranslation, poseQuaternion);
+  double axis[3];
+  double angle = 0.0;
+  GetRelativeRotation(poseQuaternion, quaternion, axis, angle);
+  double rotationAngle = angle * extrapolationTime / (newestTimestamp - firstTimestamp);
+  double maximumRotationAngle = vtkMath::RadiansFromDegrees(this->MaximumRotationOffset);
+  if (rotationAngle > maximumRotationAngle)
+  {
+    rotationAngle = maximumRotationAngle;
+  }
+  double rotation[4] = { cos(rotationAngle / 2.0), 0.0, 0.0, 0.0 };
+  for (int k = 0; k < 3; ++k)
+  {
+    rotation[k + 1] = sin(rotationAngle / 2.0) * axis[k];
+  }
+  double newestQuaternion[4] = { quaternion[0], quaternion[1], quaternion[2], quaternion[3] };
+  MultiplyQuaternion(rotation, newestQuaternion, quaternion);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPosePredictor::UpdatePredictionError(vtkIGTLPoseHistory* history)
+{
+  double newestTimestamp = history->GetNewestTimestamp();
+  double translation[3];
+  double quaternion[4];
+  while (!this->PendingPredictions.empty() && this->PendingPredictions.front().Timestamp <= newestTimestamp)
+  {
+    const PendingPrediction& prediction = this->PendingPredictions.front();
+    if (history->GetPoseAtTime(prediction.Timestamp, translation, quaternion))
+    {
+      double translationError = GetDistance(prediction.Translation, translation);
+      double rotationError = GetAngleDegrees(prediction.Quaternion, quaternion);
+      double uncompensatedTranslationError = GetDistance(prediction.NewestTranslation, translation);
+      double uncompensatedRotationError = GetAngleDegrees(prediction.NewestQuaternion, quaternion);
+      this->NumberOfErrorSamples++;
+      this->SumSquaredTranslationError += translationError * translationError;
+      this->SumSquaredRotationError += rotationError * rotationError;
+      this->SumSquaredUncompensatedTranslationError += uncompensatedTranslationError * uncompensatedTranslationError;
+      this->SumSquaredUncompensatedRotationError += uncompensatedRotationError * uncompensatedRotationError;
+      if (translationError > this->MaximumTranslationError)
+      {
+        this->MaximumTranslationError = translationError;
+      }
+      if (rotationError > this->MaximumRotationError)
+      {
+        this->MaximumRotationError = rotationError;
+      }
+    }
+    this->PendingPredictions.pop_front();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLPosePredictor::Update(vtkIGTLPoseHistory* history, double currentTime, vtkMatrix4x4* matrix)
+{
+  if (history == NULL || history->GetNumberOfPoses() < 1)
+  {
+    return false;
+  }
+  this->UpdatePredictionError(history);
+
+  PendingPrediction prediction;
+  history->GetPose(history->GetNumberOfPoses() - 1, prediction.Timestamp, prediction.NewestTranslation, prediction.NewestQuaternion);
+  double latency = currentTime - prediction.Timestamp;
+  this->LastLatency = (latency >= 0.0 && latency <= this->MaximumLatency) ? latency : -1.0;
+  double extrapolationTime = (this->LastLatency > 0.0 ? this->LastLatency : 0.0) + this->PredictionHorizon;
+  prediction.Timestamp += extrapolationTime;
+  this->PredictPose(history, extrapolationTime, prediction.Translation, prediction.Quaternion);
+  if (extrapolationTime > 0.0)
+  {
+    if (this->PendingPredictions.size() >= MaximumNumberOfPendingPredictions)
+    {
+      this->PendingPredictions.pop_front();
+    }
+    this->PendingPredictions.push_back(prediction);
+  }
+
+  if (matrix)
+  {
+    // Rotate the received linear part by the predicted rotation, which keeps its scaling and shear
+    double newestConjugate[4] = { prediction.NewestQuaternion[0], -prediction.NewestQuaternion[1],
+                                  -prediction.NewestQuaternion[2], -prediction.NewestQuaternion[3] };
+    double deltaQuaternion[4];
+    MultiplyQuaternion(prediction.Quaternion, newestConjugate, deltaQuaternion);
+    double deltaRotation[3][3];
+    vtkMath::QuaternionToMatrix3x3(deltaQuaternion, deltaRotation);
+    double linear[3][3];
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        linear[row][column] = matrix->GetElement(row, column);
+      }
+    }
+    double predictedLinear[3][3];
+    vtkMath::Multiply3x3(deltaRotation, linear, predictedLinear);
+    for (int row = 0; row < 3; ++row)
+    {
+      for (int column = 0; column < 3; ++column)
+      {
+        matrix->SetElement(row, column, predictedLinear[row][column]);
+      }
+      matrix->SetElement(row, 3, prediction.Translation[row]);
+    }
+  }
+  return true;
+}
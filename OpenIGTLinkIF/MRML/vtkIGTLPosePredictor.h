@@ -0,0 +1,137 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLPosePredictor.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLPosePredictor_h
+#define __vtkIGTLPosePredictor_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <deque>
+
+class vtkIGTLPoseHistory;
+class vtkMatrix4x4;
+
+/// \brief Extrapolates the pose of a tool to compensate the tracking latency.
+///
+/// The linear velocity is the least squares fit of the translations within VelocityWindow
+/// before the newest pose, the angular velocity is the rotation between the oldest and the newest
+/// pose of the window. The newest pose is extrapolated by its measured latency (the time from its
+/// time stamp to the update) plus PredictionHorizon, limited by MaximumTranslationOffset and
+/// MaximumRotationOffset. A latency outside [0, MaximumLatency] means that the clocks of the
+/// tracker and of this computer are not synchronized: it is ignored and only PredictionHorizon is used.
+///
+/// Each prediction is compared with the pose actually received at the predicted time.
+/// The errors are reported next to the errors without prediction (showing the newest pose),
+/// so that the horizon and the clamping can be tuned.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLPosePredictor : public vtkObject
+{
+public:
+  static vtkIGTLPosePredictor *New();
+  vtkTypeMacro(vtkIGTLPosePredictor, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Time from the update of the transform to its display (rendering), added to the measured latency, in seconds
+  vtkGetMacro(PredictionHorizon, double);
+  vtkSetClampMacro(PredictionHorizon, double, 0.0, 1.0);
+
+  /// Largest latency considered valid, in seconds
+  vtkGetMacro(MaximumLatency, double);
+  vtkSetClampMacro(MaximumLatency, double, 0.0, 10.0);
+
+  /// Latency of the newest pose measured by the last Update, -1 if it was not valid
+  vtkGetMacro(LastLatency, double);
+
+  /// Poses within this time before the newest pose are used to estimate the velocity, in seconds
+  vtkGetMacro(VelocityWindow, double);
+  vtkSetClampMacro(VelocityWindow, double, 0.001, 1.0);
+
+  /// Maximum distance between the predicted and the newest position, in mm
+  vtkGetMacro(MaximumTranslationOffset, double);
+  vtkSetClampMacro(MaximumTranslationOffset, double, 0.0, 1000.0);
+
+  /// Maximum rotation between the predicted and the newest orientation, in degrees
+  vtkGetMacro(MaximumRotationOffset, double);
+  vtkSetClampMacro(MaximumRotationOffset, double, 0.0, 180.0);
+
+  /// Predict the pose at currentTime + PredictionHorizon and update the prediction error statistics
+  /// with the poses received since the last call. currentTime is in the time base of the history.
+  /// On input, matrix is the newest pose of the history as received: the predicted rotation
+  /// and translation are applied to it, so that its scaling and shear are kept.
+  /// Returns false if the history is empty.
+  bool Update(vtkIGTLPoseHistory* history, double currentTime, vtkMatrix4x4* matrix);
+
+  /// Number of predictions compared with a received pose
+  vtkGetMacro(NumberOfErrorSamples, int);
+
+  /// Root mean square and maximum error of the predicted pose (mm and degrees)
+  double GetTranslationErrorRMS();
+  double GetRotationErrorRMS();
+  vtkGetMacro(MaximumTranslationError, double);
+  vtkGetMacro(MaximumRotationError, double);
+
+  /// Root mean square error without prediction, when the newest pose is shown (mm and degrees)
+  double GetUncompensatedTranslationErrorRMS();
+  double GetUncompensatedRotationErrorRMS();
+
+  /// Reset the error statistics
+  void ResetPredictionError();
+
+#ifndef __VTK_WRAP__
+  /// Extrapolate the newest pose of the history by the given time.
+  /// Returns false if the history is empty.
+  bool PredictPose(vtkIGTLPoseHistory* history, double extrapolationTime, double translation[3], double quaternion[4]);
+#endif
+
+protected:
+  vtkIGTLPosePredictor();
+  ~vtkIGTLPosePredictor();
+
+  struct PendingPrediction
+  {
+    double Timestamp;
+    double Translation[3];
+    double Quaternion[4];
+    double NewestTranslation[3];
+    double NewestQuaternion[4];
+  };
+
+  /// Compare the predictions with the received poses
+  void UpdatePredictionError(vtkIGTLPoseHistory* history);
+
+  double PredictionHorizon;
+  double MaximumLatency;
+  double LastLatency;
+  double VelocityWindow;
+  double MaximumTranslationOffset;
+  double MaximumRotationOffset;
+
+  std::deque<PendingPrediction> PendingPredictions;
+
+  int NumberOfErrorSamples;
+  double SumSquaredTranslationError;
+  double SumSquaredRotationError;
+  double MaximumTranslationError;
+  double MaximumRotationError;
+  double SumSquaredUncompensatedTranslationError;
+  double SumSquaredUncompensatedRotationError;
+
+private:
+  vtkIGTLPosePredictor(const vtkIGTLPosePredictor&); // Not implemented
+  void operator=(const vtkIGTLPosePredictor&);       // Not implemented
+};
+
+#endif
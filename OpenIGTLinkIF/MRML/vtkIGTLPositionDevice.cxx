@@ -0,0 +1,144 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLPositionDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLPositionDevice.h"
+#include "vtkIGTLMatrixConverter.h"
+
+// OpenIGTLink includes
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLPositionDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLPositionDevice::vtkIGTLPositionDevice()
+{
+  vtkMatrix4x4::Identity(this->Matrix);
+  this->OutMessage = igtl::PositionMessage::New();
+  this->OutMessage->SetPackType(igtl::PositionMessage::ALL);
+  this->InMessage = igtl::PositionMessage::New();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLPositionDevice::~vtkIGTLPositionDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPositionDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Position: " << this->Matrix[3] << " " << this->Matrix[7] << " " << this->Matrix[11] << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkIGTLPositionDevice::GetDeviceContentModifiedEvent() const
+{
+  return PositionModifiedEvent;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLPositionDevice::GetDeviceType() const
+{
+  return vtkIGTLPositionDevice::GetIGTLTypeName();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLPositionDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  this->InMessage->SetMessageHeader(buffer);
+  this->InMessage->AllocateBuffer();
+  memcpy(this->InMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->InMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack POSITION message " << this->GetDeviceName());
+    return 0;
+  }
+
+  // Messages without orientation (pack type POSITION_ONLY) unpack an identity quaternion
+  float position[3];
+  float quaternion[4];
+  this->InMessage->GetPosition(position);
+  this->InMessage->GetQuaternion(quaternion);
+  vtkIGTLMatrixConverter::PositionQuaternionToMatrix(position, quaternion, this->Matrix);
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->InMessage->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(PositionModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLPositionDevice::GetIGTLMessage()
+{
+  float position[3];
+  float quaternion[4];
+  vtkIGTLMatrixConverter::MatrixToPositionQuaternion(this->Matrix, position, quaternion);
+  this->OutMessage->SetPosition(position);
+  this->OutMessage->SetQuaternion(quaternion);
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->GetTime();
+  this->OutMessage->SetDeviceName(this->GetDeviceName().c_str());
+  this->OutMessage->SetTimeStamp(timestamp);
+  this->OutMessage->Pack();
+  return igtl::MessageBase::Pointer(this->OutMessage.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLPositionDevice::GetIGTLMessage(MESSAGE_PREFIX prefix)
+{
+  if (prefix == MESSAGE_PREFIX_NOT_DEFINED)
+  {
+    return this->GetIGTLMessage();
+  }
+  return igtl::MessageBase::Pointer();
+}
+
+//----------------------------------------------------------------------------
+std::set<igtlio::Device::MESSAGE_PREFIX> vtkIGTLPositionDevice::GetSupportedMessagePrefixes() const
+{
+  std::set<MESSAGE_PREFIX> retval;
+  retval.insert(MESSAGE_PREFIX_NOT_DEFINED);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPositionDevice::SetMatrix(vtkMatrix4x4* matrix)
+{
+  if (matrix == NULL)
+  {
+    return;
+  }
+  memcpy(this->Matrix, &matrix->Element[0][0], sizeof(this->Matrix));
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLPositionDevice::GetMatrix(vtkMatrix4x4* matrix)
+{
+  if (matrix == NULL)
+  {
+    return;
+  }
+  matrix->DeepCopy(this->Matrix);
+}
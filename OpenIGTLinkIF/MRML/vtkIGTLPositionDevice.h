@@ -0,0 +1,76 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLPositionDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLPositionDevice_h
+#define __vtkIGTLPositionDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioDevice.h"
+
+// OpenIGTLink includes
+#include <igtlPositionMessage.h>
+
+class vtkMatrix4x4;
+
+/// \brief OpenIGTLinkIO device for the POSITION message type.
+///
+/// A POSITION message carries a position and a quaternion (28 bytes) instead of the
+/// 48 bytes of a TRANSFORM matrix. The content is kept as a row-major 4x4 matrix so that
+/// the device can be used in place of a TRANSFORM device for linear transform nodes.
+/// Rigid transforms only: scaling of outgoing matrices is not transmitted.
+/// The OpenIGTLinkIO device factory does not know this message type, so a receiver
+/// must add the device before the first message arrives
+/// (see vtkMRMLIGTLConnectorNode::CreateDeviceForIncomingMessage).
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLPositionDevice : public igtlio::Device
+{
+public:
+  enum
+  {
+    PositionModifiedEvent = 118993,
+  };
+
+  static vtkIGTLPositionDevice *New();
+  vtkTypeMacro(vtkIGTLPositionDevice, igtlio::Device);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static const char* GetIGTLTypeName() { return "POSITION"; };
+
+  virtual unsigned int GetDeviceContentModifiedEvent() const VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage() VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage(MESSAGE_PREFIX prefix) VTK_OVERRIDE;
+  virtual std::set<MESSAGE_PREFIX> GetSupportedMessagePrefixes() const VTK_OVERRIDE;
+
+  /// Pose to send, or the last received pose
+  void SetMatrix(vtkMatrix4x4* matrix);
+  void GetMatrix(vtkMatrix4x4* matrix);
+
+protected:
+  vtkIGTLPositionDevice();
+  ~vtkIGTLPositionDevice();
+
+  // Row-major 4x4 matrix
+  double Matrix[16];
+
+  igtl::PositionMessage::Pointer OutMessage;
+  igtl::PositionMessage::Pointer InMessage;
+
+private:
+  vtkIGTLPositionDevice(const vtkIGTLPositionDevice&); // Not implemented
+  void operator=(const vtkIGTLPositionDevice&);       // Not implemented
+};
+
+#endif
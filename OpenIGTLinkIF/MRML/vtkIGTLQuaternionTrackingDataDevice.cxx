@@ -0,0 +1,208 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLQuaternionTrackingDataDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLQuaternionTrackingDataDevice.h"
+#include "vtkIGTLMatrixConverter.h"
+
+// OpenIGTLink includes
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLQuaternionTrackingDataDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLQuaternionTrackingDataDevice::vtkIGTLQuaternionTrackingDataDevice()
+{
+  this->QuaternionOutMessage = igtl::QuaternionTrackingDataMessage::New();
+  this->QuaternionInMessage = igtl::QuaternionTrackingDataMessage::New();
+  this->QuaternionStartMessage = igtl::StartQuaternionTrackingDataMessage::New();
+  this->QuaternionStopMessage = igtl::StopQuaternionTrackingDataMessage::New();
+  this->QuaternionResponseMessage = igtl::RTSQuaternionTrackingDataMessage::New();
+  this->QuaternionStartRequestMessage = igtl::StartQuaternionTrackingDataMessage::New();
+  this->QuaternionRequestResponseMessage = igtl::RTSQuaternionTrackingDataMessage::New();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLQuaternionTrackingDataDevice::~vtkIGTLQuaternionTrackingDataDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQuaternionTrackingDataDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLQuaternionTrackingDataDevice::GetDeviceType() const
+{
+  return vtkIGTLQuaternionTrackingDataDevice::GetIGTLTypeName();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLQuaternionTrackingDataDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  if (strcmp(buffer->GetDeviceType(), "RTS_QTDATA") == 0)
+  {
+    this->QuaternionResponseMessage->SetMessageHeader(buffer);
+    this->QuaternionResponseMessage->AllocateBuffer();
+    memcpy(this->QuaternionResponseMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+    if (!(this->QuaternionResponseMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+    {
+      vtkErrorMacro("ReceiveIGTLMessage: failed to unpack RTS_QTDATA message " << this->GetDeviceName());
+      return 0;
+    }
+    this->ResponseStatus = this->QuaternionResponseMessage->GetStatus();
+    this->InvokeEvent(TrackingDataResponseEvent, this);
+    return 1;
+  }
+  if (strcmp(buffer->GetDeviceType(), "STT_QTDATA") == 0)
+  {
+    this->QuaternionStartRequestMessage->SetMessageHeader(buffer);
+    this->QuaternionStartRequestMessage->AllocateBuffer();
+    memcpy(this->QuaternionStartRequestMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+    if (!(this->QuaternionStartRequestMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+    {
+      vtkErrorMacro("ReceiveIGTLMessage: failed to unpack STT_QTDATA message " << this->GetDeviceName());
+      return 0;
+    }
+    this->RequestedResolution = this->QuaternionStartRequestMessage->GetResolution();
+    this->RequestedCoordinateName = this->QuaternionStartRequestMessage->GetCoordinateName();
+    this->InvokeEvent(StartStreamingRequestEvent, this);
+    return 1;
+  }
+  if (strcmp(buffer->GetDeviceType(), "STP_QTDATA") == 0)
+  {
+    this->InvokeEvent(StopStreamingRequestEvent, this);
+    return 1;
+  }
+
+  this->QuaternionInMessage->SetMessageHeader(buffer);
+  this->QuaternionInMessage->AllocateBuffer();
+  memcpy(this->QuaternionInMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->QuaternionInMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack QTDATA message " << this->GetDeviceName());
+    return 0;
+  }
+
+  int numberOfTools = this->QuaternionInMessage->GetNumberOfQuaternionTrackingDataElements();
+  this->ToolNames.resize(numberOfTools);
+  this->ToolTypes.resize(numberOfTools);
+  this->ToolMatrices.resize(16 * numberOfTools);
+  igtl::QuaternionTrackingDataElement::Pointer element;
+  float position[3];
+  float quaternion[4];
+  for (int i = 0; i < numberOfTools; ++i)
+  {
+    this->QuaternionInMessage->GetQuaternionTrackingDataElement(i, element);
+    this->ToolNames[i] = element->GetName();
+    this->ToolTypes[i] = element->GetType();
+    element->GetPosition(position);
+    element->GetQuaternion(quaternion);
+    vtkIGTLMatrixConverter::PositionQuaternionToMatrix(position, quaternion, &this->ToolMatrices[16 * i]);
+  }
+  this->UpdateToolNamePointers();
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->QuaternionInMessage->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(TrackingDataModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLQuaternionTrackingDataDevice::GetIGTLMessage()
+{
+  this->QuaternionOutMessage->ClearQuaternionTrackingDataElements();
+  float position[3];
+  float quaternion[4];
+  for (size_t i = 0; i < this->ToolNames.size(); ++i)
+  {
+    igtl::QuaternionTrackingDataElement::Pointer element = igtl::QuaternionTrackingDataElement::New();
+    element->SetName(this->ToolNames[i].c_str());
+    element->SetType(static_cast<igtlUint8>(this->ToolTypes[i]));
+    vtkIGTLMatrixConverter::MatrixToPositionQuaternion(&this->ToolMatrices[16 * i], position, quaternion);
+    element->SetPosition(position);
+    element->SetQuaternion(quaternion);
+    this->QuaternionOutMessage->AddQuaternionTrackingDataElement(element);
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->GetTime();
+  this->QuaternionOutMessage->SetDeviceName(this->GetDeviceName().c_str());
+  this->QuaternionOutMessage->SetTimeStamp(timestamp);
+  this->QuaternionOutMessage->Pack();
+  return igtl::MessageBase::Pointer(this->QuaternionOutMessage.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLQuaternionTrackingDataDevice::GetIGTLMessage(MESSAGE_PREFIX prefix)
+{
+  if (prefix == MESSAGE_PREFIX_NOT_DEFINED)
+  {
+    return this->GetIGTLMessage();
+  }
+  if (prefix == MESSAGE_PREFIX_START)
+  {
+    this->ResponseStatus = -1;
+    this->QuaternionStartMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->QuaternionStartMessage->SetResolution(static_cast<igtlInt32>(this->Resolution));
+    this->QuaternionStartMessage->SetCoordinateName(this->CoordinateName.c_str());
+    this->QuaternionStartMessage->Pack();
+    return igtl::MessageBase::Pointer(this->QuaternionStartMessage.GetPointer());
+  }
+  if (prefix == MESSAGE_PREFIX_STOP)
+  {
+    this->ResponseStatus = -1;
+    this->QuaternionStopMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->QuaternionStopMessage->Pack();
+    return igtl::MessageBase::Pointer(this->QuaternionStopMessage.GetPointer());
+  }
+  if (prefix == MESSAGE_PREFIX_RTS)
+  {
+    this->QuaternionRequestResponseMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->QuaternionRequestResponseMessage->SetStatus(static_cast<igtlUint8>(this->RequestResponseStatus));
+    this->QuaternionRequestResponseMessage->Pack();
+    return igtl::MessageBase::Pointer(this->QuaternionRequestResponseMessage.GetPointer());
+  }
+  return igtl::MessageBase::Pointer();
+}
+
+//----------------------------------------------------------------------------
+// vtkIGTLQuaternionTrackingDataDeviceCreator
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLQuaternionTrackingDataDeviceCreator);
+
+//----------------------------------------------------------------------------
+igtlio::DevicePointer vtkIGTLQuaternionTrackingDataDeviceCreator::Create(std::string device_name)
+{
+  vtkSmartPointer<vtkIGTLQuaternionTrackingDataDevice> retval = vtkSmartPointer<vtkIGTLQuaternionTrackingDataDevice>::New();
+  retval->SetDeviceName(device_name);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLQuaternionTrackingDataDeviceCreator::GetDeviceType() const
+{
+  return vtkIGTLQuaternionTrackingDataDevice::GetIGTLTypeName();
+}
@@ -0,0 +1,79 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLQuaternionTrackingDataDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLQuaternionTrackingDataDevice_h
+#define __vtkIGTLQuaternionTrackingDataDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLTrackingDataDevice.h"
+
+// OpenIGTLink includes
+#include <igtlQuaternionTrackingDataMessage.h>
+
+/// \brief OpenIGTLinkIO device for the QTDATA message type.
+///
+/// QTDATA carries the same tool list as TDATA, but each tool pose is a position and
+/// a quaternion (28 bytes instead of 48), which reduces the bandwidth of high-rate
+/// tracking of many tools. The content is stored as matrices, as in vtkIGTLTrackingDataDevice,
+/// so that the device can update a tracking data bundle the same way.
+/// Rigid transforms only: scaling of outgoing matrices is not transmitted.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLQuaternionTrackingDataDevice : public vtkIGTLTrackingDataDevice
+{
+public:
+  static vtkIGTLQuaternionTrackingDataDevice *New();
+  vtkTypeMacro(vtkIGTLQuaternionTrackingDataDevice, vtkIGTLTrackingDataDevice);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static const char* GetIGTLTypeName() { return "QTDATA"; };
+
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage() VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage(MESSAGE_PREFIX prefix) VTK_OVERRIDE;
+
+protected:
+  vtkIGTLQuaternionTrackingDataDevice();
+  ~vtkIGTLQuaternionTrackingDataDevice();
+
+  igtl::QuaternionTrackingDataMessage::Pointer QuaternionOutMessage;
+  igtl::QuaternionTrackingDataMessage::Pointer QuaternionInMessage;
+  igtl::StartQuaternionTrackingDataMessage::Pointer QuaternionStartMessage;
+  igtl::StopQuaternionTrackingDataMessage::Pointer QuaternionStopMessage;
+  igtl::RTSQuaternionTrackingDataMessage::Pointer QuaternionResponseMessage;
+  igtl::StartQuaternionTrackingDataMessage::Pointer QuaternionStartRequestMessage;
+  igtl::RTSQuaternionTrackingDataMessage::Pointer QuaternionRequestResponseMessage;
+
+private:
+  vtkIGTLQuaternionTrackingDataDevice(const vtkIGTLQuaternionTrackingDataDevice&); // Not implemented
+  void operator=(const vtkIGTLQuaternionTrackingDataDevice&);                     // Not implemented
+};
+
+/// \brief Creator of vtkIGTLQuaternionTrackingDataDevice, adds QTDATA to an igtlio::DeviceFactory.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLQuaternionTrackingDataDeviceCreator : public igtlio::DeviceCreator
+{
+public:
+  static vtkIGTLQuaternionTrackingDataDeviceCreator *New();
+  vtkTypeMacro(vtkIGTLQuaternionTrackingDataDeviceCreator, igtlio::DeviceCreator);
+
+  virtual igtlio::DevicePointer Create(std::string device_name) VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+
+protected:
+  vtkIGTLQuaternionTrackingDataDeviceCreator() {};
+  ~vtkIGTLQuaternionTrackingDataDeviceCreator() {};
+
+private:
+  vtkIGTLQuaternionTrackingDataDeviceCreator(const vtkIGTLQuaternionTrackingDataDeviceCreator&); // Not implemented
+  void operator=(const vtkIGTLQuaternionTrackingDataDeviceCreator&);                             // Not implemented
+};
+
+#endif
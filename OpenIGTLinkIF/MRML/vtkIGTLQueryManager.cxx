@@ -0,0 +1,378 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLQueryManager.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLQueryManager.h"
+#include "vtkMRMLIGTLQueryNode.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  // Number of slots of the timer wheel, power of two
+  const int NumberOfWheelSlots = 256;
+  // Initial number of hash buckets, power of two
+  const int MinimumNumberOfHashBuckets = 64;
+
+  //----------------------------------------------------------------------------
+  bool IsStreamControlQuery(vtkMRMLIGTLQueryNode* query)
+  {
+    return query->GetQueryType() == vtkMRMLIGTLQueryNode::TYPE_START
+      || query->GetQueryType() == vtkMRMLIGTLQueryNode::TYPE_STOP;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLQueryManager);
+
+//----------------------------------------------------------------------------
+vtkIGTLQueryManager::vtkIGTLQueryManager()
+{
+  this->TickInterval = 0.01;
+  this->CurrentTick = -1;
+  this->HashBuckets.resize(MinimumNumberOfHashBuckets, -1);
+  this->WheelSlots.resize(NumberOfWheelSlots, -1);
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLQueryManager::~vtkIGTLQueryManager()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "TickInterval: " << this->TickInterval << " s\n";
+  os << indent << "NumberOfQueries: " << this->QueryToEntry.size() << "\n";
+  os << indent << "NumberOfHashBuckets: " << this->HashBuckets.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::SetTickInterval(double interval)
+{
+  if (interval <= 0.0 || interval == this->TickInterval)
+  {
+    return;
+  }
+  if (!this->QueryToEntry.empty())
+  {
+    vtkErrorMacro("SetTickInterval failed: queries are waiting");
+    return;
+  }
+  this->TickInterval = interval;
+  this->CurrentTick = -1;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkIGTLQueryManager::HashKey(const std::string& type, const std::string& deviceName)
+{
+  // FNV-1a of the type and the device name, separated by a null character
+  unsigned int hash = 2166136261u;
+  for (std::string::const_iterator c = type.begin(); c != type.end(); ++c)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+  }
+  hash *= 16777619u;
+  for (std::string::const_iterator c = deviceName.begin(); c != deviceName.end(); ++c)
+  {
+    hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+  }
+  return hash;
+}
+
+//----------------------------------------------------------------------------
+vtkTypeInt64 vtkIGTLQueryManager::GetTick(double time)
+{
+  return static_cast<vtkTypeInt64>(std::floor(time / this->TickInterval));
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLQueryManager::AllocateEntry()
+{
+  if (!this->FreeEntries.empty())
+  {
+    int index = this->FreeEntries.back();
+    this->FreeEntries.pop_back();
+    return index;
+  }
+  this->Entries.push_back(EntryType());
+  return static_cast<int>(this->Entries.size()) - 1;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::ReleaseEntry(int index)
+{
+  EntryType& entry = this->Entries[index];
+  entry.Query = NULL;
+  entry.QueryKey = NULL;
+  entry.Type.clear();
+  entry.DeviceName.clear();
+  this->FreeEntries.push_back(index);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::LinkEntry(int index)
+{
+  EntryType& entry = this->Entries[index];
+
+  int bucket = static_cast<int>(entry.Hash & (this->HashBuckets.size() - 1));
+  entry.HashPrevious = -1;
+  entry.HashNext = this->HashBuckets[bucket];
+  if (entry.HashNext >= 0)
+  {
+    this->Entries[entry.HashNext].HashPrevious = index;
+  }
+  this->HashBuckets[bucket] = index;
+
+  entry.WheelPrevious = -1;
+  entry.WheelNext = -1;
+  if (entry.ExpiryTick < 0)
+  {
+    return;
+  }
+  int slot = static_cast<int>(entry.ExpiryTick & (NumberOfWheelSlots - 1));
+  entry.WheelNext = this->WheelSlots[slot];
+  if (entry.WheelNext >= 0)
+  {
+    this->Entries[entry.WheelNext].WheelPrevious = index;
+  }
+  this->WheelSlots[slot] = index;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::UnlinkEntry(int index)
+{
+  EntryType& entry = this->Entries[index];
+
+  if (entry.HashPrevious >= 0)
+  {
+    this->Entries[entry.HashPrevious].HashNext = entry.HashNext;
+  }
+  else
+  {
+    this->HashBuckets[entry.Hash & (this->HashBuckets.size() - 1)] = entry.HashNext;
+  }
+  if (entry.HashNext >= 0)
+  {
+    this->Entries[entry.HashNext].HashPrevious = entry.HashPrevious;
+  }
+
+  if (entry.ExpiryTick < 0)
+  {
+    return;
+  }
+  if (entry.WheelPrevious >= 0)
+  {
+    this->Entries[entry.WheelPrevious].WheelNext = entry.WheelNext;
+  }
+  else
+  {
+    this->WheelSlots[entry.ExpiryTick & (NumberOfWheelSlots - 1)] = entry.WheelNext;
+  }
+  if (entry.WheelNext >= 0)
+  {
+    this->Entries[entry.WheelNext].WheelPrevious = entry.WheelPrevious;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::RemoveEntry(int index)
+{
+  this->QueryToEntry.erase(this->Entries[index].QueryKey);
+  this->UnlinkEntry(index);
+  this->ReleaseEntry(index);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::AddQuery(vtkMRMLIGTLQueryNode* query)
+{
+  if (query == NULL)
+  {
+    return;
+  }
+
+  int index = -1;
+  std::map<vtkMRMLIGTLQueryNode*, int>::iterator queryIter = this->QueryToEntry.find(query);
+  if (queryIter != this->QueryToEntry.end())
+  {
+    index = queryIter->second;
+    this->UnlinkEntry(index);
+  }
+  else
+  {
+    index = this->AllocateEntry();
+    this->QueryToEntry[query] = index;
+  }
+
+  EntryType& entry = this->Entries[index];
+  entry.Query = query;
+  entry.QueryKey = query;
+  entry.Type = query->GetIGTLName();
+  entry.DeviceName = query->GetIGTLDeviceName();
+  entry.Hash = HashKey(entry.Type, entry.DeviceName);
+  entry.ExpiryTick = -1;
+  if (query->GetTimeOut() > 0.0)
+  {
+    // Round up, a query never expires early
+    entry.ExpiryTick = static_cast<vtkTypeInt64>(
+      std::ceil((query->GetTimeStamp() + query->GetTimeOut()) / this->TickInterval));
+    if (entry.ExpiryTick <= this->CurrentTick)
+    {
+      // Already expired, expire it at the next tick
+      entry.ExpiryTick = this->CurrentTick + 1;
+    }
+  }
+  this->LinkEntry(index);
+
+  // Keep the load factor of the hash table at most 1
+  if (this->QueryToEntry.size() > this->HashBuckets.size())
+  {
+    std::vector<int> entries;
+    for (queryIter = this->QueryToEntry.begin(); queryIter != this->QueryToEntry.end(); ++queryIter)
+    {
+      this->UnlinkEntry(queryIter->second);
+      entries.push_back(queryIter->second);
+    }
+    this->HashBuckets.assign(this->HashBuckets.size() * 2, -1);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+      this->LinkEntry(entries[i]);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLQueryManager::RemoveQuery(vtkMRMLIGTLQueryNode* query)
+{
+  std::map<vtkMRMLIGTLQueryNode*, int>::iterator queryIter = this->QueryToEntry.find(query);
+  if (queryIter == this->QueryToEntry.end())
+  {
+    return false;
+  }
+  this->RemoveEntry(queryIter->second);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLQueryManager::HasQuery(vtkMRMLIGTLQueryNode* query)
+{
+  return this->QueryToEntry.find(query) != this->QueryToEntry.end();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLQueryManager::GetNumberOfQueries()
+{
+  return static_cast<int>(this->QueryToEntry.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::RemoveAllQueries()
+{
+  this->Entries.clear();
+  this->FreeEntries.clear();
+  this->QueryToEntry.clear();
+  this->HashBuckets.assign(MinimumNumberOfHashBuckets, -1);
+  this->WheelSlots.assign(NumberOfWheelSlots, -1);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::PopMatchingQueries(const std::string& type, const std::string& deviceName, bool streamControl,
+                                             QueryListType& queries)
+{
+  // Queries of the device name, then queries of any device name of the type
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    std::string name = (pass == 0) ? deviceName : std::string();
+    if (pass == 1 && deviceName.empty())
+    {
+      break;
+    }
+    unsigned int hash = HashKey(type, name);
+    int index = this->HashBuckets[hash & (this->HashBuckets.size() - 1)];
+    while (index >= 0)
+    {
+      EntryType& entry = this->Entries[index];
+      int next = entry.HashNext;
+      vtkMRMLIGTLQueryNode* query = entry.Query;
+      if (query == NULL)
+      {
+        // The query node was deleted without being cancelled
+        this->RemoveEntry(index);
+      }
+      else if (entry.Hash == hash && entry.Type == type && entry.DeviceName == name
+        && IsStreamControlQuery(query) == streamControl)
+      {
+        queries.push_back(query);
+        this->RemoveEntry(index);
+      }
+      index = next;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::PopExpiredQueries(double currentTime, QueryListType& queries)
+{
+  vtkTypeInt64 tick = this->GetTick(currentTime);
+  if (tick <= this->CurrentTick)
+  {
+    return;
+  }
+  // Visit the slots of the ticks since the last call, each slot at most once
+  vtkTypeInt64 firstTick = this->CurrentTick + 1;
+  if (this->CurrentTick < 0 || tick - firstTick >= NumberOfWheelSlots)
+  {
+    firstTick = tick - NumberOfWheelSlots + 1;
+  }
+  this->CurrentTick = tick;
+
+  for (vtkTypeInt64 slotTick = firstTick; slotTick <= tick; ++slotTick)
+  {
+    int index = this->WheelSlots[slotTick & (NumberOfWheelSlots - 1)];
+    while (index >= 0)
+    {
+      EntryType& entry = this->Entries[index];
+      int next = entry.WheelNext;
+      // Entries that expire after more turns of the wheel stay in the slot
+      if (entry.ExpiryTick <= tick)
+      {
+        vtkMRMLIGTLQueryNode* query = entry.Query;
+        if (query)
+        {
+          queries.push_back(query);
+        }
+        this->RemoveEntry(index);
+      }
+      index = next;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLQueryManager::GetQueries(QueryListType& queries)
+{
+  for (std::map<vtkMRMLIGTLQueryNode*, int>::iterator queryIter = this->QueryToEntry.begin();
+       queryIter != this->QueryToEntry.end(); ++queryIter)
+  {
+    vtkMRMLIGTLQueryNode* query = this->Entries[queryIter->second].Query;
+    if (query)
+    {
+      queries.push_back(query);
+    }
+  }
+}
@@ -0,0 +1,126 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLQueryManager.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLQueryManager_h
+#define __vtkIGTLQueryManager_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkMRMLIGTLQueryNode;
+
+/// \brief Queries waiting for a response, indexed for expiry and for response matching.
+///
+/// Expiry uses a hashed timer wheel: a query is put in the slot of its expiry tick, and each
+/// tick visits one slot, so adding, removing and expiring a query take constant time whatever
+/// the number of waiting queries. Queries with no timeout (TimeOut <= 0) never expire.
+/// Responses are matched through a hash of (message type, device name); a query without
+/// device name matches any device name of its type.
+/// The manager is not thread safe, vtkMRMLIGTLConnectorNode locks its QueryQueueMutex around it.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLQueryManager : public vtkObject
+{
+public:
+  static vtkIGTLQueryManager *New();
+  vtkTypeMacro(vtkIGTLQueryManager, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  typedef std::vector< vtkSmartPointer<vtkMRMLIGTLQueryNode> > QueryListType;
+
+  /// Duration of one tick of the timer wheel in seconds (default 0.01).
+  /// Queries expire at most one tick late. Can only be changed when no query is waiting.
+  vtkGetMacro(TickInterval, double);
+  void SetTickInterval(double interval);
+
+  /// Add a query, or update its expiry time if it is already waiting.
+  /// The query expires TimeOut seconds after its TimeStamp.
+  void AddQuery(vtkMRMLIGTLQueryNode* query);
+
+  /// Remove a query. Returns false if the query was not waiting.
+  bool RemoveQuery(vtkMRMLIGTLQueryNode* query);
+
+  bool HasQuery(vtkMRMLIGTLQueryNode* query);
+  int GetNumberOfQueries();
+
+  /// Remove all queries
+  void RemoveAllQueries();
+
+#ifndef __VTK_WRAP__
+  /// Remove the waiting queries of the given message type and device name, and the
+  /// queries of the given type without device name, and append them to queries.
+  /// If streamControl is true only START and STOP queries are matched, otherwise only the other queries.
+  void PopMatchingQueries(const std::string& type, const std::string& deviceName, bool streamControl,
+                          QueryListType& queries);
+
+  /// Remove the queries whose timeout elapsed at currentTime and append them to queries
+  void PopExpiredQueries(double currentTime, QueryListType& queries);
+
+  /// All waiting queries
+  void GetQueries(QueryListType& queries);
+#endif
+
+protected:
+  vtkIGTLQueryManager();
+  ~vtkIGTLQueryManager();
+
+  struct EntryType
+  {
+    vtkWeakPointer<vtkMRMLIGTLQueryNode> Query;
+    // Key in QueryToEntry, remains valid when the query node is deleted
+    vtkMRMLIGTLQueryNode* QueryKey;
+    std::string Type;
+    std::string DeviceName;
+    unsigned int Hash;
+    // Tick of expiry, -1 if the query does not expire
+    vtkTypeInt64 ExpiryTick;
+    // Doubly linked lists of entry indices, -1 terminated
+    int HashPrevious;
+    int HashNext;
+    int WheelPrevious;
+    int WheelNext;
+  };
+
+  static unsigned int HashKey(const std::string& type, const std::string& deviceName);
+  vtkTypeInt64 GetTick(double time);
+
+  int AllocateEntry();
+  void ReleaseEntry(int index);
+  void LinkEntry(int index);
+  void UnlinkEntry(int index);
+  void RemoveEntry(int index);
+
+  double TickInterval;
+  // Last tick processed by PopExpiredQueries, -1 before the first call
+  vtkTypeInt64 CurrentTick;
+
+  std::vector<EntryType> Entries;
+  std::vector<int> FreeEntries;
+  // Heads of the hash buckets and of the wheel slots (power of two sizes)
+  std::vector<int> HashBuckets;
+  std::vector<int> WheelSlots;
+  std::map<vtkMRMLIGTLQueryNode*, int> QueryToEntry;
+
+private:
+  vtkIGTLQueryManager(const vtkIGTLQueryManager&); // Not implemented
+  void operator=(const vtkIGTLQueryManager&);      // Not implemented
+};
+
+#endif
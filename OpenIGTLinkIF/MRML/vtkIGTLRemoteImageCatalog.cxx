@@ -0,0 +1,604 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLRemoteImageCatalog.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLRemoteImageCatalog.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+#include "vtkMRMLIGTLQueryNode.h"
+
+// MRML includes
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLRemoteImageCatalog);
+
+//----------------------------------------------------------------------------
+vtkIGTLRemoteImageCatalog::vtkIGTLRemoteImageCatalog()
+{
+  this->MetaDeviceName = NULL;
+  this->SetMetaDeviceName("Catalog");
+  this->CatalogTimeToLive = 60.0;
+  this->QueryTimeOut = 30.0;
+  this->PrefetchCount = 2;
+  this->MaximumNumberOfFetches = 2;
+  this->LastRefreshTime = 0.0;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLRemoteImageCatalog::~vtkIGTLRemoteImageCatalog()
+{
+  this->CancelFetches();
+  this->CancelMetaQueries();
+  this->SetMetaDeviceName(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ConnectorNode: " << (this->ConnectorNode.GetPointer() ? this->ConnectorNode->GetID() : "(none)") << "\n";
+  os << indent << "MetaDeviceName: " << (this->MetaDeviceName ? this->MetaDeviceName : "(none)") << "\n";
+  os << indent << "CatalogTimeToLive: " << this->CatalogTimeToLive << " s\n";
+  os << indent << "QueryTimeOut: " << this->QueryTimeOut << " s\n";
+  os << indent << "PrefetchCount: " << this->PrefetchCount << "\n";
+  os << indent << "MaximumNumberOfFetches: " << this->MaximumNumberOfFetches << "\n";
+  os << indent << "NumberOfImages: " << this->Images.size() << "\n";
+  os << indent << "NumberOfLabels: " << this->Labels.size() << "\n";
+  os << indent << "NumberOfQueuedPrefetches: " << this->PrefetchQueue.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::SetConnectorNode(vtkMRMLIGTLConnectorNode* connectorNode)
+{
+  if (this->ConnectorNode.GetPointer() == connectorNode)
+  {
+    return;
+  }
+  this->CancelFetches();
+  this->CancelMetaQueries();
+  this->Fetches.clear();
+  this->Images.clear();
+  this->ImageIndex.clear();
+  this->Labels.clear();
+  this->LabelIndex.clear();
+  this->LastRefreshTime = 0.0;
+  this->ConnectorNode = connectorNode;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLIGTLConnectorNode* vtkIGTLRemoteImageCatalog::GetConnectorNode()
+{
+  return this->ConnectorNode.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLRemoteImageCatalog::Refresh()
+{
+  if (!this->ConnectorNode.GetPointer())
+  {
+    vtkErrorMacro("Refresh: no connector node");
+    return false;
+  }
+  this->CancelMetaQueries();
+  this->LastRefreshTime = vtkTimerLog::GetUniversalTime();
+  const char* deviceName = this->MetaDeviceName ? this->MetaDeviceName : "";
+  this->ImageMetaQuery = this->CreateQuery("IMGMETA", deviceName);
+  if (!this->SendQuery(this->ImageMetaQuery))
+  {
+    this->ImageMetaQuery = NULL;
+  }
+  // Servers without label maps may not answer GET_LBMETA, the image list does not wait for it
+  this->LabelMetaQuery = this->CreateQuery("LBMETA", deviceName);
+  if (!this->SendQuery(this->LabelMetaQuery))
+  {
+    this->LabelMetaQuery = NULL;
+  }
+  return this->ImageMetaQuery.GetPointer() != NULL;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLRemoteImageCatalog::Update()
+{
+  if (this->IsRefreshing())
+  {
+    return false;
+  }
+  if (this->LastRefreshTime > 0.0
+    && vtkTimerLog::GetUniversalTime() - this->LastRefreshTime < this->CatalogTimeToLive)
+  {
+    return false;
+  }
+  return this->Refresh();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLRemoteImageCatalog::IsRefreshing()
+{
+  return this->ImageMetaQuery.GetPointer() != NULL || this->LabelMetaQuery.GetPointer() != NULL;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLRemoteImageCatalog::GetNumberOfImages()
+{
+  return static_cast<int>(this->Images.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLRemoteImageCatalog::FindImage(const char* deviceName)
+{
+  if (deviceName == NULL)
+  {
+    return -1;
+  }
+  IndexMapType::iterator iter = this->ImageIndex.find(deviceName);
+  return iter != this->ImageIndex.end() ? iter->second : -1;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLRemoteImageCatalog::GetImageDeviceName(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Images.size()))
+  {
+    return NULL;
+  }
+  return this->Images[index].DeviceName.c_str();
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLRemoteImageCatalog::GetImageName(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Images.size()))
+  {
+    return NULL;
+  }
+  return this->Images[index].Name.c_str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLRemoteImageCatalog::GetImageMetaElement(int index, vtkMRMLImageMetaListNode::ImageMetaElement* element)
+{
+  if (element == NULL || index < 0 || index >= static_cast<int>(this->Images.size()))
+  {
+    return false;
+  }
+  *element = this->Images[index];
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLRemoteImageCatalog::GetNumberOfLabels()
+{
+  return static_cast<int>(this->Labels.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLRemoteImageCatalog::FindLabel(const char* deviceName)
+{
+  if (deviceName == NULL)
+  {
+    return -1;
+  }
+  IndexMapType::iterator iter = this->LabelIndex.find(deviceName);
+  return iter != this->LabelIndex.end() ? iter->second : -1;
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLRemoteImageCatalog::GetLabelDeviceName(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Labels.size()))
+  {
+    return NULL;
+  }
+  return this->Labels[index].DeviceName.c_str();
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLRemoteImageCatalog::GetLabelName(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Labels.size()))
+  {
+    return NULL;
+  }
+  return this->Labels[index].Name.c_str();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLRemoteImageCatalog::GetLabelMetaElement(int index, vtkMRMLLabelMetaListNode::LabelMetaElement* element)
+{
+  if (element == NULL || index < 0 || index >= static_cast<int>(this->Labels.size()))
+  {
+    return false;
+  }
+  *element = this->Labels[index];
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkIGTLRemoteImageCatalog::OpenImage(const char* deviceName)
+{
+  if (deviceName == NULL || !this->ConnectorNode.GetPointer())
+  {
+    vtkErrorMacro("OpenImage: invalid device name or no connector node");
+    return NULL;
+  }
+  std::string name(deviceName);
+  vtkMRMLNode* node = this->GetImageNode(deviceName);
+  if (node == NULL)
+  {
+    this->RequestImage(name, true);
+  }
+  this->Prefetch(name);
+  this->SendQueuedFetches();
+  return node;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLRemoteImageCatalog::GetImageStatus(const char* deviceName)
+{
+  if (deviceName == NULL)
+  {
+    return IMAGE_NOT_FETCHED;
+  }
+  FetchMapType::iterator iter = this->Fetches.find(deviceName);
+  return iter != this->Fetches.end() ? iter->second.Status : IMAGE_NOT_FETCHED;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkIGTLRemoteImageCatalog::GetImageNode(const char* deviceName)
+{
+  if (deviceName == NULL)
+  {
+    return NULL;
+  }
+  FetchMapType::iterator iter = this->Fetches.find(deviceName);
+  if (iter == this->Fetches.end() || iter->second.Status != IMAGE_FETCHED)
+  {
+    return NULL;
+  }
+  vtkMRMLNode* node = this->GetNode(iter->second.NodeID);
+  if (node == NULL)
+  {
+    // The volume was removed from the scene
+    iter->second.Status = IMAGE_NOT_FETCHED;
+  }
+  return node;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::CancelFetches()
+{
+  for (FetchMapType::iterator iter = this->Fetches.begin(); iter != this->Fetches.end(); ++iter)
+  {
+    FetchType& fetch = iter->second;
+    if (fetch.Status == IMAGE_QUEUED || fetch.Status == IMAGE_FETCHING)
+    {
+      this->CancelQuery(fetch.Query);
+      fetch.Query = NULL;
+      fetch.Status = IMAGE_NOT_FETCHED;
+    }
+  }
+  this->PrefetchQueue.clear();
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkMRMLIGTLQueryNode> vtkIGTLRemoteImageCatalog::CreateQuery(const char* type, const char* deviceName)
+{
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> query = vtkSmartPointer<vtkMRMLIGTLQueryNode>::New();
+  query->SetIGTLName(type);
+  query->SetIGTLDeviceName(deviceName);
+  query->SetQueryType(vtkMRMLIGTLQueryNode::TYPE_GET);
+  query->SetQueryStatus(vtkMRMLIGTLQueryNode::STATUS_PREPARED);
+  query->SetTimeOut(this->QueryTimeOut);
+  return query;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLRemoteImageCatalog::SendQuery(vtkMRMLIGTLQueryNode* query)
+{
+  if (query == NULL || !this->ConnectorNode.GetPointer())
+  {
+    return false;
+  }
+  query->AddObserver(vtkMRMLIGTLQueryNode::ResponseEvent, this, &vtkIGTLRemoteImageCatalog::OnQueryResponse);
+  this->ConnectorNode->PushQuery(query);
+  if (query->GetQueryStatus() != vtkMRMLIGTLQueryNode::STATUS_WAITING)
+  {
+    query->RemoveObservers(vtkMRMLIGTLQueryNode::ResponseEvent);
+    return false;
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::CancelQuery(vtkMRMLIGTLQueryNode* query)
+{
+  if (query == NULL)
+  {
+    return;
+  }
+  query->RemoveObservers(vtkMRMLIGTLQueryNode::ResponseEvent);
+  if (this->ConnectorNode.GetPointer() && query->GetQueryStatus() == vtkMRMLIGTLQueryNode::STATUS_WAITING)
+  {
+    this->ConnectorNode->CancelQuery(query);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::CancelMetaQueries()
+{
+  this->CancelQuery(this->ImageMetaQuery);
+  this->ImageMetaQuery = NULL;
+  this->CancelQuery(this->LabelMetaQuery);
+  this->LabelMetaQuery = NULL;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::RequestImage(const std::string& deviceName, bool urgent)
+{
+  FetchType& fetch = this->Fetches[deviceName];
+  if (fetch.Status == IMAGE_FETCHING || fetch.Status == IMAGE_FETCHED)
+  {
+    if (urgent)
+    {
+      // An opened image does not hold a prefetch slot
+      fetch.Prefetch = false;
+    }
+    return;
+  }
+  if (!urgent)
+  {
+    if (fetch.Status == IMAGE_NOT_FETCHED)
+    {
+      // Failed images are requested again only when they are opened
+      fetch.Status = IMAGE_QUEUED;
+      this->PrefetchQueue.push_back(deviceName);
+    }
+    return;
+  }
+  if (fetch.Status == IMAGE_QUEUED)
+  {
+    this->PrefetchQueue.erase(std::remove(this->PrefetchQueue.begin(), this->PrefetchQueue.end(), deviceName),
+                              this->PrefetchQueue.end());
+  }
+  fetch.Query = this->CreateQuery("IMAGE", deviceName.c_str());
+  fetch.Prefetch = false;
+  fetch.Status = IMAGE_FETCHING;
+  if (!this->SendQuery(fetch.Query))
+  {
+    vtkErrorMacro("RequestImage: cannot send GET_IMAGE for device " << deviceName);
+    fetch.Query = NULL;
+    fetch.Status = IMAGE_FAILED;
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::SendQueuedFetches()
+{
+  int numberOfPrefetches = this->GetNumberOfPrefetchesInProgress();
+  while (!this->PrefetchQueue.empty() && numberOfPrefetches < this->MaximumNumberOfFetches)
+  {
+    std::string deviceName = this->PrefetchQueue.front();
+    this->PrefetchQueue.pop_front();
+    FetchMapType::iterator iter = this->Fetches.find(deviceName);
+    if (iter == this->Fetches.end() || iter->second.Status != IMAGE_QUEUED)
+    {
+      continue;
+    }
+    FetchType& fetch = iter->second;
+    fetch.Query = this->CreateQuery("IMAGE", deviceName.c_str());
+    fetch.Prefetch = true;
+    fetch.Status = IMAGE_FETCHING;
+    if (!this->SendQuery(fetch.Query))
+    {
+      fetch.Query = NULL;
+      fetch.Status = IMAGE_FAILED;
+      continue;
+    }
+    ++numberOfPrefetches;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLRemoteImageCatalog::GetNumberOfPrefetchesInProgress()
+{
+  int numberOfPrefetches = 0;
+  for (FetchMapType::iterator iter = this->Fetches.begin(); iter != this->Fetches.end(); ++iter)
+  {
+    if (iter->second.Status == IMAGE_FETCHING && iter->second.Prefetch)
+    {
+      ++numberOfPrefetches;
+    }
+  }
+  return numberOfPrefetches;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::Prefetch(const std::string& deviceName)
+{
+  // Prefetches queued for the previously opened entry are no longer likely
+  for (size_t i = 0; i < this->PrefetchQueue.size(); ++i)
+  {
+    FetchMapType::iterator iter = this->Fetches.find(this->PrefetchQueue[i]);
+    if (iter != this->Fetches.end() && iter->second.Status == IMAGE_QUEUED)
+    {
+      iter->second.Status = IMAGE_NOT_FETCHED;
+    }
+  }
+  this->PrefetchQueue.clear();
+
+  std::vector<std::string> candidates;
+  int imageIndex = this->FindImage(deviceName.c_str());
+  if (imageIndex >= 0)
+  {
+    // Label maps drawn on the image, then the following images
+    const vtkMRMLImageMetaListNode::ImageMetaElement& image = this->Images[imageIndex];
+    for (size_t i = 0; i < this->Labels.size(); ++i)
+    {
+      if (this->Labels[i].Owner == image.DeviceName || this->Labels[i].Owner == image.Name)
+      {
+        candidates.push_back(this->Labels[i].DeviceName);
+      }
+    }
+    for (size_t i = imageIndex + 1; i < this->Images.size(); ++i)
+    {
+      candidates.push_back(this->Images[i].DeviceName);
+    }
+  }
+  else
+  {
+    int labelIndex = this->FindLabel(deviceName.c_str());
+    for (size_t i = labelIndex + 1; labelIndex >= 0 && i < this->Labels.size(); ++i)
+    {
+      candidates.push_back(this->Labels[i].DeviceName);
+    }
+  }
+
+  int numberOfCandidates = 0;
+  for (size_t i = 0; i < candidates.size() && numberOfCandidates < this->PrefetchCount; ++i)
+  {
+    if (candidates[i] == deviceName)
+    {
+      continue;
+    }
+    this->RequestImage(candidates[i], false);
+    ++numberOfCandidates;
+  }
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLRemoteImageCatalog::GetEntryTimeStamp(const std::string& deviceName)
+{
+  int imageIndex = this->FindImage(deviceName.c_str());
+  return imageIndex >= 0 ? this->Images[imageIndex].TimeStamp : 0.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::OnQueryResponse(vtkObject* caller, unsigned long vtkNotUsed(event), void* vtkNotUsed(callData))
+{
+  vtkMRMLIGTLQueryNode* query = vtkMRMLIGTLQueryNode::SafeDownCast(caller);
+  if (query == NULL)
+  {
+    return;
+  }
+  query->RemoveObservers(vtkMRMLIGTLQueryNode::ResponseEvent);
+  vtkMRMLNode* responseNode = NULL;
+  if (query->GetQueryStatus() == vtkMRMLIGTLQueryNode::STATUS_SUCCESS && query->GetResponseDataNodeID())
+  {
+    responseNode = this->GetNode(query->GetResponseDataNodeID());
+  }
+
+  if (query == this->ImageMetaQuery.GetPointer())
+  {
+    this->ImageMetaQuery = NULL;
+    vtkMRMLImageMetaListNode* listNode = vtkMRMLImageMetaListNode::SafeDownCast(responseNode);
+    if (listNode)
+    {
+      this->UpdateImageList(listNode);
+    }
+    else
+    {
+      vtkWarningMacro("OnQueryResponse: no response to GET_IMGMETA");
+    }
+    return;
+  }
+  if (query == this->LabelMetaQuery.GetPointer())
+  {
+    this->LabelMetaQuery = NULL;
+    vtkMRMLLabelMetaListNode* listNode = vtkMRMLLabelMetaListNode::SafeDownCast(responseNode);
+    if (listNode)
+    {
+      this->UpdateLabelList(listNode);
+    }
+    return;
+  }
+
+  std::string deviceName = query->GetIGTLDeviceName();
+  FetchMapType::iterator iter = this->Fetches.find(deviceName);
+  if (iter == this->Fetches.end() || iter->second.Query.GetPointer() != query)
+  {
+    // Cancelled request
+    return;
+  }
+  this->CompleteFetch(deviceName, iter->second, responseNode);
+  this->SendQueuedFetches();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::UpdateImageList(vtkMRMLImageMetaListNode* listNode)
+{
+  int numberOfElements = listNode->GetNumberOfImageMetaElement();
+  this->Images.resize(numberOfElements);
+  this->ImageIndex.clear();
+  for (int i = 0; i < numberOfElements; ++i)
+  {
+    listNode->GetImageMetaElement(i, &this->Images[i]);
+    this->ImageIndex[this->Images[i].DeviceName] = i;
+  }
+  // Images that were scanned again since they were fetched are fetched again when opened
+  for (FetchMapType::iterator iter = this->Fetches.begin(); iter != this->Fetches.end(); ++iter)
+  {
+    if (iter->second.Status == IMAGE_FETCHED && iter->second.TimeStamp != this->GetEntryTimeStamp(iter->first))
+    {
+      iter->second.Status = IMAGE_NOT_FETCHED;
+    }
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::UpdateLabelList(vtkMRMLLabelMetaListNode* listNode)
+{
+  int numberOfElements = listNode->GetNumberOfLabelMetaElement();
+  this->Labels.resize(numberOfElements);
+  this->LabelIndex.clear();
+  for (int i = 0; i < numberOfElements; ++i)
+  {
+    listNode->GetLabelMetaElement(i, &this->Labels[i]);
+    this->LabelIndex[this->Labels[i].DeviceName] = i;
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLRemoteImageCatalog::CompleteFetch(const std::string& deviceName, FetchType& fetch, vtkMRMLNode* responseNode)
+{
+  fetch.Query = NULL;
+  fetch.Prefetch = false;
+  if (responseNode == NULL)
+  {
+    fetch.Status = IMAGE_FAILED;
+    this->InvokeEvent(ImageFetchFailedEvent, const_cast<char*>(deviceName.c_str()));
+    return;
+  }
+  fetch.Status = IMAGE_FETCHED;
+  fetch.NodeID = responseNode->GetID();
+  fetch.TimeStamp = this->GetEntryTimeStamp(deviceName);
+  this->InvokeEvent(ImageFetchedEvent, const_cast<char*>(deviceName.c_str()));
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkIGTLRemoteImageCatalog::GetNode(const std::string& nodeID)
+{
+  if (nodeID.empty() || !this->ConnectorNode.GetPointer() || this->ConnectorNode->GetScene() == NULL)
+  {
+    return NULL;
+  }
+  return this->ConnectorNode->GetScene()->GetNodeByID(nodeID.c_str());
+}
@@ -0,0 +1,197 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLRemoteImageCatalog.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLRemoteImageCatalog_h
+#define __vtkIGTLRemoteImageCatalog_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+#include "vtkMRMLImageMetaListNode.h"
+#include "vtkMRMLLabelMetaListNode.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkSmartPointer.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkMRMLIGTLConnectorNode;
+class vtkMRMLIGTLQueryNode;
+class vtkMRMLNode;
+
+/// \brief Catalog of the images and label maps that a server offers (IMGMETA and LBMETA).
+///
+/// The lists are requested with GET_IMGMETA and GET_LBMETA and kept with an index by device name,
+/// so that lookups do not search the lists. An image is requested with GET_IMAGE only when it is
+/// opened. Opening an entry also requests the entries likely to be opened next: the label maps
+/// owned by the image, then the following entries of the list. Prefetches are sent in the
+/// background, at most MaximumNumberOfFetches at a time.
+/// The catalog is not thread safe. Query responses are processed by the thread that calls
+/// vtkMRMLIGTLConnectorNode::PeriodicProcess, which must be the thread that uses the catalog.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLRemoteImageCatalog : public vtkObject
+{
+public:
+  enum
+  {
+    ImageFetchedEvent = 118998,
+    ImageFetchFailedEvent = 118999,
+  };
+
+  enum
+  {
+    IMAGE_NOT_FETCHED,
+    IMAGE_QUEUED,   // Prefetch waiting for a free slot
+    IMAGE_FETCHING, // GET_IMAGE sent, waiting for the image
+    IMAGE_FETCHED,
+    IMAGE_FAILED,
+  };
+
+  static vtkIGTLRemoteImageCatalog *New();
+  vtkTypeMacro(vtkIGTLRemoteImageCatalog, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Connector of the server. Changing the connector cancels the pending requests and clears the catalog.
+  void SetConnectorNode(vtkMRMLIGTLConnectorNode* connectorNode);
+  vtkMRMLIGTLConnectorNode* GetConnectorNode();
+
+  /// Device name of the GET_IMGMETA and GET_LBMETA requests
+  vtkGetStringMacro(MetaDeviceName);
+  vtkSetStringMacro(MetaDeviceName);
+
+  /// Time after which Update() requests the lists again, in seconds
+  vtkGetMacro(CatalogTimeToLive, double);
+  vtkSetMacro(CatalogTimeToLive, double);
+
+  /// Time to wait for a response, in seconds
+  vtkGetMacro(QueryTimeOut, double);
+  vtkSetMacro(QueryTimeOut, double);
+
+  /// Number of entries requested in the background when an entry is opened
+  vtkGetMacro(PrefetchCount, int);
+  vtkSetClampMacro(PrefetchCount, int, 0, 100);
+
+  /// Maximum number of prefetches sent at a time. Opened images are requested regardless.
+  vtkGetMacro(MaximumNumberOfFetches, int);
+  vtkSetClampMacro(MaximumNumberOfFetches, int, 1, 100);
+
+  /// Request the lists from the server. The catalog is modified when a response arrives.
+  bool Refresh();
+
+  /// Request the lists if they were never requested or are older than CatalogTimeToLive.
+  /// Returns true if the lists were requested.
+  bool Update();
+
+  /// True if a list request is waiting for its response
+  bool IsRefreshing();
+
+  /// Image entries
+  int GetNumberOfImages();
+  /// Index of the image entry of the device name, -1 if not listed
+  int FindImage(const char* deviceName);
+  const char* GetImageDeviceName(int index);
+  const char* GetImageName(int index);
+
+  /// Label map entries
+  int GetNumberOfLabels();
+  /// Index of the label map entry of the device name, -1 if not listed
+  int FindLabel(const char* deviceName);
+  const char* GetLabelDeviceName(int index);
+  const char* GetLabelName(int index);
+
+#ifndef __VTK_WRAP__
+  /// Copy of the entry at the index. Returns false if the index is out of range.
+  bool GetImageMetaElement(int index, vtkMRMLImageMetaListNode::ImageMetaElement* element);
+  bool GetLabelMetaElement(int index, vtkMRMLLabelMetaListNode::LabelMetaElement* element);
+#endif
+
+  /// Return the volume node of the entry if it is already fetched. Otherwise request the image
+  /// right away (ImageFetchedEvent is invoked with the device name when it arrives) and return NULL.
+  /// In both cases the entries likely to be opened next are prefetched.
+  vtkMRMLNode* OpenImage(const char* deviceName);
+
+  /// Fetch state of the image of the device name (IMAGE_NOT_FETCHED, ...)
+  int GetImageStatus(const char* deviceName);
+
+  /// Volume node of a fetched image, NULL if not fetched
+  vtkMRMLNode* GetImageNode(const char* deviceName);
+
+  /// Cancel the queued and pending image requests
+  void CancelFetches();
+
+protected:
+  vtkIGTLRemoteImageCatalog();
+  ~vtkIGTLRemoteImageCatalog();
+
+  struct FetchType
+  {
+    FetchType() : Status(IMAGE_NOT_FETCHED), TimeStamp(0.0), Prefetch(false) {}
+    int Status;
+    vtkSmartPointer<vtkMRMLIGTLQueryNode> Query;
+    std::string NodeID;
+    // Scan time of the entry when it was fetched, to detect updated images
+    double TimeStamp;
+    bool Prefetch;
+  };
+  typedef std::map<std::string, FetchType> FetchMapType;
+  typedef std::map<std::string, int> IndexMapType;
+
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> CreateQuery(const char* type, const char* deviceName);
+  /// Returns false if the query could not be sent
+  bool SendQuery(vtkMRMLIGTLQueryNode* query);
+  void CancelQuery(vtkMRMLIGTLQueryNode* query);
+  void CancelMetaQueries();
+
+  /// Request the image now (urgent) or when a slot is free
+  void RequestImage(const std::string& deviceName, bool urgent);
+  void SendQueuedFetches();
+  int GetNumberOfPrefetchesInProgress();
+  void Prefetch(const std::string& deviceName);
+  double GetEntryTimeStamp(const std::string& deviceName);
+
+  void OnQueryResponse(vtkObject* caller, unsigned long event, void* callData);
+  void UpdateImageList(vtkMRMLImageMetaListNode* listNode);
+  void UpdateLabelList(vtkMRMLLabelMetaListNode* listNode);
+  void CompleteFetch(const std::string& deviceName, FetchType& fetch, vtkMRMLNode* responseNode);
+
+  vtkMRMLNode* GetNode(const std::string& nodeID);
+
+  vtkWeakPointer<vtkMRMLIGTLConnectorNode> ConnectorNode;
+  char* MetaDeviceName;
+  double CatalogTimeToLive;
+  double QueryTimeOut;
+  int PrefetchCount;
+  int MaximumNumberOfFetches;
+
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> ImageMetaQuery;
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> LabelMetaQuery;
+  double LastRefreshTime;
+
+  std::vector<vtkMRMLImageMetaListNode::ImageMetaElement> Images;
+  IndexMapType ImageIndex;
+  std::vector<vtkMRMLLabelMetaListNode::LabelMetaElement> Labels;
+  IndexMapType LabelIndex;
+
+  FetchMapType Fetches;
+  // Device names of the prefetches waiting for a free slot
+  std::deque<std::string> PrefetchQueue;
+
+private:
+  vtkIGTLRemoteImageCatalog(const vtkIGTLRemoteImageCatalog&); // Not implemented
+  void operator=(const vtkIGTLRemoteImageCatalog&);            // Not implemented
+};
+
+#endif
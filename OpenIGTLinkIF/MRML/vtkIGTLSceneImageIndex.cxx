@@ -0,0 +1,293 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLSceneImageIndex.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLSceneImageIndex.h"
+
+// OpenIGTLink includes
+#include <igtlImageMessage.h>
+
+// MRML includes
+#include <vtkMRMLLabelMapVolumeNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkTimerLog.h>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  unsigned char GetIGTLScalarType(int vtkScalarType)
+  {
+    switch (vtkScalarType)
+    {
+    case VTK_CHAR:
+    case VTK_SIGNED_CHAR:
+      return igtl::ImageMessage::TYPE_INT8;
+    case VTK_UNSIGNED_CHAR:
+      return igtl::ImageMessage::TYPE_UINT8;
+    case VTK_SHORT:
+      return igtl::ImageMessage::TYPE_INT16;
+    case VTK_UNSIGNED_SHORT:
+      return igtl::ImageMessage::TYPE_UINT16;
+    case VTK_INT:
+      return igtl::ImageMessage::TYPE_INT32;
+    case VTK_UNSIGNED_INT:
+      return igtl::ImageMessage::TYPE_UINT32;
+    case VTK_FLOAT:
+      return igtl::ImageMessage::TYPE_FLOAT32;
+    case VTK_DOUBLE:
+      return igtl::ImageMessage::TYPE_FLOAT64;
+    default:
+      return 0;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLSceneImageIndex);
+
+//----------------------------------------------------------------------------
+vtkIGTLSceneImageIndex::vtkIGTLSceneImageIndex()
+{
+  this->NodeAddedObserverTag = 0;
+  this->NodeRemovedObserverTag = 0;
+  this->NameIndexValid = true;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLSceneImageIndex::~vtkIGTLSceneImageIndex()
+{
+  this->SetScene(NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Scene: " << this->Scene.GetPointer() << "\n";
+  os << indent << "NumberOfNodes: " << this->Entries.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::SetScene(vtkMRMLScene* scene)
+{
+  if (this->Scene.GetPointer() == scene)
+  {
+    return;
+  }
+  if (this->Scene.GetPointer())
+  {
+    this->Scene->RemoveObserver(this->NodeAddedObserverTag);
+    this->Scene->RemoveObserver(this->NodeRemovedObserverTag);
+  }
+  this->Entries.clear();
+  this->NameIndex.clear();
+  this->NameIndexValid = true;
+  this->Scene = scene;
+  if (scene)
+  {
+    this->NodeAddedObserverTag = scene->AddObserver(vtkMRMLScene::NodeAddedEvent, this, &vtkIGTLSceneImageIndex::OnSceneEvent);
+    this->NodeRemovedObserverTag = scene->AddObserver(vtkMRMLScene::NodeRemovedEvent, this, &vtkIGTLSceneImageIndex::OnSceneEvent);
+    // The only scan of the scene
+    std::vector<vtkMRMLNode*> nodes;
+    scene->GetNodesByClass("vtkMRMLScalarVolumeNode", nodes);
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+      this->AddNode(nodes[i]);
+    }
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLScene* vtkIGTLSceneImageIndex::GetScene()
+{
+  return this->Scene.GetPointer();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::OnSceneEvent(vtkObject* vtkNotUsed(caller), unsigned long event, void* callData)
+{
+  vtkMRMLNode* node = reinterpret_cast<vtkMRMLNode*>(callData);
+  if (event == vtkMRMLScene::NodeAddedEvent)
+  {
+    this->AddNode(node);
+  }
+  else if (event == vtkMRMLScene::NodeRemovedEvent)
+  {
+    this->RemoveNode(node);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::AddNode(vtkMRMLNode* node)
+{
+  vtkMRMLScalarVolumeNode* volumeNode = vtkMRMLScalarVolumeNode::SafeDownCast(node);
+  if (volumeNode == NULL || volumeNode->GetID() == NULL || volumeNode->IsA("vtkMRMLBitStreamNode"))
+  {
+    // Video streams are not served as images
+    return;
+  }
+  EntryType entry;
+  entry.LabelMap = (vtkMRMLLabelMapVolumeNode::SafeDownCast(volumeNode) != NULL);
+  entry.ImageModifiedTime = volumeNode->GetImageData() ? volumeNode->GetImageData()->GetMTime() : 0;
+  entry.TimeStamp = vtkTimerLog::GetUniversalTime();
+  this->Entries[volumeNode->GetID()] = entry;
+  if (volumeNode->GetName())
+  {
+    // With duplicate names the first node is served
+    this->NameIndex.insert(std::make_pair(std::string(volumeNode->GetName()), std::string(volumeNode->GetID())));
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::RemoveNode(vtkMRMLNode* node)
+{
+  if (node == NULL || node->GetID() == NULL)
+  {
+    return;
+  }
+  if (this->Entries.erase(node->GetID()) > 0)
+  {
+    // The node may have been renamed, its name cannot be used to find its mapping
+    this->NameIndexValid = false;
+  }
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLSceneImageIndex::GetNumberOfNodes()
+{
+  return static_cast<int>(this->Entries.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::GetImageMetaElements(std::vector<vtkMRMLImageMetaListNode::ImageMetaElement>& elements)
+{
+  elements.clear();
+  for (EntryMapType::iterator iter = this->Entries.begin(); iter != this->Entries.end(); ++iter)
+  {
+    vtkMRMLVolumeNode* volumeNode = this->GetVolumeNode(iter->first);
+    if (iter->second.LabelMap || volumeNode == NULL || volumeNode->GetImageData() == NULL)
+    {
+      continue;
+    }
+    vtkImageData* image = volumeNode->GetImageData();
+    vtkMRMLImageMetaListNode::ImageMetaElement element;
+    element.Name = volumeNode->GetName() ? volumeNode->GetName() : "";
+    element.DeviceName = element.Name;
+    element.TimeStamp = this->UpdateTimeStamp(iter->first, volumeNode);
+    image->GetDimensions(element.Size);
+    element.ScalarType = GetIGTLScalarType(image->GetScalarType());
+    elements.push_back(element);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::GetLabelMetaElements(std::vector<vtkMRMLLabelMetaListNode::LabelMetaElement>& elements)
+{
+  elements.clear();
+  for (EntryMapType::iterator iter = this->Entries.begin(); iter != this->Entries.end(); ++iter)
+  {
+    vtkMRMLVolumeNode* volumeNode = this->GetVolumeNode(iter->first);
+    if (!iter->second.LabelMap || volumeNode == NULL || volumeNode->GetImageData() == NULL)
+    {
+      continue;
+    }
+    vtkMRMLLabelMetaListNode::LabelMetaElement element;
+    element.Name = volumeNode->GetName() ? volumeNode->GetName() : "";
+    element.DeviceName = element.Name;
+    volumeNode->GetImageData()->GetDimensions(element.Size);
+    elements.push_back(element);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLVolumeNode* vtkIGTLSceneImageIndex::FindVolumeNode(const char* deviceName)
+{
+  if (deviceName == NULL)
+  {
+    return NULL;
+  }
+  bool rebuilt = false;
+  if (!this->NameIndexValid)
+  {
+    this->RebuildNameIndex();
+    rebuilt = true;
+  }
+  vtkMRMLVolumeNode* volumeNode = this->LookUpName(deviceName);
+  if (volumeNode == NULL && !rebuilt)
+  {
+    // The node may have been renamed since it was indexed
+    this->RebuildNameIndex();
+    volumeNode = this->LookUpName(deviceName);
+  }
+  return volumeNode;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLVolumeNode* vtkIGTLSceneImageIndex::LookUpName(const std::string& deviceName)
+{
+  NameMapType::iterator iter = this->NameIndex.find(deviceName);
+  if (iter == this->NameIndex.end())
+  {
+    return NULL;
+  }
+  vtkMRMLVolumeNode* volumeNode = this->GetVolumeNode(iter->second);
+  if (volumeNode == NULL || volumeNode->GetName() == NULL || deviceName.compare(volumeNode->GetName()) != 0)
+  {
+    return NULL;
+  }
+  return volumeNode;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSceneImageIndex::RebuildNameIndex()
+{
+  // Only the indexed nodes are visited, not the scene
+  this->NameIndex.clear();
+  for (EntryMapType::iterator iter = this->Entries.begin(); iter != this->Entries.end(); ++iter)
+  {
+    vtkMRMLVolumeNode* volumeNode = this->GetVolumeNode(iter->first);
+    if (volumeNode && volumeNode->GetName())
+    {
+      this->NameIndex.insert(std::make_pair(std::string(volumeNode->GetName()), iter->first));
+    }
+  }
+  this->NameIndexValid = true;
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLSceneImageIndex::UpdateTimeStamp(const std::string& nodeID, vtkMRMLVolumeNode* node)
+{
+  EntryType& entry = this->Entries[nodeID];
+  unsigned long imageModifiedTime = node->GetImageData() ? node->GetImageData()->GetMTime() : 0;
+  if (imageModifiedTime != entry.ImageModifiedTime)
+  {
+    entry.ImageModifiedTime = imageModifiedTime;
+    entry.TimeStamp = vtkTimerLog::GetUniversalTime();
+  }
+  return entry.TimeStamp;
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLVolumeNode* vtkIGTLSceneImageIndex::GetVolumeNode(const std::string& nodeID)
+{
+  if (this->Scene.GetPointer() == NULL)
+  {
+    return NULL;
+  }
+  return vtkMRMLVolumeNode::SafeDownCast(this->Scene->GetNodeByID(nodeID.c_str()));
+}
@@ -0,0 +1,111 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLSceneImageIndex.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLSceneImageIndex_h
+#define __vtkIGTLSceneImageIndex_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+#include "vtkMRMLImageMetaListNode.h"
+#include "vtkMRMLLabelMetaListNode.h"
+
+// VTK includes
+#include <vtkObject.h>
+#include <vtkWeakPointer.h>
+
+// STD includes
+#include <map>
+#include <string>
+#include <vector>
+
+class vtkMRMLNode;
+class vtkMRMLScene;
+class vtkMRMLVolumeNode;
+
+/// \brief Index of the volumes and label maps of a scene, to answer GET_IMGMETA, GET_LBMETA and GET_IMAGE.
+///
+/// The scene is scanned once when it is set. Afterwards the index is updated from the
+/// NodeAdded and NodeRemoved events of the scene, so requests never scan the scene.
+/// The device name of an entry is the name of its node. Renamed nodes are found again
+/// from the entries of the index when a lookup misses.
+/// The time stamp of an entry is the time when its image data was last seen modified,
+/// so that clients can detect updated images.
+/// The index is not thread safe, it is used from the thread that modifies the scene.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLSceneImageIndex : public vtkObject
+{
+public:
+  static vtkIGTLSceneImageIndex *New();
+  vtkTypeMacro(vtkIGTLSceneImageIndex, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Scene to index. The index is rebuilt and follows the changes of the scene.
+  void SetScene(vtkMRMLScene* scene);
+  vtkMRMLScene* GetScene();
+
+  /// Add or remove a node. Nodes that are not scalar volumes are ignored.
+  /// Called for the NodeAdded and NodeRemoved events of the scene.
+  void AddNode(vtkMRMLNode* node);
+  void RemoveNode(vtkMRMLNode* node);
+
+  /// Number of indexed volumes, label maps included
+  int GetNumberOfNodes();
+
+#ifndef __VTK_WRAP__
+  /// Entries of the volumes that are not label maps and have image data
+  void GetImageMetaElements(std::vector<vtkMRMLImageMetaListNode::ImageMetaElement>& elements);
+
+  /// Entries of the label maps that have image data
+  void GetLabelMetaElements(std::vector<vtkMRMLLabelMetaListNode::LabelMetaElement>& elements);
+#endif
+
+  /// Indexed volume or label map of the device name, NULL if not indexed
+  vtkMRMLVolumeNode* FindVolumeNode(const char* deviceName);
+
+protected:
+  vtkIGTLSceneImageIndex();
+  ~vtkIGTLSceneImageIndex();
+
+  void OnSceneEvent(vtkObject* caller, unsigned long event, void* callData);
+  void RebuildNameIndex();
+  /// Node of the name in the name index, NULL if missing or renamed
+  vtkMRMLVolumeNode* LookUpName(const std::string& deviceName);
+
+  /// Update the time stamp of the entry if the image data of the node was modified
+  double UpdateTimeStamp(const std::string& nodeID, vtkMRMLVolumeNode* node);
+
+  vtkMRMLVolumeNode* GetVolumeNode(const std::string& nodeID);
+
+  struct EntryType
+  {
+    bool LabelMap;
+    unsigned long ImageModifiedTime;
+    double TimeStamp;
+  };
+  // Key: node ID
+  typedef std::map<std::string, EntryType> EntryMapType;
+  // Key: device name, value: node ID
+  typedef std::map<std::string, std::string> NameMapType;
+
+  vtkWeakPointer<vtkMRMLScene> Scene;
+  unsigned long NodeAddedObserverTag;
+  unsigned long NodeRemovedObserverTag;
+
+  EntryMapType Entries;
+  NameMapType NameIndex;
+  bool NameIndexValid;
+
+private:
+  vtkIGTLSceneImageIndex(const vtkIGTLSceneImageIndex&); // Not implemented
+  void operator=(const vtkIGTLSceneImageIndex&);         // Not implemented
+};
+
+#endif
@@ -0,0 +1,51 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLServedImageDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLServedImageDevice.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLServedImageDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLServedImageDevice::vtkIGTLServedImageDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLServedImageDevice::~vtkIGTLServedImageDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLServedImageDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLServedImageDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  if (strcmp(buffer->GetDeviceType(), "GET_IMAGE") == 0)
+  {
+    // No body
+    this->InvokeEvent(ImageRequestEvent, this);
+    return 1;
+  }
+  return this->Superclass::ReceiveIGTLMessage(buffer, checkCRC);
+}
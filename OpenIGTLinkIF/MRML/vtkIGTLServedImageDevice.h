@@ -0,0 +1,51 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLServedImageDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLServedImageDevice_h
+#define __vtkIGTLServedImageDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioImageDevice.h"
+
+/// \brief IMAGE device of an image listed in an IMGMETA or LBMETA message sent to the peer.
+///
+/// A received GET_IMAGE invokes ImageRequestEvent instead of being handled as an image,
+/// so that the connector can answer with the volume of the same name. The device is
+/// added for the listed images before the peer can request them, as the OpenIGTLinkIO
+/// device factory would create a plain IMAGE device.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLServedImageDevice : public igtlio::ImageDevice
+{
+public:
+  enum
+  {
+    ImageRequestEvent = 119007,
+  };
+
+  static vtkIGTLServedImageDevice *New();
+  vtkTypeMacro(vtkIGTLServedImageDevice, igtlio::ImageDevice);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+
+protected:
+  vtkIGTLServedImageDevice();
+  ~vtkIGTLServedImageDevice();
+
+private:
+  vtkIGTLServedImageDevice(const vtkIGTLServedImageDevice&); // Not implemented
+  void operator=(const vtkIGTLServedImageDevice&);           // Not implemented
+};
+
+#endif
@@ -0,0 +1,288 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLSubscriptionManager.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLSubscriptionManager.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLSubscriptionManager);
+
+//----------------------------------------------------------------------------
+vtkIGTLSubscriptionManager::vtkIGTLSubscriptionManager()
+{
+  this->NextPushTime = -1.0;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLSubscriptionManager::~vtkIGTLSubscriptionManager()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Subscriptions: " << this->Subscriptions.size() << "\n";
+  std::map<KeyType, SubscriptionType>::iterator iter;
+  for (iter = this->Subscriptions.begin(); iter != this->Subscriptions.end(); ++iter)
+  {
+    os << indent.GetNextIndent() << iter->second.Type << " " << iter->second.DeviceName
+       << ": " << iter->second.Resolution << " ms, " << GetStatusAsString(iter->second.Status) << "\n";
+  }
+  os << indent << "CancelledSubscriptions: " << this->CancelledSubscriptions.size() << "\n";
+  os << indent << "RemoteSubscriptions: " << this->RemoteSubscriptions.size() << "\n";
+  std::map<KeyType, RemoteSubscriptionType>::iterator remoteIter;
+  for (remoteIter = this->RemoteSubscriptions.begin(); remoteIter != this->RemoteSubscriptions.end(); ++remoteIter)
+  {
+    os << indent.GetNextIndent() << remoteIter->first.first << " " << remoteIter->first.second
+       << ": " << remoteIter->second.Interval << " s\n";
+  }
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLSubscriptionManager::GetStatusAsString(int status)
+{
+  switch (status)
+  {
+    case STATUS_PENDING: return "PENDING";
+    case STATUS_SENT: return "SENT";
+    case STATUS_ACCEPTED: return "ACCEPTED";
+    case STATUS_REJECTED: return "REJECTED";
+    default: return "UNKNOWN";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::AddSubscription(const std::string& type, const std::string& deviceName, int resolution,
+                                                 const std::string& coordinateName)
+{
+  // A new STT_ message updates the stream, a stop that is not sent yet is no longer needed
+  for (SubscriptionListType::iterator iter = this->CancelledSubscriptions.begin(); iter != this->CancelledSubscriptions.end(); ++iter)
+  {
+    if (iter->Type == type && iter->DeviceName == deviceName)
+    {
+      this->CancelledSubscriptions.erase(iter);
+      break;
+    }
+  }
+  SubscriptionType& subscription = this->Subscriptions[KeyType(type, deviceName)];
+  subscription.Type = type;
+  subscription.DeviceName = deviceName;
+  subscription.Resolution = resolution;
+  subscription.CoordinateName = coordinateName;
+  subscription.Status = STATUS_PENDING;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLSubscriptionManager::RemoveSubscription(const std::string& type, const std::string& deviceName)
+{
+  std::map<KeyType, SubscriptionType>::iterator iter = this->Subscriptions.find(KeyType(type, deviceName));
+  if (iter == this->Subscriptions.end())
+  {
+    return false;
+  }
+  if (iter->second.Status == STATUS_SENT || iter->second.Status == STATUS_ACCEPTED)
+  {
+    this->CancelledSubscriptions.push_back(iter->second);
+  }
+  this->Subscriptions.erase(iter);
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLSubscriptionManager::HasSubscription(const std::string& type, const std::string& deviceName)
+{
+  return this->Subscriptions.find(KeyType(type, deviceName)) != this->Subscriptions.end();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLSubscriptionManager::GetNumberOfSubscriptions()
+{
+  return static_cast<int>(this->Subscriptions.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLSubscriptionManager::GetSubscriptionStatus(const std::string& type, const std::string& deviceName)
+{
+  std::map<KeyType, SubscriptionType>::iterator iter = this->Subscriptions.find(KeyType(type, deviceName));
+  return iter != this->Subscriptions.end() ? iter->second.Status : -1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLSubscriptionManager::SetSubscriptionStatus(const std::string& type, const std::string& deviceName, int status)
+{
+  std::map<KeyType, SubscriptionType>::iterator iter = this->Subscriptions.find(KeyType(type, deviceName));
+  if (iter == this->Subscriptions.end())
+  {
+    return false;
+  }
+  if (iter->second.Status != status)
+  {
+    iter->second.Status = status;
+    this->Modified();
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::ResetSubscriptions()
+{
+  std::map<KeyType, SubscriptionType>::iterator iter;
+  for (iter = this->Subscriptions.begin(); iter != this->Subscriptions.end(); ++iter)
+  {
+    iter->second.Status = STATUS_PENDING;
+  }
+  // The streams of the previous connection are gone
+  this->CancelledSubscriptions.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::RemoveAllSubscriptions()
+{
+  std::map<KeyType, SubscriptionType>::iterator iter;
+  for (iter = this->Subscriptions.begin(); iter != this->Subscriptions.end(); ++iter)
+  {
+    if (iter->second.Status == STATUS_SENT || iter->second.Status == STATUS_ACCEPTED)
+    {
+      this->CancelledSubscriptions.push_back(iter->second);
+    }
+  }
+  this->Subscriptions.clear();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::PopPendingSubscriptions(SubscriptionListType& subscriptions)
+{
+  std::map<KeyType, SubscriptionType>::iterator iter;
+  for (iter = this->Subscriptions.begin(); iter != this->Subscriptions.end(); ++iter)
+  {
+    if (iter->second.Status == STATUS_PENDING)
+    {
+      iter->second.Status = STATUS_SENT;
+      subscriptions.push_back(iter->second);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::PopCancelledSubscriptions(SubscriptionListType& subscriptions)
+{
+  subscriptions.insert(subscriptions.end(), this->CancelledSubscriptions.begin(), this->CancelledSubscriptions.end());
+  this->CancelledSubscriptions.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::AddRemoteSubscription(const std::string& type, const std::string& deviceName,
+                                                       double interval, double currentTime)
+{
+  RemoteSubscriptionType& subscription = this->RemoteSubscriptions[KeyType(type, deviceName)];
+  subscription.Interval = interval > 0.0 ? interval : 0.0;
+  subscription.NextPushTime = currentTime;
+  if (this->NextPushTime < 0.0 || currentTime < this->NextPushTime)
+  {
+    this->NextPushTime = currentTime;
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLSubscriptionManager::RemoveRemoteSubscription(const std::string& type, const std::string& deviceName)
+{
+  if (this->RemoteSubscriptions.erase(KeyType(type, deviceName)) == 0)
+  {
+    return false;
+  }
+  this->UpdateNextPushTime();
+  this->Modified();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLSubscriptionManager::HasRemoteSubscription(const std::string& type, const std::string& deviceName)
+{
+  return this->RemoteSubscriptions.find(KeyType(type, deviceName)) != this->RemoteSubscriptions.end();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLSubscriptionManager::GetNumberOfRemoteSubscriptions()
+{
+  return static_cast<int>(this->RemoteSubscriptions.size());
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLSubscriptionManager::GetRemoteSubscriptionInterval(const std::string& type, const std::string& deviceName)
+{
+  std::map<KeyType, RemoteSubscriptionType>::iterator iter = this->RemoteSubscriptions.find(KeyType(type, deviceName));
+  return iter != this->RemoteSubscriptions.end() ? iter->second.Interval : -1.0;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::RemoveAllRemoteSubscriptions()
+{
+  this->RemoteSubscriptions.clear();
+  this->NextPushTime = -1.0;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+double vtkIGTLSubscriptionManager::GetNextPushTime()
+{
+  return this->NextPushTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::PopDueRemoteSubscriptions(double currentTime, std::vector<KeyType>& keys)
+{
+  // Called at every connector update, return without visiting the streams if none is due
+  if (this->NextPushTime < 0.0 || currentTime < this->NextPushTime)
+  {
+    return;
+  }
+  std::map<KeyType, RemoteSubscriptionType>::iterator iter;
+  for (iter = this->RemoteSubscriptions.begin(); iter != this->RemoteSubscriptions.end(); ++iter)
+  {
+    RemoteSubscriptionType& subscription = iter->second;
+    if (subscription.NextPushTime > currentTime)
+    {
+      continue;
+    }
+    keys.push_back(iter->first);
+    subscription.NextPushTime += subscription.Interval;
+    if (subscription.NextPushTime <= currentTime)
+    {
+      // Late by more than one interval, do not send a burst to catch up
+      subscription.NextPushTime = currentTime + subscription.Interval;
+    }
+  }
+  this->UpdateNextPushTime();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLSubscriptionManager::UpdateNextPushTime()
+{
+  this->NextPushTime = -1.0;
+  std::map<KeyType, RemoteSubscriptionType>::iterator iter;
+  for (iter = this->RemoteSubscriptions.begin(); iter != this->RemoteSubscriptions.end(); ++iter)
+  {
+    if (this->NextPushTime < 0.0 || iter->second.NextPushTime < this->NextPushTime)
+    {
+      this->NextPushTime = iter->second.NextPushTime;
+    }
+  }
+}
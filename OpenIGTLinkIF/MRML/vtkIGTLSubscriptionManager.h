@@ -0,0 +1,148 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLSubscriptionManager.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLSubscriptionManager_h
+#define __vtkIGTLSubscriptionManager_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// \brief Streams started with STT_<type> and stopped with STP_<type>, in both directions.
+///
+/// Subscriptions are the streams that this connector requested from the peer. They are kept
+/// until they are removed, so that they can be requested again when the connection is
+/// re-established: ResetSubscriptions makes them all pending, and the connector sends the
+/// pending ones. Remote subscriptions are the streams that the peer requested from this
+/// connector. Each has a push interval; PopDueRemoteSubscriptions returns the streams whose
+/// next push is due and schedules the following one. A push that is late is not repeated
+/// to catch up, the schedule restarts from the current time.
+/// Streams are identified by message type and device name. The manager accepts any type;
+/// vtkMRMLIGTLConnectorNode streams TDATA and QTDATA only, whose devices handle STT_ and STP_ messages.
+/// The manager is not thread safe, vtkMRMLIGTLConnectorNode locks a mutex around it.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLSubscriptionManager : public vtkObject
+{
+public:
+  static vtkIGTLSubscriptionManager *New();
+  vtkTypeMacro(vtkIGTLSubscriptionManager, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  enum
+  {
+    STATUS_PENDING,  // STT_ message not sent yet
+    STATUS_SENT,     // STT_ message sent, waiting for the RTS_ message
+    STATUS_ACCEPTED, // the peer answered with a success status
+    STATUS_REJECTED, // the peer answered with an error status, not sent again until reset
+  };
+
+  static const char* GetStatusAsString(int status);
+
+  /// Add a subscription, or update it if it exists. The subscription is pending.
+  /// resolution is the requested interval between two messages in milliseconds.
+  void AddSubscription(const std::string& type, const std::string& deviceName, int resolution,
+                       const std::string& coordinateName);
+
+  /// Remove a subscription. If its STT_ message was sent, the stream must be stopped:
+  /// the subscription is returned by PopCancelledSubscriptions. Returns false if there is no such subscription.
+  bool RemoveSubscription(const std::string& type, const std::string& deviceName);
+
+  bool HasSubscription(const std::string& type, const std::string& deviceName);
+  int GetNumberOfSubscriptions();
+
+  /// Status of the subscription, -1 if there is no such subscription
+  int GetSubscriptionStatus(const std::string& type, const std::string& deviceName);
+
+  /// Set the status of a subscription. Returns false if there is no such subscription.
+  bool SetSubscriptionStatus(const std::string& type, const std::string& deviceName, int status);
+
+  /// Make all subscriptions pending and forget the cancelled ones, when the connection to
+  /// the peer is re-established
+  void ResetSubscriptions();
+
+  /// Remove all subscriptions
+  void RemoveAllSubscriptions();
+
+  /// Add a stream requested by the peer, or update its interval. The first push is due at currentTime.
+  void AddRemoteSubscription(const std::string& type, const std::string& deviceName, double interval, double currentTime);
+
+  /// Returns false if there is no such stream
+  bool RemoveRemoteSubscription(const std::string& type, const std::string& deviceName);
+
+  bool HasRemoteSubscription(const std::string& type, const std::string& deviceName);
+  int GetNumberOfRemoteSubscriptions();
+
+  /// Interval between two pushes of a stream in seconds, -1 if there is no such stream
+  double GetRemoteSubscriptionInterval(const std::string& type, const std::string& deviceName);
+
+  /// Remove all streams requested by the peer, when the connection is lost
+  void RemoveAllRemoteSubscriptions();
+
+  /// Earliest time at which a push is due, a negative value if there is no remote subscription
+  double GetNextPushTime();
+
+#ifndef __VTK_WRAP__
+  typedef std::pair<std::string, std::string> KeyType;
+
+  struct SubscriptionType
+  {
+    std::string Type;
+    std::string DeviceName;
+    int Resolution;
+    std::string CoordinateName;
+    int Status;
+  };
+  typedef std::vector<SubscriptionType> SubscriptionListType;
+
+  /// Pending subscriptions. Their status is set to STATUS_SENT: the caller must send their STT_ message.
+  void PopPendingSubscriptions(SubscriptionListType& subscriptions);
+
+  /// Subscriptions removed after their STT_ message was sent. The caller must send their STP_ message.
+  void PopCancelledSubscriptions(SubscriptionListType& subscriptions);
+
+  /// Append the streams whose push is due at currentTime to keys and schedule their next push
+  void PopDueRemoteSubscriptions(double currentTime, std::vector<KeyType>& keys);
+#endif
+
+protected:
+  vtkIGTLSubscriptionManager();
+  ~vtkIGTLSubscriptionManager();
+
+#ifndef __VTK_WRAP__
+  struct RemoteSubscriptionType
+  {
+    double Interval;
+    double NextPushTime;
+  };
+
+  void UpdateNextPushTime();
+
+  std::map<KeyType, SubscriptionType> Subscriptions;
+  SubscriptionListType CancelledSubscriptions;
+  std::map<KeyType, RemoteSubscriptionType> RemoteSubscriptions;
+#endif
+  // Minimum of the next push times, -1 if there is no remote subscription
+  double NextPushTime;
+
+private:
+  vtkIGTLSubscriptionManager(const vtkIGTLSubscriptionManager&); // Not implemented
+  void operator=(const vtkIGTLSubscriptionManager&);             // Not implemented
+};
+
+#endif
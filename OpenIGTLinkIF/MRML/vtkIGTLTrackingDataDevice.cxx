@@ -0,0 +1,318 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLTrackingDataDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLTrackingDataDevice.h"
+#include "vtkIGTLMatrixConverter.h"
+
+// OpenIGTLink includes
+#include <igtlTimeStamp.h>
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLTrackingDataDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLTrackingDataDevice::vtkIGTLTrackingDataDevice()
+{
+  this->Resolution = 50;
+  this->ResponseStatus = -1;
+  this->RequestedResolution = 0;
+  this->RequestResponseStatus = igtl::RTSTrackingDataMessage::STATUS_SUCCESS;
+  this->OutMessage = igtl::TrackingDataMessage::New();
+  this->InMessage = igtl::TrackingDataMessage::New();
+  this->StartMessage = igtl::StartTrackingDataMessage::New();
+  this->StopMessage = igtl::StopTrackingDataMessage::New();
+  this->ResponseMessage = igtl::RTSTrackingDataMessage::New();
+  this->StartRequestMessage = igtl::StartTrackingDataMessage::New();
+  this->RequestResponseMessage = igtl::RTSTrackingDataMessage::New();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLTrackingDataDevice::~vtkIGTLTrackingDataDevice()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTrackingDataDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "NumberOfTools: " << this->ToolNames.size() << "\n";
+  os << indent << "Resolution: " << this->Resolution << " ms\n";
+  os << indent << "CoordinateName: " << this->CoordinateName << "\n";
+  os << indent << "ResponseStatus: " << this->ResponseStatus << "\n";
+  os << indent << "RequestedResolution: " << this->RequestedResolution << " ms\n";
+  os << indent << "RequestedCoordinateName: " << this->RequestedCoordinateName << "\n";
+}
+
+//----------------------------------------------------------------------------
+unsigned int vtkIGTLTrackingDataDevice::GetDeviceContentModifiedEvent() const
+{
+  return TrackingDataModifiedEvent;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLTrackingDataDevice::GetDeviceType() const
+{
+  return vtkIGTLTrackingDataDevice::GetIGTLTypeName();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLTrackingDataDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  if (strcmp(buffer->GetDeviceType(), "RTS_TDATA") == 0)
+  {
+    this->ResponseMessage->SetMessageHeader(buffer);
+    this->ResponseMessage->AllocateBuffer();
+    memcpy(this->ResponseMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+    if (!(this->ResponseMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+    {
+      vtkErrorMacro("ReceiveIGTLMessage: failed to unpack RTS_TDATA message " << this->GetDeviceName());
+      return 0;
+    }
+    this->ResponseStatus = this->ResponseMessage->GetStatus();
+    this->InvokeEvent(TrackingDataResponseEvent, this);
+    return 1;
+  }
+  if (strcmp(buffer->GetDeviceType(), "STT_TDATA") == 0)
+  {
+    this->StartRequestMessage->SetMessageHeader(buffer);
+    this->StartRequestMessage->AllocateBuffer();
+    memcpy(this->StartRequestMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+    if (!(this->StartRequestMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+    {
+      vtkErrorMacro("ReceiveIGTLMessage: failed to unpack STT_TDATA message " << this->GetDeviceName());
+      return 0;
+    }
+    this->RequestedResolution = this->StartRequestMessage->GetResolution();
+    this->RequestedCoordinateName = this->StartRequestMessage->GetCoordinateName();
+    this->InvokeEvent(StartStreamingRequestEvent, this);
+    return 1;
+  }
+  if (strcmp(buffer->GetDeviceType(), "STP_TDATA") == 0)
+  {
+    // No body
+    this->InvokeEvent(StopStreamingRequestEvent, this);
+    return 1;
+  }
+
+  this->InMessage->SetMessageHeader(buffer);
+  this->InMessage->AllocateBuffer();
+  memcpy(this->InMessage->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->InMessage->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack TDATA message " << this->GetDeviceName());
+    return 0;
+  }
+
+  int numberOfTools = this->InMessage->GetNumberOfTrackingDataElements();
+  this->ToolNames.resize(numberOfTools);
+  this->ToolTypes.resize(numberOfTools);
+  this->ToolMatrices.resize(16 * numberOfTools);
+  this->ReceivedToolMatrices.resize(16 * numberOfTools);
+  igtl::TrackingDataElement::Pointer element;
+  igtl::Matrix4x4 matrix;
+  for (int i = 0; i < numberOfTools; ++i)
+  {
+    this->InMessage->GetTrackingDataElement(i, element);
+    this->ToolNames[i] = element->GetName();
+    this->ToolTypes[i] = element->GetType();
+    // igtl::Matrix4x4 is a row-major float[4][4], gather it into the contiguous buffer
+    element->GetMatrix(matrix);
+    memcpy(&this->ReceivedToolMatrices[16 * i], matrix, sizeof(matrix));
+  }
+  if (numberOfTools > 0)
+  {
+    // Widen the matrices of all tools at once
+    vtkIGTLMatrixConverter::ConvertMatrices(&this->ReceivedToolMatrices[0], &this->ToolMatrices[0], numberOfTools);
+  }
+  this->UpdateToolNamePointers();
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->InMessage->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(TrackingDataModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLTrackingDataDevice::GetIGTLMessage()
+{
+  this->OutMessage->ClearTrackingDataElements();
+  igtl::Matrix4x4 matrix;
+  for (size_t i = 0; i < this->ToolNames.size(); ++i)
+  {
+    igtl::TrackingDataElement::Pointer element = igtl::TrackingDataElement::New();
+    element->SetName(this->ToolNames[i].c_str());
+    element->SetType(static_cast<igtlUint8>(this->ToolTypes[i]));
+    const double* toolMatrix = &this->ToolMatrices[16 * i];
+    for (int row = 0; row < 4; ++row)
+    {
+      for (int column = 0; column < 4; ++column)
+      {
+        matrix[row][column] = static_cast<float>(toolMatrix[4 * row + column]);
+      }
+    }
+    element->SetMatrix(matrix);
+    this->OutMessage->AddTrackingDataElement(element);
+  }
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  timestamp->GetTime();
+  this->OutMessage->SetDeviceName(this->GetDeviceName().c_str());
+  this->OutMessage->SetTimeStamp(timestamp);
+  this->OutMessage->Pack();
+  return igtl::MessageBase::Pointer(this->OutMessage.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+igtl::MessageBase::Pointer vtkIGTLTrackingDataDevice::GetIGTLMessage(MESSAGE_PREFIX prefix)
+{
+  if (prefix == MESSAGE_PREFIX_NOT_DEFINED)
+  {
+    return this->GetIGTLMessage();
+  }
+  if (prefix == MESSAGE_PREFIX_START)
+  {
+    this->ResponseStatus = -1;
+    this->StartMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->StartMessage->SetResolution(static_cast<igtlInt32>(this->Resolution));
+    this->StartMessage->SetCoordinateName(this->CoordinateName.c_str());
+    this->StartMessage->Pack();
+    return igtl::MessageBase::Pointer(this->StartMessage.GetPointer());
+  }
+  if (prefix == MESSAGE_PREFIX_STOP)
+  {
+    this->ResponseStatus = -1;
+    this->StopMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->StopMessage->Pack();
+    return igtl::MessageBase::Pointer(this->StopMessage.GetPointer());
+  }
+  if (prefix == MESSAGE_PREFIX_RTS)
+  {
+    this->RequestResponseMessage->SetDeviceName(this->GetDeviceName().c_str());
+    this->RequestResponseMessage->SetStatus(static_cast<igtlUint8>(this->RequestResponseStatus));
+    this->RequestResponseMessage->Pack();
+    return igtl::MessageBase::Pointer(this->RequestResponseMessage.GetPointer());
+  }
+  return igtl::MessageBase::Pointer();
+}
+
+//----------------------------------------------------------------------------
+std::set<igtlio::Device::MESSAGE_PREFIX> vtkIGTLTrackingDataDevice::GetSupportedMessagePrefixes() const
+{
+  std::set<MESSAGE_PREFIX> retval;
+  retval.insert(MESSAGE_PREFIX_NOT_DEFINED);
+  retval.insert(MESSAGE_PREFIX_START);
+  retval.insert(MESSAGE_PREFIX_STOP);
+  retval.insert(MESSAGE_PREFIX_RTS);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTrackingDataDevice::ClearTools()
+{
+  this->ToolNames.clear();
+  this->ToolNamePointers.clear();
+  this->ToolTypes.clear();
+  this->ToolMatrices.clear();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTrackingDataDevice::AddTool(const char* name, int type, const double matrix[16])
+{
+  this->ToolNames.push_back(name ? name : "");
+  this->ToolTypes.push_back(type);
+  this->ToolMatrices.insert(this->ToolMatrices.end(), matrix, matrix + 16);
+  this->UpdateToolNamePointers();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLTrackingDataDevice::GetNumberOfTools()
+{
+  return static_cast<int>(this->ToolNames.size());
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLTrackingDataDevice::GetToolName(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->ToolNames.size()))
+  {
+    return NULL;
+  }
+  return this->ToolNames[index].c_str();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLTrackingDataDevice::GetToolType(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->ToolTypes.size()))
+  {
+    return 0;
+  }
+  return this->ToolTypes[index];
+}
+
+//----------------------------------------------------------------------------
+const char* const* vtkIGTLTrackingDataDevice::GetToolNames()
+{
+  return this->ToolNamePointers.empty() ? NULL : &this->ToolNamePointers[0];
+}
+
+//----------------------------------------------------------------------------
+const double* vtkIGTLTrackingDataDevice::GetToolMatrices()
+{
+  return this->ToolMatrices.empty() ? NULL : &this->ToolMatrices[0];
+}
+
+//----------------------------------------------------------------------------
+const int* vtkIGTLTrackingDataDevice::GetToolTypes()
+{
+  return this->ToolTypes.empty() ? NULL : &this->ToolTypes[0];
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTrackingDataDevice::UpdateToolNamePointers()
+{
+  this->ToolNamePointers.resize(this->ToolNames.size());
+  for (size_t i = 0; i < this->ToolNames.size(); ++i)
+  {
+    this->ToolNamePointers[i] = this->ToolNames[i].c_str();
+  }
+}
+
+//----------------------------------------------------------------------------
+// vtkIGTLTrackingDataDeviceCreator
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLTrackingDataDeviceCreator);
+
+//----------------------------------------------------------------------------
+igtlio::DevicePointer vtkIGTLTrackingDataDeviceCreator::Create(std::string device_name)
+{
+  vtkSmartPointer<vtkIGTLTrackingDataDevice> retval = vtkSmartPointer<vtkIGTLTrackingDataDevice>::New();
+  retval->SetDeviceName(device_name);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLTrackingDataDeviceCreator::GetDeviceType() const
+{
+  return vtkIGTLTrackingDataDevice::GetIGTLTypeName();
+}
@@ -0,0 +1,155 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLTrackingDataDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLTrackingDataDevice_h
+#define __vtkIGTLTrackingDataDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioDevice.h"
+#include "igtlioDeviceFactory.h"
+
+// OpenIGTLink includes
+#include <igtlTrackingDataMessage.h>
+
+// STD includes
+#include <string>
+#include <vector>
+
+/// \brief OpenIGTLinkIO device for the TDATA message type.
+///
+/// The content is the list of tools of one TDATA message: names, types and
+/// row-major 4x4 matrices, stored contiguously so that a tracking data bundle
+/// can be updated from a whole message at once. The device also sends the
+/// STT_TDATA and STP_TDATA queries and receives their RTS_TDATA response, and,
+/// on the sending side, receives these queries and sends their response.
+/// The connector registers vtkIGTLTrackingDataDeviceCreator in the device factory of its
+/// OpenIGTLinkIO connector, so that unsolicited TDATA streams are received as well.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLTrackingDataDevice : public igtlio::Device
+{
+public:
+  enum
+  {
+    TrackingDataModifiedEvent = 118991,
+    TrackingDataResponseEvent = 118992,
+    StartStreamingRequestEvent = 118994,
+    StopStreamingRequestEvent = 118995,
+  };
+
+  static vtkIGTLTrackingDataDevice *New();
+  vtkTypeMacro(vtkIGTLTrackingDataDevice, igtlio::Device);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  static const char* GetIGTLTypeName() { return "TDATA"; };
+
+  virtual unsigned int GetDeviceContentModifiedEvent() const VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage() VTK_OVERRIDE;
+  virtual igtl::MessageBase::Pointer GetIGTLMessage(MESSAGE_PREFIX prefix) VTK_OVERRIDE;
+  virtual std::set<MESSAGE_PREFIX> GetSupportedMessagePrefixes() const VTK_OVERRIDE;
+
+  /// Remove all tools from the content
+  void ClearTools();
+
+  /// Append a tool to the content. matrix is a row-major 4x4 matrix.
+  void AddTool(const char* name, int type, const double matrix[16]);
+
+  int GetNumberOfTools();
+  const char* GetToolName(int index);
+  int GetToolType(int index);
+
+  /// Names of all tools, valid until the content changes
+  const char* const* GetToolNames();
+
+  /// Row-major 4x4 matrices of all tools, 16 values per tool
+  const double* GetToolMatrices();
+
+  /// Types of all tools (igtl::TrackingDataElement::TYPE_TRACKER, ...), valid until the content changes
+  const int* GetToolTypes();
+
+  /// Interval between two TDATA messages requested by STT_TDATA, in milliseconds
+  vtkGetMacro(Resolution, int);
+  vtkSetMacro(Resolution, int);
+
+  /// Coordinate system requested by STT_TDATA
+  vtkGetMacro(CoordinateName, std::string);
+  vtkSetMacro(CoordinateName, std::string);
+
+  /// Status of the last RTS_TDATA message (igtl::RTSTrackingDataMessage::STATUS_SUCCESS
+  /// or STATUS_ERROR), -1 if no response has been received.
+  vtkGetMacro(ResponseStatus, int);
+
+  /// Interval (in milliseconds) and coordinate system requested by the last STT_TDATA message
+  /// received from the peer, which invoked StartStreamingRequestEvent
+  vtkGetMacro(RequestedResolution, int);
+  vtkGetMacro(RequestedCoordinateName, std::string);
+
+  /// Status sent in the RTS_TDATA message that answers a received STT_TDATA or STP_TDATA message
+  vtkGetMacro(RequestResponseStatus, int);
+  vtkSetMacro(RequestResponseStatus, int);
+
+protected:
+  vtkIGTLTrackingDataDevice();
+  ~vtkIGTLTrackingDataDevice();
+
+  void UpdateToolNamePointers();
+
+  std::vector<std::string> ToolNames;
+  std::vector<const char*> ToolNamePointers;
+  std::vector<int> ToolTypes;
+  std::vector<double> ToolMatrices;
+  // Single precision matrices of the last received message, kept to avoid reallocation
+  std::vector<float> ReceivedToolMatrices;
+
+  int Resolution;
+  std::string CoordinateName;
+  int ResponseStatus;
+  int RequestedResolution;
+  std::string RequestedCoordinateName;
+  int RequestResponseStatus;
+
+  igtl::TrackingDataMessage::Pointer OutMessage;
+  igtl::TrackingDataMessage::Pointer InMessage;
+  igtl::StartTrackingDataMessage::Pointer StartMessage;
+  igtl::StopTrackingDataMessage::Pointer StopMessage;
+  igtl::RTSTrackingDataMessage::Pointer ResponseMessage;
+  igtl::StartTrackingDataMessage::Pointer StartRequestMessage;
+  igtl::RTSTrackingDataMessage::Pointer RequestResponseMessage;
+
+private:
+  vtkIGTLTrackingDataDevice(const vtkIGTLTrackingDataDevice&); // Not implemented
+  void operator=(const vtkIGTLTrackingDataDevice&);           // Not implemented
+};
+
+/// \brief Creator of vtkIGTLTrackingDataDevice, adds TDATA to an igtlio::DeviceFactory.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLTrackingDataDeviceCreator : public igtlio::DeviceCreator
+{
+public:
+  static vtkIGTLTrackingDataDeviceCreator *New();
+  vtkTypeMacro(vtkIGTLTrackingDataDeviceCreator, igtlio::DeviceCreator);
+
+  virtual igtlio::DevicePointer Create(std::string device_name) VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+
+protected:
+  vtkIGTLTrackingDataDeviceCreator() {};
+  ~vtkIGTLTrackingDataDeviceCreator() {};
+
+private:
+  vtkIGTLTrackingDataDeviceCreator(const vtkIGTLTrackingDataDeviceCreator&); // Not implemented
+  void operator=(const vtkIGTLTrackingDataDeviceCreator&);                   // Not implemented
+};
+
+#endif
@@ -0,0 +1,331 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLTransformFilter.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLTransformFilter.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cmath>
+
+namespace
+{
+  // Translation components 0-2, quaternion components 3-6
+  const int NumberOfChannels = 7;
+
+  //----------------------------------------------------------------------------
+  double GetSmoothingFactor(double cutoffFrequency, double timeStep)
+  {
+    double tau = 1.0 / (2.0 * vtkMath::Pi() * cutoffFrequency);
+    return 1.0 / (1.0 + tau / timeStep);
+  }
+
+  //----------------------------------------------------------------------------
+  // One-Euro filter of one component
+  struct OneEuroChannel
+  {
+    double Value;
+    double Derivative;
+
+    void Reset(double value)
+    {
+      this->Value = value;
+      this->Derivative = 0.0;
+    }
+
+    double Filter(double value, double timeStep, double minimumCutoff, double cutoffSlope, double derivativeCutoff)
+    {
+      double derivative = (value - this->Value) / timeStep;
+      this->Derivative += GetSmoothingFactor(derivativeCutoff, timeStep) * (derivative - this->Derivative);
+      double cutoff = minimumCutoff + cutoffSlope * fabs(this->Derivative);
+      this->Value += GetSmoothingFactor(cutoff, timeStep) * (value - this->Value);
+      return this->Value;
+    }
+  };
+
+  //----------------------------------------------------------------------------
+  // Constant velocity Kalman filter of one component
+  struct KalmanChannel
+  {
+    double Value;
+    double Velocity;
+    double Covariance[2][2];
+
+    void Reset(double value, double measurementNoise)
+    {
+      this->Value = value;
+      this->Velocity = 0.0;
+      this->Covariance[0][0] = measurementNoise;
+      this->Covariance[0][1] = 0.0;
+      this->Covariance[1][0] = 0.0;
+      // Unknown initial velocity
+      this->Covariance[1][1] = 1e6 * measurementNoise;
+    }
+
+    double Filter(double value, double timeStep, double processNoise, double measurementNoise)
+    {
+      // Predict
+      double dt = timeStep;
+      this->Value += dt * this->Velocity;
+      double p00 = this->Covariance[0][0] + dt * (this->Covariance[1][0] + this->Covariance[0][1]) + dt * dt * this->Covariance[1][1]
+        + processNoise * dt * dt * dt / 3.0;
+      double p01 = this->Covariance[0][1] + dt * this->Covariance[1][1] + processNoise * dt * dt / 2.0;
+      double p10 = this->Covariance[1][0] + dt * this->Covariance[1][1] + processNoise * dt * dt / 2.0;
+      double p11 = this->Covariance[1][1] + processNoise * dt;
+
+      // Correct
+      double innovation = value - this->Value;
+      double innovationCovariance = p00 + measurementNoise;
+      double gain0 = p00 / innovationCovariance;
+      double gain1 = p10 / innovationCovariance;
+      this->Value += gain0 * innovation;
+      this->Velocity += gain1 * innovation;
+      this->Covariance[0][0] = (1.0 - gain0) * p00;
+      this->Covariance[0][1] = (1.0 - gain0) * p01;
+      this->Covariance[1][0] = p10 - gain1 * p00;
+      this->Covariance[1][1] = p11 - gain1 * p01;
+      return this->Value;
+    }
+  };
+}
+
+//----------------------------------------------------------------------------
+class vtkIGTLTransformFilter::vtkInternal
+{
+public:
+  vtkInternal()
+  {
+    this->Initialized = false;
+    this->PreviousTimestamp = 0.0;
+    this->PreviousArrivalTime = 0.0;
+  }
+
+  bool Initialized;
+  double PreviousTimestamp;
+  double PreviousArrivalTime;
+  double PreviousQuaternion[4];
+  OneEuroChannel OneEuro[NumberOfChannels];
+  KalmanChannel Kalman[NumberOfChannels];
+};
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLTransformFilter);
+
+//----------------------------------------------------------------------------
+vtkIGTLTransformFilter::vtkIGTLTransformFilter()
+{
+  this->Internal = new vtkInternal;
+  this->FilterType = FILTER_ONE_EURO;
+  this->MinimumCutoffFrequency = 1.0;
+  this->CutoffSlope = 0.05;
+  this->RotationCutoffSlope = 0.05;
+  this->DerivativeCutoffFrequency = 1.0;
+  this->MeasurementNoise = 0.25;
+  this->RotationMeasurementNoise = 0.05;
+  this->ProcessNoise = 1000.0;
+  this->RotationProcessNoise = 100.0;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLTransformFilter::~vtkIGTLTransformFilter()
+{
+  delete this->Internal;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTransformFilter::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "FilterType: " << FilterTypeToString(this->FilterType) << "\n";
+  os << indent << "MinimumCutoffFrequency: " << this->MinimumCutoffFrequency << " Hz\n";
+  os << indent << "CutoffSlope: " << this->CutoffSlope << "\n";
+  os << indent << "RotationCutoffSlope: " << this->RotationCutoffSlope << "\n";
+  os << indent << "DerivativeCutoffFrequency: " << this->DerivativeCutoffFrequency << " Hz\n";
+  os << indent << "MeasurementNoise: " << this->MeasurementNoise << " mm^2\n";
+  os << indent << "RotationMeasurementNoise: " << this->RotationMeasurementNoise << " deg^2\n";
+  os << indent << "ProcessNoise: " << this->ProcessNoise << "\n";
+  os << indent << "RotationProcessNoise: " << this->RotationProcessNoise << "\n";
+}
+
+//----------------------------------------------------------------------------
+const char* vtkIGTLTransformFilter::FilterTypeToString(int type)
+{
+  switch (type)
+  {
+    case FILTER_NONE: return "NONE";
+    case FILTER_ONE_EURO: return "ONE_EURO";
+    case FILTER_KALMAN: return "KALMAN";
+    default:
+      return "INVALID";
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTransformFilter::SetFilterType(int type)
+{
+  if (type < FILTER_NONE || type >= NUM_FILTER || type == this->FilterType)
+  {
+    return;
+  }
+  this->FilterType = type;
+  this->Reset();
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTransformFilter::Reset()
+{
+  this->Internal->Initialized = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLTransformFilter::Filter(double timestamp, double arrivalTime, vtkMatrix4x4* matrix)
+{
+  if (matrix == NULL || this->FilterType == FILTER_NONE)
+  {
+    return;
+  }
+
+  double rotation[3][3];
+  for (int column = 0; column < 3; ++column)
+  {
+    double norm = 0.0;
+    for (int row = 0; row < 3; ++row)
+    {
+      norm += matrix->GetElement(row, column) * matrix->GetElement(row, column);
+    }
+    norm = norm > 0.0 ? sqrt(norm) : 1.0;
+    for (int row = 0; row < 3; ++row)
+    {
+      rotation[row][column] = matrix->GetElement(row, column) / norm;
+    }
+  }
+  double quaternion[4];
+  vtkMath::Matrix3x3ToQuaternion(rotation, quaternion);
+  // Orthonormal rotation of the measured pose
+  double measuredRotation[3][3];
+  vtkMath::QuaternionToMatrix3x3(quaternion, measuredRotation);
+
+  vtkInternal* internal = this->Internal;
+  if (internal->Initialized)
+  {
+    // q and -q are the same rotation, keep the quaternion components continuous
+    double dot = 0.0;
+    for (int k = 0; k < 4; ++k)
+    {
+      dot += quaternion[k] * internal->PreviousQuaternion[k];
+    }
+    if (dot < 0.0)
+    {
+      for (int k = 0; k < 4; ++k)
+      {
+        quaternion[k] = -quaternion[k];
+      }
+    }
+  }
+
+  // Quaternion components are scaled to approximately degrees of rotation,
+  // so that the rotation parameters are given in degrees
+  const double rotationScale = 2.0 * 180.0 / vtkMath::Pi();
+  double values[NumberOfChannels];
+  for (int k = 0; k < 3; ++k)
+  {
+    values[k] = matrix->GetElement(k, 3);
+  }
+  for (int k = 0; k < 4; ++k)
+  {
+    values[3 + k] = quaternion[k] * rotationScale;
+  }
+
+  double timeStep = timestamp - internal->PreviousTimestamp;
+  if (timestamp <= 0.0 || timeStep <= 0.0)
+  {
+    // Time stamp not set or not advancing
+    timeStep = arrivalTime - internal->PreviousArrivalTime;
+  }
+  if (!internal->Initialized || timeStep <= 0.0 || timeStep > 1.0)
+  {
+    // First pose, no time between the samples, or a long pause: restart from the measured pose
+    for (int k = 0; k < NumberOfChannels; ++k)
+    {
+      double measurementNoise = k < 3 ? this->MeasurementNoise : this->RotationMeasurementNoise;
+      internal->OneEuro[k].Reset(values[k]);
+      internal->Kalman[k].Reset(values[k], measurementNoise);
+    }
+    internal->Initialized = true;
+  }
+  else
+  {
+    for (int k = 0; k < NumberOfChannels; ++k)
+    {
+      bool isRotation = (k >= 3);
+      if (this->FilterType == FILTER_ONE_EURO)
+      {
+        values[k] = internal->OneEuro[k].Filter(values[k], timeStep, this->MinimumCutoffFrequency,
+          isRotation ? this->RotationCutoffSlope : this->CutoffSlope, this->DerivativeCutoffFrequency);
+      }
+      else
+      {
+        values[k] = internal->Kalman[k].Filter(values[k], timeStep,
+          isRotation ? this->RotationProcessNoise : this->ProcessNoise,
+          isRotation ? this->RotationMeasurementNoise : this->MeasurementNoise);
+      }
+    }
+  }
+  internal->PreviousTimestamp = timestamp;
+  internal->PreviousArrivalTime = arrivalTime;
+  for (int k = 0; k < 4; ++k)
+  {
+    internal->PreviousQuaternion[k] = quaternion[k];
+  }
+
+  double norm = 0.0;
+  for (int k = 0; k < 4; ++k)
+  {
+    quaternion[k] = values[3 + k];
+    norm += quaternion[k] * quaternion[k];
+  }
+  norm = sqrt(norm);
+  for (int k = 0; k < 4; ++k)
+  {
+    quaternion[k] /= norm;
+  }
+  vtkMath::QuaternionToMatrix3x3(quaternion, rotation);
+
+  // The change of rotation made by the filter is applied to the measured matrix, so that its scaling
+  // and shear are kept
+  double deltaRotation[3][3];
+  vtkMath::Transpose3x3(measuredRotation, measuredRotation);
+  vtkMath::Multiply3x3(rotation, measuredRotation, deltaRotation);
+  double linear[3][3];
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 3; ++column)
+    {
+      linear[row][column] = matrix->GetElement(row, column);
+    }
+  }
+  double filteredLinear[3][3];
+  vtkMath::Multiply3x3(deltaRotation, linear, filteredLinear);
+  for (int row = 0; row < 3; ++row)
+  {
+    for (int column = 0; column < 3; ++column)
+    {
+      matrix->SetElement(row, column, filteredLinear[row][column]);
+    }
+    matrix->SetElement(row, 3, values[row]);
+  }
+}
@@ -0,0 +1,116 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLTransformFilter.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLTransformFilter_h
+#define __vtkIGTLTransformFilter_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+class vtkMatrix4x4;
+
+/// \brief Smoothing filter for a stream of transforms.
+///
+/// Translation and rotation are filtered separately. The rotation is filtered as the
+/// quaternion components, aligned with the previous orientation and renormalized,
+/// which is accurate for the small changes between consecutive samples.
+/// Rotation parameters are given in degrees. Scaling and shear of the input matrix
+/// are not filtered, the filtered rotation is applied to them.
+///
+/// - One-Euro filter: adaptive low-pass filter. The cutoff frequency increases with speed,
+///   so slow motion is smoothed strongly and fast motion has little lag.
+/// - Kalman filter: constant velocity model for each component.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLTransformFilter : public vtkObject
+{
+public:
+  enum
+  {
+    FILTER_NONE,
+    FILTER_ONE_EURO,
+    FILTER_KALMAN,
+    NUM_FILTER,
+  };
+
+  static vtkIGTLTransformFilter *New();
+  vtkTypeMacro(vtkIGTLTransformFilter, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Filter type. Changing the type resets the filter.
+  void SetFilterType(int type);
+  vtkGetMacro(FilterType, int);
+  static const char* FilterTypeToString(int type);
+
+  /// One-Euro filter: cutoff frequency at rest, in Hz
+  vtkGetMacro(MinimumCutoffFrequency, double);
+  vtkSetClampMacro(MinimumCutoffFrequency, double, 0.001, 1000.0);
+
+  /// One-Euro filter: increase of the cutoff frequency with the translation speed, in Hz per mm/s
+  vtkGetMacro(CutoffSlope, double);
+  vtkSetClampMacro(CutoffSlope, double, 0.0, 1000.0);
+
+  /// One-Euro filter: increase of the cutoff frequency with the rotation speed, in Hz per deg/s
+  vtkGetMacro(RotationCutoffSlope, double);
+  vtkSetClampMacro(RotationCutoffSlope, double, 0.0, 1000.0);
+
+  /// One-Euro filter: cutoff frequency of the speed estimate, in Hz
+  vtkGetMacro(DerivativeCutoffFrequency, double);
+  vtkSetClampMacro(DerivativeCutoffFrequency, double, 0.001, 1000.0);
+
+  /// Kalman filter: variance of the measured translation (mm^2) and rotation (deg^2)
+  vtkGetMacro(MeasurementNoise, double);
+  vtkSetClampMacro(MeasurementNoise, double, 1e-12, 1e12);
+  vtkGetMacro(RotationMeasurementNoise, double);
+  vtkSetClampMacro(RotationMeasurementNoise, double, 1e-12, 1e12);
+
+  /// Kalman filter: spectral density of the acceleration, for translation (mm^2/s^3)
+  /// and rotation (deg^2/s^3). Larger values follow motion changes faster.
+  vtkGetMacro(ProcessNoise, double);
+  vtkSetClampMacro(ProcessNoise, double, 1e-12, 1e12);
+  vtkGetMacro(RotationProcessNoise, double);
+  vtkSetClampMacro(RotationProcessNoise, double, 1e-12, 1e12);
+
+  /// Forget the filter state. The next pose is passed through unchanged.
+  void Reset();
+
+  /// Filter the pose in place. The time step of the filter is the difference of the sample
+  /// time stamps (in seconds). Senders that do not set time stamps send 0, and some repeat
+  /// the time stamp of the previous sample: if the time stamp does not advance, the time
+  /// between the arrivals of the two samples is used instead.
+  /// The filter restarts from the measured pose after a pause of more than a second.
+  void Filter(double timestamp, double arrivalTime, vtkMatrix4x4* matrix);
+
+protected:
+  vtkIGTLTransformFilter();
+  ~vtkIGTLTransformFilter();
+
+  int FilterType;
+  double MinimumCutoffFrequency;
+  double CutoffSlope;
+  double RotationCutoffSlope;
+  double DerivativeCutoffFrequency;
+  double MeasurementNoise;
+  double RotationMeasurementNoise;
+  double ProcessNoise;
+  double RotationProcessNoise;
+
+private:
+  vtkIGTLTransformFilter(const vtkIGTLTransformFilter&); // Not implemented
+  void operator=(const vtkIGTLTransformFilter&);         // Not implemented
+
+  class vtkInternal;
+  vtkInternal* Internal;
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLVideoDevice.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLVideoDevice.h"
+#include "vtkIGTLI420ToRGBConverter.h"
+
+// OpenIGTLink includes
+#include <igtlConfigure.h>
+#include <igtlTimeStamp.h>
+#if defined(OpenIGTLink_USE_VP9)
+  #include <igtlVP9Decoder.h>
+#endif
+#if defined(OpenIGTLink_USE_H264)
+  #include <igtlH264Decoder.h>
+#endif
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstring>
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLVideoDevice);
+
+//----------------------------------------------------------------------------
+vtkIGTLVideoDevice::vtkIGTLVideoDevice()
+{
+  this->Message = igtl::VideoMessage::New();
+  this->KeyFrameMessage = igtl::VideoMessage::New();
+  this->KeyFrameReceived = false;
+  this->LastFrameConverted = false;
+  this->ConversionImplementation = vtkIGTLI420ToRGBConverter::IMPLEMENTATION_AUTO;
+  this->Decoder = NULL;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLVideoDevice::~vtkIGTLVideoDevice()
+{
+  delete this->Decoder;
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLVideoDevice::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "ConversionImplementation: "
+     << vtkIGTLI420ToRGBConverter::GetImplementationName(this->ConversionImplementation) << "\n";
+  os << indent << "LastFrameConverted: " << (this->LastFrameConverted ? "true" : "false") << "\n";
+}
+
+//----------------------------------------------------------------------------
+GenericDecoder* vtkIGTLVideoDevice::GetDecoder(const std::string& codecName)
+{
+  if (this->Decoder && this->DecoderCodecName == codecName)
+  {
+    return this->Decoder;
+  }
+  delete this->Decoder;
+  this->Decoder = NULL;
+  this->DecoderCodecName = codecName;
+#if defined(OpenIGTLink_USE_VP9)
+  if (codecName == IGTL_VIDEO_CODEC_NAME_VP9)
+  {
+    this->Decoder = new VP9Decoder();
+  }
+#endif
+#if defined(OpenIGTLink_USE_H264)
+  if (codecName == IGTL_VIDEO_CODEC_NAME_H264)
+  {
+    this->Decoder = new H264Decoder();
+  }
+#endif
+  return this->Decoder;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLVideoDevice::ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC)
+{
+  if (strcmp(buffer->GetDeviceType(), "VIDEO") != 0)
+  {
+    // Prefixed messages
+    return this->Superclass::ReceiveIGTLMessage(buffer, checkCRC);
+  }
+
+  this->Message->SetMessageHeader(buffer);
+  this->Message->AllocateBuffer();
+  memcpy(this->Message->GetBufferBodyPointer(), buffer->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  if (!(this->Message->Unpack(checkCRC) & igtl::MessageHeader::UNPACK_BODY))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to unpack VIDEO message " << this->GetDeviceName());
+    return 0;
+  }
+
+  GenericDecoder* decoder = this->GetDecoder(this->Message->GetCodecType());
+  if (decoder == NULL)
+  {
+    // Codec is not built in, OpenIGTLinkIO may still decode it
+    this->LastFrameConverted = false;
+    return this->Superclass::ReceiveIGTLMessage(buffer, checkCRC);
+  }
+
+  bool keyFrame = (this->Message->GetFrameType() == FrameTypeKey);
+  if (!keyFrame && !this->KeyFrameReceived)
+  {
+    // Delta frames cannot be decoded before the first key frame
+    return 0;
+  }
+  int width = this->Message->GetWidth();
+  int height = this->Message->GetHeight();
+  if (width <= 0 || height <= 0)
+  {
+    return 0;
+  }
+  igtl_uint32 dimensions[2] = { static_cast<igtl_uint32>(width), static_cast<igtl_uint32>(height) };
+  this->I420Frame.resize(width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2));
+  if (decoder->DecodeBitStreamIntoFrame(this->Message->GetPackFragmentPointer(2), &this->I420Frame[0],
+    dimensions, this->Message->GetBitStreamSize()) != 0)
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: failed to decode VIDEO message " << this->GetDeviceName());
+    return 0;
+  }
+
+  igtlio::VideoConverter::ContentData content = this->GetContent();
+  if (content.image == NULL)
+  {
+    content.image = vtkSmartPointer<vtkImageData>::New();
+  }
+  if (!vtkIGTLI420ToRGBConverter::ConvertFrame(&this->I420Frame[0], width, height, content.image,
+    this->ConversionImplementation))
+  {
+    vtkErrorMacro("ReceiveIGTLMessage: I420 conversion is not available");
+    return 0;
+  }
+  content.image->Modified();
+  content.frameType = this->Message->GetFrameType();
+  strncpy(content.codecName, this->Message->GetCodecType().c_str(), IGTL_VIDEO_CODEC_NAME_SIZE);
+  content.keyFrameUpdated = keyFrame;
+  if (keyFrame)
+  {
+    this->KeyFrameMessage->Copy(this->Message);
+    this->KeyFrameReceived = true;
+  }
+  this->SetContent(content);
+  this->LastFrameConverted = true;
+
+  igtl::TimeStamp::Pointer timestamp = igtl::TimeStamp::New();
+  this->Message->GetTimeStamp(timestamp);
+  this->SetTimestamp(timestamp->GetTimeStamp());
+  this->Modified();
+  this->InvokeEvent(VideoModifiedEvent, this);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+igtl::VideoMessage::Pointer vtkIGTLVideoDevice::GetReceivedMessage()
+{
+  if (!this->LastFrameConverted)
+  {
+    return igtl::VideoMessage::Pointer();
+  }
+  igtl::VideoMessage::Pointer message = igtl::VideoMessage::New();
+  message->Copy(this->Message);
+  return message;
+}
+
+//----------------------------------------------------------------------------
+igtl::VideoMessage::Pointer vtkIGTLVideoDevice::GetReceivedKeyFrameMessage()
+{
+  if (!this->LastFrameConverted || !this->KeyFrameReceived)
+  {
+    return igtl::VideoMessage::Pointer();
+  }
+  igtl::VideoMessage::Pointer message = igtl::VideoMessage::New();
+  message->Copy(this->KeyFrameMessage);
+  return message;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLVideoDevice::GetReceivedCodecType()
+{
+  return this->Message->GetCodecType();
+}
+
+//----------------------------------------------------------------------------
+// vtkIGTLVideoDeviceCreator
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLVideoDeviceCreator);
+
+//----------------------------------------------------------------------------
+igtlio::DevicePointer vtkIGTLVideoDeviceCreator::Create(std::string device_name)
+{
+  vtkSmartPointer<vtkIGTLVideoDevice> retval = vtkSmartPointer<vtkIGTLVideoDevice>::New();
+  retval->SetDeviceName(device_name);
+  return retval;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLVideoDeviceCreator::GetDeviceType() const
+{
+  return "VIDEO";
+}
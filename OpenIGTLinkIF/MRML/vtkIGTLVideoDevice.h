@@ -0,0 +1,102 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLVideoDevice.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLVideoDevice_h
+#define __vtkIGTLVideoDevice_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// OpenIGTLinkIO includes
+#include "igtlioDeviceFactory.h"
+#include "igtlioVideoDevice.h"
+
+// STD includes
+#include <string>
+#include <vector>
+
+/// \brief VIDEO device that converts received frames with vtkIGTLI420ToRGBConverter.
+///
+/// Received messages are decoded into an I420 frame with the VP9 or H264 decoder of
+/// OpenIGTLink and converted to RGB with the fastest SIMD kernel of the processor, instead of
+/// the scalar conversion of the OpenIGTLinkIO video converter. Codecs that are not built in are
+/// decoded by the superclass. Sending is not changed.
+/// The connector registers vtkIGTLVideoDeviceCreator in the device factory of its OpenIGTLinkIO
+/// connector, so all of its VIDEO devices, including the devices of unsolicited streams, are of this class.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLVideoDevice : public igtlio::VideoDevice
+{
+public:
+  static vtkIGTLVideoDevice *New();
+  vtkTypeMacro(vtkIGTLVideoDevice, igtlio::VideoDevice);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  virtual int ReceiveIGTLMessage(igtl::MessageBase::Pointer buffer, bool checkCRC) VTK_OVERRIDE;
+
+  /// Implementation of vtkIGTLI420ToRGBConverter used for received frames,
+  /// vtkIGTLI420ToRGBConverter::IMPLEMENTATION_AUTO by default
+  vtkGetMacro(ConversionImplementation, int);
+  vtkSetMacro(ConversionImplementation, int);
+
+  /// True if the last received frame was converted by this device, false if it was
+  /// decoded by the superclass
+  vtkGetMacro(LastFrameConverted, bool);
+
+  /// Copies of the last received message and of the last received key frame,
+  /// packed in network byte order. NULL if the superclass decoded the last message.
+  igtl::VideoMessage::Pointer GetReceivedMessage();
+  igtl::VideoMessage::Pointer GetReceivedKeyFrameMessage();
+
+  /// Codec of the last received message
+  std::string GetReceivedCodecType();
+
+protected:
+  vtkIGTLVideoDevice();
+  ~vtkIGTLVideoDevice();
+
+  GenericDecoder* GetDecoder(const std::string& codecName);
+
+  igtl::VideoMessage::Pointer Message;
+  igtl::VideoMessage::Pointer KeyFrameMessage;
+  bool KeyFrameReceived;
+  bool LastFrameConverted;
+  int ConversionImplementation;
+
+  // Decoder of the current codec, recreated when the codec changes
+  GenericDecoder* Decoder;
+  std::string DecoderCodecName;
+  std::vector<igtl_uint8> I420Frame;
+
+private:
+  vtkIGTLVideoDevice(const vtkIGTLVideoDevice&); // Not implemented
+  void operator=(const vtkIGTLVideoDevice&);     // Not implemented
+};
+
+/// \brief Creator of vtkIGTLVideoDevice, replaces the VIDEO creator of an igtlio::DeviceFactory.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLVideoDeviceCreator : public igtlio::DeviceCreator
+{
+public:
+  static vtkIGTLVideoDeviceCreator *New();
+  vtkTypeMacro(vtkIGTLVideoDeviceCreator, igtlio::DeviceCreator);
+
+  virtual igtlio::DevicePointer Create(std::string device_name) VTK_OVERRIDE;
+  virtual std::string GetDeviceType() const VTK_OVERRIDE;
+
+protected:
+  vtkIGTLVideoDeviceCreator() {};
+  ~vtkIGTLVideoDeviceCreator() {};
+
+private:
+  vtkIGTLVideoDeviceCreator(const vtkIGTLVideoDeviceCreator&); // Not implemented
+  void operator=(const vtkIGTLVideoDeviceCreator&);            // Not implemented
+};
+
+#endif
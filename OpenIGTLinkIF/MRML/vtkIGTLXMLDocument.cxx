@@ -0,0 +1,686 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLXMLDocument.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLXMLDocument.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+
+// STD includes
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  bool IsSpace(char c)
+  {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+  }
+
+  //----------------------------------------------------------------------------
+  bool IsNameEnd(char c)
+  {
+    return IsSpace(c) || c == '>' || c == '/' || c == '=';
+  }
+
+  //----------------------------------------------------------------------------
+  const char* SkipSpaces(const char* p, const char* end)
+  {
+    while (p < end && IsSpace(*p))
+    {
+      ++p;
+    }
+    return p;
+  }
+
+  //----------------------------------------------------------------------------
+  bool StartsWith(const char* p, const char* end, const char* prefix)
+  {
+    size_t length = strlen(prefix);
+    return static_cast<size_t>(end - p) >= length && strncmp(p, prefix, length) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  const char* Find(const char* p, const char* end, const char* pattern)
+  {
+    size_t length = strlen(pattern);
+    for (; static_cast<size_t>(end - p) >= length; ++p)
+    {
+      if (*p == pattern[0] && strncmp(p, pattern, length) == 0)
+      {
+        return p;
+      }
+    }
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  void AppendUTF8(std::string& text, unsigned long codePoint)
+  {
+    if (codePoint < 0x80)
+    {
+      text += static_cast<char>(codePoint);
+    }
+    else if (codePoint < 0x800)
+    {
+      text += static_cast<char>(0xC0 | (codePoint >> 6));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000)
+    {
+      text += static_cast<char>(0xE0 | (codePoint >> 12));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+      text += static_cast<char>(0xF0 | (codePoint >> 18));
+      text += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+      text += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+      text += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::StringView::Equals(const char* text) const
+{
+  if (this->Data == NULL || text == NULL)
+  {
+    return false;
+  }
+  return strlen(text) == this->Length && strncmp(this->Data, text, this->Length) == 0;
+}
+
+//----------------------------------------------------------------------------
+vtkStandardNewMacro(vtkIGTLXMLDocument);
+
+//----------------------------------------------------------------------------
+vtkIGTLXMLDocument::vtkIGTLXMLDocument()
+{
+  this->Valid = false;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLXMLDocument::~vtkIGTLXMLDocument()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLXMLDocument::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "Valid: " << (this->Valid ? "true" : "false") << "\n";
+  os << indent << "ErrorMessage: " << this->ErrorMessage << "\n";
+  os << indent << "NumberOfElements: " << this->Elements.size() << "\n";
+  os << indent << "NumberOfAttributes: " << this->Attributes.size() << "\n";
+}
+
+//----------------------------------------------------------------------------
+void vtkIGTLXMLDocument::Clear()
+{
+  this->Buffer.clear();
+  this->Elements.clear();
+  this->Attributes.clear();
+  this->Valid = false;
+  this->ErrorMessage.clear();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::Parse(const std::string& content)
+{
+  this->Clear();
+  this->Buffer = content;
+  return this->ParseElements(this->Buffer.data(), this->Buffer.data() + this->Buffer.size());
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::ParseBuffer(const char* data, size_t length)
+{
+  this->Clear();
+  if (data == NULL)
+  {
+    return this->SetError("no content", NULL, NULL);
+  }
+  return this->ParseElements(data, data + length);
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::SetError(const char* message, const char* begin, const char* position)
+{
+  std::ostringstream error;
+  error << message;
+  if (begin && position)
+  {
+    error << " at offset " << (position - begin);
+  }
+  this->ErrorMessage = error.str();
+  this->Elements.clear();
+  this->Attributes.clear();
+  this->Valid = false;
+  return false;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::ParseElements(const char* begin, const char* end)
+{
+  std::vector<int> openElements;
+  const char* p = begin;
+  while (p < end)
+  {
+    if (*p != '<')
+    {
+      // Text, kept for the element if it is its first non-blank text
+      const char* textBegin = SkipSpaces(p, end);
+      const char* textEnd = static_cast<const char*>(memchr(p, '<', end - p));
+      if (textEnd == NULL)
+      {
+        textEnd = end;
+      }
+      p = textEnd;
+      while (textEnd > textBegin && IsSpace(textEnd[-1]))
+      {
+        --textEnd;
+      }
+      if (textBegin < textEnd)
+      {
+        if (openElements.empty())
+        {
+          return this->SetError("text outside of the root element", begin, textBegin);
+        }
+        ElementType& element = this->Elements[openElements.back()];
+        if (element.Text.IsNull())
+        {
+          element.Text = StringView(textBegin, textEnd - textBegin);
+        }
+      }
+      continue;
+    }
+    if (StartsWith(p, end, "<!--"))
+    {
+      const char* commentEnd = Find(p + 4, end, "-->");
+      if (commentEnd == NULL)
+      {
+        return this->SetError("unterminated comment", begin, p);
+      }
+      p = commentEnd + 3;
+      continue;
+    }
+    if (StartsWith(p, end, "<![CDATA["))
+    {
+      const char* dataBegin = p + 9;
+      const char* dataEnd = Find(dataBegin, end, "]]>");
+      if (dataEnd == NULL)
+      {
+        return this->SetError("unterminated CDATA section", begin, p);
+      }
+      if (openElements.empty())
+      {
+        return this->SetError("CDATA section outside of the root element", begin, p);
+      }
+      ElementType& element = this->Elements[openElements.back()];
+      if (element.Text.IsNull())
+      {
+        element.Text = StringView(dataBegin, dataEnd - dataBegin);
+        element.TextIsCDATA = true;
+      }
+      p = dataEnd + 3;
+      continue;
+    }
+    if (StartsWith(p, end, "<?"))
+    {
+      const char* instructionEnd = Find(p + 2, end, "?>");
+      if (instructionEnd == NULL)
+      {
+        return this->SetError("unterminated processing instruction", begin, p);
+      }
+      p = instructionEnd + 2;
+      continue;
+    }
+    if (StartsWith(p, end, "<!"))
+    {
+      const char* declarationEnd = static_cast<const char*>(memchr(p, '>', end - p));
+      if (declarationEnd == NULL)
+      {
+        return this->SetError("unterminated declaration", begin, p);
+      }
+      p = declarationEnd + 1;
+      continue;
+    }
+    if (StartsWith(p, end, "</"))
+    {
+      const char* nameBegin = p + 2;
+      const char* nameEnd = nameBegin;
+      while (nameEnd < end && !IsNameEnd(*nameEnd))
+      {
+        ++nameEnd;
+      }
+      const char* tagEnd = static_cast<const char*>(memchr(nameEnd, '>', end - nameEnd));
+      if (tagEnd == NULL)
+      {
+        return this->SetError("unterminated end tag", begin, p);
+      }
+      // Close the matching element, and the elements left open inside it
+      StringView name(nameBegin, nameEnd - nameBegin);
+      int depth = static_cast<int>(openElements.size()) - 1;
+      while (depth >= 0)
+      {
+        const StringView& openName = this->Elements[openElements[depth]].Name;
+        if (openName.Length == name.Length && strncmp(openName.Data, name.Data, name.Length) == 0)
+        {
+          break;
+        }
+        --depth;
+      }
+      if (depth < 0)
+      {
+        return this->SetError("end tag without start tag", begin, p);
+      }
+      openElements.resize(depth);
+      p = tagEnd + 1;
+      continue;
+    }
+
+    // Start tag
+    const char* nameBegin = p + 1;
+    const char* nameEnd = nameBegin;
+    while (nameEnd < end && !IsNameEnd(*nameEnd))
+    {
+      ++nameEnd;
+    }
+    if (nameEnd == nameBegin)
+    {
+      return this->SetError("element without name", begin, p);
+    }
+    int parent = openElements.empty() ? -1 : openElements.back();
+    if (parent < 0 && !this->Elements.empty())
+    {
+      return this->SetError("more than one root element", begin, p);
+    }
+    int elementIndex = static_cast<int>(this->Elements.size());
+    ElementType element;
+    element.Name = StringView(nameBegin, nameEnd - nameBegin);
+    element.TextIsCDATA = false;
+    element.FirstAttribute = static_cast<int>(this->Attributes.size());
+    element.NumberOfAttributes = 0;
+    element.Parent = parent;
+    element.FirstChild = -1;
+    element.LastChild = -1;
+    element.NextSibling = -1;
+    this->Elements.push_back(element);
+    if (parent >= 0)
+    {
+      ElementType& parentElement = this->Elements[parent];
+      if (parentElement.LastChild >= 0)
+      {
+        this->Elements[parentElement.LastChild].NextSibling = elementIndex;
+      }
+      else
+      {
+        parentElement.FirstChild = elementIndex;
+      }
+      parentElement.LastChild = elementIndex;
+    }
+
+    // Attributes
+    p = nameEnd;
+    bool closed = false;
+    while (true)
+    {
+      p = SkipSpaces(p, end);
+      if (p >= end)
+      {
+        return this->SetError("unterminated start tag", begin, nameBegin - 1);
+      }
+      if (*p == '>')
+      {
+        ++p;
+        break;
+      }
+      if (*p == '/' && p + 1 < end && p[1] == '>')
+      {
+        p += 2;
+        closed = true;
+        break;
+      }
+      const char* attributeNameBegin = p;
+      while (p < end && !IsNameEnd(*p))
+      {
+        ++p;
+      }
+      if (p == attributeNameBegin)
+      {
+        return this->SetError("invalid attribute", begin, p);
+      }
+      AttributeType attribute;
+      attribute.Name = StringView(attributeNameBegin, p - attributeNameBegin);
+      attribute.Value = StringView(p, 0);
+      p = SkipSpaces(p, end);
+      if (p < end && *p == '=')
+      {
+        p = SkipSpaces(p + 1, end);
+        if (p < end && (*p == '"' || *p == '\''))
+        {
+          const char* valueEnd = static_cast<const char*>(memchr(p + 1, *p, end - p - 1));
+          if (valueEnd == NULL)
+          {
+            return this->SetError("unterminated attribute value", begin, p);
+          }
+          attribute.Value = StringView(p + 1, valueEnd - p - 1);
+          p = valueEnd + 1;
+        }
+        else
+        {
+          // Unquoted value, ends at a space or at the end of the tag
+          const char* valueBegin = p;
+          while (p < end && !IsSpace(*p) && *p != '>' && !(*p == '/' && p + 1 < end && p[1] == '>'))
+          {
+            ++p;
+          }
+          attribute.Value = StringView(valueBegin, p - valueBegin);
+        }
+      }
+      this->Attributes.push_back(attribute);
+      ++this->Elements[elementIndex].NumberOfAttributes;
+    }
+    if (!closed)
+    {
+      openElements.push_back(elementIndex);
+    }
+  }
+
+  if (!openElements.empty())
+  {
+    return this->SetError("unclosed element", begin, this->Elements[openElements.back()].Name.Data - 1);
+  }
+  if (this->Elements.empty())
+  {
+    return this->SetError("no root element", NULL, NULL);
+  }
+  this->Valid = true;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::IsValid()
+{
+  return this->Valid;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLXMLDocument::GetErrorMessage()
+{
+  return this->ErrorMessage;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::IsElementIndexValid(int element)
+{
+  return element >= 0 && element < static_cast<int>(this->Elements.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::GetNumberOfElements()
+{
+  return static_cast<int>(this->Elements.size());
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::GetRootElement()
+{
+  return this->Elements.empty() ? -1 : 0;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::GetParentElement(int element)
+{
+  return this->IsElementIndexValid(element) ? this->Elements[element].Parent : -1;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::GetFirstChildElement(int element)
+{
+  return this->IsElementIndexValid(element) ? this->Elements[element].FirstChild : -1;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::GetNextSiblingElement(int element)
+{
+  return this->IsElementIndexValid(element) ? this->Elements[element].NextSibling : -1;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::FindChildElement(int element, const char* name)
+{
+  for (int child = this->GetFirstChildElement(element); child >= 0; child = this->Elements[child].NextSibling)
+  {
+    if (this->Elements[child].Name.Equals(name))
+    {
+      return child;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::FindChildElementWithAttribute(int element, const char* name,
+                                                      const char* attributeName, const char* attributeValue)
+{
+  for (int child = this->GetFirstChildElement(element); child >= 0; child = this->Elements[child].NextSibling)
+  {
+    if (this->Elements[child].Name.Equals(name) && this->GetAttributeView(child, attributeName).Equals(attributeValue))
+    {
+      return child;
+    }
+  }
+  return -1;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLXMLDocument::StringView vtkIGTLXMLDocument::GetElementNameView(int element)
+{
+  return this->IsElementIndexValid(element) ? this->Elements[element].Name : StringView();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLXMLDocument::GetElementName(int element)
+{
+  return this->GetElementNameView(element).ToString();
+}
+
+//----------------------------------------------------------------------------
+int vtkIGTLXMLDocument::GetNumberOfAttributes(int element)
+{
+  return this->IsElementIndexValid(element) ? this->Elements[element].NumberOfAttributes : 0;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLXMLDocument::GetAttributeName(int element, int index)
+{
+  if (index < 0 || index >= this->GetNumberOfAttributes(element))
+  {
+    return std::string();
+  }
+  return this->Attributes[this->Elements[element].FirstAttribute + index].Name.ToString();
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLXMLDocument::StringView vtkIGTLXMLDocument::GetAttributeView(int element, const char* name)
+{
+  if (!this->IsElementIndexValid(element))
+  {
+    return StringView();
+  }
+  const ElementType& elementData = this->Elements[element];
+  for (int i = 0; i < elementData.NumberOfAttributes; ++i)
+  {
+    const AttributeType& attribute = this->Attributes[elementData.FirstAttribute + i];
+    if (attribute.Name.Equals(name))
+    {
+      return attribute.Value;
+    }
+  }
+  return StringView();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::HasAttribute(int element, const char* name)
+{
+  return !this->GetAttributeView(element, name).IsNull();
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::GetAttribute(int element, const char* name, std::string& value)
+{
+  StringView view = this->GetAttributeView(element, name);
+  if (view.IsNull())
+  {
+    return false;
+  }
+  value = DecodeEntities(view);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLXMLDocument::GetAttributeValue(int element, const char* name)
+{
+  return DecodeEntities(this->GetAttributeView(element, name));
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::GetScalarAttribute(int element, const char* name, double& value)
+{
+  StringView view = this->GetAttributeView(element, name);
+  if (view.IsNull() || view.Length == 0 || view.Length > 63)
+  {
+    return false;
+  }
+  // The buffer is not null terminated after the value
+  char text[64];
+  memcpy(text, view.Data, view.Length);
+  text[view.Length] = '\0';
+  char* numberEnd = NULL;
+  double number = strtod(text, &numberEnd);
+  if (numberEnd == text || *SkipSpaces(numberEnd, text + view.Length) != '\0')
+  {
+    return false;
+  }
+  value = number;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkIGTLXMLDocument::GetScalarAttribute(int element, const char* name, int& value)
+{
+  StringView view = this->GetAttributeView(element, name);
+  if (view.IsNull() || view.Length == 0 || view.Length > 63)
+  {
+    return false;
+  }
+  char text[64];
+  memcpy(text, view.Data, view.Length);
+  text[view.Length] = '\0';
+  char* numberEnd = NULL;
+  long number = strtol(text, &numberEnd, 10);
+  if (numberEnd == text || *SkipSpaces(numberEnd, text + view.Length) != '\0')
+  {
+    return false;
+  }
+  value = static_cast<int>(number);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLXMLDocument::StringView vtkIGTLXMLDocument::GetElementTextView(int element)
+{
+  return this->IsElementIndexValid(element) ? this->Elements[element].Text : StringView();
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLXMLDocument::GetElementText(int element)
+{
+  if (this->IsElementIndexValid(element) && this->Elements[element].TextIsCDATA)
+  {
+    // Character data is not markup, it is returned as is
+    return this->Elements[element].Text.ToString();
+  }
+  return DecodeEntities(this->GetElementTextView(element));
+}
+
+//----------------------------------------------------------------------------
+std::string vtkIGTLXMLDocument::DecodeEntities(const StringView& view)
+{
+  if (view.IsNull())
+  {
+    return std::string();
+  }
+  const char* p = view.Data;
+  const char* end = view.Data + view.Length;
+  const char* ampersand = static_cast<const char*>(memchr(p, '&', view.Length));
+  if (ampersand == NULL)
+  {
+    return std::string(p, view.Length);
+  }
+  std::string text(p, ampersand - p);
+  p = ampersand;
+  while (p < end)
+  {
+    if (*p != '&')
+    {
+      text += *p++;
+      continue;
+    }
+    const char* semicolon = static_cast<const char*>(memchr(p, ';', end - p));
+    if (semicolon == NULL || semicolon - p > 10)
+    {
+      // Not an entity, keep the ampersand
+      text += *p++;
+      continue;
+    }
+    StringView entity(p + 1, semicolon - p - 1);
+    if (entity.Equals("lt")) { text += '<'; }
+    else if (entity.Equals("gt")) { text += '>'; }
+    else if (entity.Equals("amp")) { text += '&'; }
+    else if (entity.Equals("quot")) { text += '"'; }
+    else if (entity.Equals("apos")) { text += '\''; }
+    else if (entity.Length > 1 && entity.Data[0] == '#')
+    {
+      std::string digits(entity.Data + 1, entity.Length - 1);
+      bool hexadecimal = (digits[0] == 'x' || digits[0] == 'X');
+      char* digitsEnd = NULL;
+      const char* digitsBegin = digits.c_str() + (hexadecimal ? 1 : 0);
+      // strtoul would also accept spaces and a sign before the digits
+      bool digitFirst = hexadecimal ? (isxdigit(static_cast<unsigned char>(*digitsBegin)) != 0)
+                                    : (isdigit(static_cast<unsigned char>(*digitsBegin)) != 0);
+      unsigned long codePoint = digitFirst ? strtoul(digitsBegin, &digitsEnd, hexadecimal ? 16 : 10) : 0;
+      if (!digitFirst || *digitsEnd != '\0' || codePoint > 0x10FFFF)
+      {
+        text.append(p, semicolon + 1 - p);
+      }
+      else
+      {
+        AppendUTF8(text, codePoint);
+      }
+    }
+    else
+    {
+      // Unknown entity, keep it
+      text.append(p, semicolon + 1 - p);
+    }
+    p = semicolon + 1;
+  }
+  return text;
+}
@@ -0,0 +1,158 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkIGTLXMLDocument.h
+
+==========================================================================*/
+
+#ifndef __vtkIGTLXMLDocument_h
+#define __vtkIGTLXMLDocument_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// VTK includes
+#include <vtkObject.h>
+
+// STD includes
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// \brief Compact read-only DOM of the XML content of a COMMAND message.
+///
+/// The content is parsed once into arrays of elements and attributes. Names, attribute values and
+/// texts are views (pointer and length) into the parsed buffer, nothing is copied or decoded until
+/// a value is requested as a string. Elements are identified by their index, in document order;
+/// -1 means no element. The parser is lenient with the content that devices actually send:
+/// unquoted attribute values and attributes without value are accepted.
+/// An end tag closes the elements left open inside its element.
+/// Comments, processing instructions and DOCTYPE are skipped. Entities are decoded by the
+/// string accessors only, except in CDATA sections; views return the raw content.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkIGTLXMLDocument : public vtkObject
+{
+public:
+  static vtkIGTLXMLDocument *New();
+  vtkTypeMacro(vtkIGTLXMLDocument, vtkObject);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  /// Copy the content into the document and parse it. Returns false if the content is not well formed.
+  /// Content that outlives the document, such as a received message, is parsed without copy by ParseBuffer.
+  bool Parse(const std::string& content);
+
+  /// Remove all elements
+  void Clear();
+
+  /// True if the last parsing succeeded
+  bool IsValid();
+  std::string GetErrorMessage();
+
+  int GetNumberOfElements();
+
+  /// Root element, -1 if the document is not valid
+  int GetRootElement();
+
+  int GetParentElement(int element);
+  int GetFirstChildElement(int element);
+  int GetNextSiblingElement(int element);
+
+  /// First child element with the given name, -1 if none
+  int FindChildElement(int element, const char* name);
+
+  /// First child element with the given name whose attribute has the given value, -1 if none.
+  /// E.g. FindChildElementWithAttribute(root, "Parameter", "Name", "Depth")
+  int FindChildElementWithAttribute(int element, const char* name, const char* attributeName, const char* attributeValue);
+
+  std::string GetElementName(int element);
+
+  int GetNumberOfAttributes(int element);
+  std::string GetAttributeName(int element, int index);
+  bool HasAttribute(int element, const char* name);
+
+  /// Decoded value of an attribute. Returns false if the element has no such attribute.
+  bool GetAttribute(int element, const char* name, std::string& value);
+
+  /// Decoded value of an attribute, empty if the element has no such attribute
+  std::string GetAttributeValue(int element, const char* name);
+
+  /// Numerical value of an attribute. Returns false if the attribute is missing or not a number.
+  bool GetScalarAttribute(int element, const char* name, double& value);
+  bool GetScalarAttribute(int element, const char* name, int& value);
+
+  /// Decoded text of the element (first text or CDATA section, without surrounding white space)
+  std::string GetElementText(int element);
+
+#ifndef __VTK_WRAP__
+  /// Characters of the parsed buffer, not null terminated
+  struct StringView
+  {
+    const char* Data;
+    size_t Length;
+
+    StringView() : Data(NULL), Length(0) {}
+    StringView(const char* data, size_t length) : Data(data), Length(length) {}
+    bool IsNull() const { return this->Data == NULL; }
+    bool Equals(const char* text) const;
+    std::string ToString() const { return this->Data ? std::string(this->Data, this->Length) : std::string(); }
+  };
+
+  /// Parse a buffer without copying it. The buffer must not change or be freed while the document is used.
+  bool ParseBuffer(const char* data, size_t length);
+
+  StringView GetElementNameView(int element);
+
+  /// Raw value of an attribute, null view if the element has no such attribute
+  StringView GetAttributeView(int element, const char* name);
+
+  StringView GetElementTextView(int element);
+
+  /// Replace the predefined and numeric character entities
+  static std::string DecodeEntities(const StringView& view);
+#endif
+
+protected:
+  vtkIGTLXMLDocument();
+  ~vtkIGTLXMLDocument();
+
+#ifndef __VTK_WRAP__
+  struct ElementType
+  {
+    StringView Name;
+    StringView Text;
+    bool TextIsCDATA;
+    int FirstAttribute;
+    int NumberOfAttributes;
+    int Parent;
+    int FirstChild;
+    int LastChild;
+    int NextSibling;
+  };
+
+  struct AttributeType
+  {
+    StringView Name;
+    StringView Value;
+  };
+
+  bool ParseElements(const char* begin, const char* end);
+  bool SetError(const char* message, const char* begin, const char* position);
+  bool IsElementIndexValid(int element);
+
+  std::string Buffer;
+  std::vector<ElementType> Elements;
+  std::vector<AttributeType> Attributes;
+#endif
+  bool Valid;
+  std::string ErrorMessage;
+
+private:
+  vtkIGTLXMLDocument(const vtkIGTLXMLDocument&); // Not implemented
+  void operator=(const vtkIGTLXMLDocument&);     // Not implemented
+};
+
+#endif
@@ -1,12 +1,24 @@
 #include "vtkMRMLBitStreamNode.h"
 
+// OpenIGTLinkIF MRML includes
+#include "vtkIGTLI420ToRGBConverter.h"
+#include "vtkIGTLImageResampler.h"
+#include "vtkIGTLVideoDevice.h"
+#include "vtkMRMLBitStreamStorageNode.h"
+
 // OpenIGTLink includes
 #include "igtlioVideoDevice.h"
+#include "igtlConfigure.h"
 #include "igtlImageMessage.h"
+#if defined(OpenIGTLink_USE_VP9)
+  #include "igtlVP9Decoder.h"
+#endif
+#if defined(OpenIGTLink_USE_H264)
+  #include "igtlH264Decoder.h"
+#endif
 
 // MRML includes
 #include "vtkMRMLScene.h"
-#include "vtkMRMLNRRDStorageNode.h"
 
 // VTK includes
 #include <vtkCollection.h>
@@ -14,8 +26,34 @@
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
 #include <vtkXMLUtilities.h>
 
+// STD includes
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <vector>
+
+// Maximum number of frames held in the jitter buffer, older frames are dropped
+// if the sender is faster than the buffer is drained.
+static const unsigned int JitterBufferMaximumNumberOfFrames = 64;
+
+// Due frames that are displayed more than this late (in seconds) are skipped, so that the display
+// catches up when it is updated less often than frames arrive.
+static const double JitterBufferMaximumLateness = 0.2;
+
+// Allowed growth of the estimated clock offset per received frame (in seconds).
+// Lets the playout point follow a slowly increasing network delay.
+static const double JitterBufferClockOffsetRelaxation = 0.0001;
+
+// Maximum number of recorded compressed frames and groups of pictures (a key frame and its
+// delta frames). The oldest group is dropped when either limit is exceeded.
+static const unsigned int StreamMaximumNumberOfFrames = 600;
+static const int StreamMaximumNumberOfGroupsOfPictures = 8;
+
 //----------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLBitStreamNode);
 
@@ -70,7 +108,34 @@ public:
 
   int ObserveOutsideVideoDevice(igtlio::VideoDevice* device);
 
-  void DecodeMessageStream(igtl::VideoMessage::Pointer videoMessage);
+  GenericDecoder* GetDecoder(const std::string& codecName);
+  bool DecodeBitStream(GenericDecoder* decoder, unsigned char* bitStream, igtl_uint64 bitStreamSize,
+                       int width, int height);
+
+  // Compressed stream recording
+  struct StreamFrame
+  {
+    std::vector<unsigned char> BitStream;
+    int Width;
+    int Height;
+    double Timestamp;
+    bool KeyFrame;
+  };
+  void AddStreamFrame(const unsigned char* bitStream, unsigned int size, int width, int height,
+                      double timestamp, bool keyFrame);
+  void RecordMessage(igtl::VideoMessage::Pointer videoMessage);
+
+  // Encode region clamped to the image and size of the encoded frame.
+  // Returns false if the image is sent as it is.
+  bool GetEncodeGeometry(vtkImageData* image, int region[4], int& outputWidth, int& outputHeight);
+  bool DecodeStreamFrames();
+
+  // Jitter buffer
+  vtkSmartPointer<vtkImageData> GetFrameFromPool(vtkImageData* frame);
+  void ReturnFrameToPool(vtkImageData* frame);
+  void QueueFrame(vtkImageData* frame, double timestamp);
+  void ReleaseDueFrames(double currentTime);
+  void ClearFrameQueue();
 
   vtkMRMLBitStreamNode* External;
 
@@ -79,6 +144,35 @@ public:
   igtl::ImageMessage::Pointer ImageMessageBuffer;
 
   igtlio::VideoDevicePointer videoDevice;
+
+  // Decoder of the recorded stream frames, recreated when the codec changes
+  GenericDecoder* Decoder;
+  std::string DecoderCodecName;
+  // Decoded I420 frame and its RGB conversion
+  std::vector<igtl_uint8> I420Frame;
+  vtkSmartPointer<vtkImageData> DecodedImage;
+
+  // Compressed frames of the last groups of pictures, the first one is always a key frame.
+  // A deque so that dropping the oldest group does not copy the other frames.
+  std::deque<StreamFrame> StreamFrames;
+  // Set when the stream frames were loaded but not decoded yet
+  bool DecodePending;
+
+  // Cropped and scaled image passed to the encoder
+  vtkSmartPointer<vtkImageData> EncodeImage;
+
+  // Frames waiting for display, ordered by header timestamp
+  typedef std::multimap<double, vtkSmartPointer<vtkImageData> > FrameQueueType;
+  FrameQueueType FrameQueue;
+  // Released frame images that can be reused for new frames
+  std::vector<vtkSmartPointer<vtkImageData> > FramePool;
+  // Frame currently displayed by the node, owned by the jitter buffer
+  vtkSmartPointer<vtkImageData> DisplayedFrame;
+
+  // Estimated (local time - remote timestamp), the smallest transport delay observed
+  double ClockOffset;
+  bool ClockOffsetValid;
+  double LastReleasedTimestamp;
 };
 
 //----------------------------------------------------------------------------
@@ -89,6 +183,8 @@ vtkMRMLBitStreamNode::vtkInternal::vtkInternal(vtkMRMLBitStreamNode* external)
   : External(external)
 {
   videoDevice = NULL;
+  Decoder = NULL;
+  DecodePending = false;
 
   MessageBuffer = igtl::VideoMessage::New();
   MessageBuffer->InitPack();
@@ -98,11 +194,16 @@ vtkMRMLBitStreamNode::vtkInternal::vtkInternal(vtkMRMLBitStreamNode* external)
 
   ImageMessageBuffer = igtl::ImageMessage::New();
   ImageMessageBuffer->InitPack();
+
+  ClockOffset = 0.0;
+  ClockOffsetValid = false;
+  LastReleasedTimestamp = -1.0;
 }
 
 //---------------------------------------------------------------------------
 vtkMRMLBitStreamNode::vtkInternal::~vtkInternal()
 {
+  delete this->Decoder;
 }
 
 //---------------------------------------------------------------------------
@@ -113,11 +214,22 @@ int vtkMRMLBitStreamNode::vtkInternal::ObserveOutsideVideoDevice(igtlio::VideoDe
     //vectorVolumeNode = vtkMRMLVectorVolumeNode::SafeDownCast(node);
     device->AddObserver(device->GetDeviceContentModifiedEvent(), this->External, &vtkMRMLBitStreamNode::ProcessDeviceModifiedEvents);
     //------
-    igtl::VideoMessage::Pointer videoMsg = device->GetCompressedIGTLMessage();
-    igtl_header* h = (igtl_header*)videoMsg->GetPackPointer();
-    igtl_header_convert_byte_order(h);
-    this->SetMessageStream(videoMsg);
-    this->External->codecName = device->GetCurrentCodecType();
+    // Frames converted by vtkIGTLVideoDevice are not in the OpenIGTLinkIO message buffers
+    vtkIGTLVideoDevice* convertingDevice = vtkIGTLVideoDevice::SafeDownCast(device);
+    bool converted = convertingDevice && convertingDevice->GetLastFrameConverted();
+    igtl::VideoMessage::Pointer videoMsg = converted ? convertingDevice->GetReceivedMessage()
+                                                     : device->GetCompressedIGTLMessage();
+    if (videoMsg.IsNotNull())
+    {
+      if (this->External->RecordStream)
+      {
+        this->RecordMessage(videoMsg);
+      }
+      igtl_header* h = (igtl_header*)videoMsg->GetPackPointer();
+      igtl_header_convert_byte_order(h);
+      this->SetMessageStream(videoMsg);
+    }
+    this->External->codecName = converted ? convertingDevice->GetReceivedCodecType() : device->GetCurrentCodecType();
     this->External->SetAndObserveImageData(device->GetContent().image);
     //this->Internal->videoDevice = device; // should the interal video device point to the external video device?
     //-------
@@ -127,22 +239,283 @@ int vtkMRMLBitStreamNode::vtkInternal::ObserveOutsideVideoDevice(igtlio::VideoDe
 }
 
 //---------------------------------------------------------------------------
-void vtkMRMLBitStreamNode::vtkInternal::DecodeMessageStream(igtl::VideoMessage::Pointer videoMessage)
+GenericDecoder* vtkMRMLBitStreamNode::vtkInternal::GetDecoder(const std::string& codecName)
+{
+  if (this->Decoder && this->DecoderCodecName == codecName)
+  {
+    return this->Decoder;
+  }
+  delete this->Decoder;
+  this->Decoder = NULL;
+  this->DecoderCodecName = codecName;
+#if defined(OpenIGTLink_USE_VP9)
+  if (codecName == IGTL_VIDEO_CODEC_NAME_VP9)
+  {
+    this->Decoder = new VP9Decoder();
+  }
+#endif
+#if defined(OpenIGTLink_USE_H264)
+  if (codecName == IGTL_VIDEO_CODEC_NAME_H264)
+  {
+    this->Decoder = new H264Decoder();
+  }
+#endif
+  return this->Decoder;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLBitStreamNode::vtkInternal::DecodeBitStream(GenericDecoder* decoder, unsigned char* bitStream, igtl_uint64 bitStreamSize,
+                                                        int width, int height)
+{
+  if (decoder == NULL || bitStream == NULL || width <= 0 || height <= 0)
+  {
+    return false;
+  }
+  igtl_uint32 dimensions[2] = { static_cast<igtl_uint32>(width), static_cast<igtl_uint32>(height) };
+  this->I420Frame.resize(width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2));
+  if (decoder->DecodeBitStreamIntoFrame(bitStream, &this->I420Frame[0], dimensions, bitStreamSize) != 0)
+  {
+    return false;
+  }
+
+  if (this->DecodedImage == NULL)
+  {
+    this->DecodedImage = vtkSmartPointer<vtkImageData>::New();
+  }
+  if (!vtkIGTLI420ToRGBConverter::ConvertFrame(&this->I420Frame[0], width, height, this->DecodedImage))
+  {
+    return false;
+  }
+
+  if (this->External->GetImageData() != this->DecodedImage)
+  {
+    // Stored frames are displayed directly, their timestamps are not related to the current time
+    this->External->SetAndObserveImageData(this->DecodedImage);
+  }
+  this->External->Modified();
+  return true;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::vtkInternal::AddStreamFrame(const unsigned char* bitStream, unsigned int size, int width, int height,
+                                                       double timestamp, bool keyFrame)
+{
+  if (!keyFrame && this->StreamFrames.empty())
+  {
+    // Delta frames are useless without the preceding key frame
+    return;
+  }
+  this->StreamFrames.push_back(StreamFrame());
+  StreamFrame& frame = this->StreamFrames.back();
+  frame.BitStream.assign(bitStream, bitStream + size);
+  frame.Width = width;
+  frame.Height = height;
+  frame.Timestamp = timestamp;
+  frame.KeyFrame = keyFrame;
+
+  // Whole groups of pictures are dropped, so that the stream still starts with a key frame
+  int numberOfGroupsOfPictures = 0;
+  for (std::deque<StreamFrame>::iterator frameIt = this->StreamFrames.begin(); frameIt != this->StreamFrames.end(); ++frameIt)
+  {
+    numberOfGroupsOfPictures += frameIt->KeyFrame ? 1 : 0;
+  }
+  while (this->StreamFrames.size() > StreamMaximumNumberOfFrames
+    || numberOfGroupsOfPictures > StreamMaximumNumberOfGroupsOfPictures)
+  {
+    std::deque<StreamFrame>::iterator nextKeyFrame = this->StreamFrames.begin() + 1;
+    while (nextKeyFrame != this->StreamFrames.end() && !nextKeyFrame->KeyFrame)
+    {
+      ++nextKeyFrame;
+    }
+    if (nextKeyFrame == this->StreamFrames.end())
+    {
+      // A single group of pictures fills the stream, its next delta frames are not recorded
+      this->StreamFrames.pop_back();
+      break;
+    }
+    this->StreamFrames.erase(this->StreamFrames.begin(), nextKeyFrame);
+    numberOfGroupsOfPictures--;
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::vtkInternal::RecordMessage(igtl::VideoMessage::Pointer videoMessage)
+{
+  // Unpack a copy, the device keeps using its message
+  igtl::VideoMessage::Pointer message = igtl::VideoMessage::New();
+  message->Copy(videoMessage);
+  if (!(message->Unpack() & igtl::MessageHeader::UNPACK_BODY))
+  {
+    return;
+  }
+  igtlUint32 seconds = 0;
+  igtlUint32 nanoseconds = 0;
+  message->GetTimeStamp(&seconds, &nanoseconds);
+  // The frame type of the message decides, delta frames before the first key frame are dropped
+  bool keyFrame = (message->GetFrameType() == FrameTypeKey);
+  this->AddStreamFrame(message->GetPackFragmentPointer(2), static_cast<unsigned int>(message->GetBitStreamSize()),
+    message->GetWidth(), message->GetHeight(), seconds + nanoseconds * 1.0e-9, keyFrame);
+  this->DecodePending = false;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLBitStreamNode::vtkInternal::GetEncodeGeometry(vtkImageData* image, int region[4], int& outputWidth, int& outputHeight)
+{
+  if (image == NULL || image->GetScalarType() != VTK_UNSIGNED_CHAR)
+  {
+    return false;
+  }
+  int* dimensions = image->GetDimensions();
+  region[0] = 0;
+  region[1] = 0;
+  region[2] = dimensions[0];
+  region[3] = dimensions[1];
+  int* encodeRegion = this->External->EncodeRegion;
+  if (encodeRegion[2] > 0 && encodeRegion[3] > 0)
+  {
+    region[0] = std::max(0, std::min(encodeRegion[0], dimensions[0] - 1));
+    region[1] = std::max(0, std::min(encodeRegion[1], dimensions[1] - 1));
+    region[2] = std::min(encodeRegion[2], dimensions[0] - region[0]);
+    region[3] = std::min(encodeRegion[3], dimensions[1] - region[1]);
+  }
+  // The I420 encoders need even frame dimensions
+  outputWidth = std::max(2, static_cast<int>(region[2] * this->External->EncodeScale) & ~1);
+  outputHeight = std::max(2, static_cast<int>(region[3] * this->External->EncodeScale) & ~1);
+  return region[2] != dimensions[0] || region[3] != dimensions[1] || this->External->EncodeScale < 1.0;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLBitStreamNode::vtkInternal::DecodeStreamFrames()
 {
-  if (this->videoDevice == NULL)
+  this->DecodePending = false;
+  GenericDecoder* decoder = this->GetDecoder(this->External->codecName);
+  if (decoder == NULL)
   {
-    igtl::MessageHeader::Pointer headerMsg = igtl::MessageHeader::New();
-    headerMsg->Copy(videoMessage);
-    this->External->SetUpVideoDeviceByName(headerMsg->GetDeviceName());
+    vtkWarningWithObjectMacro(this->External, "DecodeStreamFrames: no decoder available for codec " << this->External->codecName);
+    return false;
   }
-  if (this->External->GetImageData() != this->videoDevice->GetContent().image)
+  // Only the last frame stays displayed, it is decoded from the last key frame
+  bool success = !this->StreamFrames.empty();
+  std::deque<StreamFrame>::iterator frameIt = this->StreamFrames.end();
+  while (frameIt != this->StreamFrames.begin() && !(frameIt - 1)->KeyFrame)
   {
-    this->External->SetAndObserveImageData(this->videoDevice->GetContent().image);
+    --frameIt;
   }
-  if (this->videoDevice->ReceiveIGTLMessage(static_cast<igtl::MessageBase::Pointer>(videoMessage), false))
+  if (frameIt != this->StreamFrames.begin())
   {
-    this->External->Modified();
+    --frameIt;
   }
+  for (; frameIt != this->StreamFrames.end(); ++frameIt)
+  {
+    success = this->DecodeBitStream(decoder, &frameIt->BitStream[0], frameIt->BitStream.size(),
+      frameIt->Width, frameIt->Height) && success;
+  }
+  return success;
+}
+
+//---------------------------------------------------------------------------
+vtkSmartPointer<vtkImageData> vtkMRMLBitStreamNode::vtkInternal::GetFrameFromPool(vtkImageData* frame)
+{
+  vtkSmartPointer<vtkImageData> image;
+  if (!this->FramePool.empty())
+  {
+    image = this->FramePool.back();
+    this->FramePool.pop_back();
+  }
+  else
+  {
+    image = vtkSmartPointer<vtkImageData>::New();
+  }
+  // DeepCopy reuses the scalar buffer of the pooled image if the frame size did not change
+  image->DeepCopy(frame);
+  return image;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::vtkInternal::ReturnFrameToPool(vtkImageData* frame)
+{
+  if (frame && this->FramePool.size() < JitterBufferMaximumNumberOfFrames)
+  {
+    this->FramePool.push_back(frame);
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::vtkInternal::QueueFrame(vtkImageData* frame, double timestamp)
+{
+  double currentTime = vtkTimerLog::GetUniversalTime();
+  if (timestamp <= 0.0)
+  {
+    // Time stamp is not set by the sender, frames are played in order of arrival
+    timestamp = currentTime;
+  }
+  if (this->LastReleasedTimestamp >= 0.0 && timestamp <= this->LastReleasedTimestamp)
+  {
+    // A newer frame has already been displayed
+    return;
+  }
+
+  double clockOffset = currentTime - timestamp;
+  if (!this->ClockOffsetValid)
+  {
+    this->ClockOffset = clockOffset;
+    this->ClockOffsetValid = true;
+  }
+  else
+  {
+    this->ClockOffset = std::min(clockOffset, this->ClockOffset + JitterBufferClockOffsetRelaxation);
+  }
+
+  this->FrameQueue.insert(FrameQueueType::value_type(timestamp, this->GetFrameFromPool(frame)));
+  while (this->FrameQueue.size() > JitterBufferMaximumNumberOfFrames)
+  {
+    this->ReturnFrameToPool(this->FrameQueue.begin()->second);
+    this->FrameQueue.erase(this->FrameQueue.begin());
+  }
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::vtkInternal::ReleaseDueFrames(double currentTime)
+{
+  // Frames are due when their timestamp, mapped to local time, is older than the target delay.
+  // One due frame is displayed per update, in timestamp order, so that each frame is shown
+  // for about its own frame interval.
+  double releaseTimestamp = currentTime - this->ClockOffset - this->External->JitterBufferDelay;
+  FrameQueueType::iterator dueFrame = this->FrameQueue.begin();
+  if (dueFrame == this->FrameQueue.end() || dueFrame->first > releaseTimestamp)
+  {
+    return;
+  }
+  // Skip frames that are too late to be displayed while a newer frame is due
+  FrameQueueType::iterator nextFrame = dueFrame;
+  ++nextFrame;
+  while (nextFrame != this->FrameQueue.end() && nextFrame->first <= releaseTimestamp
+    && dueFrame->first < releaseTimestamp - JitterBufferMaximumLateness)
+  {
+    this->ReturnFrameToPool(dueFrame->second);
+    this->FrameQueue.erase(dueFrame);
+    dueFrame = nextFrame++;
+  }
+
+  vtkSmartPointer<vtkImageData> previousFrame = this->DisplayedFrame;
+  this->DisplayedFrame = dueFrame->second;
+  this->LastReleasedTimestamp = dueFrame->first;
+  this->FrameQueue.erase(dueFrame);
+
+  this->External->SetAndObserveImageData(this->DisplayedFrame);
+  this->ReturnFrameToPool(previousFrame);
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::vtkInternal::ClearFrameQueue()
+{
+  for (FrameQueueType::iterator it = this->FrameQueue.begin(); it != this->FrameQueue.end(); ++it)
+  {
+    this->ReturnFrameToPool(it->second);
+  }
+  this->FrameQueue.clear();
+  this->ClockOffsetValid = false;
+  this->LastReleasedTimestamp = -1.0;
 }
 
 //----------------------------------------------------------------------------
@@ -157,6 +530,12 @@ vtkMRMLBitStreamNode::vtkMRMLBitStreamNode()
   isKeyFrameDecoded = false;
   isKeyFrameUpdated = false;
   MessageBufferValid = false;
+  LowLatencyMode = true;
+  JitterBufferDelay = 0.1;
+  EncodeRegion[0] = EncodeRegion[1] = EncodeRegion[2] = EncodeRegion[3] = 0;
+  EncodeScale = 1.0;
+  OutgoingDeviceType = "VIDEO";
+  RecordStream = true;
 }
 
 //-----------------------------------------------------------------------------
@@ -183,16 +562,33 @@ void vtkMRMLBitStreamNode::ProcessDeviceModifiedEvents( vtkObject *caller, unsig
     {
     return;
     }
-  igtl::VideoMessage::Pointer videoMsg = modifiedDevice->GetCompressedIGTLMessage();
+  // Frames converted by vtkIGTLVideoDevice are not in the OpenIGTLinkIO message buffers
+  vtkIGTLVideoDevice* convertingDevice = vtkIGTLVideoDevice::SafeDownCast(modifiedDevice);
+  bool converted = convertingDevice && convertingDevice->GetLastFrameConverted();
+  igtl::VideoMessage::Pointer videoMsg = converted ? convertingDevice->GetReceivedMessage()
+                                                   : modifiedDevice->GetCompressedIGTLMessage();
+  if (videoMsg.IsNull())
+    {
+    return;
+    }
+  if (this->RecordStream)
+    {
+    this->Internal->RecordMessage(videoMsg);
+    }
   igtl_header* h = (igtl_header*) videoMsg->GetPackPointer();
   igtl_header_convert_byte_order(h);
   this->SetIsCopied(false);
   this->SetKeyFrameUpdated(false);
-  this->codecName = modifiedDevice->GetCurrentCodecType();
+  this->codecName = converted ? convertingDevice->GetReceivedCodecType() : modifiedDevice->GetCurrentCodecType();
   this->Internal->SetMessageStream(videoMsg);
-  if(!this->GetKeyFrameReceivedFlag() || modifiedDevice->GetContent().keyFrameUpdated)
+  // Only a received key frame updates the key frame stream, a delta frame is not decodable alone
+  igtl::VideoMessage::Pointer keyFrameMsg;
+  if (modifiedDevice->GetContent().keyFrameUpdated)
+    {
+    keyFrameMsg = converted ? convertingDevice->GetReceivedKeyFrameMessage() : modifiedDevice->GetKeyFrameMessage();
+    }
+  if (keyFrameMsg.IsNotNull())
     {
-    igtl::VideoMessage::Pointer keyFrameMsg = modifiedDevice->GetKeyFrameMessage();
     igtl_header* h = (igtl_header*) keyFrameMsg->GetPackPointer();
     igtl_header_convert_byte_order(h);
     this->Internal->SetKeyFrameStream(keyFrameMsg);
@@ -223,10 +619,154 @@ void vtkMRMLBitStreamNode::SetUpVideoDeviceByName(const char* name)
 }
 
 
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::SetOutgoingDeviceType(const std::string& deviceType)
+{
+  if (deviceType != "VIDEO" && deviceType != "LLVIDEO")
+  {
+    vtkErrorMacro("SetOutgoingDeviceType: unsupported device type " << deviceType);
+    return;
+  }
+  if (this->OutgoingDeviceType == deviceType)
+  {
+    return;
+  }
+  this->OutgoingDeviceType = deviceType;
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkMRMLBitStreamNode::GetEncodeImageData()
+{
+  vtkImageData* image = this->GetImageData();
+  int region[4] = { 0, 0, 0, 0 };
+  int outputWidth = 0;
+  int outputHeight = 0;
+  if (!this->Internal->GetEncodeGeometry(image, region, outputWidth, outputHeight))
+  {
+    return image;
+  }
+
+  if (this->Internal->EncodeImage == NULL)
+  {
+    this->Internal->EncodeImage = vtkSmartPointer<vtkImageData>::New();
+  }
+  if (!vtkIGTLImageResampler::Resample(image, region, outputWidth, outputHeight, this->Internal->EncodeImage))
+  {
+    vtkErrorMacro("GetEncodeImageData: failed to resample the encode region");
+    return image;
+  }
+  return this->Internal->EncodeImage;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::GetEncodeIJKToRASMatrix(vtkMatrix4x4* ijkToRAS)
+{
+  if (ijkToRAS == NULL)
+  {
+    return;
+  }
+  this->GetIJKToRASMatrix(ijkToRAS);
+  int region[4] = { 0, 0, 0, 0 };
+  int outputWidth = 0;
+  int outputHeight = 0;
+  if (!this->Internal->GetEncodeGeometry(this->GetImageData(), region, outputWidth, outputHeight))
+  {
+    return;
+  }
+  // Encoded pixel (i, j) is interpolated at (x + (i + 0.5) * scaleX - 0.5, y + (j + 0.5) * scaleY - 0.5)
+  double scaleX = static_cast<double>(region[2]) / outputWidth;
+  double scaleY = static_cast<double>(region[3]) / outputHeight;
+  vtkSmartPointer<vtkMatrix4x4> encodeToImage = vtkSmartPointer<vtkMatrix4x4>::New();
+  encodeToImage->SetElement(0, 0, scaleX);
+  encodeToImage->SetElement(1, 1, scaleY);
+  encodeToImage->SetElement(0, 3, region[0] + 0.5 * scaleX - 0.5);
+  encodeToImage->SetElement(1, 3, region[1] + 0.5 * scaleY - 0.5);
+  vtkMatrix4x4::Multiply4x4(ijkToRAS, encodeToImage, ijkToRAS);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::SetRecordStream(bool record)
+{
+  if (this->RecordStream == record)
+  {
+    return;
+  }
+  this->RecordStream = record;
+  if (!record)
+  {
+    this->Internal->StreamFrames.clear();
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::SetLowLatencyMode(bool lowLatency)
+{
+  if (this->LowLatencyMode == lowLatency)
+  {
+    return;
+  }
+  this->LowLatencyMode = lowLatency;
+  if (lowLatency)
+  {
+    this->Internal->ClearFrameQueue();
+  }
+  this->Modified();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::PushDecodedFrame(vtkImageData* frame, double timestamp)
+{
+  if (frame == NULL)
+  {
+    return;
+  }
+  if (this->LowLatencyMode)
+  {
+    if (this->GetImageData() != frame)
+    {
+      this->SetAndObserveImageData(frame);
+    }
+    return;
+  }
+  this->Internal->QueueFrame(frame, timestamp);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::UpdateJitterBuffer()
+{
+  if (this->LowLatencyMode || this->Internal->FrameQueue.empty())
+  {
+    return;
+  }
+  this->Internal->ReleaseDueFrames(vtkTimerLog::GetUniversalTime());
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::ClearJitterBuffer()
+{
+  this->Internal->ClearFrameQueue();
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLBitStreamNode::GetNumberOfBufferedFrames()
+{
+  return static_cast<int>(this->Internal->FrameQueue.size());
+}
+
 //----------------------------------------------------------------------------
 void vtkMRMLBitStreamNode::WriteXML(ostream& of, int nIndent)
 {
   Superclass::WriteXML(of, nIndent);
+
+  of << " lowLatencyMode=\"" << (this->LowLatencyMode ? "true" : "false") << "\"";
+  of << " jitterBufferDelay=\"" << this->JitterBufferDelay << "\"";
+  of << " encodeRegion=\"" << this->EncodeRegion[0] << " " << this->EncodeRegion[1] << " "
+     << this->EncodeRegion[2] << " " << this->EncodeRegion[3] << "\"";
+  of << " encodeScale=\"" << this->EncodeScale << "\"";
+  of << " outgoingDeviceType=\"" << this->OutgoingDeviceType << "\"";
+  of << " recordStream=\"" << (this->RecordStream ? "true" : "false") << "\"";
 }
 
 //----------------------------------------------------------------------------
@@ -235,7 +775,51 @@ void vtkMRMLBitStreamNode::ReadXMLAttributes(const char** atts)
   int disabledModify = this->StartModify();
   
   Superclass::ReadXMLAttributes(atts);
-  
+
+  const char* attName;
+  const char* attValue;
+  while (*atts != NULL)
+    {
+    attName = *(atts++);
+    attValue = *(atts++);
+    if (!strcmp(attName, "lowLatencyMode"))
+      {
+      this->SetLowLatencyMode(strcmp(attValue, "true") == 0);
+      }
+    else if (!strcmp(attName, "jitterBufferDelay"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      double delay = 0.0;
+      ss >> delay;
+      this->SetJitterBufferDelay(delay);
+      }
+    else if (!strcmp(attName, "encodeRegion"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      int region[4] = { 0, 0, 0, 0 };
+      ss >> region[0] >> region[1] >> region[2] >> region[3];
+      this->SetEncodeRegion(region);
+      }
+    else if (!strcmp(attName, "encodeScale"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      double scale = 1.0;
+      ss >> scale;
+      this->SetEncodeScale(scale);
+      }
+    else if (!strcmp(attName, "outgoingDeviceType"))
+      {
+      this->SetOutgoingDeviceType(attValue);
+      }
+    else if (!strcmp(attName, "recordStream"))
+      {
+      this->SetRecordStream(!strcmp(attValue, "true"));
+      }
+    }
+
   this->EndModify(disabledModify);
 }
 
@@ -245,6 +829,19 @@ void vtkMRMLBitStreamNode::Copy(vtkMRMLNode *anode)
 {
   int disabledModify = this->StartModify();
   Superclass::Copy(anode);
+  vtkMRMLBitStreamNode* node = vtkMRMLBitStreamNode::SafeDownCast(anode);
+  if (node)
+    {
+    this->SetLowLatencyMode(node->GetLowLatencyMode());
+    this->SetJitterBufferDelay(node->GetJitterBufferDelay());
+    this->SetEncodeRegion(node->GetEncodeRegion());
+    this->SetEncodeScale(node->GetEncodeScale());
+    this->SetOutgoingDeviceType(node->GetOutgoingDeviceType());
+    this->SetRecordStream(node->GetRecordStream());
+    this->codecName = node->codecName;
+    this->Internal->StreamFrames = node->Internal->StreamFrames;
+    this->Internal->DecodePending = node->Internal->DecodePending;
+    }
   this->EndModify(disabledModify);
 }
 
@@ -252,12 +849,136 @@ void vtkMRMLBitStreamNode::Copy(vtkMRMLNode *anode)
 void vtkMRMLBitStreamNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   Superclass::PrintSelf(os,indent);
+
+  os << indent << "LowLatencyMode: " << (this->LowLatencyMode ? "true" : "false") << "\n";
+  os << indent << "JitterBufferDelay: " << this->JitterBufferDelay << "\n";
+  os << indent << "NumberOfBufferedFrames: " << this->Internal->FrameQueue.size() << "\n";
+  os << indent << "EncodeRegion: " << this->EncodeRegion[0] << " " << this->EncodeRegion[1] << " "
+     << this->EncodeRegion[2] << " " << this->EncodeRegion[3] << "\n";
+  os << indent << "EncodeScale: " << this->EncodeScale << "\n";
+  os << indent << "OutgoingDeviceType: " << this->OutgoingDeviceType << "\n";
+  os << indent << "RecordStream: " << (this->RecordStream ? "true" : "false") << "\n";
+  os << indent << "NumberOfStreamFrames: " << this->Internal->StreamFrames.size() << "\n";
+  os << indent << "DecodePending: " << (this->Internal->DecodePending ? "true" : "false") << "\n";
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLStorageNode* vtkMRMLBitStreamNode::CreateDefaultStorageNode()
 {
-  return vtkMRMLNRRDStorageNode::New();
+  // The storage node writes the decoded image when no compressed stream is recorded
+  return vtkMRMLBitStreamStorageNode::New();
+}
+
+//----------------------------------------------------------------------------
+vtkImageData* vtkMRMLBitStreamNode::GetImageData()
+{
+  if (this->Internal->DecodePending)
+  {
+    this->Internal->DecodeStreamFrames();
+  }
+  return Superclass::GetImageData();
+}
+
+//----------------------------------------------------------------------------
+vtkAlgorithmOutput* vtkMRMLBitStreamNode::GetImageDataConnection()
+{
+  if (this->Internal->DecodePending)
+  {
+    this->Internal->DecodeStreamFrames();
+  }
+  return Superclass::GetImageDataConnection();
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLBitStreamNode::GetNumberOfStreamFrames()
+{
+  return static_cast<int>(this->Internal->StreamFrames.size());
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::ClearStreamFrames()
+{
+  this->Internal->StreamFrames.clear();
+  this->Internal->DecodePending = false;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::AddStreamFrame(const unsigned char* bitStream, unsigned int size, int width, int height,
+                                          double timestamp, bool keyFrame)
+{
+  if (bitStream == NULL || size == 0)
+  {
+    vtkErrorMacro("AddStreamFrame: empty frame");
+    return;
+  }
+  this->Internal->AddStreamFrame(bitStream, size, width, height, timestamp, keyFrame);
+}
+
+//----------------------------------------------------------------------------
+const unsigned char* vtkMRMLBitStreamNode::GetStreamFrameData(int index, unsigned int& size)
+{
+  size = 0;
+  if (index < 0 || index >= this->GetNumberOfStreamFrames())
+  {
+    vtkErrorMacro("GetStreamFrameData: invalid frame index " << index);
+    return NULL;
+  }
+  size = static_cast<unsigned int>(this->Internal->StreamFrames[index].BitStream.size());
+  return &this->Internal->StreamFrames[index].BitStream[0];
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLBitStreamNode::GetStreamFrameKeyFrame(int index)
+{
+  if (index < 0 || index >= this->GetNumberOfStreamFrames())
+  {
+    vtkErrorMacro("GetStreamFrameKeyFrame: invalid frame index " << index);
+    return false;
+  }
+  return this->Internal->StreamFrames[index].KeyFrame;
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLBitStreamNode::GetStreamFrameTimestamp(int index)
+{
+  if (index < 0 || index >= this->GetNumberOfStreamFrames())
+  {
+    vtkErrorMacro("GetStreamFrameTimestamp: invalid frame index " << index);
+    return 0.0;
+  }
+  return this->Internal->StreamFrames[index].Timestamp;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::GetStreamFrameDimensions(int index, int dimensions[2])
+{
+  dimensions[0] = 0;
+  dimensions[1] = 0;
+  if (index < 0 || index >= this->GetNumberOfStreamFrames())
+  {
+    vtkErrorMacro("GetStreamFrameDimensions: invalid frame index " << index);
+    return;
+  }
+  dimensions[0] = this->Internal->StreamFrames[index].Width;
+  dimensions[1] = this->Internal->StreamFrames[index].Height;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamNode::SetDecodePending(bool pending)
+{
+  this->Internal->DecodePending = pending && !this->Internal->StreamFrames.empty();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLBitStreamNode::GetDecodePending()
+{
+  return this->Internal->DecodePending;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLBitStreamNode::DecodeStreamFrames()
+{
+  return this->Internal->DecodeStreamFrames();
 }
 
 //----------------------------------------------------------------------------
@@ -37,8 +37,14 @@ public:
   /// Set node attributes
   virtual void ReadXMLAttributes( const char** atts) VTK_OVERRIDE;
   
-  /// Create default storage node or NULL if does not have one
+  /// Create default storage node or NULL if does not have one.
+  /// The compressed stream is stored if it is available, otherwise the decoded image.
   virtual vtkMRMLStorageNode* CreateDefaultStorageNode() VTK_OVERRIDE;
+
+  /// Image data of the volume. Stream frames that were loaded from file
+  /// are decoded on the first access.
+  virtual vtkImageData* GetImageData() VTK_OVERRIDE;
+  virtual vtkAlgorithmOutput* GetImageDataConnection() VTK_OVERRIDE;
   
   ///
   /// Write this node's information to a MRML file in XML format.
@@ -110,7 +116,105 @@ public:
   IGTLDevicePointer GetVideoMessageDevice();
 
   int ObserveOutsideVideoDevice(IGTLDevicePointer devicePtr);
-  
+
+  //----------------------------------------------------------------
+  // Compressed stream
+  //----------------------------------------------------------------
+
+  /// When enabled (default), the node keeps the compressed frames of the last received groups
+  /// of pictures (a key frame and its delta frames), so that the scene is saved with the compressed
+  /// stream instead of decoded frames. At most 600 frames in 8 groups are kept, the oldest group
+  /// is dropped first. Disabling clears the stream frames, the decoded image is then saved.
+  vtkGetMacro(RecordStream, bool);
+  void SetRecordStream(bool record);
+  vtkBooleanMacro(RecordStream, bool);
+
+  int GetNumberOfStreamFrames();
+  void ClearStreamFrames();
+
+#ifndef __VTK_WRAP__
+  /// Append a compressed frame. Delta frames before the first key frame are ignored.
+  void AddStreamFrame(const unsigned char* bitStream, unsigned int size, int width, int height,
+                      double timestamp, bool keyFrame);
+
+  /// Returns the compressed data of a frame and sets its size, or NULL if the index is invalid.
+  const unsigned char* GetStreamFrameData(int index, unsigned int& size);
+#endif
+
+  bool GetStreamFrameKeyFrame(int index);
+  double GetStreamFrameTimestamp(int index);
+  void GetStreamFrameDimensions(int index, int dimensions[2]);
+
+  /// Request decoding of the stream frames on the next image data access.
+  /// Used by the storage node after reading a file.
+  void SetDecodePending(bool pending);
+  bool GetDecodePending();
+
+  /// Decode all stream frames and display the last one. Returns true on success.
+  bool DecodeStreamFrames();
+
+  //----------------------------------------------------------------
+  // Encoding options
+  //----------------------------------------------------------------
+
+  /// Region of the image that is sent when the node is encoded as VIDEO:
+  /// (x, y, width, height) in pixels. A zero width or height selects the full image.
+  vtkGetVector4Macro(EncodeRegion, int);
+  vtkSetVector4Macro(EncodeRegion, int);
+
+  /// Scale applied to the encode region before encoding, 1.0 sends it at full resolution.
+  vtkGetMacro(EncodeScale, double);
+  vtkSetClampMacro(EncodeScale, double, 0.05, 1.0);
+
+  /// Image passed to the video encoder: the encode region of the image data,
+  /// resampled by the encode scale. Returns the image data itself if no crop or scaling is set.
+  /// The spacing and origin of the returned image account for the crop and the scale.
+  vtkImageData* GetEncodeImageData();
+
+  /// IJK to RAS matrix of the encoded frames: the IJK to RAS matrix of the node
+  /// combined with the crop offset and the scale of the encode region.
+  void GetEncodeIJKToRASMatrix(vtkMatrix4x4* ijkToRAS);
+
+  /// Message type used when the node is sent: "VIDEO" (default) for the lossy 8-bit
+  /// video codecs, or "LLVIDEO" for lossless compression of 8 and 16-bit images.
+  /// LLVIDEO frames are sent at full resolution, the encode region and scale are ignored.
+  /// The type is applied when the node is added to a connector as outgoing node.
+  std::string GetOutgoingDeviceType(){return this->OutgoingDeviceType;};
+  void SetOutgoingDeviceType(const std::string& deviceType);
+
+  //----------------------------------------------------------------
+  // Jitter buffer
+  //----------------------------------------------------------------
+
+  /// In low latency mode (default) decoded frames are displayed as soon as they arrive.
+  /// When disabled, frames are held in a jitter buffer, ordered by their OpenIGTLink
+  /// header timestamp and released JitterBufferDelay seconds after their timestamp.
+  vtkGetMacro(LowLatencyMode, bool);
+  void SetLowLatencyMode(bool lowLatency);
+  vtkBooleanMacro(LowLatencyMode, bool);
+
+  /// Target delay of the jitter buffer in seconds.
+  vtkGetMacro(JitterBufferDelay, double);
+  vtkSetClampMacro(JitterBufferDelay, double, 0.0, 2.0);
+
+  /// Add a decoded frame with its OpenIGTLink header timestamp (in seconds).
+  /// In low latency mode the frame is displayed immediately, otherwise a copy of it
+  /// is queued in the jitter buffer. A timestamp of 0 (not set by the sender) is replaced
+  /// by the arrival time of the frame.
+  void PushDecodedFrame(vtkImageData* frame, double timestamp);
+
+  /// Display the oldest frame whose release time has passed, one frame per call.
+  /// Due frames more than 0.2 s late are skipped while a newer frame is due, so that the
+  /// display catches up if it is updated less often than frames arrive.
+  /// Called periodically by the connector node.
+  void UpdateJitterBuffer();
+
+  /// Remove all queued frames from the jitter buffer.
+  void ClearJitterBuffer();
+
+  /// Number of frames currently waiting in the jitter buffer.
+  int GetNumberOfBufferedFrames();
+
 protected:
   vtkMRMLBitStreamNode();
   ~vtkMRMLBitStreamNode();
@@ -129,6 +233,18 @@ protected:
 
   bool MessageBufferValid;
 
+  bool LowLatencyMode;
+
+  double JitterBufferDelay;
+
+  int EncodeRegion[4];
+
+  double EncodeScale;
+
+  std::string OutgoingDeviceType;
+
+  bool RecordStream;
+
 private:
   class vtkInternal;
   vtkInternal * Internal;
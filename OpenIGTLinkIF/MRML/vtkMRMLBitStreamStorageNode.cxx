@@ -0,0 +1,338 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkMRMLBitStreamStorageNode.cxx
+
+==========================================================================*/
+
+// OpenIGTLinkIF MRML includes
+#include "vtkMRMLBitStreamStorageNode.h"
+#include "vtkMRMLBitStreamNode.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+
+// STD includes
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+  const char BitStreamFileMagic[] = "IGTLBS";
+  const unsigned int BitStreamFileMagicLength = 6;
+  // Version 2 adds the decoded image, written when no compressed frames are recorded
+  const unsigned short BitStreamFileVersion = 2;
+  const unsigned char BitStreamFrameFlagKeyFrame = 0x01;
+
+  //---------------------------------------------------------------------------
+  // Values are written in little endian byte order independently of the platform
+  template <typename T> void WriteValue(std::ostream& stream, T value)
+  {
+    unsigned char bytes[sizeof(T)];
+    for (unsigned int i = 0; i < sizeof(T); ++i)
+    {
+      bytes[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+    stream.write(reinterpret_cast<const char*>(bytes), sizeof(T));
+  }
+
+  //---------------------------------------------------------------------------
+  template <typename T> bool ReadValue(std::istream& stream, T& value)
+  {
+    unsigned char bytes[sizeof(T)];
+    if (!stream.read(reinterpret_cast<char*>(bytes), sizeof(T)))
+    {
+      return false;
+    }
+    value = 0;
+    for (unsigned int i = 0; i < sizeof(T); ++i)
+    {
+      value |= static_cast<T>(bytes[i]) << (8 * i);
+    }
+    return true;
+  }
+
+  //---------------------------------------------------------------------------
+  void WriteDouble(std::ostream& stream, double value)
+  {
+    vtkTypeUInt64 bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    WriteValue(stream, bits);
+  }
+
+  //---------------------------------------------------------------------------
+  bool ReadDouble(std::istream& stream, double& value)
+  {
+    vtkTypeUInt64 bits = 0;
+    if (!ReadValue(stream, bits))
+    {
+      return false;
+    }
+    memcpy(&value, &bits, sizeof(value));
+    return true;
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNodeNewMacro(vtkMRMLBitStreamStorageNode);
+
+//----------------------------------------------------------------------------
+vtkMRMLBitStreamStorageNode::vtkMRMLBitStreamStorageNode()
+{
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLBitStreamStorageNode::~vtkMRMLBitStreamStorageNode()
+{
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamStorageNode::PrintSelf(ostream& os, vtkIndent indent)
+{
+  Superclass::PrintSelf(os,indent);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLBitStreamStorageNode::CanReadInReferenceNode(vtkMRMLNode *refNode)
+{
+  return refNode->IsA("vtkMRMLBitStreamNode");
+}
+
+//----------------------------------------------------------------------------
+const char* vtkMRMLBitStreamStorageNode::GetDefaultWriteFileExtension()
+{
+  return "igtlbs";
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamStorageNode::InitializeSupportedReadFileTypes()
+{
+  this->SupportedReadFileTypes->InsertNextValue("Compressed video stream (.igtlbs)");
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLBitStreamStorageNode::InitializeSupportedWriteFileTypes()
+{
+  this->SupportedWriteFileTypes->InsertNextValue("Compressed video stream (.igtlbs)");
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLBitStreamStorageNode::ReadDataInternal(vtkMRMLNode *refNode)
+{
+  vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(refNode);
+  if (bitStreamNode == NULL)
+    {
+    vtkErrorMacro("ReadDataInternal: reference node is not a BitStream node");
+    return 0;
+    }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty())
+    {
+    vtkErrorMacro("ReadDataInternal: file name not specified");
+    return 0;
+    }
+  std::ifstream file(fullName.c_str(), std::ios::in | std::ios::binary);
+  if (!file.is_open())
+    {
+    vtkErrorMacro("ReadDataInternal: unable to open file " << fullName);
+    return 0;
+    }
+
+  char magic[BitStreamFileMagicLength];
+  vtkTypeUInt16 version = 0;
+  vtkTypeUInt16 codecNameLength = 0;
+  if (!file.read(magic, BitStreamFileMagicLength) || strncmp(magic, BitStreamFileMagic, BitStreamFileMagicLength) != 0
+    || !ReadValue(file, version) || version > BitStreamFileVersion || !ReadValue(file, codecNameLength))
+    {
+    vtkErrorMacro("ReadDataInternal: " << fullName << " is not a supported compressed video stream file");
+    return 0;
+    }
+  std::string codecName(codecNameLength, '\0');
+  vtkTypeUInt32 numberOfFrames = 0;
+  vtkTypeUInt32 numberOfKeyFrames = 0;
+  if ((codecNameLength > 0 && !file.read(&codecName[0], codecNameLength))
+    || !ReadValue(file, numberOfFrames) || !ReadValue(file, numberOfKeyFrames)
+    || numberOfKeyFrames > numberOfFrames)
+    {
+    vtkErrorMacro("ReadDataInternal: invalid header in " << fullName);
+    return 0;
+    }
+  // The key frame index allows seeking without parsing the frames,
+  // the stored frames start with a key frame so it is only validated here.
+  std::vector<vtkTypeUInt32> keyFrameIndices(numberOfKeyFrames);
+  for (vtkTypeUInt32 i = 0; i < numberOfKeyFrames; ++i)
+    {
+    if (!ReadValue(file, keyFrameIndices[i]) || keyFrameIndices[i] >= numberOfFrames)
+      {
+      vtkErrorMacro("ReadDataInternal: invalid key frame index in " << fullName);
+      return 0;
+      }
+    }
+
+  if (numberOfFrames == 0 && version >= 2)
+    {
+    return this->ReadDecodedImage(file, bitStreamNode, codecName) ? 1 : 0;
+    }
+
+  int wasModifying = bitStreamNode->StartModify();
+  bitStreamNode->ClearStreamFrames();
+  bitStreamNode->SetCodecName(codecName);
+  std::vector<unsigned char> frameData;
+  for (vtkTypeUInt32 frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+    vtkTypeUInt8 flags = 0;
+    vtkTypeUInt32 width = 0;
+    vtkTypeUInt32 height = 0;
+    double timestamp = 0.0;
+    vtkTypeUInt32 size = 0;
+    if (!ReadValue(file, flags) || !ReadValue(file, width) || !ReadValue(file, height)
+      || !ReadDouble(file, timestamp) || !ReadValue(file, size) || size == 0)
+      {
+      vtkErrorMacro("ReadDataInternal: invalid frame header " << frameIndex << " in " << fullName);
+      bitStreamNode->ClearStreamFrames();
+      bitStreamNode->EndModify(wasModifying);
+      return 0;
+      }
+    frameData.resize(size);
+    if (!file.read(reinterpret_cast<char*>(&frameData[0]), size))
+      {
+      vtkErrorMacro("ReadDataInternal: truncated frame " << frameIndex << " in " << fullName);
+      bitStreamNode->ClearStreamFrames();
+      bitStreamNode->EndModify(wasModifying);
+      return 0;
+      }
+    bitStreamNode->AddStreamFrame(&frameData[0], size, static_cast<int>(width), static_cast<int>(height),
+      timestamp, (flags & BitStreamFrameFlagKeyFrame) != 0);
+    }
+  // Decoding is deferred until the image is needed
+  bitStreamNode->SetDecodePending(true);
+  bitStreamNode->EndModify(wasModifying);
+  return 1;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLBitStreamStorageNode::ReadDecodedImage(std::istream& file, vtkMRMLBitStreamNode* bitStreamNode,
+                                                   const std::string& codecName)
+{
+  vtkTypeUInt32 dimensions[3] = { 0, 0, 0 };
+  vtkTypeUInt8 numberOfComponents = 0;
+  if (!ReadValue(file, dimensions[0]) || !ReadValue(file, dimensions[1]) || !ReadValue(file, dimensions[2])
+    || !ReadValue(file, numberOfComponents) || numberOfComponents == 0
+    || dimensions[0] == 0 || dimensions[1] == 0 || dimensions[2] == 0)
+    {
+    vtkErrorMacro("ReadDataInternal: invalid image header in " << this->GetFullNameFromFileName());
+    return false;
+    }
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(dimensions[0], dimensions[1], dimensions[2]);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, numberOfComponents);
+  std::streamsize size = static_cast<std::streamsize>(dimensions[0]) * dimensions[1] * dimensions[2] * numberOfComponents;
+  if (!file.read(static_cast<char*>(image->GetScalarPointer()), size))
+    {
+    vtkErrorMacro("ReadDataInternal: truncated image in " << this->GetFullNameFromFileName());
+    return false;
+    }
+  int wasModifying = bitStreamNode->StartModify();
+  bitStreamNode->ClearStreamFrames();
+  bitStreamNode->SetCodecName(codecName);
+  bitStreamNode->SetAndObserveImageData(image);
+  bitStreamNode->EndModify(wasModifying);
+  return true;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLBitStreamStorageNode::WriteDataInternal(vtkMRMLNode *refNode)
+{
+  vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(refNode);
+  if (bitStreamNode == NULL)
+    {
+    vtkErrorMacro("WriteDataInternal: reference node is not a BitStream node");
+    return 0;
+    }
+  int numberOfFrames = bitStreamNode->GetNumberOfStreamFrames();
+  vtkImageData* image = NULL;
+  if (numberOfFrames == 0)
+    {
+    // Recording was disabled or no key frame was received yet
+    image = bitStreamNode->GetImageData();
+    if (image == NULL || image->GetScalarType() != VTK_UNSIGNED_CHAR || image->GetScalarPointer() == NULL)
+      {
+      vtkErrorMacro("WriteDataInternal: " << bitStreamNode->GetID() << " has no compressed stream or 8-bit image to write");
+      return 0;
+      }
+    }
+
+  std::string fullName = this->GetFullNameFromFileName();
+  if (fullName.empty())
+    {
+    vtkErrorMacro("WriteDataInternal: file name not specified");
+    return 0;
+    }
+  std::ofstream file(fullName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+    {
+    vtkErrorMacro("WriteDataInternal: unable to open file " << fullName << " for writing");
+    return 0;
+    }
+
+  std::string codecName = bitStreamNode->GetCodecName();
+  std::vector<vtkTypeUInt32> keyFrameIndices;
+  for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+    if (bitStreamNode->GetStreamFrameKeyFrame(frameIndex))
+      {
+      keyFrameIndices.push_back(static_cast<vtkTypeUInt32>(frameIndex));
+      }
+    }
+
+  file.write(BitStreamFileMagic, BitStreamFileMagicLength);
+  WriteValue(file, static_cast<vtkTypeUInt16>(BitStreamFileVersion));
+  WriteValue(file, static_cast<vtkTypeUInt16>(codecName.size()));
+  file.write(codecName.c_str(), codecName.size());
+  WriteValue(file, static_cast<vtkTypeUInt32>(numberOfFrames));
+  WriteValue(file, static_cast<vtkTypeUInt32>(keyFrameIndices.size()));
+  for (std::vector<vtkTypeUInt32>::iterator it = keyFrameIndices.begin(); it != keyFrameIndices.end(); ++it)
+    {
+    WriteValue(file, *it);
+    }
+  for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+    unsigned int size = 0;
+    const unsigned char* data = bitStreamNode->GetStreamFrameData(frameIndex, size);
+    int dimensions[2] = { 0, 0 };
+    bitStreamNode->GetStreamFrameDimensions(frameIndex, dimensions);
+    WriteValue(file, static_cast<vtkTypeUInt8>(bitStreamNode->GetStreamFrameKeyFrame(frameIndex) ? BitStreamFrameFlagKeyFrame : 0));
+    WriteValue(file, static_cast<vtkTypeUInt32>(dimensions[0]));
+    WriteValue(file, static_cast<vtkTypeUInt32>(dimensions[1]));
+    WriteDouble(file, bitStreamNode->GetStreamFrameTimestamp(frameIndex));
+    WriteValue(file, static_cast<vtkTypeUInt32>(size));
+    file.write(reinterpret_cast<const char*>(data), size);
+    }
+  if (image)
+    {
+    int* dimensions = image->GetDimensions();
+    WriteValue(file, static_cast<vtkTypeUInt32>(dimensions[0]));
+    WriteValue(file, static_cast<vtkTypeUInt32>(dimensions[1]));
+    WriteValue(file, static_cast<vtkTypeUInt32>(dimensions[2]));
+    WriteValue(file, static_cast<vtkTypeUInt8>(image->GetNumberOfScalarComponents()));
+    file.write(static_cast<const char*>(image->GetScalarPointer()),
+      static_cast<std::streamsize>(dimensions[0]) * dimensions[1] * dimensions[2] * image->GetNumberOfScalarComponents());
+    }
+
+  if (!file.good())
+    {
+    vtkErrorMacro("WriteDataInternal: failed to write " << fullName);
+    return 0;
+    }
+  return 1;
+}
@@ -0,0 +1,82 @@
+/*==========================================================================
+
+  Portions (c) Copyright 2008-2009 Brigham and Women's Hospital (BWH) All Rights Reserved.
+
+  See Doc/copyright/copyright.txt
+  or http://www.slicer.org/copyright/copyright.txt for details.
+
+  Program:   3D Slicer
+  Module:    vtkMRMLBitStreamStorageNode.h
+
+==========================================================================*/
+
+#ifndef __vtkMRMLBitStreamStorageNode_h
+#define __vtkMRMLBitStreamStorageNode_h
+
+// OpenIGTLinkIF MRML includes
+#include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+
+// MRML includes
+#include <vtkMRMLStorageNode.h>
+
+// STD includes
+#include <iosfwd>
+#include <string>
+
+class vtkMRMLBitStreamNode;
+
+/// \brief Storage node writing the compressed stream of a BitStream volume.
+///
+/// The container (.igtlbs) holds the codec name, the recorded compressed frames with their
+/// timestamps and key frame flags, and an index of the key frames.
+/// All values are little endian:
+///   "IGTLBS" magic, uint16 version, uint16 codec name length, codec name,
+///   uint32 number of frames, uint32 number of key frames, uint32 key frame indices[],
+///   per frame: uint8 flags (1: key frame), uint32 width, uint32 height,
+///              float64 timestamp, uint32 size, compressed data.
+/// If the node has no recorded frames (version 2), the decoded image follows instead:
+///   uint32 dimensions[3], uint8 number of components, 8-bit scalars.
+/// Frames are not decoded when the file is read, the BitStream node decodes them
+/// when its image data is first accessed.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLBitStreamStorageNode : public vtkMRMLStorageNode
+{
+public:
+  static vtkMRMLBitStreamStorageNode *New();
+  vtkTypeMacro(vtkMRMLBitStreamStorageNode, vtkMRMLStorageNode);
+  void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
+
+  virtual vtkMRMLNode* CreateNodeInstance() VTK_OVERRIDE;
+
+  ///
+  /// Get node XML tag name (like Storage, Model)
+  virtual const char* GetNodeTagName() VTK_OVERRIDE {return "BitStreamStorage";};
+
+  /// Return true if the node can be read in
+  virtual bool CanReadInReferenceNode(vtkMRMLNode* refNode) VTK_OVERRIDE;
+
+  /// Return a default file extension for writing
+  virtual const char* GetDefaultWriteFileExtension() VTK_OVERRIDE;
+
+protected:
+  vtkMRMLBitStreamStorageNode();
+  ~vtkMRMLBitStreamStorageNode();
+  vtkMRMLBitStreamStorageNode(const vtkMRMLBitStreamStorageNode&);
+  void operator=(const vtkMRMLBitStreamStorageNode&);
+
+  /// Initialize all the supported read file types
+  virtual void InitializeSupportedReadFileTypes() VTK_OVERRIDE;
+
+  /// Initialize all the supported write file types
+  virtual void InitializeSupportedWriteFileTypes() VTK_OVERRIDE;
+
+  /// Read data and set it in the referenced node
+  virtual int ReadDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
+
+  /// Write data from a referenced node
+  virtual int WriteDataInternal(vtkMRMLNode *refNode) VTK_OVERRIDE;
+
+  /// Read the decoded image stored instead of compressed frames
+  bool ReadDecodedImage(std::istream& file, vtkMRMLBitStreamNode* bitStreamNode, const std::string& codecName);
+};
+
+#endif
@@ -25,9 +25,33 @@ Version:   $Revision: 1.2 $
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
   #include "igtlioVideoDevice.h"
   #include <vtkMRMLBitStreamNode.h>
+  #include "vtkIGTLLosslessVideoDevice.h"
+  #include "vtkIGTLVideoDevice.h"
 #endif
 // OpenIGTLinkIF MRML includes
 #include "vtkMRMLIGTLConnectorNode.h"
+#include "vtkMRMLIGTLTrackingDataBundleNode.h"
+#include "vtkMRMLIGTLTrackingDataQueryNode.h"
+#include "vtkIGTLTrackingDataDevice.h"
+#include "vtkIGTLQuaternionTrackingDataDevice.h"
+#include "vtkIGTLPositionDevice.h"
+#include "vtkIGTLImageMetaDevice.h"
+#include "vtkIGTLLabelMetaDevice.h"
+#include "vtkIGTLCapabilityDevice.h"
+#include "vtkIGTLClockOffsetEstimator.h"
+#include "vtkIGTLCommandDispatcher.h"
+#include "vtkIGTLCommandHandle.h"
+#include "vtkIGTLCommandRequest.h"
+#include "vtkIGTLCommandResponseCache.h"
+#include "vtkIGTLLatencyHistogram.h"
+#include "vtkIGTLQueryManager.h"
+#include "vtkIGTLSceneImageIndex.h"
+#include "vtkIGTLServedImageDevice.h"
+#include "vtkIGTLSubscriptionManager.h"
+#include "vtkIGTLPoseHistory.h"
+#include "vtkIGTLPosePredictor.h"
+#include "vtkIGTLTransformFilter.h"
+#include "vtkIGTLXMLDocument.h"
 #include "vtkMRMLVolumeNode.h"
 #include <vtkMRMLScalarVolumeNode.h>
 #include <vtkMRMLScalarVolumeDisplayNode.h>
@@ -36,10 +60,13 @@ Version:   $Revision: 1.2 $
 #include <vtkMRMLModelNode.h>
 #include <vtkMRMLTextNode.h>
 #include <vtkMRMLIGTLStatusNode.h>
+#include <vtkMRMLImageMetaListNode.h>
+#include <vtkMRMLLabelMetaListNode.h>
 #include <vtkMRMLLinearTransformNode.h>
 #include <vtkMRMLColorLogic.h>
 #include <vtkMRMLColorTableNode.h>
 #include <vtkCollection.h>
+#include <vtkMultiThreader.h>
 #include <vtkMutexLock.h>
 #include <vtkTimerLog.h>
 #include <vtkImageData.h>
@@ -49,8 +76,51 @@ Version:   $Revision: 1.2 $
 // VTK include
 #include <vtksys/SystemTools.hxx>
 
+// STD includes
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <sstream>
+
 #define MEMLNodeNameKey "MEMLNodeName"
 
+// Clock synchronization ping, answered by the remote connector with its receive and send times.
+// Only commands with both names are pings, other GetClockTime commands are passed to the application.
+#define ClockPingDeviceName "SlicerClockSync"
+#define ClockPingCommandName "GetClockTime"
+#define ClockPingTimeout 2.0
+
+// Time during which the connector keeps a completed handle returned by SendCommandAsync, in seconds
+#define CommandHandleRetentionTime 60.0
+
+// Poses kept for a predicted transform when the pose history is disabled
+#define MinimumPredictionHistoryCapacity 32
+
+// Attribute of an outgoing node that selects its message type (see RegisterOutgoingMRMLNode)
+#define OutgoingDeviceTypeAttributeName "OpenIGTLinkIF.out.type"
+
+namespace
+{
+  //----------------------------------------------------------------------------
+  // TDATA and QTDATA devices share the tool storage of vtkIGTLTrackingDataDevice
+  bool IsTrackingDataDeviceType(const std::string& deviceType)
+  {
+    return deviceType.compare(vtkIGTLTrackingDataDevice::GetIGTLTypeName()) == 0
+      || deviceType.compare(vtkIGTLQuaternionTrackingDataDevice::GetIGTLTypeName()) == 0;
+  }
+
+  //----------------------------------------------------------------------------
+  // Message types of incoming poses, in the order used to find the type of a name
+  const int NumberOfPoseDeviceTypes = 4;
+  const char* GetPoseDeviceType(int index)
+  {
+    static const char* deviceTypes[NumberOfPoseDeviceTypes] = { "TRANSFORM", vtkIGTLPositionDevice::GetIGTLTypeName(),
+      vtkIGTLTrackingDataDevice::GetIGTLTypeName(), vtkIGTLQuaternionTrackingDataDevice::GetIGTLTypeName() };
+    return deviceTypes[index];
+  }
+}
+
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLIGTLConnectorNode);
 
@@ -64,15 +134,55 @@ public:
 
   ///  Send the given command from the given device.
   /// - If using BLOCKING, the call blocks until a response appears or timeout. Return response.
+  ///   On the processing thread the call cannot block, it returns NULL and the response is received
+  ///   by the next PeriodicProcess.
   /// - If using ASYNCHRONOUS, wait for the CommandResponseReceivedEvent event. Return device.
   ///
   igtlio::CommandDevicePointer SendCommand(std::string device_id, std::string command, std::string content, igtlio::SYNCHRONIZATION_TYPE synchronized = igtlio::BLOCKING, double timeout_s = 5);
 
+  /// Queue the given command and return a handle that is completed when the response arrives
+  /// or the timeout expires. The command is sent as soon as the command window allows it.
+  /// If useCache is true and the response cache has a valid response, the handle is completed
+  /// with it before returning and the command is not sent.
+  vtkSmartPointer<vtkIGTLCommandHandle> SendCommandAsync(std::string device_id, std::string command, std::string content,
+                                                         double timeout_s, bool useCache = false);
+
+  /// Store a received response in the response cache and complete the handle with it.
+  /// The response content is swapped into the handle, responseContent is left empty.
+  void CompleteCommand(vtkIGTLCommandHandle* handle, const std::string& responseName, std::string& responseContent,
+                       double receiveTime);
+
+  /// Send queued commands while fewer than CommandWindowSize commands are in flight
+  void SendQueuedCommands();
+
+  /// Complete the handle of the command in flight that the received response answers.
+  /// Returns false if the response does not match any command in flight.
+  bool ProcessCommandResponse(igtlio::Device* device, double receiveTime);
+
+  /// Expire the commands in flight whose timeout elapsed, remove cancelled commands
+  /// and send queued commands
+  void UpdatePendingCommands(double currentTime);
+
+  /// True if called from the thread that imports incoming messages (the caller of PeriodicProcess).
+  /// False for all threads until PeriodicProcess is called.
+  bool IsProcessingThread();
+
   /// Send a command response from the given device. Asynchronous.
   /// Precondition: The given device has received a query that is not yet responded to.
   /// Return device.
   igtlio::CommandDevicePointer SendCommandResponse(std::string device_id, std::string command, std::string content);
 
+  /// Send the response of the command with the given ID, which may not be the last command received by the device
+  igtlio::CommandDevicePointer SendCommandResponse(std::string device_id, std::string command, int commandID, std::string content);
+
+  /// Submit a received command to the handler registered for its name. content is the content of
+  /// the command device, its content string is swapped into the request when a handler is found.
+  /// Returns false if no handler is registered for the command.
+  bool DispatchCommand(igtlio::Device* device, igtlio::CommandConverter::ContentData& content, double receiveTime);
+
+  /// Send the responses of the requests completed by command handlers
+  void SendCompletedCommandResponses();
+
   unsigned int AssignOutGoingNodeToDevice(vtkMRMLNode* node, igtlio::DevicePointer device);
 
   void ProcessNewDeviceEvent(vtkObject *caller, unsigned long event, void *callData);
@@ -83,18 +193,235 @@ public:
 
   vtkMRMLNode* GetOrAddMRMLNodeforDevice(igtlio::Device* device);
 
+  /// Complete the waiting tracking data queries of the device when RTS_TDATA is received.
+  void ProcessTrackingDataResponse(vtkIGTLTrackingDataDevice* device);
+
+  /// Complete the waiting GET queries of the message type and device name with STATUS_SUCCESS.
+  void ProcessQueryResponse(const std::string& deviceType, const std::string& deviceName, vtkMRMLNode* responseNode);
+
+  /// Complete the queries whose timeout elapsed with STATUS_EXPIRED.
+  void ExpireQueries(double currentTime);
+
+  /// Set the status of the queries and invoke their ResponseEvent
+  void CompleteQueries(const vtkIGTLQueryManager::QueryListType& queries, int queryStatus, vtkMRMLNode* responseNode);
+
+  /// Record the pose of an incoming transform in its history. senderTimestamp is the time stamp
+  /// of the message (0 if the sender does not set it), arrivalTime is the local time of arrival.
+  void AddPoseToHistory(const std::string& deviceType, const std::string& name, double senderTimestamp,
+                        double arrivalTime, vtkMatrix4x4* matrix);
+
+  /// Replace the matrix by the predicted pose if prediction is enabled for the transform
+  void PredictPose(const std::string& deviceType, const std::string& name, vtkMatrix4x4* matrix);
+
+  /// Smooth the matrix if a filter is set for the transform
+  void FilterPose(const std::string& name, double timestamp, double arrivalTime, vtkMatrix4x4* matrix);
+
+  /// Record the arrival interval and the latency of an incoming tracking message.
+  /// arrivalTime is the local time when the message processing started.
+  void RecordStreamStatistics(const std::string& deviceType, const std::string& name, double timestamp, double arrivalTime);
+
+  /// Time stamp of an incoming message. The remote time is converted to local time
+  /// if the clock offset of the peer is known.
+  double GetLocalTimestamp(igtlio::Device* device);
+
+  /// Send a clock synchronization ping if one is due
+  void UpdateClockSynchronization(double currentTime);
+
+  /// Send a clock synchronization ping now. Returns false if a ping is already pending.
+  bool SendClockPing();
+
+  /// Answer a clock synchronization ping of the peer. Returns false if the command is not a ping.
+  bool ProcessClockPingRequest(igtlio::Device* device, const igtlio::CommandConverter::ContentData& content, double receiveTime);
+
+  /// Add the exchange to the clock offset estimate if the response to the pending ping arrived.
+  /// Returns true if the response was processed.
+  bool ProcessClockPingResponse(double receiveTime);
+
+  /// Send the changed tools of each outgoing tracking data bundle, one TDATA or QTDATA message per bundle
+  void PushModifiedTrackingDataBundles();
+
+  /// Send the STT_ messages of the pending subscriptions and the STP_ messages of the removed ones
+  void SendSubscriptions();
+
+  /// Start or stop pushing the outgoing node of the device at the rate requested by the peer,
+  /// and answer the request with RTS_TDATA or RTS_QTDATA
+  void ProcessStreamingRequest(vtkIGTLTrackingDataDevice* device, bool start, double currentTime);
+
+  /// Push the outgoing nodes of the streams requested by the peer whose push is due
+  void PushSubscribedNodes(double currentTime);
+
+  /// Add the IMGMETA and LBMETA devices that receive the list requests of the peer
+  void AddServedImageMetaDevices();
+
+  /// Add the device that receives the GET_IMAGE requests of a listed image, unless the image already has a device
+  void AddServedImageDevice(const std::string& deviceName);
+
+  /// Index of the volumes of the scene, following the current scene of the connector
+  vtkIGTLSceneImageIndex* GetSceneImageIndex();
+
+  /// Answer GET_IMGMETA or GET_LBMETA with the volumes or label maps of the scene
+  void ProcessImageMetaRequest(igtlio::Device* device);
+
+  /// Answer GET_IMAGE with the listed volume of the device name
+  void ProcessImageRequest(igtlio::Device* device);
+
+  /// Add the CAPABIL device that receives the capability of the peer and its requests
+  void AddCapabilityDevice();
+
+  /// Message types that this connector receives into nodes, sent in answer to GET_CAPABIL
+  std::vector<std::string> GetLocalSupportedTypes();
+
+  /// Answer GET_CAPABIL with the local supported types
+  void ProcessCapabilityRequest();
+
+  /// Cache the types of a CAPABIL message received from the peer
+  void ProcessPeerCapability();
+
+  /// Forget the capability of the peer. Returns true if it was known.
+  bool ClearPeerCapability();
+
+  /// True if the capability of the peer is not known or lists the type
+  bool IsPeerTypeSupported(const std::string& deviceType);
+
+  /// Device types of the node that the peer supports. Types requested for the node fall back
+  /// to the default types of the node. Returned unchanged if the peer supports none of them.
+  std::vector<std::string> SelectPeerSupportedTypes(vtkMRMLNode* node, const std::vector<std::string>& deviceTypes);
+
+  /// Move the outgoing nodes whose device is not of a type selected for the capability of the peer
+  /// to the preferred selected type. Called when the capability is received or cleared.
+  void UpdateOutgoingDevicesForPeer();
+
+  /// ID of the outgoing node sent by the device, empty if the device sends no node
+  std::string GetOutgoingNodeID(igtlio::Device* device);
+
+  /// Create a device, including the message types that the OpenIGTLinkIO device factory does not know.
+  igtlio::DevicePointer CreateDevice(const std::string& deviceType, const std::string& deviceName);
+
+  /// Device types for sending the node, in order of preference.
+  std::vector<std::string> GetOutgoingDeviceTypes(vtkMRMLNode* node);
+  std::vector<std::string> GetRequestedOutgoingDeviceTypes(vtkMRMLNode* node);
+
   vtkMRMLIGTLConnectorNode* External;
   igtlio::ConnectorPointer IOConnector;
 
   typedef std::map<std::string, igtlio::Connector::NodeInfoType>   NodeInfoMapType;
   typedef std::map<std::string, vtkSmartPointer <igtlio::Device> > MessageDeviceMapType;
   typedef std::map<std::string, std::vector<std::string> > DeviceTypeToNodeTagMapType;
+  struct PoseHistoryType
+  {
+    vtkSmartPointer<vtkIGTLPoseHistory> History;
+    // True if the poses are stamped with the sender's clock, false if with the local arrival time
+    bool SenderTime;
+  };
+  // Histories are keyed by message type and name, so that a TDATA tool and a TRANSFORM
+  // of the same name have separate histories
+  typedef std::map<std::pair<std::string, std::string>, PoseHistoryType> PoseHistoryMapType;
+  typedef std::map<std::string, vtkSmartPointer<vtkIGTLPosePredictor> > PosePredictorMapType;
+  typedef std::map<std::string, vtkSmartPointer<vtkIGTLTransformFilter> > TransformFilterMapType;
+
+  struct StreamStatisticsType
+  {
+    vtkSmartPointer<vtkIGTLLatencyHistogram> ArrivalInterval;
+    vtkSmartPointer<vtkIGTLLatencyHistogram> Latency;
+    double LastArrivalTime;
+  };
+  // Keyed by message type and name, as the pose histories
+  typedef std::map<std::pair<std::string, std::string>, StreamStatisticsType> StreamStatisticsMapType;
 
   NodeInfoMapType IncomingMRMLNodeInfoMap;
   MessageDeviceMapType  OutgoingMRMLIDToDeviceMap;
   MessageDeviceMapType  IncomingMRMLIDToDeviceMap;
   DeviceTypeToNodeTagMapType DeviceTypeToNodeTagMap;
 
+  PoseHistoryMapType PoseHistories;
+  int PoseHistoryCapacity;
+
+  /// History of the message type and name, NULL if no pose was received
+  PoseHistoryType* FindPoseHistory(const std::string& deviceType, const std::string& name);
+
+  /// Time of a pose history corresponding to the local time
+  double GetPoseHistoryTime(const PoseHistoryType& history, double localTime);
+  PosePredictorMapType PosePredictors;
+  TransformFilterMapType TransformFilters;
+  StreamStatisticsMapType StreamStatistics;
+
+  /// Statistics of the message type and name, NULL if no message was received
+  StreamStatisticsType* FindStreamStatistics(const char* deviceType, const char* name);
+
+  // Working matrix of incoming transforms, reused for every message
+  vtkSmartPointer<vtkMatrix4x4> IncomingPoseMatrix;
+  // Smoothed tool matrices of incoming tracking data, reused for every message
+  std::vector<double> FilteredToolMatrices;
+
+  // Tools of the outgoing tracking data bundle being sent, reused for every message
+  std::vector<std::string> OutgoingToolNames;
+  std::vector<double> OutgoingToolMatrices;
+  std::vector<int> OutgoingToolTypes;
+
+  vtkSmartPointer<vtkIGTLClockOffsetEstimator> ClockOffsetEstimator;
+  double ClockSynchronizationInterval;
+  igtlio::CommandDevicePointer ClockPingDevice;
+  int ClockPingCommandID;
+  // Local send time of the pending ping, 0 if no ping is pending
+  double ClockPingSendTime;
+  double LastClockPingTime;
+
+  // Commands waiting for a response. Handles may be waited for from other threads.
+  struct QueuedCommandType
+  {
+    vtkSmartPointer<vtkIGTLCommandHandle> Handle;
+    std::string Content;
+  };
+  // Command IDs are counted per command device: commands are identified by device name and ID
+  typedef std::pair<std::string, int> CommandKeyType;
+  typedef std::map<CommandKeyType, vtkSmartPointer<vtkIGTLCommandHandle> > CommandCorrelationMapType;
+  // Correlation table of the commands in flight: command key to handle
+  CommandCorrelationMapType CommandsInFlight;
+  // Commands taken from the queue whose send call has not returned yet. They count in the window.
+  // Responses that arrive before their command is entered in the correlation table are kept meanwhile.
+  struct EarlyCommandResponseType
+  {
+    std::string Name;
+    std::string Content;
+    double ReceiveTime;
+  };
+  int NumberOfCommandsSending;
+  std::map<CommandKeyType, EarlyCommandResponseType> EarlyCommandResponses;
+  // Commands waiting for a free slot in the window, in request order
+  std::deque<QueuedCommandType> QueuedCommands;
+  // Handles returned by SendCommandAsync, kept until CommandHandleRetentionTime after their completion
+  std::vector< vtkSmartPointer<vtkIGTLCommandHandle> > IssuedCommandHandles;
+  int CommandWindowSize;
+  vtkSmartPointer<vtkMutexLock> PendingCommandsMutex;
+  // Responses of commands that are reused until their time to live expires
+  vtkSmartPointer<vtkIGTLCommandResponseCache> CommandResponseCache;
+  // Handlers of incoming commands, run on worker threads
+  vtkSmartPointer<vtkIGTLCommandDispatcher> CommandDispatcher;
+  vtkMultiThreaderIDType ProcessingThreadID;
+  bool ProcessingThreadIDValid;
+
+  // Queries waiting for a response, matched to responses by message type and device name and expired
+  // after their TimeOut. Queries are held by weak pointer. Access it with the QueryQueueMutex of the node locked.
+  vtkSmartPointer<vtkIGTLQueryManager> QueryManager;
+
+  // Streams requested from the peer, and by the peer. Subscriptions may be changed from any thread.
+  vtkSmartPointer<vtkIGTLSubscriptionManager> SubscriptionManager;
+  vtkSmartPointer<vtkMutexLock> SubscriptionMutex;
+
+  // Volumes of the scene listed in answer to GET_IMGMETA and GET_LBMETA
+  bool ServeSceneImages;
+  std::string ServedImageMetaDeviceName;
+  vtkSmartPointer<vtkIGTLSceneImageIndex> SceneImageIndex;
+
+  // Message types of the peer, cached from its CAPABIL message until the connection is closed
+  bool CapabilityNegotiation;
+  vtkSmartPointer<vtkIGTLCapabilityDevice> CapabilityDevice;
+  bool PeerCapabilityKnown;
+  std::vector<std::string> PeerSupportedTypes;
+  std::set<std::string> PeerSupportedTypeSet;
+  // Incremented by PushNode, which may be called from other threads than the one that processes events
+  int NumberOfSuppressedMessages;
+  vtkSmartPointer<vtkMutexLock> SuppressedMessagesMutex;
 };
 
 //----------------------------------------------------------------------------
@@ -105,12 +432,54 @@ vtkMRMLIGTLConnectorNode::vtkInternal::vtkInternal(vtkMRMLIGTLConnectorNode* ext
   : External(external)
 {
   this->IOConnector = igtlio::ConnectorPointer::New();
+  this->PoseHistoryCapacity = 256;
+  this->IncomingPoseMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  this->ClockOffsetEstimator = vtkSmartPointer<vtkIGTLClockOffsetEstimator>::New();
+  this->ClockSynchronizationInterval = 0.0;
+  this->ClockPingCommandID = 0;
+  this->ClockPingSendTime = 0.0;
+  this->LastClockPingTime = 0.0;
+  this->CommandWindowSize = 16;
+  this->NumberOfCommandsSending = 0;
+  this->PendingCommandsMutex = vtkSmartPointer<vtkMutexLock>::New();
+  this->CommandResponseCache = vtkSmartPointer<vtkIGTLCommandResponseCache>::New();
+  this->CommandDispatcher = vtkSmartPointer<vtkIGTLCommandDispatcher>::New();
+  this->ProcessingThreadIDValid = false;
+  this->QueryManager = vtkSmartPointer<vtkIGTLQueryManager>::New();
+  this->SubscriptionManager = vtkSmartPointer<vtkIGTLSubscriptionManager>::New();
+  this->SubscriptionMutex = vtkSmartPointer<vtkMutexLock>::New();
+  this->ServeSceneImages = false;
+  this->ServedImageMetaDeviceName = "Catalog";
+  this->SceneImageIndex = vtkSmartPointer<vtkIGTLSceneImageIndex>::New();
+  this->CapabilityNegotiation = true;
+  this->PeerCapabilityKnown = false;
+  this->NumberOfSuppressedMessages = 0;
+  this->SuppressedMessagesMutex = vtkSmartPointer<vtkMutexLock>::New();
 }
 
 
 //---------------------------------------------------------------------------
 vtkMRMLIGTLConnectorNode::vtkInternal::~vtkInternal()
 {
+  // Wake up the threads that still wait for a response
+  this->PendingCommandsMutex->Lock();
+  std::vector< vtkSmartPointer<vtkIGTLCommandHandle> > pendingCommands;
+  for (CommandCorrelationMapType::iterator iter = this->CommandsInFlight.begin(); iter != this->CommandsInFlight.end(); ++iter)
+  {
+    pendingCommands.push_back(iter->second);
+  }
+  for (size_t i = 0; i < this->QueuedCommands.size(); ++i)
+  {
+    pendingCommands.push_back(this->QueuedCommands[i].Handle);
+  }
+  this->CommandsInFlight.clear();
+  this->QueuedCommands.clear();
+  this->IssuedCommandHandles.clear();
+  this->PendingCommandsMutex->Unlock();
+  for (size_t i = 0; i < pendingCommands.size(); ++i)
+  {
+    pendingCommands[i]->Cancel();
+  }
 }
 
 //----------------------------------------------------------------------------
@@ -147,6 +516,15 @@ unsigned int vtkMRMLIGTLConnectorNode::vtkInternal::AssignOutGoingNodeToDevice(v
     transformDevice->SetContent(content);
     modifiedEvent = vtkMRMLLinearTransformNode::TransformModifiedEvent;
   }
+  else if (device->GetDeviceType().compare(vtkIGTLPositionDevice::GetIGTLTypeName()) == 0)
+  {
+    vtkIGTLPositionDevice* positionDevice = static_cast<vtkIGTLPositionDevice*>(device.GetPointer());
+    vtkMRMLLinearTransformNode* transformNode = vtkMRMLLinearTransformNode::SafeDownCast(node);
+    vtkSmartPointer<vtkMatrix4x4> mat = vtkSmartPointer<vtkMatrix4x4>::New();
+    transformNode->GetMatrixTransformToParent(mat);
+    positionDevice->SetMatrix(mat);
+    modifiedEvent = vtkMRMLLinearTransformNode::TransformModifiedEvent;
+  }
   else if (device->GetDeviceType().compare("POLYDATA") == 0)
   {
     igtlio::PolyDataDevice* polyDevice = static_cast<igtlio::PolyDataDevice*>(device.GetPointer());
@@ -163,6 +541,24 @@ unsigned int vtkMRMLIGTLConnectorNode::vtkInternal::AssignOutGoingNodeToDevice(v
     stringDevice->SetContent(content);
     modifiedEvent = vtkMRMLTextNode::TextModifiedEvent;
   }
+  else if (IsTrackingDataDeviceType(device->GetDeviceType()))
+  {
+    vtkIGTLTrackingDataDevice* trackingDataDevice = static_cast<vtkIGTLTrackingDataDevice*>(device.GetPointer());
+    vtkMRMLIGTLTrackingDataBundleNode* bundleNode = vtkMRMLIGTLTrackingDataBundleNode::SafeDownCast(node);
+    // The tools changed since the last message, or all tools if the bundle is pushed without changes
+    if (bundleNode->GetOutgoingTools(true, this->OutgoingToolNames, this->OutgoingToolMatrices, this->OutgoingToolTypes) == 0)
+    {
+      bundleNode->GetOutgoingTools(false, this->OutgoingToolNames, this->OutgoingToolMatrices, this->OutgoingToolTypes);
+    }
+    trackingDataDevice->ClearTools();
+    for (size_t i = 0; i < this->OutgoingToolNames.size(); ++i)
+    {
+      trackingDataDevice->AddTool(this->OutgoingToolNames[i].c_str(), this->OutgoingToolTypes[i],
+                                  &this->OutgoingToolMatrices[16 * i]);
+    }
+    // Transform changes are collected and sent once per PeriodicProcess, not on node events
+    return 0;
+  }
   else if (device->GetDeviceType().compare("COMMAND") == 0)
   {
     return 0;
@@ -174,7 +570,8 @@ unsigned int vtkMRMLIGTLConnectorNode::vtkInternal::AssignOutGoingNodeToDevice(v
     igtlio::VideoDevice* videoDevice = static_cast<igtlio::VideoDevice*>(device.GetPointer());
     vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(node);
     igtlio::VideoConverter::ContentData content;
-    content.image = bitStreamNode->GetImageData();
+    // Only the encode region, at the encode scale, is passed to the encoder
+    content.image = bitStreamNode->GetEncodeImageData();
     content.frameType = FrameTypeUnKnown;
     strncpy(content.codecName, videoDevice->GetCurrentCodecType().c_str(), IGTL_VIDEO_CODEC_NAME_SIZE);
     content.keyFrameMessage = NULL;
@@ -183,1334 +580,3292 @@ unsigned int vtkMRMLIGTLConnectorNode::vtkInternal::AssignOutGoingNodeToDevice(v
     videoDevice->SetContent(content);
     modifiedEvent = vtkMRMLBitStreamNode::ImageDataModifiedEvent;
   }
+  else if (device->GetDeviceType().compare(vtkIGTLLosslessVideoDevice::GetIGTLTypeName()) == 0)
+  {
+    vtkIGTLLosslessVideoDevice* losslessDevice = static_cast<vtkIGTLLosslessVideoDevice*>(device.GetPointer());
+    vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(node);
+    losslessDevice->SetImage(bitStreamNode->GetImageData());
+    modifiedEvent = vtkMRMLBitStreamNode::ImageDataModifiedEvent;
+  }
 #endif
   return modifiedEvent;
 }
 
 //----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessNewDeviceEvent(vtkObject *caller, unsigned long event, void *callData)
-{
-}
-
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessOutgoingDeviceModifiedEvent(vtkObject *caller, unsigned long event, igtlio::Device * modifiedDevice)
-{
-  this->IOConnector->SendMessage(CreateDeviceKey(modifiedDevice), modifiedDevice->MESSAGE_PREFIX_NOT_DEFINED);
-}
-
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessIncomingDeviceModifiedEvent(vtkObject *caller, unsigned long event, igtlio::Device * modifiedDevice)
+void vtkMRMLIGTLConnectorNode::vtkInternal::PushModifiedTrackingDataBundles()
 {
-  vtkMRMLNode* modifiedNode = this->GetOrAddMRMLNodeforDevice(modifiedDevice);
-  const std::string deviceType = modifiedDevice->GetDeviceType();
-  const std::string deviceName = modifiedDevice->GetDeviceName();
-  if (this->External->GetNodeTagFromDeviceType(deviceType.c_str()).size() > 0)
+  vtkMRMLScene* scene = this->External->GetScene();
+  if (scene == NULL || this->IOConnector->GetState() != igtlio::Connector::STATE_CONNECTED)
   {
-    if (strcmp(deviceType.c_str(), "IMAGE") == 0)
-    {
-      igtlio::ImageDevice* imageDevice = reinterpret_cast<igtlio::ImageDevice*>(modifiedDevice);
-      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
-      {
-        if (strcmp(modifiedNode->GetNodeTagName(), "Volume") == 0 ||
-            strcmp(modifiedNode->GetNodeTagName(), "VectorVolume") == 0
-            )
-        {
-          vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(modifiedNode);
-          volumeNode->SetIJKToRASMatrix(imageDevice->GetContent().transform);
-          volumeNode->SetAndObserveImageData(imageDevice->GetContent().image);
-          volumeNode->Modified();
-        }
-#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
-        else if (strcmp(modifiedNode->GetNodeTagName(), "BitStream") == 0)
-        {
-          vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(modifiedNode);
-          bitStreamNode->SetAndObserveImageData(imageDevice->GetContent().image);
-          bitStreamNode->SetIJKToRASMatrix(imageDevice->GetContent().transform);
-          bitStreamNode->Modified();
-          igtlio::VideoDevice* device = static_cast<igtlio::VideoDevice*>(bitStreamNode->GetVideoMessageDevice());
-          vtkImageData* srcImageData = imageDevice->GetContent().image;
-          int numComponents = srcImageData->GetNumberOfScalarComponents();
-          int size[3];
-          srcImageData->GetDimensions(size);
-          igtl::ImageMessage::Pointer temImageMsg = igtl::ImageMessage::New();
-          int scalarTypeSize = temImageMsg->GetScalarSize(srcImageData->GetScalarType());
-          long dataSize = size[0] * size[1] * size[2] * scalarTypeSize*numComponents;
-          memcpy(device->GetContent().image->GetScalarPointer(), imageDevice->GetContent().image->GetScalarPointer(), dataSize);
-          device->GetIGTLMessage();
-        }
-#endif
-      }
-    }
-#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
-    else if (strcmp(deviceType.c_str(), "VIDEO") == 0)
+    return;
+  }
+  MessageDeviceMapType::iterator iter;
+  for (iter = this->OutgoingMRMLIDToDeviceMap.begin(); iter != this->OutgoingMRMLIDToDeviceMap.end(); ++iter)
+  {
+    if (!IsTrackingDataDeviceType(iter->second->GetDeviceType()))
     {
-      igtlio::VideoDevice* videoDevice = reinterpret_cast<igtlio::VideoDevice*>(modifiedDevice);
-      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
-      {
-        vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(modifiedNode);
-        bitStreamNode->SetAndObserveImageData(videoDevice->GetContent().image);
-      }
-      // The BitstreamNode has its own handling of the device modified event
+      continue;
     }
-#endif
-    else if (strcmp(deviceType.c_str(), "STATUS") == 0)
+    vtkMRMLIGTLTrackingDataBundleNode* bundleNode = vtkMRMLIGTLTrackingDataBundleNode::SafeDownCast(scene->GetNodeByID(iter->first));
+    if (bundleNode && bundleNode->HasModifiedOutgoingTransforms())
     {
-      igtlio::StatusDevice* statusDevice = reinterpret_cast<igtlio::StatusDevice*>(modifiedDevice);
-      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
-      {
-        vtkMRMLIGTLStatusNode* statusNode = vtkMRMLIGTLStatusNode::SafeDownCast(modifiedNode);
-        statusNode->SetStatus(statusDevice->GetContent().code, statusDevice->GetContent().subcode, statusDevice->GetContent().errorname.c_str(), statusDevice->GetContent().statusstring.c_str());
-        statusNode->Modified();
-      }
+      this->External->PushNode(bundleNode);
+      bundleNode->ClearModifiedOutgoingTransforms();
     }
-    else if (strcmp(deviceType.c_str(), "TRANSFORM") == 0)
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::SendSubscriptions()
+{
+  if (this->IOConnector->GetState() != igtlio::Connector::STATE_CONNECTED)
+  {
+    // Sent when the connection is established
+    return;
+  }
+  vtkIGTLSubscriptionManager::SubscriptionListType cancelledSubscriptions;
+  vtkIGTLSubscriptionManager::SubscriptionListType pendingSubscriptions;
+  this->SubscriptionMutex->Lock();
+  this->SubscriptionManager->PopCancelledSubscriptions(cancelledSubscriptions);
+  this->SubscriptionManager->PopPendingSubscriptions(pendingSubscriptions);
+  this->SubscriptionMutex->Unlock();
+
+  for (size_t i = 0; i < cancelledSubscriptions.size(); ++i)
+  {
+    igtlio::DeviceKeyType key;
+    key.type = cancelledSubscriptions[i].Type;
+    key.name = cancelledSubscriptions[i].DeviceName;
+    if (this->IOConnector->GetDevice(key).GetPointer())
     {
-      igtlio::TransformDevice* transformDevice = reinterpret_cast<igtlio::TransformDevice*>(modifiedDevice);
-      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
-      {
-        vtkMRMLLinearTransformNode* transformNode = vtkMRMLLinearTransformNode::SafeDownCast(modifiedNode);
-        vtkSmartPointer<vtkMatrix4x4> transfromMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
-        transfromMatrix->DeepCopy(transformDevice->GetContent().transform);
-        transformNode->SetMatrixTransformToParent(transfromMatrix.GetPointer());
-        transformNode->Modified();
-      }
+      this->IOConnector->SendMessage(key, igtlio::Device::MESSAGE_PREFIX_STOP);
     }
-    else if (strcmp(deviceType.c_str(), "POLYDATA") == 0)
+  }
+
+  for (size_t i = 0; i < pendingSubscriptions.size(); ++i)
+  {
+    const vtkIGTLSubscriptionManager::SubscriptionType& subscription = pendingSubscriptions[i];
+    // The device that sends the request receives the stream
+    igtlio::Device* device = static_cast<igtlio::Device*>(
+      this->External->CreateDeviceForIncomingMessage(subscription.Type.c_str(), subscription.DeviceName.c_str()));
+    vtkIGTLTrackingDataDevice* trackingDataDevice = vtkIGTLTrackingDataDevice::SafeDownCast(device);
+    if (trackingDataDevice)
     {
-      igtlio::PolyDataDevice* polyDevice = reinterpret_cast<igtlio::PolyDataDevice*>(modifiedDevice);
-      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
-      {
-        vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(modifiedNode);
-        modelNode->SetAndObservePolyData(polyDevice->GetContent().polydata);
-        modelNode->Modified();
-      }
+      trackingDataDevice->SetResolution(subscription.Resolution);
+      trackingDataDevice->SetCoordinateName(subscription.CoordinateName);
     }
-    else if (strcmp(deviceType.c_str(), "STRING") == 0)
+    igtlio::DeviceKeyType key;
+    key.type = subscription.Type;
+    key.name = subscription.DeviceName;
+    if (device == NULL || !this->IOConnector->SendMessage(key, igtlio::Device::MESSAGE_PREFIX_START))
     {
-      igtlio::StringDevice* stringDevice = reinterpret_cast<igtlio::StringDevice*>(modifiedDevice);
-      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
-      {
-        vtkMRMLTextNode* textNode = vtkMRMLTextNode::SafeDownCast(modifiedNode);
-        textNode->SetEncoding(stringDevice->GetContent().encoding);
-        textNode->SetText(stringDevice->GetContent().string_msg.c_str());
-        textNode->Modified();
-      }
+      vtkErrorWithObjectMacro(this->External, "SendSubscriptions: cannot send STT_" << subscription.Type << " for device " << subscription.DeviceName);
+      this->SubscriptionMutex->Lock();
+      this->SubscriptionManager->SetSubscriptionStatus(subscription.Type, subscription.DeviceName,
+                                                       vtkIGTLSubscriptionManager::STATUS_REJECTED);
+      this->SubscriptionMutex->Unlock();
     }
-    else if (strcmp(deviceType.c_str(), "COMMAND") == 0)
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessStreamingRequest(vtkIGTLTrackingDataDevice* device, bool start,
+                                                                    double currentTime)
+{
+  int status = igtl::RTSTrackingDataMessage::STATUS_SUCCESS;
+  this->SubscriptionMutex->Lock();
+  if (!start)
+  {
+    this->SubscriptionManager->RemoveRemoteSubscription(device->GetDeviceType(), device->GetDeviceName());
+  }
+  else if (this->GetOutgoingNodeID(device).empty())
+  {
+    status = igtl::RTSTrackingDataMessage::STATUS_ERROR;
+  }
+  else
+  {
+    this->SubscriptionManager->AddRemoteSubscription(device->GetDeviceType(), device->GetDeviceName(),
+                                                     device->GetRequestedResolution() * 0.001, currentTime);
+  }
+  this->SubscriptionMutex->Unlock();
+  if (status != igtl::RTSTrackingDataMessage::STATUS_SUCCESS)
+  {
+    vtkWarningWithObjectMacro(this->External, "ProcessStreamingRequest: no outgoing node to stream for STT_"
+                              << device->GetDeviceType() << " " << device->GetDeviceName());
+  }
+  device->SetRequestResponseStatus(status);
+  this->IOConnector->SendMessage(CreateDeviceKey(device), igtlio::Device::MESSAGE_PREFIX_RTS);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::PushSubscribedNodes(double currentTime)
+{
+  vtkMRMLScene* scene = this->External->GetScene();
+  if (scene == NULL || this->IOConnector->GetState() != igtlio::Connector::STATE_CONNECTED)
+  {
+    return;
+  }
+  std::vector<vtkIGTLSubscriptionManager::KeyType> dueKeys;
+  this->SubscriptionMutex->Lock();
+  this->SubscriptionManager->PopDueRemoteSubscriptions(currentTime, dueKeys);
+  this->SubscriptionMutex->Unlock();
+  for (size_t i = 0; i < dueKeys.size(); ++i)
+  {
+    igtlio::DeviceKeyType key;
+    key.type = dueKeys[i].first;
+    key.name = dueKeys[i].second;
+    igtlio::DevicePointer device = this->IOConnector->GetDevice(key);
+    std::string nodeID = device.GetPointer() ? this->GetOutgoingNodeID(device) : std::string();
+    vtkMRMLNode* node = nodeID.empty() ? NULL : scene->GetNodeByID(nodeID);
+    if (node == NULL)
     {
-      // Process the modified event from command device.
+      // The node is no longer sent by this connector, end the stream
+      this->SubscriptionMutex->Lock();
+      this->SubscriptionManager->RemoveRemoteSubscription(key.type, key.name);
+      this->SubscriptionMutex->Unlock();
+      continue;
     }
+    this->External->PushNode(node);
   }
 }
 
 //----------------------------------------------------------------------------
-vtkMRMLNode* vtkMRMLIGTLConnectorNode::vtkInternal::GetOrAddMRMLNodeforDevice(igtlio::Device* device)
+std::string vtkMRMLIGTLConnectorNode::vtkInternal::GetOutgoingNodeID(igtlio::Device* device)
 {
-  if (device)
+  MessageDeviceMapType::iterator iter;
+  for (iter = this->OutgoingMRMLIDToDeviceMap.begin(); iter != this->OutgoingMRMLIDToDeviceMap.end(); ++iter)
   {
-    if (device->GetMessageDirection() != igtlio::Device::MESSAGE_DIRECTION_IN)
+    if (iter->second.GetPointer() == device)
     {
-      // we are only interested in incomming devices
-      return NULL;
+      return iter->first;
     }
   }
-  // Found the node and return the node;
-  NodeInfoMapType::iterator inIter;
-  for (inIter = this->IncomingMRMLNodeInfoMap.begin();
-    inIter != this->IncomingMRMLNodeInfoMap.end();
-    inIter++)
+  return std::string();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::AddServedImageMetaDevices()
+{
+  const char* deviceTypes[] = { vtkIGTLImageMetaDevice::GetIGTLTypeName(), vtkIGTLLabelMetaDevice::GetIGTLTypeName() };
+  for (int i = 0; i < 2; ++i)
   {
-    vtkMRMLNode* node = this->External->GetScene()->GetNodeByID((inIter->first));
-    if (node)
+    igtlio::DeviceKeyType key;
+    key.type = deviceTypes[i];
+    key.name = this->ServedImageMetaDeviceName;
+    if (this->IOConnector->GetDevice(key) == NULL)
     {
-      const std::string deviceType = device->GetDeviceType();
-      const std::string deviceName = device->GetDeviceName();
-      bool typeMatched = false;
-      for (unsigned int i = 0; i < this->External->GetNodeTagFromDeviceType(deviceType.c_str()).size(); i++)
-      {
-        const std::string nodeTag = this->External->GetNodeTagFromDeviceType(deviceType.c_str())[i];
-        if (strcmp(node->GetNodeTagName(), nodeTag.c_str()) == 0)
-        {
-          typeMatched = 1;
-          break;
-        }
-      }
-      if (typeMatched && strcmp(node->GetName(), deviceName.c_str()) == 0)
-      {
-        return node;
-      }
+      this->IOConnector->AddDevice(this->CreateDevice(key.type, key.name));
     }
   }
+}
 
-  // Node not found and add the node
-  if (strcmp(device->GetDeviceType().c_str(), "IMAGE") == 0)
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::AddServedImageDevice(const std::string& deviceName)
+{
+  igtlio::DeviceKeyType key;
+  key.type = "IMAGE";
+  key.name = deviceName;
+  if (this->IOConnector->GetDevice(key) == NULL)
   {
-    vtkSmartPointer<vtkMRMLVolumeNode> volumeNode;
-    int numberOfComponents = 1;
-    vtkSmartPointer<vtkImageData> image;
-    std::string deviceName = "";
-    igtlio::ImageDevice* imageDevice = reinterpret_cast<igtlio::ImageDevice*>(device);
-    igtlio::ImageConverter::ContentData content = imageDevice->GetContent();
-    numberOfComponents = content.image->GetNumberOfScalarComponents(); //to improve the io module to be able to cope with video data
-    image = content.image;
-    deviceName = imageDevice->GetDeviceName().c_str();
-#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
-    volumeNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
-#else
-    if (numberOfComponents>1)
-    {
-      volumeNode = vtkSmartPointer<vtkMRMLVectorVolumeNode>::New();
-    }
-    else
-    {
-      volumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
-    }
+    vtkSmartPointer<vtkIGTLServedImageDevice> device = vtkSmartPointer<vtkIGTLServedImageDevice>::New();
+    device->SetDeviceName(deviceName);
+    this->IOConnector->AddDevice(device);
+  }
+}
 
-#endif
-    volumeNode->SetAndObserveImageData(image);
-    volumeNode->SetName(deviceName.c_str());
-    this->External->GetScene()->SaveStateForUndo();
-    volumeNode->SetDescription("Received by OpenIGTLink");
-    vtkDebugMacro("Name vol node " << volumeNode->GetClassName());
-    this->External->GetScene()->AddNode(volumeNode);
-#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
-    vtkMRMLBitStreamNode * tempNode = vtkMRMLBitStreamNode::SafeDownCast(volumeNode);
-    tempNode->SetUpVideoDeviceByName(deviceName.c_str());
-    igtlio::VideoDevice* videoDevice = static_cast<igtlio::VideoDevice*>(tempNode->GetVideoMessageDevice());
-    vtkImageData* imageData = videoDevice->GetContent().image.GetPointer();
-    vtkImageData* srcImageData = imageDevice->GetContent().image;
-    int size[3];
-    srcImageData->GetDimensions(size);
-    imageData->SetDimensions(size[0], size[1], size[2]);
-    imageData->SetExtent(0, size[0] - 1, 0, size[1] - 1, 0, size[2] - 1);
-    imageData->SetOrigin(0.0, 0.0, 0.0);
-    imageData->SetSpacing(1.0, 1.0, 1.0);
-    int numComponents = srcImageData->GetNumberOfScalarComponents();
-#if (VTK_MAJOR_VERSION <= 5)
-    imageData->SetNumberOfScalarComponents(numComponents);
-    imageData->SetScalarType(srcImageData->GetScalarType());
-    imageData->AllocateScalars();
-#else
-    imageData->AllocateScalars(srcImageData->GetScalarType(), numComponents);
-#endif
-    igtl::ImageMessage::Pointer temImageMsg = igtl::ImageMessage::New();
-    int scalarTypeSize = temImageMsg->GetScalarSize(srcImageData->GetScalarType());
-    long dataSize = size[0] * size[1] * size[2] * scalarTypeSize*numComponents;
-    memcpy(imageData->GetScalarPointer(), srcImageData->GetScalarPointer(), dataSize);
-    //videoDevice->GetContent().image = imageData;
-#endif
-    vtkDebugMacro("Set basic display info");
-    bool scalarDisplayNodeRequired = (numberOfComponents == 1);
-    vtkSmartPointer<vtkMRMLVolumeDisplayNode> displayNode;
-    if (scalarDisplayNodeRequired)
+//----------------------------------------------------------------------------
+vtkIGTLSceneImageIndex* vtkMRMLIGTLConnectorNode::vtkInternal::GetSceneImageIndex()
+{
+  // Built on the first request if the connector was not in a scene when serving was enabled
+  if (this->SceneImageIndex->GetScene() != this->External->GetScene())
+  {
+    this->SceneImageIndex->SetScene(this->External->GetScene());
+  }
+  return this->SceneImageIndex;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessImageMetaRequest(igtlio::Device* device)
+{
+  if (!this->ServeSceneImages)
+  {
+    return;
+  }
+  vtkIGTLSceneImageIndex* index = this->GetSceneImageIndex();
+  if (device->GetDeviceType().compare(vtkIGTLImageMetaDevice::GetIGTLTypeName()) == 0)
+  {
+    vtkIGTLImageMetaDevice* imageMetaDevice = static_cast<vtkIGTLImageMetaDevice*>(device);
+    std::vector<vtkMRMLImageMetaListNode::ImageMetaElement> elements;
+    index->GetImageMetaElements(elements);
+    imageMetaDevice->ClearElements();
+    for (size_t i = 0; i < elements.size(); ++i)
     {
-      displayNode = vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode>::New();
+      imageMetaDevice->AddElement(elements[i]);
+      this->AddServedImageDevice(elements[i].DeviceName);
     }
-    else
+  }
+  else
+  {
+    vtkIGTLLabelMetaDevice* labelMetaDevice = static_cast<vtkIGTLLabelMetaDevice*>(device);
+    std::vector<vtkMRMLLabelMetaListNode::LabelMetaElement> elements;
+    index->GetLabelMetaElements(elements);
+    labelMetaDevice->ClearElements();
+    for (size_t i = 0; i < elements.size(); ++i)
     {
-      displayNode = vtkSmartPointer<vtkMRMLVectorVolumeDisplayNode>::New();
+      labelMetaDevice->AddElement(elements[i]);
+      this->AddServedImageDevice(elements[i].DeviceName);
     }
+  }
+  this->IOConnector->SendMessage(CreateDeviceKey(device), igtlio::Device::MESSAGE_PREFIX_NOT_DEFINED);
+}
 
-    this->External->GetScene()->AddNode(displayNode);
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessImageRequest(igtlio::Device* device)
+{
+  if (!this->ServeSceneImages)
+  {
+    return;
+  }
+  vtkMRMLVolumeNode* volumeNode = this->GetSceneImageIndex()->FindVolumeNode(device->GetDeviceName().c_str());
+  if (volumeNode == NULL || volumeNode->GetImageData() == NULL)
+  {
+    vtkWarningWithObjectMacro(this->External, "ProcessImageRequest: no volume " << device->GetDeviceName() << " in the scene");
+    return;
+  }
+  igtlio::ImageDevice* imageDevice = static_cast<igtlio::ImageDevice*>(device);
+  vtkSmartPointer<vtkMatrix4x4> ijkToRAS = vtkSmartPointer<vtkMatrix4x4>::New();
+  volumeNode->GetIJKToRASMatrix(ijkToRAS);
+  igtlio::ImageConverter::ContentData content = { volumeNode->GetImageData(), ijkToRAS };
+  imageDevice->SetContent(content);
+  this->IOConnector->SendMessage(CreateDeviceKey(device), igtlio::Device::MESSAGE_PREFIX_NOT_DEFINED);
+}
 
-    if (scalarDisplayNodeRequired)
-    {
-      const char* colorTableId = vtkMRMLColorLogic::GetColorTableNodeID(vtkMRMLColorTableNode::Grey);
-      displayNode->SetAndObserveColorNodeID(colorTableId);
-    }
-    else
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::AddCapabilityDevice()
+{
+  // The peer must use the same device name, custom types are routed by device name
+  this->CapabilityDevice = vtkSmartPointer<vtkIGTLCapabilityDevice>::New();
+  this->CapabilityDevice->SetDeviceName("Capability");
+  this->CapabilityDevice->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
+  this->IOConnector->AddDevice(this->CapabilityDevice.GetPointer());
+}
+
+//----------------------------------------------------------------------------
+std::vector<std::string> vtkMRMLIGTLConnectorNode::vtkInternal::GetLocalSupportedTypes()
+{
+  std::vector<std::string> types;
+  for (DeviceTypeToNodeTagMapType::iterator iter = this->DeviceTypeToNodeTagMap.begin(); iter != this->DeviceTypeToNodeTagMap.end(); ++iter)
+  {
+#if !defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+    // Video messages cannot be decoded
+    if (iter->first.compare("VIDEO") == 0 || iter->first.compare("LLVIDEO") == 0)
     {
-      displayNode->SetDefaultColorMap();
+      continue;
     }
+#endif
+    types.push_back(iter->first);
+  }
+  types.push_back(igtlio::CommandConverter::GetIGTLTypeName());
+  types.push_back(vtkIGTLCapabilityDevice::GetIGTLTypeName());
+  return types;
+}
 
-    volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
-    this->External->RegisterIncomingMRMLNode(volumeNode, device);
-    return volumeNode;
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessCapabilityRequest()
+{
+  this->CapabilityDevice->SetTypes(this->GetLocalSupportedTypes());
+  this->IOConnector->SendMessage(CreateDeviceKey(this->CapabilityDevice.GetPointer()), igtlio::Device::MESSAGE_PREFIX_NOT_DEFINED);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessPeerCapability()
+{
+  if (!this->CapabilityNegotiation)
+  {
+    return;
   }
-#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
-  else if (strcmp(device->GetDeviceType().c_str(), "VIDEO") == 0)
+  const std::vector<std::string>& types = this->CapabilityDevice->GetTypes();
+  if (types.empty())
   {
-    igtlio::VideoDevice* videoDevice = reinterpret_cast<igtlio::VideoDevice*>(device);
-    igtlio::VideoConverter::ContentData content = videoDevice->GetContent();
-    int numberOfComponents = content.image->GetNumberOfScalarComponents(); //to improve the io module to be able to cope with video data
-    vtkSmartPointer<vtkImageData> image = content.image;
-    std::string deviceName = videoDevice->GetDeviceName().c_str();
-    this->External->GetScene()->SaveStateForUndo();
-    bool scalarDisplayNodeRequired = (numberOfComponents == 1);
-    vtkSmartPointer<vtkMRMLBitStreamNode> bitStreamNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
-    bitStreamNode->SetName(deviceName.c_str());
-    bitStreamNode->SetDescription("Received by OpenIGTLink");
-    this->External->GetScene()->AddNode(bitStreamNode);
-    bitStreamNode->ObserveOutsideVideoDevice(reinterpret_cast<igtlio::VideoDevice*>(device));
-    vtkSmartPointer<vtkMRMLVolumeDisplayNode> displayNode;
-    if (scalarDisplayNodeRequired)
-    {
-      displayNode = vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode>::New();
-    }
-    else
-    {
-      displayNode = vtkSmartPointer<vtkMRMLVectorVolumeDisplayNode>::New();
-    }
-    this->External->GetScene()->AddNode(displayNode);
-    if (scalarDisplayNodeRequired)
-    {
-      const char* colorTableId = vtkMRMLColorLogic::GetColorTableNodeID(vtkMRMLColorTableNode::Grey);
-      displayNode->SetAndObserveColorNodeID(colorTableId);
-    }
-    else
+    // A peer that lists no type does not declare its capability, everything is still sent
+    if (this->ClearPeerCapability())
     {
-      displayNode->SetDefaultColorMap();
+      this->External->InvokeEvent(vtkMRMLIGTLConnectorNode::PeerCapabilityModifiedEvent);
     }
-    bitStreamNode->SetAndObserveDisplayNodeID(displayNode->GetID());
-    this->External->RegisterIncomingMRMLNode(bitStreamNode, device);
-    return bitStreamNode;
+    return;
   }
-#endif
-  else if (strcmp(device->GetDeviceType().c_str(), "STATUS") == 0)
+  this->PeerSupportedTypes = types;
+  this->PeerSupportedTypeSet.clear();
+  this->PeerSupportedTypeSet.insert(types.begin(), types.end());
+  this->PeerCapabilityKnown = true;
+  this->UpdateOutgoingDevicesForPeer();
+  this->External->InvokeEvent(vtkMRMLIGTLConnectorNode::PeerCapabilityModifiedEvent);
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::ClearPeerCapability()
+{
+  if (!this->PeerCapabilityKnown)
   {
-    vtkSmartPointer<vtkMRMLIGTLStatusNode> statusNode;
-    statusNode = vtkSmartPointer<vtkMRMLIGTLStatusNode>::New();
-    statusNode->SetName(device->GetDeviceName().c_str());
-    statusNode->SetDescription("Received by OpenIGTLink");
-    this->External->GetScene()->AddNode(statusNode);
-    this->External->RegisterIncomingMRMLNode(statusNode, device);
-    return statusNode;
+    return false;
   }
-  else if (strcmp(device->GetDeviceType().c_str(), "TRANSFORM") == 0)
+  this->PeerCapabilityKnown = false;
+  this->PeerSupportedTypes.clear();
+  this->PeerSupportedTypeSet.clear();
+  // Nodes moved to a fallback type are sent with their requested type again
+  this->UpdateOutgoingDevicesForPeer();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::IsPeerTypeSupported(const std::string& deviceType)
+{
+  if (!this->CapabilityNegotiation || !this->PeerCapabilityKnown)
   {
-    vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode;
-    transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
-    transformNode->SetName(device->GetDeviceName().c_str());
-    transformNode->SetDescription("Received by OpenIGTLink");
+    return true;
+  }
+  return this->PeerSupportedTypeSet.find(deviceType) != this->PeerSupportedTypeSet.end();
+}
 
-    vtkMatrix4x4* transform = vtkMatrix4x4::New();
-    transform->Identity();
-    transformNode->ApplyTransformMatrix(transform);
-    transform->Delete();
-    this->External->GetScene()->AddNode(transformNode);
-    this->External->RegisterIncomingMRMLNode(transformNode, device);
-    return transformNode;
+//----------------------------------------------------------------------------
+std::vector<std::string> vtkMRMLIGTLConnectorNode::vtkInternal::SelectPeerSupportedTypes(vtkMRMLNode* node, const std::vector<std::string>& deviceTypes)
+{
+  if (!this->CapabilityNegotiation || !this->PeerCapabilityKnown)
+  {
+    return deviceTypes;
   }
-  else if (strcmp(device->GetDeviceType().c_str(), "POLYDATA") == 0)
+  std::vector<std::string> supportedTypes;
+  for (size_t i = 0; i < deviceTypes.size(); ++i)
   {
-    igtlio::PolyDataDevice* polyDevice = reinterpret_cast<igtlio::PolyDataDevice*>(device);
-    igtlio::PolyDataConverter::ContentData content = polyDevice->GetContent();
-
-    vtkSmartPointer<vtkMRMLModelNode> modelNode = NULL;
-    std::string mrmlNodeTagName = "";
-    if (device->GetMetaDataElement(MEMLNodeNameKey, mrmlNodeTagName))
+    if (this->IsPeerTypeSupported(deviceTypes[i]))
     {
-      std::string className = this->External->GetScene()->GetClassNameByTag(mrmlNodeTagName.c_str());
-      vtkMRMLNode * createdNode = this->External->GetScene()->CreateNodeByClass(className.c_str());
-      if (createdNode)
-      {
-        modelNode = vtkMRMLModelNode::SafeDownCast(createdNode);
-      }
-      else
-      {
-        modelNode = vtkSmartPointer<vtkMRMLModelNode>::New();
-      }
-    }
-    else
-    {
-      modelNode = vtkSmartPointer<vtkMRMLModelNode>::New();
+      supportedTypes.push_back(deviceTypes[i]);
     }
-    modelNode->SetName(device->GetDeviceName().c_str());
-    modelNode->SetDescription("Received by OpenIGTLink");
-    this->External->GetScene()->AddNode(modelNode);
-    modelNode->SetAndObservePolyData(content.polydata);
-    modelNode->CreateDefaultDisplayNodes();
-    this->External->RegisterIncomingMRMLNode(modelNode, device);
-    return modelNode;
   }
-  else if (strcmp(device->GetDeviceType().c_str(), "STRING") == 0)
+  if (supportedTypes.empty())
   {
-    igtlio::StringDevice* modifiedDevice = reinterpret_cast<igtlio::StringDevice*>(device);
-    vtkSmartPointer<vtkMRMLTextNode> textNode = vtkSmartPointer<vtkMRMLTextNode>::New();
-    textNode->SetEncoding(modifiedDevice->GetContent().encoding);
-    textNode->SetText(modifiedDevice->GetContent().string_msg.c_str());
-    textNode->SetName(device->GetDeviceName().c_str());
-    this->External->RegisterIncomingMRMLNode(textNode, device);
-    return textNode;
+    // LLVIDEO, POSITION or QTDATA requested for the node: VIDEO or IMAGE, TRANSFORM or TDATA
+    std::vector<std::string> defaultTypes = this->External->GetDeviceTypeFromMRMLNodeType(node->GetNodeTagName());
+    for (size_t i = 0; i < defaultTypes.size(); ++i)
+    {
+      if (this->IsPeerTypeSupported(defaultTypes[i]))
+      {
+        supportedTypes.push_back(defaultTypes[i]);
+      }
+    }
   }
-  return NULL;
+  // Without a supported type the pushes of the node are suppressed
+  return supportedTypes.empty() ? deviceTypes : supportedTypes;
 }
 
-igtlio::CommandDevicePointer vtkMRMLIGTLConnectorNode::vtkInternal::SendCommand(std::string device_id, std::string command, std::string content, igtlio::SYNCHRONIZATION_TYPE synchronized, double timeout_s)
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::UpdateOutgoingDevicesForPeer()
 {
-  igtlio::CommandDevicePointer device = this->IOConnector->SendCommand(device_id, command, content);
-
-  if (synchronized == igtlio::BLOCKING)
+  vtkMRMLScene* scene = this->External->GetScene();
+  if (scene == NULL)
+  {
+    return;
+  }
+  // AssignOutGoingNodeToDevice modifies the map
+  MessageDeviceMapType outgoingDevices = this->OutgoingMRMLIDToDeviceMap;
+  for (MessageDeviceMapType::iterator iter = outgoingDevices.begin(); iter != outgoingDevices.end(); ++iter)
   {
-    double starttime = vtkTimerLog::GetUniversalTime();
-    while (vtkTimerLog::GetUniversalTime() - starttime < timeout_s)
+    igtlio::Device* device = iter->second;
+    vtkMRMLNode* node = scene->GetNodeByID(iter->first.c_str());
+    if (device == NULL || node == NULL)
     {
-      this->IOConnector->PeriodicProcess();
-      vtksys::SystemTools::Delay(5);
-
-      igtlio::CommandDevicePointer response = device->GetResponseFromCommandID(device->GetContent().id);
-
-      if (response.GetPointer())
+      continue;
+    }
+    // Derived from the requested types each time, so that a fallback lasts only as long as
+    // the capability that caused it
+    std::vector<std::string> deviceTypes = this->GetOutgoingDeviceTypes(node);
+    if (deviceTypes.empty()
+      || std::find(deviceTypes.begin(), deviceTypes.end(), device->GetDeviceType()) != deviceTypes.end())
+    {
+      continue;
+    }
+    igtlio::DeviceKeyType key;
+    key.type = deviceTypes[0];
+    key.name = device->GetDeviceName();
+    igtlio::DevicePointer selectedDevice = this->IOConnector->GetDevice(key);
+    if (selectedDevice == NULL)
+    {
+      selectedDevice = this->CreateDevice(key.type, key.name);
+      if (selectedDevice == NULL)
       {
-        return response;
+        continue;
       }
+      selectedDevice->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
+      this->IOConnector->AddDevice(selectedDevice);
     }
+    // The node is sent with the selected device from now on, as in PushNode
+    device->RemoveObservers(device->GetDeviceContentModifiedEvent());
+    this->AssignOutGoingNodeToDevice(node, selectedDevice);
+    selectedDevice->RemoveObservers(selectedDevice->GetDeviceContentModifiedEvent());
+    selectedDevice->AddObserver(selectedDevice->GetDeviceContentModifiedEvent(), this->External, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
   }
-  else
+}
+
+//----------------------------------------------------------------------------
+igtlio::DevicePointer vtkMRMLIGTLConnectorNode::vtkInternal::CreateDevice(const std::string& deviceType, const std::string& deviceName)
+{
+  if (deviceType.compare(vtkIGTLPositionDevice::GetIGTLTypeName()) == 0)
+  {
+    igtlio::DevicePointer device = vtkSmartPointer<vtkIGTLPositionDevice>::New();
+    device->SetDeviceName(deviceName);
+    return device;
+  }
+  if (deviceType.compare(vtkIGTLImageMetaDevice::GetIGTLTypeName()) == 0)
+  {
+    igtlio::DevicePointer device = vtkSmartPointer<vtkIGTLImageMetaDevice>::New();
+    device->SetDeviceName(deviceName);
+    return device;
+  }
+  if (deviceType.compare(vtkIGTLLabelMetaDevice::GetIGTLTypeName()) == 0)
+  {
+    igtlio::DevicePointer device = vtkSmartPointer<vtkIGTLLabelMetaDevice>::New();
+    device->SetDeviceName(deviceName);
+    return device;
+  }
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  if (deviceType.compare(vtkIGTLLosslessVideoDevice::GetIGTLTypeName()) == 0)
   {
+    igtlio::DevicePointer device = vtkSmartPointer<vtkIGTLLosslessVideoDevice>::New();
+    device->SetDeviceName(deviceName);
     return device;
   }
-  return vtkSmartPointer<igtlio::CommandDevice>();
+#endif
+  return this->IOConnector->GetDeviceFactory()->create(deviceType, deviceName);
 }
 
 //----------------------------------------------------------------------------
-igtlio::CommandDevicePointer vtkMRMLIGTLConnectorNode::vtkInternal::SendCommandResponse(std::string device_id, std::string command, std::string content)
+std::vector<std::string> vtkMRMLIGTLConnectorNode::vtkInternal::GetOutgoingDeviceTypes(vtkMRMLNode* node)
 {
-  igtlio::DeviceKeyType key(igtlio::CommandConverter::GetIGTLTypeName(), device_id);
-  igtlio::CommandDevicePointer device = igtlio::CommandDevice::SafeDownCast(this->IOConnector->GetDevice(key));
-
-  igtlio::CommandConverter::ContentData contentdata = device->GetContent();
-
-  if (command != contentdata.name)
-  {
-    vtkGenericWarningMacro("Requested command response " << command << " does not match the existing query: " << contentdata.name);
-    return igtlio::CommandDevicePointer();
-  }
-
-  contentdata.name = command;
-  contentdata.content = content;
-  device->SetContent(contentdata);
-
-  this->IOConnector->SendMessage(CreateDeviceKey(device), igtlio::Device::MESSAGE_PREFIX_RTS);
-  return device;
-}
-
-
-//----------------------------------------------------------------------------
-// vtkMRMLIGTLConnectorNode method
-
-//----------------------------------------------------------------------------
-vtkMRMLIGTLConnectorNode::vtkMRMLIGTLConnectorNode()
-{
-  this->Internal = new vtkInternal(this);
-  this->HideFromEditors = false;
-  this->QueryQueueMutex = vtkMutexLock::New();
-  this->ConnectEvents();
- 
-  this->IncomingNodeReferenceRole=NULL;
-  this->IncomingNodeReferenceMRMLAttributeName=NULL;
-  this->OutgoingNodeReferenceRole=NULL;
-  this->OutgoingNodeReferenceMRMLAttributeName=NULL;
-  
-  this->SetIncomingNodeReferenceRole("incoming");
-  this->SetIncomingNodeReferenceMRMLAttributeName("incomingNodeRef");
-  this->AddNodeReferenceRole(this->GetIncomingNodeReferenceRole(),
-                             this->GetIncomingNodeReferenceMRMLAttributeName());
-
-  this->SetOutgoingNodeReferenceRole("outgoing");
-  this->SetOutgoingNodeReferenceMRMLAttributeName("outgoingNodeRef");
-  this->AddNodeReferenceRole(this->GetOutgoingNodeReferenceRole(),
-                             this->GetOutgoingNodeReferenceMRMLAttributeName());
-
-  this->Internal->DeviceTypeToNodeTagMap.clear();
-  std::string volumeTags[] = {"Volume", "VectorVolume", "BitStream"};
-  this->Internal->DeviceTypeToNodeTagMap["IMAGE"] = std::vector<std::string>(volumeTags, volumeTags+3);
-  this->Internal->DeviceTypeToNodeTagMap["VIDEO"] = std::vector<std::string>(1,"BitStream");
-  this->Internal->DeviceTypeToNodeTagMap["STATUS"] = std::vector<std::string>(1,"IGTLStatus");
-  this->Internal->DeviceTypeToNodeTagMap["TRANSFORM"] = std::vector<std::string>(1,"LinearTransform");
-  std::string modelTags[] = {"Model", "FiberBundle"};
-  this->Internal->DeviceTypeToNodeTagMap["POLYDATA"] = std::vector<std::string>(modelTags, modelTags+2);
-  this->Internal->DeviceTypeToNodeTagMap["STRING"] = std::vector<std::string>(1,"Text");
-  
+  return this->SelectPeerSupportedTypes(node, this->GetRequestedOutgoingDeviceTypes(node));
 }
 
 //----------------------------------------------------------------------------
-vtkMRMLIGTLConnectorNode::~vtkMRMLIGTLConnectorNode()
+std::vector<std::string> vtkMRMLIGTLConnectorNode::vtkInternal::GetRequestedOutgoingDeviceTypes(vtkMRMLNode* node)
 {
-  if (this->QueryQueueMutex)
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(node);
+  if (bitStreamNode && bitStreamNode->GetOutgoingDeviceType().compare(vtkIGTLLosslessVideoDevice::GetIGTLTypeName()) == 0)
+  {
+    return std::vector<std::string>(1, vtkIGTLLosslessVideoDevice::GetIGTLTypeName());
+  }
+#endif
+  // Compact quaternion messages are used only if requested for the node
+  const char* requestedType = node->GetAttribute(OutgoingDeviceTypeAttributeName);
+  if (requestedType)
+  {
+    if (strcmp(requestedType, vtkIGTLPositionDevice::GetIGTLTypeName()) == 0
+      && vtkMRMLLinearTransformNode::SafeDownCast(node))
     {
-    this->QueryQueueMutex->Delete();
+      return std::vector<std::string>(1, vtkIGTLPositionDevice::GetIGTLTypeName());
     }
-
-  delete this->Internal;
-  this->Internal = NULL;
+    if (strcmp(requestedType, vtkIGTLQuaternionTrackingDataDevice::GetIGTLTypeName()) == 0
+      && vtkMRMLIGTLTrackingDataBundleNode::SafeDownCast(node))
+    {
+      return std::vector<std::string>(1, vtkIGTLQuaternionTrackingDataDevice::GetIGTLTypeName());
+    }
+  }
+  return this->External->GetDeviceTypeFromMRMLNodeType(node->GetNodeTagName());
 }
 
-void vtkMRMLIGTLConnectorNode::ConnectEvents()
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessNewDeviceEvent(vtkObject *caller, unsigned long event, void *callData)
 {
-  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->ConnectedEvent, this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->DisconnectedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->ActivatedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->DeactivatedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->NewDeviceEvent, this,  &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->RemovedDeviceEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
 }
 
 //----------------------------------------------------------------------------
-std::vector<std::string> vtkMRMLIGTLConnectorNode::GetNodeTagFromDeviceType(const char * deviceType)
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessOutgoingDeviceModifiedEvent(vtkObject *caller, unsigned long event, igtlio::Device * modifiedDevice)
 {
-  vtkInternal::DeviceTypeToNodeTagMapType::iterator iter;
-  if(this->Internal->DeviceTypeToNodeTagMap.find(std::string(deviceType)) != this->Internal->DeviceTypeToNodeTagMap.end())
-    {
-    return this->Internal->DeviceTypeToNodeTagMap.find(std::string(deviceType))->second;
-    }
-  return std::vector<std::string>(0);
+  if (!this->IsPeerTypeSupported(modifiedDevice->GetDeviceType()))
+  {
+    this->SuppressedMessagesMutex->Lock();
+    this->NumberOfSuppressedMessages++;
+    this->SuppressedMessagesMutex->Unlock();
+    return;
+  }
+  this->IOConnector->SendMessage(CreateDeviceKey(modifiedDevice), modifiedDevice->MESSAGE_PREFIX_NOT_DEFINED);
 }
 
 //----------------------------------------------------------------------------
-std::vector<std::string> vtkMRMLIGTLConnectorNode::GetDeviceTypeFromMRMLNodeType(const char* NodeTag)
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessIncomingDeviceModifiedEvent(vtkObject *caller, unsigned long event, igtlio::Device * modifiedDevice)
 {
+  vtkMRMLNode* modifiedNode = this->GetOrAddMRMLNodeforDevice(modifiedDevice);
+  const std::string deviceType = modifiedDevice->GetDeviceType();
+  const std::string deviceName = modifiedDevice->GetDeviceName();
+  if (this->External->GetNodeTagFromDeviceType(deviceType.c_str()).size() > 0)
+  {
+    if (strcmp(deviceType.c_str(), "IMAGE") == 0)
+    {
+      igtlio::ImageDevice* imageDevice = reinterpret_cast<igtlio::ImageDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        if (strcmp(modifiedNode->GetNodeTagName(), "Volume") == 0 ||
+            strcmp(modifiedNode->GetNodeTagName(), "VectorVolume") == 0
+            )
+        {
+          vtkMRMLVolumeNode* volumeNode = vtkMRMLVolumeNode::SafeDownCast(modifiedNode);
+          volumeNode->SetIJKToRASMatrix(imageDevice->GetContent().transform);
+          volumeNode->SetAndObserveImageData(imageDevice->GetContent().image);
+          volumeNode->Modified();
+        }
 #if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
-  if(strcmp(NodeTag, "BitStream")==0)
+        else if (strcmp(modifiedNode->GetNodeTagName(), "BitStream") == 0)
+        {
+          vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(modifiedNode);
+          bitStreamNode->SetAndObserveImageData(imageDevice->GetContent().image);
+          bitStreamNode->SetIJKToRASMatrix(imageDevice->GetContent().transform);
+          bitStreamNode->Modified();
+          igtlio::VideoDevice* device = static_cast<igtlio::VideoDevice*>(bitStreamNode->GetVideoMessageDevice());
+          vtkImageData* srcImageData = imageDevice->GetContent().image;
+          int numComponents = srcImageData->GetNumberOfScalarComponents();
+          int size[3];
+          srcImageData->GetDimensions(size);
+          igtl::ImageMessage::Pointer temImageMsg = igtl::ImageMessage::New();
+          int scalarTypeSize = temImageMsg->GetScalarSize(srcImageData->GetScalarType());
+          long dataSize = size[0] * size[1] * size[2] * scalarTypeSize*numComponents;
+          memcpy(device->GetContent().image->GetScalarPointer(), imageDevice->GetContent().image->GetScalarPointer(), dataSize);
+          device->GetIGTLMessage();
+        }
+#endif
+      }
+    }
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+    else if (strcmp(deviceType.c_str(), "VIDEO") == 0)
     {
-    std::vector<std::string> DeviceTypes;
-    DeviceTypes.push_back("VIDEO");
-    DeviceTypes.push_back("IMAGE");
-    return DeviceTypes;
+      // Frames of vtkIGTLVideoDevice are already converted by vtkIGTLI420ToRGBConverter
+      igtlio::VideoDevice* videoDevice = reinterpret_cast<igtlio::VideoDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(modifiedNode);
+        bitStreamNode->PushDecodedFrame(videoDevice->GetContent().image, this->GetLocalTimestamp(videoDevice));
+      }
+      // The BitstreamNode has its own handling of the device modified event
+    }
+    else if (strcmp(deviceType.c_str(), vtkIGTLLosslessVideoDevice::GetIGTLTypeName()) == 0)
+    {
+      vtkIGTLLosslessVideoDevice* losslessDevice = static_cast<vtkIGTLLosslessVideoDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(modifiedNode);
+        bitStreamNode->PushDecodedFrame(losslessDevice->GetImage(), this->GetLocalTimestamp(losslessDevice));
+      }
     }
 #endif
-  if(strcmp(NodeTag, "Volume")==0 || strcmp(NodeTag, "VectorVolume")==0)
+    else if (strcmp(deviceType.c_str(), "STATUS") == 0)
     {
-    std::vector<std::string> DeviceTypes;
-    DeviceTypes.push_back("IMAGE");
-    return DeviceTypes;
+      // The state of the remote device may have changed
+      this->CommandResponseCache->Invalidate();
+      igtlio::StatusDevice* statusDevice = reinterpret_cast<igtlio::StatusDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLIGTLStatusNode* statusNode = vtkMRMLIGTLStatusNode::SafeDownCast(modifiedNode);
+        statusNode->SetStatus(statusDevice->GetContent().code, statusDevice->GetContent().subcode, statusDevice->GetContent().errorname.c_str(), statusDevice->GetContent().statusstring.c_str());
+        statusNode->Modified();
+      }
     }
-  if(strcmp(NodeTag, "IGTLStatus")==0)
+    else if (strcmp(deviceType.c_str(), "TRANSFORM") == 0
+      || strcmp(deviceType.c_str(), vtkIGTLPositionDevice::GetIGTLTypeName()) == 0)
     {
-    return std::vector<std::string>(1, "STATUS");
+      double arrivalTime = vtkTimerLog::GetUniversalTime();
+      // The transform node copies the matrix, so the working matrix can be reused
+      vtkMatrix4x4* transfromMatrix = this->IncomingPoseMatrix;
+      if (strcmp(deviceType.c_str(), "TRANSFORM") == 0)
+      {
+        igtlio::TransformDevice* transformDevice = reinterpret_cast<igtlio::TransformDevice*>(modifiedDevice);
+        transfromMatrix->DeepCopy(transformDevice->GetContent().transform);
+      }
+      else
+      {
+        static_cast<vtkIGTLPositionDevice*>(modifiedDevice)->GetMatrix(transfromMatrix);
+      }
+      double timestamp = this->GetLocalTimestamp(modifiedDevice);
+      // Smoothing, history and prediction are applied before the MRML update
+      this->FilterPose(deviceName, timestamp, arrivalTime, transfromMatrix);
+      this->AddPoseToHistory(deviceType, deviceName, modifiedDevice->GetTimestamp(), arrivalTime, transfromMatrix);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLLinearTransformNode* transformNode = vtkMRMLLinearTransformNode::SafeDownCast(modifiedNode);
+        this->PredictPose(deviceType, deviceName, transfromMatrix);
+        transformNode->SetMatrixTransformToParent(transfromMatrix);
+        transformNode->Modified();
+      }
+      this->RecordStreamStatistics(deviceType, deviceName, timestamp, arrivalTime);
     }
-  if(strcmp(NodeTag, "LinearTransform")==0)
+    else if (strcmp(deviceType.c_str(), "POLYDATA") == 0)
     {
-    return std::vector<std::string>(1, "TRANSFORM");
+      igtlio::PolyDataDevice* polyDevice = reinterpret_cast<igtlio::PolyDataDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLModelNode* modelNode = vtkMRMLModelNode::SafeDownCast(modifiedNode);
+        modelNode->SetAndObservePolyData(polyDevice->GetContent().polydata);
+        modelNode->Modified();
+      }
     }
-  if(strcmp(NodeTag, "Model")==0 || strcmp(NodeTag, "FiberBundle")==0)
+    else if (strcmp(deviceType.c_str(), "STRING") == 0)
     {
-    return std::vector<std::string>(1, "POLYDATA");
+      igtlio::StringDevice* stringDevice = reinterpret_cast<igtlio::StringDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLTextNode* textNode = vtkMRMLTextNode::SafeDownCast(modifiedNode);
+        textNode->SetEncoding(stringDevice->GetContent().encoding);
+        textNode->SetText(stringDevice->GetContent().string_msg.c_str());
+        textNode->Modified();
+      }
     }
-  if(strcmp(NodeTag, "Text")==0)
+    else if (IsTrackingDataDeviceType(deviceType))
     {
-    return std::vector<std::string>(1, "STRING");
+      double arrivalTime = vtkTimerLog::GetUniversalTime();
+      vtkIGTLTrackingDataDevice* trackingDataDevice = static_cast<vtkIGTLTrackingDataDevice*>(modifiedDevice);
+      double timestamp = this->GetLocalTimestamp(trackingDataDevice);
+      int numberOfTools = trackingDataDevice->GetNumberOfTools();
+      const double* toolMatrices = trackingDataDevice->GetToolMatrices();
+      if (!this->TransformFilters.empty() && numberOfTools > 0)
+      {
+        // Each tool is smoothed by the filter set for its name, as an incoming TRANSFORM
+        this->FilteredToolMatrices.assign(toolMatrices, toolMatrices + 16 * numberOfTools);
+        vtkMatrix4x4* toolMatrix = this->IncomingPoseMatrix;
+        for (int i = 0; i < numberOfTools; ++i)
+        {
+          toolMatrix->DeepCopy(&this->FilteredToolMatrices[16 * i]);
+          this->FilterPose(trackingDataDevice->GetToolName(i), timestamp, arrivalTime, toolMatrix);
+          vtkMatrix4x4::DeepCopy(&this->FilteredToolMatrices[16 * i], toolMatrix);
+        }
+        toolMatrices = &this->FilteredToolMatrices[0];
+      }
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0 && numberOfTools > 0)
+      {
+        // All tools of the message are applied in one batch, so that the bundle is modified only once
+        vtkMRMLIGTLTrackingDataBundleNode* bundleNode = vtkMRMLIGTLTrackingDataBundleNode::SafeDownCast(modifiedNode);
+        bundleNode->UpdateTransformNodes(numberOfTools, trackingDataDevice->GetToolNames(),
+                                         toolMatrices, trackingDataDevice->GetToolTypes());
+      }
+      if (this->PoseHistoryCapacity > 0)
+      {
+        vtkMatrix4x4* toolMatrix = this->IncomingPoseMatrix;
+        for (int i = 0; i < numberOfTools; ++i)
+        {
+          toolMatrix->DeepCopy(toolMatrices + 16 * i);
+          this->AddPoseToHistory(deviceType, trackingDataDevice->GetToolName(i), trackingDataDevice->GetTimestamp(),
+                                 arrivalTime, toolMatrix);
+        }
+      }
+      this->RecordStreamStatistics(deviceType, deviceName, timestamp, arrivalTime);
     }
-  return std::vector<std::string>(0);
-}
-
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::ProcessMRMLEvents( vtkObject *caller, unsigned long event, void *callData )
-{
-  Superclass::ProcessMRMLEvents(caller, event, callData);
-  vtkMRMLNode* node = vtkMRMLNode::SafeDownCast(caller);
-  if (!node)
+    else if (strcmp(deviceType.c_str(), vtkIGTLImageMetaDevice::GetIGTLTypeName()) == 0)
     {
-    return;
+      vtkIGTLImageMetaDevice* imageMetaDevice = static_cast<vtkIGTLImageMetaDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLImageMetaListNode* imageMetaListNode = vtkMRMLImageMetaListNode::SafeDownCast(modifiedNode);
+        imageMetaListNode->ClearImageMetaElement();
+        for (int i = 0; i < imageMetaDevice->GetNumberOfElements(); ++i)
+        {
+          imageMetaListNode->AddImageMetaElement(imageMetaDevice->GetElement(i));
+        }
+        imageMetaListNode->Modified();
+      }
     }
-  int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
-
-  for (int i = 0; i < n; i ++)
-  {
-    const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-    if (strcmp(node->GetID(), id) == 0)
+    else if (strcmp(deviceType.c_str(), vtkIGTLLabelMetaDevice::GetIGTLTypeName()) == 0)
     {
-      this->PushNode(node);
+      vtkIGTLLabelMetaDevice* labelMetaDevice = static_cast<vtkIGTLLabelMetaDevice*>(modifiedDevice);
+      if (strcmp(modifiedNode->GetName(), deviceName.c_str()) == 0)
+      {
+        vtkMRMLLabelMetaListNode* labelMetaListNode = vtkMRMLLabelMetaListNode::SafeDownCast(modifiedNode);
+        labelMetaListNode->ClearLabelMetaElement();
+        for (int i = 0; i < labelMetaDevice->GetNumberOfElements(); ++i)
+        {
+          labelMetaListNode->AddLabelMetaElement(labelMetaDevice->GetElement(i));
+        }
+        labelMetaListNode->Modified();
+      }
+    }
+    else if (strcmp(deviceType.c_str(), "COMMAND") == 0)
+    {
+      // Process the modified event from command device.
     }
+    this->ProcessQueryResponse(deviceType, deviceName, modifiedNode);
   }
 }
 
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::RecordStreamStatistics(const std::string& deviceType, const std::string& name,
+                                                                   double timestamp, double arrivalTime)
+{
+  std::pair<std::string, std::string> key(deviceType, name);
+  StreamStatisticsMapType::iterator iter = this->StreamStatistics.find(key);
+  if (iter == this->StreamStatistics.end())
+  {
+    StreamStatisticsType statistics;
+    statistics.ArrivalInterval = vtkSmartPointer<vtkIGTLLatencyHistogram>::New();
+    statistics.Latency = vtkSmartPointer<vtkIGTLLatencyHistogram>::New();
+    statistics.LastArrivalTime = arrivalTime;
+    iter = this->StreamStatistics.insert(std::make_pair(key, statistics)).first;
+  }
+  else
+  {
+    iter->second.ArrivalInterval->RecordValue(arrivalTime - iter->second.LastArrivalTime);
+    iter->second.LastArrivalTime = arrivalTime;
+  }
+  // Senders that do not set the time stamp send 0
+  if (timestamp > 0.0)
+  {
+    iter->second.Latency->RecordValue(vtkTimerLog::GetUniversalTime() - timestamp);
+  }
+}
 
-void vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents(vtkObject *caller, unsigned long event, void *callData )
+//----------------------------------------------------------------------------
+vtkMRMLIGTLConnectorNode::vtkInternal::StreamStatisticsType* vtkMRMLIGTLConnectorNode::vtkInternal::FindStreamStatistics(
+  const char* deviceType, const char* name)
 {
-  igtlio::Connector* connector = reinterpret_cast<igtlio::Connector*>(caller);
-  igtlio::Device* modifiedDevice = reinterpret_cast<igtlio::Device*>(callData);
-  if (connector == NULL)
-    {
+  if (deviceType == NULL || name == NULL)
+  {
+    return NULL;
+  }
+  StreamStatisticsMapType::iterator iter = this->StreamStatistics.find(std::make_pair(std::string(deviceType), std::string(name)));
+  return iter == this->StreamStatistics.end() ? NULL : &iter->second;
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::vtkInternal::GetLocalTimestamp(igtlio::Device* device)
+{
+  double timestamp = device->GetTimestamp();
+  if (timestamp <= 0.0)
+  {
+    // Time stamp is not set by the sender
+    return timestamp;
+  }
+  return this->ClockOffsetEstimator->RemoteToLocalTime(timestamp);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::UpdateClockSynchronization(double currentTime)
+{
+  if (this->ClockSynchronizationInterval <= 0.0 || this->IOConnector->GetState() != igtlio::Connector::STATE_CONNECTED)
+  {
+    return;
+  }
+  if (this->ClockPingSendTime == 0.0 && currentTime - this->LastClockPingTime >= this->ClockSynchronizationInterval)
+  {
+    this->SendClockPing();
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::SendClockPing()
+{
+  if (this->ClockPingSendTime > 0.0)
+  {
+    return false;
+  }
+  std::string content = "<Command Name=\"" ClockPingCommandName "\" />";
+  double sendTime = vtkTimerLog::GetUniversalTime();
+  igtlio::CommandDevicePointer device = this->SendCommand(ClockPingDeviceName, ClockPingCommandName, content, igtlio::ASYNCHRONOUS);
+  this->LastClockPingTime = sendTime;
+  if (!device.GetPointer())
+  {
+    return false;
+  }
+  this->ClockPingDevice = device;
+  this->ClockPingCommandID = device->GetContent().id;
+  this->ClockPingSendTime = sendTime;
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::ProcessClockPingRequest(igtlio::Device* device,
+                                                                    const igtlio::CommandConverter::ContentData& content,
+                                                                    double receiveTime)
+{
+  if (device->GetDeviceName() != ClockPingDeviceName || content.name != ClockPingCommandName)
+  {
+    return false;
+  }
+  std::ostringstream response;
+  response.precision(17);
+  response << "<Command Status=\"SUCCESS\" RequestReceiveTime=\"" << receiveTime
+           << "\" ResponseSendTime=\"" << vtkTimerLog::GetUniversalTime() << "\" />";
+  this->SendCommandResponse(device->GetDeviceName(), ClockPingCommandName, response.str());
+  return true;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::ProcessClockPingResponse(double receiveTime)
+{
+  if (this->ClockPingSendTime == 0.0 || !this->ClockPingDevice.GetPointer())
+  {
+    return false;
+  }
+  igtlio::CommandDevicePointer response = this->ClockPingDevice->GetResponseFromCommandID(this->ClockPingCommandID);
+  if (!response.GetPointer())
+  {
+    if (receiveTime - this->ClockPingSendTime > ClockPingTimeout)
+    {
+      // The peer does not answer, try again at the next interval
+      this->ClockPingSendTime = 0.0;
+    }
+    return false;
+  }
+
+  double sendTime = this->ClockPingSendTime;
+  this->ClockPingSendTime = 0.0;
+  // The response is parsed where the device content holds it
+  igtlio::CommandConverter::ContentData content = response->GetContent();
+  vtkSmartPointer<vtkIGTLXMLDocument> document = vtkSmartPointer<vtkIGTLXMLDocument>::New();
+  if (!document->ParseBuffer(content.content.data(), content.content.size()))
+  {
+    vtkWarningWithObjectMacro(this->External, "ProcessClockPingResponse: invalid response: "
+                              << document->GetErrorMessage() << ": " << content.content);
+    return true;
+  }
+  int root = document->GetRootElement();
+  double requestReceiveTime = 0.0;
+  double responseSendTime = 0.0;
+  if (document->GetScalarAttribute(root, "RequestReceiveTime", requestReceiveTime)
+    && document->GetScalarAttribute(root, "ResponseSendTime", responseSendTime))
+  {
+    this->ClockOffsetEstimator->AddSample(sendTime, requestReceiveTime, responseSendTime, receiveTime);
+  }
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::AddPoseToHistory(const std::string& deviceType, const std::string& name,
+                                                              double senderTimestamp, double arrivalTime, vtkMatrix4x4* matrix)
+{
+  int capacity = this->PoseHistoryCapacity;
+  if (capacity <= 0 && !IsTrackingDataDeviceType(deviceType) && this->PosePredictors.find(name) != this->PosePredictors.end())
+  {
+    // Prediction needs the recent poses even if the history is disabled
+    capacity = MinimumPredictionHistoryCapacity;
+  }
+  if (capacity <= 0 || matrix == NULL)
+  {
+    return;
+  }
+  // Senders that do not set the time stamp send 0: their poses are stamped with the arrival time.
+  // Sender time stamps are kept in the sender's clock and converted when the history is looked up,
+  // so that a new clock offset estimate does not move the poses already in the history.
+  bool senderTime = (senderTimestamp > 0.0);
+  double timestamp = senderTime ? senderTimestamp : arrivalTime;
+  PoseHistoryType& history = this->PoseHistories[std::make_pair(deviceType, name)];
+  if (history.History == NULL)
+  {
+    history.History = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+    history.History->SetCapacity(capacity);
+    history.SenderTime = senderTime;
+  }
+  if (history.SenderTime != senderTime)
+  {
+    // The sender started or stopped setting time stamps, the two clocks cannot be mixed
+    history.History->Clear();
+    history.SenderTime = senderTime;
+  }
+  if (!history.History->AddPose(timestamp, matrix))
+  {
+    // The pose is older than the newest one: the sender clock went backward (e.g., the sender
+    // was restarted). Poses of the old and the new clock cannot be interpolated, start a new history.
+    vtkDebugWithObjectMacro(this->External, "AddPoseToHistory: time stamp of " << deviceType << " " << name
+                            << " went backward, the pose history is restarted");
+    history.History->Clear();
+    history.History->AddPose(timestamp, matrix);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLIGTLConnectorNode::vtkInternal::PoseHistoryType* vtkMRMLIGTLConnectorNode::vtkInternal::FindPoseHistory(
+  const std::string& deviceType, const std::string& name)
+{
+  PoseHistoryMapType::iterator iter = this->PoseHistories.find(std::make_pair(deviceType, name));
+  return iter == this->PoseHistories.end() ? NULL : &iter->second;
+}
+
+//----------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::vtkInternal::GetPoseHistoryTime(const PoseHistoryType& history, double localTime)
+{
+  return history.SenderTime ? this->ClockOffsetEstimator->LocalToRemoteTime(localTime) : localTime;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::PredictPose(const std::string& deviceType, const std::string& name, vtkMatrix4x4* matrix)
+{
+  PosePredictorMapType::iterator predictorIter = this->PosePredictors.find(name);
+  if (predictorIter == this->PosePredictors.end())
+  {
+    return;
+  }
+  PoseHistoryType* history = this->FindPoseHistory(deviceType, name);
+  if (history == NULL)
+  {
+    // Prediction needs the pose history
+    return;
+  }
+  // The newest pose is extrapolated by its latency, measured in the time base of the history
+  predictorIter->second->Update(history->History,
+    this->GetPoseHistoryTime(*history, vtkTimerLog::GetUniversalTime()), matrix);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::FilterPose(const std::string& name, double timestamp, double arrivalTime,
+                                                        vtkMatrix4x4* matrix)
+{
+  TransformFilterMapType::iterator iter = this->TransformFilters.find(name);
+  if (iter != this->TransformFilters.end())
+  {
+    iter->second->Filter(timestamp, arrivalTime, matrix);
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessTrackingDataResponse(vtkIGTLTrackingDataDevice* device)
+{
+  int queryStatus = (device->GetResponseStatus() == igtl::RTSTrackingDataMessage::STATUS_SUCCESS) ?
+    vtkMRMLIGTLQueryNode::STATUS_SUCCESS : vtkMRMLIGTLQueryNode::STATUS_ERROR;
+  vtkIGTLQueryManager::QueryListType respondedQueries;
+  this->External->QueryQueueMutex->Lock();
+  this->QueryManager->PopMatchingQueries(device->GetDeviceType(), device->GetDeviceName(), true, respondedQueries);
+  this->External->QueryQueueMutex->Unlock();
+
+  this->SubscriptionMutex->Lock();
+  if (this->SubscriptionManager->GetSubscriptionStatus(device->GetDeviceType(), device->GetDeviceName())
+    == vtkIGTLSubscriptionManager::STATUS_SENT)
+  {
+    this->SubscriptionManager->SetSubscriptionStatus(device->GetDeviceType(), device->GetDeviceName(),
+      queryStatus == vtkMRMLIGTLQueryNode::STATUS_SUCCESS ? vtkIGTLSubscriptionManager::STATUS_ACCEPTED
+                                                          : vtkIGTLSubscriptionManager::STATUS_REJECTED);
+  }
+  this->SubscriptionMutex->Unlock();
+
+  vtkMRMLNode* bundleNode = NULL;
+  MessageDeviceMapType::iterator deviceIter;
+  for (deviceIter = this->IncomingMRMLIDToDeviceMap.begin(); deviceIter != this->IncomingMRMLIDToDeviceMap.end(); ++deviceIter)
+  {
+    if (deviceIter->second.GetPointer() == device)
+    {
+      bundleNode = this->External->GetScene() ? this->External->GetScene()->GetNodeByID(deviceIter->first) : NULL;
+      break;
+    }
+  }
+
+  this->CompleteQueries(respondedQueries, queryStatus, bundleNode);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ProcessQueryResponse(const std::string& deviceType, const std::string& deviceName,
+                                                                 vtkMRMLNode* responseNode)
+{
+  vtkIGTLQueryManager::QueryListType respondedQueries;
+  this->External->QueryQueueMutex->Lock();
+  this->QueryManager->PopMatchingQueries(deviceType, deviceName, false, respondedQueries);
+  this->External->QueryQueueMutex->Unlock();
+  this->CompleteQueries(respondedQueries, vtkMRMLIGTLQueryNode::STATUS_SUCCESS, responseNode);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::ExpireQueries(double currentTime)
+{
+  vtkIGTLQueryManager::QueryListType expiredQueries;
+  this->External->QueryQueueMutex->Lock();
+  this->QueryManager->PopExpiredQueries(currentTime, expiredQueries);
+  this->External->QueryQueueMutex->Unlock();
+  this->CompleteQueries(expiredQueries, vtkMRMLIGTLQueryNode::STATUS_EXPIRED, NULL);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::CompleteQueries(const vtkIGTLQueryManager::QueryListType& queries,
+                                                            int queryStatus, vtkMRMLNode* responseNode)
+{
+  // Observers may push new queries, the mutex is not locked here
+  for (size_t i = 0; i < queries.size(); ++i)
+  {
+    vtkMRMLIGTLQueryNode* queryNode = queries[i];
+    queryNode->SetQueryStatus(queryStatus);
+    queryNode->SetConnectorNodeID("");
+    if (responseNode)
+    {
+      queryNode->SetResponseDataNodeID(responseNode->GetID());
+    }
+    queryNode->InvokeEvent(vtkMRMLIGTLQueryNode::ResponseEvent);
+  }
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLIGTLConnectorNode::vtkInternal::GetOrAddMRMLNodeforDevice(igtlio::Device* device)
+{
+  if (device)
+  {
+    if (device->GetMessageDirection() != igtlio::Device::MESSAGE_DIRECTION_IN)
+    {
+      // we are only interested in incomming devices
+      return NULL;
+    }
+  }
+  // Found the node and return the node;
+  NodeInfoMapType::iterator inIter;
+  for (inIter = this->IncomingMRMLNodeInfoMap.begin();
+    inIter != this->IncomingMRMLNodeInfoMap.end();
+    inIter++)
+  {
+    vtkMRMLNode* node = this->External->GetScene()->GetNodeByID((inIter->first));
+    if (node)
+    {
+      const std::string deviceType = device->GetDeviceType();
+      const std::string deviceName = device->GetDeviceName();
+      bool typeMatched = false;
+      for (unsigned int i = 0; i < this->External->GetNodeTagFromDeviceType(deviceType.c_str()).size(); i++)
+      {
+        const std::string nodeTag = this->External->GetNodeTagFromDeviceType(deviceType.c_str())[i];
+        if (strcmp(node->GetNodeTagName(), nodeTag.c_str()) == 0)
+        {
+          typeMatched = 1;
+          break;
+        }
+      }
+      if (typeMatched && strcmp(node->GetName(), deviceName.c_str()) == 0)
+      {
+        return node;
+      }
+    }
+  }
+
+  // Node not found and add the node
+  if (strcmp(device->GetDeviceType().c_str(), "IMAGE") == 0)
+  {
+    vtkSmartPointer<vtkMRMLVolumeNode> volumeNode;
+    int numberOfComponents = 1;
+    vtkSmartPointer<vtkImageData> image;
+    std::string deviceName = "";
+    igtlio::ImageDevice* imageDevice = reinterpret_cast<igtlio::ImageDevice*>(device);
+    igtlio::ImageConverter::ContentData content = imageDevice->GetContent();
+    numberOfComponents = content.image->GetNumberOfScalarComponents(); //to improve the io module to be able to cope with video data
+    image = content.image;
+    deviceName = imageDevice->GetDeviceName().c_str();
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+    volumeNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+#else
+    if (numberOfComponents>1)
+    {
+      volumeNode = vtkSmartPointer<vtkMRMLVectorVolumeNode>::New();
+    }
+    else
+    {
+      volumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+    }
+
+#endif
+    volumeNode->SetAndObserveImageData(image);
+    volumeNode->SetName(deviceName.c_str());
+    this->External->GetScene()->SaveStateForUndo();
+    volumeNode->SetDescription("Received by OpenIGTLink");
+    vtkDebugMacro("Name vol node " << volumeNode->GetClassName());
+    this->External->GetScene()->AddNode(volumeNode);
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+    vtkMRMLBitStreamNode * tempNode = vtkMRMLBitStreamNode::SafeDownCast(volumeNode);
+    tempNode->SetUpVideoDeviceByName(deviceName.c_str());
+    igtlio::VideoDevice* videoDevice = static_cast<igtlio::VideoDevice*>(tempNode->GetVideoMessageDevice());
+    vtkImageData* imageData = videoDevice->GetContent().image.GetPointer();
+    vtkImageData* srcImageData = imageDevice->GetContent().image;
+    int size[3];
+    srcImageData->GetDimensions(size);
+    imageData->SetDimensions(size[0], size[1], size[2]);
+    imageData->SetExtent(0, size[0] - 1, 0, size[1] - 1, 0, size[2] - 1);
+    imageData->SetOrigin(0.0, 0.0, 0.0);
+    imageData->SetSpacing(1.0, 1.0, 1.0);
+    int numComponents = srcImageData->GetNumberOfScalarComponents();
+#if (VTK_MAJOR_VERSION <= 5)
+    imageData->SetNumberOfScalarComponents(numComponents);
+    imageData->SetScalarType(srcImageData->GetScalarType());
+    imageData->AllocateScalars();
+#else
+    imageData->AllocateScalars(srcImageData->GetScalarType(), numComponents);
+#endif
+    igtl::ImageMessage::Pointer temImageMsg = igtl::ImageMessage::New();
+    int scalarTypeSize = temImageMsg->GetScalarSize(srcImageData->GetScalarType());
+    long dataSize = size[0] * size[1] * size[2] * scalarTypeSize*numComponents;
+    memcpy(imageData->GetScalarPointer(), srcImageData->GetScalarPointer(), dataSize);
+    //videoDevice->GetContent().image = imageData;
+#endif
+    vtkDebugMacro("Set basic display info");
+    bool scalarDisplayNodeRequired = (numberOfComponents == 1);
+    vtkSmartPointer<vtkMRMLVolumeDisplayNode> displayNode;
+    if (scalarDisplayNodeRequired)
+    {
+      displayNode = vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode>::New();
+    }
+    else
+    {
+      displayNode = vtkSmartPointer<vtkMRMLVectorVolumeDisplayNode>::New();
+    }
+
+    this->External->GetScene()->AddNode(displayNode);
+
+    if (scalarDisplayNodeRequired)
+    {
+      const char* colorTableId = vtkMRMLColorLogic::GetColorTableNodeID(vtkMRMLColorTableNode::Grey);
+      displayNode->SetAndObserveColorNodeID(colorTableId);
+    }
+    else
+    {
+      displayNode->SetDefaultColorMap();
+    }
+
+    volumeNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+    this->External->RegisterIncomingMRMLNode(volumeNode, device);
+    return volumeNode;
+  }
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  else if (strcmp(device->GetDeviceType().c_str(), "VIDEO") == 0)
+  {
+    igtlio::VideoDevice* videoDevice = reinterpret_cast<igtlio::VideoDevice*>(device);
+    igtlio::VideoConverter::ContentData content = videoDevice->GetContent();
+    int numberOfComponents = content.image->GetNumberOfScalarComponents(); //to improve the io module to be able to cope with video data
+    vtkSmartPointer<vtkImageData> image = content.image;
+    std::string deviceName = videoDevice->GetDeviceName().c_str();
+    this->External->GetScene()->SaveStateForUndo();
+    bool scalarDisplayNodeRequired = (numberOfComponents == 1);
+    vtkSmartPointer<vtkMRMLBitStreamNode> bitStreamNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+    bitStreamNode->SetName(deviceName.c_str());
+    bitStreamNode->SetDescription("Received by OpenIGTLink");
+    this->External->GetScene()->AddNode(bitStreamNode);
+    bitStreamNode->ObserveOutsideVideoDevice(reinterpret_cast<igtlio::VideoDevice*>(device));
+    vtkSmartPointer<vtkMRMLVolumeDisplayNode> displayNode;
+    if (scalarDisplayNodeRequired)
+    {
+      displayNode = vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode>::New();
+    }
+    else
+    {
+      displayNode = vtkSmartPointer<vtkMRMLVectorVolumeDisplayNode>::New();
+    }
+    this->External->GetScene()->AddNode(displayNode);
+    if (scalarDisplayNodeRequired)
+    {
+      const char* colorTableId = vtkMRMLColorLogic::GetColorTableNodeID(vtkMRMLColorTableNode::Grey);
+      displayNode->SetAndObserveColorNodeID(colorTableId);
+    }
+    else
+    {
+      displayNode->SetDefaultColorMap();
+    }
+    bitStreamNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+    this->External->RegisterIncomingMRMLNode(bitStreamNode, device);
+    return bitStreamNode;
+  }
+  else if (strcmp(device->GetDeviceType().c_str(), vtkIGTLLosslessVideoDevice::GetIGTLTypeName()) == 0)
+  {
+    vtkIGTLLosslessVideoDevice* losslessDevice = static_cast<vtkIGTLLosslessVideoDevice*>(device);
+    vtkImageData* image = losslessDevice->GetImage();
+    this->External->GetScene()->SaveStateForUndo();
+    vtkSmartPointer<vtkMRMLBitStreamNode> bitStreamNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+    bitStreamNode->SetName(device->GetDeviceName().c_str());
+    bitStreamNode->SetDescription("Received by OpenIGTLink");
+    bitStreamNode->SetOutgoingDeviceType(vtkIGTLLosslessVideoDevice::GetIGTLTypeName());
+    bitStreamNode->SetAndObserveImageData(image);
+    this->External->GetScene()->AddNode(bitStreamNode);
+    vtkSmartPointer<vtkMRMLVolumeDisplayNode> displayNode;
+    if (image->GetNumberOfScalarComponents() == 1)
+    {
+      displayNode = vtkSmartPointer<vtkMRMLScalarVolumeDisplayNode>::New();
+      this->External->GetScene()->AddNode(displayNode);
+      displayNode->SetAndObserveColorNodeID(vtkMRMLColorLogic::GetColorTableNodeID(vtkMRMLColorTableNode::Grey));
+    }
+    else
+    {
+      displayNode = vtkSmartPointer<vtkMRMLVectorVolumeDisplayNode>::New();
+      this->External->GetScene()->AddNode(displayNode);
+      displayNode->SetDefaultColorMap();
+    }
+    bitStreamNode->SetAndObserveDisplayNodeID(displayNode->GetID());
+    this->External->RegisterIncomingMRMLNode(bitStreamNode, device);
+    return bitStreamNode;
+  }
+#endif
+  else if (strcmp(device->GetDeviceType().c_str(), "STATUS") == 0)
+  {
+    vtkSmartPointer<vtkMRMLIGTLStatusNode> statusNode;
+    statusNode = vtkSmartPointer<vtkMRMLIGTLStatusNode>::New();
+    statusNode->SetName(device->GetDeviceName().c_str());
+    statusNode->SetDescription("Received by OpenIGTLink");
+    this->External->GetScene()->AddNode(statusNode);
+    this->External->RegisterIncomingMRMLNode(statusNode, device);
+    return statusNode;
+  }
+  else if (strcmp(device->GetDeviceType().c_str(), "TRANSFORM") == 0
+    || strcmp(device->GetDeviceType().c_str(), vtkIGTLPositionDevice::GetIGTLTypeName()) == 0)
+  {
+    vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode;
+    transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+    transformNode->SetName(device->GetDeviceName().c_str());
+    transformNode->SetDescription("Received by OpenIGTLink");
+
+    vtkMatrix4x4* transform = vtkMatrix4x4::New();
+    transform->Identity();
+    transformNode->ApplyTransformMatrix(transform);
+    transform->Delete();
+    this->External->GetScene()->AddNode(transformNode);
+    this->External->RegisterIncomingMRMLNode(transformNode, device);
+    return transformNode;
+  }
+  else if (strcmp(device->GetDeviceType().c_str(), "POLYDATA") == 0)
+  {
+    igtlio::PolyDataDevice* polyDevice = reinterpret_cast<igtlio::PolyDataDevice*>(device);
+    igtlio::PolyDataConverter::ContentData content = polyDevice->GetContent();
+
+    vtkSmartPointer<vtkMRMLModelNode> modelNode = NULL;
+    std::string mrmlNodeTagName = "";
+    if (device->GetMetaDataElement(MEMLNodeNameKey, mrmlNodeTagName))
+    {
+      std::string className = this->External->GetScene()->GetClassNameByTag(mrmlNodeTagName.c_str());
+      vtkMRMLNode * createdNode = this->External->GetScene()->CreateNodeByClass(className.c_str());
+      if (createdNode)
+      {
+        modelNode = vtkMRMLModelNode::SafeDownCast(createdNode);
+      }
+      else
+      {
+        modelNode = vtkSmartPointer<vtkMRMLModelNode>::New();
+      }
+    }
+    else
+    {
+      modelNode = vtkSmartPointer<vtkMRMLModelNode>::New();
+    }
+    modelNode->SetName(device->GetDeviceName().c_str());
+    modelNode->SetDescription("Received by OpenIGTLink");
+    this->External->GetScene()->AddNode(modelNode);
+    modelNode->SetAndObservePolyData(content.polydata);
+    modelNode->CreateDefaultDisplayNodes();
+    this->External->RegisterIncomingMRMLNode(modelNode, device);
+    return modelNode;
+  }
+  else if (IsTrackingDataDeviceType(device->GetDeviceType()))
+  {
+    vtkSmartPointer<vtkMRMLIGTLTrackingDataBundleNode> bundleNode = vtkSmartPointer<vtkMRMLIGTLTrackingDataBundleNode>::New();
+    bundleNode->SetName(device->GetDeviceName().c_str());
+    bundleNode->SetDescription("Received by OpenIGTLink");
+    this->External->GetScene()->AddNode(bundleNode);
+    this->External->RegisterIncomingMRMLNode(bundleNode, device);
+    return bundleNode;
+  }
+  else if (strcmp(device->GetDeviceType().c_str(), vtkIGTLImageMetaDevice::GetIGTLTypeName()) == 0)
+  {
+    vtkSmartPointer<vtkMRMLImageMetaListNode> imageMetaListNode = vtkSmartPointer<vtkMRMLImageMetaListNode>::New();
+    imageMetaListNode->SetName(device->GetDeviceName().c_str());
+    imageMetaListNode->SetDescription("Received by OpenIGTLink");
+    this->External->GetScene()->AddNode(imageMetaListNode);
+    this->External->RegisterIncomingMRMLNode(imageMetaListNode, device);
+    return imageMetaListNode;
+  }
+  else if (strcmp(device->GetDeviceType().c_str(), vtkIGTLLabelMetaDevice::GetIGTLTypeName()) == 0)
+  {
+    vtkSmartPointer<vtkMRMLLabelMetaListNode> labelMetaListNode = vtkSmartPointer<vtkMRMLLabelMetaListNode>::New();
+    labelMetaListNode->SetName(device->GetDeviceName().c_str());
+    labelMetaListNode->SetDescription("Received by OpenIGTLink");
+    this->External->GetScene()->AddNode(labelMetaListNode);
+    this->External->RegisterIncomingMRMLNode(labelMetaListNode, device);
+    return labelMetaListNode;
+  }
+  else if (strcmp(device->GetDeviceType().c_str(), "STRING") == 0)
+  {
+    igtlio::StringDevice* modifiedDevice = reinterpret_cast<igtlio::StringDevice*>(device);
+    vtkSmartPointer<vtkMRMLTextNode> textNode = vtkSmartPointer<vtkMRMLTextNode>::New();
+    textNode->SetEncoding(modifiedDevice->GetContent().encoding);
+    textNode->SetText(modifiedDevice->GetContent().string_msg.c_str());
+    textNode->SetName(device->GetDeviceName().c_str());
+    this->External->RegisterIncomingMRMLNode(textNode, device);
+    return textNode;
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------------
+igtlio::CommandDevicePointer vtkMRMLIGTLConnectorNode::vtkInternal::SendCommand(std::string device_id, std::string command, std::string content, igtlio::SYNCHRONIZATION_TYPE synchronized, double timeout_s)
+{
+  if (synchronized != igtlio::BLOCKING)
+  {
+    return this->IOConnector->SendCommand(device_id, command, content);
+  }
+
+  vtkSmartPointer<vtkIGTLCommandHandle> handle = this->SendCommandAsync(device_id, command, content, timeout_s);
+  if (handle.GetPointer() == NULL)
+  {
+    return igtlio::CommandDevicePointer();
+  }
+  if (this->IsProcessingThread())
+  {
+    // The response can only be imported by PeriodicProcess on this thread, which must not be re-entered
+    // from here (the caller may be an observer of an import). The command is sent asynchronously:
+    // the handle completes in a later PeriodicProcess and CommandResponseReceivedEvent is invoked.
+    return igtlio::CommandDevicePointer();
+  }
+  // The processing thread completes the handle and wakes this thread up, with the response or when
+  // the timeout expires. The timeout starts when the command leaves the queue.
+  while (!handle->IsDone())
+  {
+    // The expiry time is known once the command is sent, check again after timeout_s while it is queued
+    double remaining = handle->IsSent() ? handle->GetExpiryTime() - vtkTimerLog::GetUniversalTime() : timeout_s;
+    if (remaining <= 0.0)
+    {
+      // Expired, but not completed by the processing thread (PeriodicProcess is no longer called)
+      break;
+    }
+    handle->Wait(remaining);
+  }
+  if (handle->GetStatus() != vtkIGTLCommandHandle::STATUS_SUCCESS)
+  {
+    handle->Cancel();
+    return igtlio::CommandDevicePointer();
+  }
+  igtlio::DeviceKeyType key(igtlio::CommandConverter::GetIGTLTypeName(), device_id);
+  igtlio::CommandDevicePointer device = igtlio::CommandDevice::SafeDownCast(this->IOConnector->GetDevice(key));
+  return device.GetPointer() ? device->GetResponseFromCommandID(handle->GetCommandID()) : igtlio::CommandDevicePointer();
+}
+
+//----------------------------------------------------------------------------
+vtkSmartPointer<vtkIGTLCommandHandle> vtkMRMLIGTLConnectorNode::vtkInternal::SendCommandAsync(std::string device_id, std::string command,
+                                                                                               std::string content, double timeout_s, bool useCache)
+{
+  vtkSmartPointer<vtkIGTLCommandHandle> handle = vtkSmartPointer<vtkIGTLCommandHandle>::New();
+  handle->Initialize(device_id, command, content, timeout_s);
+  std::string responseName;
+  std::string responseContent;
+  double currentTime = vtkTimerLog::GetUniversalTime();
+  if (useCache && this->CommandResponseCache->GetResponse(device_id, command, content, currentTime, responseName, responseContent))
+  {
+    handle->SetCachedResponse(responseName, responseContent, currentTime);
+    return handle;
+  }
+  QueuedCommandType queuedCommand;
+  queuedCommand.Handle = handle;
+  queuedCommand.Content = content;
+  this->PendingCommandsMutex->Lock();
+  this->QueuedCommands.push_back(queuedCommand);
+  this->PendingCommandsMutex->Unlock();
+  this->SendQueuedCommands();
+  return handle;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::SendQueuedCommands()
+{
+  while (true)
+  {
+    this->PendingCommandsMutex->Lock();
+    if (this->QueuedCommands.empty()
+      || static_cast<int>(this->CommandsInFlight.size()) + this->NumberOfCommandsSending >= this->CommandWindowSize)
+    {
+      this->PendingCommandsMutex->Unlock();
+      return;
+    }
+    QueuedCommandType queuedCommand = this->QueuedCommands.front();
+    this->QueuedCommands.pop_front();
+    vtkIGTLCommandHandle* handle = queuedCommand.Handle;
+    if (handle->IsDone())
+    {
+      // Cancelled while queued
+      this->PendingCommandsMutex->Unlock();
+      continue;
+    }
+    // Reserve the slot before sending, the ID is known once the command is sent
+    this->NumberOfCommandsSending++;
+    this->PendingCommandsMutex->Unlock();
+
+    igtlio::CommandDevicePointer device = this->IOConnector->SendCommand(handle->GetDeviceName(), handle->GetCommandName(), queuedCommand.Content);
+    double sendTime = vtkTimerLog::GetUniversalTime();
+
+    bool respondedEarly = false;
+    EarlyCommandResponseType earlyResponse;
+    this->PendingCommandsMutex->Lock();
+    this->NumberOfCommandsSending--;
+    if (device.GetPointer())
+    {
+      CommandKeyType key(handle->GetDeviceName(), device->GetContent().id);
+      handle->SetSent(key.second, sendTime);
+      std::map<CommandKeyType, EarlyCommandResponseType>::iterator earlyIter = this->EarlyCommandResponses.find(key);
+      if (earlyIter != this->EarlyCommandResponses.end())
+      {
+        // The processing thread received the response while this thread was sending
+        respondedEarly = true;
+        earlyResponse = earlyIter->second;
+        this->EarlyCommandResponses.erase(earlyIter);
+      }
+      else
+      {
+        this->CommandsInFlight[key] = queuedCommand.Handle;
+      }
+    }
+    if (this->NumberOfCommandsSending == 0)
+    {
+      this->EarlyCommandResponses.clear();
+    }
+    this->PendingCommandsMutex->Unlock();
+
+    if (device.GetPointer() == NULL)
+    {
+      handle->Fail(sendTime);
+    }
+    else if (respondedEarly)
+    {
+      this->CompleteCommand(handle, earlyResponse.Name, earlyResponse.Content, earlyResponse.ReceiveTime);
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::ProcessCommandResponse(igtlio::Device* device, double receiveTime)
+{
+  igtlio::CommandDevice* commandDevice = igtlio::CommandDevice::SafeDownCast(device);
+  if (commandDevice == NULL)
+  {
+    return false;
+  }
+  // The device content is the received response, which carries the ID of the command it answers
+  igtlio::CommandConverter::ContentData content = commandDevice->GetContent();
+  vtkSmartPointer<vtkIGTLCommandHandle> handle;
+  this->PendingCommandsMutex->Lock();
+  CommandKeyType key(device->GetDeviceName(), content.id);
+  CommandCorrelationMapType::iterator iter = this->CommandsInFlight.find(key);
+  if (iter != this->CommandsInFlight.end())
+  {
+    handle = iter->second;
+    this->CommandsInFlight.erase(iter);
+  }
+  else if (this->NumberOfCommandsSending > 0)
+  {
+    // May answer a command whose send call has not returned yet, SendQueuedCommands picks it up
+    EarlyCommandResponseType& earlyResponse = this->EarlyCommandResponses[key];
+    earlyResponse.Name = content.name;
+    earlyResponse.Content.swap(content.content);
+    earlyResponse.ReceiveTime = receiveTime;
+  }
+  this->PendingCommandsMutex->Unlock();
+  if (handle.GetPointer() == NULL)
+  {
+    return false;
+  }
+  this->CompleteCommand(handle, content.name, content.content, receiveTime);
+  this->SendQueuedCommands();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::CompleteCommand(vtkIGTLCommandHandle* handle, const std::string& responseName,
+                                                            std::string& responseContent, double receiveTime)
+{
+  // The cache copies the response only for commands with a time to live. It is stored before the
+  // handle takes the content: a response to the command is valid even if the handle has just expired.
+  this->CommandResponseCache->AddResponse(handle->GetDeviceName(), handle->GetCommandName(), handle->GetCommandContent(),
+                                          responseName, responseContent, receiveTime);
+  handle->TakeResponse(responseName, responseContent, receiveTime);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::UpdatePendingCommands(double currentTime)
+{
+  std::vector< vtkSmartPointer<vtkIGTLCommandHandle> > responded;
+  std::vector<igtlio::CommandDevicePointer> responses;
+  std::vector< vtkSmartPointer<vtkIGTLCommandHandle> > expired;
+  this->PendingCommandsMutex->Lock();
+  CommandCorrelationMapType::iterator iter = this->CommandsInFlight.begin();
+  while (iter != this->CommandsInFlight.end())
+  {
+    vtkIGTLCommandHandle* handle = iter->second;
+    if (handle->IsDone())
+    {
+      // Cancelled by the caller, the slot is freed
+      this->CommandsInFlight.erase(iter++);
+      continue;
+    }
+    if (currentTime <= handle->GetExpiryTime())
+    {
+      ++iter;
+      continue;
+    }
+    // Before expiring, look for a response that was not matched when it was received
+    igtlio::DeviceKeyType key(igtlio::CommandConverter::GetIGTLTypeName(), handle->GetDeviceName());
+    igtlio::CommandDevicePointer device = igtlio::CommandDevice::SafeDownCast(this->IOConnector->GetDevice(key));
+    igtlio::CommandDevicePointer response;
+    if (device.GetPointer())
+    {
+      response = device->GetResponseFromCommandID(handle->GetCommandID());
+    }
+    if (response.GetPointer())
+    {
+      responded.push_back(handle);
+      responses.push_back(response);
+    }
+    else
+    {
+      expired.push_back(handle);
+    }
+    this->CommandsInFlight.erase(iter++);
+  }
+  // Release the issued handles completed long enough ago, in place to keep the request order
+  size_t numberOfIssuedHandles = 0;
+  for (size_t i = 0; i < this->IssuedCommandHandles.size(); ++i)
+  {
+    vtkIGTLCommandHandle* handle = this->IssuedCommandHandles[i];
+    if (!handle->IsDone() || currentTime - handle->GetCompletionTime() <= CommandHandleRetentionTime)
+    {
+      this->IssuedCommandHandles[numberOfIssuedHandles++] = handle;
+    }
+  }
+  this->IssuedCommandHandles.resize(numberOfIssuedHandles);
+  this->PendingCommandsMutex->Unlock();
+
+  // Handles invoke their completion event, complete them without holding the lock
+  for (size_t i = 0; i < responded.size(); ++i)
+  {
+    igtlio::CommandConverter::ContentData content = responses[i]->GetContent();
+    this->CompleteCommand(responded[i], content.name, content.content, currentTime);
+  }
+  for (size_t i = 0; i < expired.size(); ++i)
+  {
+    expired[i]->Expire(currentTime);
+  }
+  this->SendQueuedCommands();
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::IsProcessingThread()
+{
+  return this->ProcessingThreadIDValid
+    && vtkMultiThreader::ThreadsEqual(this->ProcessingThreadID, vtkMultiThreader::GetCurrentThreadID());
+}
+
+//----------------------------------------------------------------------------
+igtlio::CommandDevicePointer vtkMRMLIGTLConnectorNode::vtkInternal::SendCommandResponse(std::string device_id, std::string command, std::string content)
+{
+  igtlio::DeviceKeyType key(igtlio::CommandConverter::GetIGTLTypeName(), device_id);
+  igtlio::CommandDevicePointer device = igtlio::CommandDevice::SafeDownCast(this->IOConnector->GetDevice(key));
+
+  igtlio::CommandConverter::ContentData contentdata = device->GetContent();
+
+  if (command != contentdata.name)
+  {
+    vtkGenericWarningMacro("Requested command response " << command << " does not match the existing query: " << contentdata.name);
+    return igtlio::CommandDevicePointer();
+  }
+
+  contentdata.name = command;
+  contentdata.content = content;
+  device->SetContent(contentdata);
+
+  this->IOConnector->SendMessage(CreateDeviceKey(device), igtlio::Device::MESSAGE_PREFIX_RTS);
+  return device;
+}
+
+//----------------------------------------------------------------------------
+igtlio::CommandDevicePointer vtkMRMLIGTLConnectorNode::vtkInternal::SendCommandResponse(std::string device_id, std::string command,
+                                                                                       int commandID, std::string content)
+{
+  igtlio::DeviceKeyType key(igtlio::CommandConverter::GetIGTLTypeName(), device_id);
+  igtlio::CommandDevicePointer device = igtlio::CommandDevice::SafeDownCast(this->IOConnector->GetDevice(key));
+  if (!device.GetPointer())
+  {
+    vtkGenericWarningMacro("Cannot send command response " << command << ": device " << device_id << " not found");
+    return igtlio::CommandDevicePointer();
+  }
+
+  igtlio::CommandConverter::ContentData contentdata = device->GetContent();
+  contentdata.id = commandID;
+  contentdata.name = command;
+  contentdata.content = content;
+  device->SetContent(contentdata);
+
+  this->IOConnector->SendMessage(CreateDeviceKey(device), igtlio::Device::MESSAGE_PREFIX_RTS);
+  return device;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::vtkInternal::DispatchCommand(igtlio::Device* device, igtlio::CommandConverter::ContentData& content,
+                                                            double receiveTime)
+{
+  if (!this->CommandDispatcher->HasHandler(content.name))
+  {
+    return false;
+  }
+  vtkSmartPointer<vtkIGTLCommandRequest> request = vtkSmartPointer<vtkIGTLCommandRequest>::New();
+  request->Initialize(this->External, device->GetDeviceName(), content.name, content.id, std::string(), receiveTime);
+  // The request takes the received content, handlers parse it in place
+  request->TakeContent(content.content);
+  if (!this->CommandDispatcher->Submit(request))
+  {
+    return false;
+  }
+  // Handlers run without worker threads complete immediately
+  this->SendCompletedCommandResponses();
+  return true;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::vtkInternal::SendCompletedCommandResponses()
+{
+  std::vector< vtkSmartPointer<vtkIGTLCommandRequest> > completedRequests;
+  this->CommandDispatcher->PopCompletedRequests(completedRequests);
+  for (size_t i = 0; i < completedRequests.size(); ++i)
+  {
+    vtkIGTLCommandRequest* request = completedRequests[i];
+    this->SendCommandResponse(request->GetDeviceName(), request->GetCommandName(), request->GetCommandID(),
+                              request->GetResponseContent());
+  }
+}
+
+
+//----------------------------------------------------------------------------
+// vtkMRMLIGTLConnectorNode method
+
+//----------------------------------------------------------------------------
+vtkMRMLIGTLConnectorNode::vtkMRMLIGTLConnectorNode()
+{
+  this->Internal = new vtkInternal(this);
+  this->HideFromEditors = false;
+  this->QueryQueueMutex = vtkMutexLock::New();
+  this->ConnectEvents();
+  // TDATA and QTDATA streams are received without a preceding query as well
+  this->Internal->IOConnector->GetDeviceFactory()->registerCreator<vtkIGTLTrackingDataDeviceCreator>();
+  this->Internal->IOConnector->GetDeviceFactory()->registerCreator<vtkIGTLQuaternionTrackingDataDeviceCreator>();
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  // Received VIDEO frames are converted with vtkIGTLI420ToRGBConverter
+  this->Internal->IOConnector->GetDeviceFactory()->registerCreator<vtkIGTLVideoDeviceCreator>();
+#endif
+  this->Internal->AddCapabilityDevice();
+ 
+  this->IncomingNodeReferenceRole=NULL;
+  this->IncomingNodeReferenceMRMLAttributeName=NULL;
+  this->OutgoingNodeReferenceRole=NULL;
+  this->OutgoingNodeReferenceMRMLAttributeName=NULL;
+  
+  this->SetIncomingNodeReferenceRole("incoming");
+  this->SetIncomingNodeReferenceMRMLAttributeName("incomingNodeRef");
+  this->AddNodeReferenceRole(this->GetIncomingNodeReferenceRole(),
+                             this->GetIncomingNodeReferenceMRMLAttributeName());
+
+  this->SetOutgoingNodeReferenceRole("outgoing");
+  this->SetOutgoingNodeReferenceMRMLAttributeName("outgoingNodeRef");
+  this->AddNodeReferenceRole(this->GetOutgoingNodeReferenceRole(),
+                             this->GetOutgoingNodeReferenceMRMLAttributeName());
+
+  this->Internal->DeviceTypeToNodeTagMap.clear();
+  std::string volumeTags[] = {"Volume", "VectorVolume", "BitStream"};
+  this->Internal->DeviceTypeToNodeTagMap["IMAGE"] = std::vector<std::string>(volumeTags, volumeTags+3);
+  this->Internal->DeviceTypeToNodeTagMap["VIDEO"] = std::vector<std::string>(1,"BitStream");
+  this->Internal->DeviceTypeToNodeTagMap["LLVIDEO"] = std::vector<std::string>(1,"BitStream");
+  this->Internal->DeviceTypeToNodeTagMap["STATUS"] = std::vector<std::string>(1,"IGTLStatus");
+  this->Internal->DeviceTypeToNodeTagMap["TRANSFORM"] = std::vector<std::string>(1,"LinearTransform");
+  this->Internal->DeviceTypeToNodeTagMap["POSITION"] = std::vector<std::string>(1,"LinearTransform");
+  std::string modelTags[] = {"Model", "FiberBundle"};
+  this->Internal->DeviceTypeToNodeTagMap["POLYDATA"] = std::vector<std::string>(modelTags, modelTags+2);
+  this->Internal->DeviceTypeToNodeTagMap["STRING"] = std::vector<std::string>(1,"Text");
+  this->Internal->DeviceTypeToNodeTagMap["TDATA"] = std::vector<std::string>(1,"IGTLTrackingDataSplitter");
+  this->Internal->DeviceTypeToNodeTagMap["QTDATA"] = std::vector<std::string>(1,"IGTLTrackingDataSplitter");
+  this->Internal->DeviceTypeToNodeTagMap["IMGMETA"] = std::vector<std::string>(1,"ImageMetaList");
+  this->Internal->DeviceTypeToNodeTagMap["LBMETA"] = std::vector<std::string>(1,"LabelMetaList");
+  
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLIGTLConnectorNode::~vtkMRMLIGTLConnectorNode()
+{
+  // Command handlers may still access the connector, wait for them to return
+  this->Internal->CommandDispatcher->Shutdown();
+
+  if (this->QueryQueueMutex)
+    {
+    this->QueryQueueMutex->Delete();
+    }
+
+  delete this->Internal;
+  this->Internal = NULL;
+}
+
+void vtkMRMLIGTLConnectorNode::ConnectEvents()
+{
+  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->ConnectedEvent, this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->DisconnectedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->ActivatedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->DeactivatedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->NewDeviceEvent, this,  &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+  this->Internal->IOConnector->AddObserver(this->Internal->IOConnector->RemovedDeviceEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+}
+
+//----------------------------------------------------------------------------
+std::vector<std::string> vtkMRMLIGTLConnectorNode::GetNodeTagFromDeviceType(const char * deviceType)
+{
+  vtkInternal::DeviceTypeToNodeTagMapType::iterator iter;
+  if(this->Internal->DeviceTypeToNodeTagMap.find(std::string(deviceType)) != this->Internal->DeviceTypeToNodeTagMap.end())
+    {
+    return this->Internal->DeviceTypeToNodeTagMap.find(std::string(deviceType))->second;
+    }
+  return std::vector<std::string>(0);
+}
+
+//----------------------------------------------------------------------------
+std::vector<std::string> vtkMRMLIGTLConnectorNode::GetDeviceTypeFromMRMLNodeType(const char* NodeTag)
+{
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  if(strcmp(NodeTag, "BitStream")==0)
+    {
+    std::vector<std::string> DeviceTypes;
+    DeviceTypes.push_back("VIDEO");
+    DeviceTypes.push_back("IMAGE");
+    return DeviceTypes;
+    }
+#endif
+  if(strcmp(NodeTag, "Volume")==0 || strcmp(NodeTag, "VectorVolume")==0)
+    {
+    std::vector<std::string> DeviceTypes;
+    DeviceTypes.push_back("IMAGE");
+    return DeviceTypes;
+    }
+  if(strcmp(NodeTag, "IGTLStatus")==0)
+    {
+    return std::vector<std::string>(1, "STATUS");
+    }
+  if(strcmp(NodeTag, "LinearTransform")==0)
+    {
+    return std::vector<std::string>(1, "TRANSFORM");
+    }
+  if(strcmp(NodeTag, "Model")==0 || strcmp(NodeTag, "FiberBundle")==0)
+    {
+    return std::vector<std::string>(1, "POLYDATA");
+    }
+  if(strcmp(NodeTag, "Text")==0)
+    {
+    return std::vector<std::string>(1, "STRING");
+    }
+  if(strcmp(NodeTag, "IGTLTrackingDataSplitter")==0)
+    {
+    return std::vector<std::string>(1, vtkIGTLTrackingDataDevice::GetIGTLTypeName());
+    }
+  return std::vector<std::string>(0);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::ProcessMRMLEvents( vtkObject *caller, unsigned long event, void *callData )
+{
+  Superclass::ProcessMRMLEvents(caller, event, callData);
+  vtkMRMLNode* node = vtkMRMLNode::SafeDownCast(caller);
+  if (!node)
+    {
+    return;
+    }
+  int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
+
+  for (int i = 0; i < n; i ++)
+  {
+    const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+    if (strcmp(node->GetID(), id) == 0)
+    {
+      this->PushNode(node);
+    }
+  }
+}
+
+
+void vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents(vtkObject *caller, unsigned long event, void *callData )
+{
+  igtlio::Connector* connector = reinterpret_cast<igtlio::Connector*>(caller);
+  igtlio::Device* modifiedDevice = reinterpret_cast<igtlio::Device*>(callData);
+  if (connector == NULL)
+    {
     // we are only interested in proxy node modified events
     return;
     }
-  int mrmlEvent = -1;
-  switch (event)
+  int mrmlEvent = -1;
+  switch (event)
+    {
+    case igtlio::Connector::ConnectedEvent:
+      mrmlEvent = ConnectedEvent;
+      // The peer may be a different computer
+      this->ResetClockSynchronization();
+      // Request the subscribed streams again, the peer starts without streams
+      this->Internal->SubscriptionMutex->Lock();
+      this->Internal->SubscriptionManager->ResetSubscriptions();
+      this->Internal->SubscriptionManager->RemoveAllRemoteSubscriptions();
+      this->Internal->SubscriptionMutex->Unlock();
+      // The peer may be a different application
+      this->Internal->ClearPeerCapability();
+      this->RequestPeerCapability();
+      break;
+    case igtlio::Connector::DisconnectedEvent:
+      mrmlEvent = DisconnectedEvent;
+      this->Internal->SubscriptionMutex->Lock();
+      this->Internal->SubscriptionManager->ResetSubscriptions();
+      this->Internal->SubscriptionManager->RemoveAllRemoteSubscriptions();
+      this->Internal->SubscriptionMutex->Unlock();
+      if (this->Internal->ClearPeerCapability())
+        {
+        this->InvokeEvent(PeerCapabilityModifiedEvent);
+        }
+      break;
+    case igtlio::Connector::ActivatedEvent: mrmlEvent = ActivatedEvent; break;
+    case igtlio::Connector::DeactivatedEvent: mrmlEvent = DeactivatedEvent; break;
+    case 118948: mrmlEvent = ReceiveEvent; break; // deprecated. it was for query response, OpenIGTLinkIO doesn't support query event. it is replaced with command message.
+    case igtlio::Connector::NewDeviceEvent: mrmlEvent = NewDeviceEvent; break;
+    case igtlio::Connector::DeviceContentModifiedEvent: mrmlEvent = DeviceModifiedEvent; break;
+    case igtlio::Connector::RemovedDeviceEvent: mrmlEvent = DeviceModifiedEvent; break;
+    case igtlio::Device::CommandReceivedEvent: mrmlEvent = CommandReceivedEvent; break;  // COMMAND device got a query, COMMAND received
+    case igtlio::Device::CommandResponseReceivedEvent: mrmlEvent = CommandResponseReceivedEvent; break;  // COMMAND device got a response, RTS_COMMAND received
+    }
+  if( modifiedDevice != NULL)
+    {
+    if(event==this->Internal->IOConnector->NewDeviceEvent)
+      {
+      // no action perform at this stage, wait until the message content in the device is unpacked,
+      // As we need the message content data to create mrmlnode.
+      // Also the newly added device could also be a outgoing message from IF module
+      //this->ProcessNewDeviceEvent(caller, event, callData );
+      //modifiedDevice->AddObserver(modifiedDevice->GetDeviceContentModifiedEvent(),  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+      if (modifiedDevice->MessageDirectionIsIn())
+        {
+        modifiedDevice->AddObserver(modifiedDevice->GetDeviceContentModifiedEvent(),  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        if (modifiedDevice->GetDeviceType().compare(igtlio::CommandConverter::GetIGTLTypeName()) == 0)
+          {
+          modifiedDevice->AddObserver(modifiedDevice->CommandReceivedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+          modifiedDevice->AddObserver(modifiedDevice->CommandResponseReceivedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+          }
+        if (IsTrackingDataDeviceType(modifiedDevice->GetDeviceType()))
+          {
+          modifiedDevice->AddObserver(vtkIGTLTrackingDataDevice::TrackingDataResponseEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+          }
+        }
+      if (IsTrackingDataDeviceType(modifiedDevice->GetDeviceType()))
+        {
+        // The peer may request the stream of the tracking data sent by this connector
+        modifiedDevice->AddObserver(vtkIGTLTrackingDataDevice::StartStreamingRequestEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        modifiedDevice->AddObserver(vtkIGTLTrackingDataDevice::StopStreamingRequestEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        }
+      // The peer may request the lists and the images of the scene
+      if (modifiedDevice->GetDeviceType().compare(vtkIGTLImageMetaDevice::GetIGTLTypeName()) == 0)
+        {
+        modifiedDevice->AddObserver(vtkIGTLImageMetaDevice::ImageMetaRequestEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        }
+      if (modifiedDevice->GetDeviceType().compare(vtkIGTLLabelMetaDevice::GetIGTLTypeName()) == 0)
+        {
+        modifiedDevice->AddObserver(vtkIGTLLabelMetaDevice::LabelMetaRequestEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        }
+      if (vtkIGTLServedImageDevice::SafeDownCast(modifiedDevice))
+        {
+        modifiedDevice->AddObserver(vtkIGTLServedImageDevice::ImageRequestEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        }
+      if (modifiedDevice == this->Internal->CapabilityDevice.GetPointer())
+        {
+        modifiedDevice->AddObserver(vtkIGTLCapabilityDevice::CapabilityModifiedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        modifiedDevice->AddObserver(vtkIGTLCapabilityDevice::CapabilityRequestEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        }
+      }
+    if(modifiedDevice == this->Internal->CapabilityDevice.GetPointer()
+      && (event==vtkIGTLCapabilityDevice::CapabilityModifiedEvent || event==vtkIGTLCapabilityDevice::CapabilityRequestEvent))
+      {
+      // CAPABIL or GET_CAPABIL received from the peer
+      if (event==vtkIGTLCapabilityDevice::CapabilityRequestEvent)
+        {
+        this->Internal->ProcessCapabilityRequest();
+        }
+      else
+        {
+        this->Internal->ProcessPeerCapability();
+        }
+      return;
+      }
+    if(event==modifiedDevice->GetDeviceContentModifiedEvent())
+      {
+      if (modifiedDevice->MessageDirectionIsIn())
+        {
+        this->Internal->ProcessIncomingDeviceModifiedEvent(caller, event, modifiedDevice);
+        }
+      else if (modifiedDevice->MessageDirectionIsOut())
+        {
+        this->Internal->ProcessOutgoingDeviceModifiedEvent(caller, event, modifiedDevice);
+        }
+      }
+    if(event==modifiedDevice->CommandReceivedEvent || event==modifiedDevice->CommandResponseReceivedEvent)
+      {
+      // Clock synchronization pings are answered and processed here, without notifying observers
+      double receiveTime = vtkTimerLog::GetUniversalTime();
+      igtlio::CommandDevice* commandDevice = igtlio::CommandDevice::SafeDownCast(modifiedDevice);
+      if (event==modifiedDevice->CommandReceivedEvent && commandDevice)
+        {
+        // The content is copied out of the device once for the ping check and the dispatch
+        igtlio::CommandConverter::ContentData content = commandDevice->GetContent();
+        if (this->Internal->ProcessClockPingRequest(modifiedDevice, content, receiveTime))
+          {
+          return;
+          }
+        // A command from the peer may change the state that cached responses describe
+        this->Internal->CommandResponseCache->Invalidate();
+        if (this->Internal->DispatchCommand(modifiedDevice, content, receiveTime))
+          {
+          // Answered by a registered handler, not by the observers
+          return;
+          }
+        }
+      if (event==modifiedDevice->CommandResponseReceivedEvent && modifiedDevice == this->Internal->ClockPingDevice.GetPointer()
+        && this->Internal->ProcessClockPingResponse(receiveTime))
+        {
+        return;
+        }
+      if (event==modifiedDevice->CommandResponseReceivedEvent)
+        {
+        this->Internal->ProcessCommandResponse(modifiedDevice, receiveTime);
+        }
+      this->InvokeEvent(mrmlEvent, modifiedDevice);
+      return;
+      }
+    if(event==vtkIGTLTrackingDataDevice::TrackingDataResponseEvent)
+      {
+      // RTS_TDATA or RTS_QTDATA received, the start or stop query is accepted or rejected
+      this->Internal->ProcessTrackingDataResponse(static_cast<vtkIGTLTrackingDataDevice*>(modifiedDevice));
+      return;
+      }
+    if(event==vtkIGTLTrackingDataDevice::StartStreamingRequestEvent || event==vtkIGTLTrackingDataDevice::StopStreamingRequestEvent)
+      {
+      // STT_TDATA or STP_TDATA (or their QTDATA counterparts) received from the peer
+      this->Internal->ProcessStreamingRequest(static_cast<vtkIGTLTrackingDataDevice*>(modifiedDevice),
+        event==vtkIGTLTrackingDataDevice::StartStreamingRequestEvent, vtkTimerLog::GetUniversalTime());
+      return;
+      }
+    if(event==vtkIGTLImageMetaDevice::ImageMetaRequestEvent || event==vtkIGTLLabelMetaDevice::LabelMetaRequestEvent)
+      {
+      // GET_IMGMETA or GET_LBMETA received from the peer
+      this->Internal->ProcessImageMetaRequest(modifiedDevice);
+      return;
+      }
+    if(event==vtkIGTLServedImageDevice::ImageRequestEvent)
+      {
+      // GET_IMAGE received from the peer for an image listed by this connector
+      this->Internal->ProcessImageRequest(modifiedDevice);
+      return;
+      }
+    }
+  //propagate the event to the connector property and treeview widgets
+  this->InvokeEvent(mrmlEvent);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::WriteXML(ostream& of, int nIndent)
+{
+
+  // Start by having the superclass write its information
+  Superclass::WriteXML(of, nIndent);
+
+  switch (this->Internal->IOConnector->GetType())
+    {
+      case igtlio::Connector::TYPE_SERVER:
+      of << " connectorType=\"" << "SERVER" << "\" ";
+      break;
+    case igtlio::Connector::TYPE_CLIENT:
+      of << " connectorType=\"" << "CLIENT" << "\" ";
+      of << " serverHostname=\"" << this->Internal->IOConnector->GetServerHostname() << "\" ";
+      break;
+    default:
+      of << " connectorType=\"" << "NOT_DEFINED" << "\" ";
+      break;
+    }
+
+  of << " serverPort=\"" << this->Internal->IOConnector->GetServerPort() << "\" ";
+  of << " persistent=\"" << this->Internal->IOConnector->GetPersistent() << "\" ";
+  of << " state=\"" << this->Internal->IOConnector->GetState() <<"\"";
+  of << " restrictDeviceName=\"" << this->Internal->IOConnector->GetRestrictDeviceName() << "\" ";
+
+}
+
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::ReadXMLAttributes(const char** atts)
+{
+  vtkMRMLNode::ReadXMLAttributes(atts);
+
+  const char* attName;
+  const char* attValue;
+
+  const char* serverHostname = "";
+  int port = 0;
+  int type = -1;
+  int restrictDeviceName = 0;
+  int state = igtlio::Connector::STATE_OFF;
+  int persistent = igtlio::Connector::PERSISTENT_OFF;
+
+  while (*atts != NULL)
+    {
+    attName = *(atts++);
+    attValue = *(atts++);
+
+    if (!strcmp(attName, "connectorType"))
+      {
+      if (!strcmp(attValue, "SERVER"))
+        {
+        type = igtlio::Connector::TYPE_SERVER;
+        }
+      else if (!strcmp(attValue, "CLIENT"))
+        {
+        type = igtlio::Connector::TYPE_CLIENT;
+        }
+      else
+        {
+        type = igtlio::Connector::TYPE_NOT_DEFINED;
+        }
+      }
+    if (!strcmp(attName, "serverHostname"))
+      {
+      serverHostname = attValue;
+      }
+    if (!strcmp(attName, "serverPort"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> port;
+      }
+    if (!strcmp(attName, "restrictDeviceName"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> restrictDeviceName;;
+      }
+    if (!strcmp(attName, "persistent"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> persistent;
+      }
+    if (!strcmp(attName, "state"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> state;
+      }
+    /*if (!strcmp(attName, "logErrorIfServerConnectionFailed"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      ss >> LogErrorIfServerConnectionFailed;
+      }
+    }*/
+
+  switch(type)
+    {
+    case igtlio::Connector::TYPE_SERVER:
+      this->Internal->IOConnector->SetTypeServer(port);
+      this->Internal->IOConnector->SetRestrictDeviceName(restrictDeviceName);
+      break;
+    case igtlio::Connector::TYPE_CLIENT:
+      this->Internal->IOConnector->SetTypeClient(serverHostname, port);
+      this->Internal->IOConnector->SetRestrictDeviceName(restrictDeviceName);
+      break;
+    default: // not defined
+      // do nothing
+      break;
+    }
+
+  if (persistent == igtlio::Connector::PERSISTENT_ON)
+    {
+    this->Internal->IOConnector->SetPersistent(igtlio::Connector::PERSISTENT_ON);
+    // At this point not all the nodes are loaded so we cannot start
+    // the processing thread (if we activate the connection then it may immediately
+    // start receiving messages, create corresponding MRML nodes, while the same
+    // MRML nodes are being loaded from the scene; this would result in duplicate
+    // MRML nodes).
+    // All the nodes will be activated by the module logic when the scene import is finished.
+    this->Internal->IOConnector->SetState(state);
+    this->Modified();
+    }
+  }
+}
+
+
+//----------------------------------------------------------------------------
+// Copy the node's attributes to this object.
+// Does NOT copy: ID, FilePrefix, Name, VolumeID
+void vtkMRMLIGTLConnectorNode::Copy(vtkMRMLNode *anode)
+{
+  Superclass::Copy(anode);
+  vtkMRMLIGTLConnectorNode *node = (vtkMRMLIGTLConnectorNode *) anode;
+
+  int type = node->Internal->IOConnector->GetType();
+
+  switch(type)
+    {
+      case igtlio::Connector::TYPE_SERVER:
+      this->Internal->IOConnector->SetType(igtlio::Connector::TYPE_SERVER);
+      this->Internal->IOConnector->SetTypeServer(node->Internal->IOConnector->GetServerPort());
+      this->Internal->IOConnector->SetRestrictDeviceName(node->Internal->IOConnector->GetRestrictDeviceName());
+      break;
+    case igtlio::Connector::TYPE_CLIENT:
+      this->Internal->IOConnector->SetType(igtlio::Connector::TYPE_CLIENT);
+      this->Internal->IOConnector->SetTypeClient(node->Internal->IOConnector->GetServerHostname(), node->Internal->IOConnector->GetServerPort());
+      this->Internal->IOConnector->SetRestrictDeviceName(node->Internal->IOConnector->GetRestrictDeviceName());
+      break;
+    default: // not defined
+      // do nothing
+        this->Internal->IOConnector->SetType(igtlio::Connector::TYPE_NOT_DEFINED);
+      break;
+    }
+  this->Internal->IOConnector->SetState(node->Internal->IOConnector->GetState());
+  this->Internal->IOConnector->SetPersistent(node->Internal->IOConnector->GetPersistent());
+}
+
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::PrintSelf(ostream& os, vtkIndent indent)
+{
+  Superclass::PrintSelf(os,indent);
+
+  if (this->Internal->IOConnector->GetType() == igtlio::Connector::TYPE_SERVER)
+    {
+    os << indent << "Connector Type : SERVER\n";
+    os << indent << "Listening Port #: " << this->Internal->IOConnector->GetServerPort() << "\n";
+    }
+  else if (this->Internal->IOConnector->GetType() == igtlio::Connector::TYPE_CLIENT)
+    {
+    os << indent << "Connector Type: CLIENT\n";
+    os << indent << "Server Hostname: " << this->Internal->IOConnector->GetServerHostname() << "\n";
+    os << indent << "Server Port #: " << this->Internal->IOConnector->GetServerPort() << "\n";
+    }
+
+  switch (this->Internal->IOConnector->GetState())
+    {
+    case igtlio::Connector::STATE_OFF:
+      os << indent << "State: OFF\n";
+      break;
+    case igtlio::Connector::STATE_WAIT_CONNECTION:
+      os << indent << "State: WAIT FOR CONNECTION\n";
+      break;
+    case igtlio::Connector::STATE_CONNECTED:
+      os << indent << "State: CONNECTED\n";
+      break;
+    }
+  os << indent << "Persistent: " << this->Internal->IOConnector->GetPersistent() << "\n";
+  os << indent << "Restrict Device Name: " << this->Internal->IOConnector->GetRestrictDeviceName() << "\n";
+  os << indent << "Push Outgoing Message Flag: " << this->Internal->IOConnector->GetPushOutgoingMessageFlag() << "\n";
+  os << indent << "Check CRC: " << this->Internal->IOConnector->GetCheckCRC()<< "\n";
+  os << indent << "Number of outgoing nodes: " << this->GetNumberOfOutgoingMRMLNodes() << "\n";
+  os << indent << "Number of incoming nodes: " << this->GetNumberOfIncomingMRMLNodes() << "\n";
+}
+
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::OnNodeReferenceAdded(vtkMRMLNodeReference *reference)
+{
+  vtkMRMLScene* scene = this->GetScene();
+  if (!scene)
+  {
+    return;
+  }
+  
+  vtkMRMLNode* node = scene->GetNodeByID(reference->GetReferencedNodeID());
+  if (!node)
+  {
+    return;
+  }
+  
+  if (strcmp(reference->GetReferenceRole(), this->GetIncomingNodeReferenceRole()) == 0)
+  {
+    // Add new NodeInfoType structure
+    igtlio::Connector::NodeInfoType nodeInfo;
+    //nodeInfo.node = node;
+    nodeInfo.lock = 0;
+    nodeInfo.second = 0;
+    nodeInfo.nanosecond = 0;
+    this->Internal->IncomingMRMLNodeInfoMap[node->GetID()] = nodeInfo;
+  }
+  else
+  {
+    // Find a converter for the node
+    igtlio::DevicePointer device = NULL;
+    vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->OutgoingMRMLIDToDeviceMap.find(node->GetID());
+    if (citer == this->Internal->OutgoingMRMLIDToDeviceMap.end())
+      {
+      igtlio::DeviceKeyType key;
+      key.name = node->GetName();
+      std::vector<std::string> deviceTypes = this->Internal->GetOutgoingDeviceTypes(node);
+      for (int typeIndex = 0; typeIndex < deviceTypes.size(); typeIndex++)
+        {
+        key.type = deviceTypes[typeIndex];
+        device = this->Internal->IOConnector->GetDevice(key);
+        if (device != NULL)
+          {
+          break;
+          }
+        }
+      if(device == NULL)
+        {
+        //If no device is found, add a device using the first device type, such as prefer "IMAGE" over "VIDEO".
+        device = this->Internal->CreateDevice(deviceTypes[0], key.name);
+        device->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
+        if (device)
+          {
+          this->Internal->OutgoingMRMLIDToDeviceMap[node->GetID()] = device;
+          this->Internal->IOConnector->AddDevice(device);
+          }
+        }
+      }
+    else
+      {
+      device = this->Internal->OutgoingMRMLIDToDeviceMap[node->GetID()];
+      }
+    if (!device)
+      {
+    // TODO: Remove the reference ID?
+    return;
+      }
+    device->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
+    unsigned int NodeModifiedEvent = this->Internal->AssignOutGoingNodeToDevice(node, device);
+    node->AddObserver(NodeModifiedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+        
+    // Need to update the events here because observed events are not saved in the scene
+    // for each reference and therefore only the role-default event observers are added.
+    // Get the correct list of events to observe from the converter and update the reference
+    // with that.
+    // Without doing this, outgoing transforms are not updated if connectors are set up from
+    // a saved scene.
+    int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
+    for (int i = 0; i < n; i ++)
+    {
+      const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+      if (strcmp(node->GetID(), id) == 0)
+      {
+        vtkIntArray* nodeEvents;
+        nodeEvents = vtkIntArray::New();
+        nodeEvents->InsertNextValue(NodeModifiedEvent);
+        this->SetAndObserveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i,
+                                              node->GetID(),nodeEvents );
+        nodeEvents->Delete();
+        break;
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::OnNodeReferenceRemoved(vtkMRMLNodeReference *reference)
+{
+  const char* nodeID = reference->GetReferencedNodeID();
+  if (!nodeID)
     {
-    case igtlio::Connector::ConnectedEvent: mrmlEvent = ConnectedEvent; break;
-    case igtlio::Connector::DisconnectedEvent: mrmlEvent = DisconnectedEvent; break;
-    case igtlio::Connector::ActivatedEvent: mrmlEvent = ActivatedEvent; break;
-    case igtlio::Connector::DeactivatedEvent: mrmlEvent = DeactivatedEvent; break;
-    case 118948: mrmlEvent = ReceiveEvent; break; // deprecated. it was for query response, OpenIGTLinkIO doesn't support query event. it is replaced with command message.
-    case igtlio::Connector::NewDeviceEvent: mrmlEvent = NewDeviceEvent; break;
-    case igtlio::Connector::DeviceContentModifiedEvent: mrmlEvent = DeviceModifiedEvent; break;
-    case igtlio::Connector::RemovedDeviceEvent: mrmlEvent = DeviceModifiedEvent; break;
-    case igtlio::Device::CommandReceivedEvent: mrmlEvent = CommandReceivedEvent; break;  // COMMAND device got a query, COMMAND received
-    case igtlio::Device::CommandResponseReceivedEvent: mrmlEvent = CommandResponseReceivedEvent; break;  // COMMAND device got a response, RTS_COMMAND received
+    return;
+    }
+  if (strcmp(reference->GetReferenceRole(), this->GetIncomingNodeReferenceRole()) == 0)
+    {
+    // Check if the node has already been reagistered.
+    // TODO: MRMLNodeListType can be reimplemented as a std::list
+    // so that the converter can be removed by 'remove()' method.
+    vtkInternal::NodeInfoMapType::iterator iter;
+    iter = this->Internal->IncomingMRMLNodeInfoMap.find(nodeID);
+    if (iter != this->Internal->IncomingMRMLNodeInfoMap.end())
+      {
+      this->Internal->IncomingMRMLNodeInfoMap.erase(iter);
+      }
+    vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->IncomingMRMLIDToDeviceMap.find(nodeID);
+    if (citer != this->Internal->IncomingMRMLIDToDeviceMap.end())
+      {
+      this->Internal->IncomingMRMLIDToDeviceMap.erase(citer);
+      }
+    else
+      {
+      vtkErrorMacro("Node is not found in IncomingMRMLIDToDeviceMap: "<<nodeID);
+      }
+    }
+  else
+    {
+    // Search converter from OutgoingMRMLIDToDeviceMap
+    vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->OutgoingMRMLIDToDeviceMap.find(nodeID);
+    if (citer != this->Internal->OutgoingMRMLIDToDeviceMap.end())
+      {
+      vtkSmartPointer<igtlio::Device> device = citer->second;
+      device->RemoveObserver(device->GetDeviceContentModifiedEvent());
+      this->Internal->IOConnector->RemoveDevice(device);
+      this->Internal->OutgoingMRMLIDToDeviceMap.erase(citer);
+      }
+    else
+      {
+      vtkErrorMacro("Node is not found in OutgoingMRMLIDToDeviceMap: "<<nodeID);
+      }
+    }
+}
+
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::OnNodeReferenceModified(vtkMRMLNodeReference *reference)
+{
+  vtkMRMLScene* scene = this->GetScene();
+  if (!scene)
+  {
+    return;
+  }
+  
+  vtkMRMLNode* node = scene->GetNodeByID(reference->GetReferencedNodeID());
+  if (!node)
+  {
+    return;
+  }
+  if (strcmp(reference->GetReferenceRole(), this->GetIncomingNodeReferenceRole()) == 0)
+  {
+  }
+  else
+  {
+  }
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::RegisterIncomingMRMLNode(vtkMRMLNode* node, IGTLDevicePointer device)
+{
+
+  if (!node)
+  {
+    return false;
+  }
+  igtlio::Device* igtlDevice = static_cast< igtlio::Device* >(device);
+  
+  // Check if the node has already been registered.
+  if (this->HasNodeReferenceID(this->GetIncomingNodeReferenceRole(), node->GetID()))
+  {
+    // the node has been already registered.
+    return false;
+  }
+  else
+  {
+    this->Internal->IncomingMRMLIDToDeviceMap[node->GetID()] = igtlDevice;
+    this->AddAndObserveNodeReferenceID(this->GetIncomingNodeReferenceRole(), node->GetID());
+    this->Modified();
+  }
+  
+  return &this->Internal->IncomingMRMLNodeInfoMap[node->GetID()];
+  
+}
+
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::UnregisterIncomingMRMLNode(vtkMRMLNode* node)
+{
+  
+  if (!node)
+  {
+    return;
+  }
+  
+  // Check if the node is on the reference list for outgoing nodes
+  int n = this->GetNumberOfNodeReferences(this->GetIncomingNodeReferenceRole());
+  for (int i = 0; i < n; i ++)
+  {
+    const char* id = this->GetNthNodeReferenceID(this->GetIncomingNodeReferenceRole(), i);
+    if (strcmp(node->GetID(), id) == 0)
+    {
+      // Alredy on the list. Remove it.
+      this->RemoveNthNodeReferenceID(this->GetIncomingNodeReferenceRole(), i);
+      vtkInternal::NodeInfoMapType::iterator iter;
+      iter = this->Internal->IncomingMRMLNodeInfoMap.find(id);
+      if (iter != this->Internal->IncomingMRMLNodeInfoMap.end())
+      {
+        this->Internal->IncomingMRMLNodeInfoMap.erase(iter);
+      }
+      vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->IncomingMRMLIDToDeviceMap.find(node->GetID());
+      if (citer != this->Internal->IncomingMRMLIDToDeviceMap.end())
+        {
+        this->Internal->IncomingMRMLIDToDeviceMap.erase(citer);
+        }
+      else
+        {
+        vtkErrorMacro("Node is not found in IncomingMRMLIDToDeviceMap: "<<node->GetID());
+        }
+      this->Modified();
+      break;
+    }
+  }
+  
+}
+
+//---------------------------------------------------------------------------
+unsigned int vtkMRMLIGTLConnectorNode::GetNumberOfOutgoingMRMLNodes()
+{
+  //return this->OutgoingMRMLNodeList.size();
+  return this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
+}
+
+
+//---------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLIGTLConnectorNode::GetOutgoingMRMLNode(unsigned int i)
+{
+  if (i < (unsigned int)this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole()))
+    {
+    vtkMRMLScene* scene = this->GetScene();
+    if (!scene)
+      return NULL;
+    vtkMRMLNode* node = scene->GetNodeByID(this->GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i));
+    return node;
+    }
+  else 
+    {
+    return NULL;
+    }
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::RegisterOutgoingMRMLNode(vtkMRMLNode* node, const char* devType)
+{
+  
+  if (!node)
+    {
+    return 0;
+    }
+  
+  // An explicitly requested device type replaces the previous one
+  if (devType != NULL || node->GetAttribute(OutgoingDeviceTypeAttributeName) == NULL)
+    {
+    node->SetAttribute(OutgoingDeviceTypeAttributeName, devType);
+    }
+  if (node->GetAttribute("OpenIGTLinkIF.out.name") == NULL)
+    {
+    node->SetAttribute("OpenIGTLinkIF.out.name", node->GetName());
+    }
+  
+  
+  
+  // Check if the node is on the reference list for outgoing nodes
+  int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
+  for (int i = 0; i < n; i ++)
+    {
+    const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+    if (strcmp(node->GetID(), id) == 0)
+      {
+      // Alredy on the list. Remove it.
+      this->RemoveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+      break;
+      }
     }
-  if( modifiedDevice != NULL)
+  
+  if (this->AddAndObserveNodeReferenceID(this->GetOutgoingNodeReferenceRole(), node->GetID()))
     {
-    if(event==this->Internal->IOConnector->NewDeviceEvent)
+    igtlio::DevicePointer device = NULL;
+    igtlio::DeviceKeyType key;
+    key.name = node->GetName();
+    std::vector<std::string> deviceTypes = this->Internal->GetOutgoingDeviceTypes(node);
+    for (int typeIndex = 0; typeIndex < deviceTypes.size(); typeIndex++)
       {
-      // no action perform at this stage, wait until the message content in the device is unpacked,
-      // As we need the message content data to create mrmlnode.
-      // Also the newly added device could also be a outgoing message from IF module
-      //this->ProcessNewDeviceEvent(caller, event, callData );
-      //modifiedDevice->AddObserver(modifiedDevice->GetDeviceContentModifiedEvent(),  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-      if (modifiedDevice->MessageDirectionIsIn())
+      key.type = deviceTypes[typeIndex];
+      device = this->Internal->IOConnector->GetDevice(key);
+      if (device != NULL)
         {
-        modifiedDevice->AddObserver(modifiedDevice->GetDeviceContentModifiedEvent(),  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-        if (modifiedDevice->GetDeviceType().compare(igtlio::CommandConverter::GetIGTLTypeName()) == 0)
-          {
-          modifiedDevice->AddObserver(modifiedDevice->CommandReceivedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-          modifiedDevice->AddObserver(modifiedDevice->CommandResponseReceivedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-          }
+        break;
         }
       }
-    if(event==modifiedDevice->GetDeviceContentModifiedEvent())
+    /*--------
+    // device should be added in the OnNodeReferenceAdded function already,
+    // delete the following lines in the future
+    this->OutgoingMRMLIDToDeviceMap[node->GetName()] = device;
+    if (!device)
       {
-      if (modifiedDevice->MessageDirectionIsIn())
-        {
-        this->Internal->ProcessIncomingDeviceModifiedEvent(caller, event, modifiedDevice);
-        }
-      else if (modifiedDevice->MessageDirectionIsOut())
-        {
-        this->Internal->ProcessOutgoingDeviceModifiedEvent(caller, event, modifiedDevice);
-        }
+      device = this->Internal->IOConnector->GetDeviceFactory()->create(key.type, key.name);
+      device->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
+      this->Internal->IOConnector->AddDevice(device);
       }
-    if(event==modifiedDevice->CommandReceivedEvent || event==modifiedDevice->CommandResponseReceivedEvent)
+    */
+    
+    this->Modified();
+    
+    return 1;
+    }
+  else // If the reference node wasn't associated with any device, delete the reference
+    {
+    int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
+    for (int i = 0; i < n; i ++)
+    {
+      const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+      if (strcmp(node->GetID(), id) == 0)
       {
-      this->InvokeEvent(mrmlEvent, modifiedDevice);
-      return;
+        // Alredy on the list. Remove it.
+        this->RemoveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+        break;
       }
     }
-  //propagate the event to the connector property and treeview widgets
-  this->InvokeEvent(mrmlEvent);
+    return 0;
+    }
+  
 }
 
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::WriteXML(ostream& of, int nIndent)
-{
-
-  // Start by having the superclass write its information
-  Superclass::WriteXML(of, nIndent);
 
-  switch (this->Internal->IOConnector->GetType())
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::UnregisterOutgoingMRMLNode(vtkMRMLNode* node)
+{
+  if (!node)
+  {
+    return;
+  }
+  
+  // Check if the node is on the reference list for outgoing nodes
+  int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
+  for (int i = 0; i < n; i ++)
+  {
+    const char* id = this->GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+    if (strcmp(node->GetID(), id) == 0)
     {
-      case igtlio::Connector::TYPE_SERVER:
-      of << " connectorType=\"" << "SERVER" << "\" ";
-      break;
-    case igtlio::Connector::TYPE_CLIENT:
-      of << " connectorType=\"" << "CLIENT" << "\" ";
-      of << " serverHostname=\"" << this->Internal->IOConnector->GetServerHostname() << "\" ";
-      break;
-    default:
-      of << " connectorType=\"" << "NOT_DEFINED" << "\" ";
+      // Alredy on the list. Remove it.
+      this->RemoveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
+      this->Modified();
       break;
     }
+  }
+  
+}
 
-  of << " serverPort=\"" << this->Internal->IOConnector->GetServerPort() << "\" ";
-  of << " persistent=\"" << this->Internal->IOConnector->GetPersistent() << "\" ";
-  of << " state=\"" << this->Internal->IOConnector->GetState() <<"\"";
-  of << " restrictDeviceName=\"" << this->Internal->IOConnector->GetRestrictDeviceName() << "\" ";
-
+//---------------------------------------------------------------------------
+unsigned int vtkMRMLIGTLConnectorNode::GetNumberOfIncomingMRMLNodes()
+{
+  //return this->IncomingMRMLNodeInfoMap.size();
+  return this->GetNumberOfNodeReferences(this->GetIncomingNodeReferenceRole());
 }
 
 
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::ReadXMLAttributes(const char** atts)
+//---------------------------------------------------------------------------
+vtkMRMLNode* vtkMRMLIGTLConnectorNode::GetIncomingMRMLNode(unsigned int i)
 {
-  vtkMRMLNode::ReadXMLAttributes(atts);
-
-  const char* attName;
-  const char* attValue;
+  if (i < (unsigned int)this->GetNumberOfNodeReferences(this->GetIncomingNodeReferenceRole()))
+    {
+    vtkMRMLScene* scene = this->GetScene();
+    if (!scene)
+      return NULL;
+    vtkMRMLNode* node = scene->GetNodeByID(this->GetNthNodeReferenceID(this->GetIncomingNodeReferenceRole(), i));
+    return node;
+    }
+  else 
+    {
+    return NULL;
+    }
+}
 
-  const char* serverHostname = "";
-  int port = 0;
-  int type = -1;
-  int restrictDeviceName = 0;
-  int state = igtlio::Connector::STATE_OFF;
-  int persistent = igtlio::Connector::PERSISTENT_OFF;
 
-  while (*atts != NULL)
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::PushNode(vtkMRMLNode* node)
+{
+  if (!node)
     {
-    attName = *(atts++);
-    attValue = *(atts++);
+    return 0;
+    }
+  
+  if (!(node->GetID()))
+  {
+    return 0;
+  }
+  
+  
+  vtkInternal::MessageDeviceMapType::iterator iter = this->Internal->OutgoingMRMLIDToDeviceMap.find(node->GetID());
+  if (iter == this->Internal->OutgoingMRMLIDToDeviceMap.end())
+    {
+    vtkErrorMacro("Node is not found in OutgoingMRMLIDToDeviceMap: "<<node->GetID());
+    return 0;
+    }
 
-    if (!strcmp(attName, "connectorType"))
+  vtkSmartPointer<igtlio::Device> device = iter->second;
+  igtlio::DeviceKeyType key;
+  key.name = device->GetDeviceName();
+  key.type = device->GetDeviceType();
+  device->ClearMetaData();
+  device->SetMetaDataElement(MEMLNodeNameKey, IANA_TYPE_US_ASCII, node->GetNodeTagName());
+  device->RemoveObservers(device->GetDeviceContentModifiedEvent());
+  this->Internal->AssignOutGoingNodeToDevice(node, device); // update the device content
+  device->AddObserver(device->GetDeviceContentModifiedEvent(),  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
+  
+  if((strcmp(node->GetClassName(),"vtkMRMLIGTLQueryNode")!=0))
+    {
+    if (!this->Internal->IsPeerTypeSupported(key.type))
       {
-      if (!strcmp(attValue, "SERVER"))
-        {
-        type = igtlio::Connector::TYPE_SERVER;
-        }
-      else if (!strcmp(attValue, "CLIENT"))
-        {
-        type = igtlio::Connector::TYPE_CLIENT;
-        }
-      else
-        {
-        type = igtlio::Connector::TYPE_NOT_DEFINED;
-        }
+      // The peer would discard the message
+      this->Internal->SuppressedMessagesMutex->Lock();
+      this->Internal->NumberOfSuppressedMessages++;
+      this->Internal->SuppressedMessagesMutex->Unlock();
+      return 0;
       }
-    if (!strcmp(attName, "serverHostname"))
+    this->Internal->IOConnector->SendMessage(key); //
+    }
+  else if(strcmp(node->GetClassName(),"vtkMRMLIGTLQueryNode")==0)
+    {
+    this->Internal->IOConnector->SendMessage(key, device->MESSAGE_PREFIX_RTS);
+    }
+  return 0;
+}
+
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::PushQuery(vtkMRMLIGTLQueryNode* node)
+{
+  if (node==NULL)
+    {
+    vtkErrorMacro("vtkMRMLIGTLConnectorNode::PushQuery failed: invalid input node");
+    return;
+    }
+  igtlio::DeviceKeyType key;
+  key.name = node->GetIGTLDeviceName();
+  key.type = node->GetIGTLName();
+  igtlio::Device::MESSAGE_PREFIX prefix = igtlio::Device::MESSAGE_PREFIX_RTS;
+  if (node->GetQueryType() == vtkMRMLIGTLQueryNode::TYPE_GET)
+    {
+    prefix = igtlio::Device::MESSAGE_PREFIX_GET;
+    }
+
+  vtkMRMLIGTLTrackingDataQueryNode* trackingDataQueryNode = vtkMRMLIGTLTrackingDataQueryNode::SafeDownCast(node);
+  if (trackingDataQueryNode)
+    {
+    // The tracking data stream is started and stopped with STT_TDATA and STP_TDATA (or their QTDATA counterparts).
+    // The same device receives the tracking data messages, so it is created as an incoming device.
+    if (key.name.empty())
       {
-      serverHostname = attValue;
+      vtkErrorMacro("vtkMRMLIGTLConnectorNode::PushQuery failed: tracking data query requires a device name");
+      return;
       }
-    if (!strcmp(attName, "serverPort"))
+    if (trackingDataQueryNode->GetQueryType() == vtkMRMLIGTLQueryNode::TYPE_START)
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> port;
+      prefix = igtlio::Device::MESSAGE_PREFIX_START;
       }
-    if (!strcmp(attName, "restrictDeviceName"))
+    else if (trackingDataQueryNode->GetQueryType() == vtkMRMLIGTLQueryNode::TYPE_STOP)
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> restrictDeviceName;;
+      prefix = igtlio::Device::MESSAGE_PREFIX_STOP;
       }
-    if (!strcmp(attName, "persistent"))
+    else
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> persistent;
+      vtkErrorMacro("vtkMRMLIGTLConnectorNode::PushQuery failed: tracking data query type must be START or STOP");
+      return;
       }
-    if (!strcmp(attName, "state"))
+    vtkIGTLTrackingDataDevice* trackingDataDevice = vtkIGTLTrackingDataDevice::SafeDownCast(
+      static_cast<igtlio::Device*>(this->CreateDeviceForIncomingMessage(key.type.c_str(), key.name.c_str())));
+    if (trackingDataDevice == NULL)
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> state;
+      vtkErrorMacro("vtkMRMLIGTLConnectorNode::PushQuery failed: cannot create tracking data device " << key.name);
+      return;
       }
-    /*if (!strcmp(attName, "logErrorIfServerConnectionFailed"))
+    trackingDataDevice->SetResolution(trackingDataQueryNode->GetResolution());
+    trackingDataDevice->SetCoordinateName(trackingDataQueryNode->GetCoordinateName());
+    }
+  else if(this->Internal->IOConnector->GetDevice(key)==NULL)
+    {
+    // The response is received by the same device. Types unknown to the OpenIGTLinkIO
+    // device factory (such as IMGMETA) are created here.
+    if (this->CreateDeviceForIncomingMessage(key.type.c_str(), key.name.c_str()) == NULL)
       {
-      std::stringstream ss;
-      ss << attValue;
-      ss >> LogErrorIfServerConnectionFailed;
+      vtkErrorMacro("vtkMRMLIGTLConnectorNode::PushQuery failed: Device type not supported");
+      return;
       }
-    }*/
+    }
+  this->Internal->IOConnector->SendMessage(key, prefix);
+  this->QueryQueueMutex->Lock();
+  node->SetTimeStamp(vtkTimerLog::GetUniversalTime());
+  node->SetQueryStatus(vtkMRMLIGTLQueryNode::STATUS_WAITING);
+  node->SetConnectorNodeID(this->GetID());
+  this->Internal->QueryManager->AddQuery(node);
+  this->QueryQueueMutex->Unlock();
+}
 
-  switch(type)
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::CancelQuery(vtkMRMLIGTLQueryNode* node)
+{
+  if (node==NULL)
     {
-    case igtlio::Connector::TYPE_SERVER:
-      this->Internal->IOConnector->SetTypeServer(port);
-      this->Internal->IOConnector->SetRestrictDeviceName(restrictDeviceName);
-      break;
-    case igtlio::Connector::TYPE_CLIENT:
-      this->Internal->IOConnector->SetTypeClient(serverHostname, port);
-      this->Internal->IOConnector->SetRestrictDeviceName(restrictDeviceName);
-      break;
-    default: // not defined
-      // do nothing
-      break;
+    vtkErrorMacro("vtkMRMLIGTLConnectorNode::CancelQuery failed: invalid input node");
+    return;
     }
+  this->QueryQueueMutex->Lock();
+  this->Internal->QueryManager->RemoveQuery(node);
+  node->SetConnectorNodeID("");
+  this->QueryQueueMutex->Unlock();
+}
 
-  if (persistent == igtlio::Connector::PERSISTENT_ON)
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetNumberOfWaitingQueries()
+{
+  this->QueryQueueMutex->Lock();
+  int numberOfQueries = this->Internal->QueryManager->GetNumberOfQueries();
+  this->QueryQueueMutex->Unlock();
+  return numberOfQueries;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::Subscribe(const char* deviceType, const char* deviceName, int resolution,
+                                         const char* coordinateName)
+{
+  if (deviceType == NULL || deviceName == NULL || deviceType[0] == '\0' || deviceName[0] == '\0')
     {
-    this->Internal->IOConnector->SetPersistent(igtlio::Connector::PERSISTENT_ON);
-    // At this point not all the nodes are loaded so we cannot start
-    // the processing thread (if we activate the connection then it may immediately
-    // start receiving messages, create corresponding MRML nodes, while the same
-    // MRML nodes are being loaded from the scene; this would result in duplicate
-    // MRML nodes).
-    // All the nodes will be activated by the module logic when the scene import is finished.
-    this->Internal->IOConnector->SetState(state);
-    this->Modified();
+    vtkErrorMacro("vtkMRMLIGTLConnectorNode::Subscribe failed: device type and name are required");
+    return false;
     }
-  }
+  if (!IsTrackingDataDeviceType(deviceType))
+    {
+    // Only the tracking data devices build STT_ and STP_ messages and answer them
+    vtkErrorMacro("vtkMRMLIGTLConnectorNode::Subscribe failed: streaming is only supported for "
+                  << vtkIGTLTrackingDataDevice::GetIGTLTypeName() << " and "
+                  << vtkIGTLQuaternionTrackingDataDevice::GetIGTLTypeName() << ", not " << deviceType);
+    return false;
+    }
+  this->Internal->SubscriptionMutex->Lock();
+  this->Internal->SubscriptionManager->AddSubscription(deviceType, deviceName, resolution > 0 ? resolution : 0,
+                                                       coordinateName ? coordinateName : "");
+  this->Internal->SubscriptionMutex->Unlock();
+  return true;
 }
 
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::Unsubscribe(const char* deviceType, const char* deviceName)
+{
+  if (deviceType == NULL || deviceName == NULL)
+    {
+    return;
+    }
+  this->Internal->SubscriptionMutex->Lock();
+  this->Internal->SubscriptionManager->RemoveSubscription(deviceType, deviceName);
+  this->Internal->SubscriptionMutex->Unlock();
+}
 
-//----------------------------------------------------------------------------
-// Copy the node's attributes to this object.
-// Does NOT copy: ID, FilePrefix, Name, VolumeID
-void vtkMRMLIGTLConnectorNode::Copy(vtkMRMLNode *anode)
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::IsSubscribed(const char* deviceType, const char* deviceName)
 {
-  Superclass::Copy(anode);
-  vtkMRMLIGTLConnectorNode *node = (vtkMRMLIGTLConnectorNode *) anode;
+  return this->GetSubscriptionStatus(deviceType, deviceName) >= 0;
+}
 
-  int type = node->Internal->IOConnector->GetType();
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetNumberOfSubscriptions()
+{
+  this->Internal->SubscriptionMutex->Lock();
+  int numberOfSubscriptions = this->Internal->SubscriptionManager->GetNumberOfSubscriptions();
+  this->Internal->SubscriptionMutex->Unlock();
+  return numberOfSubscriptions;
+}
 
-  switch(type)
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetSubscriptionStatus(const char* deviceType, const char* deviceName)
+{
+  if (deviceType == NULL || deviceName == NULL)
     {
-      case igtlio::Connector::TYPE_SERVER:
-      this->Internal->IOConnector->SetType(igtlio::Connector::TYPE_SERVER);
-      this->Internal->IOConnector->SetTypeServer(node->Internal->IOConnector->GetServerPort());
-      this->Internal->IOConnector->SetRestrictDeviceName(node->Internal->IOConnector->GetRestrictDeviceName());
-      break;
-    case igtlio::Connector::TYPE_CLIENT:
-      this->Internal->IOConnector->SetType(igtlio::Connector::TYPE_CLIENT);
-      this->Internal->IOConnector->SetTypeClient(node->Internal->IOConnector->GetServerHostname(), node->Internal->IOConnector->GetServerPort());
-      this->Internal->IOConnector->SetRestrictDeviceName(node->Internal->IOConnector->GetRestrictDeviceName());
-      break;
-    default: // not defined
-      // do nothing
-        this->Internal->IOConnector->SetType(igtlio::Connector::TYPE_NOT_DEFINED);
-      break;
+    return -1;
     }
-  this->Internal->IOConnector->SetState(node->Internal->IOConnector->GetState());
-  this->Internal->IOConnector->SetPersistent(node->Internal->IOConnector->GetPersistent());
+  this->Internal->SubscriptionMutex->Lock();
+  int status = this->Internal->SubscriptionManager->GetSubscriptionStatus(deviceType, deviceName);
+  this->Internal->SubscriptionMutex->Unlock();
+  return status;
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::IsRemotelySubscribed(const char* deviceType, const char* deviceName)
+{
+  if (deviceType == NULL || deviceName == NULL)
+    {
+    return false;
+    }
+  this->Internal->SubscriptionMutex->Lock();
+  bool subscribed = this->Internal->SubscriptionManager->HasRemoteSubscription(deviceType, deviceName);
+  this->Internal->SubscriptionMutex->Unlock();
+  return subscribed;
+}
 
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::PrintSelf(ostream& os, vtkIndent indent)
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetNumberOfRemoteSubscriptions()
 {
-  Superclass::PrintSelf(os,indent);
+  this->Internal->SubscriptionMutex->Lock();
+  int numberOfSubscriptions = this->Internal->SubscriptionManager->GetNumberOfRemoteSubscriptions();
+  this->Internal->SubscriptionMutex->Unlock();
+  return numberOfSubscriptions;
+}
 
-  if (this->Internal->IOConnector->GetType() == igtlio::Connector::TYPE_SERVER)
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::SetServeSceneImages(bool serve)
+{
+  if (this->Internal->ServeSceneImages == serve)
     {
-    os << indent << "Connector Type : SERVER\n";
-    os << indent << "Listening Port #: " << this->Internal->IOConnector->GetServerPort() << "\n";
+    return;
     }
-  else if (this->Internal->IOConnector->GetType() == igtlio::Connector::TYPE_CLIENT)
+  this->Internal->ServeSceneImages = serve;
+  if (serve)
     {
-    os << indent << "Connector Type: CLIENT\n";
-    os << indent << "Server Hostname: " << this->Internal->IOConnector->GetServerHostname() << "\n";
-    os << indent << "Server Port #: " << this->Internal->IOConnector->GetServerPort() << "\n";
+    this->Internal->AddServedImageMetaDevices();
+    this->Internal->SceneImageIndex->SetScene(this->GetScene());
     }
-
-  switch (this->Internal->IOConnector->GetState())
+  else
     {
-    case igtlio::Connector::STATE_OFF:
-      os << indent << "State: OFF\n";
-      break;
-    case igtlio::Connector::STATE_WAIT_CONNECTION:
-      os << indent << "State: WAIT FOR CONNECTION\n";
-      break;
-    case igtlio::Connector::STATE_CONNECTED:
-      os << indent << "State: CONNECTED\n";
-      break;
+    // Stop following the scene
+    this->Internal->SceneImageIndex->SetScene(NULL);
     }
-  os << indent << "Persistent: " << this->Internal->IOConnector->GetPersistent() << "\n";
-  os << indent << "Restrict Device Name: " << this->Internal->IOConnector->GetRestrictDeviceName() << "\n";
-  os << indent << "Push Outgoing Message Flag: " << this->Internal->IOConnector->GetPushOutgoingMessageFlag() << "\n";
-  os << indent << "Check CRC: " << this->Internal->IOConnector->GetCheckCRC()<< "\n";
-  os << indent << "Number of outgoing nodes: " << this->GetNumberOfOutgoingMRMLNodes() << "\n";
-  os << indent << "Number of incoming nodes: " << this->GetNumberOfIncomingMRMLNodes() << "\n";
+  this->Modified();
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::GetServeSceneImages()
+{
+  return this->Internal->ServeSceneImages;
+}
 
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::OnNodeReferenceAdded(vtkMRMLNodeReference *reference)
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::SetServedImageMetaDeviceName(const char* name)
 {
-  vtkMRMLScene* scene = this->GetScene();
-  if (!scene)
-  {
-    return;
-  }
-  
-  vtkMRMLNode* node = scene->GetNodeByID(reference->GetReferencedNodeID());
-  if (!node)
-  {
+  std::string deviceName = name ? name : "";
+  if (this->Internal->ServedImageMetaDeviceName == deviceName)
+    {
     return;
-  }
-  
-  if (strcmp(reference->GetReferenceRole(), this->GetIncomingNodeReferenceRole()) == 0)
-  {
-    // Add new NodeInfoType structure
-    igtlio::Connector::NodeInfoType nodeInfo;
-    //nodeInfo.node = node;
-    nodeInfo.lock = 0;
-    nodeInfo.second = 0;
-    nodeInfo.nanosecond = 0;
-    this->Internal->IncomingMRMLNodeInfoMap[node->GetID()] = nodeInfo;
-  }
-  else
-  {
-    // Find a converter for the node
-    igtlio::DevicePointer device = NULL;
-    vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->OutgoingMRMLIDToDeviceMap.find(node->GetID());
-    if (citer == this->Internal->OutgoingMRMLIDToDeviceMap.end())
-      {
-      igtlio::DeviceKeyType key;
-      key.name = node->GetName();
-      std::vector<std::string> deviceTypes = GetDeviceTypeFromMRMLNodeType(node->GetNodeTagName());
-      for (int typeIndex = 0; typeIndex < deviceTypes.size(); typeIndex++)
-        {
-        key.type = deviceTypes[typeIndex];
-        device = this->Internal->IOConnector->GetDevice(key);
-        if (device != NULL)
-          {
-          break;
-          }
-        }
-      if(device == NULL)
-        {
-        //If no device is found, add a device using the first device type, such as prefer "IMAGE" over "VIDEO".
-        device = this->Internal->IOConnector->GetDeviceFactory()->create(deviceTypes[0], key.name);
-        device->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
-        if (device)
-          {
-          this->Internal->OutgoingMRMLIDToDeviceMap[node->GetID()] = device;
-          this->Internal->IOConnector->AddDevice(device);
-          }
-        }
-      }
-    else
-      {
-      device = this->Internal->OutgoingMRMLIDToDeviceMap[node->GetID()];
-      }
-    if (!device)
-      {
-    // TODO: Remove the reference ID?
+    }
+  this->Internal->ServedImageMetaDeviceName = deviceName;
+  if (this->Internal->ServeSceneImages)
+    {
+    this->Internal->AddServedImageMetaDevices();
+    }
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+const char* vtkMRMLIGTLConnectorNode::GetServedImageMetaDeviceName()
+{
+  return this->Internal->ServedImageMetaDeviceName.c_str();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::SetCapabilityNegotiation(bool negotiate)
+{
+  if (this->Internal->CapabilityNegotiation == negotiate)
+    {
     return;
-      }
-    device->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
-    unsigned int NodeModifiedEvent = this->Internal->AssignOutGoingNodeToDevice(node, device);
-    node->AddObserver(NodeModifiedEvent,  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-        
-    // Need to update the events here because observed events are not saved in the scene
-    // for each reference and therefore only the role-default event observers are added.
-    // Get the correct list of events to observe from the converter and update the reference
-    // with that.
-    // Without doing this, outgoing transforms are not updated if connectors are set up from
-    // a saved scene.
-    int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
-    for (int i = 0; i < n; i ++)
+    }
+  this->Internal->CapabilityNegotiation = negotiate;
+  if (negotiate)
     {
-      const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-      if (strcmp(node->GetID(), id) == 0)
+    this->RequestPeerCapability();
+    }
+  else if (this->Internal->ClearPeerCapability())
+    {
+    this->InvokeEvent(PeerCapabilityModifiedEvent);
+    }
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::GetCapabilityNegotiation()
+{
+  return this->Internal->CapabilityNegotiation;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::RequestPeerCapability()
+{
+  if (!this->Internal->CapabilityNegotiation
+    || this->Internal->IOConnector->GetState() != igtlio::Connector::STATE_CONNECTED)
+    {
+    return false;
+    }
+  return this->Internal->IOConnector->SendMessage(CreateDeviceKey(this->Internal->CapabilityDevice.GetPointer()), igtlio::Device::MESSAGE_PREFIX_GET) != 0;
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::IsPeerCapabilityKnown()
+{
+  return this->Internal->PeerCapabilityKnown;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetNumberOfPeerSupportedTypes()
+{
+  return static_cast<int>(this->Internal->PeerSupportedTypes.size());
+}
+
+//---------------------------------------------------------------------------
+const char* vtkMRMLIGTLConnectorNode::GetPeerSupportedType(int index)
+{
+  if (index < 0 || index >= static_cast<int>(this->Internal->PeerSupportedTypes.size()))
+    {
+    return NULL;
+    }
+  return this->Internal->PeerSupportedTypes[index].c_str();
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::IsPeerTypeSupported(const char* deviceType)
+{
+  return deviceType != NULL && this->Internal->IsPeerTypeSupported(deviceType);
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetNumberOfSuppressedMessages()
+{
+  this->Internal->SuppressedMessagesMutex->Lock();
+  int numberOfSuppressedMessages = this->Internal->NumberOfSuppressedMessages;
+  this->Internal->SuppressedMessagesMutex->Unlock();
+  return numberOfSuppressedMessages;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::LockIncomingMRMLNode(vtkMRMLNode* node)
+{
+  vtkInternal::NodeInfoMapType::iterator iter;
+  for (iter = this->Internal->IncomingMRMLNodeInfoMap.begin(); iter != this->Internal->IncomingMRMLNodeInfoMap.end(); iter++)
+    {
+    //if ((iter->second).node == node)
+    if (iter->first.compare(node->GetID()) == 0)
       {
-        vtkIntArray* nodeEvents;
-        nodeEvents = vtkIntArray::New();
-        nodeEvents->InsertNextValue(NodeModifiedEvent);
-        this->SetAndObserveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i,
-                                              node->GetID(),nodeEvents );
-        nodeEvents->Delete();
-        break;
+      (iter->second).lock = 1;
       }
     }
-  }
 }
 
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::OnNodeReferenceRemoved(vtkMRMLNodeReference *reference)
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::UnlockIncomingMRMLNode(vtkMRMLNode* node)
 {
-  const char* nodeID = reference->GetReferencedNodeID();
-  if (!nodeID)
-    {
-    return;
-    }
-  if (strcmp(reference->GetReferenceRole(), this->GetIncomingNodeReferenceRole()) == 0)
+  // Check if the node has already been added in the locked node list
+  vtkInternal::NodeInfoMapType::iterator iter;
+  for (iter = this->Internal->IncomingMRMLNodeInfoMap.begin(); iter != this->Internal->IncomingMRMLNodeInfoMap.end(); iter++)
     {
-    // Check if the node has already been reagistered.
-    // TODO: MRMLNodeListType can be reimplemented as a std::list
-    // so that the converter can be removed by 'remove()' method.
-    vtkInternal::NodeInfoMapType::iterator iter;
-    iter = this->Internal->IncomingMRMLNodeInfoMap.find(nodeID);
-    if (iter != this->Internal->IncomingMRMLNodeInfoMap.end())
-      {
-      this->Internal->IncomingMRMLNodeInfoMap.erase(iter);
-      }
-    vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->IncomingMRMLIDToDeviceMap.find(nodeID);
-    if (citer != this->Internal->IncomingMRMLIDToDeviceMap.end())
-      {
-      this->Internal->IncomingMRMLIDToDeviceMap.erase(citer);
-      }
-    else
+    //if ((iter->second).node == node)
+    if (iter->first.compare(node->GetID()) == 0)
       {
-      vtkErrorMacro("Node is not found in IncomingMRMLIDToDeviceMap: "<<nodeID);
+      (iter->second).lock = 0;
+      return;
       }
     }
-  else
+}
+
+
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetIGTLTimeStamp(vtkMRMLNode* node, int& second, int& nanosecond)
+{
+  // Check if the node has already been added in the locked node list
+  vtkInternal::NodeInfoMapType::iterator iter;
+  for (iter = this->Internal->IncomingMRMLNodeInfoMap.begin(); iter != this->Internal->IncomingMRMLNodeInfoMap.end(); iter++)
     {
-    // Search converter from OutgoingMRMLIDToDeviceMap
-    vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->OutgoingMRMLIDToDeviceMap.find(nodeID);
-    if (citer != this->Internal->OutgoingMRMLIDToDeviceMap.end())
-      {
-      vtkSmartPointer<igtlio::Device> device = citer->second;
-      device->RemoveObserver(device->GetDeviceContentModifiedEvent());
-      this->Internal->IOConnector->RemoveDevice(device);
-      this->Internal->OutgoingMRMLIDToDeviceMap.erase(citer);
-      }
-    else
+    //if ((iter->second).node == node)
+    if (iter->first.compare(node->GetID()) == 0)
       {
-      vtkErrorMacro("Node is not found in OutgoingMRMLIDToDeviceMap: "<<nodeID);
+      second = (iter->second).second;
+      nanosecond = (iter->second).nanosecond;
+      return 1;
       }
     }
+  return 0;
+  
 }
 
-
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::OnNodeReferenceModified(vtkMRMLNodeReference *reference)
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::SetPoseHistoryCapacity(int capacity)
 {
-  vtkMRMLScene* scene = this->GetScene();
-  if (!scene)
-  {
-    return;
-  }
-  
-  vtkMRMLNode* node = scene->GetNodeByID(reference->GetReferencedNodeID());
-  if (!node)
-  {
+  if (capacity < 0)
+    {
+    capacity = 0;
+    }
+  if (capacity == this->Internal->PoseHistoryCapacity)
+    {
     return;
-  }
-  if (strcmp(reference->GetReferenceRole(), this->GetIncomingNodeReferenceRole()) == 0)
-  {
-  }
-  else
-  {
-  }
+    }
+  this->Internal->PoseHistoryCapacity = capacity;
+  this->Internal->PoseHistories.clear();
+  this->Modified();
 }
 
 //---------------------------------------------------------------------------
-bool vtkMRMLIGTLConnectorNode::RegisterIncomingMRMLNode(vtkMRMLNode* node, IGTLDevicePointer device)
+int vtkMRMLIGTLConnectorNode::GetPoseHistoryCapacity()
 {
-
-  if (!node)
-  {
-    return false;
-  }
-  igtlio::Device* igtlDevice = static_cast< igtlio::Device* >(device);
-  
-  // Check if the node has already been registered.
-  if (this->HasNodeReferenceID(this->GetIncomingNodeReferenceRole(), node->GetID()))
-  {
-    // the node has been already registered.
-    return false;
-  }
-  else
-  {
-    this->Internal->IncomingMRMLIDToDeviceMap[node->GetID()] = igtlDevice;
-    this->AddAndObserveNodeReferenceID(this->GetIncomingNodeReferenceRole(), node->GetID());
-    this->Modified();
-  }
-  
-  return &this->Internal->IncomingMRMLNodeInfoMap[node->GetID()];
-  
+  return this->Internal->PoseHistoryCapacity;
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::GetTransformAtTime(const char* deviceName, double timestamp, vtkMatrix4x4* matrix)
+{
+  return this->GetTransformAtTime(this->GetPoseHistoryDeviceType(deviceName), deviceName, timestamp, matrix);
+}
 
 //---------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::UnregisterIncomingMRMLNode(vtkMRMLNode* node)
+bool vtkMRMLIGTLConnectorNode::GetTransformAtTime(const char* deviceType, const char* deviceName, double timestamp,
+                                                  vtkMatrix4x4* matrix)
 {
-  
-  if (!node)
-  {
-    return;
-  }
-  
-  // Check if the node is on the reference list for outgoing nodes
-  int n = this->GetNumberOfNodeReferences(this->GetIncomingNodeReferenceRole());
-  for (int i = 0; i < n; i ++)
-  {
-    const char* id = this->GetNthNodeReferenceID(this->GetIncomingNodeReferenceRole(), i);
-    if (strcmp(node->GetID(), id) == 0)
+  if (deviceType == NULL || deviceName == NULL)
     {
-      // Alredy on the list. Remove it.
-      this->RemoveNthNodeReferenceID(this->GetIncomingNodeReferenceRole(), i);
-      vtkInternal::NodeInfoMapType::iterator iter;
-      iter = this->Internal->IncomingMRMLNodeInfoMap.find(id);
-      if (iter != this->Internal->IncomingMRMLNodeInfoMap.end())
-      {
-        this->Internal->IncomingMRMLNodeInfoMap.erase(iter);
-      }
-      vtkInternal::MessageDeviceMapType::iterator citer = this->Internal->IncomingMRMLIDToDeviceMap.find(node->GetID());
-      if (citer != this->Internal->IncomingMRMLIDToDeviceMap.end())
-        {
-        this->Internal->IncomingMRMLIDToDeviceMap.erase(citer);
-        }
-      else
-        {
-        vtkErrorMacro("Node is not found in IncomingMRMLIDToDeviceMap: "<<node->GetID());
-        }
-      this->Modified();
-      break;
+    return false;
     }
-  }
-  
+  vtkInternal::PoseHistoryType* history = this->Internal->FindPoseHistory(deviceType, deviceName);
+  if (history == NULL)
+    {
+    return false;
+    }
+  return history->History->GetPoseAtTime(this->Internal->GetPoseHistoryTime(*history, timestamp), matrix);
 }
 
 //---------------------------------------------------------------------------
-unsigned int vtkMRMLIGTLConnectorNode::GetNumberOfOutgoingMRMLNodes()
+vtkIGTLPoseHistory* vtkMRMLIGTLConnectorNode::GetPoseHistory(const char* deviceName)
 {
-  //return this->OutgoingMRMLNodeList.size();
-  return this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
+  return this->GetPoseHistory(this->GetPoseHistoryDeviceType(deviceName), deviceName);
 }
 
-
 //---------------------------------------------------------------------------
-vtkMRMLNode* vtkMRMLIGTLConnectorNode::GetOutgoingMRMLNode(unsigned int i)
+vtkIGTLPoseHistory* vtkMRMLIGTLConnectorNode::GetPoseHistory(const char* deviceType, const char* deviceName)
 {
-  if (i < (unsigned int)this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole()))
-    {
-    vtkMRMLScene* scene = this->GetScene();
-    if (!scene)
-      return NULL;
-    vtkMRMLNode* node = scene->GetNodeByID(this->GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i));
-    return node;
-    }
-  else 
+  if (deviceType == NULL || deviceName == NULL)
     {
     return NULL;
     }
+  vtkInternal::PoseHistoryType* history = this->Internal->FindPoseHistory(deviceType, deviceName);
+  return history ? history->History.GetPointer() : NULL;
 }
 
 //---------------------------------------------------------------------------
-int vtkMRMLIGTLConnectorNode::RegisterOutgoingMRMLNode(vtkMRMLNode* node, const char* devType)
+const char* vtkMRMLIGTLConnectorNode::GetPoseHistoryDeviceType(const char* deviceName)
 {
-  
-  if (!node)
+  if (deviceName == NULL)
     {
-    return 0;
+    return NULL;
     }
-  
-  // TODO: Need to check the existing device type?
-  if (node->GetAttribute("OpenIGTLinkIF.out.type") == NULL)
+  for (int i = 0; i < NumberOfPoseDeviceTypes; ++i)
     {
-    node->SetAttribute("OpenIGTLinkIF.out.type", devType);
+    if (this->Internal->FindPoseHistory(GetPoseDeviceType(i), deviceName))
+      {
+      return GetPoseDeviceType(i);
+      }
     }
-  if (node->GetAttribute("OpenIGTLinkIF.out.name") == NULL)
+  return NULL;
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::SetPosePredictionEnabled(const char* deviceName, bool enabled)
+{
+  if (deviceName == NULL || this->GetPosePredictionEnabled(deviceName) == enabled)
     {
-    node->SetAttribute("OpenIGTLinkIF.out.name", node->GetName());
+    return;
     }
-  
-  
-  
-  // Check if the node is on the reference list for outgoing nodes
-  int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
-  for (int i = 0; i < n; i ++)
+  if (enabled)
     {
-    const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-    if (strcmp(node->GetID(), id) == 0)
-      {
-      // Alredy on the list. Remove it.
-      this->RemoveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-      break;
-      }
+    this->Internal->PosePredictors[deviceName] = vtkSmartPointer<vtkIGTLPosePredictor>::New();
     }
-  
-  if (this->AddAndObserveNodeReferenceID(this->GetOutgoingNodeReferenceRole(), node->GetID()))
+  else
     {
-    igtlio::DevicePointer device = NULL;
-    igtlio::DeviceKeyType key;
-    key.name = node->GetName();
-    std::vector<std::string> deviceTypes = GetDeviceTypeFromMRMLNodeType(node->GetNodeTagName());
-    for (int typeIndex = 0; typeIndex < deviceTypes.size(); typeIndex++)
-      {
-      key.type = deviceTypes[typeIndex];
-      device = this->Internal->IOConnector->GetDevice(key);
-      if (device != NULL)
-        {
-        break;
-        }
-      }
-    /*--------
-    // device should be added in the OnNodeReferenceAdded function already,
-    // delete the following lines in the future
-    this->OutgoingMRMLIDToDeviceMap[node->GetName()] = device;
-    if (!device)
-      {
-      device = this->Internal->IOConnector->GetDeviceFactory()->create(key.type, key.name);
-      device->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_OUT);
-      this->Internal->IOConnector->AddDevice(device);
-      }
-    */
-    
-    this->Modified();
-    
-    return 1;
+    this->Internal->PosePredictors.erase(deviceName);
     }
-  else // If the reference node wasn't associated with any device, delete the reference
-    {
-    int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
-    for (int i = 0; i < n; i ++)
+  this->Modified();
+}
+
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::GetPosePredictionEnabled(const char* deviceName)
+{
+  return this->GetPosePredictor(deviceName) != NULL;
+}
+
+//---------------------------------------------------------------------------
+vtkIGTLPosePredictor* vtkMRMLIGTLConnectorNode::GetPosePredictor(const char* deviceName)
+{
+  if (deviceName == NULL)
     {
-      const char* id = GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-      if (strcmp(node->GetID(), id) == 0)
-      {
-        // Alredy on the list. Remove it.
-        this->RemoveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-        break;
-      }
+    return NULL;
     }
-    return 0;
+  vtkInternal::PosePredictorMapType::iterator iter = this->Internal->PosePredictors.find(deviceName);
+  if (iter == this->Internal->PosePredictors.end())
+    {
+    return NULL;
     }
-  
+  return iter->second;
 }
 
-
 //---------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::UnregisterOutgoingMRMLNode(vtkMRMLNode* node)
+void vtkMRMLIGTLConnectorNode::SetTransformFilterType(const char* deviceName, int type)
 {
-  if (!node)
-  {
+  if (deviceName == NULL || this->GetTransformFilterType(deviceName) == type)
+    {
     return;
-  }
-  
-  // Check if the node is on the reference list for outgoing nodes
-  int n = this->GetNumberOfNodeReferences(this->GetOutgoingNodeReferenceRole());
-  for (int i = 0; i < n; i ++)
-  {
-    const char* id = this->GetNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-    if (strcmp(node->GetID(), id) == 0)
+    }
+  if (type <= vtkIGTLTransformFilter::FILTER_NONE || type >= vtkIGTLTransformFilter::NUM_FILTER)
     {
-      // Alredy on the list. Remove it.
-      this->RemoveNthNodeReferenceID(this->GetOutgoingNodeReferenceRole(), i);
-      this->Modified();
-      break;
+    this->Internal->TransformFilters.erase(deviceName);
     }
-  }
-  
+  else
+    {
+    vtkSmartPointer<vtkIGTLTransformFilter>& filter = this->Internal->TransformFilters[deviceName];
+    if (filter == NULL)
+      {
+      filter = vtkSmartPointer<vtkIGTLTransformFilter>::New();
+      }
+    filter->SetFilterType(type);
+    }
+  this->Modified();
 }
 
 //---------------------------------------------------------------------------
-unsigned int vtkMRMLIGTLConnectorNode::GetNumberOfIncomingMRMLNodes()
+int vtkMRMLIGTLConnectorNode::GetTransformFilterType(const char* deviceName)
 {
-  //return this->IncomingMRMLNodeInfoMap.size();
-  return this->GetNumberOfNodeReferences(this->GetIncomingNodeReferenceRole());
+  vtkIGTLTransformFilter* filter = this->GetTransformFilter(deviceName);
+  return filter ? filter->GetFilterType() : static_cast<int>(vtkIGTLTransformFilter::FILTER_NONE);
 }
 
-
 //---------------------------------------------------------------------------
-vtkMRMLNode* vtkMRMLIGTLConnectorNode::GetIncomingMRMLNode(unsigned int i)
+vtkIGTLTransformFilter* vtkMRMLIGTLConnectorNode::GetTransformFilter(const char* deviceName)
 {
-  if (i < (unsigned int)this->GetNumberOfNodeReferences(this->GetIncomingNodeReferenceRole()))
+  if (deviceName == NULL)
     {
-    vtkMRMLScene* scene = this->GetScene();
-    if (!scene)
-      return NULL;
-    vtkMRMLNode* node = scene->GetNodeByID(this->GetNthNodeReferenceID(this->GetIncomingNodeReferenceRole(), i));
-    return node;
+    return NULL;
     }
-  else 
+  vtkInternal::TransformFilterMapType::iterator iter = this->Internal->TransformFilters.find(deviceName);
+  if (iter == this->Internal->TransformFilters.end())
     {
     return NULL;
     }
+  return iter->second;
 }
 
-
 //---------------------------------------------------------------------------
-int vtkMRMLIGTLConnectorNode::PushNode(vtkMRMLNode* node)
+const char* vtkMRMLIGTLConnectorNode::GetStreamStatisticsDeviceType(const char* deviceName)
 {
-  if (!node)
-    {
-    return 0;
-    }
-  
-  if (!(node->GetID()))
-  {
-    return 0;
-  }
-  
-  
-  vtkInternal::MessageDeviceMapType::iterator iter = this->Internal->OutgoingMRMLIDToDeviceMap.find(node->GetID());
-  if (iter == this->Internal->OutgoingMRMLIDToDeviceMap.end())
+  for (int i = 0; deviceName != NULL && i < NumberOfPoseDeviceTypes; ++i)
     {
-    vtkErrorMacro("Node is not found in OutgoingMRMLIDToDeviceMap: "<<node->GetID());
-    return 0;
+    if (this->Internal->FindStreamStatistics(GetPoseDeviceType(i), deviceName))
+      {
+      return GetPoseDeviceType(i);
+      }
     }
+  return NULL;
+}
 
-  vtkSmartPointer<igtlio::Device> device = iter->second;
-  igtlio::DeviceKeyType key;
-  key.name = device->GetDeviceName();
-  key.type = device->GetDeviceType();
-  device->ClearMetaData();
-  device->SetMetaDataElement(MEMLNodeNameKey, IANA_TYPE_US_ASCII, node->GetNodeTagName());
-  device->RemoveObservers(device->GetDeviceContentModifiedEvent());
-  this->Internal->AssignOutGoingNodeToDevice(node, device); // update the device content
-  device->AddObserver(device->GetDeviceContentModifiedEvent(),  this, &vtkMRMLIGTLConnectorNode::ProcessIOConnectorEvents);
-  
-  if((strcmp(node->GetClassName(),"vtkMRMLIGTLQueryNode")!=0))
+//---------------------------------------------------------------------------
+vtkIGTLLatencyHistogram* vtkMRMLIGTLConnectorNode::GetArrivalIntervalHistogram(const char* deviceName)
+{
+  return this->GetArrivalIntervalHistogram(this->GetStreamStatisticsDeviceType(deviceName), deviceName);
+}
+
+//---------------------------------------------------------------------------
+vtkIGTLLatencyHistogram* vtkMRMLIGTLConnectorNode::GetArrivalIntervalHistogram(const char* deviceType, const char* deviceName)
+{
+  vtkInternal::StreamStatisticsType* statistics = this->Internal->FindStreamStatistics(deviceType, deviceName);
+  return statistics ? statistics->ArrivalInterval.GetPointer() : NULL;
+}
+
+//---------------------------------------------------------------------------
+vtkIGTLLatencyHistogram* vtkMRMLIGTLConnectorNode::GetLatencyHistogram(const char* deviceName)
+{
+  return this->GetLatencyHistogram(this->GetStreamStatisticsDeviceType(deviceName), deviceName);
+}
+
+//---------------------------------------------------------------------------
+vtkIGTLLatencyHistogram* vtkMRMLIGTLConnectorNode::GetLatencyHistogram(const char* deviceType, const char* deviceName)
+{
+  vtkInternal::StreamStatisticsType* statistics = this->Internal->FindStreamStatistics(deviceType, deviceName);
+  return statistics ? statistics->Latency.GetPointer() : NULL;
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::GetArrivalIntervalPercentile(const char* deviceName, double percentile)
+{
+  return this->GetArrivalIntervalPercentile(this->GetStreamStatisticsDeviceType(deviceName), deviceName, percentile);
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::GetArrivalIntervalPercentile(const char* deviceType, const char* deviceName, double percentile)
+{
+  vtkIGTLLatencyHistogram* histogram = this->GetArrivalIntervalHistogram(deviceType, deviceName);
+  if (histogram == NULL || histogram->GetTotalCount() == 0)
     {
-    this->Internal->IOConnector->SendMessage(key); //
+    return -1.0;
     }
-  else if(strcmp(node->GetClassName(),"vtkMRMLIGTLQueryNode")==0)
+  return histogram->GetValueAtPercentile(percentile);
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::GetLatencyPercentile(const char* deviceName, double percentile)
+{
+  return this->GetLatencyPercentile(this->GetStreamStatisticsDeviceType(deviceName), deviceName, percentile);
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::GetLatencyPercentile(const char* deviceType, const char* deviceName, double percentile)
+{
+  vtkIGTLLatencyHistogram* histogram = this->GetLatencyHistogram(deviceType, deviceName);
+  if (histogram == NULL || histogram->GetTotalCount() == 0)
     {
-    this->Internal->IOConnector->SendMessage(key, device->MESSAGE_PREFIX_RTS);
+    return -1.0;
     }
-  return 0;
+  return histogram->GetValueAtPercentile(percentile);
 }
 
-
 //---------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::PushQuery(vtkMRMLIGTLQueryNode* node)
+void vtkMRMLIGTLConnectorNode::ResetStreamStatistics(const char* deviceName)
 {
-  if (node==NULL)
+  if (deviceName == NULL)
     {
-    vtkErrorMacro("vtkMRMLIGTLConnectorNode::PushQuery failed: invalid input node");
+    this->Internal->StreamStatistics.clear();
     return;
     }
-  igtlio::DeviceKeyType key;
-  key.name = node->GetIGTLDeviceName();
-  key.type = node->GetIGTLName();
-  
-  if(this->Internal->IOConnector->GetDevice(key)==NULL)
+  for (int i = 0; i < NumberOfPoseDeviceTypes; ++i)
     {
-    igtlio::DeviceCreatorPointer deviceCreator = this->Internal->IOConnector->GetDeviceFactory()->GetCreator(key.GetBaseTypeName());
-    if (deviceCreator.GetPointer())
-      {
-      this->Internal->IOConnector->AddDevice(deviceCreator->Create(key.name));
-      }
-    else
-      {
-      vtkErrorMacro("vtkMRMLIGTLConnectorNode::PushQuery failed: Device type not supported");
-      return;
-      }
+    this->ResetStreamStatistics(GetPoseDeviceType(i), deviceName);
     }
-  this->Internal->IOConnector->SendMessage(key, igtlio::Device::MESSAGE_PREFIX_RTS);
-  this->QueryQueueMutex->Lock();
-  node->SetTimeStamp(vtkTimerLog::GetUniversalTime());
-  node->SetQueryStatus(vtkMRMLIGTLQueryNode::STATUS_WAITING);
-  node->SetConnectorNodeID(this->GetID());
-  this->QueryWaitingQueue.push_back(node);
-  this->QueryQueueMutex->Unlock();
 }
 
-
 //---------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::CancelQuery(vtkMRMLIGTLQueryNode* node)
+void vtkMRMLIGTLConnectorNode::ResetStreamStatistics(const char* deviceType, const char* deviceName)
 {
-  if (node==NULL)
+  if (deviceType == NULL || deviceName == NULL)
     {
-    vtkErrorMacro("vtkMRMLIGTLConnectorNode::CancelQuery failed: invalid input node");
     return;
     }
-  this->QueryQueueMutex->Lock();
-  this->QueryWaitingQueue.remove(node);
-  node->SetConnectorNodeID("");
-  this->QueryQueueMutex->Unlock();
+  this->Internal->StreamStatistics.erase(std::make_pair(std::string(deviceType), std::string(deviceName)));
 }
 
 //---------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::LockIncomingMRMLNode(vtkMRMLNode* node)
+void vtkMRMLIGTLConnectorNode::SetClockSynchronizationInterval(double interval)
 {
-  vtkInternal::NodeInfoMapType::iterator iter;
-  for (iter = this->Internal->IncomingMRMLNodeInfoMap.begin(); iter != this->Internal->IncomingMRMLNodeInfoMap.end(); iter++)
+  if (interval < 0.0)
     {
-    //if ((iter->second).node == node)
-    if (iter->first.compare(node->GetID()) == 0)
-      {
-      (iter->second).lock = 1;
-      }
+    interval = 0.0;
+    }
+  if (interval == this->Internal->ClockSynchronizationInterval)
+    {
+    return;
     }
+  this->Internal->ClockSynchronizationInterval = interval;
+  this->Modified();
 }
 
+//---------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::GetClockSynchronizationInterval()
+{
+  return this->Internal->ClockSynchronizationInterval;
+}
 
 //---------------------------------------------------------------------------
-void vtkMRMLIGTLConnectorNode::UnlockIncomingMRMLNode(vtkMRMLNode* node)
+bool vtkMRMLIGTLConnectorNode::SynchronizeClock()
 {
-  // Check if the node has already been added in the locked node list
-  vtkInternal::NodeInfoMapType::iterator iter;
-  for (iter = this->Internal->IncomingMRMLNodeInfoMap.begin(); iter != this->Internal->IncomingMRMLNodeInfoMap.end(); iter++)
+  if (this->Internal->IOConnector->GetState() != igtlio::Connector::STATE_CONNECTED)
     {
-    //if ((iter->second).node == node)
-    if (iter->first.compare(node->GetID()) == 0)
-      {
-      (iter->second).lock = 0;
-      return;
-      }
+    return false;
     }
+  return this->Internal->SendClockPing();
+}
+
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::ResetClockSynchronization()
+{
+  this->Internal->ClockOffsetEstimator->Reset();
+  this->Internal->ClockPingSendTime = 0.0;
+  this->Internal->LastClockPingTime = 0.0;
+  this->Internal->ClockPingDevice = NULL;
 }
 
+//---------------------------------------------------------------------------
+bool vtkMRMLIGTLConnectorNode::IsClockOffsetValid()
+{
+  return this->Internal->ClockOffsetEstimator->IsValid();
+}
 
 //---------------------------------------------------------------------------
-int vtkMRMLIGTLConnectorNode::GetIGTLTimeStamp(vtkMRMLNode* node, int& second, int& nanosecond)
+double vtkMRMLIGTLConnectorNode::GetClockOffset()
 {
-  // Check if the node has already been added in the locked node list
-  vtkInternal::NodeInfoMapType::iterator iter;
-  for (iter = this->Internal->IncomingMRMLNodeInfoMap.begin(); iter != this->Internal->IncomingMRMLNodeInfoMap.end(); iter++)
-    {
-    //if ((iter->second).node == node)
-    if (iter->first.compare(node->GetID()) == 0)
-      {
-      second = (iter->second).second;
-      nanosecond = (iter->second).nanosecond;
-      return 1;
-      }
-    }
-  return 0;
-  
+  return this->Internal->ClockOffsetEstimator->GetOffset(vtkTimerLog::GetUniversalTime());
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::GetClockDrift()
+{
+  return this->Internal->ClockOffsetEstimator->GetDrift();
+}
+
+//---------------------------------------------------------------------------
+double vtkMRMLIGTLConnectorNode::RemoteToLocalTime(double remoteTime)
+{
+  return this->Internal->ClockOffsetEstimator->RemoteToLocalTime(remoteTime);
+}
+
+//---------------------------------------------------------------------------
+vtkIGTLClockOffsetEstimator* vtkMRMLIGTLConnectorNode::GetClockOffsetEstimator()
+{
+  return this->Internal->ClockOffsetEstimator;
 }
 
 //---------------------------------------------------------------------------
@@ -1544,6 +3899,80 @@ void vtkMRMLIGTLConnectorNode::SendCommand(std::string device_id, std::string co
   this->Internal->SendCommand(device_id, command, content, blocking ? igtlio::BLOCKING : igtlio::ASYNCHRONOUS, timeout_s);
 }
 
+//----------------------------------------------------------------------------
+vtkIGTLCommandHandle* vtkMRMLIGTLConnectorNode::SendCommandAsync(std::string device_id, std::string command, std::string content, double timeout_s /*=5*/)
+{
+  vtkSmartPointer<vtkIGTLCommandHandle> handle = this->Internal->SendCommandAsync(device_id, command, content, timeout_s, true);
+  this->Internal->PendingCommandsMutex->Lock();
+  this->Internal->IssuedCommandHandles.push_back(handle);
+  this->Internal->PendingCommandsMutex->Unlock();
+  return handle;
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandResponseCache* vtkMRMLIGTLConnectorNode::GetCommandResponseCache()
+{
+  return this->Internal->CommandResponseCache;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::RegisterCommandHandler(std::string command, vtkIGTLCommandHandler* handler)
+{
+  this->Internal->CommandDispatcher->RegisterHandler(command, handler);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::UnregisterCommandHandler(std::string command)
+{
+  this->Internal->CommandDispatcher->UnregisterHandler(command);
+}
+
+//----------------------------------------------------------------------------
+vtkIGTLCommandDispatcher* vtkMRMLIGTLConnectorNode::GetCommandDispatcher()
+{
+  return this->Internal->CommandDispatcher;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLConnectorNode::SetCommandWindowSize(int size)
+{
+  size = std::max(1, std::min(size, 1024));
+  this->Internal->PendingCommandsMutex->Lock();
+  bool modified = (this->Internal->CommandWindowSize != size);
+  this->Internal->CommandWindowSize = size;
+  this->Internal->PendingCommandsMutex->Unlock();
+  if (modified)
+    {
+    // A larger window lets queued commands go now
+    this->Internal->SendQueuedCommands();
+    this->Modified();
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetCommandWindowSize()
+{
+  return this->Internal->CommandWindowSize;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetNumberOfCommandsInFlight()
+{
+  this->Internal->PendingCommandsMutex->Lock();
+  int count = static_cast<int>(this->Internal->CommandsInFlight.size()) + this->Internal->NumberOfCommandsSending;
+  this->Internal->PendingCommandsMutex->Unlock();
+  return count;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLConnectorNode::GetNumberOfQueuedCommands()
+{
+  this->Internal->PendingCommandsMutex->Lock();
+  int count = static_cast<int>(this->Internal->QueuedCommands.size());
+  this->Internal->PendingCommandsMutex->Unlock();
+  return count;
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLIGTLConnectorNode::SendCommandResponse(std::string device_id, std::string command, std::string content)
 {
@@ -1577,7 +4006,36 @@ int vtkMRMLIGTLConnectorNode::Stop()
 //---------------------------------------------------------------------------
 void vtkMRMLIGTLConnectorNode::PeriodicProcess()
 {
+  // Blocking commands sent from other threads wait for this thread to import the response
+  this->Internal->ProcessingThreadID = vtkMultiThreader::GetCurrentThreadID();
+  this->Internal->ProcessingThreadIDValid = true;
   this->Internal->IOConnector->PeriodicProcess();
+  this->Internal->CommandDispatcher->ProcessMRMLAccessRequests();
+  this->Internal->SendCompletedCommandResponses();
+  double currentTime = vtkTimerLog::GetUniversalTime();
+  this->Internal->UpdatePendingCommands(currentTime);
+  this->Internal->ExpireQueries(currentTime);
+  this->Internal->SendSubscriptions();
+  this->Internal->ProcessClockPingResponse(currentTime);
+  this->Internal->UpdateClockSynchronization(currentTime);
+  this->Internal->PushModifiedTrackingDataBundles();
+  this->Internal->PushSubscribedNodes(currentTime);
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  // Release buffered video frames at a steady rate
+  vtkMRMLScene* scene = this->GetScene();
+  if (scene)
+    {
+    vtkInternal::MessageDeviceMapType::iterator iter;
+    for (iter = this->Internal->IncomingMRMLIDToDeviceMap.begin(); iter != this->Internal->IncomingMRMLIDToDeviceMap.end(); ++iter)
+      {
+      vtkMRMLBitStreamNode* bitStreamNode = vtkMRMLBitStreamNode::SafeDownCast(scene->GetNodeByID(iter->first));
+      if (bitStreamNode)
+        {
+        bitStreamNode->UpdateJitterBuffer();
+        }
+      }
+    }
+#endif
 }
 
 //---------------------------------------------------------------------------
@@ -1639,7 +4097,7 @@ IGTLDevicePointer vtkMRMLIGTLConnectorNode::CreateDeviceForOutgoingMRMLNode(vtkM
   {
     igtlio::DeviceKeyType key;
     key.name = dnode->GetName();
-    std::vector<std::string> deviceTypes = this->GetDeviceTypeFromMRMLNodeType(dnode->GetNodeTagName());
+    std::vector<std::string> deviceTypes = this->Internal->GetOutgoingDeviceTypes(dnode);
     for (int typeIndex = 0; typeIndex < deviceTypes.size(); typeIndex++)
     {
       key.type = deviceTypes[typeIndex];
@@ -1651,7 +4109,7 @@ IGTLDevicePointer vtkMRMLIGTLConnectorNode::CreateDeviceForOutgoingMRMLNode(vtkM
     }
     if (device == NULL)
     {
-      device = this->Internal->IOConnector->GetDeviceFactory()->create(key.type, key.name);
+      device = this->Internal->CreateDevice(key.type, key.name);
       if (device)
       {
         this->Internal->OutgoingMRMLIDToDeviceMap[dnode->GetID()] = device;
@@ -1666,6 +4124,32 @@ IGTLDevicePointer vtkMRMLIGTLConnectorNode::CreateDeviceForOutgoingMRMLNode(vtkM
   return device;
 }
 
+//---------------------------------------------------------------------------
+IGTLDevicePointer vtkMRMLIGTLConnectorNode::CreateDeviceForIncomingMessage(const char* deviceType, const char* deviceName)
+{
+  if (deviceType == NULL || deviceName == NULL)
+  {
+    return NULL;
+  }
+  igtlio::DeviceKeyType key;
+  key.type = deviceType;
+  key.name = deviceName;
+  igtlio::DevicePointer device = this->Internal->IOConnector->GetDevice(key);
+  if (device == NULL)
+  {
+    device = this->Internal->CreateDevice(key.type, key.name);
+    if (device == NULL)
+    {
+      vtkErrorMacro("CreateDeviceForIncomingMessage: unknown device type " << deviceType);
+      return NULL;
+    }
+    // The direction must be set before the device is added, so that its content is observed
+    device->SetMessageDirection(igtlio::Device::MESSAGE_DIRECTION_IN);
+    this->Internal->IOConnector->AddDevice(device);
+  }
+  return device;
+}
+
 //---------------------------------------------------------------------------
 void vtkMRMLIGTLConnectorNode::SetType(int type)
 {
@@ -16,6 +16,7 @@
 
 // OpenIGTLinkIF MRML includes
 #include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
+#include "vtkIGTLCommandHandle.h"
 #include "vtkMRMLIGTLQueryNode.h"
 
 // MRML includes
@@ -25,11 +26,18 @@
 #include <vtkMRMLScene.h>
 
 #include <vtkCallbackCommand.h>
-#include <vtkWeakPointer.h>
-
-#include <list>
-
+#include <vtkSmartPointer.h>
+
+class vtkIGTLClockOffsetEstimator;
+class vtkIGTLLatencyHistogram;
+class vtkIGTLPoseHistory;
+class vtkIGTLPosePredictor;
+class vtkIGTLTransformFilter;
+class vtkMatrix4x4;
 class vtkMRMLIGTLQueryNode;
+class vtkIGTLCommandDispatcher;
+class vtkIGTLCommandHandler;
+class vtkIGTLCommandResponseCache;
 class vtkMutexLock;
 
 typedef void* IGTLDevicePointer;
@@ -54,6 +62,7 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLConnectorNode : pub
     RemovedDeviceEvent= 118951,
     CommandReceivedEvent = 119001, // COMMAND device got a query, COMMAND received
     CommandResponseReceivedEvent = 119002, // COMMAND device got a response, RTS_COMMAND received
+    PeerCapabilityModifiedEvent = 119010, // CAPABIL received, or the capability of the peer was cleared
   };
 
   enum
@@ -124,6 +133,9 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLConnectorNode : pub
   // Description:
   // Set and start observing MRML node for outgoing data.
   // If devType == NULL, a converter is chosen based only on MRML Tag.
+  // devType "POSITION" (linear transform nodes) or "QTDATA" (tracking data bundle nodes)
+  // sends the pose as position and quaternion, which is smaller than TRANSFORM or TDATA.
+  // The type is stored in the "OpenIGTLinkIF.out.type" attribute of the node.
   int RegisterOutgoingMRMLNode(vtkMRMLNode* node, const char* devType=NULL);
   
   // Description:
@@ -169,6 +181,11 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLConnectorNode : pub
 
   // Get device for outgoing MRML node. If a device has not been created then it is created.
   IGTLDevicePointer CreateDeviceForOutgoingMRMLNode(vtkMRMLNode* dnode);
+
+  // Get device for incoming messages of the given type and name. If a device has not been
+  // created then it is created. Needed for message types that OpenIGTLinkIO cannot create
+  // when the first message arrives, such as LLVIDEO or POSITION.
+  IGTLDevicePointer CreateDeviceForIncomingMessage(const char* deviceType, const char* deviceName);
   
   // Description:
   // Get number of registered outgoing MRML nodes:
@@ -194,11 +211,9 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLConnectorNode : pub
   // external nodes or MRML event hander in the connector node.
   int PushNode(vtkMRMLNode* node);
   
-  // Query queueing mechanism is needed to send all queries from the connector thread.
-  // Queries can be pushed to the end of the QueryQueue by calling RequestInvoke from any thread,
-  // and they will be Invoked in the main thread.
-  // Use a weak pointer to make sure we don't try to access the query node after it is deleted from the scene.
-  std::list< vtkWeakPointer<vtkMRMLIGTLQueryNode> > QueryWaitingQueue;
+  // Waiting queries are indexed internally, so that responses are matched and queries expired
+  // without scanning a list; use GetNumberOfWaitingQueries.
+  // Locked while waiting queries are added, matched, expired or cancelled
   vtkMutexLock* QueryQueueMutex;
 
   //----------------------------------------------------------------
@@ -206,27 +221,164 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLConnectorNode : pub
   //----------------------------------------------------------------
   // Description:
   // Push query into the query list.
+  // A vtkMRMLIGTLTrackingDataQueryNode sends STT_TDATA (TYPE_START) or STP_TDATA (TYPE_STOP).
+  // The TDATA stream is received into a tracking data bundle node named after the query device name.
   void PushQuery(vtkMRMLIGTLQueryNode* query);
   
   // Description:
   // Removes query from the query list.
   void CancelQuery(vtkMRMLIGTLQueryNode* node);
 
+  // Description:
+  // Waiting queries are completed with STATUS_SUCCESS when a message of the query type and
+  // device name is received (any device name if the query has none), and with STATUS_EXPIRED
+  // by PeriodicProcess when TimeOut elapsed. ResponseEvent is invoked on the query node in both cases.
+  int GetNumberOfWaitingQueries();
+
+  //----------------------------------------------------------------
+  // Streaming subscriptions
+  //----------------------------------------------------------------
+
+  // Description:
+  // Request the stream of messages of the given type and device name from the peer with STT_<type>.
+  // Streaming is supported for TDATA and QTDATA only, the message types whose devices send and
+  // answer STT_ and STP_ messages. resolution is the requested interval between two messages
+  // in milliseconds. The subscription is kept until Unsubscribe: PeriodicProcess sends the request,
+  // and sends it again each time the connection is re-established. Messages are received as usual,
+  // into the incoming node of the device.
+  // Returns false if the type or the device name is empty, or if the type is not TDATA or QTDATA.
+  bool Subscribe(const char* deviceType, const char* deviceName, int resolution, const char* coordinateName = NULL);
+
+  // Description:
+  // Remove the subscription and stop the stream with STP_TDATA or STP_QTDATA
+  void Unsubscribe(const char* deviceType, const char* deviceName);
+
+  bool IsSubscribed(const char* deviceType, const char* deviceName);
+  int GetNumberOfSubscriptions();
+
+  // Description:
+  // vtkIGTLSubscriptionManager::STATUS_PENDING, STATUS_SENT, STATUS_ACCEPTED or STATUS_REJECTED
+  // (the peer answered the STT_ request with an error), -1 if there is no such subscription.
+  int GetSubscriptionStatus(const char* deviceType, const char* deviceName);
+
+  // Description:
+  // Streams requested by the peer with STT_TDATA or STT_QTDATA. The outgoing node of the device is
+  // pushed at the requested interval until the peer sends STP_ or disconnects. A request for a
+  // device that sends no node is answered with an error status. STT_ requests for other message
+  // types are not answered.
+  bool IsRemotelySubscribed(const char* deviceType, const char* deviceName);
+  int GetNumberOfRemoteSubscriptions();
+
+  //----------------------------------------------------------------
+  // Serving the images of the scene
+  //----------------------------------------------------------------
+
+  // Description:
+  // Answer GET_IMGMETA and GET_LBMETA with the volumes and label maps of the scene, and GET_IMAGE
+  // with the listed volumes (the device name of a volume is its node name). The volumes are indexed
+  // when serving is enabled, the index then follows the nodes added to and removed from the scene,
+  // so that requests do not scan the scene. A volume that already has an IMAGE device, for example
+  // an outgoing node, is listed but its GET_IMAGE requests are not answered. Off by default.
+  void SetServeSceneImages(bool serve);
+  bool GetServeSceneImages();
+  vtkBooleanMacro(ServeSceneImages, bool);
+
+  // Description:
+  // Device name of the GET_IMGMETA and GET_LBMETA requests that are answered. The default ("Catalog")
+  // is the name requested by vtkIGTLRemoteImageCatalog.
+  void SetServedImageMetaDeviceName(const char* name);
+  const char* GetServedImageMetaDeviceName();
+
+  //----------------------------------------------------------------
+  // Capability negotiation
+  //----------------------------------------------------------------
+
+  // Description:
+  // Request the CAPABIL message of the peer with GET_CAPABIL when the connection is established,
+  // and keep its message types until the connection is closed. Outgoing nodes are then sent with a
+  // type that the peer supports: VIDEO or LLVIDEO as IMAGE, POSITION as TRANSFORM, QTDATA as TDATA.
+  // Pushes of a type that the peer does not support and that has no such fallback are not sent.
+  // A fallback lasts until the capability of the peer changes or is cleared, then the requested
+  // type is used again. Everything is sent until the peer answers. GET_CAPABIL from the peer is
+  // always answered.
+  // Both peers must use the device name "Capability", which is fixed: negotiation works between
+  // two OpenIGTLinkIF connectors. Other peers answer GET_CAPABIL for another device name, or not
+  // at all, and are sent every message as without negotiation. On by default.
+  void SetCapabilityNegotiation(bool negotiate);
+  bool GetCapabilityNegotiation();
+  vtkBooleanMacro(CapabilityNegotiation, bool);
+
+  // Description:
+  // Send GET_CAPABIL. Returns false if negotiation is off or the connector is not connected.
+  bool RequestPeerCapability();
+
+  // Description:
+  // Message types listed by the peer. IsPeerTypeSupported returns true while the capability
+  // of the peer is not known.
+  bool IsPeerCapabilityKnown();
+  int GetNumberOfPeerSupportedTypes();
+  const char* GetPeerSupportedType(int index);
+  bool IsPeerTypeSupported(const char* deviceType);
+
+  // Description:
+  // Number of pushes that were not sent because the peer does not support their type
+  int GetNumberOfSuppressedMessages();
+
   //----------------------------------------------------------------
   // Sending commands
   //----------------------------------------------------------------
 
   ///  Send the given command from the given device.
-  /// - If using BLOCKING, the call blocks until a response appears or timeout. Return response.
-  /// - If using ASYNCHRONOUS, wait for the CommandResponseReceivedEvent event. Return device.
-  ///  TODO: return a command object that can be observed
+  /// - If blocking, the call sleeps until PeriodicProcess receives the response or timeout_s after the command
+  ///   is sent. Blocking is only possible from a thread other than the one that runs PeriodicProcess: on that
+  ///   thread the command is sent asynchronously, as PeriodicProcess is not re-entered to import the response.
+  /// - If not blocking, wait for the CommandResponseReceivedEvent event, or use SendCommandAsync.
   void SendCommand(std::string device_id, std::string command, std::string content, bool blocking = true, double timeout_s = 5);
 
+  /// Send the given command without blocking and return a handle that is completed when the response
+  /// arrives (during PeriodicProcess) or timeout_s after the command is sent. The handle can be polled,
+  /// waited for from another thread, or observed (vtkIGTLCommandHandle::CommandCompletedEvent).
+  /// Up to CommandWindowSize commands are in flight at the same time, further commands are queued
+  /// and sent in request order as responses arrive. Responses may arrive in any order.
+  /// The handle is owned by the connector and stays valid until 60 seconds after its completion
+  /// (or until the connector is deleted). Register it, e.g. in a vtkSmartPointer, to keep it longer.
+  /// If the command has a time to live in the response cache and a valid cached response, the handle
+  /// is returned completed with that response (GetResponseFromCache) and the command is not sent.
+  vtkIGTLCommandHandle* SendCommandAsync(std::string device_id, std::string command, std::string content, double timeout_s = 5);
+
+  /// Maximum number of commands sent and waiting for their response (1-1024, default 16).
+  /// 1 sends the commands one round trip after the other.
+  void SetCommandWindowSize(int size);
+  int GetCommandWindowSize();
+
+  /// Number of commands sent, or being sent, and waiting for their response
+  int GetNumberOfCommandsInFlight();
+
+  /// Number of commands waiting for a free slot in the command window
+  int GetNumberOfQueuedCommands();
+
+  /// Cache of command responses used by SendCommandAsync. Caching is off until a time to live
+  /// is set for a command name, e.g. GetCommandResponseCache()->SetCommandTimeToLive("Get", 2.0).
+  /// Responses of all commands sent by the connector are stored. The cache is invalidated when
+  /// a STATUS or COMMAND message is received. Hit and miss counters are available on the cache.
+  vtkIGTLCommandResponseCache* GetCommandResponseCache();
+
   /// Send a command response from the given device. Asynchronous.
   /// Precondition: The given device has received a query that is not yet responded to.
   /// TODO: return a command object that can be observed
   void SendCommandResponse(std::string device_id, std::string command, std::string content);
 
+  /// Answer the incoming commands of the given name with a handler instead of CommandReceivedEvent.
+  /// Handlers run on the worker threads of the command dispatcher, several commands can be processed
+  /// at the same time. Responses are sent from PeriodicProcess with the ID of their command.
+  /// Handlers access MRML only between vtkIGTLCommandRequest::BeginMRMLAccess and EndMRMLAccess,
+  /// which pause the thread calling PeriodicProcess. A NULL handler removes the handler.
+  void RegisterCommandHandler(std::string command, vtkIGTLCommandHandler* handler);
+  void UnregisterCommandHandler(std::string command);
+
+  /// Registry and worker pool of the command handlers, e.g. to set the number of threads
+  vtkIGTLCommandDispatcher* GetCommandDispatcher();
+
   //----------------------------------------------------------------
   // For OpenIGTLink time stamp access
   //----------------------------------------------------------------
@@ -244,6 +396,152 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLConnectorNode : pub
   // Description:
   // Get OpenIGTLink's time stamp information. Returns 0, if it fails to obtain time stamp.
   int GetIGTLTimeStamp(vtkMRMLNode* node, int& second, int& nanosecond);
+
+  //----------------------------------------------------------------
+  // Pose history of incoming transforms
+  //----------------------------------------------------------------
+
+  // Description:
+  // Number of poses kept for each incoming transform (TRANSFORM message or TDATA tool).
+  // 0 disables the history. Changing the capacity clears the histories.
+  void SetPoseHistoryCapacity(int capacity);
+  int GetPoseHistoryCapacity();
+
+  // Description:
+  // Get the pose of an incoming transform at the given time stamp (in seconds),
+  // interpolated between the received poses. deviceType is the message type (TRANSFORM, POSITION,
+  // TDATA or QTDATA) and deviceName the device name, or the tool name for TDATA and QTDATA.
+  // Time stamps are in local time if the clock offset of the peer is known (see SetClockSynchronizationInterval),
+  // otherwise in the sender's time. Poses of senders that do not set the message time stamp are stamped
+  // with their local arrival time. Returns false if no pose of the device was received
+  // or the time is outside the history.
+  // Without deviceType, the first history of the name is used, in the type order above.
+  bool GetTransformAtTime(const char* deviceType, const char* deviceName, double timestamp, vtkMatrix4x4* matrix);
+  bool GetTransformAtTime(const char* deviceName, double timestamp, vtkMatrix4x4* matrix);
+
+  // Description:
+  // Get the pose history of an incoming transform. Returns NULL if no pose was received.
+  // The history keeps the time stamps of the sender's clock (or the local arrival times, see above),
+  // so that a new clock offset estimate does not reorder it. Use GetTransformAtTime to look up
+  // a pose at a local time.
+  // If the time stamp of a message is older than the newest pose of the history, the sender clock
+  // went backward (e.g., the sender was restarted) and the history is restarted from that pose.
+  vtkIGTLPoseHistory* GetPoseHistory(const char* deviceType, const char* deviceName);
+  vtkIGTLPoseHistory* GetPoseHistory(const char* deviceName);
+
+  // Description:
+  // Message type of the first pose history of the name, in the order TRANSFORM, POSITION, TDATA, QTDATA.
+  // Returns NULL if no pose of that name was received.
+  const char* GetPoseHistoryDeviceType(const char* deviceName);
+
+  // Description:
+  // Show the pose of an incoming TRANSFORM extrapolated to compensate the latency between
+  // tracking and display, instead of the received pose. The pose is extrapolated by the time from
+  // its time stamp to its arrival plus the prediction horizon of the predictor; the measured part
+  // requires synchronized clocks (see SetClockSynchronizationInterval) or a sender on this computer.
+  // Only the rotation and the translation are extrapolated, the scaling and shear of the received
+  // matrix are kept. Prediction uses the pose history: if the pose history capacity is 0,
+  // a short history is kept for the predicted transforms.
+  void SetPosePredictionEnabled(const char* deviceName, bool enabled);
+  bool GetPosePredictionEnabled(const char* deviceName);
+
+  // Description:
+  // Get the predictor of an incoming TRANSFORM to set the prediction horizon and limits
+  // and to read the prediction error. Returns NULL if prediction is disabled for the device.
+  vtkIGTLPosePredictor* GetPosePredictor(const char* deviceName);
+
+  // Description:
+  // Smooth an incoming TRANSFORM or POSITION in the receive path, before the transform node is updated.
+  // For TDATA and QTDATA, deviceName is the name of a tool: the tool is smoothed before the
+  // transform nodes of its bundle are updated.
+  // type is vtkIGTLTransformFilter::FILTER_ONE_EURO or FILTER_KALMAN, FILTER_NONE removes the filter.
+  // Smoothed poses are stored in the pose history and used for prediction. Poses without
+  // advancing sender time stamps are filtered by their arrival time.
+  void SetTransformFilterType(const char* deviceName, int type);
+  int GetTransformFilterType(const char* deviceName);
+
+  // Description:
+  // Get the filter of an incoming TRANSFORM or tool to set its parameters. Returns NULL if no filter is set.
+  vtkIGTLTransformFilter* GetTransformFilter(const char* deviceName);
+
+  //----------------------------------------------------------------
+  // Timing of incoming tracking streams
+  //----------------------------------------------------------------
+
+  // Description:
+  // Get the histogram of the time between consecutive messages of an incoming transform,
+  // in seconds. deviceType is the message type (TRANSFORM, POSITION, TDATA or QTDATA) and
+  // deviceName the device name; a TDATA or QTDATA message counts once, under its device name.
+  // Returns NULL if no message of the device was received.
+  // Without deviceType, the first statistics of the name are used, in the type order above.
+  vtkIGTLLatencyHistogram* GetArrivalIntervalHistogram(const char* deviceType, const char* deviceName);
+  vtkIGTLLatencyHistogram* GetArrivalIntervalHistogram(const char* deviceName);
+
+  // Description:
+  // Get the histogram of the time from the message time stamp to the update of the transform,
+  // in seconds. The time stamp is set by the sender, so the latency includes the clock offset
+  // between the two computers. Returns NULL if no message of the device was received.
+  vtkIGTLLatencyHistogram* GetLatencyHistogram(const char* deviceType, const char* deviceName);
+  vtkIGTLLatencyHistogram* GetLatencyHistogram(const char* deviceName);
+
+  // Description:
+  // Arrival interval or latency below which the given percentage of the messages fall, in seconds.
+  // 50 gives the median, 100 the maximum. Returns -1 if no value was recorded for the device.
+  double GetArrivalIntervalPercentile(const char* deviceType, const char* deviceName, double percentile);
+  double GetArrivalIntervalPercentile(const char* deviceName, double percentile);
+  double GetLatencyPercentile(const char* deviceType, const char* deviceName, double percentile);
+  double GetLatencyPercentile(const char* deviceName, double percentile);
+
+  // Description:
+  // Message type of the first statistics of the name, in the order TRANSFORM, POSITION, TDATA, QTDATA.
+  // Returns NULL if no message of that name was received.
+  const char* GetStreamStatisticsDeviceType(const char* deviceName);
+
+  // Description:
+  // Forget the timing statistics of a device, of all message types of a name,
+  // or of all devices if deviceName is NULL.
+  void ResetStreamStatistics(const char* deviceType, const char* deviceName);
+  void ResetStreamStatistics(const char* deviceName = NULL);
+
+  //----------------------------------------------------------------
+  // Clock synchronization with the peer
+  //----------------------------------------------------------------
+
+  // Description:
+  // Estimate the offset between the clock of the peer and the local clock by sending a
+  // GetClockTime COMMAND every interval seconds, NTP-style. The peer connector answers with
+  // its receive and send times. 0 (default) disables the periodic exchange.
+  // Pings use the reserved device name "SlicerClockSync" and are answered whatever the interval of
+  // the answering connector is. GetClockTime commands with another device name are not intercepted.
+  // When an estimate is available, the time stamps of all incoming messages are converted
+  // to local time before they are used for pose history, filtering and timing statistics.
+  void SetClockSynchronizationInterval(double interval);
+  double GetClockSynchronizationInterval();
+
+  // Description:
+  // Send one clock synchronization ping now. Returns false if not connected or a ping is pending.
+  bool SynchronizeClock();
+
+  // Description:
+  // Forget the clock offset estimate. Called automatically when a connection is established.
+  void ResetClockSynchronization();
+
+  // Description:
+  // True if at least one ping exchange completed
+  bool IsClockOffsetValid();
+
+  // Description:
+  // Clock of the peer minus local clock, in seconds, and its rate of change
+  double GetClockOffset();
+  double GetClockDrift();
+
+  // Description:
+  // Convert a time stamp of the peer to local time. Returned unchanged if the offset is unknown.
+  double RemoteToLocalTime(double remoteTime);
+
+  // Description:
+  // Get the estimator to read the round-trip delay or change the number of exchanges used.
+  vtkIGTLClockOffsetEstimator* GetClockOffsetEstimator();
   
   
   std::vector<std::string> GetDeviceTypeFromMRMLNodeType(const char* NodeTag);
@@ -155,6 +155,7 @@ const char* vtkMRMLIGTLQueryNode::QueryStatusToString(int queryStatus)
     case STATUS_PREPARED: return "PREPARED";
     case STATUS_WAITING: return "WAITING";
     case STATUS_SUCCESS: return "SUCCESS";
+    case STATUS_ERROR: return "ERROR";
     case STATUS_EXPIRED: return "EXPIRED";
     default:
       return "INVALID";
@@ -87,7 +87,7 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLQueryNode : public
 
   // Description:
   // Timeout of the query in seconds.
-  // If TimeOut>0 then it means that QueryStatus has to be changed to STATUS_TIMEOUT if the status
+  // If TimeOut>0 then it means that QueryStatus has to be changed to STATUS_EXPIRED if the status
   // is still STATUS_WAITING and more than TimeOut time elapsed since the TimeStamp.
   // If TimeOut==0 then there is no limit on the amount of time waiting for a query response.
   vtkGetMacro( TimeOut, double );
@@ -14,27 +14,38 @@ Version:   $Revision: 1.2 $
 
 // OpenIGTLinkIF MRML includes
 #include "vtkMRMLIGTLTrackingDataBundleNode.h"
+#include "vtkIGTLMatrixConverter.h"
 
 // OpenIGTLink includes
 #include <igtlOSUtil.h>
 #include <igtlMath.h>
 #include <igtlMessageBase.h>
 #include <igtlMessageHeader.h>
+#include <igtlTrackingDataMessage.h>
 #include <igtl_header.h>  // to define maximum length of message name
 
 // MRML includes
 #include <vtkMRMLScene.h>
 
 // VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkIntArray.h>
 #include <vtkMatrix4x4.h>
 #include <vtkNew.h>
 #include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
 
 // STD includes
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <sstream>
-#include <map>
+#include <vector>
+
+#define OutgoingTransformReferenceRole "outgoingTransform"
+#define OutgoingTransformReferenceMRMLAttributeName "outgoingTransformNodeRef"
+#define ToolTypeAttributeName "IGTLToolType"
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLIGTLTrackingDataBundleNode);
@@ -47,11 +58,47 @@ public:
   vtkInternal(vtkMRMLIGTLTrackingDataBundleNode* external);
   ~vtkInternal();
 
+  struct TrackingDataInfo
+  {
+    std::string                                 name;
+    int                                         type;
+    vtkSmartPointer<vtkMRMLLinearTransformNode> node;
+    // Received matrix of the tool, reused for every update
+    vtkSmartPointer<vtkMatrix4x4>               matrix;
+  };
+
+  // Index of the tool, or -1 if it is not in the bundle
+  int FindTool(const char* name);
+
+  // Index of the tool. A new tool and its transform node are created for unknown names.
+  int GetOrAddTool(const char* name, int type);
+
+  // Set the type of the tool and of its transform node, if it changed
+  void SetToolType(TrackingDataInfo& info, int type);
+
   // Update Transform nodes. If new data is specified, create a new Transform node.
   // default type is 1 (igtl::TrackingDataMessage::TYPE_TRACKER)
   void UpdateTransformNode(const char* name, igtl::Matrix4x4& matrix, int type = 1);
 
+  // Update several tools, with the type of each tool in types, or type for all tools if types is NULL.
+  void UpdateTools(int numberOfTools, const char* const* names, const double* matrices, const int* types, int type);
+
+  static unsigned int HashName(const char* name);
+  void InsertHashTableEntry(int toolIndex);
+  void RebuildHashTable();
+
   vtkMRMLIGTLTrackingDataBundleNode* External;
+
+  // Tools in the order they were added
+  std::vector<TrackingDataInfo> Tools;
+
+  // IDs of the outgoing transform nodes that changed since the last message
+  std::set<std::string> ModifiedOutgoingNodeIDs;
+  vtkSmartPointer<vtkMatrix4x4> OutgoingMatrix;
+
+  // Open addressing hash table of tool indices, -1 marks empty slots.
+  // The size is a power of two, at least twice the number of tools.
+  std::vector<int> HashTable;
 };
 
 //----------------------------------------------------------------------------
@@ -61,6 +108,7 @@ public:
 vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::vtkInternal(vtkMRMLIGTLTrackingDataBundleNode* external)
   : External(external)
 {
+  this->OutgoingMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
 }
 
 
@@ -69,47 +117,138 @@ vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::~vtkInternal()
 {
 }
 
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::UpdateTransformNode(const char* name, igtl::Matrix4x4& matrix, int type)
+//---------------------------------------------------------------------------
+unsigned int vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::HashName(const char* name)
 {
-  TrackingDataInfoMap::iterator iter = this->External->TrackingDataList.find(std::string(name));
+  // FNV-1a
+  unsigned int hash = 2166136261u;
+  for (const unsigned char* c = reinterpret_cast<const unsigned char*>(name); *c; ++c)
+  {
+    hash = (hash ^ *c) * 16777619u;
+  }
+  return hash;
+}
 
-  vtkMRMLLinearTransformNode* node;
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::InsertHashTableEntry(int toolIndex)
+{
+  unsigned int mask = static_cast<unsigned int>(this->HashTable.size()) - 1;
+  unsigned int slot = HashName(this->Tools[toolIndex].name.c_str()) & mask;
+  while (this->HashTable[slot] >= 0)
+  {
+    slot = (slot + 1) & mask;
+  }
+  this->HashTable[slot] = toolIndex;
+}
 
-  // If the tracking node does not exist in the scene
-  if (iter == this->External->TrackingDataList.end())
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::RebuildHashTable()
+{
+  size_t size = 16;
+  while (size < 2 * this->Tools.size())
+  {
+    size *= 2;
+  }
+  this->HashTable.assign(size, -1);
+  for (int toolIndex = 0; toolIndex < static_cast<int>(this->Tools.size()); ++toolIndex)
   {
-    node = vtkMRMLLinearTransformNode::New();
-    node->SetName(name);
-    node->SetDescription("Received by OpenIGTLink");
+    this->InsertHashTableEntry(toolIndex);
+  }
+}
 
-    if (this->External->GetScene())
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::FindTool(const char* name)
+{
+  if (name == NULL || this->HashTable.empty())
+  {
+    return -1;
+  }
+  unsigned int mask = static_cast<unsigned int>(this->HashTable.size()) - 1;
+  for (unsigned int slot = HashName(name) & mask; this->HashTable[slot] >= 0; slot = (slot + 1) & mask)
+  {
+    int toolIndex = this->HashTable[slot];
+    if (this->Tools[toolIndex].name.compare(name) == 0)
     {
-      this->External->GetScene()->AddNode(node);
-      node->Delete();
+      return toolIndex;
     }
-    TrackingDataInfo info;
-    info.type = type;
-    info.node = node;
-    this->External->TrackingDataList[std::string(name)] = info;
+  }
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+int vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::GetOrAddTool(const char* name, int type)
+{
+  int toolIndex = this->FindTool(name);
+  if (toolIndex >= 0)
+  {
+    return toolIndex;
+  }
 
-    // TODO: register to MRML observer
+  // If the tracking node does not exist in the scene
+  TrackingDataInfo info;
+  info.name = name;
+  info.type = type;
+  info.node = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+  info.matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  info.node->SetName(name);
+  info.node->SetDescription("Received by OpenIGTLink");
+  vtkMRMLIGTLTrackingDataBundleNode::SetToolType(info.node, type);
+  if (this->External->GetScene())
+  {
+    this->External->GetScene()->AddNode(info.node);
+  }
+  // TODO: register to MRML observer
 
+  this->Tools.push_back(info);
+  toolIndex = static_cast<int>(this->Tools.size()) - 1;
+  if (2 * this->Tools.size() > this->HashTable.size())
+  {
+    this->RebuildHashTable();
   }
   else
   {
-    node = iter->second.node;
+    this->InsertHashTableEntry(toolIndex);
   }
+  return toolIndex;
+}
 
-  vtkNew<vtkMatrix4x4> mat;
-  double *vtkmat = &mat->Element[0][0];
-  float *igtlmat = &matrix[0][0];
-  for (int i = 0; i < 16; i++)
+//---------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::SetToolType(TrackingDataInfo& info, int type)
+{
+  if (info.type != type)
   {
-    vtkmat[i] = igtlmat[i];
+    info.type = type;
+    vtkMRMLIGTLTrackingDataBundleNode::SetToolType(info.node, type);
   }
-  node->SetMatrixTransformToParent(mat.GetPointer());
+}
 
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::UpdateTransformNode(const char* name, igtl::Matrix4x4& matrix, int type)
+{
+  TrackingDataInfo& info = this->Tools[this->GetOrAddTool(name, type)];
+  vtkIGTLMatrixConverter::ConvertMatrix(&matrix[0][0], info.matrix);
+  info.node->SetMatrixTransformToParent(info.matrix);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::vtkInternal::UpdateTools(int numberOfTools, const char* const* names,
+                                                                 const double* matrices, const int* types, int type)
+{
+  int wasModifying = this->External->StartModify();
+  for (int i = 0; i < numberOfTools; i ++)
+  {
+    if (names[i] == NULL)
+    {
+      continue;
+    }
+    int toolType = types ? types[i] : type;
+    TrackingDataInfo& info = this->Tools[this->GetOrAddTool(names[i], toolType)];
+    this->SetToolType(info, toolType);
+    info.matrix->DeepCopy(matrices + 16 * i);
+    info.node->SetMatrixTransformToParent(info.matrix);
+  }
+  this->External->Modified();
+  this->External->EndModify(wasModifying);
 }
 
 //----------------------------------------------------------------------------
@@ -121,6 +260,10 @@ vtkMRMLIGTLTrackingDataBundleNode::vtkMRMLIGTLTrackingDataBundleNode()
   this->Internal = new vtkInternal(this);
 
   this->HideFromEditors = 1;
+
+  vtkNew<vtkIntArray> events;
+  events->InsertNextValue(vtkMRMLLinearTransformNode::TransformModifiedEvent);
+  this->AddNodeReferenceRole(OutgoingTransformReferenceRole, OutgoingTransformReferenceMRMLAttributeName, events.GetPointer());
 }
 
 //----------------------------------------------------------------------------
@@ -163,6 +306,35 @@ void vtkMRMLIGTLTrackingDataBundleNode::ProcessMRMLEvents( vtkObject *caller, un
 {
   Superclass::ProcessMRMLEvents(caller, event, callData);
 
+  if (event == vtkMRMLLinearTransformNode::TransformModifiedEvent)
+    {
+    vtkMRMLNode* node = vtkMRMLNode::SafeDownCast(caller);
+    if (node && node->GetID() && this->HasNodeReferenceID(OutgoingTransformReferenceRole, node->GetID()))
+      {
+      this->Internal->ModifiedOutgoingNodeIDs.insert(node->GetID());
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::OnNodeReferenceAdded(vtkMRMLNodeReference *reference)
+{
+  Superclass::OnNodeReferenceAdded(reference);
+  if (reference->GetReferencedNodeID() && strcmp(reference->GetReferenceRole(), OutgoingTransformReferenceRole) == 0)
+    {
+    // The current pose of a new tool is sent with the next message
+    this->Internal->ModifiedOutgoingNodeIDs.insert(reference->GetReferencedNodeID());
+    }
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::OnNodeReferenceRemoved(vtkMRMLNodeReference *reference)
+{
+  Superclass::OnNodeReferenceRemoved(reference);
+  if (reference->GetReferencedNodeID() && strcmp(reference->GetReferenceRole(), OutgoingTransformReferenceRole) == 0)
+    {
+    this->Internal->ModifiedOutgoingNodeIDs.erase(reference->GetReferencedNodeID());
+    }
 }
 
 
@@ -170,69 +342,204 @@ void vtkMRMLIGTLTrackingDataBundleNode::ProcessMRMLEvents( vtkObject *caller, un
 void vtkMRMLIGTLTrackingDataBundleNode::PrintSelf(ostream& os, vtkIndent indent)
 {
   vtkMRMLNode::PrintSelf(os,indent);
+  os << indent << "NumberOfTransformNodes: " << this->Internal->Tools.size() << "\n";
+  os << indent << "NumberOfOutgoingTransformNodes: " << this->GetNumberOfOutgoingTransformNodes() << "\n";
 }
 
 
 //----------------------------------------------------------------------------
 void vtkMRMLIGTLTrackingDataBundleNode::UpdateTransformNode(const char* name, vtkMatrix4x4* matrix, int type)
 {
-  TrackingDataInfoMap::iterator iter = this->TrackingDataList.find(std::string(name));
-
-  vtkMRMLLinearTransformNode* node;
+  if (name == NULL || matrix == NULL)
+    {
+    return;
+    }
+  vtkInternal::TrackingDataInfo& info = this->Internal->Tools[this->Internal->GetOrAddTool(name, type)];
+  this->Internal->SetToolType(info, type);
+  info.node->SetMatrixTransformToParent(matrix);
+}
 
-  // If the tracking node does not exist in the scene
-  if (iter == this->TrackingDataList.end())
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::UpdateTransformNodes(int numberOfTools, const char* const* names,
+                                                             const double* matrices, int type)
+{
+  if (numberOfTools <= 0 || names == NULL || matrices == NULL)
     {
-    node = vtkMRMLLinearTransformNode::New();
-    node->SetName(name);
-    node->SetDescription("Received by OpenIGTLink");
-    if (this->GetScene())
-      {
-      this->GetScene()->AddNode(node);
-      }
-    TrackingDataInfo info;
-    info.type = type;
-    info.node = node;
-    this->TrackingDataList[std::string(name)] = info;
+    return;
+    }
+  this->Internal->UpdateTools(numberOfTools, names, matrices, NULL, type);
+}
 
-    // TODO: register to MRML observer
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::UpdateTransformNodes(int numberOfTools, const char* const* names,
+                                                             const double* matrices, const int* types)
+{
+  if (numberOfTools <= 0 || names == NULL || matrices == NULL || types == NULL)
+    {
+    return;
+    }
+  this->Internal->UpdateTools(numberOfTools, names, matrices, types, 0);
+}
 
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::UpdateTransformNodes(vtkStringArray* names, vtkDoubleArray* matrices, int type)
+{
+  if (names == NULL || matrices == NULL)
+    {
+    return;
     }
-  else
+  if (matrices->GetNumberOfComponents() != 16 || matrices->GetNumberOfTuples() != names->GetNumberOfValues())
     {
-    node = iter->second.node;
+    vtkErrorMacro("UpdateTransformNodes: expected one 16 component tuple per name");
+    return;
+    }
+  int numberOfTools = static_cast<int>(names->GetNumberOfValues());
+  std::vector<const char*> toolNames(numberOfTools);
+  for (int i = 0; i < numberOfTools; i ++)
+    {
+    toolNames[i] = names->GetValue(i).c_str();
+    }
+  if (numberOfTools > 0)
+    {
+    this->UpdateTransformNodes(numberOfTools, &toolNames[0], matrices->GetPointer(0), type);
     }
-
-  node->ApplyTransformMatrix(matrix);
-  node->Delete();
 }
 
 //----------------------------------------------------------------------------
 int vtkMRMLIGTLTrackingDataBundleNode::GetNumberOfTransformNodes()
 {
-  return this->TrackingDataList.size();
+  return static_cast<int>(this->Internal->Tools.size());
 }
 
 //----------------------------------------------------------------------------
 vtkMRMLLinearTransformNode* vtkMRMLIGTLTrackingDataBundleNode::GetTransformNode(unsigned int id)
 {
-  if (id > this->TrackingDataList.size())
+  if (id >= this->Internal->Tools.size())
     {
     return NULL;
     }
+  return this->Internal->Tools[id].node;
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLTrackingDataBundleNode::GetTransformNodeIndex(const char* name)
+{
+  return this->Internal->FindTool(name);
+}
 
-  TrackingDataInfoMap::iterator iter;
-  iter = this->TrackingDataList.begin();
-  for (unsigned int i = 0; i < id; i ++)
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLTrackingDataBundleNode::GetTransformNodeType(unsigned int id)
+{
+  if (id >= this->Internal->Tools.size())
     {
-    iter ++;
+    return 0;
     }
-  if (iter != this->TrackingDataList.end())
+  return this->Internal->Tools[id].type;
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::AddOutgoingTransformNodeID(const char* nodeID)
+{
+  if (nodeID == NULL || this->HasNodeReferenceID(OutgoingTransformReferenceRole, nodeID))
     {
-    return iter->second.node;
+    return;
     }
-  else
+  this->AddAndObserveNodeReferenceID(OutgoingTransformReferenceRole, nodeID);
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::RemoveOutgoingTransformNodeID(const char* nodeID)
+{
+  if (nodeID == NULL)
     {
-    return NULL;
+    return;
+    }
+  int n = this->GetNumberOfNodeReferences(OutgoingTransformReferenceRole);
+  for (int i = 0; i < n; i ++)
+    {
+    const char* id = this->GetNthNodeReferenceID(OutgoingTransformReferenceRole, i);
+    if (id && strcmp(id, nodeID) == 0)
+      {
+      this->RemoveNthNodeReferenceID(OutgoingTransformReferenceRole, i);
+      break;
+      }
+    }
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLTrackingDataBundleNode::GetNumberOfOutgoingTransformNodes()
+{
+  return this->GetNumberOfNodeReferences(OutgoingTransformReferenceRole);
+}
+
+//----------------------------------------------------------------------------
+vtkMRMLLinearTransformNode* vtkMRMLIGTLTrackingDataBundleNode::GetOutgoingTransformNode(int n)
+{
+  return vtkMRMLLinearTransformNode::SafeDownCast(this->GetNthNodeReference(OutgoingTransformReferenceRole, n));
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::SetToolType(vtkMRMLNode* node, int type)
+{
+  if (node == NULL)
+    {
+    return;
+    }
+  std::stringstream ss;
+  ss << type;
+  node->SetAttribute(ToolTypeAttributeName, ss.str().c_str());
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLTrackingDataBundleNode::GetToolType(vtkMRMLNode* node)
+{
+  const char* attribute = node ? node->GetAttribute(ToolTypeAttributeName) : NULL;
+  if (attribute == NULL)
+    {
+    return igtl::TrackingDataElement::TYPE_TRACKER;
+    }
+  int type = igtl::TrackingDataElement::TYPE_TRACKER;
+  std::stringstream ss(attribute);
+  ss >> type;
+  return type;
+}
+
+//----------------------------------------------------------------------------
+bool vtkMRMLIGTLTrackingDataBundleNode::HasModifiedOutgoingTransforms()
+{
+  return !this->Internal->ModifiedOutgoingNodeIDs.empty();
+}
+
+//----------------------------------------------------------------------------
+void vtkMRMLIGTLTrackingDataBundleNode::ClearModifiedOutgoingTransforms()
+{
+  this->Internal->ModifiedOutgoingNodeIDs.clear();
+}
+
+//----------------------------------------------------------------------------
+int vtkMRMLIGTLTrackingDataBundleNode::GetOutgoingTools(bool modifiedOnly, std::vector<std::string>& names,
+                                                        std::vector<double>& matrices, std::vector<int>& types)
+{
+  names.clear();
+  matrices.clear();
+  types.clear();
+  int n = this->GetNumberOfNodeReferences(OutgoingTransformReferenceRole);
+  for (int i = 0; i < n; i ++)
+    {
+    vtkMRMLLinearTransformNode* node = this->GetOutgoingTransformNode(i);
+    if (node == NULL || node->GetName() == NULL)
+      {
+      continue;
+      }
+    if (modifiedOnly && this->Internal->ModifiedOutgoingNodeIDs.count(node->GetID()) == 0)
+      {
+      continue;
+      }
+    node->GetMatrixTransformToParent(this->Internal->OutgoingMatrix);
+    const double* elements = &this->Internal->OutgoingMatrix->Element[0][0];
+    names.push_back(node->GetName());
+    matrices.insert(matrices.end(), elements, elements + 16);
+    types.push_back(GetToolType(node));
     }
+  return static_cast<int>(names.size());
 }
@@ -26,6 +26,9 @@
 // VTK includes
 #include <vtkObject.h>
 
+class vtkDoubleArray;
+class vtkStringArray;
+
 // STD includes
 #include <string>
 #include <map>
@@ -95,19 +98,82 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLTrackingDataBundleN
   // method to propagate events generated in mrml
   virtual void ProcessMRMLEvents ( vtkObject *caller, unsigned long event, void *callData ) VTK_OVERRIDE;
 
+  virtual void OnNodeReferenceAdded(vtkMRMLNodeReference *reference) VTK_OVERRIDE;
+  virtual void OnNodeReferenceRemoved(vtkMRMLNodeReference *reference) VTK_OVERRIDE;
+
   // Description:
   // Update Transform nodes. If new data is specified, create a new Transform node.
   // default type is 1 (igtl::TrackingDataMessage::TYPE_TRACKER)
   virtual void UpdateTransformNode(const char* name, vtkMatrix4x4* matrix, int type = 1);
 
+#ifndef __VTK_WRAP__
+  // Description:
+  // Update the transform nodes of several tools in one pass.
+  // matrices contains numberOfTools row-major 4x4 matrices (16 values per tool).
+  // Transform nodes are created for new names. The bundle node is modified only once.
+  virtual void UpdateTransformNodes(int numberOfTools, const char* const* names, const double* matrices, int type = 1);
+
+  // Description:
+  // Same as above, with the type of each tool in types (numberOfTools values).
+  virtual void UpdateTransformNodes(int numberOfTools, const char* const* names, const double* matrices, const int* types);
+#endif
+
+  // Description:
+  // Update the transform nodes of several tools in one pass, from Python as well.
+  // matrices has 16 components per tuple (row-major 4x4 matrix) and one tuple per name.
+  virtual void UpdateTransformNodes(vtkStringArray* names, vtkDoubleArray* matrices, int type = 1);
+
   // Description:
   // Get the number of linear transform nodes in the bundle
   virtual int GetNumberOfTransformNodes();
 
   // Description:
-  // Get the N-th linear transform node (id == N)
+  // Get the N-th linear transform node (id == N). Tools are kept in the order they were added.
   virtual vtkMRMLLinearTransformNode* GetTransformNode(unsigned int id);
 
+  // Description:
+  // Get the index of the tool with the given name, or -1 if it is not in the bundle.
+  virtual int GetTransformNodeIndex(const char* name);
+
+  // Description:
+  // Get the type of the N-th tool, as last received (igtl::TrackingDataElement::TYPE_TRACKER, ...).
+  // Returns 0 if there is no such tool.
+  virtual int GetTransformNodeType(unsigned int id);
+
+  //----------------------------------------------------------------
+  // Outgoing tools
+  //----------------------------------------------------------------
+
+  // Description:
+  // Transform nodes sent by the bundle. When the bundle is an outgoing node of a connector,
+  // the transforms that changed since the last message are sent together in one TDATA message
+  // at each connector update, instead of one TRANSFORM message per transform.
+  void AddOutgoingTransformNodeID(const char* nodeID);
+  void RemoveOutgoingTransformNodeID(const char* nodeID);
+  int GetNumberOfOutgoingTransformNodes();
+  vtkMRMLLinearTransformNode* GetOutgoingTransformNode(int n);
+
+  // Description:
+  // Type of a tool in TDATA messages (igtl::TrackingDataElement::TYPE_6D, ...). The type is kept in the
+  // "IGTLToolType" attribute of the transform node, so that it is saved with the scene. Outgoing tools
+  // without the attribute are sent as TYPE_TRACKER (1). Transform nodes of received tools get the
+  // attribute too, so that a received tool is forwarded with its type.
+  static void SetToolType(vtkMRMLNode* node, int type);
+  static int GetToolType(vtkMRMLNode* node);
+
+  // Description:
+  // True if an outgoing transform was added or changed since the last ClearModifiedOutgoingTransforms().
+  bool HasModifiedOutgoingTransforms();
+  void ClearModifiedOutgoingTransforms();
+
+#ifndef __VTK_WRAP__
+  // Description:
+  // Get the names, the row-major matrices (16 values per tool) and the types of the outgoing tools.
+  // If modifiedOnly is true, only the changed tools are returned. Returns the number of tools.
+  int GetOutgoingTools(bool modifiedOnly, std::vector<std::string>& names, std::vector<double>& matrices,
+                       std::vector<int>& types);
+#endif
+
 
  protected:
   //----------------------------------------------------------------
@@ -130,14 +196,6 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLTrackingDataBundleN
   // Data
   //----------------------------------------------------------------
 
-  typedef struct {
-    int                         type;
-    vtkMRMLLinearTransformNode* node;
-  } TrackingDataInfo;
-  typedef std::map<std::string, TrackingDataInfo> TrackingDataInfoMap;
-
-  TrackingDataInfoMap TrackingDataList;
-
   class vtkInternal;
   vtkInternal * Internal;
 };
@@ -16,22 +16,16 @@ Version:   $Revision: 1.2 $
 #include <vtkMRMLIGTLTrackingDataQueryNode.h>
 
 // OpenIGTLink includes
-#include <igtlOSUtil.h>
-#include <igtlMessageBase.h>
-#include <igtlMessageHeader.h>
-#include <igtl_header.h>  // to define maximum length of message name
-
-// MRML includes
-#include <vtkMRMLScene.h>
+#include <igtl_tdata.h>  // to define maximum length of coordinate name
 
 // VTK includes
 #include <vtkObjectFactory.h>
 
 // STD includes
+#include <cstring>
 #include <string>
 #include <iostream>
 #include <sstream>
-#include <map>
 
 //------------------------------------------------------------------------------
 vtkMRMLNodeNewMacro(vtkMRMLIGTLTrackingDataQueryNode);
@@ -39,13 +33,9 @@ vtkMRMLNodeNewMacro(vtkMRMLIGTLTrackingDataQueryNode);
 //----------------------------------------------------------------------------
 vtkMRMLIGTLTrackingDataQueryNode::vtkMRMLIGTLTrackingDataQueryNode()
 {
-  this->QueryStatus = 0;
-  this->QueryType   = 0;
-
-  this->ConnectorNodeID = "";
-
-  this->TimeStamp = 0.0;
-  this->TimeOut   = 0.0;
+  this->SetIGTLName("TDATA");
+  this->Resolution = 50;
+  this->CoordinateName = "";
 
   this->HideFromEditors = 1;
 }
@@ -61,16 +51,38 @@ void vtkMRMLIGTLTrackingDataQueryNode::WriteXML(ostream& of, int nIndent)
   // Start by having the superclass write its information
   Superclass::WriteXML(of, nIndent);
 
-  //of << " serverPort=\"" << this->ServerPort << "\" ";
-  //of << " restrictDeviceName=\"" << this->RestrictDeviceName << "\" ";
+  of << " resolution=\"" << this->Resolution << "\"";
+  of << " coordinateName=\"" << this->CoordinateName << "\"";
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLIGTLTrackingDataQueryNode::ReadXMLAttributes(const char** atts)
 {
-
-  vtkMRMLNode::ReadXMLAttributes(atts);
-
+  int disabledModify = this->StartModify();
+
+  Superclass::ReadXMLAttributes(atts);
+
+  const char* attName;
+  const char* attValue;
+  while (*atts != NULL)
+    {
+    attName = *(atts++);
+    attValue = *(atts++);
+    if (!strcmp(attName, "resolution"))
+      {
+      std::stringstream ss;
+      ss << attValue;
+      int resolution = 0;
+      ss >> resolution;
+      this->SetResolution(resolution);
+      }
+    else if (!strcmp(attName, "coordinateName"))
+      {
+      this->SetCoordinateName(attValue);
+      }
+    }
+
+  this->EndModify(disabledModify);
 }
 
 //----------------------------------------------------------------------------
@@ -78,37 +90,36 @@ void vtkMRMLIGTLTrackingDataQueryNode::ReadXMLAttributes(const char** atts)
 // Does NOT copy: ID, FilePrefix, Name, VolumeID
 void vtkMRMLIGTLTrackingDataQueryNode::Copy(vtkMRMLNode *anode)
 {
-
   Superclass::Copy(anode);
-  //vtkMRMLIGTLTrackingDataQueryNode *node = (vtkMRMLIGTLTrackingDataQueryNode *) anode;
-
-}
-
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLTrackingDataQueryNode::ProcessMRMLEvents( vtkObject *caller, unsigned long event, void *callData )
-{
-
-  Superclass::ProcessMRMLEvents(caller, event, callData);
 
+  vtkMRMLIGTLTrackingDataQueryNode* node = vtkMRMLIGTLTrackingDataQueryNode::SafeDownCast(anode);
+  if (node==NULL)
+    {
+    return;
+    }
+  this->Resolution = node->Resolution;
+  this->CoordinateName = node->CoordinateName;
 }
 
 //----------------------------------------------------------------------------
 void vtkMRMLIGTLTrackingDataQueryNode::PrintSelf(ostream& os, vtkIndent indent)
 {
-  vtkMRMLNode::PrintSelf(os,indent);
-}
+  Superclass::PrintSelf(os,indent);
 
-//----------------------------------------------------------------------------
-void vtkMRMLIGTLTrackingDataQueryNode::SetIGTLName(const char* name)
-{
-  char buf[IGTL_HEADER_DEVSIZE+1];
-  buf[IGTL_HEADER_DEVSIZE] = '\0';
-  strncpy(buf, name, IGTL_HEADER_DEVSIZE);
-  this->IGTLName = buf;
+  os << indent << "Resolution: " << this->Resolution << " ms\n";
+  os << indent << "CoordinateName: " << this->CoordinateName << "\n";
 }
 
 //----------------------------------------------------------------------------
-const char* vtkMRMLIGTLTrackingDataQueryNode::GetErrorString()
+void vtkMRMLIGTLTrackingDataQueryNode::SetCoordinateName(const char* name)
 {
-  return "";
+  char buf[IGTL_STT_TDATA_LEN_COORDNAME+1];
+  buf[IGTL_STT_TDATA_LEN_COORDNAME] = '\0';
+  strncpy(buf, name ? name : "", IGTL_STT_TDATA_LEN_COORDNAME);
+  if (this->CoordinateName.compare(buf) == 0)
+    {
+    return;
+    }
+  this->CoordinateName = buf;
+  this->Modified();
 }
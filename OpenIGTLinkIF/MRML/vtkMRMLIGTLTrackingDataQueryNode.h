@@ -16,67 +16,46 @@
 
 // OpenIGTLinkIF MRML includes
 #include "vtkSlicerOpenIGTLinkIFModuleMRMLExport.h"
-
-// MRML includes
-#include <vtkMRML.h>
-#include <vtkMRMLNode.h>
-#include <vtkMRMLStorageNode.h>
-
-// VTK includes
-#include <vtkObject.h>
+#include "vtkMRMLIGTLQueryNode.h"
 
 // STD includes
 #include <string>
-#include <map>
-#include <vector>
-#include <set>
 
-class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLTrackingDataQueryNode : public vtkMRMLNode
+// Description:
+// Query node to start (STT_TDATA) and stop (STP_TDATA) a tracking data stream.
+// The IGTL name is "TDATA" by default; set it to "QTDATA" to request the compact
+// quaternion stream (STT_QTDATA, STP_QTDATA). The device name of the query is the device name
+// of the expected tracking data messages, which are received into a tracking data bundle node
+// with the same name.
+// The ResponseEvent, TYPE_* and STATUS_* constants, the query status and type accessors, GetErrorString()
+// and the response data node ID are inherited from vtkMRMLIGTLQueryNode, so existing code that uses them
+// through this class still compiles. Differences from the previous vtkMRMLNode based class:
+// STATUS_EXPIRED is inserted before NUM_STATUS, and the XML tag is "IGTLTrackingDataQuery"
+// instead of "IGTLQuery", which is the tag of vtkMRMLIGTLQueryNode.
+class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLTrackingDataQueryNode : public vtkMRMLIGTLQueryNode
 {
  public:
 
   //----------------------------------------------------------------
-  // Constants Definitions
+  // Access functions
   //----------------------------------------------------------------
 
-  // Events
-  enum {
-    ResponseEvent        = 128940,
-  };
-
-  enum {
-    TYPE_NOT_DEFINED,
-    TYPE_GET,
-    TYPE_START,
-    TYPE_STOP,
-    NUM_TYPE,
-  };
-
-  enum {
-    STATUS_NOT_DEFINED,
-    STATUS_PREPARED,     // Ready to query
-    STATUS_WAITING,      // Waiting for response from server
-    STATUS_SUCCESS,      // Server accepted query successfuly
-    STATUS_ERROR,        // Server failed to accept query
-    NUM_STATUS,
-  };
-
- public:
+  // Description:
+  // Requested minimum interval between two TDATA messages in milliseconds.
+  vtkGetMacro( Resolution, int );
+  vtkSetClampMacro( Resolution, int, 0, VTK_INT_MAX );
 
-  //----------------------------------------------------------------
-  // Access functions
-  //----------------------------------------------------------------
-  vtkGetMacro( QueryStatus, int );
-  vtkSetMacro( QueryStatus, int );
-  vtkGetMacro( QueryType, int );
-  vtkSetMacro( QueryType, int );
+  // Description:
+  // Name of the coordinate system requested for the tracking data. Empty for the tracker default.
+  virtual void SetCoordinateName(const char* name);
+  virtual const char* GetCoordinateName() { return CoordinateName.c_str(); };
 
   //----------------------------------------------------------------
   // Standard methods for MRML nodes
   //----------------------------------------------------------------
 
   static vtkMRMLIGTLTrackingDataQueryNode *New();
-  vtkTypeMacro(vtkMRMLIGTLTrackingDataQueryNode,vtkMRMLNode);
+  vtkTypeMacro(vtkMRMLIGTLTrackingDataQueryNode,vtkMRMLIGTLQueryNode);
 
   void PrintSelf(ostream& os, vtkIndent indent) VTK_OVERRIDE;
 
@@ -97,24 +76,7 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLTrackingDataQueryNo
   // Description:
   // Get node XML tag name (like Volume, Model)
   virtual const char* GetNodeTagName() VTK_OVERRIDE
-  { return "IGTLQuery"; };
-
-  // method to propagate events generated in mrml
-  virtual void ProcessMRMLEvents ( vtkObject *caller, unsigned long event, void *callData ) VTK_OVERRIDE;
-
-  // Description:
-  // Get OpenIGTLink device name. If the query node is for IMAGE, "IMAGE" is returned.
-  virtual void SetIGTLName(const char* name);
-  virtual const char* GetIGTLName() { return IGTLName.c_str(); };
-
-  // Description:
-  // Return error message after receiving requested message.
-  virtual const char* GetErrorString();
-
-  // Description:
-  // Query node saves MRML node that holds received data as response to the query.
-  virtual void SetResponseDataNodeID(const char* id) { this->DataNodeID = id; };
-  virtual const char* GetResponseDataNodeID()        { return this->DataNodeID.c_str(); };
+  { return "IGTLTrackingDataQuery"; };
 
  protected:
   //----------------------------------------------------------------
@@ -126,30 +88,14 @@ class VTK_SLICER_OPENIGTLINKIF_MODULE_MRML_EXPORT vtkMRMLIGTLTrackingDataQueryNo
   vtkMRMLIGTLTrackingDataQueryNode(const vtkMRMLIGTLTrackingDataQueryNode&);
   void operator=(const vtkMRMLIGTLTrackingDataQueryNode&);
 
- public:
-  //----------------------------------------------------------------
-  // Connector configuration
-  //----------------------------------------------------------------
-
-
  private:
   //----------------------------------------------------------------
   // Data
   //----------------------------------------------------------------
 
-  std::string IGTLName;
-
-  int QueryStatus;
-  int QueryType;
-
-  std::string ConnectorNodeID;
-  std::string DataNodeID;
-
-  // Time when the querry issued.
-  double TimeStamp;
-  double TimeOut;
+  int Resolution;
+  std::string CoordinateName;
 
 };
 
 #endif
-
@@ -0,0 +1,135 @@
+// IF module includes
+#include "vtkIGTLClockOffsetEstimator.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// Remote clock of the simulated peer: offset at local time 100 s, and drift
+static double RemoteOffset = 5.0;
+static double RemoteDrift = 0.0;
+
+static double LocalToRemote(double localTime)
+{
+  return localTime + RemoteOffset + RemoteDrift * (localTime - 100.0);
+}
+
+// Ping sent at the given local time, with the given network delays and 1 ms processing time
+static void AddPing(vtkIGTLClockOffsetEstimator* estimator, double sendTime, double requestDelay, double responseDelay)
+{
+  double requestReceiveTime = LocalToRemote(sendTime + requestDelay);
+  double responseSendTime = LocalToRemote(sendTime + requestDelay + 0.001);
+  estimator->AddSample(sendTime, requestReceiveTime, responseSendTime, sendTime + requestDelay + 0.001 + responseDelay);
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLClockOffsetEstimator> estimator = vtkSmartPointer<vtkIGTLClockOffsetEstimator>::New();
+
+  // Without exchanges, times are not converted
+  if (estimator->IsValid() || estimator->RemoteToLocalTime(123.0) != 123.0 || estimator->LocalToRemoteTime(123.0) != 123.0)
+    {
+    std::cout << "FAILURE: times are converted without an estimate" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Symmetric delays give the exact offset
+  AddPing(estimator, 100.0, 0.01, 0.01);
+  if (!estimator->IsValid() || fabs(estimator->GetOffset(100.0) - 5.0) > 1e-9
+    || fabs(estimator->GetMinimumRoundTripDelay() - 0.02) > 1e-9
+    || fabs(estimator->RemoteToLocalTime(205.0) - 200.0) > 1e-9 || fabs(estimator->LocalToRemoteTime(200.0) - 205.0) > 1e-9)
+    {
+    std::cout << "FAILURE: offset of a symmetric ping is " << estimator->GetOffset(100.0) << ", expected 5" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Pings delayed on the way out have a wrong offset and a long round trip: the shortest half is used
+  for (int i = 0; i < 9; ++i)
+    {
+    AddPing(estimator, 101.0 + i, 0.5 + 0.01 * i, 0.01);
+    AddPing(estimator, 101.5 + i, 0.01, 0.01);
+    }
+  if (estimator->GetNumberOfSamples() != 19 || fabs(estimator->GetOffset(110.0) - 5.0) > 1e-9
+    || estimator->GetDrift() != 0.0)
+    {
+    std::cout << "FAILURE: offset with delayed pings is " << estimator->GetOffset(110.0) << ", expected 5" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A response sent after it was received (clock jump of the peer) has no negative round trip
+  estimator->Reset();
+  estimator->AddSample(100.0, 105.0, 105.5, 100.1);
+  if (estimator->GetMinimumRoundTripDelay() != 0.0)
+    {
+    std::cout << "FAILURE: negative round trip delay " << estimator->GetMinimumRoundTripDelay() << std::endl;
+    numberOfFailures++;
+    }
+
+  // Drift is estimated when the exchanges span MinimumDriftTimeSpan
+  estimator->Reset();
+  RemoteDrift = 1e-4;
+  estimator->SetMinimumDriftTimeSpan(30.0);
+  for (int i = 0; i < 13; ++i)
+    {
+    AddPing(estimator, 100.0 + 10.0 * i, 0.01, 0.01);
+    }
+  double localTime = 250.0;
+  double remoteTime = LocalToRemote(localTime);
+  if (fabs(estimator->GetDrift() - RemoteDrift) > 1e-9 || fabs(estimator->LocalToRemoteTime(localTime) - remoteTime) > 1e-6
+    || fabs(estimator->RemoteToLocalTime(remoteTime) - localTime) > 1e-6)
+    {
+    std::cout << "FAILURE: drift is " << estimator->GetDrift() << ", expected " << RemoteDrift << std::endl;
+    numberOfFailures++;
+    }
+  // Exchanges spanning a shorter time give no drift
+  estimator->SetMinimumDriftTimeSpan(1000.0);
+  estimator->Reset();
+  for (int i = 0; i < 13; ++i)
+    {
+    AddPing(estimator, 100.0 + 10.0 * i, 0.01, 0.01);
+    }
+  if (estimator->GetDrift() != 0.0)
+    {
+    std::cout << "FAILURE: drift estimated from a short time span" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Only the most recent exchanges are kept
+  estimator->Reset();
+  RemoteDrift = 0.0;
+  estimator->SetMaximumNumberOfSamples(4);
+  RemoteOffset = 1.0;
+  for (int i = 0; i < 6; ++i)
+    {
+    AddPing(estimator, 100.0 + i, 0.01, 0.01);
+    }
+  RemoteOffset = 2.0;
+  for (int i = 0; i < 4; ++i)
+    {
+    AddPing(estimator, 106.0 + i, 0.01, 0.01);
+    }
+  if (estimator->GetNumberOfSamples() != 4 || fabs(estimator->GetOffset(110.0) - 2.0) > 1e-9)
+    {
+    std::cout << "FAILURE: offset after the peer clock changed is " << estimator->GetOffset(110.0) << ", expected 2" << std::endl;
+    numberOfFailures++;
+    }
+
+  estimator->Reset();
+  if (estimator->IsValid() || estimator->GetNumberOfSamples() != 0 || estimator->RemoteToLocalTime(1.0) != 1.0)
+    {
+    std::cout << "FAILURE: exchanges remain after Reset" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: clock offset and drift estimated from pings" << std::endl;
+  return EXIT_SUCCESS;
+}
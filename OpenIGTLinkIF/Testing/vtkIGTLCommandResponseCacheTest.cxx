@@ -0,0 +1,170 @@
+// IF module includes
+#include "vtkIGTLCommandResponseCache.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+static const char* Content = "<Command><Parameter Name=\"Depth\" /></Command>";
+
+static bool IsCached(vtkIGTLCommandResponseCache* cache, const char* deviceName, const char* commandName,
+                     const std::string& content, double currentTime, const char* expectedResponse = NULL)
+{
+  std::string responseName;
+  std::string responseContent;
+  if (!cache->GetResponse(deviceName, commandName, content, currentTime, responseName, responseContent))
+    {
+    return false;
+    }
+  return expectedResponse == NULL || (responseName == commandName && responseContent == expectedResponse);
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLCommandResponseCache> cache = vtkSmartPointer<vtkIGTLCommandResponseCache>::New();
+
+  // 64-bit FNV-1a
+  if (vtkIGTLCommandResponseCache::HashContent("") != 14695981039346656037ULL
+    || vtkIGTLCommandResponseCache::HashContent("a") != 0xaf63dc4c8601ec8cULL)
+    {
+    std::cout << "FAILURE: content hash is not FNV-1a" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Commands without time to live are not cached, and not counted
+  cache->AddResponse("Scanner", "Get", Content, "Get", "<Result Depth=\"10\" />", 10.0);
+  if (cache->GetNumberOfEntries() != 0 || IsCached(cache, "Scanner", "Get", Content, 10.0)
+    || cache->GetNumberOfHits() != 0 || cache->GetNumberOfMisses() != 0)
+    {
+    std::cout << "FAILURE: command without time to live is cached" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A response is reused until its time to live expires
+  cache->SetCommandTimeToLive("Get", 2.0);
+  if (cache->GetCommandTimeToLive("Get") != 2.0 || cache->GetCommandTimeToLive("Set") != 0.0)
+    {
+    std::cout << "FAILURE: time to live is not stored" << std::endl;
+    numberOfFailures++;
+    }
+  if (IsCached(cache, "Scanner", "Get", Content, 10.0) || cache->GetNumberOfMisses() != 1)
+    {
+    std::cout << "FAILURE: response is cached before it is added" << std::endl;
+    numberOfFailures++;
+    }
+  cache->AddResponse("Scanner", "Get", Content, "Get", "<Result Depth=\"10\" />", 10.0);
+  if (!IsCached(cache, "Scanner", "Get", Content, 11.0, "<Result Depth=\"10\" />")
+    || !IsCached(cache, "Scanner", "Get", Content, 12.0, "<Result Depth=\"10\" />")
+    || cache->GetNumberOfHits() != 2)
+    {
+    std::cout << "FAILURE: response is not reused within its time to live" << std::endl;
+    numberOfFailures++;
+    }
+  if (IsCached(cache, "Scanner", "Get", Content, 12.01) || cache->GetNumberOfEntries() != 0 || cache->GetNumberOfMisses() != 2)
+    {
+    std::cout << "FAILURE: response is reused after its time to live" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A new response replaces the previous one and restarts its time to live
+  cache->AddResponse("Scanner", "Get", Content, "Get", "<Result Depth=\"10\" />", 20.0);
+  cache->AddResponse("Scanner", "Get", Content, "Get", "<Result Depth=\"20\" />", 21.0);
+  if (cache->GetNumberOfEntries() != 1 || !IsCached(cache, "Scanner", "Get", Content, 22.5, "<Result Depth=\"20\" />"))
+    {
+    std::cout << "FAILURE: response is not replaced" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Responses are stored by device name, command name and content
+  if (IsCached(cache, "Robot", "Get", Content, 21.0) || IsCached(cache, "Scanner", "Get", "<Command />", 21.0)
+    || IsCached(cache, "Scanner", "Set", Content, 21.0))
+    {
+    std::cout << "FAILURE: response is reused for another command" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Invalidation of the device, or of all devices
+  cache->AddResponse("Robot", "Get", Content, "Get", "<Result Angle=\"5\" />", 21.0);
+  cache->InvalidateDevice("Scanner");
+  if (IsCached(cache, "Scanner", "Get", Content, 21.0) || !IsCached(cache, "Robot", "Get", Content, 21.0)
+    || cache->GetNumberOfInvalidations() != 1)
+    {
+    std::cout << "FAILURE: responses of the device are not invalidated" << std::endl;
+    numberOfFailures++;
+    }
+  cache->AddResponse("Scanner", "Get", Content, "Get", "<Result Depth=\"20\" />", 21.0);
+  cache->Invalidate();
+  if (cache->GetNumberOfEntries() != 0 || IsCached(cache, "Robot", "Get", Content, 21.0)
+    || cache->GetNumberOfInvalidations() != 2)
+    {
+    std::cout << "FAILURE: responses are not invalidated" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Disabling caching of a command removes its responses only
+  cache->SetCommandTimeToLive("List", 5.0);
+  cache->AddResponse("Scanner", "Get", Content, "Get", "<Result Depth=\"20\" />", 30.0);
+  cache->AddResponse("Scanner", "List", "", "List", "<Result />", 30.0);
+  cache->SetCommandTimeToLive("Get", 0.0);
+  if (cache->GetNumberOfEntries() != 1 || !IsCached(cache, "Scanner", "List", "", 30.0, "<Result />"))
+    {
+    std::cout << "FAILURE: disabling caching of a command removed other responses" << std::endl;
+    numberOfFailures++;
+    }
+  cache->RemoveAllCommandTimeToLive();
+  if (cache->GetNumberOfEntries() != 0 || cache->GetCommandTimeToLive("List") != 0.0)
+    {
+    std::cout << "FAILURE: responses remain after caching is disabled" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A full cache removes expired responses first, then the response that expires first
+  cache->SetCommandTimeToLive("Get", 10.0);
+  cache->SetMaximumNumberOfEntries(3);
+  for (int i = 0; i < 3; ++i)
+    {
+    std::ostringstream content;
+    content << "<Command Index=\"" << i << "\" />";
+    cache->AddResponse("Scanner", "Get", content.str(), "Get", "<Result />", 40.0 + i);
+    }
+  cache->AddResponse("Scanner", "Get", "<Command Index=\"3\" />", "Get", "<Result />", 45.0);
+  if (cache->GetNumberOfEntries() != 3 || IsCached(cache, "Scanner", "Get", "<Command Index=\"0\" />", 45.0)
+    || !IsCached(cache, "Scanner", "Get", "<Command Index=\"1\" />", 45.0)
+    || !IsCached(cache, "Scanner", "Get", "<Command Index=\"3\" />", 45.0))
+    {
+    std::cout << "FAILURE: the response that expires first is not removed from a full cache" << std::endl;
+    numberOfFailures++;
+    }
+  cache->AddResponse("Scanner", "Get", "<Command Index=\"4\" />", "Get", "<Result />", 51.5);
+  if (cache->GetNumberOfEntries() != 3 || IsCached(cache, "Scanner", "Get", "<Command Index=\"1\" />", 51.5)
+    || !IsCached(cache, "Scanner", "Get", "<Command Index=\"2\" />", 51.5))
+    {
+    std::cout << "FAILURE: expired responses are not removed from a full cache" << std::endl;
+    numberOfFailures++;
+    }
+  cache->SetMaximumNumberOfEntries(1);
+  if (cache->GetNumberOfEntries() != 1 || !IsCached(cache, "Scanner", "Get", "<Command Index=\"4\" />", 51.5))
+    {
+    std::cout << "FAILURE: a smaller maximum does not keep the response that expires last" << std::endl;
+    numberOfFailures++;
+    }
+
+  cache->ResetCounters();
+  if (cache->GetNumberOfHits() != 0 || cache->GetNumberOfMisses() != 0 || cache->GetNumberOfInvalidations() != 0)
+    {
+    std::cout << "FAILURE: counters are not reset" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: command responses cached until their time to live and invalidation" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,149 @@
+// IF module includes
+#include "vtkIGTLI420ToRGBConverter.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Per-pixel conversion used by the OpenIGTLink video decoders before the SIMD kernels.
+// All implementations must reproduce its output exactly.
+static void ReferenceConvert(const unsigned char* i420, unsigned char* rgb, int width, int height)
+{
+  int chromaWidth = (width + 1) / 2;
+  const unsigned char* yPlane = i420;
+  const unsigned char* uPlane = i420 + width * height;
+  const unsigned char* vPlane = uPlane + chromaWidth * ((height + 1) / 2);
+  for (int row = 0; row < height; ++row)
+    {
+    for (int col = 0; col < width; ++col)
+      {
+      int c = yPlane[row * width + col] - 16;
+      int d = uPlane[(row / 2) * chromaWidth + col / 2] - 128;
+      int e = vPlane[(row / 2) * chromaWidth + col / 2] - 128;
+      int r = (298 * c + 409 * e + 128) >> 8;
+      int g = (298 * c - 100 * d - 208 * e + 128) >> 8;
+      int b = (298 * c + 516 * d + 128) >> 8;
+      unsigned char* out = rgb + 3 * (row * width + col);
+      out[0] = static_cast<unsigned char>(r < 0 ? 0 : (r > 255 ? 255 : r));
+      out[1] = static_cast<unsigned char>(g < 0 ? 0 : (g > 255 ? 255 : g));
+      out[2] = static_cast<unsigned char>(b < 0 ? 0 : (b > 255 ? 255 : b));
+      }
+    }
+}
+
+static int GetFrameSize(int width, int height)
+{
+  return width * height + 2 * ((width + 1) / 2) * ((height + 1) / 2);
+}
+
+static void FillRandomFrame(std::vector<unsigned char>& frame)
+{
+  for (size_t i = 0; i < frame.size(); ++i)
+    {
+    frame[i] = static_cast<unsigned char>(rand() & 0xFF);
+    }
+}
+
+// Conversion time of 1080p frames for each available implementation
+static void RunBenchmark()
+{
+  const int width = 1920;
+  const int height = 1080;
+  const int numberOfIterations = 50;
+  std::vector<unsigned char> frame(GetFrameSize(width, height));
+  FillRandomFrame(frame);
+  std::vector<unsigned char> rgb(width * height * 3);
+  for (int implementation = vtkIGTLI420ToRGBConverter::IMPLEMENTATION_SCALAR;
+    implementation < vtkIGTLI420ToRGBConverter::IMPLEMENTATION_LAST; ++implementation)
+    {
+    if (!vtkIGTLI420ToRGBConverter::IsImplementationAvailable(implementation))
+      {
+      continue;
+      }
+    double startTime = vtkTimerLog::GetUniversalTime();
+    for (int i = 0; i < numberOfIterations; ++i)
+      {
+      vtkIGTLI420ToRGBConverter::ConvertFrame(&frame[0], &rgb[0], width, height, implementation);
+      }
+    double frameTime = (vtkTimerLog::GetUniversalTime() - startTime) / numberOfIterations;
+    std::cout << vtkIGTLI420ToRGBConverter::GetImplementationName(implementation) << ": "
+              << frameTime * 1000.0 << " ms per 1080p frame" << std::endl;
+    }
+  std::cout << "Selected implementation: "
+            << vtkIGTLI420ToRGBConverter::GetImplementationName(vtkIGTLI420ToRGBConverter::GetBestImplementation()) << std::endl;
+}
+
+int main(int argc, char * argv [] )
+{
+  srand(12345);
+  int numberOfFailures = 0;
+
+  // Sizes include widths that do not fill complete vectors and odd chroma dimensions
+  const int sizes[][2] = { {1, 1}, {2, 2}, {15, 3}, {16, 2}, {17, 5}, {33, 7}, {64, 64}, {641, 481}, {1920, 1080} };
+  const int numberOfSizes = sizeof(sizes) / sizeof(sizes[0]);
+  for (int sizeIndex = 0; sizeIndex < numberOfSizes; ++sizeIndex)
+    {
+    int width = sizes[sizeIndex][0];
+    int height = sizes[sizeIndex][1];
+    std::vector<unsigned char> frame(GetFrameSize(width, height));
+    FillRandomFrame(frame);
+    if (sizeIndex == 0)
+      {
+      // Extreme values, saturating all channels
+      frame[0] = 255; frame[1] = 0; frame[2] = 255;
+      }
+    std::vector<unsigned char> expected(width * height * 3);
+    ReferenceConvert(&frame[0], &expected[0], width, height);
+
+    for (int implementation = vtkIGTLI420ToRGBConverter::IMPLEMENTATION_SCALAR;
+      implementation < vtkIGTLI420ToRGBConverter::IMPLEMENTATION_LAST; ++implementation)
+      {
+      if (!vtkIGTLI420ToRGBConverter::IsImplementationAvailable(implementation))
+        {
+        continue;
+        }
+      std::vector<unsigned char> actual(width * height * 3, 0);
+      vtkIGTLI420ToRGBConverter::ConvertFrame(&frame[0], &actual[0], width, height, implementation);
+      if (actual != expected)
+        {
+        std::cout << "FAILURE: " << vtkIGTLI420ToRGBConverter::GetImplementationName(implementation)
+                  << " output differs from the reference for " << width << "x" << height << std::endl;
+        numberOfFailures++;
+        }
+      }
+    }
+
+  // Conversion into image data
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  std::vector<unsigned char> frame(GetFrameSize(17, 5));
+  FillRandomFrame(frame);
+  std::vector<unsigned char> expected(17 * 5 * 3);
+  ReferenceConvert(&frame[0], &expected[0], 17, 5);
+  if (!vtkIGTLI420ToRGBConverter::ConvertFrame(&frame[0], 17, 5, image)
+    || image->GetNumberOfScalarComponents() != 3
+    || memcmp(image->GetScalarPointer(), &expected[0], expected.size()) != 0)
+    {
+    std::cout << "FAILURE: conversion into vtkImageData" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Timing is only measured on request, to keep test runs short
+  if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+    {
+    RunBenchmark();
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: all implementations match the reference conversion" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+// OpenIGTLink includes
+#include <igtlConfigure.h>
+
+// IF module includes
+#include "vtkIGTLImageResampler.h"
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  #include "vtkMRMLBitStreamNode.h"
+#endif
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Bilinear interpolation in floating point at the pixel center aligned source position
+static double ReferenceSample(const std::vector<unsigned char>& frame, int stride, int numberOfComponents,
+                              int regionX, int regionY, int regionWidth, int regionHeight,
+                              int outputWidth, int outputHeight, int x, int y, int component)
+{
+  double sourceX = std::max(0.0, (x + 0.5) * regionWidth / outputWidth - 0.5);
+  double sourceY = std::max(0.0, (y + 0.5) * regionHeight / outputHeight - 0.5);
+  int x0 = std::min(static_cast<int>(sourceX), regionWidth - 1);
+  int y0 = std::min(static_cast<int>(sourceY), regionHeight - 1);
+  int x1 = std::min(x0 + 1, regionWidth - 1);
+  int y1 = std::min(y0 + 1, regionHeight - 1);
+  double fx = sourceX - x0;
+  double fy = sourceY - y0;
+  const unsigned char* region = &frame[0] + regionY * stride + regionX * numberOfComponents + component;
+  double top = region[y0 * stride + x0 * numberOfComponents] * (1.0 - fx) + region[y0 * stride + x1 * numberOfComponents] * fx;
+  double bottom = region[y1 * stride + x0 * numberOfComponents] * (1.0 - fx) + region[y1 * stride + x1 * numberOfComponents] * fx;
+  return top * (1.0 - fy) + bottom * fy;
+}
+
+int main(int argc, char * argv [] )
+{
+  srand(12345);
+  int numberOfFailures = 0;
+
+  // All implementations are bit-exact and within rounding of the floating point interpolation
+  const int numberOfComponentsList[] = { 1, 3, 4 };
+  const int regions[][6] = {
+    // x, y, width, height, output width, output height
+    { 0, 0, 64, 48, 32, 24 },
+    { 5, 3, 50, 40, 20, 16 },
+    { 0, 0, 64, 48, 63, 47 },
+    { 10, 7, 33, 21, 16, 10 },
+    { 62, 46, 2, 2, 2, 2 },
+    { 0, 0, 64, 48, 2, 2 },
+    };
+  const int inputWidth = 64;
+  const int inputHeight = 48;
+  for (unsigned int componentIndex = 0; componentIndex < sizeof(numberOfComponentsList) / sizeof(int); ++componentIndex)
+    {
+    int numberOfComponents = numberOfComponentsList[componentIndex];
+    int stride = inputWidth * numberOfComponents;
+    std::vector<unsigned char> frame(stride * inputHeight);
+    for (size_t i = 0; i < frame.size(); ++i)
+      {
+      frame[i] = static_cast<unsigned char>(rand() & 0xFF);
+      }
+    for (unsigned int regionIndex = 0; regionIndex < sizeof(regions) / sizeof(regions[0]); ++regionIndex)
+      {
+      const int* r = regions[regionIndex];
+      int outputStride = r[4] * numberOfComponents;
+      std::vector<unsigned char> expected(outputStride * r[5]);
+      if (!vtkIGTLImageResampler::Resample(&frame[0], stride, numberOfComponents, r[0], r[1], r[2], r[3],
+        &expected[0], outputStride, r[4], r[5], vtkIGTLImageResampler::IMPLEMENTATION_SCALAR))
+        {
+        std::cout << "FAILURE: scalar resampling of region " << regionIndex << " failed" << std::endl;
+        numberOfFailures++;
+        continue;
+        }
+      for (int y = 0; y < r[5]; ++y)
+        {
+        for (int x = 0; x < r[4]; ++x)
+          {
+          for (int component = 0; component < numberOfComponents; ++component)
+            {
+            double reference = ReferenceSample(frame, stride, numberOfComponents, r[0], r[1], r[2], r[3],
+              r[4], r[5], x, y, component);
+            if (fabs(expected[y * outputStride + x * numberOfComponents + component] - reference) > 3.0)
+              {
+              std::cout << "FAILURE: region " << regionIndex << " with " << numberOfComponents
+                        << " components differs from bilinear interpolation at " << x << ", " << y << std::endl;
+              numberOfFailures++;
+              x = r[4];
+              y = r[5];
+              break;
+              }
+            }
+          }
+        }
+      for (int implementation = vtkIGTLImageResampler::IMPLEMENTATION_SCALAR + 1;
+        implementation < vtkIGTLImageResampler::IMPLEMENTATION_LAST; ++implementation)
+        {
+        if (!vtkIGTLImageResampler::IsImplementationAvailable(implementation))
+          {
+          continue;
+          }
+        // Guard bytes detect writes past the end of the output
+        std::vector<unsigned char> actual(outputStride * r[5] + 4, 0xA5);
+        vtkIGTLImageResampler::Resample(&frame[0], stride, numberOfComponents, r[0], r[1], r[2], r[3],
+          &actual[0], outputStride, r[4], r[5], implementation);
+        if (memcmp(&actual[0], &expected[0], expected.size()) != 0
+          || actual[expected.size()] != 0xA5 || actual[expected.size() + 3] != 0xA5)
+          {
+          std::cout << "FAILURE: implementation " << implementation << " differs from the scalar code for region "
+                    << regionIndex << " with " << numberOfComponents << " components" << std::endl;
+          numberOfFailures++;
+          }
+        }
+      }
+    }
+
+  // Spacing and origin follow the crop and the scale
+  vtkSmartPointer<vtkImageData> input = vtkSmartPointer<vtkImageData>::New();
+  input->SetDimensions(inputWidth, inputHeight, 1);
+  input->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+  input->SetSpacing(0.5, 0.25, 2.0);
+  input->SetOrigin(10.0, 20.0, 30.0);
+  vtkSmartPointer<vtkImageData> output = vtkSmartPointer<vtkImageData>::New();
+  const int region[4] = { 8, 4, 32, 24 };
+  if (!vtkIGTLImageResampler::Resample(input, region, 16, 8, output))
+    {
+    std::cout << "FAILURE: resampling of vtkImageData failed" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    // Scale 2 horizontally and 3 vertically, output pixel 0 is at source pixel (8.5, 5)
+    double* spacing = output->GetSpacing();
+    double* origin = output->GetOrigin();
+    if (output->GetDimensions()[0] != 16 || output->GetDimensions()[1] != 8
+      || fabs(spacing[0] - 1.0) > 1e-9 || fabs(spacing[1] - 0.75) > 1e-9 || fabs(spacing[2] - 2.0) > 1e-9
+      || fabs(origin[0] - 14.25) > 1e-9 || fabs(origin[1] - 21.25) > 1e-9 || fabs(origin[2] - 30.0) > 1e-9)
+      {
+      std::cout << "FAILURE: resampled image geometry is spacing " << spacing[0] << " " << spacing[1] << " "
+                << spacing[2] << ", origin " << origin[0] << " " << origin[1] << " " << origin[2] << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+#if defined(OpenIGTLink_ENABLE_VIDEOSTREAMING)
+  // EncodeRegion and EncodeScale of the bitstream node
+  vtkSmartPointer<vtkMRMLBitStreamNode> node = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(inputWidth, inputHeight, 1);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+  node->SetAndObserveImageData(image);
+  node->SetSpacing(0.5, 0.5, 1.0);
+  node->SetOrigin(-10.0, -20.0, 0.0);
+  if (node->GetEncodeImageData() != image)
+    {
+    std::cout << "FAILURE: the image is resampled without encode region and scale" << std::endl;
+    numberOfFailures++;
+    }
+  node->SetEncodeRegion(10, 6, 41, 30);
+  node->SetEncodeScale(0.5);
+  vtkImageData* encodeImage = node->GetEncodeImageData();
+  // Width and height are rounded down to even numbers for the I420 encoders
+  if (encodeImage == image || encodeImage->GetDimensions()[0] != 20 || encodeImage->GetDimensions()[1] != 14)
+    {
+    std::cout << "FAILURE: unexpected encode image size" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    // The last encoded pixel and the source position it was interpolated at have the same RAS position
+    vtkSmartPointer<vtkMatrix4x4> imageIJKToRAS = vtkSmartPointer<vtkMatrix4x4>::New();
+    node->GetIJKToRASMatrix(imageIJKToRAS);
+    vtkSmartPointer<vtkMatrix4x4> encodeIJKToRAS = vtkSmartPointer<vtkMatrix4x4>::New();
+    node->GetEncodeIJKToRASMatrix(encodeIJKToRAS);
+    double encodePixel[4] = { 19.0, 13.0, 0.0, 1.0 };
+    double sourcePixel[4] = { 10.0 + 19.5 * 41.0 / 20.0 - 0.5, 6.0 + 13.5 * 30.0 / 14.0 - 0.5, 0.0, 1.0 };
+    double encodeRAS[4] = { 0.0, 0.0, 0.0, 0.0 };
+    double sourceRAS[4] = { 0.0, 0.0, 0.0, 0.0 };
+    encodeIJKToRAS->MultiplyPoint(encodePixel, encodeRAS);
+    imageIJKToRAS->MultiplyPoint(sourcePixel, sourceRAS);
+    if (fabs(encodeRAS[0] - sourceRAS[0]) > 1e-9 || fabs(encodeRAS[1] - sourceRAS[1]) > 1e-9
+      || fabs(encodeRAS[2] - sourceRAS[2]) > 1e-9)
+      {
+      std::cout << "FAILURE: encode IJK to RAS matrix does not follow the encode region and scale" << std::endl;
+      numberOfFailures++;
+      }
+    }
+#endif
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: resampled frames and geometry match the reference" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+// IF module includes
+#include "vtkIGTLLatencyHistogram.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Values are compared in microseconds
+static double ToMicroseconds(double value)
+{
+  return floor(value * 1e6 + 0.5);
+}
+
+// Each percentile must be at or above the exact percentile of the values, and above it by
+// less than the width of one sub-bucket (1/64 of the value)
+static bool CheckPercentiles(vtkIGTLLatencyHistogram* histogram, std::vector<double> microseconds, const char* description)
+{
+  std::sort(microseconds.begin(), microseconds.end());
+  const double percentiles[] = { 0.0, 1.0, 10.0, 25.0, 50.0, 75.0, 90.0, 99.0, 99.9, 100.0 };
+  for (unsigned int i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i)
+    {
+    size_t count = static_cast<size_t>(percentiles[i] / 100.0 * microseconds.size() + 0.5);
+    double exact = microseconds[count > 0 ? count - 1 : 0];
+    double value = ToMicroseconds(histogram->GetValueAtPercentile(percentiles[i]));
+    if (value < exact || value > exact + exact / 64.0)
+      {
+      std::cout << "FAILURE: " << description << ": percentile " << percentiles[i] << " is " << value
+                << " us, expected " << exact << " us" << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLLatencyHistogram> histogram = vtkSmartPointer<vtkIGTLLatencyHistogram>::New();
+
+  // Empty histogram
+  if (histogram->GetTotalCount() != 0 || histogram->GetMinimum() != 0.0 || histogram->GetMaximum() != 0.0
+    || histogram->GetMean() != 0.0 || histogram->GetValueAtPercentile(50.0) != 0.0)
+    {
+    std::cout << "FAILURE: empty histogram has values" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Values below 128 microseconds are exact
+  for (int value = 1; value <= 100; ++value)
+    {
+    histogram->RecordValue(value * 1e-6);
+    }
+  if (histogram->GetTotalCount() != 100 || ToMicroseconds(histogram->GetMinimum()) != 1.0
+    || ToMicroseconds(histogram->GetMaximum()) != 100.0 || fabs(histogram->GetMean() - 50.5e-6) > 1e-12
+    || ToMicroseconds(histogram->GetValueAtPercentile(50.0)) != 50.0
+    || ToMicroseconds(histogram->GetValueAtPercentile(99.0)) != 99.0
+    || ToMicroseconds(histogram->GetValueAtPercentile(0.0)) != 1.0)
+    {
+    std::cout << "FAILURE: small values are not exact" << std::endl;
+    numberOfFailures++;
+    }
+  // Percentiles outside 0-100 are clamped to the extremes
+  if (ToMicroseconds(histogram->GetValueAtPercentile(-5.0)) != 1.0
+    || ToMicroseconds(histogram->GetValueAtPercentile(150.0)) != 100.0)
+    {
+    std::cout << "FAILURE: percentiles outside 0-100 are not clamped" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Values that share a sub-bucket: 128 and 129 us are counted together, 130 us is in the next sub-bucket
+  histogram->Reset();
+  histogram->RecordValue(128e-6);
+  histogram->RecordValue(129e-6);
+  histogram->RecordValue(130e-6);
+  histogram->RecordValue(131e-6);
+  if (ToMicroseconds(histogram->GetValueAtPercentile(25.0)) != 129.0
+    || ToMicroseconds(histogram->GetValueAtPercentile(50.0)) != 129.0
+    || ToMicroseconds(histogram->GetValueAtPercentile(75.0)) != 131.0)
+    {
+    std::cout << "FAILURE: sub-buckets of 128-131 us are " << ToMicroseconds(histogram->GetValueAtPercentile(25.0))
+              << ", " << ToMicroseconds(histogram->GetValueAtPercentile(50.0)) << ", "
+              << ToMicroseconds(histogram->GetValueAtPercentile(75.0)) << " us" << std::endl;
+    numberOfFailures++;
+    }
+  // A single value is reported exactly, percentiles do not go beyond the exact extremes
+  histogram->Reset();
+  histogram->RecordValue(0.0123456);
+  if (ToMicroseconds(histogram->GetValueAtPercentile(50.0)) != 12346.0
+    || ToMicroseconds(histogram->GetValueAtPercentile(100.0)) != 12346.0)
+    {
+    std::cout << "FAILURE: a single value is reported as " << histogram->GetValueAtPercentile(50.0) << std::endl;
+    numberOfFailures++;
+    }
+
+  // Uniform distribution from 1 us to 10 ms
+  histogram->Reset();
+  std::vector<double> values;
+  for (int value = 1; value <= 10000; ++value)
+    {
+    histogram->RecordValue(value * 1e-6);
+    values.push_back(value);
+    }
+  numberOfFailures += CheckPercentiles(histogram, values, "uniform distribution") ? 0 : 1;
+  if (ToMicroseconds(histogram->GetValueAtPercentile(50.0)) != 5055.0)
+    {
+    std::cout << "FAILURE: median of 1-10000 us is " << histogram->GetValueAtPercentile(50.0)
+              << ", expected the top of the 5000 us sub-bucket" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Latencies from 100 us to 100 s, spread over many powers of two
+  histogram->Reset();
+  values.clear();
+  for (int i = 0; i <= 600; ++i)
+    {
+    double value = floor(100.0 * pow(10.0, i / 100.0));
+    histogram->RecordValue(value * 1e-6);
+    values.push_back(value);
+    }
+  numberOfFailures += CheckPercentiles(histogram, values, "logarithmic distribution") ? 0 : 1;
+  double sum = 0.0;
+  for (size_t i = 0; i < values.size(); ++i)
+    {
+    sum += values[i];
+    }
+  if (fabs(histogram->GetMean() - sum / values.size() * 1e-6) > 1e-9)
+    {
+    std::cout << "FAILURE: mean is " << histogram->GetMean() << ", expected " << sum / values.size() * 1e-6 << std::endl;
+    numberOfFailures++;
+    }
+
+  // Negative values are counted as 0, values beyond the range as the largest trackable value
+  histogram->Reset();
+  histogram->RecordValue(-0.001);
+  histogram->RecordValue(1e6);
+  if (histogram->GetTotalCount() != 2 || histogram->GetNumberOfNegativeValues() != 1
+    || histogram->GetMinimum() != 0.0 || ToMicroseconds(histogram->GetMaximum()) != 68719476735.0
+    || histogram->GetValueAtPercentile(50.0) != 0.0
+    || ToMicroseconds(histogram->GetValueAtPercentile(100.0)) != 68719476735.0)
+    {
+    std::cout << "FAILURE: negative or too large values are not clamped" << std::endl;
+    numberOfFailures++;
+    }
+
+  histogram->Reset();
+  if (histogram->GetTotalCount() != 0 || histogram->GetNumberOfNegativeValues() != 0
+    || histogram->GetMaximum() != 0.0 || histogram->GetValueAtPercentile(100.0) != 0.0)
+    {
+    std::cout << "FAILURE: values remain after Reset" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: latency histogram buckets and percentiles" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+// IF module includes
+#include "vtkIGTLLosslessCodec.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Synthetic 16-bit frame: smooth structure moving by a few pixels per frame with detector noise,
+// similar to fluoroscopy or ultrasound RF data.
+static void FillFrame(vtkImageData* image, int width, int height, int frameIndex, int noiseAmplitude)
+{
+  if (image->GetDimensions()[0] != width || image->GetDimensions()[1] != height
+    || image->GetScalarType() != VTK_UNSIGNED_SHORT)
+    {
+    image->SetDimensions(width, height, 1);
+    image->AllocateScalars(VTK_UNSIGNED_SHORT, 1);
+    }
+  unsigned short* pixels = static_cast<unsigned short*>(image->GetScalarPointer());
+  double shift = 2.0 * frameIndex;
+  for (int y = 0; y < height; ++y)
+    {
+    for (int x = 0; x < width; ++x)
+      {
+      double value = 20000.0 + 12000.0 * sin((x + shift) * 0.02) * cos(y * 0.015)
+        + 8000.0 * exp(-((x - width / 2 - shift) * (x - width / 2 - shift) + (y - height / 2) * (y - height / 2)) / 20000.0);
+      int noise = noiseAmplitude > 0 ? (rand() % (2 * noiseAmplitude + 1)) - noiseAmplitude : 0;
+      int sample = static_cast<int>(value) + noise;
+      pixels[y * width + x] = static_cast<unsigned short>(sample < 0 ? 0 : (sample > 65535 ? 65535 : sample));
+      }
+    }
+  image->Modified();
+}
+
+static bool IsEqual(vtkImageData* a, vtkImageData* b)
+{
+  int* dimensionsA = a->GetDimensions();
+  int* dimensionsB = b->GetDimensions();
+  if (dimensionsA[0] != dimensionsB[0] || dimensionsA[1] != dimensionsB[1] || dimensionsA[2] != dimensionsB[2]
+    || a->GetScalarType() != b->GetScalarType() || a->GetNumberOfScalarComponents() != b->GetNumberOfScalarComponents())
+    {
+    return false;
+    }
+  size_t size = static_cast<size_t>(dimensionsA[0]) * dimensionsA[1] * dimensionsA[2]
+    * a->GetNumberOfScalarComponents() * a->GetScalarSize();
+  return memcmp(a->GetScalarPointer(), b->GetScalarPointer(), size) == 0;
+}
+
+// Compression ratio and throughput on synthetic 16-bit 1024x1024 frames for each thread count.
+// Returns the number of frames that are not reconstructed exactly.
+static int RunBenchmark(const std::vector<int>& threadCounts)
+{
+  int numberOfFailures = 0;
+  const int width = 1024;
+  const int height = 1024;
+  const int numberOfFrames = 30;
+  const double rawFrameSize = width * height * 2.0;
+  const int noiseAmplitudes[] = { 0, 16, 256 };
+  for (unsigned int noiseIndex = 0; noiseIndex < sizeof(noiseAmplitudes) / sizeof(noiseAmplitudes[0]); ++noiseIndex)
+    {
+    std::vector<vtkSmartPointer<vtkImageData> > frames;
+    for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+      {
+      vtkSmartPointer<vtkImageData> frame = vtkSmartPointer<vtkImageData>::New();
+      FillFrame(frame, width, height, frameIndex, noiseAmplitudes[noiseIndex]);
+      frames.push_back(frame);
+      }
+    const int keyFrameIntervals[] = { 1, numberOfFrames };
+    for (int runIndex = 0; runIndex < 2 * static_cast<int>(threadCounts.size()); ++runIndex)
+      {
+      int keyFrameInterval = keyFrameIntervals[runIndex / threadCounts.size()];
+      int numberOfThreads = threadCounts[runIndex % threadCounts.size()];
+      vtkSmartPointer<vtkIGTLLosslessCodec> encoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+      vtkSmartPointer<vtkIGTLLosslessCodec> decoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+      encoder->SetKeyFrameInterval(keyFrameInterval);
+      encoder->SetNumberOfThreads(numberOfThreads);
+      decoder->SetNumberOfThreads(numberOfThreads);
+      vtkSmartPointer<vtkImageData> decoded = vtkSmartPointer<vtkImageData>::New();
+      std::vector<unsigned char> stream;
+      double encodeTime = 0.0;
+      double decodeTime = 0.0;
+      double compressedSize = 0.0;
+      for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+        {
+        double startTime = vtkTimerLog::GetUniversalTime();
+        encoder->EncodeFrame(frames[frameIndex], stream);
+        double encodedTime = vtkTimerLog::GetUniversalTime();
+        bool decodeSuccess = decoder->DecodeFrame(&stream[0], stream.size(), decoded);
+        encodeTime += encodedTime - startTime;
+        decodeTime += vtkTimerLog::GetUniversalTime() - encodedTime;
+        compressedSize += stream.size();
+        if (!decodeSuccess || !IsEqual(frames[frameIndex], decoded))
+          {
+          std::cout << "FAILURE: benchmark frame " << frameIndex << " is not reconstructed exactly" << std::endl;
+          numberOfFailures++;
+          break;
+          }
+        }
+      double megabytes = rawFrameSize * numberOfFrames / 1.0e6;
+      std::cout << "noise " << noiseAmplitudes[noiseIndex]
+                << ", " << (keyFrameInterval == 1 ? "key frames only" : "frame differencing")
+                << ", " << numberOfThreads << (numberOfThreads == 1 ? " thread" : " threads")
+                << ": ratio " << rawFrameSize * numberOfFrames / compressedSize
+                << ", encode " << megabytes / encodeTime << " MB/s"
+                << ", decode " << megabytes / decodeTime << " MB/s" << std::endl;
+      }
+    }
+  return numberOfFailures;
+}
+
+int main(int argc, char * argv [] )
+{
+  srand(12345);
+  int numberOfFailures = 0;
+
+  // Round trip of random frames of all supported types, including sizes smaller than a block
+  const int sizes[][2] = { {1, 1}, {3, 2}, {33, 7}, {640, 480} };
+  const int scalarTypes[] = { VTK_UNSIGNED_CHAR, VTK_SIGNED_CHAR, VTK_UNSIGNED_SHORT, VTK_SHORT };
+  for (unsigned int sizeIndex = 0; sizeIndex < sizeof(sizes) / sizeof(sizes[0]); ++sizeIndex)
+    {
+    for (unsigned int typeIndex = 0; typeIndex < sizeof(scalarTypes) / sizeof(scalarTypes[0]); ++typeIndex)
+      {
+      for (int numberOfComponents = 1; numberOfComponents <= 3; numberOfComponents += 2)
+        {
+        vtkSmartPointer<vtkIGTLLosslessCodec> encoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+        vtkSmartPointer<vtkIGTLLosslessCodec> decoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+        encoder->SetKeyFrameInterval(3);
+        // Frames split into more strips than the decoder has threads, and the other way round
+        encoder->SetNumberOfThreads(typeIndex % 2 == 0 ? 1 : 4);
+        decoder->SetNumberOfThreads(3);
+        vtkSmartPointer<vtkImageData> frame = vtkSmartPointer<vtkImageData>::New();
+        frame->SetDimensions(sizes[sizeIndex][0], sizes[sizeIndex][1], 1);
+        frame->AllocateScalars(scalarTypes[typeIndex], numberOfComponents);
+        vtkSmartPointer<vtkImageData> decoded = vtkSmartPointer<vtkImageData>::New();
+        std::vector<unsigned char> stream;
+        for (int frameIndex = 0; frameIndex < 5; ++frameIndex)
+          {
+          unsigned char* bytes = static_cast<unsigned char*>(frame->GetScalarPointer());
+          size_t size = static_cast<size_t>(sizes[sizeIndex][0]) * sizes[sizeIndex][1] * numberOfComponents * frame->GetScalarSize();
+          for (size_t i = 0; i < size; ++i)
+            {
+            bytes[i] = static_cast<unsigned char>(rand() & 0xFF);
+            }
+          frame->Modified();
+          if (!encoder->EncodeFrame(frame, stream) || !decoder->DecodeFrame(&stream[0], stream.size(), decoded)
+            || !IsEqual(frame, decoded))
+            {
+            std::cout << "FAILURE: round trip of " << sizes[sizeIndex][0] << "x" << sizes[sizeIndex][1]
+                      << " frame " << frameIndex << " of type " << frame->GetScalarTypeAsString()
+                      << " with " << numberOfComponents << " components" << std::endl;
+            numberOfFailures++;
+            }
+          }
+        }
+      }
+    }
+
+  // One strip per thread, small frames are not split
+  {
+  vtkSmartPointer<vtkIGTLLosslessCodec> encoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+  encoder->SetNumberOfThreads(4);
+  vtkSmartPointer<vtkImageData> frame = vtkSmartPointer<vtkImageData>::New();
+  std::vector<unsigned char> stream;
+  FillFrame(frame, 640, 480, 0, 10);
+  encoder->EncodeFrame(frame, stream);
+  int numberOfStrips = stream[16];
+  FillFrame(frame, 64, 40, 0, 10);
+  encoder->EncodeFrame(frame, stream);
+  if (numberOfStrips != 4 || stream[16] != 1)
+    {
+    std::cout << "FAILURE: frames are not split into one strip per thread" << std::endl;
+    numberOfFailures++;
+    }
+  }
+
+  // A delta frame cannot be decoded without its reference frame
+  {
+  vtkSmartPointer<vtkIGTLLosslessCodec> encoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+  vtkSmartPointer<vtkIGTLLosslessCodec> decoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+  vtkSmartPointer<vtkImageData> frame = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkImageData> decoded = vtkSmartPointer<vtkImageData>::New();
+  std::vector<unsigned char> stream;
+  FillFrame(frame, 64, 64, 0, 10);
+  encoder->EncodeFrame(frame, stream);
+  FillFrame(frame, 64, 64, 1, 10);
+  encoder->EncodeFrame(frame, stream);
+  if (vtkIGTLLosslessCodec::IsKeyFrame(&stream[0], stream.size()) || decoder->DecodeFrame(&stream[0], stream.size(), decoded))
+    {
+    std::cout << "FAILURE: delta frame decoded without reference frame" << std::endl;
+    numberOfFailures++;
+    }
+  }
+
+  // Headers that do not match the stream length are rejected before the frame is allocated
+  {
+  vtkSmartPointer<vtkIGTLLosslessCodec> encoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+  vtkSmartPointer<vtkIGTLLosslessCodec> decoder = vtkSmartPointer<vtkIGTLLosslessCodec>::New();
+  vtkSmartPointer<vtkImageData> frame = vtkSmartPointer<vtkImageData>::New();
+  vtkSmartPointer<vtkImageData> decoded = vtkSmartPointer<vtkImageData>::New();
+  std::vector<unsigned char> stream;
+  FillFrame(frame, 32, 32, 0, 0);
+  encoder->EncodeFrame(frame, stream);
+
+  std::vector<unsigned char> largeFrame(stream);
+  // 65535 x 65535 pixels with 255 components
+  largeFrame[6] = 255;
+  largeFrame[8] = largeFrame[9] = largeFrame[12] = largeFrame[13] = 0xFF;
+  largeFrame[10] = largeFrame[11] = largeFrame[14] = largeFrame[15] = 0;
+  std::vector<unsigned char> truncated(stream.begin(), stream.end() - 1);
+  std::vector<unsigned char> manyStrips(stream);
+  manyStrips[16] = 32;
+  if (decoder->DecodeFrame(&largeFrame[0], largeFrame.size(), decoded) || decoded->GetPointData()->GetScalars() != NULL
+    || decoder->DecodeFrame(&truncated[0], truncated.size(), decoded)
+    || decoder->DecodeFrame(&manyStrips[0], manyStrips.size(), decoded))
+    {
+    std::cout << "FAILURE: stream with an invalid frame size or length was decoded" << std::endl;
+    numberOfFailures++;
+    }
+  if (!decoder->DecodeFrame(&stream[0], stream.size(), decoded) || !IsEqual(frame, decoded))
+    {
+    std::cout << "FAILURE: valid stream is not decoded after invalid streams" << std::endl;
+    numberOfFailures++;
+    }
+  }
+
+  // Only a short benchmark runs by default, to keep test runs short
+  std::vector<int> threadCounts;
+  threadCounts.push_back(1);
+  int defaultNumberOfThreads = vtkSmartPointer<vtkIGTLLosslessCodec>::New()->GetNumberOfThreads();
+  if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+    {
+    for (int numberOfThreads = 2; numberOfThreads < std::max(8, defaultNumberOfThreads); numberOfThreads *= 2)
+      {
+      threadCounts.push_back(numberOfThreads);
+      }
+    }
+  if (threadCounts.back() != defaultNumberOfThreads)
+    {
+    threadCounts.push_back(defaultNumberOfThreads);
+    }
+  numberOfFailures += RunBenchmark(threadCounts);
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: all frames were reconstructed exactly" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+//OpenIGTLink includes
+#include "igtlMessageHeader.h"
+#include "igtlTrackingDataMessage.h"
+
+// IF module includes
+#include "vtkIGTLMatrixConverter.h"
+#include "vtkIGTLTrackingDataDevice.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+// Plain widening loop, all implementations must reproduce its output bit for bit
+static void ReferenceConvert(const float* source, double* destination, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+    {
+    destination[i] = static_cast<double>(source[i]);
+    }
+}
+
+static float GetRandomValue()
+{
+  return static_cast<float>(rand() - RAND_MAX / 2) / 1000.0f;
+}
+
+static igtl::MessageBase::Pointer ToReceivedBuffer(igtl::MessageBase::Pointer message)
+{
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitPack();
+  memcpy(header->GetPackPointer(), message->GetPackPointer(), header->GetPackSize());
+  header->Unpack();
+  igtl::MessageBase::Pointer buffer = igtl::MessageBase::New();
+  buffer->SetMessageHeader(header);
+  buffer->AllocateBuffer();
+  memcpy(buffer->GetBufferBodyPointer(), message->GetPackBodyPointer(), buffer->GetBufferBodySize());
+  return buffer;
+}
+
+int main(int argc, char * argv [] )
+{
+  srand(12345);
+  int numberOfFailures = 0;
+
+  // Values that are not exactly representable in decimal, signed zeros, denormals and infinities
+  std::vector<float> source(40 + 4);
+  for (size_t i = 0; i < source.size(); ++i)
+    {
+    source[i] = GetRandomValue();
+    }
+  source[1] = -0.0f;
+  source[2] = 1e-40f;
+  source[5] = 3.0e38f;
+  source[7] = -std::numeric_limits<float>::infinity();
+
+  // Counts cover the vector loops and every length of the scalar tail of the SSE2 (8 values)
+  // and AVX2 (16 values) kernels. Offsets make loads and stores unaligned.
+  for (int implementation = vtkIGTLMatrixConverter::IMPLEMENTATION_SCALAR;
+    implementation < vtkIGTLMatrixConverter::IMPLEMENTATION_LAST; ++implementation)
+    {
+    if (!vtkIGTLMatrixConverter::IsImplementationAvailable(implementation))
+      {
+      std::cout << vtkIGTLMatrixConverter::GetImplementationName(implementation) << " is not available, skipped" << std::endl;
+      continue;
+      }
+    for (size_t offset = 0; offset < 4; ++offset)
+      {
+      for (size_t count = 0; count <= 40; ++count)
+        {
+        // Guard values after the end detect writes past count
+        std::vector<double> expected(count + 2, -12345.0);
+        std::vector<double> actual(count + 2 + offset, -12345.0);
+        ReferenceConvert(&source[offset], &expected[0], count);
+        if (!vtkIGTLMatrixConverter::ConvertFloatToDouble(&source[offset], &actual[offset], count, implementation)
+          || memcmp(&actual[offset], &expected[0], expected.size() * sizeof(double)) != 0)
+          {
+          std::cout << "FAILURE: " << vtkIGTLMatrixConverter::GetImplementationName(implementation)
+                    << " output differs from the reference for " << count << " values at offset " << offset << std::endl;
+          numberOfFailures++;
+          }
+        }
+      }
+    }
+
+  // Matrices of several tools, converted by the selected implementation
+  const int numberOfMatrices = 5;
+  std::vector<float> matrices(16 * numberOfMatrices);
+  for (size_t i = 0; i < matrices.size(); ++i)
+    {
+    matrices[i] = GetRandomValue();
+    }
+  std::vector<double> expectedMatrices(matrices.size());
+  ReferenceConvert(&matrices[0], &expectedMatrices[0], matrices.size());
+  for (int numberOfConvertedMatrices = 0; numberOfConvertedMatrices <= numberOfMatrices; ++numberOfConvertedMatrices)
+    {
+    std::vector<double> actualMatrices(matrices.size(), 0.0);
+    if (!vtkIGTLMatrixConverter::ConvertMatrices(&matrices[0], &actualMatrices[0], numberOfConvertedMatrices)
+      || memcmp(&actualMatrices[0], &expectedMatrices[0], 16 * numberOfConvertedMatrices * sizeof(double)) != 0
+      || (numberOfConvertedMatrices < numberOfMatrices && actualMatrices[16 * numberOfConvertedMatrices] != 0.0))
+      {
+      std::cout << "FAILURE: conversion of " << numberOfConvertedMatrices << " matrices" << std::endl;
+      numberOfFailures++;
+      }
+    }
+  if (vtkIGTLMatrixConverter::ConvertMatrices(&matrices[0], &expectedMatrices[0], -1)
+    || vtkIGTLMatrixConverter::ConvertFloatToDouble(&matrices[0], &expectedMatrices[0], 16, vtkIGTLMatrixConverter::IMPLEMENTATION_LAST))
+    {
+    std::cout << "FAILURE: invalid count or implementation is accepted" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Conversion into a VTK matrix, in row-major order
+  vtkSmartPointer<vtkMatrix4x4> vtkMatrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  unsigned long matrixTime = vtkMatrix->GetMTime();
+  vtkIGTLMatrixConverter::ConvertMatrix(&matrices[16], vtkMatrix);
+  for (int i = 0; i < 16; ++i)
+    {
+    if (vtkMatrix->GetElement(i / 4, i % 4) != static_cast<double>(matrices[16 + i]))
+      {
+      std::cout << "FAILURE: element " << i / 4 << ", " << i % 4 << " of the VTK matrix is "
+                << vtkMatrix->GetElement(i / 4, i % 4) << ", expected " << matrices[16 + i] << std::endl;
+      numberOfFailures++;
+      break;
+      }
+    }
+  if (vtkMatrix->GetMTime() <= matrixTime)
+    {
+    std::cout << "FAILURE: VTK matrix is not modified by the conversion" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A received TDATA message gathers the matrices of all tools into one buffer before the conversion.
+  // TDATA carries the upper 3 rows, the last row is always 0, 0, 0, 1.
+  igtl::TrackingDataMessage::Pointer message = igtl::TrackingDataMessage::New();
+  message->SetDeviceName("Tracker");
+  for (int tool = 0; tool < numberOfMatrices; ++tool)
+    {
+    float* toolMatrix = &matrices[16 * tool];
+    toolMatrix[12] = 0.0f;
+    toolMatrix[13] = 0.0f;
+    toolMatrix[14] = 0.0f;
+    toolMatrix[15] = 1.0f;
+    igtl::Matrix4x4 matrix;
+    memcpy(matrix, toolMatrix, sizeof(matrix));
+    igtl::TrackingDataElement::Pointer element = igtl::TrackingDataElement::New();
+    element->SetName(tool % 2 ? "Needle" : "Probe");
+    element->SetType(igtl::TrackingDataElement::TYPE_6D);
+    element->SetMatrix(matrix);
+    message->AddTrackingDataElement(element);
+    }
+  message->Pack();
+  vtkSmartPointer<vtkIGTLTrackingDataDevice> device = vtkSmartPointer<vtkIGTLTrackingDataDevice>::New();
+  if (!device->ReceiveIGTLMessage(ToReceivedBuffer(message.GetPointer()), true)
+    || device->GetNumberOfTools() != numberOfMatrices)
+    {
+    std::cout << "FAILURE: TDATA message is not received" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    ReferenceConvert(&matrices[0], &expectedMatrices[0], matrices.size());
+    if (memcmp(device->GetToolMatrices(), &expectedMatrices[0], expectedMatrices.size() * sizeof(double)) != 0)
+      {
+      std::cout << "FAILURE: tool matrices of the received TDATA message differ from the sent matrices" << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: all implementations match the reference conversion" << std::endl;
+  return EXIT_SUCCESS;
+}
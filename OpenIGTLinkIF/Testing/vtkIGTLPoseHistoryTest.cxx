@@ -0,0 +1,162 @@
+// IF module includes
+#include "vtkIGTLPoseHistory.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// Rotation about the z axis and translation along x
+static void SetPose(vtkMatrix4x4* matrix, double angle, double x)
+{
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  transform->Translate(x, 0.0, 0.0);
+  transform->RotateZ(angle);
+  matrix->DeepCopy(transform->GetMatrix());
+}
+
+static bool CheckPose(vtkMatrix4x4* matrix, double angle, double x, const char* description)
+{
+  vtkSmartPointer<vtkMatrix4x4> expected = vtkSmartPointer<vtkMatrix4x4>::New();
+  SetPose(expected, angle, x);
+  for (int row = 0; row < 4; ++row)
+    {
+    for (int column = 0; column < 4; ++column)
+      {
+      if (fabs(matrix->GetElement(row, column) - expected->GetElement(row, column)) > 1e-9)
+        {
+        std::cout << "FAILURE: " << description << ": element " << row << ", " << column << " is "
+                  << matrix->GetElement(row, column) << ", expected " << expected->GetElement(row, column) << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLPoseHistory> history = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  // Empty history
+  if (history->GetNumberOfPoses() != 0 || history->GetPoseAtTime(0.0, matrix))
+    {
+    std::cout << "FAILURE: pose found in an empty history" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Poses at 1, 2 and 3 s: 0, 90 and 120 degrees about z
+  SetPose(matrix, 0.0, 0.0);
+  history->AddPose(1.0, matrix);
+  SetPose(matrix, 90.0, 10.0);
+  history->AddPose(2.0, matrix);
+  SetPose(matrix, 120.0, 20.0);
+  history->AddPose(3.0, matrix);
+  if (history->GetNumberOfPoses() != 3 || history->GetOldestTimestamp() != 1.0 || history->GetNewestTimestamp() != 3.0)
+    {
+    std::cout << "FAILURE: unexpected history range" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Lookup of the received poses, between them and outside the history
+  numberOfFailures += (history->GetPoseAtTime(1.0, matrix) && CheckPose(matrix, 0.0, 0.0, "oldest pose")) ? 0 : 1;
+  numberOfFailures += (history->GetPoseAtTime(3.0, matrix) && CheckPose(matrix, 120.0, 20.0, "newest pose")) ? 0 : 1;
+  // SLERP rotates at constant angular velocity and translation is linear
+  numberOfFailures += (history->GetPoseAtTime(1.5, matrix) && CheckPose(matrix, 45.0, 5.0, "middle of first interval")) ? 0 : 1;
+  numberOfFailures += (history->GetPoseAtTime(1.25, matrix) && CheckPose(matrix, 22.5, 2.5, "quarter of first interval")) ? 0 : 1;
+  numberOfFailures += (history->GetPoseAtTime(2.5, matrix) && CheckPose(matrix, 105.0, 15.0, "middle of second interval")) ? 0 : 1;
+  if (history->GetPoseAtTime(0.999, matrix) || history->GetPoseAtTime(3.001, matrix))
+    {
+    std::cout << "FAILURE: pose found outside the history" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Out of order and repeated time stamps
+  SetPose(matrix, 0.0, 100.0);
+  if (history->AddPose(2.5, matrix) || history->GetNumberOfPoses() != 3)
+    {
+    std::cout << "FAILURE: a pose older than the newest pose was added" << std::endl;
+    numberOfFailures++;
+    }
+  SetPose(matrix, 150.0, 30.0);
+  if (!history->AddPose(3.0, matrix) || history->GetNumberOfPoses() != 3
+    || !history->GetPoseAtTime(3.0, matrix) || !CheckPose(matrix, 150.0, 30.0, "replaced newest pose"))
+    {
+    std::cout << "FAILURE: a pose with the time stamp of the newest pose did not replace it" << std::endl;
+    numberOfFailures++;
+    }
+
+  // SLERP takes the shorter arc when the quaternions have opposite signs
+  vtkSmartPointer<vtkIGTLPoseHistory> signHistory = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+  const double translation[3] = { 0.0, 0.0, 0.0 };
+  const double identity[4] = { 1.0, 0.0, 0.0, 0.0 };
+  double halfAngle = vtkMath::RadiansFromDegrees(60.0) / 2.0;
+  const double negated[4] = { -cos(halfAngle), 0.0, 0.0, -sin(halfAngle) };
+  signHistory->AddPose(0.0, translation, identity);
+  signHistory->AddPose(1.0, translation, negated);
+  numberOfFailures += (signHistory->GetPoseAtTime(0.5, matrix) && CheckPose(matrix, 30.0, 0.0, "shorter arc")) ? 0 : 1;
+
+  // Scaling of the added matrix is removed
+  vtkSmartPointer<vtkIGTLPoseHistory> scaleHistory = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+  SetPose(matrix, 30.0, 5.0);
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      matrix->SetElement(row, column, matrix->GetElement(row, column) * (column + 2));
+      }
+    }
+  scaleHistory->AddPose(0.0, matrix);
+  numberOfFailures += (scaleHistory->GetPoseAtTime(0.0, matrix) && CheckPose(matrix, 30.0, 5.0, "scaled pose")) ? 0 : 1;
+
+  // When the ring buffer is full, the oldest poses are overwritten
+  vtkSmartPointer<vtkIGTLPoseHistory> ringHistory = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+  ringHistory->SetCapacity(4);
+  for (int i = 0; i < 10; ++i)
+    {
+    SetPose(matrix, i, i);
+    ringHistory->AddPose(i, matrix);
+    }
+  if (ringHistory->GetNumberOfPoses() != 4 || ringHistory->GetOldestTimestamp() != 6.0
+    || ringHistory->GetNewestTimestamp() != 9.0 || ringHistory->GetPoseAtTime(5.5, matrix))
+    {
+    std::cout << "FAILURE: the ring buffer does not keep the newest poses" << std::endl;
+    numberOfFailures++;
+    }
+  for (int i = 0; i < 4; ++i)
+    {
+    double timestamp = 0.0;
+    double poseTranslation[3];
+    double quaternion[4];
+    if (!ringHistory->GetPose(i, timestamp, poseTranslation, quaternion) || timestamp != 6.0 + i
+      || fabs(poseTranslation[0] - (6.0 + i)) > 1e-9)
+      {
+      std::cout << "FAILURE: pose " << i << " of the ring buffer is out of order" << std::endl;
+      numberOfFailures++;
+      }
+    }
+  // Binary search across the wrap-around of the ring buffer
+  numberOfFailures += (ringHistory->GetPoseAtTime(7.5, matrix) && CheckPose(matrix, 7.5, 7.5, "wrapped interval")) ? 0 : 1;
+
+  ringHistory->Clear();
+  if (ringHistory->GetNumberOfPoses() != 0 || ringHistory->GetPoseAtTime(9.0, matrix))
+    {
+    std::cout << "FAILURE: poses remain after Clear" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: pose history lookup and interpolation" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// IF module includes
+#include "vtkIGTLPoseHistory.h"
+#include "vtkIGTLPosePredictor.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// The tool moves along x at 100 mm/s and rotates about z at 90 deg/s
+static const double Speed = 100.0;
+static const double AngularSpeed = 90.0;
+
+// Pose of the tool at the given time, with the axes scaled by 2, 3 and 4
+static void GetPose(double time, vtkMatrix4x4* matrix)
+{
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  transform->Translate(Speed * time, 0.0, 0.0);
+  transform->RotateZ(AngularSpeed * time);
+  transform->Scale(2.0, 3.0, 4.0);
+  matrix->DeepCopy(transform->GetMatrix());
+}
+
+static bool CheckPose(vtkMatrix4x4* matrix, double time, double x, const char* description)
+{
+  vtkSmartPointer<vtkMatrix4x4> expected = vtkSmartPointer<vtkMatrix4x4>::New();
+  GetPose(time, expected);
+  expected->SetElement(0, 3, x);
+  for (int row = 0; row < 4; ++row)
+    {
+    for (int column = 0; column < 4; ++column)
+      {
+      if (fabs(matrix->GetElement(row, column) - expected->GetElement(row, column)) > 1e-6)
+        {
+        std::cout << "FAILURE: " << description << ": element " << row << ", " << column << " is "
+                  << matrix->GetElement(row, column) << ", expected " << expected->GetElement(row, column) << std::endl;
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+
+  // Poses every 10 ms from 0 to 100 ms
+  vtkSmartPointer<vtkIGTLPoseHistory> history = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int i = 0; i <= 10; ++i)
+    {
+    GetPose(0.01 * i, matrix);
+    history->AddPose(0.01 * i, matrix);
+    }
+
+  vtkSmartPointer<vtkIGTLPosePredictor> predictor = vtkSmartPointer<vtkIGTLPosePredictor>::New();
+  predictor->SetPredictionHorizon(0.02);
+
+  // Empty history
+  vtkSmartPointer<vtkIGTLPoseHistory> emptyHistory = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+  if (predictor->Update(emptyHistory, 0.0, matrix))
+    {
+    std::cout << "FAILURE: prediction from an empty history" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Updated 30 ms after the newest pose: extrapolated by the latency and the horizon, scaling is kept
+  GetPose(0.1, matrix);
+  if (!predictor->Update(history, 0.13, matrix) || fabs(predictor->GetLastLatency() - 0.03) > 1e-9)
+    {
+    std::cout << "FAILURE: latency of the newest pose is " << predictor->GetLastLatency() << ", expected 0.03" << std::endl;
+    numberOfFailures++;
+    }
+  numberOfFailures += CheckPose(matrix, 0.15, Speed * 0.15, "pose extrapolated by the latency") ? 0 : 1;
+
+  // Latencies that are negative or too long come from unsynchronized clocks, only the horizon is used
+  GetPose(0.1, matrix);
+  predictor->Update(history, 100.0, matrix);
+  if (predictor->GetLastLatency() != -1.0)
+    {
+    std::cout << "FAILURE: a latency of 100 s was accepted" << std::endl;
+    numberOfFailures++;
+    }
+  numberOfFailures += CheckPose(matrix, 0.12, Speed * 0.12, "pose with a too long latency") ? 0 : 1;
+  GetPose(0.1, matrix);
+  predictor->Update(history, 0.05, matrix);
+  numberOfFailures += (predictor->GetLastLatency() == -1.0 && CheckPose(matrix, 0.12, Speed * 0.12, "pose with a negative latency")) ? 0 : 1;
+
+  // The translation offset is clamped
+  predictor->SetMaximumTranslationOffset(1.0);
+  GetPose(0.1, matrix);
+  predictor->Update(history, 0.13, matrix);
+  numberOfFailures += CheckPose(matrix, 0.15, Speed * 0.1 + 1.0, "clamped translation") ? 0 : 1;
+  predictor->SetMaximumTranslationOffset(20.0);
+
+  // Prediction error: constant velocity is predicted exactly, showing the newest pose lags by the horizon
+  vtkSmartPointer<vtkIGTLPoseHistory> streamHistory = vtkSmartPointer<vtkIGTLPoseHistory>::New();
+  for (int i = 0; i <= 30; ++i)
+    {
+    double time = 0.01 * i;
+    GetPose(time, matrix);
+    streamHistory->AddPose(time, matrix);
+    if (i == 5)
+      {
+      // Predictions from the first poses have no velocity estimate yet
+      predictor->ResetPredictionError();
+      }
+    predictor->Update(streamHistory, time, matrix);
+    }
+  if (predictor->GetNumberOfErrorSamples() < 20 || predictor->GetTranslationErrorRMS() > 1e-6
+    || predictor->GetRotationErrorRMS() > 1e-4 || fabs(predictor->GetUncompensatedTranslationErrorRMS() - Speed * 0.02) > 1e-6
+    || fabs(predictor->GetUncompensatedRotationErrorRMS() - AngularSpeed * 0.02) > 1e-4)
+    {
+    std::cout << "FAILURE: prediction error of " << predictor->GetNumberOfErrorSamples() << " samples is "
+              << predictor->GetTranslationErrorRMS() << " mm, " << predictor->GetRotationErrorRMS()
+              << " deg, without prediction " << predictor->GetUncompensatedTranslationErrorRMS() << " mm, "
+              << predictor->GetUncompensatedRotationErrorRMS() << " deg" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: poses are extrapolated by the measured latency" << std::endl;
+  return EXIT_SUCCESS;
+}
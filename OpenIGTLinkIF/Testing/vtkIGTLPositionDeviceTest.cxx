@@ -0,0 +1,194 @@
+//OpenIGTLink includes
+#include "igtlMessageHeader.h"
+#include "igtlPositionMessage.h"
+#include "igtlQuaternionTrackingDataMessage.h"
+
+// IF module includes
+#include "vtkIGTLPositionDevice.h"
+#include "vtkIGTLQuaternionTrackingDataDevice.h"
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// POSITION and QTDATA messages packed by a device are unpacked by another device,
+// as the OpenIGTLinkIO connector does with a received header and body.
+
+static igtl::MessageBase::Pointer ToReceivedBuffer(igtl::MessageBase::Pointer message)
+{
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitPack();
+  memcpy(header->GetPackPointer(), message->GetPackPointer(), header->GetPackSize());
+  header->Unpack();
+  igtl::MessageBase::Pointer buffer = igtl::MessageBase::New();
+  buffer->SetMessageHeader(header);
+  buffer->AllocateBuffer();
+  memcpy(buffer->GetBufferBodyPointer(), message->GetPackBodyPointer(), buffer->GetBufferBodySize());
+  return buffer;
+}
+
+static void GetPose(double angle, double x, double y, double z, vtkMatrix4x4* matrix)
+{
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  transform->Translate(x, y, z);
+  transform->RotateWXYZ(angle, 1.0, 2.0, 3.0);
+  matrix->DeepCopy(transform->GetMatrix());
+}
+
+static bool IsEqual(const double* elements, vtkMatrix4x4* expected, const char* description)
+{
+  for (int i = 0; i < 16; ++i)
+    {
+    // Positions and quaternions are sent as 32 bit floats
+    if (fabs(elements[i] - expected->GetElement(i / 4, i % 4)) > 1e-4)
+      {
+      std::cout << "FAILURE: " << description << ": element " << i / 4 << ", " << i % 4 << " is " << elements[i]
+                << ", expected " << expected->GetElement(i / 4, i % 4) << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+static bool CheckPositionRoundTrip(vtkMatrix4x4* matrix, vtkMatrix4x4* expected, const char* description)
+{
+  vtkSmartPointer<vtkIGTLPositionDevice> sender = vtkSmartPointer<vtkIGTLPositionDevice>::New();
+  sender->SetDeviceName("Pointer");
+  sender->SetMatrix(matrix);
+  igtl::MessageBase::Pointer buffer = ToReceivedBuffer(sender->GetIGTLMessage());
+
+  vtkSmartPointer<vtkIGTLPositionDevice> receiver = vtkSmartPointer<vtkIGTLPositionDevice>::New();
+  if (strcmp(buffer->GetDeviceType(), "POSITION") != 0 || strcmp(buffer->GetDeviceName(), "Pointer") != 0
+    || !receiver->ReceiveIGTLMessage(buffer, true))
+    {
+    std::cout << "FAILURE: " << description << ": POSITION message was not unpacked" << std::endl;
+    return false;
+    }
+  if (fabs(receiver->GetTimestamp() - vtkTimerLog::GetUniversalTime()) > 10.0)
+    {
+    std::cout << "FAILURE: " << description << ": time stamp " << receiver->GetTimestamp() << " is not the send time" << std::endl;
+    return false;
+    }
+  vtkSmartPointer<vtkMatrix4x4> received = vtkSmartPointer<vtkMatrix4x4>::New();
+  receiver->GetMatrix(received);
+  return IsEqual(&received->Element[0][0], expected, description);
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  vtkSmartPointer<vtkMatrix4x4> expected = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  // POSITION: rotations, including a half turn where the w component of the quaternion is 0
+  GetPose(30.0, 1.5, -2.25, 100.0, matrix);
+  numberOfFailures += CheckPositionRoundTrip(matrix, matrix, "rotated pose") ? 0 : 1;
+  GetPose(180.0, 0.0, 0.0, 0.0, matrix);
+  numberOfFailures += CheckPositionRoundTrip(matrix, matrix, "half turn") ? 0 : 1;
+  GetPose(-90.0, -10.0, 20.0, -30.0, matrix);
+  numberOfFailures += CheckPositionRoundTrip(matrix, matrix, "negative rotation") ? 0 : 1;
+
+  // POSITION carries rigid transforms only, scaling is not sent
+  GetPose(45.0, 5.0, 6.0, 7.0, expected);
+  matrix->DeepCopy(expected);
+  for (int row = 0; row < 3; ++row)
+    {
+    for (int column = 0; column < 3; ++column)
+      {
+      matrix->SetElement(row, column, expected->GetElement(row, column) * 2.0);
+      }
+    }
+  numberOfFailures += CheckPositionRoundTrip(matrix, expected, "scaled pose") ? 0 : 1;
+
+  // A POSITION message without orientation gives the identity rotation
+  igtl::PositionMessage::Pointer positionOnlyMessage = igtl::PositionMessage::New();
+  positionOnlyMessage->SetDeviceName("Pointer");
+  positionOnlyMessage->SetPackType(igtl::PositionMessage::POSITION_ONLY);
+  positionOnlyMessage->SetPosition(1.0f, 2.0f, 3.0f);
+  positionOnlyMessage->Pack();
+  vtkSmartPointer<vtkIGTLPositionDevice> positionOnlyReceiver = vtkSmartPointer<vtkIGTLPositionDevice>::New();
+  expected->Identity();
+  expected->SetElement(0, 3, 1.0);
+  expected->SetElement(1, 3, 2.0);
+  expected->SetElement(2, 3, 3.0);
+  if (!positionOnlyReceiver->ReceiveIGTLMessage(ToReceivedBuffer(positionOnlyMessage.GetPointer()), true))
+    {
+    std::cout << "FAILURE: POSITION message without orientation was not unpacked" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    positionOnlyReceiver->GetMatrix(matrix);
+    numberOfFailures += IsEqual(&matrix->Element[0][0], expected, "position only") ? 0 : 1;
+    }
+
+  // QTDATA: names, types and poses of all tools
+  const int numberOfTools = 3;
+  const char* toolNames[numberOfTools] = { "Probe", "Needle", "Reference" };
+  const int toolTypes[numberOfTools] = { igtl::QuaternionTrackingDataElement::TYPE_6D,
+                                         igtl::QuaternionTrackingDataElement::TYPE_5D,
+                                         igtl::QuaternionTrackingDataElement::TYPE_TRACKER };
+  vtkSmartPointer<vtkMatrix4x4> toolMatrices[numberOfTools];
+  vtkSmartPointer<vtkIGTLQuaternionTrackingDataDevice> sender = vtkSmartPointer<vtkIGTLQuaternionTrackingDataDevice>::New();
+  sender->SetDeviceName("Tracker");
+  for (int i = 0; i < numberOfTools; ++i)
+    {
+    toolMatrices[i] = vtkSmartPointer<vtkMatrix4x4>::New();
+    GetPose(60.0 * i + 10.0, 10.0 * i, -5.0 * i, 2.5 * i, toolMatrices[i]);
+    sender->AddTool(toolNames[i], toolTypes[i], &toolMatrices[i]->Element[0][0]);
+    }
+  igtl::MessageBase::Pointer buffer = ToReceivedBuffer(sender->GetIGTLMessage());
+  vtkSmartPointer<vtkIGTLQuaternionTrackingDataDevice> receiver = vtkSmartPointer<vtkIGTLQuaternionTrackingDataDevice>::New();
+  if (strcmp(buffer->GetDeviceType(), "QTDATA") != 0 || !receiver->ReceiveIGTLMessage(buffer, true)
+    || receiver->GetNumberOfTools() != numberOfTools)
+    {
+    std::cout << "FAILURE: QTDATA message was not unpacked" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    for (int i = 0; i < numberOfTools; ++i)
+      {
+      if (strcmp(receiver->GetToolName(i), toolNames[i]) != 0 || receiver->GetToolType(i) != toolTypes[i]
+        || receiver->GetToolTypes()[i] != toolTypes[i] || strcmp(receiver->GetToolNames()[i], toolNames[i]) != 0)
+        {
+        std::cout << "FAILURE: QTDATA tool " << i << " is " << receiver->GetToolName(i) << " of type "
+                  << receiver->GetToolType(i) << ", expected " << toolNames[i] << " of type " << toolTypes[i] << std::endl;
+        numberOfFailures++;
+        }
+      numberOfFailures += IsEqual(receiver->GetToolMatrices() + 16 * i, toolMatrices[i], toolNames[i]) ? 0 : 1;
+      }
+    }
+
+  // STT_QTDATA carries the requested resolution and coordinate system, RTS_QTDATA the answer
+  sender->SetResolution(50);
+  sender->SetCoordinateName("RAS");
+  if (!receiver->ReceiveIGTLMessage(ToReceivedBuffer(sender->GetIGTLMessage(igtlio::Device::MESSAGE_PREFIX_START)), true)
+    || receiver->GetRequestedResolution() != 50 || receiver->GetRequestedCoordinateName() != "RAS")
+    {
+    std::cout << "FAILURE: STT_QTDATA request is not received" << std::endl;
+    numberOfFailures++;
+    }
+  receiver->SetRequestResponseStatus(igtl::RTSQuaternionTrackingDataMessage::STATUS_SUCCESS);
+  if (!sender->ReceiveIGTLMessage(ToReceivedBuffer(receiver->GetIGTLMessage(igtlio::Device::MESSAGE_PREFIX_RTS)), true)
+    || sender->GetResponseStatus() != igtl::RTSQuaternionTrackingDataMessage::STATUS_SUCCESS)
+    {
+    std::cout << "FAILURE: RTS_QTDATA response is not received" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: POSITION and QTDATA messages are unpacked as they were packed" << std::endl;
+  return EXIT_SUCCESS;
+}
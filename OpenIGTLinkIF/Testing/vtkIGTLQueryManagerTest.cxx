@@ -0,0 +1,205 @@
+// IF module includes
+#include "vtkIGTLQueryManager.h"
+#include "vtkMRMLIGTLQueryNode.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+static vtkSmartPointer<vtkMRMLIGTLQueryNode> CreateQuery(const char* type, const char* deviceName, int queryType,
+                                                         double timeStamp, double timeOut)
+{
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> query = vtkSmartPointer<vtkMRMLIGTLQueryNode>::New();
+  query->SetIGTLName(type);
+  query->SetIGTLDeviceName(deviceName);
+  query->SetQueryType(queryType);
+  query->SetTimeStamp(timeStamp);
+  query->SetTimeOut(timeOut);
+  return query;
+}
+
+static bool IsQueryList(const vtkIGTLQueryManager::QueryListType& queries, vtkMRMLIGTLQueryNode* first,
+                        vtkMRMLIGTLQueryNode* second, const char* description)
+{
+  size_t expectedSize = (first ? 1 : 0) + (second ? 1 : 0);
+  if (queries.size() != expectedSize || (first && queries[0] != first) || (second && queries[1] != second))
+    {
+    std::cout << "FAILURE: " << description << ": " << queries.size() << " queries, expected " << expectedSize << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLQueryManager> manager = vtkSmartPointer<vtkIGTLQueryManager>::New();
+  vtkIGTLQueryManager::QueryListType queries;
+
+  // A query expires after its timeout, at most one tick (10 ms) late, and never early
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> expiringQuery = CreateQuery("IMAGE", "CT", vtkMRMLIGTLQueryNode::TYPE_GET, 100.0, 0.5);
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> permanentQuery = CreateQuery("IMAGE", "MR", vtkMRMLIGTLQueryNode::TYPE_GET, 100.0, 0.0);
+  manager->AddQuery(expiringQuery);
+  manager->AddQuery(permanentQuery);
+  manager->PopExpiredQueries(100.0, queries);
+  manager->PopExpiredQueries(100.49, queries);
+  numberOfFailures += IsQueryList(queries, NULL, NULL, "query expired before its timeout") ? 0 : 1;
+  manager->PopExpiredQueries(100.515, queries);
+  numberOfFailures += IsQueryList(queries, expiringQuery, NULL, "query expired at its timeout") ? 0 : 1;
+  queries.clear();
+  // Queries without timeout never expire
+  manager->PopExpiredQueries(1e6, queries);
+  if (!queries.empty() || !manager->HasQuery(permanentQuery) || manager->HasQuery(expiringQuery)
+    || manager->GetNumberOfQueries() != 1)
+    {
+    std::cout << "FAILURE: query without timeout expired" << std::endl;
+    numberOfFailures++;
+    }
+  manager->RemoveAllQueries();
+
+  // A timeout longer than one turn of the wheel (256 ticks) is not expired when the wheel passes its slot
+  manager = vtkSmartPointer<vtkIGTLQueryManager>::New();
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> longQuery = CreateQuery("IMAGE", "CT", vtkMRMLIGTLQueryNode::TYPE_GET, 100.0, 5.0);
+  manager->AddQuery(longQuery);
+  double expiryTime = 0.0;
+  for (int i = 0; i <= 600 && expiryTime == 0.0; ++i)
+    {
+    double currentTime = 100.0 + 0.01 * i;
+    manager->PopExpiredQueries(currentTime, queries);
+    if (!queries.empty())
+      {
+      expiryTime = currentTime;
+      }
+    }
+  if (expiryTime < 105.0 || expiryTime > 105.025)
+    {
+    std::cout << "FAILURE: query with 5 s timeout expired at " << expiryTime << ", expected 105" << std::endl;
+    numberOfFailures++;
+    }
+  queries.clear();
+
+  // Queries are expired when the manager is not updated for longer than a turn of the wheel
+  manager->AddQuery(CreateQuery("IMAGE", "CT", vtkMRMLIGTLQueryNode::TYPE_GET, 110.0, 0.5));
+  manager->PopExpiredQueries(110.0, queries);
+  manager->PopExpiredQueries(120.0, queries);
+  if (queries.size() != 1 || manager->GetNumberOfQueries() != 0)
+    {
+    std::cout << "FAILURE: query not expired after a long pause" << std::endl;
+    numberOfFailures++;
+    }
+  queries.clear();
+
+  // Adding a waiting query again restarts its timeout
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> resentQuery = CreateQuery("IMAGE", "CT", vtkMRMLIGTLQueryNode::TYPE_GET, 130.0, 0.5);
+  manager->AddQuery(resentQuery);
+  manager->PopExpiredQueries(130.0, queries);
+  resentQuery->SetTimeStamp(130.4);
+  manager->AddQuery(resentQuery);
+  manager->PopExpiredQueries(130.6, queries);
+  if (!queries.empty() || manager->GetNumberOfQueries() != 1)
+    {
+    std::cout << "FAILURE: query added again expired at its first timeout" << std::endl;
+    numberOfFailures++;
+    }
+  manager->PopExpiredQueries(130.92, queries);
+  numberOfFailures += IsQueryList(queries, resentQuery, NULL, "query added again") ? 0 : 1;
+  queries.clear();
+
+  // Responses match queries of their type and device name, and queries of their type without device name.
+  // GET queries and START/STOP queries are matched separately.
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> namedQuery = CreateQuery("IMAGE", "CT", vtkMRMLIGTLQueryNode::TYPE_GET, 200.0, 10.0);
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> anyNameQuery = CreateQuery("IMAGE", "", vtkMRMLIGTLQueryNode::TYPE_GET, 200.0, 10.0);
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> otherNameQuery = CreateQuery("IMAGE", "MR", vtkMRMLIGTLQueryNode::TYPE_GET, 200.0, 10.0);
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> startQuery = CreateQuery("TDATA", "Tracker", vtkMRMLIGTLQueryNode::TYPE_START, 200.0, 10.0);
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> getQuery = CreateQuery("TDATA", "Tracker", vtkMRMLIGTLQueryNode::TYPE_GET, 200.0, 10.0);
+  manager->AddQuery(namedQuery);
+  manager->AddQuery(anyNameQuery);
+  manager->AddQuery(otherNameQuery);
+  manager->AddQuery(startQuery);
+  manager->AddQuery(getQuery);
+  manager->PopMatchingQueries("IMAGE", "CT", false, queries);
+  numberOfFailures += IsQueryList(queries, namedQuery, anyNameQuery, "IMAGE CT response") ? 0 : 1;
+  queries.clear();
+  manager->PopMatchingQueries("IMAGE", "CT", false, queries);
+  numberOfFailures += IsQueryList(queries, NULL, NULL, "second IMAGE CT response") ? 0 : 1;
+  manager->PopMatchingQueries("LBMETA", "MR", false, queries);
+  numberOfFailures += IsQueryList(queries, NULL, NULL, "response of another type") ? 0 : 1;
+  manager->PopMatchingQueries("TDATA", "Tracker", false, queries);
+  numberOfFailures += IsQueryList(queries, getQuery, NULL, "TDATA message") ? 0 : 1;
+  queries.clear();
+  manager->PopMatchingQueries("TDATA", "Tracker", true, queries);
+  numberOfFailures += IsQueryList(queries, startQuery, NULL, "RTS_TDATA response") ? 0 : 1;
+  queries.clear();
+
+  // Cancelled queries are neither matched nor expired
+  if (!manager->RemoveQuery(otherNameQuery) || manager->RemoveQuery(otherNameQuery) || manager->HasQuery(otherNameQuery)
+    || manager->GetNumberOfQueries() != 0)
+    {
+    std::cout << "FAILURE: query could not be cancelled once" << std::endl;
+    numberOfFailures++;
+    }
+  manager->PopMatchingQueries("IMAGE", "MR", false, queries);
+  manager->PopExpiredQueries(300.0, queries);
+  numberOfFailures += IsQueryList(queries, NULL, NULL, "cancelled query") ? 0 : 1;
+
+  // A deleted query node is dropped without being returned
+  vtkSmartPointer<vtkMRMLIGTLQueryNode> deletedQuery = CreateQuery("STRING", "Message", vtkMRMLIGTLQueryNode::TYPE_GET, 300.0, 10.0);
+  manager->AddQuery(deletedQuery);
+  deletedQuery = NULL;
+  manager->PopMatchingQueries("STRING", "Message", false, queries);
+  if (!queries.empty() || manager->GetNumberOfQueries() != 0)
+    {
+    std::cout << "FAILURE: deleted query node was matched" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Many queries: the hash table grows and each response matches its own query
+  const int numberOfQueries = 1000;
+  std::vector< vtkSmartPointer<vtkMRMLIGTLQueryNode> > manyQueries;
+  for (int i = 0; i < numberOfQueries; ++i)
+    {
+    std::ostringstream name;
+    name << "Device" << i;
+    manyQueries.push_back(CreateQuery("IMAGE", name.str().c_str(), vtkMRMLIGTLQueryNode::TYPE_GET, 400.0, 1.0 + 0.01 * i));
+    manager->AddQuery(manyQueries[i]);
+    }
+  for (int i = 0; i < numberOfQueries; i += 2)
+    {
+    manager->PopMatchingQueries("IMAGE", manyQueries[i]->GetIGTLDeviceName(), false, queries);
+    if (queries.size() != 1 || queries[0] != manyQueries[i])
+      {
+      std::cout << "FAILURE: response " << i << " matched " << queries.size() << " queries" << std::endl;
+      numberOfFailures++;
+      break;
+      }
+    queries.clear();
+    }
+  // The other queries expire in order of their timeout
+  manager->PopExpiredQueries(400.0, queries);
+  for (int i = 1; i < numberOfQueries; i += 2)
+    {
+    manager->PopExpiredQueries(401.0 + 0.01 * i + 0.015, queries);
+    }
+  bool inOrder = (queries.size() == static_cast<size_t>(numberOfQueries / 2));
+  for (size_t i = 0; inOrder && i < queries.size(); ++i)
+    {
+    inOrder = (queries[i] == manyQueries[2 * i + 1]);
+    }
+  if (!inOrder || manager->GetNumberOfQueries() != 0)
+    {
+    std::cout << "FAILURE: " << queries.size() << " queries expired, expected " << numberOfQueries / 2 << " in order of their timeout" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: query expiry, matching and cancellation" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,291 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+
+// IF module includes
+#include "vtkIGTLRemoteImageCatalog.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+
+// MRML includes
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// A server connector serves the volumes of its scene. The catalog of a client connector lists
+// them with GET_IMGMETA, fetches an opened image right away and prefetches the following
+// images, at most MaximumNumberOfFetches at a time.
+
+static const int ServerPort = 18952;
+static const int NumberOfImages = 5;
+static const int PrefetchCount = 3;
+
+struct FetchEventCounts
+{
+  int Fetched;
+  int Failed;
+};
+
+static void onFetchEventFunc(vtkObject* caller, unsigned long eid, void* clientdata, void *calldata)
+{
+  FetchEventCounts* counts = static_cast<FetchEventCounts*>(clientdata);
+  if (eid == vtkIGTLRemoteImageCatalog::ImageFetchedEvent)
+    {
+    counts->Fetched++;
+    }
+  else
+    {
+    counts->Failed++;
+    }
+}
+
+static vtkSmartPointer<vtkMRMLScalarVolumeNode> AddVolume(vtkMRMLScene* scene, const char* name)
+{
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(8, 6, 1);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> volumeNode = vtkSmartPointer<vtkMRMLScalarVolumeNode>::New();
+  volumeNode->SetName(name);
+  volumeNode->SetAndObserveImageData(image);
+  scene->AddNode(volumeNode);
+  return volumeNode;
+}
+
+static void Process(vtkMRMLIGTLConnectorNode* serverNode, vtkMRMLIGTLConnectorNode* clientNode)
+{
+  serverNode->PeriodicProcess();
+  clientNode->PeriodicProcess();
+  igtl::Sleep(5);
+}
+
+// Process until the lists are received. Returns false on timeout.
+static bool WaitForRefresh(vtkIGTLRemoteImageCatalog* catalog, vtkMRMLIGTLConnectorNode* serverNode,
+                           vtkMRMLIGTLConnectorNode* clientNode)
+{
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (catalog->IsRefreshing() && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    Process(serverNode, clientNode);
+    }
+  return !catalog->IsRefreshing();
+}
+
+// Number of the images first..last (catalog indices) with the given status
+static int GetNumberOfImagesWithStatus(vtkIGTLRemoteImageCatalog* catalog, int first, int last, int status)
+{
+  int numberOfImages = 0;
+  for (int i = first; i <= last; ++i)
+    {
+    numberOfImages += (catalog->GetImageStatus(catalog->GetImageDeviceName(i)) == status) ? 1 : 0;
+    }
+  return numberOfImages;
+}
+
+int main(int argc, char * argv [] )
+{
+  vtkSmartPointer<vtkMRMLScene> serverScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> serverNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  serverScene->AddNode(serverNode);
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> serverVolumes[NumberOfImages];
+  for (int i = 0; i < NumberOfImages; ++i)
+    {
+    std::ostringstream name;
+    name << "Image" << i;
+    serverVolumes[i] = AddVolume(serverScene, name.str().c_str());
+    }
+  serverNode->SetServeSceneImages(true);
+  serverNode->SetTypeServer(ServerPort);
+  serverNode->Start();
+  igtl::Sleep(20);
+
+  vtkSmartPointer<vtkMRMLScene> clientScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> clientNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  clientScene->AddNode(clientNode);
+  clientNode->SetTypeClient("localhost", ServerPort);
+  clientNode->Start();
+
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (clientNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected)
+    {
+    Process(serverNode, clientNode);
+    if (vtkTimerLog::GetUniversalTime() - startTime > 5.0)
+      {
+      std::cout << "FAILURE to connect to server" << std::endl;
+      clientNode->Stop();
+      serverNode->Stop();
+      return EXIT_FAILURE;
+      }
+    }
+
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLRemoteImageCatalog> catalog = vtkSmartPointer<vtkIGTLRemoteImageCatalog>::New();
+  catalog->SetConnectorNode(clientNode);
+  catalog->SetPrefetchCount(PrefetchCount);
+  catalog->SetMaximumNumberOfFetches(1);
+  catalog->SetQueryTimeOut(2.0);
+  FetchEventCounts eventCounts = { 0, 0 };
+  vtkSmartPointer<vtkCallbackCommand> fetchCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  fetchCallback->SetCallback(onFetchEventFunc);
+  fetchCallback->SetClientData(&eventCounts);
+  catalog->AddObserver(vtkIGTLRemoteImageCatalog::ImageFetchedEvent, fetchCallback);
+  catalog->AddObserver(vtkIGTLRemoteImageCatalog::ImageFetchFailedEvent, fetchCallback);
+
+  // The lists are requested on the first update, then only after their time to live
+  if (!catalog->Update() || !catalog->IsRefreshing() || !WaitForRefresh(catalog, serverNode, clientNode))
+    {
+    std::cout << "FAILURE: the image list was not received" << std::endl;
+    clientNode->Stop();
+    serverNode->Stop();
+    return EXIT_FAILURE;
+    }
+  if (catalog->GetNumberOfImages() != NumberOfImages || catalog->GetNumberOfLabels() != 0)
+    {
+    std::cout << "FAILURE: " << catalog->GetNumberOfImages() << " images and " << catalog->GetNumberOfLabels()
+              << " label maps listed, expected " << NumberOfImages << " and 0" << std::endl;
+    clientNode->Stop();
+    serverNode->Stop();
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < NumberOfImages; ++i)
+    {
+    const char* deviceName = catalog->GetImageDeviceName(i);
+    vtkMRMLImageMetaListNode::ImageMetaElement element;
+    if (catalog->FindImage(deviceName) != i || !catalog->GetImageMetaElement(i, &element)
+      || element.Size[0] != 8 || element.Size[1] != 6 || element.Size[2] != 1
+      || serverScene->GetFirstNodeByName(deviceName) == NULL || catalog->GetImageStatus(deviceName) != vtkIGTLRemoteImageCatalog::IMAGE_NOT_FETCHED)
+      {
+      std::cout << "FAILURE: image entry " << i << " (" << deviceName << ") does not describe a served volume" << std::endl;
+      numberOfFailures++;
+      }
+    }
+  if (catalog->FindImage("Missing") != -1 || catalog->GetImageDeviceName(NumberOfImages) != NULL)
+    {
+    std::cout << "FAILURE: missing image is listed" << std::endl;
+    numberOfFailures++;
+    }
+  if (catalog->Update() || catalog->IsRefreshing())
+    {
+    std::cout << "FAILURE: the image list was requested again within its time to live" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Opening the first image fetches it right away and prefetches the next PrefetchCount images, one at a time
+  const char* openedName = catalog->GetImageDeviceName(0);
+  if (catalog->OpenImage(openedName) != NULL || catalog->GetImageStatus(openedName) != vtkIGTLRemoteImageCatalog::IMAGE_FETCHING)
+    {
+    std::cout << "FAILURE: the opened image is not requested" << std::endl;
+    numberOfFailures++;
+    }
+  if (GetNumberOfImagesWithStatus(catalog, 1, PrefetchCount, vtkIGTLRemoteImageCatalog::IMAGE_FETCHING) != 1
+    || GetNumberOfImagesWithStatus(catalog, 1, PrefetchCount, vtkIGTLRemoteImageCatalog::IMAGE_QUEUED) != PrefetchCount - 1
+    || GetNumberOfImagesWithStatus(catalog, PrefetchCount + 1, NumberOfImages - 1, vtkIGTLRemoteImageCatalog::IMAGE_NOT_FETCHED)
+       != NumberOfImages - 1 - PrefetchCount)
+    {
+    std::cout << "FAILURE: prefetches are not limited to 1 at a time and " << PrefetchCount << " images" << std::endl;
+    numberOfFailures++;
+    }
+  int maximumNumberOfPrefetches = 0;
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (GetNumberOfImagesWithStatus(catalog, 0, PrefetchCount, vtkIGTLRemoteImageCatalog::IMAGE_FETCHED) < PrefetchCount + 1
+    && vtkTimerLog::GetUniversalTime() - startTime < 10.0)
+    {
+    Process(serverNode, clientNode);
+    int numberOfPrefetches = GetNumberOfImagesWithStatus(catalog, 1, PrefetchCount, vtkIGTLRemoteImageCatalog::IMAGE_FETCHING);
+    maximumNumberOfPrefetches = numberOfPrefetches > maximumNumberOfPrefetches ? numberOfPrefetches : maximumNumberOfPrefetches;
+    }
+  if (GetNumberOfImagesWithStatus(catalog, 0, PrefetchCount, vtkIGTLRemoteImageCatalog::IMAGE_FETCHED) != PrefetchCount + 1
+    || eventCounts.Fetched != PrefetchCount + 1 || eventCounts.Failed != 0 || maximumNumberOfPrefetches > 1)
+    {
+    std::cout << "FAILURE: " << eventCounts.Fetched << " images fetched, " << eventCounts.Failed << " failed, up to "
+              << maximumNumberOfPrefetches << " prefetches at a time, expected " << PrefetchCount + 1 << ", 0 and 1" << std::endl;
+    numberOfFailures++;
+    }
+  if (catalog->GetImageStatus(catalog->GetImageDeviceName(NumberOfImages - 1)) != vtkIGTLRemoteImageCatalog::IMAGE_NOT_FETCHED)
+    {
+    std::cout << "FAILURE: an image beyond the prefetch count was fetched" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A fetched image is a volume of the client scene, returned without a new request when opened again
+  vtkMRMLScalarVolumeNode* fetchedNode = vtkMRMLScalarVolumeNode::SafeDownCast(catalog->GetImageNode(openedName));
+  int dimensions[3] = { 0, 0, 0 };
+  if (fetchedNode && fetchedNode->GetImageData())
+    {
+    fetchedNode->GetImageData()->GetDimensions(dimensions);
+    }
+  if (fetchedNode == NULL || fetchedNode->GetScene() != clientScene.GetPointer() || dimensions[0] != 8 || dimensions[1] != 6)
+    {
+    std::cout << "FAILURE: the fetched image is not a volume of the client scene" << std::endl;
+    numberOfFailures++;
+    }
+  if (catalog->OpenImage(openedName) != fetchedNode || clientNode->GetNumberOfWaitingQueries() != 0)
+    {
+    std::cout << "FAILURE: the fetched image was requested again" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A refresh lists new images, and images updated on the server are fetched again when opened
+  const char* updatedName = catalog->GetImageDeviceName(1);
+  vtkMRMLScalarVolumeNode* updatedVolume = vtkMRMLScalarVolumeNode::SafeDownCast(serverScene->GetFirstNodeByName(updatedName));
+  igtl::Sleep(10);
+  updatedVolume->GetImageData()->Modified();
+  AddVolume(serverScene, "Added");
+  if (!catalog->Refresh() || !WaitForRefresh(catalog, serverNode, clientNode))
+    {
+    std::cout << "FAILURE: the image list was not received again" << std::endl;
+    numberOfFailures++;
+    }
+  if (catalog->GetNumberOfImages() != NumberOfImages + 1 || catalog->FindImage("Added") < 0)
+    {
+    std::cout << "FAILURE: the image added on the server is not listed after a refresh" << std::endl;
+    numberOfFailures++;
+    }
+  if (catalog->GetImageStatus(updatedName) != vtkIGTLRemoteImageCatalog::IMAGE_NOT_FETCHED
+    || catalog->GetImageStatus(openedName) != vtkIGTLRemoteImageCatalog::IMAGE_FETCHED)
+    {
+    std::cout << "FAILURE: only the image updated on the server must be fetched again" << std::endl;
+    numberOfFailures++;
+    }
+
+  // An image that the server does not answer fails after the query timeout
+  catalog->SetQueryTimeOut(0.5);
+  catalog->OpenImage("Missing");
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (catalog->GetImageStatus("Missing") == vtkIGTLRemoteImageCatalog::IMAGE_FETCHING
+    && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    Process(serverNode, clientNode);
+    }
+  if (catalog->GetImageStatus("Missing") != vtkIGTLRemoteImageCatalog::IMAGE_FAILED || eventCounts.Failed != 1)
+    {
+    std::cout << "FAILURE: the request of a missing image did not fail" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Changing the connector clears the catalog
+  catalog->SetConnectorNode(NULL);
+  if (catalog->GetNumberOfImages() != 0 || catalog->GetImageStatus(openedName) != vtkIGTLRemoteImageCatalog::IMAGE_NOT_FETCHED)
+    {
+    std::cout << "FAILURE: the catalog is not cleared with the connector" << std::endl;
+    numberOfFailures++;
+    }
+
+  clientNode->Stop();
+  serverNode->Stop();
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: remote images listed, opened and prefetched within the fetch limit" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+
+// IF module includes
+#include "vtkIGTLSceneImageIndex.h"
+
+// MRML includes
+#include <vtkMRMLLabelMapVolumeNode.h>
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScalarVolumeNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+template <class T>
+static vtkSmartPointer<T> AddVolume(vtkMRMLScene* scene, const char* name, bool withImage = true)
+{
+  vtkSmartPointer<T> volumeNode = vtkSmartPointer<T>::New();
+  volumeNode->SetName(name);
+  if (withImage)
+    {
+    vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+    image->SetDimensions(4, 3, 2);
+    image->AllocateScalars(VTK_SHORT, 1);
+    volumeNode->SetAndObserveImageData(image);
+    }
+  scene->AddNode(volumeNode);
+  return volumeNode;
+}
+
+// Names of the image entries, in order, separated by spaces
+static std::string GetImageNames(vtkIGTLSceneImageIndex* index)
+{
+  std::vector<vtkMRMLImageMetaListNode::ImageMetaElement> elements;
+  index->GetImageMetaElements(elements);
+  std::string names;
+  for (size_t i = 0; i < elements.size(); ++i)
+    {
+    names += (i > 0 ? " " : "") + elements[i].DeviceName;
+    }
+  return names;
+}
+
+static bool IsImageList(vtkIGTLSceneImageIndex* index, const char* expectedNames, const char* description)
+{
+  std::string names = GetImageNames(index);
+  if (names != expectedNames)
+    {
+    std::cout << "FAILURE: " << description << ": images \"" << names << "\", expected \"" << expectedNames << "\"" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+static double GetImageTimeStamp(vtkIGTLSceneImageIndex* index, const std::string& deviceName)
+{
+  std::vector<vtkMRMLImageMetaListNode::ImageMetaElement> elements;
+  index->GetImageMetaElements(elements);
+  for (size_t i = 0; i < elements.size(); ++i)
+    {
+    if (elements[i].DeviceName == deviceName)
+      {
+      return elements[i].TimeStamp;
+      }
+    }
+  return 0.0;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkMRMLScene> scene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkIGTLSceneImageIndex> index = vtkSmartPointer<vtkIGTLSceneImageIndex>::New();
+
+  // Volumes already in the scene are indexed when the scene is set, other nodes are ignored
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> ct = AddVolume<vtkMRMLScalarVolumeNode>(scene, "CT");
+  vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+  transformNode->SetName("Transform");
+  scene->AddNode(transformNode);
+  index->SetScene(scene);
+  if (index->GetScene() != scene.GetPointer() || index->GetNumberOfNodes() != 1 || index->FindVolumeNode("CT") != ct.GetPointer()
+    || index->FindVolumeNode("Transform") != NULL || index->FindVolumeNode("Missing") != NULL || index->FindVolumeNode(NULL) != NULL)
+    {
+    std::cout << "FAILURE: volumes of the scene are not indexed when the scene is set" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Nodes added to the scene are indexed, image volumes and label maps separately
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> mr = AddVolume<vtkMRMLScalarVolumeNode>(scene, "MR");
+  vtkSmartPointer<vtkMRMLLabelMapVolumeNode> label = AddVolume<vtkMRMLLabelMapVolumeNode>(scene, "Segmentation");
+  AddVolume<vtkMRMLScalarVolumeNode>(scene, "Empty", false);
+  if (index->GetNumberOfNodes() != 4 || index->FindVolumeNode("MR") != mr.GetPointer()
+    || index->FindVolumeNode("Segmentation") != label.GetPointer())
+    {
+    std::cout << "FAILURE: " << index->GetNumberOfNodes() << " volumes indexed after NodeAdded, expected 4" << std::endl;
+    numberOfFailures++;
+    }
+  // Volumes without image data are not listed
+  numberOfFailures += IsImageList(index, "CT MR", "added volumes") ? 0 : 1;
+  std::vector<vtkMRMLImageMetaListNode::ImageMetaElement> imageElements;
+  index->GetImageMetaElements(imageElements);
+  if (imageElements.size() != 2 || imageElements[0].Name != "CT" || imageElements[0].Size[0] != 4
+    || imageElements[0].Size[1] != 3 || imageElements[0].Size[2] != 2 || imageElements[0].TimeStamp <= 0.0)
+    {
+    std::cout << "FAILURE: image entry does not describe its volume" << std::endl;
+    numberOfFailures++;
+    }
+  std::vector<vtkMRMLLabelMetaListNode::LabelMetaElement> labelElements;
+  index->GetLabelMetaElements(labelElements);
+  if (labelElements.size() != 1 || labelElements[0].DeviceName != "Segmentation" || labelElements[0].Size[2] != 2)
+    {
+    std::cout << "FAILURE: " << labelElements.size() << " label map entries, expected 1" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Renamed nodes are found by their new name only
+  mr->SetName("MR2");
+  if (index->FindVolumeNode("MR2") != mr.GetPointer() || index->FindVolumeNode("MR") != NULL)
+    {
+    std::cout << "FAILURE: renamed volume is not found by its new name" << std::endl;
+    numberOfFailures++;
+    }
+  numberOfFailures += IsImageList(index, "CT MR2", "renamed volume") ? 0 : 1;
+
+  // Nodes removed from the scene are removed from the index, renamed or not
+  ct->SetName("CT2");
+  scene->RemoveNode(ct);
+  scene->RemoveNode(transformNode);
+  if (index->GetNumberOfNodes() != 3 || index->FindVolumeNode("CT") != NULL || index->FindVolumeNode("CT2") != NULL
+    || index->FindVolumeNode("MR2") != mr.GetPointer())
+    {
+    std::cout << "FAILURE: removed volume remains in the index" << std::endl;
+    numberOfFailures++;
+    }
+  numberOfFailures += IsImageList(index, "MR2", "removed volume") ? 0 : 1;
+
+  // The time stamp changes only when the image data is modified
+  double timeStamp = GetImageTimeStamp(index, "MR2");
+  igtl::Sleep(10);
+  if (GetImageTimeStamp(index, "MR2") != timeStamp)
+    {
+    std::cout << "FAILURE: time stamp of an unmodified image changed" << std::endl;
+    numberOfFailures++;
+    }
+  mr->GetImageData()->Modified();
+  double modifiedTimeStamp = GetImageTimeStamp(index, "MR2");
+  if (modifiedTimeStamp <= timeStamp || GetImageTimeStamp(index, "MR2") != modifiedTimeStamp)
+    {
+    std::cout << "FAILURE: time stamp is not updated once when the image is modified" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Changing the scene rebuilds the index and stops following the previous scene
+  vtkSmartPointer<vtkMRMLScene> otherScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLScalarVolumeNode> us = AddVolume<vtkMRMLScalarVolumeNode>(otherScene, "US");
+  index->SetScene(otherScene);
+  AddVolume<vtkMRMLScalarVolumeNode>(scene, "NotIndexed");
+  if (index->GetNumberOfNodes() != 1 || index->FindVolumeNode("US") != us.GetPointer()
+    || index->FindVolumeNode("MR2") != NULL || index->FindVolumeNode("NotIndexed") != NULL)
+    {
+    std::cout << "FAILURE: index does not follow the new scene only" << std::endl;
+    numberOfFailures++;
+    }
+  index->SetScene(NULL);
+  AddVolume<vtkMRMLScalarVolumeNode>(otherScene, "AfterClear");
+  if (index->GetScene() != NULL || index->GetNumberOfNodes() != 0 || index->FindVolumeNode("US") != NULL)
+    {
+    std::cout << "FAILURE: index is not cleared without scene" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: scene volumes indexed from NodeAdded and NodeRemoved, renames and image updates tracked" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,224 @@
+// IF module includes
+#include "vtkIGTLSubscriptionManager.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static bool IsStatus(vtkIGTLSubscriptionManager* manager, const char* type, const char* deviceName, int expectedStatus,
+                     const char* description)
+{
+  int status = manager->GetSubscriptionStatus(type, deviceName);
+  if (status != expectedStatus)
+    {
+    std::cout << "FAILURE: " << description << ": " << type << " " << deviceName << " is "
+              << vtkIGTLSubscriptionManager::GetStatusAsString(status) << ", expected "
+              << vtkIGTLSubscriptionManager::GetStatusAsString(expectedStatus) << std::endl;
+    return false;
+    }
+  return true;
+}
+
+static bool IsSubscriptionList(const vtkIGTLSubscriptionManager::SubscriptionListType& subscriptions, size_t expectedSize,
+                               const char* description)
+{
+  if (subscriptions.size() != expectedSize)
+    {
+    std::cout << "FAILURE: " << description << ": " << subscriptions.size() << " subscriptions, expected " << expectedSize << std::endl;
+    return false;
+    }
+  return true;
+}
+
+// Push the due streams at currentTime, returns the number of pushed streams
+static int Push(vtkIGTLSubscriptionManager* manager, double currentTime, int& numberOfTrackerPushes)
+{
+  std::vector<vtkIGTLSubscriptionManager::KeyType> keys;
+  manager->PopDueRemoteSubscriptions(currentTime, keys);
+  for (size_t i = 0; i < keys.size(); ++i)
+    {
+    numberOfTrackerPushes += (keys[i].second == "Tracker") ? 1 : 0;
+    }
+  return static_cast<int>(keys.size());
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLSubscriptionManager> manager = vtkSmartPointer<vtkIGTLSubscriptionManager>::New();
+  vtkIGTLSubscriptionManager::SubscriptionListType subscriptions;
+
+  // Subscriptions are pending until popped to send their STT_ message, then wait for the RTS_ message
+  manager->AddSubscription("TDATA", "Tracker", 50, "RAS");
+  manager->AddSubscription("QTDATA", "Tracker", 20, "");
+  numberOfFailures += IsStatus(manager, "TDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_PENDING, "added") ? 0 : 1;
+  manager->PopPendingSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 2, "pending subscriptions") ? 0 : 1;
+  for (size_t i = 0; i < subscriptions.size(); ++i)
+    {
+    if (subscriptions[i].Type == "TDATA" && (subscriptions[i].Resolution != 50 || subscriptions[i].CoordinateName != "RAS"))
+      {
+      std::cout << "FAILURE: STT_TDATA parameters are not kept" << std::endl;
+      numberOfFailures++;
+      }
+    }
+  numberOfFailures += IsStatus(manager, "TDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_SENT, "popped") ? 0 : 1;
+  subscriptions.clear();
+  manager->PopPendingSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 0, "subscriptions popped twice") ? 0 : 1;
+
+  // The RTS_ message accepts or rejects the stream
+  manager->SetSubscriptionStatus("TDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_ACCEPTED);
+  manager->SetSubscriptionStatus("QTDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_REJECTED);
+  numberOfFailures += IsStatus(manager, "TDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_ACCEPTED, "accepted") ? 0 : 1;
+  numberOfFailures += IsStatus(manager, "QTDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_REJECTED, "rejected") ? 0 : 1;
+  if (manager->SetSubscriptionStatus("TDATA", "Other", vtkIGTLSubscriptionManager::STATUS_ACCEPTED)
+    || manager->GetSubscriptionStatus("TDATA", "Other") != -1 || manager->GetNumberOfSubscriptions() != 2)
+    {
+    std::cout << "FAILURE: status of a missing subscription is set" << std::endl;
+    numberOfFailures++;
+    }
+  // A rejected stream is not requested again while the connection lasts
+  manager->PopPendingSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 0, "rejected subscription") ? 0 : 1;
+
+  // On reconnection all subscriptions are requested again, the rejected one included
+  manager->ResetSubscriptions();
+  numberOfFailures += IsStatus(manager, "QTDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_PENDING, "reset") ? 0 : 1;
+  manager->PopPendingSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 2, "subscriptions after reconnection") ? 0 : 1;
+  subscriptions.clear();
+
+  // Removing a subscription whose STT_ message was sent requires a STP_ message, once
+  manager->SetSubscriptionStatus("TDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_ACCEPTED);
+  if (!manager->RemoveSubscription("TDATA", "Tracker") || manager->RemoveSubscription("TDATA", "Tracker")
+    || manager->HasSubscription("TDATA", "Tracker") || !manager->HasSubscription("QTDATA", "Tracker"))
+    {
+    std::cout << "FAILURE: subscription is not removed once" << std::endl;
+    numberOfFailures++;
+    }
+  manager->PopCancelledSubscriptions(subscriptions);
+  if (!IsSubscriptionList(subscriptions, 1, "cancelled accepted subscription") || subscriptions[0].Type != "TDATA")
+    {
+    std::cout << "FAILURE: STP_TDATA is not requested for the removed subscription" << std::endl;
+    numberOfFailures++;
+    }
+  subscriptions.clear();
+  manager->PopCancelledSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 0, "cancelled subscriptions popped twice") ? 0 : 1;
+
+  // A subscription that was never sent, or was rejected, is removed without STP_ message
+  manager->AddSubscription("IMAGE", "US", 100, "");
+  manager->SetSubscriptionStatus("QTDATA", "Tracker", vtkIGTLSubscriptionManager::STATUS_REJECTED);
+  manager->RemoveSubscription("IMAGE", "US");
+  manager->RemoveSubscription("QTDATA", "Tracker");
+  manager->PopCancelledSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 0, "subscriptions removed before being accepted") ? 0 : 1;
+
+  // Subscribing again before the STP_ message is sent updates the stream instead of stopping it
+  manager->AddSubscription("TDATA", "Tracker", 50, "");
+  manager->PopPendingSubscriptions(subscriptions);
+  subscriptions.clear();
+  manager->RemoveSubscription("TDATA", "Tracker");
+  manager->AddSubscription("TDATA", "Tracker", 100, "");
+  manager->PopCancelledSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 0, "subscription added again") ? 0 : 1;
+  manager->PopPendingSubscriptions(subscriptions);
+  if (!IsSubscriptionList(subscriptions, 1, "subscription added again") || subscriptions[0].Resolution != 100)
+    {
+    std::cout << "FAILURE: resolution of the subscription added again is not updated" << std::endl;
+    numberOfFailures++;
+    }
+  subscriptions.clear();
+
+  // Stops of the previous connection are not sent on the new one, removing all subscriptions stops the sent ones
+  manager->AddSubscription("IMAGE", "US", 100, "");
+  manager->RemoveSubscription("TDATA", "Tracker");
+  manager->ResetSubscriptions();
+  manager->PopCancelledSubscriptions(subscriptions);
+  numberOfFailures += IsSubscriptionList(subscriptions, 0, "cancelled subscriptions after reconnection") ? 0 : 1;
+  manager->PopPendingSubscriptions(subscriptions);
+  subscriptions.clear();
+  manager->RemoveAllSubscriptions();
+  manager->PopCancelledSubscriptions(subscriptions);
+  if (manager->GetNumberOfSubscriptions() != 0 || !IsSubscriptionList(subscriptions, 1, "all subscriptions removed"))
+    {
+    numberOfFailures++;
+    }
+  subscriptions.clear();
+
+  // Push schedule: the first push is due when the peer subscribes, then once per interval
+  int numberOfTrackerPushes = 0;
+  if (manager->GetNextPushTime() >= 0.0 || Push(manager, 100.0, numberOfTrackerPushes) != 0)
+    {
+    std::cout << "FAILURE: push is due without remote subscription" << std::endl;
+    numberOfFailures++;
+    }
+  manager->AddRemoteSubscription("TDATA", "Tracker", 0.25, 100.0);
+  manager->AddRemoteSubscription("IMAGE", "US", 1.0, 100.5);
+  if (manager->GetNextPushTime() != 100.0 || manager->GetRemoteSubscriptionInterval("TDATA", "Tracker") != 0.25
+    || manager->GetRemoteSubscriptionInterval("TDATA", "US") != -1.0 || manager->GetNumberOfRemoteSubscriptions() != 2)
+    {
+    std::cout << "FAILURE: remote subscriptions are not scheduled" << std::endl;
+    numberOfFailures++;
+    }
+  // Updates every 50 ms for 2 s: the tracker is pushed 8 times, the image 2 times (at 100.5 and 101.5)
+  int numberOfPushes = 0;
+  for (int i = 0; i < 40; ++i)
+    {
+    numberOfPushes += Push(manager, 100.0 + 0.05 * i, numberOfTrackerPushes);
+    }
+  if (numberOfTrackerPushes != 8 || numberOfPushes != 10)
+    {
+    std::cout << "FAILURE: " << numberOfTrackerPushes << " tracker pushes and " << numberOfPushes - numberOfTrackerPushes
+              << " image pushes, expected 8 and 2" << std::endl;
+    numberOfFailures++;
+    }
+
+  // A push late by less than an interval keeps the schedule, a longer delay does not send a burst
+  manager->AddRemoteSubscription("TDATA", "Tracker", 0.25, 200.0);
+  manager->RemoveRemoteSubscription("IMAGE", "US");
+  numberOfTrackerPushes = 0;
+  Push(manager, 200.0, numberOfTrackerPushes);
+  Push(manager, 200.3, numberOfTrackerPushes);
+  if (numberOfTrackerPushes != 2 || manager->GetNextPushTime() != 200.5)
+    {
+    std::cout << "FAILURE: slightly late push moved the schedule to " << manager->GetNextPushTime() << std::endl;
+    numberOfFailures++;
+    }
+  Push(manager, 202.0, numberOfTrackerPushes);
+  Push(manager, 202.0, numberOfTrackerPushes);
+  if (numberOfTrackerPushes != 3 || manager->GetNextPushTime() != 202.25)
+    {
+    std::cout << "FAILURE: " << numberOfTrackerPushes - 2 << " pushes after a long delay, next at "
+              << manager->GetNextPushTime() << ", expected 1 and 202.25" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Unsubscribed streams are no longer pushed
+  if (!manager->RemoveRemoteSubscription("TDATA", "Tracker") || manager->RemoveRemoteSubscription("TDATA", "Tracker")
+    || manager->HasRemoteSubscription("TDATA", "Tracker") || manager->GetNextPushTime() >= 0.0
+    || Push(manager, 300.0, numberOfTrackerPushes) != 0)
+    {
+    std::cout << "FAILURE: removed remote subscription is pushed" << std::endl;
+    numberOfFailures++;
+    }
+  manager->AddRemoteSubscription("TDATA", "Tracker", 0.25, 300.0);
+  manager->RemoveAllRemoteSubscriptions();
+  if (manager->GetNumberOfRemoteSubscriptions() != 0 || Push(manager, 301.0, numberOfTrackerPushes) != 0)
+    {
+    std::cout << "FAILURE: remote subscriptions remain after the connection is lost" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: subscription states and push schedule" << std::endl;
+  return EXIT_SUCCESS;
+}
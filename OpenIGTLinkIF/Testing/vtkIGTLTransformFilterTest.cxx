@@ -0,0 +1,190 @@
+// IF module includes
+#include "vtkIGTLTransformFilter.h"
+
+// VTK includes
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Samples every 10 ms, the pose steps from 0 to 10 mm and 30 degrees about z after 50 samples
+static const int NumberOfSamples = 151;
+static const int StepSample = 50;
+static const double SamplePeriod = 0.01;
+
+enum
+{
+  SENDER_TIME,
+  ZERO_TIME,
+  REPEATED_TIME,
+};
+
+// Pose scaled by 2, 3 and 4 along the axes
+static void GetPose(double x, double angle, vtkMatrix4x4* matrix)
+{
+  vtkSmartPointer<vtkTransform> transform = vtkSmartPointer<vtkTransform>::New();
+  transform->Translate(x, 0.0, 0.0);
+  transform->RotateZ(angle);
+  transform->Scale(2.0, 3.0, 4.0);
+  matrix->DeepCopy(transform->GetMatrix());
+}
+
+// Filter the step and return the filtered matrices. Only the arrival time advances
+// if the sender time stamps are not set or repeated.
+static std::vector<vtkSmartPointer<vtkMatrix4x4> > FilterStep(int filterType, int timeMode)
+{
+  vtkSmartPointer<vtkIGTLTransformFilter> filter = vtkSmartPointer<vtkIGTLTransformFilter>::New();
+  filter->SetFilterType(filterType);
+  std::vector<vtkSmartPointer<vtkMatrix4x4> > output;
+  for (int i = 0; i < NumberOfSamples; ++i)
+    {
+    double arrivalTime = 100.0 + SamplePeriod * i;
+    double timestamp = SamplePeriod * i;
+    if (timeMode == ZERO_TIME)
+      {
+      timestamp = 0.0;
+      }
+    else if (timeMode == REPEATED_TIME)
+      {
+      timestamp = 5.0;
+      }
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    GetPose(i < StepSample ? 0.0 : 10.0, i < StepSample ? 0.0 : 30.0, matrix);
+    filter->Filter(timestamp, arrivalTime, matrix);
+    output.push_back(matrix);
+    }
+  return output;
+}
+
+// Rotation angle about z of a matrix that is scaled by 2 along x
+static double GetAngle(vtkMatrix4x4* matrix)
+{
+  return vtkMath::DegreesFromRadians(atan2(matrix->GetElement(1, 0), matrix->GetElement(0, 0)));
+}
+
+static bool IsEqual(vtkMatrix4x4* matrix, vtkMatrix4x4* expected, double tolerance)
+{
+  for (int row = 0; row < 4; ++row)
+    {
+    for (int column = 0; column < 4; ++column)
+      {
+      if (fabs(matrix->GetElement(row, column) - expected->GetElement(row, column)) > tolerance)
+        {
+        return false;
+        }
+      }
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkMatrix4x4> expected = vtkSmartPointer<vtkMatrix4x4>::New();
+
+  int filterTypes[] = { vtkIGTLTransformFilter::FILTER_ONE_EURO, vtkIGTLTransformFilter::FILTER_KALMAN };
+  for (int filterIndex = 0; filterIndex < 2; ++filterIndex)
+    {
+    int filterType = filterTypes[filterIndex];
+    const char* filterName = vtkIGTLTransformFilter::FilterTypeToString(filterType);
+    std::vector<vtkSmartPointer<vtkMatrix4x4> > output = FilterStep(filterType, SENDER_TIME);
+
+    // Step response: the first sample after the step is smoothed, and the filter settles within 0.5 s
+    GetPose(0.0, 0.0, expected);
+    if (!IsEqual(output[StepSample - 1], expected, 1e-9))
+      {
+      std::cout << "FAILURE: " << filterName << " filter changed a constant pose" << std::endl;
+      numberOfFailures++;
+      }
+    double stepX = output[StepSample]->GetElement(0, 3);
+    double stepAngle = GetAngle(output[StepSample]);
+    if (stepX < 1.0 || stepX > 9.0 || stepAngle < 3.0 || stepAngle > 27.0)
+      {
+      std::cout << "FAILURE: " << filterName << " filter output after the step is " << stepX << " mm, "
+                << stepAngle << " deg, expected between the poses before and after the step" << std::endl;
+      numberOfFailures++;
+      }
+    GetPose(10.0, 30.0, expected);
+    if (!IsEqual(output[StepSample + 50], expected, 0.01) || !IsEqual(output[NumberOfSamples - 1], expected, 1e-4))
+      {
+      std::cout << "FAILURE: " << filterName << " filter did not settle at the pose after the step" << std::endl;
+      numberOfFailures++;
+      }
+    if (filterType == vtkIGTLTransformFilter::FILTER_ONE_EURO)
+      {
+      for (int i = StepSample; i < NumberOfSamples; ++i)
+        {
+        if (output[i]->GetElement(0, 3) > 10.0 || output[i]->GetElement(0, 3) < output[i - 1]->GetElement(0, 3))
+          {
+          std::cout << "FAILURE: One-Euro step response overshoots at sample " << i << std::endl;
+          numberOfFailures++;
+          break;
+          }
+        }
+      }
+
+    // Scaling is kept while the rotation is filtered
+    for (int i = 0; i < NumberOfSamples; ++i)
+      {
+      for (int column = 0; column < 3; ++column)
+        {
+        double norm = sqrt(output[i]->GetElement(0, column) * output[i]->GetElement(0, column)
+          + output[i]->GetElement(1, column) * output[i]->GetElement(1, column)
+          + output[i]->GetElement(2, column) * output[i]->GetElement(2, column));
+        if (fabs(norm - (column + 2.0)) > 1e-9)
+          {
+          std::cout << "FAILURE: " << filterName << " filter changed the scaling of axis " << column
+                    << " at sample " << i << " to " << norm << std::endl;
+          numberOfFailures++;
+          i = NumberOfSamples;
+          break;
+          }
+        }
+      }
+
+    // Without sender time stamps, or with a repeated one, the arrival times give the same result
+    int timeModes[] = { ZERO_TIME, REPEATED_TIME };
+    for (int modeIndex = 0; modeIndex < 2; ++modeIndex)
+      {
+      std::vector<vtkSmartPointer<vtkMatrix4x4> > arrivalOutput = FilterStep(filterType, timeModes[modeIndex]);
+      for (int i = 0; i < NumberOfSamples; ++i)
+        {
+        if (!IsEqual(arrivalOutput[i], output[i], 1e-6))
+          {
+          std::cout << "FAILURE: " << filterName << " filter with " << (timeModes[modeIndex] == ZERO_TIME ? "zero" : "repeated")
+                    << " time stamps differs at sample " << i << ": " << arrivalOutput[i]->GetElement(0, 3)
+                    << " mm, expected " << output[i]->GetElement(0, 3) << " mm" << std::endl;
+          numberOfFailures++;
+          break;
+          }
+        }
+      }
+    }
+
+  // After a pause of more than a second the measured pose is passed through
+  vtkSmartPointer<vtkIGTLTransformFilter> filter = vtkSmartPointer<vtkIGTLTransformFilter>::New();
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  GetPose(0.0, 0.0, matrix);
+  filter->Filter(1.0, 1.0, matrix);
+  GetPose(20.0, 45.0, matrix);
+  filter->Filter(3.0, 3.0, matrix);
+  GetPose(20.0, 45.0, expected);
+  if (!IsEqual(matrix, expected, 1e-9))
+    {
+    std::cout << "FAILURE: the filter did not restart after a pause" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: transform filter step response and time stamps" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,212 @@
+// IF module includes
+#include "vtkIGTLXMLDocument.h"
+
+// VTK includes
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Content of the documents is parsed in place with ParseBuffer, as the connector does with received
+// COMMAND messages, except where the copying Parse is tested.
+
+static bool ParseValid(vtkIGTLXMLDocument* document, const std::string& content, const char* description)
+{
+  if (!document->ParseBuffer(content.data(), content.size()) || !document->IsValid())
+    {
+    std::cout << "FAILURE: " << description << ": " << document->GetErrorMessage() << std::endl;
+    return false;
+    }
+  return true;
+}
+
+static bool ParseInvalid(vtkIGTLXMLDocument* document, const std::string& content, const char* description)
+{
+  if (document->ParseBuffer(content.data(), content.size()) || document->IsValid()
+    || document->GetErrorMessage().empty() || document->GetNumberOfElements() != 0 || document->GetRootElement() != -1)
+    {
+    std::cout << "FAILURE: " << description << " is accepted: " << content << std::endl;
+    return false;
+    }
+  return true;
+}
+
+static bool IsEqual(const std::string& value, const char* expected, const char* description)
+{
+  if (value != expected)
+    {
+    std::cout << "FAILURE: " << description << " is \"" << value << "\", expected \"" << expected << "\"" << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkIGTLXMLDocument> document = vtkSmartPointer<vtkIGTLXMLDocument>::New();
+
+  // Elements, attributes and navigation, with declaration, comments and white space around the root
+  std::string content =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!DOCTYPE Command>\n"
+    "<!-- Set <Depth> & gain -->\n"
+    "<Command Name=\"Set\" Version='2'>\n"
+    "  <Parameter Name=\"Depth\" Value=\"12.5\" />\n"
+    "  <!-- <Parameter Name=\"Commented\" /> -->\n"
+    "  <Parameter Name=\"Gain\" Value=\"-3\"/>\n"
+    "  <Description>  Depth and gain  </Description>\n"
+    "</Command>\n";
+  if (ParseValid(document, content, "command"))
+    {
+    int root = document->GetRootElement();
+    int depth = document->FindChildElementWithAttribute(root, "Parameter", "Name", "Depth");
+    int gain = document->FindChildElementWithAttribute(root, "Parameter", "Name", "Gain");
+    int description = document->FindChildElement(root, "Description");
+    double depthValue = 0.0;
+    int gainValue = 0;
+    int version = 0;
+    if (root != 0 || document->GetNumberOfElements() != 4 || document->GetElementName(root) != "Command"
+      || document->GetFirstChildElement(root) != depth || document->GetNextSiblingElement(depth) != gain
+      || document->GetNextSiblingElement(gain) != description || document->GetNextSiblingElement(description) != -1
+      || document->GetParentElement(gain) != root || document->GetParentElement(root) != -1
+      || document->FindChildElementWithAttribute(root, "Parameter", "Name", "Commented") != -1
+      || document->FindChildElement(root, "Missing") != -1)
+      {
+      std::cout << "FAILURE: elements of the command are not found" << std::endl;
+      numberOfFailures++;
+      }
+    if (document->GetNumberOfAttributes(root) != 2 || document->GetAttributeName(root, 1) != "Version"
+      || !document->GetScalarAttribute(root, "Version", version) || version != 2
+      || !document->GetScalarAttribute(depth, "Value", depthValue) || depthValue != 12.5
+      || !document->GetScalarAttribute(gain, "Value", gainValue) || gainValue != -3
+      || document->GetScalarAttribute(depth, "Name", depthValue) || document->HasAttribute(depth, "Missing"))
+      {
+      std::cout << "FAILURE: attributes of the command are not read" << std::endl;
+      numberOfFailures++;
+      }
+    numberOfFailures += IsEqual(document->GetElementText(description), "Depth and gain", "element text") ? 0 : 1;
+    numberOfFailures += IsEqual(document->GetElementText(root), "", "text of element with children only") ? 0 : 1;
+    // Views point into the parsed content
+    vtkIGTLXMLDocument::StringView nameView = document->GetAttributeView(depth, "Name");
+    if (nameView.Data != content.data() + content.find("\"Depth\"") + 1 || nameView.Length != 5)
+      {
+      std::cout << "FAILURE: attribute view does not point into the parsed content" << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  // Predefined entities and numeric character references are decoded by the string accessors only
+  content = "<Text Value=\"&lt;a &amp; b&gt; &quot;c&quot; &apos;d&apos;\" Code=\"&#65;&#x42;&#X43;&#233;&#x20AC;&#x1F600;\">"
+            "x &lt; y &amp;&amp; &unknown; &#xZZ; &#-1; &#x110000; & alone</Text>";
+  if (ParseValid(document, content, "entities"))
+    {
+    int root = document->GetRootElement();
+    numberOfFailures += IsEqual(document->GetAttributeValue(root, "Value"), "<a & b> \"c\" 'd'", "predefined entities") ? 0 : 1;
+    numberOfFailures += IsEqual(document->GetAttributeValue(root, "Code"),
+                                "ABC\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", "numeric character references") ? 0 : 1;
+    numberOfFailures += IsEqual(document->GetElementText(root), "x < y && &unknown; &#xZZ; &#-1; &#x110000; & alone",
+                                "text with invalid references") ? 0 : 1;
+    numberOfFailures += IsEqual(document->GetAttributeView(root, "Value").ToString(),
+                                "&lt;a &amp; b&gt; &quot;c&quot; &apos;d&apos;", "raw attribute view") ? 0 : 1;
+    }
+
+  // CDATA sections are kept as they are, markup and entities included
+  content = "<Script><![CDATA[if (a < b && c > d) { x = \"&amp;\"; }]]></Script>";
+  if (ParseValid(document, content, "CDATA section"))
+    {
+    numberOfFailures += IsEqual(document->GetElementText(document->GetRootElement()),
+                                "if (a < b && c > d) { x = \"&amp;\"; }", "CDATA text") ? 0 : 1;
+    }
+  content = "<Script> <!-- comment --> <![CDATA[]]>text</Script>";
+  if (ParseValid(document, content, "empty CDATA section"))
+    {
+    numberOfFailures += IsEqual(document->GetElementText(document->GetRootElement()), "", "empty CDATA text") ? 0 : 1;
+    }
+
+  // Unquoted attribute values and attributes without value
+  content = "<Parameter Name=Depth Value = 7 Enabled Unit=mm/>";
+  if (ParseValid(document, content, "unquoted attributes"))
+    {
+    int root = document->GetRootElement();
+    int value = 0;
+    if (document->GetNumberOfAttributes(root) != 4 || document->GetAttributeValue(root, "Name") != "Depth"
+      || !document->GetScalarAttribute(root, "Value", value) || value != 7
+      || !document->HasAttribute(root, "Enabled") || document->GetAttributeValue(root, "Enabled") != ""
+      || document->GetAttributeValue(root, "Unit") != "mm")
+      {
+      std::cout << "FAILURE: unquoted attributes are not read" << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  // An end tag closes the elements left open inside its element
+  content = "<Command><Parameter Name=\"Depth\"><Unit>mm</Command>";
+  if (ParseValid(document, content, "element closed by the end tag of its parent"))
+    {
+    int parameter = document->FindChildElement(document->GetRootElement(), "Parameter");
+    if (document->GetNumberOfElements() != 3 || document->GetElementText(document->FindChildElement(parameter, "Unit")) != "mm")
+      {
+      std::cout << "FAILURE: elements closed by the end tag of their parent are not kept" << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  // Malformed content
+  numberOfFailures += ParseInvalid(document, "", "empty content") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "  <!-- comment only -->  ", "content without element") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "<Command></Parameter>", "mismatched end tag") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "<Command><Parameter></Unit></Command>", "end tag of no open element") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "<Command><Parameter/>", "unclosed element") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "<Command/><Command/>", "two root elements") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "text<Command/>", "text outside of the root element") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "<Command/><![CDATA[x]]>", "CDATA outside of the root element") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "< Command/>", "element without name") ? 0 : 1;
+  numberOfFailures += ParseInvalid(document, "<Command =\"1\"/>", "attribute without name") ? 0 : 1;
+  if (document->ParseBuffer(NULL, 0) || document->IsValid())
+    {
+    std::cout << "FAILURE: null buffer is accepted" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Every truncation of a valid document is rejected, and nothing after the given length is read
+  content =
+    "<?xml version=\"1.0\"?><!-- c --><Command Name=\"Set\" Unit=mm Enabled>"
+    "<Parameter Value='&lt;1&gt;'/><Text><![CDATA[a<b]]></Text></Command>";
+  if (ParseValid(document, content, "document to truncate"))
+    {
+    // The characters after the truncation would complete the document if they were read
+    for (size_t length = 0; length < content.size(); ++length)
+      {
+      if (document->ParseBuffer(content.data(), length))
+        {
+        std::cout << "FAILURE: content truncated to " << length << " characters is accepted: "
+                  << content.substr(0, length) << std::endl;
+        numberOfFailures++;
+        break;
+        }
+      }
+    }
+
+  // A failed parse clears the previous document, Parse copies its content
+  std::string copiedContent = "<Command Name=\"Copied\"/>";
+  document->Parse(copiedContent);
+  copiedContent.assign(copiedContent.size(), ' ');
+  numberOfFailures += IsEqual(document->GetAttributeValue(document->GetRootElement(), "Name"), "Copied", "copied content") ? 0 : 1;
+  document->Parse("<Command");
+  if (document->IsValid() || document->GetAttributeValue(0, "Name") != "" || document->GetElementName(0) != "")
+    {
+    std::cout << "FAILURE: elements remain after a failed parse" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: XML content parsed into elements, attributes and decoded text" << std::endl;
+  return EXIT_SUCCESS;
+}
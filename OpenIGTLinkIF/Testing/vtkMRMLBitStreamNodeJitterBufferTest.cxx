@@ -0,0 +1,130 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+
+// IF module includes
+#include "vtkMRMLBitStreamNode.h"
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+// Frames are identified by the value of their pixels. The jitter buffer stores copies,
+// so the same image is pushed with a new value each time.
+static void PushFrame(vtkMRMLBitStreamNode* node, vtkImageData* frame, int value, double timestamp)
+{
+  unsigned char* pixels = static_cast<unsigned char*>(frame->GetScalarPointer());
+  for (int i = 0; i < 4; ++i)
+    {
+    pixels[i] = static_cast<unsigned char>(value);
+    }
+  frame->Modified();
+  node->PushDecodedFrame(frame, timestamp);
+}
+
+static int GetDisplayedFrame(vtkMRMLBitStreamNode* node)
+{
+  vtkImageData* image = node->GetImageData();
+  if (image == NULL || image->GetScalarPointer() == NULL)
+    {
+    return -1;
+    }
+  return *static_cast<unsigned char*>(image->GetScalarPointer());
+}
+
+// Update the buffer once and check the displayed frame
+static bool IsReleased(vtkMRMLBitStreamNode* node, int expectedValue, const char* description)
+{
+  node->UpdateJitterBuffer();
+  int value = GetDisplayedFrame(node);
+  if (value != expectedValue)
+    {
+    std::cout << "FAILURE: " << description << ": frame " << value << " displayed, expected " << expectedValue << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkMRMLBitStreamNode> node = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+  vtkSmartPointer<vtkImageData> frame = vtkSmartPointer<vtkImageData>::New();
+  frame->SetDimensions(2, 2, 1);
+  frame->AllocateScalars(VTK_UNSIGNED_CHAR, 1);
+
+  // In low latency mode frames bypass the buffer and are displayed without copy
+  node->SetLowLatencyMode(true);
+  PushFrame(node, frame, 10, vtkTimerLog::GetUniversalTime());
+  if (node->GetImageData() != frame.GetPointer() || node->GetNumberOfBufferedFrames() != 0)
+    {
+    std::cout << "FAILURE: frame is buffered in low latency mode" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Frames are held for the delay, then displayed in timestamp order, one per update
+  node->SetLowLatencyMode(false);
+  node->SetJitterBufferDelay(0.1);
+  double startTime = vtkTimerLog::GetUniversalTime();
+  PushFrame(node, frame, 3, startTime + 0.02);
+  PushFrame(node, frame, 1, startTime);
+  PushFrame(node, frame, 2, startTime + 0.01);
+  node->UpdateJitterBuffer();
+  if (node->GetNumberOfBufferedFrames() != 3 || node->GetImageData() != frame.GetPointer())
+    {
+    std::cout << "FAILURE: " << node->GetNumberOfBufferedFrames() << " buffered frames before the delay, expected 3" << std::endl;
+    numberOfFailures++;
+    }
+  igtl::Sleep(150);
+  numberOfFailures += IsReleased(node, 1, "first due frame") ? 0 : 1;
+  numberOfFailures += IsReleased(node, 2, "second due frame") ? 0 : 1;
+  numberOfFailures += IsReleased(node, 3, "third due frame") ? 0 : 1;
+  // Frames older than the displayed one are dropped
+  PushFrame(node, frame, 4, startTime + 0.015);
+  if (node->GetNumberOfBufferedFrames() != 0)
+    {
+    std::cout << "FAILURE: frame older than the displayed frame is buffered" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Frames without timestamp are played in order of arrival
+  node->ClearJitterBuffer();
+  PushFrame(node, frame, 5, 0.0);
+  igtl::Sleep(20);
+  PushFrame(node, frame, 6, 0.0);
+  igtl::Sleep(20);
+  PushFrame(node, frame, 7, 0.0);
+  if (node->GetNumberOfBufferedFrames() != 3)
+    {
+    std::cout << "FAILURE: " << node->GetNumberOfBufferedFrames() << " buffered frames without timestamp, expected 3" << std::endl;
+    numberOfFailures++;
+    }
+  igtl::Sleep(150);
+  numberOfFailures += IsReleased(node, 5, "first frame without timestamp") ? 0 : 1;
+  numberOfFailures += IsReleased(node, 6, "second frame without timestamp") ? 0 : 1;
+  numberOfFailures += IsReleased(node, 7, "third frame without timestamp") ? 0 : 1;
+
+  // Frames that are too late are skipped while a newer frame is due
+  PushFrame(node, frame, 8, 0.0);
+  PushFrame(node, frame, 9, 0.0);
+  igtl::Sleep(400);
+  PushFrame(node, frame, 11, 0.0);
+  igtl::Sleep(150);
+  numberOfFailures += IsReleased(node, 11, "late frames") ? 0 : 1;
+  if (node->GetNumberOfBufferedFrames() != 0)
+    {
+    std::cout << "FAILURE: late frames remain in the buffer" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: jitter buffer releases frames in order after the delay" << std::endl;
+  return EXIT_SUCCESS;
+}
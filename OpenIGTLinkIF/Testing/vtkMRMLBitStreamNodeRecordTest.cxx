@@ -0,0 +1,278 @@
+// IF module includes
+#include "vtkIGTLVideoDevice.h"
+#include "vtkMRMLBitStreamNode.h"
+#include "vtkMRMLBitStreamStorageNode.h"
+
+// OpenIGTLink includes
+#include <igtlConfigure.h>
+#include <igtlMessageHeader.h>
+#include <igtlVideoMessage.h>
+#if defined(OpenIGTLink_USE_VP9)
+  #include <igtlVP9Encoder.h>
+#endif
+
+// VTK includes
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+// STD includes
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static const char* StreamFileName = "vtkMRMLBitStreamNodeRecordTest.igtlbs";
+
+// Header and body of a packed message, as the connector passes it to a device after receiving it
+static igtl::MessageBase::Pointer GetReceivedBuffer(igtl::MessageBase* message)
+{
+  igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+  header->InitBuffer();
+  memcpy(header->GetBufferPointer(), message->GetBufferPointer(), header->GetBufferSize());
+  header->Unpack();
+  igtl::MessageBase::Pointer buffer = igtl::MessageBase::New();
+  buffer->SetMessageHeader(header);
+  buffer->AllocateBuffer();
+  memcpy(buffer->GetBufferBodyPointer(), message->GetBufferBodyPointer(), buffer->GetBufferBodySize());
+  return buffer;
+}
+
+static bool IsEqual(vtkImageData* a, vtkImageData* b)
+{
+  if (a == NULL || b == NULL)
+    {
+    return false;
+    }
+  int* dimensionsA = a->GetDimensions();
+  int* dimensionsB = b->GetDimensions();
+  if (dimensionsA[0] != dimensionsB[0] || dimensionsA[1] != dimensionsB[1] || dimensionsA[2] != dimensionsB[2]
+    || a->GetScalarType() != b->GetScalarType() || a->GetNumberOfScalarComponents() != b->GetNumberOfScalarComponents())
+    {
+    return false;
+    }
+  size_t size = static_cast<size_t>(dimensionsA[0]) * dimensionsA[1] * dimensionsA[2]
+    * a->GetNumberOfScalarComponents() * a->GetScalarSize();
+  return memcmp(a->GetScalarPointer(), b->GetScalarPointer(), size) == 0;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+
+  // Recording is on by default and the stream is saved by the BitStream storage node
+  vtkSmartPointer<vtkMRMLBitStreamNode> node = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+  vtkSmartPointer<vtkMRMLStorageNode> defaultStorageNode = vtkSmartPointer<vtkMRMLStorageNode>::Take(node->CreateDefaultStorageNode());
+  if (!node->GetRecordStream() || vtkMRMLBitStreamStorageNode::SafeDownCast(defaultStorageNode) == NULL)
+    {
+    std::cout << "FAILURE: stream recording is not enabled by default" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Groups of pictures start with a key frame
+  const unsigned char frameData[4] = { 1, 2, 3, 4 };
+  node->AddStreamFrame(frameData, sizeof(frameData), 16, 8, 1.0, false);
+  if (node->GetNumberOfStreamFrames() != 0)
+    {
+    std::cout << "FAILURE: a delta frame before the first key frame was kept" << std::endl;
+    numberOfFailures++;
+    }
+  node->AddStreamFrame(frameData, sizeof(frameData), 16, 8, 2.0, true);
+  node->AddStreamFrame(frameData, sizeof(frameData), 16, 8, 3.0, false);
+  node->AddStreamFrame(frameData, sizeof(frameData), 16, 8, 4.0, false);
+  if (node->GetNumberOfStreamFrames() != 3 || !node->GetStreamFrameKeyFrame(0) || node->GetStreamFrameKeyFrame(1))
+    {
+    std::cout << "FAILURE: expected a key frame followed by two delta frames, got "
+              << node->GetNumberOfStreamFrames() << " frames" << std::endl;
+    numberOfFailures++;
+    }
+  node->AddStreamFrame(frameData, sizeof(frameData), 16, 8, 5.0, true);
+  if (node->GetNumberOfStreamFrames() != 4 || !node->GetStreamFrameKeyFrame(3) || node->GetStreamFrameTimestamp(3) != 5.0)
+    {
+    std::cout << "FAILURE: a key frame did not start a new group of pictures" << std::endl;
+    numberOfFailures++;
+    }
+
+  // The oldest groups of pictures are dropped when the stream is full
+  vtkSmartPointer<vtkMRMLBitStreamNode> ringNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+  for (int frameIndex = 0; frameIndex < 1000; ++frameIndex)
+    {
+    ringNode->AddStreamFrame(frameData, sizeof(frameData), 16, 8, frameIndex, frameIndex % 50 == 0);
+    }
+  int numberOfKeyFrames = 0;
+  for (int frameIndex = 0; frameIndex < ringNode->GetNumberOfStreamFrames(); ++frameIndex)
+    {
+    numberOfKeyFrames += ringNode->GetStreamFrameKeyFrame(frameIndex) ? 1 : 0;
+    }
+  if (ringNode->GetNumberOfStreamFrames() != 400 || numberOfKeyFrames != 8
+    || !ringNode->GetStreamFrameKeyFrame(0) || ringNode->GetStreamFrameTimestamp(0) != 600.0)
+    {
+    std::cout << "FAILURE: " << ringNode->GetNumberOfStreamFrames() << " frames in " << numberOfKeyFrames
+              << " groups of pictures kept, expected the last 400 frames in 8 groups" << std::endl;
+    numberOfFailures++;
+    }
+  // A group of pictures longer than the stream keeps its first frames
+  ringNode->ClearStreamFrames();
+  for (int frameIndex = 0; frameIndex < 1000; ++frameIndex)
+    {
+    ringNode->AddStreamFrame(frameData, sizeof(frameData), 16, 8, frameIndex, frameIndex == 0);
+    }
+  if (ringNode->GetNumberOfStreamFrames() != 600 || !ringNode->GetStreamFrameKeyFrame(0)
+    || ringNode->GetStreamFrameTimestamp(599) != 599.0)
+    {
+    std::cout << "FAILURE: a long group of pictures was not truncated" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Save and load the stream frames
+  vtkSmartPointer<vtkMRMLBitStreamStorageNode> storageNode = vtkSmartPointer<vtkMRMLBitStreamStorageNode>::New();
+  storageNode->SetFileName(StreamFileName);
+  node->SetCodecName("TEST");
+  vtkSmartPointer<vtkMRMLBitStreamNode> loadedNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+  unsigned int loadedSize = 0;
+  if (!storageNode->WriteData(node) || !storageNode->ReadData(loadedNode)
+    || loadedNode->GetNumberOfStreamFrames() != 4 || !loadedNode->GetStreamFrameKeyFrame(3)
+    || loadedNode->GetStreamFrameTimestamp(3) != 5.0 || loadedNode->GetCodecName() != "TEST"
+    || loadedNode->GetStreamFrameData(0, loadedSize) == NULL || loadedSize != sizeof(frameData)
+    || memcmp(loadedNode->GetStreamFrameData(0, loadedSize), frameData, sizeof(frameData)) != 0)
+    {
+    std::cout << "FAILURE: stream frames differ after save and load" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Disabling recording releases the frames, the decoded image is saved instead
+  node->RecordStreamOff();
+  if (node->GetNumberOfStreamFrames() != 0)
+    {
+    std::cout << "FAILURE: disabling recording did not clear the stream frames" << std::endl;
+    numberOfFailures++;
+    }
+  vtkSmartPointer<vtkImageData> image = vtkSmartPointer<vtkImageData>::New();
+  image->SetDimensions(5, 3, 1);
+  image->AllocateScalars(VTK_UNSIGNED_CHAR, 3);
+  for (int i = 0; i < 5 * 3 * 3; ++i)
+    {
+    static_cast<unsigned char*>(image->GetScalarPointer())[i] = static_cast<unsigned char>(i * 7);
+    }
+  node->SetAndObserveImageData(image);
+  vtkSmartPointer<vtkMRMLBitStreamNode> imageNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+  if (!storageNode->WriteData(node) || !storageNode->ReadData(imageNode)
+    || imageNode->GetNumberOfStreamFrames() != 0 || !IsEqual(imageNode->GetImageData(), image))
+    {
+    std::cout << "FAILURE: decoded image differs after save and load" << std::endl;
+    numberOfFailures++;
+    }
+
+#if defined(OpenIGTLink_USE_VP9)
+  // Received frames: save, load and decode
+  const int width = 64;
+  const int height = 48;
+  const int numberOfFrames = 5;
+  VP9Encoder* encoder = new VP9Encoder();
+  encoder->SetPicWidthAndHeight(width, height);
+  encoder->SetLosslessLink(true);
+  encoder->InitializeEncoder();
+  std::vector<unsigned char> i420Frame(width * height * 3 / 2);
+  SourcePicture picture;
+  picture.colorFormat = FormatI420;
+  picture.picWidth = width;
+  picture.picHeight = height;
+  picture.data[0] = &i420Frame[0];
+  picture.data[1] = picture.data[0] + width * height;
+  picture.data[2] = picture.data[1] + width * height / 4;
+  picture.stride[0] = width;
+  picture.stride[1] = picture.stride[2] = width / 2;
+  std::vector<igtl::VideoMessage::Pointer> messages;
+  for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+    {
+    for (int y = 0; y < height; ++y)
+      {
+      for (int x = 0; x < width; ++x)
+        {
+        i420Frame[y * width + x] = static_cast<unsigned char>(16 + ((x + 4 * frameIndex) * 3 + y * 2) % 220);
+        }
+      }
+    memset(&i420Frame[width * height], 100 + 10 * frameIndex, width * height / 2);
+    picture.timeStamp = frameIndex;
+    igtl::VideoMessage::Pointer message = igtl::VideoMessage::New();
+    message->SetDeviceName("Video");
+    message->SetTimeStamp(100, frameIndex * 1000000);
+    if (encoder->EncodeSingleFrameIntoVideoMSG(&picture, message, false) != 0)
+      {
+      std::cout << "FAILURE: encoding frame " << frameIndex << std::endl;
+      numberOfFailures++;
+      break;
+      }
+    messages.push_back(message);
+    }
+  delete encoder;
+
+  vtkSmartPointer<vtkIGTLVideoDevice> device = vtkSmartPointer<vtkIGTLVideoDevice>::New();
+  device->SetDeviceName("Video");
+  vtkSmartPointer<vtkMRMLBitStreamNode> receivingNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+  if (messages.size() == static_cast<size_t>(numberOfFrames))
+    {
+    // The connector creates the node after the first frame, recording is off
+    receivingNode->RecordStreamOff();
+    device->ReceiveIGTLMessage(GetReceivedBuffer(messages[0]), false);
+    receivingNode->ObserveOutsideVideoDevice(device.GetPointer());
+    device->ReceiveIGTLMessage(GetReceivedBuffer(messages[1]), false);
+    if (receivingNode->GetNumberOfStreamFrames() != 0)
+      {
+      std::cout << "FAILURE: frames were recorded while recording is off" << std::endl;
+      numberOfFailures++;
+      }
+
+    // The stream is sent again from its key frame with recording on
+    receivingNode->RecordStreamOn();
+    for (int frameIndex = 0; frameIndex < numberOfFrames; ++frameIndex)
+      {
+      bool keyFrame = (messages[frameIndex]->GetFrameType() == FrameTypeKey);
+      int framesBefore = receivingNode->GetNumberOfStreamFrames();
+      if (!device->ReceiveIGTLMessage(GetReceivedBuffer(messages[frameIndex]), false) || !device->GetLastFrameConverted())
+        {
+        std::cout << "FAILURE: frame " << frameIndex << " was not converted by the device" << std::endl;
+        numberOfFailures++;
+        break;
+        }
+      int expectedFrames = (keyFrame || framesBefore > 0) ? framesBefore + 1 : 0;
+      if (receivingNode->GetNumberOfStreamFrames() != expectedFrames)
+        {
+        std::cout << "FAILURE: " << receivingNode->GetNumberOfStreamFrames() << " recorded frames after frame "
+                  << frameIndex << ", expected " << expectedFrames << std::endl;
+        numberOfFailures++;
+        }
+      }
+    }
+
+  if (receivingNode->GetNumberOfStreamFrames() == 0 || !receivingNode->GetStreamFrameKeyFrame(0))
+    {
+    std::cout << "FAILURE: the recorded stream does not start with a key frame" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    vtkSmartPointer<vtkMRMLBitStreamNode> decodedNode = vtkSmartPointer<vtkMRMLBitStreamNode>::New();
+    if (!storageNode->WriteData(receivingNode) || !storageNode->ReadData(decodedNode)
+      || decodedNode->GetNumberOfStreamFrames() != receivingNode->GetNumberOfStreamFrames())
+      {
+      std::cout << "FAILURE: received stream frames could not be saved and loaded" << std::endl;
+      numberOfFailures++;
+      }
+    else if (!IsEqual(decodedNode->GetImageData(), device->GetContent().image))
+      {
+      std::cout << "FAILURE: the loaded stream does not decode to the last received frame" << std::endl;
+      numberOfFailures++;
+      }
+    }
+#endif
+
+  remove(StreamFileName);
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: recorded stream frames and decoded images survive save, load and decode" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,270 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+#include "igtlioCommandDevice.h"
+
+// IF module includes
+#include "vtkIGTLCommandHandle.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkMultiThreader.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+
+// A server connector echoes the commands it receives, except "Ignore" commands.
+// Blocking commands sent from another thread sleep until the thread calling PeriodicProcess
+// receives the response. On that thread, a blocking command is sent asynchronously.
+// Handles returned by SendCommandAsync are completed, expired or cancelled, and are kept
+// by the connector after their completion.
+
+static const int ServerPort = 18950;
+static const char* CommandDeviceName = "BlockingTest";
+
+static vtkMultiThreaderIDType MainThreadID;
+static int NumberOfResponses = 0;
+static bool ResponseOnOtherThread = false;
+
+void onCommandReceivedEventFunc(vtkObject* caller, unsigned long eid, void* clientdata, void *calldata)
+{
+  vtkMRMLIGTLConnectorNode* connectorNode = vtkMRMLIGTLConnectorNode::SafeDownCast(caller);
+  igtlio::CommandDevice* device = reinterpret_cast<igtlio::CommandDevice*>(calldata);
+  if (device->GetContent().name != "Ignore")
+    {
+    connectorNode->SendCommandResponse(device->GetDeviceName(), device->GetContent().name, device->GetContent().content);
+    }
+}
+
+void onCommandResponseReceivedEventFunc(vtkObject* caller, unsigned long eid, void* clientdata, void *calldata)
+{
+  NumberOfResponses++;
+  if (!vtkMultiThreader::ThreadsEqual(MainThreadID, vtkMultiThreader::GetCurrentThreadID()))
+    {
+    ResponseOnOtherThread = true;
+    }
+}
+
+void onCommandCompletedEventFunc(vtkObject* caller, unsigned long eid, void* clientdata, void *calldata)
+{
+  (*static_cast<int*>(clientdata))++;
+}
+
+struct WorkerData
+{
+  vtkMRMLIGTLConnectorNode* ClientNode;
+  vtkIGTLCommandHandle* Handle;
+  double Duration;
+  int NumberOfCommandsInFlight;
+  bool Done;
+};
+
+// Send a blocking command and record how long it blocked
+static VTK_THREAD_RETURN_TYPE BlockingSendThread(void* arg)
+{
+  WorkerData* data = static_cast<WorkerData*>(static_cast<vtkMultiThreader::ThreadInfo*>(arg)->UserData);
+  double startTime = vtkTimerLog::GetUniversalTime();
+  data->ClientNode->SendCommand(CommandDeviceName, "Echo", "<Command Name=\"Blocking\" />", true, 5.0);
+  data->Duration = vtkTimerLog::GetUniversalTime() - startTime;
+  data->NumberOfCommandsInFlight = data->ClientNode->GetNumberOfCommandsInFlight();
+  data->Done = true;
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+// Wait for a handle completed by the main thread
+static VTK_THREAD_RETURN_TYPE WaitThread(void* arg)
+{
+  WorkerData* data = static_cast<WorkerData*>(static_cast<vtkMultiThreader::ThreadInfo*>(arg)->UserData);
+  data->Done = data->Handle->Wait(5.0);
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+static void Process(vtkMRMLIGTLConnectorNode* serverNode, vtkMRMLIGTLConnectorNode* clientNode, double duration)
+{
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (vtkTimerLog::GetUniversalTime() - startTime < duration)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(1);
+    }
+}
+
+int main(int argc, char * argv [] )
+{
+  MainThreadID = vtkMultiThreader::GetCurrentThreadID();
+
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> serverNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  vtkSmartPointer<vtkCallbackCommand> commandReceivedCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  commandReceivedCallback->SetCallback(onCommandReceivedEventFunc);
+  serverNode->AddObserver(vtkMRMLIGTLConnectorNode::CommandReceivedEvent, commandReceivedCallback);
+  serverNode->SetTypeServer(ServerPort);
+  serverNode->Start();
+  igtl::Sleep(20);
+
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> clientNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  vtkSmartPointer<vtkCallbackCommand> commandResponseReceivedCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  commandResponseReceivedCallback->SetCallback(onCommandResponseReceivedEventFunc);
+  clientNode->AddObserver(vtkMRMLIGTLConnectorNode::CommandResponseReceivedEvent, commandResponseReceivedCallback);
+  clientNode->SetTypeClient("localhost", ServerPort);
+  clientNode->Start();
+
+  // The client is not processed yet, so that no thread is its processing thread
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (clientNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected)
+    {
+    serverNode->PeriodicProcess();
+    igtl::Sleep(5);
+    if (vtkTimerLog::GetUniversalTime() - startTime > 5.0)
+      {
+      std::cout << "FAILURE to connect to server" << std::endl;
+      clientNode->Stop();
+      serverNode->Stop();
+      return EXIT_FAILURE;
+      }
+    }
+
+  int numberOfFailures = 0;
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+
+  // Blocking command from another thread: it sleeps until the main thread imports the response
+  WorkerData blockingData = { clientNode, NULL, 0.0, -1, false };
+  int threadID = threader->SpawnThread(BlockingSendThread, &blockingData);
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (clientNode->GetNumberOfCommandsInFlight() == 0 && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    serverNode->PeriodicProcess();
+    igtl::Sleep(1);
+    }
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (!blockingData.Done && vtkTimerLog::GetUniversalTime() - startTime < 10.0)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(1);
+    }
+  threader->TerminateThread(threadID);
+  Process(serverNode, clientNode, 0.05);
+  if (!blockingData.Done || blockingData.Duration > 2.0 || blockingData.NumberOfCommandsInFlight != 0)
+    {
+    std::cout << "FAILURE: blocking command from another thread returned after " << blockingData.Duration << " s with "
+              << blockingData.NumberOfCommandsInFlight << " commands in flight, expected when the response arrived" << std::endl;
+    numberOfFailures++;
+    }
+  if (NumberOfResponses != 1 || ResponseOnOtherThread)
+    {
+    std::cout << "FAILURE: " << NumberOfResponses << " responses, imported "
+              << (ResponseOnOtherThread ? "by the waiting thread" : "by the main thread") << ", expected 1 by the main thread" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Blocking command on the processing thread: no message is imported during the call
+  startTime = vtkTimerLog::GetUniversalTime();
+  clientNode->SendCommand(CommandDeviceName, "Echo", "<Command Name=\"ProcessingThread\" />", true, 5.0);
+  double duration = vtkTimerLog::GetUniversalTime() - startTime;
+  if (duration > 1.0 || NumberOfResponses != 1)
+    {
+    std::cout << "FAILURE: blocking command on the processing thread returned after " << duration << " s with "
+              << NumberOfResponses << " responses, expected immediately without importing the response" << std::endl;
+    numberOfFailures++;
+    }
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (NumberOfResponses < 2 && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    Process(serverNode, clientNode, 0.01);
+    }
+  if (NumberOfResponses != 2 || clientNode->GetNumberOfCommandsInFlight() != 0)
+    {
+    std::cout << "FAILURE: response of the command sent on the processing thread was not received" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Asynchronous command waited for by another thread and observed by the main thread
+  int numberOfCompletedEvents = 0;
+  vtkSmartPointer<vtkCallbackCommand> commandCompletedCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  commandCompletedCallback->SetCallback(onCommandCompletedEventFunc);
+  commandCompletedCallback->SetClientData(&numberOfCompletedEvents);
+  vtkSmartPointer<vtkIGTLCommandHandle> handle = clientNode->SendCommandAsync(CommandDeviceName, "Echo", "<Command Name=\"Async\" />", 5.0);
+  handle->AddObserver(vtkIGTLCommandHandle::CommandCompletedEvent, commandCompletedCallback);
+  WorkerData waitData = { clientNode, handle, 0.0, -1, false };
+  threadID = threader->SpawnThread(WaitThread, &waitData);
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (!handle->IsDone() && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    Process(serverNode, clientNode, 0.01);
+    }
+  threader->TerminateThread(threadID);
+  if (handle->GetStatus() != vtkIGTLCommandHandle::STATUS_SUCCESS || handle->GetResponseName() != "Echo"
+    || handle->GetResponseContent() != "<Command Name=\"Async\" />" || handle->GetResponseFromCache()
+    || handle->GetCompletionTime() < handle->GetSendTime())
+    {
+    std::cout << "FAILURE: asynchronous command status is " << vtkIGTLCommandHandle::GetStatusAsString(handle->GetStatus())
+              << ", response " << handle->GetResponseContent() << std::endl;
+    numberOfFailures++;
+    }
+  if (!waitData.Done || numberOfCompletedEvents != 1)
+    {
+    std::cout << "FAILURE: the waiting thread was " << (waitData.Done ? "" : "not ") << "woken up, "
+              << numberOfCompletedEvents << " completed events, expected 1" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Handle used without reference: the connector keeps it after its completion
+  vtkIGTLCommandHandle* ownedHandle = clientNode->SendCommandAsync(CommandDeviceName, "Echo", "<Command Name=\"Owned\" />", 5.0);
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (!ownedHandle->IsDone() && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    Process(serverNode, clientNode, 0.01);
+    }
+  Process(serverNode, clientNode, 0.05);
+  if (ownedHandle->GetStatus() != vtkIGTLCommandHandle::STATUS_SUCCESS || ownedHandle->GetReferenceCount() != 1
+    || ownedHandle->GetResponseContent() != "<Command Name=\"Owned\" />")
+    {
+    std::cout << "FAILURE: completed handle is not kept by the connector" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Unanswered command expires after its timeout
+  vtkSmartPointer<vtkIGTLCommandHandle> expiredHandle = clientNode->SendCommandAsync(CommandDeviceName, "Ignore", "<Command />", 0.2);
+  Process(serverNode, clientNode, 0.1);
+  if (expiredHandle->IsDone())
+    {
+    std::cout << "FAILURE: command expired before its timeout" << std::endl;
+    numberOfFailures++;
+    }
+  Process(serverNode, clientNode, 0.3);
+  if (expiredHandle->GetStatus() != vtkIGTLCommandHandle::STATUS_EXPIRED || clientNode->GetNumberOfCommandsInFlight() != 0)
+    {
+    std::cout << "FAILURE: unanswered command status is " << vtkIGTLCommandHandle::GetStatusAsString(expiredHandle->GetStatus())
+              << ", expected Expired" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Cancelled command frees its slot in the command window
+  vtkSmartPointer<vtkIGTLCommandHandle> cancelledHandle = clientNode->SendCommandAsync(CommandDeviceName, "Ignore", "<Command />", 5.0);
+  if (!cancelledHandle->Cancel() || cancelledHandle->Cancel() || !cancelledHandle->Wait(0.0))
+    {
+    std::cout << "FAILURE: command could not be cancelled once" << std::endl;
+    numberOfFailures++;
+    }
+  Process(serverNode, clientNode, 0.05);
+  if (cancelledHandle->GetStatus() != vtkIGTLCommandHandle::STATUS_CANCELLED || clientNode->GetNumberOfCommandsInFlight() != 0)
+    {
+    std::cout << "FAILURE: cancelled command status is " << vtkIGTLCommandHandle::GetStatusAsString(cancelledHandle->GetStatus())
+              << " with " << clientNode->GetNumberOfCommandsInFlight() << " commands in flight" << std::endl;
+    numberOfFailures++;
+    }
+
+  clientNode->Stop();
+  serverNode->Stop();
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: blocking and asynchronous commands" << std::endl;
+  return EXIT_SUCCESS;
+}
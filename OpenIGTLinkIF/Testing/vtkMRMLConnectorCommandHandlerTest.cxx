@@ -0,0 +1,152 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+
+// IF module includes
+#include "vtkIGTLCommandDispatcher.h"
+#include "vtkIGTLCommandHandle.h"
+#include "vtkIGTLCommandHandler.h"
+#include "vtkIGTLCommandRequest.h"
+#include "vtkIGTLXMLDocument.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+
+// VTK includes
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// A server connector answers "Slow" commands with a handler that takes HandlerDuration seconds.
+// The client sends NumberOfCommands commands at once: with a worker per command they must be
+// answered in about one handler duration, each response carrying the content of its own command.
+
+static const int ServerPort = 18947;
+static const int NumberOfCommands = 4;
+static const double HandlerDuration = 0.2;
+static const char* CommandDeviceName = "HandlerTest";
+static const char* CommandName = "Slow";
+
+static std::string GetCommandContent(int index)
+{
+  std::ostringstream content;
+  content << "<Command Index=\"" << index << "\" />";
+  return content.str();
+}
+
+class vtkSlowCommandHandler : public vtkIGTLCommandHandler
+{
+public:
+  static vtkSlowCommandHandler *New();
+  vtkTypeMacro(vtkSlowCommandHandler, vtkIGTLCommandHandler);
+
+  void Execute(vtkIGTLCommandRequest* request) VTK_OVERRIDE
+  {
+    igtl::Sleep(static_cast<int>(HandlerDuration * 1000));
+    if (request->BeginMRMLAccess())
+    {
+      // The main thread is paused, the connector node can be used
+      this->ConnectorNodeName = request->GetConnectorNode()->GetName() ? request->GetConnectorNode()->GetName() : "";
+      request->EndMRMLAccess();
+    }
+    // Answer with the index of the command, read from the parsed content
+    vtkIGTLXMLDocument* document = request->GetContentDocument();
+    int index = -1;
+    if (document->IsValid() && document->GetScalarAttribute(document->GetRootElement(), "Index", index))
+      {
+      request->SetResponseContent(GetCommandContent(index));
+      }
+  }
+
+  std::string ConnectorNodeName;
+
+protected:
+  vtkSlowCommandHandler() {}
+  ~vtkSlowCommandHandler() {}
+};
+
+vtkStandardNewMacro(vtkSlowCommandHandler);
+
+int main(int argc, char * argv [] )
+{
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> serverNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  serverNode->SetName("Server");
+  vtkSmartPointer<vtkSlowCommandHandler> handler = vtkSmartPointer<vtkSlowCommandHandler>::New();
+  serverNode->RegisterCommandHandler(CommandName, handler);
+  serverNode->GetCommandDispatcher()->SetNumberOfThreads(NumberOfCommands);
+  serverNode->SetTypeServer(ServerPort);
+  serverNode->Start();
+  igtl::Sleep(20);
+
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> clientNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  clientNode->SetTypeClient("localhost", ServerPort);
+  clientNode->Start();
+
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (clientNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(5);
+    if (vtkTimerLog::GetUniversalTime() - startTime > 5.0)
+      {
+      std::cerr << "FAILURE to connect to server" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::vector< vtkSmartPointer<vtkIGTLCommandHandle> > handles;
+  startTime = vtkTimerLog::GetUniversalTime();
+  for (int i = 0; i < NumberOfCommands; ++i)
+    {
+    handles.push_back(clientNode->SendCommandAsync(CommandDeviceName, CommandName, GetCommandContent(i), 10.0));
+    }
+  int numberOfDone = 0;
+  while (numberOfDone < NumberOfCommands && vtkTimerLog::GetUniversalTime() - startTime < 10.0)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(1);
+    numberOfDone = 0;
+    for (int i = 0; i < NumberOfCommands; ++i)
+      {
+      numberOfDone += handles[i]->IsDone() ? 1 : 0;
+      }
+    }
+  double elapsed = vtkTimerLog::GetUniversalTime() - startTime;
+
+  clientNode->Stop();
+  serverNode->Stop();
+
+  int numberOfFailures = 0;
+  for (int i = 0; i < NumberOfCommands; ++i)
+    {
+    vtkIGTLXMLDocument* response = handles[i]->GetResponseDocument();
+    int index = -1;
+    if (response == NULL || !response->GetScalarAttribute(response->GetRootElement(), "Index", index) || index != i)
+      {
+      std::cerr << "Command " << i << ": status " << vtkIGTLCommandHandle::GetStatusAsString(handles[i]->GetStatus())
+                << ", response " << handles[i]->GetResponseContent() << std::endl;
+      ++numberOfFailures;
+      }
+    }
+  std::cout << NumberOfCommands << " commands of " << HandlerDuration << " s answered in " << elapsed << " s" << std::endl;
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  if (elapsed > 0.5 * NumberOfCommands * HandlerDuration)
+    {
+    std::cerr << "FAILURE: commands were not processed in parallel" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if (handler->ConnectorNodeName != "Server")
+    {
+    std::cerr << "FAILURE: handler could not access the connector node" << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
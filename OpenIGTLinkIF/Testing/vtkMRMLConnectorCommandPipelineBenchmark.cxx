@@ -0,0 +1,140 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+#include "igtlioCommandDevice.h"
+
+// IF module includes
+#include "vtkIGTLCommandHandle.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// Loopback benchmark of pipelined COMMAND/RTS_COMMAND exchanges.
+// A server connector echoes the content of every command it receives. A client connector sends
+// a chain of commands with increasing command window sizes and reports the command rate.
+// Every response must reach the handle of its own command.
+
+static const int ServerPort = 18946;
+static const int NumberOfCommands = 500;
+static const char* CommandDeviceName = "PipelineBenchmark";
+static const char* CommandName = "Echo";
+
+void onCommandReceivedEventFunc(vtkObject* caller, unsigned long eid, void* clientdata, void *calldata)
+{
+  vtkMRMLIGTLConnectorNode* connectorNode = vtkMRMLIGTLConnectorNode::SafeDownCast(caller);
+  igtlio::CommandDevice* device = reinterpret_cast<igtlio::CommandDevice*>(calldata);
+  connectorNode->SendCommandResponse(device->GetDeviceName(), device->GetContent().name, device->GetContent().content);
+}
+
+static std::string GetCommandContent(int index)
+{
+  std::ostringstream content;
+  content << "<Command Index=\"" << index << "\" />";
+  return content.str();
+}
+
+// Returns the number of commands that did not get their own response
+static int RunWindow(vtkMRMLIGTLConnectorNode* serverNode, vtkMRMLIGTLConnectorNode* clientNode, int windowSize, double& commandsPerSecond)
+{
+  clientNode->SetCommandWindowSize(windowSize);
+  std::vector< vtkSmartPointer<vtkIGTLCommandHandle> > handles;
+  double startTime = vtkTimerLog::GetUniversalTime();
+  for (int i = 0; i < NumberOfCommands; ++i)
+    {
+    handles.push_back(clientNode->SendCommandAsync(CommandDeviceName, CommandName, GetCommandContent(i), 10.0));
+    }
+  int numberOfDone = 0;
+  while (numberOfDone < NumberOfCommands && vtkTimerLog::GetUniversalTime() - startTime < 60.0)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    numberOfDone = 0;
+    for (int i = 0; i < NumberOfCommands; ++i)
+      {
+      numberOfDone += handles[i]->IsDone() ? 1 : 0;
+      }
+    }
+  double elapsed = vtkTimerLog::GetUniversalTime() - startTime;
+  commandsPerSecond = elapsed > 0.0 ? NumberOfCommands / elapsed : 0.0;
+
+  int numberOfFailures = 0;
+  for (int i = 0; i < NumberOfCommands; ++i)
+    {
+    if (handles[i]->GetStatus() != vtkIGTLCommandHandle::STATUS_SUCCESS
+      || handles[i]->GetResponseContent() != GetCommandContent(i))
+      {
+      if (numberOfFailures == 0)
+        {
+        std::cerr << "Command " << i << ": status " << vtkIGTLCommandHandle::GetStatusAsString(handles[i]->GetStatus())
+                  << ", response " << handles[i]->GetResponseContent() << std::endl;
+        }
+      ++numberOfFailures;
+      }
+    }
+  return numberOfFailures;
+}
+
+int main(int argc, char * argv [] )
+{
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> serverNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  vtkSmartPointer<vtkCallbackCommand> commandReceivedCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  commandReceivedCallback->SetCallback(onCommandReceivedEventFunc);
+  serverNode->AddObserver(vtkMRMLIGTLConnectorNode::CommandReceivedEvent, commandReceivedCallback);
+  serverNode->SetTypeServer(ServerPort);
+  serverNode->Start();
+  igtl::Sleep(20);
+
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> clientNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  clientNode->SetTypeClient("localhost", ServerPort);
+  clientNode->Start();
+
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (clientNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(5);
+    if (vtkTimerLog::GetUniversalTime() - startTime > 5.0)
+      {
+      std::cerr << "FAILURE to connect to server" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  int numberOfFailures = 0;
+  double serialRate = 0.0;
+  std::cout << NumberOfCommands << " commands per window size" << std::endl;
+  std::cout << "window  commands/s  speedup" << std::endl;
+  int windowSizes[] = { 1, 2, 4, 8, 16, 32, 64 };
+  for (size_t i = 0; i < sizeof(windowSizes) / sizeof(windowSizes[0]); ++i)
+    {
+    double commandsPerSecond = 0.0;
+    numberOfFailures += RunWindow(serverNode, clientNode, windowSizes[i], commandsPerSecond);
+    if (windowSizes[i] == 1)
+      {
+      serialRate = commandsPerSecond;
+      }
+    char line[64];
+    sprintf(line, "%6d  %10.0f  %6.2fx", windowSizes[i], commandsPerSecond, serialRate > 0.0 ? commandsPerSecond / serialRate : 0.0);
+    std::cout << line << std::endl;
+    }
+
+  clientNode->Stop();
+  serverNode->Stop();
+
+  if (numberOfFailures > 0)
+    {
+    std::cerr << numberOfFailures << " commands did not receive their own response" << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,248 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+
+// IF module includes
+#include "vtkIGTLCommandDispatcher.h"
+#include "vtkIGTLCommandHandle.h"
+#include "vtkIGTLCommandHandler.h"
+#include "vtkIGTLCommandRequest.h"
+#include "vtkIGTLCommandResponseCache.h"
+#include "vtkIGTLXMLDocument.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+
+// VTK includes
+#include <vtkMultiThreader.h>
+#include <vtkObjectFactory.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// A server connector answers "Delay" commands after the delay given in the command, on parallel
+// worker threads. Commands in flight are answered out of order and each response must reach the
+// handle of its own command. The command window limits the commands in flight, further commands
+// are queued, and a blocking command waits while it is queued.
+
+static const int ServerPort = 18951;
+static const int NumberOfCommands = 4;
+static const char* CommandDeviceName = "PipelineTest";
+static const char* CommandName = "Delay";
+
+static std::string GetCommandContent(int index, int delay)
+{
+  std::ostringstream content;
+  content << "<Command Index=\"" << index << "\" Delay=\"" << delay << "\" />";
+  return content.str();
+}
+
+class vtkDelayCommandHandler : public vtkIGTLCommandHandler
+{
+public:
+  static vtkDelayCommandHandler *New();
+  vtkTypeMacro(vtkDelayCommandHandler, vtkIGTLCommandHandler);
+
+  void Execute(vtkIGTLCommandRequest* request) VTK_OVERRIDE
+  {
+    vtkIGTLXMLDocument* document = request->GetContentDocument();
+    int delay = 0;
+    if (document->IsValid() && document->GetScalarAttribute(document->GetRootElement(), "Delay", delay))
+      {
+      igtl::Sleep(delay);
+      }
+    request->SetResponseContent(request->GetContent());
+  }
+
+protected:
+  vtkDelayCommandHandler() {}
+  ~vtkDelayCommandHandler() {}
+};
+
+vtkStandardNewMacro(vtkDelayCommandHandler);
+
+struct BlockingCommandData
+{
+  vtkMRMLIGTLConnectorNode* ClientNode;
+  std::string Content;
+  double Timeout;
+  bool Done;
+};
+
+static VTK_THREAD_RETURN_TYPE BlockingSendThread(void* arg)
+{
+  BlockingCommandData* data = static_cast<BlockingCommandData*>(static_cast<vtkMultiThreader::ThreadInfo*>(arg)->UserData);
+  data->ClientNode->SendCommand(CommandDeviceName, CommandName, data->Content, true, data->Timeout);
+  data->Done = true;
+  return VTK_THREAD_RETURN_VALUE;
+}
+
+// Process until all handles are completed. Returns the largest number of commands in flight.
+static int ProcessUntilDone(vtkMRMLIGTLConnectorNode* serverNode, vtkMRMLIGTLConnectorNode* clientNode,
+                            std::vector< vtkSmartPointer<vtkIGTLCommandHandle> >& handles)
+{
+  int maximumInFlight = clientNode->GetNumberOfCommandsInFlight();
+  double startTime = vtkTimerLog::GetUniversalTime();
+  size_t numberOfDone = 0;
+  while (numberOfDone < handles.size() && vtkTimerLog::GetUniversalTime() - startTime < 10.0)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    maximumInFlight = std::max(maximumInFlight, clientNode->GetNumberOfCommandsInFlight());
+    igtl::Sleep(1);
+    numberOfDone = 0;
+    for (size_t i = 0; i < handles.size(); ++i)
+      {
+      numberOfDone += handles[i]->IsDone() ? 1 : 0;
+      }
+    }
+  return maximumInFlight;
+}
+
+// Returns the number of commands that did not get their own response
+static int CheckResponses(std::vector< vtkSmartPointer<vtkIGTLCommandHandle> >& handles, const char* description)
+{
+  int numberOfFailures = 0;
+  for (size_t i = 0; i < handles.size(); ++i)
+    {
+    if (handles[i]->GetStatus() != vtkIGTLCommandHandle::STATUS_SUCCESS
+      || handles[i]->GetResponseContent() != handles[i]->GetCommandContent())
+      {
+      std::cout << "FAILURE: " << description << ": command " << i << " status "
+                << vtkIGTLCommandHandle::GetStatusAsString(handles[i]->GetStatus())
+                << ", response " << handles[i]->GetResponseContent() << std::endl;
+      numberOfFailures++;
+      }
+    }
+  return numberOfFailures;
+}
+
+int main(int argc, char * argv [] )
+{
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> serverNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  vtkSmartPointer<vtkDelayCommandHandler> handler = vtkSmartPointer<vtkDelayCommandHandler>::New();
+  serverNode->RegisterCommandHandler(CommandName, handler);
+  serverNode->GetCommandDispatcher()->SetNumberOfThreads(NumberOfCommands);
+  serverNode->SetTypeServer(ServerPort);
+  serverNode->Start();
+  igtl::Sleep(20);
+
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> clientNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  clientNode->SetTypeClient("localhost", ServerPort);
+  clientNode->Start();
+
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (clientNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(5);
+    if (vtkTimerLog::GetUniversalTime() - startTime > 5.0)
+      {
+      std::cout << "FAILURE to connect to server" << std::endl;
+      clientNode->Stop();
+      serverNode->Stop();
+      return EXIT_FAILURE;
+      }
+    }
+
+  int numberOfFailures = 0;
+
+  // All commands in flight at once, the first command is answered last
+  clientNode->SetCommandWindowSize(NumberOfCommands);
+  std::vector< vtkSmartPointer<vtkIGTLCommandHandle> > handles;
+  for (int i = 0; i < NumberOfCommands; ++i)
+    {
+    handles.push_back(clientNode->SendCommandAsync(CommandDeviceName, CommandName, GetCommandContent(i, 100 * (NumberOfCommands - i)), 5.0));
+    }
+  if (clientNode->GetNumberOfCommandsInFlight() != NumberOfCommands || clientNode->GetNumberOfQueuedCommands() != 0)
+    {
+    std::cout << "FAILURE: " << clientNode->GetNumberOfCommandsInFlight() << " commands in flight and "
+              << clientNode->GetNumberOfQueuedCommands() << " queued, expected " << NumberOfCommands << " in flight" << std::endl;
+    numberOfFailures++;
+    }
+  ProcessUntilDone(serverNode, clientNode, handles);
+  numberOfFailures += CheckResponses(handles, "out of order responses");
+  for (int i = 1; i < NumberOfCommands; ++i)
+    {
+    if (handles[i]->GetCompletionTime() >= handles[i - 1]->GetCompletionTime())
+      {
+      std::cout << "FAILURE: command " << i << " was answered after command " << i - 1 << std::endl;
+      numberOfFailures++;
+      }
+    }
+  if (handles[0]->GetCompletionTime() - handles[0]->GetSendTime() > 2.0 * 100 * NumberOfCommands / 1000.0)
+    {
+    std::cout << "FAILURE: commands in flight were not answered in parallel" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Window of 2: further commands are queued and sent in request order as responses arrive
+  clientNode->SetCommandWindowSize(2);
+  handles.clear();
+  for (int i = 0; i < NumberOfCommands; ++i)
+    {
+    handles.push_back(clientNode->SendCommandAsync(CommandDeviceName, CommandName, GetCommandContent(10 + i, 50), 5.0));
+    }
+  if (clientNode->GetNumberOfCommandsInFlight() != 2 || clientNode->GetNumberOfQueuedCommands() != NumberOfCommands - 2
+    || handles[2]->IsSent() || handles[3]->IsSent())
+    {
+    std::cout << "FAILURE: " << clientNode->GetNumberOfCommandsInFlight() << " commands in flight and "
+              << clientNode->GetNumberOfQueuedCommands() << " queued, expected 2 and " << NumberOfCommands - 2 << std::endl;
+    numberOfFailures++;
+    }
+  int maximumInFlight = ProcessUntilDone(serverNode, clientNode, handles);
+  numberOfFailures += CheckResponses(handles, "window of 2");
+  if (maximumInFlight > 2 || handles[2]->GetSendTime() < handles[0]->GetSendTime() || handles[3]->GetSendTime() < handles[2]->GetSendTime())
+    {
+    std::cout << "FAILURE: " << maximumInFlight << " commands were in flight with a window of 2" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Window of 1: a blocking command queued behind a command in flight is not given up when its
+  // timeout has elapsed since the call, but only once it has elapsed since the command was sent
+  clientNode->SetCommandWindowSize(1);
+  clientNode->GetCommandResponseCache()->SetCommandTimeToLive(CommandName, 60.0);
+  handles.clear();
+  handles.push_back(clientNode->SendCommandAsync(CommandDeviceName, CommandName, GetCommandContent(20, 250), 5.0));
+  BlockingCommandData blockingData = { clientNode, GetCommandContent(21, 100), 0.3, false };
+  vtkSmartPointer<vtkMultiThreader> threader = vtkSmartPointer<vtkMultiThreader>::New();
+  int threadID = threader->SpawnThread(BlockingSendThread, &blockingData);
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (!blockingData.Done && vtkTimerLog::GetUniversalTime() - startTime < 10.0)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(1);
+    }
+  threader->TerminateThread(threadID);
+  numberOfFailures += CheckResponses(handles, "command in flight before the blocking command");
+  // The response of the blocking command is in the response cache only if it was received
+  std::string responseName;
+  std::string responseContent;
+  if (!clientNode->GetCommandResponseCache()->GetResponse(CommandDeviceName, CommandName, blockingData.Content,
+                                                          vtkTimerLog::GetUniversalTime(), responseName, responseContent)
+    || responseContent != blockingData.Content)
+    {
+    std::cout << "FAILURE: the queued blocking command did not receive its response" << std::endl;
+    numberOfFailures++;
+    }
+  if (clientNode->GetNumberOfCommandsInFlight() != 0 || clientNode->GetNumberOfQueuedCommands() != 0)
+    {
+    std::cout << "FAILURE: commands remain in flight or queued" << std::endl;
+    numberOfFailures++;
+    }
+
+  clientNode->Stop();
+  serverNode->Stop();
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: pipelined commands answered out of order" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+//OpenIGTLink includes
+#include "igtlCapabilityMessage.h"
+#include "igtlMessageHeader.h"
+#include "igtlOSUtil.h"
+#include "igtlServerSocket.h"
+
+// IF module includes
+#include "vtkMRMLIGTLConnectorNode.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkCallbackCommand.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// A plain OpenIGTLink server plays the peer of a client connector and answers GET_CAPABIL with
+// different message types. A transform sent as POSITION falls back to TRANSFORM while the peer
+// does not support POSITION, is suppressed while the peer supports neither, and is sent as
+// POSITION again when the capability of the peer changes or is cleared.
+
+static const int ServerPort = 18953;
+
+static void onCapabilityModifiedFunc(vtkObject* caller, unsigned long eid, void* clientdata, void *calldata)
+{
+  int* numberOfEvents = static_cast<int*>(clientdata);
+  (*numberOfEvents)++;
+}
+
+// Type of the next message of the device, skipping other messages. Empty on timeout.
+static std::string ReceiveMessageType(igtl::Socket* socket, vtkMRMLIGTLConnectorNode* clientNode, const std::string& deviceName)
+{
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    clientNode->PeriodicProcess();
+    igtl::MessageHeader::Pointer header = igtl::MessageHeader::New();
+    header->InitPack();
+    bool timeout = false;
+    if (socket->Receive(header->GetPackPointer(), header->GetPackSize(), timeout) != static_cast<igtlUint64>(header->GetPackSize()))
+      {
+      continue;
+      }
+    header->Unpack();
+    socket->Skip(header->GetBodySizeToRead(), 0);
+    if (deviceName == header->GetDeviceName())
+      {
+      return header->GetDeviceType();
+      }
+    }
+  return "";
+}
+
+// Send CAPABIL and process it. Returns false if the connector did not update the capability.
+static bool SendCapability(igtl::Socket* socket, vtkMRMLIGTLConnectorNode* clientNode, int* numberOfEvents,
+                           const char* type1, const char* type2)
+{
+  std::vector<std::string> types;
+  types.push_back(type1);
+  if (type2)
+    {
+    types.push_back(type2);
+    }
+  igtl::CapabilityMessage::Pointer capabilityMessage = igtl::CapabilityMessage::New();
+  capabilityMessage->SetDeviceName("Capability");
+  capabilityMessage->SetTypes(types);
+  capabilityMessage->Pack();
+  socket->Send(capabilityMessage->GetPackPointer(), capabilityMessage->GetPackSize());
+  int expectedNumberOfEvents = *numberOfEvents + 1;
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (*numberOfEvents < expectedNumberOfEvents && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    clientNode->PeriodicProcess();
+    igtl::Sleep(5);
+    }
+  return *numberOfEvents == expectedNumberOfEvents
+    && clientNode->GetNumberOfPeerSupportedTypes() == static_cast<int>(types.size());
+}
+
+static bool IsPushedAs(igtl::Socket* socket, vtkMRMLIGTLConnectorNode* clientNode, vtkMRMLNode* node,
+                       const char* expectedType, const char* description)
+{
+  clientNode->PushNode(node);
+  std::string type = ReceiveMessageType(socket, clientNode, node->GetName());
+  if (type != expectedType)
+    {
+    std::cout << "FAILURE: " << description << ": transform sent as \"" << type << "\", expected " << expectedType << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  igtl::ServerSocket::Pointer serverSocket = igtl::ServerSocket::New();
+  if (serverSocket->CreateServer(ServerPort) < 0)
+    {
+    std::cout << "FAILURE to create server" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  vtkSmartPointer<vtkMRMLScene> scene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> clientNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  scene->AddNode(clientNode);
+  int numberOfCapabilityEvents = 0;
+  vtkSmartPointer<vtkCallbackCommand> capabilityCallback = vtkSmartPointer<vtkCallbackCommand>::New();
+  capabilityCallback->SetCallback(onCapabilityModifiedFunc);
+  capabilityCallback->SetClientData(&numberOfCapabilityEvents);
+  clientNode->AddObserver(vtkMRMLIGTLConnectorNode::PeerCapabilityModifiedEvent, capabilityCallback);
+  // Registered before the capability is known, with the type requested for the node
+  vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+  transformNode->SetName("Needle");
+  scene->AddNode(transformNode);
+  clientNode->RegisterOutgoingMRMLNode(transformNode, "POSITION");
+  clientNode->SetTypeClient("localhost", ServerPort);
+  clientNode->Start();
+
+  igtl::ClientSocket::Pointer socket;
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (socket.IsNull() || clientNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected)
+    {
+    if (socket.IsNull())
+      {
+      socket = serverSocket->WaitForConnection(10);
+      }
+    clientNode->PeriodicProcess();
+    if (vtkTimerLog::GetUniversalTime() - startTime > 5.0)
+      {
+      std::cout << "FAILURE to connect to server" << std::endl;
+      clientNode->Stop();
+      serverSocket->CloseSocket();
+      return EXIT_FAILURE;
+      }
+    }
+  socket->SetReceiveTimeout(100);
+
+  int numberOfFailures = 0;
+  // The connector asks for the capability of the peer when connected
+  if (ReceiveMessageType(socket, clientNode, "Capability") != "GET_CAPABIL" || clientNode->IsPeerCapabilityKnown()
+    || !clientNode->IsPeerTypeSupported("POSITION"))
+    {
+    std::cout << "FAILURE: GET_CAPABIL was not sent when connected" << std::endl;
+    numberOfFailures++;
+    }
+
+  // POSITION is not supported, the transform falls back to TRANSFORM
+  if (!SendCapability(socket, clientNode, &numberOfCapabilityEvents, "TRANSFORM", "STATUS"))
+    {
+    std::cout << "FAILURE: capability of the peer is not received" << std::endl;
+    numberOfFailures++;
+    }
+  numberOfFailures += IsPushedAs(socket, clientNode, transformNode, "TRANSFORM", "peer without POSITION") ? 0 : 1;
+
+  // Neither type is supported, the push is suppressed
+  SendCapability(socket, clientNode, &numberOfCapabilityEvents, "STATUS", NULL);
+  clientNode->PushNode(transformNode);
+  if (clientNode->GetNumberOfSuppressedMessages() != 1)
+    {
+    std::cout << "FAILURE: " << clientNode->GetNumberOfSuppressedMessages() << " suppressed messages, expected 1" << std::endl;
+    numberOfFailures++;
+    }
+
+  // The fallback does not outlive the capability that caused it: the suppressed push was not
+  // sent, and the next push uses the requested type again
+  SendCapability(socket, clientNode, &numberOfCapabilityEvents, "POSITION", "TRANSFORM");
+  numberOfFailures += IsPushedAs(socket, clientNode, transformNode, "POSITION", "peer with POSITION") ? 0 : 1;
+
+  // Clearing the capability restores the requested type
+  SendCapability(socket, clientNode, &numberOfCapabilityEvents, "TRANSFORM", NULL);
+  numberOfFailures += IsPushedAs(socket, clientNode, transformNode, "TRANSFORM", "peer with TRANSFORM only") ? 0 : 1;
+  int expectedNumberOfEvents = numberOfCapabilityEvents + 1;
+  clientNode->SetCapabilityNegotiation(false);
+  if (clientNode->IsPeerCapabilityKnown() || numberOfCapabilityEvents != expectedNumberOfEvents)
+    {
+    std::cout << "FAILURE: capability of the peer is not cleared when negotiation is turned off" << std::endl;
+    numberOfFailures++;
+    }
+  numberOfFailures += IsPushedAs(socket, clientNode, transformNode, "POSITION", "negotiation off") ? 0 : 1;
+  if (clientNode->GetNumberOfSuppressedMessages() != 1)
+    {
+    std::cout << "FAILURE: pushes were suppressed while the peer supported their type" << std::endl;
+    numberOfFailures++;
+    }
+
+  clientNode->Stop();
+  socket->CloseSocket();
+  serverSocket->CloseSocket();
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: outgoing types follow the capability of the peer" << std::endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+//OpenIGTLink includes
+#include "igtlOSUtil.h"
+#include "igtlTrackingDataMessage.h"
+
+// IF module includes
+#include "vtkIGTLLatencyHistogram.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+#include "vtkMRMLIGTLTrackingDataBundleNode.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// A client connector sends the transforms of an outgoing tracking data bundle to a server connector.
+// All tools go in one TDATA message with the type of each tool. After that, only the tools that
+// changed since the last connector update are sent, again in one message.
+// A TRANSFORM with the name of the bundle has its own stream statistics.
+
+static const int ServerPort = 18949;
+static const int NumberOfTools = 3;
+static const char* ToolNames[NumberOfTools] = { "Probe", "Needle", "Reference" };
+
+static void SetX(vtkMRMLLinearTransformNode* node, double x)
+{
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  matrix->SetElement(0, 3, x);
+  node->SetMatrixTransformToParent(matrix);
+}
+
+static double GetX(vtkMRMLIGTLTrackingDataBundleNode* bundleNode, const char* name)
+{
+  vtkMRMLLinearTransformNode* node = bundleNode->GetTransformNode(bundleNode->GetTransformNodeIndex(name));
+  if (node == NULL)
+    {
+    return -1.0;
+    }
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  node->GetMatrixTransformToParent(matrix);
+  return matrix->GetElement(0, 3);
+}
+
+static int GetNumberOfReceivedMessages(vtkMRMLIGTLConnectorNode* connectorNode)
+{
+  // One arrival interval is recorded for each message after the first one
+  vtkIGTLLatencyHistogram* histogram = connectorNode->GetArrivalIntervalHistogram("TDATA", "Tracker");
+  return histogram ? static_cast<int>(histogram->GetTotalCount()) + 1 : 0;
+}
+
+static void Process(vtkMRMLIGTLConnectorNode* serverNode, vtkMRMLIGTLConnectorNode* clientNode, double duration)
+{
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (vtkTimerLog::GetUniversalTime() - startTime < duration)
+    {
+    clientNode->PeriodicProcess();
+    serverNode->PeriodicProcess();
+    igtl::Sleep(5);
+    }
+}
+
+int main(int argc, char * argv [] )
+{
+  vtkSmartPointer<vtkMRMLScene> serverScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> serverNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  serverScene->AddNode(serverNode);
+  serverNode->SetTypeServer(ServerPort);
+  serverNode->Start();
+  igtl::Sleep(20);
+
+  vtkSmartPointer<vtkMRMLScene> clientScene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> clientNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  clientScene->AddNode(clientNode);
+  clientNode->SetTypeClient("localhost", ServerPort);
+
+  int numberOfFailures = 0;
+  // Streams can be requested for tracking data only. Removed before the connection, nothing is sent.
+  if (clientNode->Subscribe("IMAGE", "Tracker", 50) || clientNode->IsSubscribed("IMAGE", "Tracker")
+    || !clientNode->Subscribe("TDATA", "Tracker", 50) || !clientNode->IsSubscribed("TDATA", "Tracker"))
+    {
+    std::cout << "FAILURE: subscriptions are not limited to TDATA and QTDATA" << std::endl;
+    numberOfFailures++;
+    }
+  clientNode->Unsubscribe("TDATA", "Tracker");
+  clientNode->Start();
+
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (clientNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected)
+    {
+    serverNode->PeriodicProcess();
+    clientNode->PeriodicProcess();
+    igtl::Sleep(5);
+    if (vtkTimerLog::GetUniversalTime() - startTime > 5.0)
+      {
+      std::cout << "FAILURE to connect to server" << std::endl;
+      clientNode->Stop();
+      serverNode->Stop();
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Outgoing bundle: the reference has no type attribute and is sent as TYPE_TRACKER
+  const int toolTypes[NumberOfTools] = { igtl::TrackingDataElement::TYPE_6D, igtl::TrackingDataElement::TYPE_5D,
+                                         igtl::TrackingDataElement::TYPE_TRACKER };
+  vtkSmartPointer<vtkMRMLIGTLTrackingDataBundleNode> outgoingBundleNode = vtkSmartPointer<vtkMRMLIGTLTrackingDataBundleNode>::New();
+  outgoingBundleNode->SetName("Tracker");
+  clientScene->AddNode(outgoingBundleNode);
+  vtkSmartPointer<vtkMRMLLinearTransformNode> toolNodes[NumberOfTools];
+  for (int i = 0; i < NumberOfTools; ++i)
+    {
+    toolNodes[i] = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+    toolNodes[i]->SetName(ToolNames[i]);
+    clientScene->AddNode(toolNodes[i]);
+    SetX(toolNodes[i], 10.0 * (i + 1));
+    if (i < 2)
+      {
+      vtkMRMLIGTLTrackingDataBundleNode::SetToolType(toolNodes[i], toolTypes[i]);
+      }
+    outgoingBundleNode->AddOutgoingTransformNodeID(toolNodes[i]->GetID());
+    }
+  clientNode->RegisterOutgoingMRMLNode(outgoingBundleNode);
+
+  vtkMRMLIGTLTrackingDataBundleNode* bundleNode = NULL;
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    clientNode->PeriodicProcess();
+    serverNode->PeriodicProcess();
+    bundleNode = vtkMRMLIGTLTrackingDataBundleNode::SafeDownCast(serverScene->GetFirstNodeByName("Tracker"));
+    if (bundleNode && bundleNode->GetNumberOfTransformNodes() == NumberOfTools)
+      {
+      break;
+      }
+    igtl::Sleep(5);
+    }
+  if (bundleNode == NULL || bundleNode->GetNumberOfTransformNodes() != NumberOfTools)
+    {
+    std::cout << "FAILURE: the outgoing bundle was not received" << std::endl;
+    clientNode->Stop();
+    serverNode->Stop();
+    return EXIT_FAILURE;
+    }
+  for (int i = 0; i < NumberOfTools; ++i)
+    {
+    int index = bundleNode->GetTransformNodeIndex(ToolNames[i]);
+    if (bundleNode->GetTransformNodeType(index) != toolTypes[i] || fabs(GetX(bundleNode, ToolNames[i]) - 10.0 * (i + 1)) > 1e-4
+      || vtkMRMLIGTLTrackingDataBundleNode::GetToolType(bundleNode->GetTransformNode(index)) != toolTypes[i])
+      {
+      std::cout << "FAILURE: tool " << ToolNames[i] << " was received with type " << bundleNode->GetTransformNodeType(index)
+                << " at " << GetX(bundleNode, ToolNames[i]) << ", expected type " << toolTypes[i] << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  // Without changes nothing more is sent
+  Process(serverNode, clientNode, 0.2);
+  if (GetNumberOfReceivedMessages(serverNode) != 1)
+    {
+    std::cout << "FAILURE: " << GetNumberOfReceivedMessages(serverNode) << " messages for the first update, expected 1" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Two tools changed between two connector updates are sent in one message, without the unchanged tool
+  vtkMRMLLinearTransformNode* receivedReferenceNode = bundleNode->GetTransformNode(bundleNode->GetTransformNodeIndex("Reference"));
+  SetX(receivedReferenceNode, 999.0);
+  SetX(toolNodes[0], 11.0);
+  SetX(toolNodes[1], 21.0);
+  startTime = vtkTimerLog::GetUniversalTime();
+  while ((GetX(bundleNode, "Probe") != 11.0 || GetX(bundleNode, "Needle") != 21.0)
+    && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    clientNode->PeriodicProcess();
+    serverNode->PeriodicProcess();
+    igtl::Sleep(5);
+    }
+  Process(serverNode, clientNode, 0.2);
+  if (fabs(GetX(bundleNode, "Probe") - 11.0) > 1e-4 || fabs(GetX(bundleNode, "Needle") - 21.0) > 1e-4)
+    {
+    std::cout << "FAILURE: the changed tools were not received" << std::endl;
+    numberOfFailures++;
+    }
+  if (GetX(bundleNode, "Reference") != 999.0)
+    {
+    std::cout << "FAILURE: the unchanged tool was sent again" << std::endl;
+    numberOfFailures++;
+    }
+  if (GetNumberOfReceivedMessages(serverNode) != 2)
+    {
+    std::cout << "FAILURE: " << GetNumberOfReceivedMessages(serverNode) << " messages in total, expected 2" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Statistics are kept per message type: a TRANSFORM named like the bundle does not count as TDATA
+  vtkSmartPointer<vtkMRMLLinearTransformNode> transformNode = vtkSmartPointer<vtkMRMLLinearTransformNode>::New();
+  transformNode->SetName("Tracker");
+  clientScene->AddNode(transformNode);
+  clientNode->RegisterOutgoingMRMLNode(transformNode);
+  clientNode->PushNode(transformNode);
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (serverNode->GetArrivalIntervalHistogram("TRANSFORM", "Tracker") == NULL
+    && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    clientNode->PeriodicProcess();
+    serverNode->PeriodicProcess();
+    igtl::Sleep(5);
+    }
+  const char* statisticsType = serverNode->GetStreamStatisticsDeviceType("Tracker");
+  if (serverNode->GetArrivalIntervalHistogram("TRANSFORM", "Tracker") == NULL || GetNumberOfReceivedMessages(serverNode) != 2
+    || statisticsType == NULL || strcmp(statisticsType, "TRANSFORM") != 0)
+    {
+    std::cout << "FAILURE: TRANSFORM and TDATA of the same name do not have separate statistics" << std::endl;
+    numberOfFailures++;
+    }
+  serverNode->ResetStreamStatistics("TRANSFORM", "Tracker");
+  if (serverNode->GetArrivalIntervalHistogram("Tracker") != serverNode->GetArrivalIntervalHistogram("TDATA", "Tracker")
+    || GetNumberOfReceivedMessages(serverNode) != 2)
+    {
+    std::cout << "FAILURE: resetting the TRANSFORM statistics changed the TDATA statistics" << std::endl;
+    numberOfFailures++;
+    }
+
+  clientNode->Stop();
+  serverNode->Stop();
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: changed tools are sent in one TDATA message with their types" << std::endl;
+  return EXIT_SUCCESS;
+}
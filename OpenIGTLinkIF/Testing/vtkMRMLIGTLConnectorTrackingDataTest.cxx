@@ -0,0 +1,308 @@
+//OpenIGTLink includes
+#include "igtlClientSocket.h"
+#include "igtlOSUtil.h"
+#include "igtlQuaternionTrackingDataMessage.h"
+#include "igtlTrackingDataMessage.h"
+#include "igtlTransformMessage.h"
+
+// IF module includes
+#include "vtkIGTLPoseHistory.h"
+#include "vtkIGTLTransformFilter.h"
+#include "vtkMRMLIGTLConnectorNode.h"
+#include "vtkMRMLIGTLTrackingDataBundleNode.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkTimerLog.h>
+
+// STD includes
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// A plain OpenIGTLink client sends TDATA and QTDATA streams that the server connector did not
+// request. Each stream must be received into a tracking data bundle, with the type of each tool.
+// The client then sends a TRANSFORM with the name of a TDATA tool and without time stamps:
+// the two must have separate pose histories, stamped with the arrival time.
+// A filter set for a tool name smooths that tool only.
+// A predicted TRANSFORM keeps a short history even if the pose history is disabled.
+
+static const int ServerPort = 18948;
+
+static const char* ToolNames[] = { "Probe", "Needle", "Reference" };
+static const int ToolTypes[] = { igtl::TrackingDataElement::TYPE_6D, igtl::TrackingDataElement::TYPE_5D,
+                                 igtl::TrackingDataElement::TYPE_TRACKER };
+
+// TDATA without time stamps, tool i at x = 10 * (i + 1) + offset
+static void SendTrackingData(igtl::Socket* socket, double offset)
+{
+  igtl::TrackingDataMessage::Pointer trackingDataMessage = igtl::TrackingDataMessage::New();
+  trackingDataMessage->SetDeviceName("Tracker");
+  trackingDataMessage->SetTimeStamp(0, 0);
+  for (int i = 0; i < 3; ++i)
+    {
+    igtl::TrackingDataElement::Pointer element = igtl::TrackingDataElement::New();
+    element->SetName(ToolNames[i]);
+    element->SetType(ToolTypes[i]);
+    element->SetPosition(static_cast<float>(10.0 * (i + 1) + offset), 0.0f, 0.0f);
+    trackingDataMessage->AddTrackingDataElement(element);
+    }
+  trackingDataMessage->Pack();
+  socket->Send(trackingDataMessage->GetPackPointer(), trackingDataMessage->GetPackSize());
+}
+
+static double GetToolPosition(vtkMRMLIGTLTrackingDataBundleNode* bundleNode, const char* name)
+{
+  vtkMRMLLinearTransformNode* node = bundleNode->GetTransformNode(bundleNode->GetTransformNodeIndex(name));
+  if (node == NULL)
+    {
+    return 0.0;
+    }
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  node->GetMatrixTransformToParent(matrix);
+  return matrix->GetElement(0, 3);
+}
+
+// Send TDATA and wait until the unfiltered Probe tool is updated
+static bool SendAndWaitForTrackingData(igtl::Socket* socket, vtkMRMLIGTLConnectorNode* connectorNode,
+                                       vtkMRMLIGTLTrackingDataBundleNode* bundleNode, double offset)
+{
+  SendTrackingData(socket, offset);
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    connectorNode->PeriodicProcess();
+    if (fabs(GetToolPosition(bundleNode, "Probe") - (10.0 + offset)) < 1e-4)
+      {
+      return true;
+      }
+    igtl::Sleep(5);
+    }
+  return false;
+}
+
+static vtkMRMLIGTLTrackingDataBundleNode* WaitForBundle(vtkMRMLIGTLConnectorNode* connectorNode,
+                                                        vtkMRMLScene* scene, const char* name, int numberOfTools)
+{
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    connectorNode->PeriodicProcess();
+    vtkMRMLIGTLTrackingDataBundleNode* bundleNode =
+      vtkMRMLIGTLTrackingDataBundleNode::SafeDownCast(scene->GetFirstNodeByName(name));
+    if (bundleNode && bundleNode->GetNumberOfTransformNodes() == numberOfTools)
+      {
+      return bundleNode;
+      }
+    igtl::Sleep(5);
+    }
+  return NULL;
+}
+
+static bool CheckTool(vtkMRMLIGTLTrackingDataBundleNode* bundleNode, const char* name, int type, double x)
+{
+  int index = bundleNode->GetTransformNodeIndex(name);
+  vtkMRMLLinearTransformNode* node = bundleNode->GetTransformNode(index);
+  if (index < 0 || node == NULL || bundleNode->GetTransformNodeType(index) != type)
+    {
+    std::cout << "FAILURE: tool " << name << " of " << bundleNode->GetName() << " is missing or has type "
+              << bundleNode->GetTransformNodeType(index) << ", expected " << type << std::endl;
+    return false;
+    }
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  node->GetMatrixTransformToParent(matrix);
+  if (fabs(matrix->GetElement(0, 3) - x) > 1e-4)
+    {
+    std::cout << "FAILURE: tool " << name << " of " << bundleNode->GetName() << " is at " << matrix->GetElement(0, 3)
+              << ", expected " << x << std::endl;
+    return false;
+    }
+  return true;
+}
+
+int main(int argc, char * argv [] )
+{
+  vtkSmartPointer<vtkMRMLScene> scene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLIGTLConnectorNode> serverNode = vtkSmartPointer<vtkMRMLIGTLConnectorNode>::New();
+  scene->AddNode(serverNode);
+  serverNode->SetTypeServer(ServerPort);
+  serverNode->Start();
+  igtl::Sleep(20);
+
+  igtl::ClientSocket::Pointer socket = igtl::ClientSocket::New();
+  if (socket->ConnectToServer("localhost", ServerPort) != 0)
+    {
+    std::cout << "FAILURE to connect to server" << std::endl;
+    serverNode->Stop();
+    return EXIT_FAILURE;
+    }
+  double startTime = vtkTimerLog::GetUniversalTime();
+  while (serverNode->GetState() != vtkMRMLIGTLConnectorNode::StateConnected
+    && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    serverNode->PeriodicProcess();
+    igtl::Sleep(5);
+    }
+
+  // TDATA with tools of different types
+  SendTrackingData(socket, 0.0);
+
+  // QTDATA with a single tool
+  igtl::QuaternionTrackingDataMessage::Pointer quaternionMessage = igtl::QuaternionTrackingDataMessage::New();
+  quaternionMessage->SetDeviceName("QuaternionTracker");
+  igtl::QuaternionTrackingDataElement::Pointer quaternionElement = igtl::QuaternionTrackingDataElement::New();
+  quaternionElement->SetName("Pointer");
+  quaternionElement->SetType(igtl::QuaternionTrackingDataElement::TYPE_3D);
+  quaternionElement->SetPosition(-5.0f, 0.0f, 0.0f);
+  quaternionElement->SetQuaternion(0.0f, 0.0f, 0.0f, 1.0f);
+  quaternionMessage->AddQuaternionTrackingDataElement(quaternionElement);
+  quaternionMessage->Pack();
+  socket->Send(quaternionMessage->GetPackPointer(), quaternionMessage->GetPackSize());
+
+  int numberOfFailures = 0;
+  vtkMRMLIGTLTrackingDataBundleNode* bundleNode = WaitForBundle(serverNode, scene, "Tracker", 3);
+  if (bundleNode == NULL)
+    {
+    std::cout << "FAILURE: the unsolicited TDATA stream was not received" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    for (int i = 0; i < 3; ++i)
+      {
+      numberOfFailures += CheckTool(bundleNode, ToolNames[i], ToolTypes[i], 10.0 * (i + 1)) ? 0 : 1;
+      }
+    }
+  vtkMRMLIGTLTrackingDataBundleNode* quaternionBundleNode = WaitForBundle(serverNode, scene, "QuaternionTracker", 1);
+  if (quaternionBundleNode == NULL)
+    {
+    std::cout << "FAILURE: the unsolicited QTDATA stream was not received" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    numberOfFailures += CheckTool(quaternionBundleNode, "Pointer", igtl::QuaternionTrackingDataElement::TYPE_3D, -5.0) ? 0 : 1;
+    }
+
+  // TRANSFORM named like a TDATA tool, without time stamps
+  const int numberOfTransforms = 3;
+  for (int i = 0; i < numberOfTransforms; ++i)
+    {
+    igtl::TransformMessage::Pointer transformMessage = igtl::TransformMessage::New();
+    transformMessage->SetDeviceName("Probe");
+    transformMessage->SetTimeStamp(0, 0);
+    igtl::Matrix4x4 transformMatrix;
+    igtl::IdentityMatrix(transformMatrix);
+    transformMatrix[0][3] = -100.0f * (i + 1);
+    transformMessage->SetMatrix(transformMatrix);
+    transformMessage->Pack();
+    socket->Send(transformMessage->GetPackPointer(), transformMessage->GetPackSize());
+    // Wait for the transform before sending the next one, so that the arrival times differ
+    startTime = vtkTimerLog::GetUniversalTime();
+    vtkIGTLPoseHistory* history = NULL;
+    while (vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+      {
+      serverNode->PeriodicProcess();
+      history = serverNode->GetPoseHistory("TRANSFORM", "Probe");
+      if (history && history->GetNumberOfPoses() == i + 1)
+        {
+        break;
+        }
+      igtl::Sleep(5);
+      }
+    igtl::Sleep(20);
+    }
+  vtkIGTLPoseHistory* transformHistory = serverNode->GetPoseHistory("TRANSFORM", "Probe");
+  vtkIGTLPoseHistory* toolHistory = serverNode->GetPoseHistory("TDATA", "Probe");
+  if (transformHistory == NULL || toolHistory == NULL || transformHistory == toolHistory
+    || transformHistory->GetNumberOfPoses() != numberOfTransforms || toolHistory->GetNumberOfPoses() != 1)
+    {
+    std::cout << "FAILURE: TRANSFORM and TDATA tool of the same name do not have separate histories of "
+              << numberOfTransforms << " and 1 poses" << std::endl;
+    numberOfFailures++;
+    }
+  else
+    {
+    vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+    double newestTime = transformHistory->GetNewestTimestamp();
+    if (transformHistory->GetOldestTimestamp() >= newestTime
+      || !serverNode->GetTransformAtTime("TRANSFORM", "Probe", newestTime, matrix)
+      || fabs(matrix->GetElement(0, 3) + 100.0 * numberOfTransforms) > 1e-4
+      || !serverNode->GetTransformAtTime("TDATA", "Probe", toolHistory->GetNewestTimestamp(), matrix)
+      || fabs(matrix->GetElement(0, 3) - 10.0) > 1e-4)
+      {
+      std::cout << "FAILURE: poses without sender time stamps are not stamped with their arrival time" << std::endl;
+      numberOfFailures++;
+      }
+    const char* probeType = serverNode->GetPoseHistoryDeviceType("Probe");
+    if (probeType == NULL || strcmp(probeType, "TRANSFORM") != 0
+      || serverNode->GetPoseHistory("Probe") != transformHistory)
+      {
+      std::cout << "FAILURE: lookup by name does not prefer the TRANSFORM history" << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  // A tool with a filter is smoothed, the other tools of the bundle are not
+  if (bundleNode)
+    {
+    serverNode->SetTransformFilterType("Needle", vtkIGTLTransformFilter::FILTER_ONE_EURO);
+    vtkIGTLTransformFilter* filter = serverNode->GetTransformFilter("Needle");
+    filter->SetMinimumCutoffFrequency(0.01);
+    filter->SetCutoffSlope(0.0);
+    // The first pose initializes the filter
+    bool received = SendAndWaitForTrackingData(socket, serverNode, bundleNode, 100.0);
+    double firstPosition = GetToolPosition(bundleNode, "Needle");
+    igtl::Sleep(20);
+    received = SendAndWaitForTrackingData(socket, serverNode, bundleNode, 200.0) && received;
+    double filteredPosition = GetToolPosition(bundleNode, "Needle");
+    if (!received || fabs(firstPosition - 120.0) > 1e-4 || filteredPosition <= 120.0 || filteredPosition >= 220.0 - 1e-4
+      || fabs(GetToolPosition(bundleNode, "Reference") - 230.0) > 1e-4)
+      {
+      std::cout << "FAILURE: filtered tool moved from " << firstPosition << " to " << filteredPosition
+                << ", expected 120 and a smoothed position below 220" << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  // Prediction without pose history
+  serverNode->SetPoseHistoryCapacity(0);
+  serverNode->SetPosePredictionEnabled("Moving", true);
+  for (int i = 0; i < 2; ++i)
+    {
+    igtl::TransformMessage::Pointer transformMessage = igtl::TransformMessage::New();
+    transformMessage->SetDeviceName("Moving");
+    igtl::Matrix4x4 transformMatrix;
+    igtl::IdentityMatrix(transformMatrix);
+    transformMessage->SetMatrix(transformMatrix);
+    transformMessage->Pack();
+    socket->Send(transformMessage->GetPackPointer(), transformMessage->GetPackSize());
+    }
+  startTime = vtkTimerLog::GetUniversalTime();
+  while (serverNode->GetPoseHistory("TRANSFORM", "Moving") == NULL && vtkTimerLog::GetUniversalTime() - startTime < 5.0)
+    {
+    serverNode->PeriodicProcess();
+    igtl::Sleep(5);
+    }
+  if (serverNode->GetPoseHistory("TRANSFORM", "Moving") == NULL || serverNode->GetPoseHistory("TRANSFORM", "Probe") != NULL)
+    {
+    std::cout << "FAILURE: with pose history capacity 0, only predicted transforms must have a history" << std::endl;
+    numberOfFailures++;
+    }
+
+  socket->CloseSocket();
+  serverNode->Stop();
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: unsolicited tracking data is received with the type of each tool" << std::endl;
+  return EXIT_SUCCESS;
+}
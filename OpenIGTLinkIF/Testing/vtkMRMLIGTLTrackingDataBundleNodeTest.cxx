@@ -0,0 +1,156 @@
+// IF module includes
+#include "vtkMRMLIGTLTrackingDataBundleNode.h"
+
+// MRML includes
+#include <vtkMRMLLinearTransformNode.h>
+#include <vtkMRMLScene.h>
+
+// VTK includes
+#include <vtkDoubleArray.h>
+#include <vtkMatrix4x4.h>
+#include <vtkSmartPointer.h>
+#include <vtkStringArray.h>
+
+// STD includes
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static std::string ToolName(int toolIndex)
+{
+  std::stringstream ss;
+  ss << "Tool" << toolIndex;
+  return ss.str();
+}
+
+// Translation of the tool matrix encodes the tool index and the update
+static void SetToolMatrix(double* elements, int toolIndex, int update)
+{
+  for (int i = 0; i < 16; ++i)
+    {
+    elements[i] = (i % 5 == 0) ? 1.0 : 0.0;
+    }
+  elements[3] = toolIndex;
+  elements[7] = update;
+}
+
+static bool HasToolMatrix(vtkMRMLLinearTransformNode* node, int toolIndex, int update)
+{
+  if (node == NULL)
+    {
+    return false;
+    }
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  node->GetMatrixTransformToParent(matrix);
+  return matrix->GetElement(0, 3) == toolIndex && matrix->GetElement(1, 3) == update;
+}
+
+int main(int argc, char * argv [] )
+{
+  int numberOfFailures = 0;
+
+  vtkSmartPointer<vtkMRMLScene> scene = vtkSmartPointer<vtkMRMLScene>::New();
+  vtkSmartPointer<vtkMRMLIGTLTrackingDataBundleNode> bundleNode = vtkSmartPointer<vtkMRMLIGTLTrackingDataBundleNode>::New();
+  scene->AddNode(bundleNode);
+
+  // Enough tools to grow the name hash table several times
+  const int numberOfTools = 100;
+  std::vector<std::string> names;
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+    names.push_back(ToolName(toolIndex));
+    }
+
+  // Single updates, added in reverse order
+  vtkSmartPointer<vtkMatrix4x4> matrix = vtkSmartPointer<vtkMatrix4x4>::New();
+  for (int toolIndex = numberOfTools - 1; toolIndex >= numberOfTools / 2; --toolIndex)
+    {
+    SetToolMatrix(&matrix->Element[0][0], toolIndex, 0);
+    bundleNode->UpdateTransformNode(names[toolIndex].c_str(), matrix);
+    }
+
+  // Batch update of all tools, the first half is new
+  std::vector<const char*> toolNames;
+  std::vector<double> matrices(16 * numberOfTools);
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+    toolNames.push_back(names[toolIndex].c_str());
+    SetToolMatrix(&matrices[16 * toolIndex], toolIndex, 1);
+    }
+  bundleNode->UpdateTransformNodes(numberOfTools, &toolNames[0], &matrices[0]);
+
+  if (bundleNode->GetNumberOfTransformNodes() != numberOfTools)
+    {
+    std::cout << "FAILURE: " << bundleNode->GetNumberOfTransformNodes() << " transform nodes, expected "
+              << numberOfTools << std::endl;
+    numberOfFailures++;
+    }
+
+  // Tools are kept in the order they were added: the second half in reverse order, then the first half
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+    int expectedIndex = toolIndex >= numberOfTools / 2 ? numberOfTools - 1 - toolIndex : numberOfTools / 2 + toolIndex;
+    int index = bundleNode->GetTransformNodeIndex(names[toolIndex].c_str());
+    vtkMRMLLinearTransformNode* node = bundleNode->GetTransformNode(expectedIndex);
+    if (index != expectedIndex || node == NULL || names[toolIndex] != node->GetName()
+      || !HasToolMatrix(node, toolIndex, 1) || node->GetScene() != scene.GetPointer())
+      {
+      std::cout << "FAILURE: tool " << names[toolIndex] << " has index " << index << ", expected "
+                << expectedIndex << std::endl;
+      numberOfFailures++;
+      }
+    }
+  if (bundleNode->GetTransformNodeIndex("Tool") != -1 || bundleNode->GetTransformNodeIndex("") != -1
+    || bundleNode->GetTransformNodeIndex(NULL) != -1 || bundleNode->GetTransformNode(numberOfTools) != NULL)
+    {
+    std::cout << "FAILURE: unknown tools are found in the bundle" << std::endl;
+    numberOfFailures++;
+    }
+
+  // Wrapped batch update
+  vtkSmartPointer<vtkStringArray> nameArray = vtkSmartPointer<vtkStringArray>::New();
+  vtkSmartPointer<vtkDoubleArray> matrixArray = vtkSmartPointer<vtkDoubleArray>::New();
+  matrixArray->SetNumberOfComponents(16);
+  double elements[16];
+  for (int toolIndex = 0; toolIndex <= numberOfTools; toolIndex += 10)
+    {
+    nameArray->InsertNextValue(ToolName(toolIndex));
+    SetToolMatrix(elements, toolIndex, 2);
+    matrixArray->InsertNextTuple(elements);
+    }
+  bundleNode->UpdateTransformNodes(nameArray, matrixArray);
+  if (bundleNode->GetNumberOfTransformNodes() != numberOfTools + 1
+    || bundleNode->GetTransformNodeIndex(ToolName(numberOfTools).c_str()) != numberOfTools)
+    {
+    std::cout << "FAILURE: the wrapped batch update did not append the new tool" << std::endl;
+    numberOfFailures++;
+    }
+  for (int toolIndex = 0; toolIndex < numberOfTools; ++toolIndex)
+    {
+    vtkMRMLLinearTransformNode* node = bundleNode->GetTransformNode(
+      bundleNode->GetTransformNodeIndex(names[toolIndex].c_str()));
+    if (!HasToolMatrix(node, toolIndex, toolIndex % 10 == 0 ? 2 : 1))
+      {
+      std::cout << "FAILURE: wrapped batch update of tool " << names[toolIndex] << std::endl;
+      numberOfFailures++;
+      }
+    }
+
+  // Mismatched arrays are rejected
+  matrixArray->SetNumberOfTuples(1);
+  bundleNode->UpdateTransformNodes(nameArray, matrixArray);
+  if (!HasToolMatrix(bundleNode->GetTransformNode(bundleNode->GetTransformNodeIndex("Tool0")), 0, 2))
+    {
+    std::cout << "FAILURE: mismatched name and matrix arrays were applied" << std::endl;
+    numberOfFailures++;
+    }
+
+  if (numberOfFailures > 0)
+    {
+    return EXIT_FAILURE;
+    }
+  std::cout << "SUCCESS: tracking data bundle tools are found by name and kept in order" << std::endl;
+  return EXIT_SUCCESS;
+}